@@ -23,7 +23,7 @@ layout (location = 6) out vec4 outPrevPosinClipSpace;
 
 void main() 
 {
-	MeshData meshData 		= g_meshUniform.data[g_pushConstant.mesh_id];
+	MeshData meshData 		= g_meshUniform.data[g_pushConstant.mesh_id + gl_InstanceIndex];
 
 	outUV 					= inUV;
 	
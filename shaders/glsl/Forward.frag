@@ -121,20 +121,18 @@ void main()
 			lightColor						= lightColor * light.intensity;
 
 			// Compute Shadow if enabled
-			int enableShadowRTPCF = int(g_Info.enable_Shadow_RT_PCF);
-			if((enableShadowRTPCF & ENABLE_SHADOW) == ENABLE_SHADOW)
+			if(HAS_FEATURE(ENABLE_SHADOW))
 			{
-				if((enableShadowRTPCF & ENABLE_RT_SHADOW) != ENABLE_RT_SHADOW)
+				if(!HAS_FEATURE(ENABLE_RT_SHADOW))
 				{
-					bool enablePCF = ((enableShadowRTPCF & ENABLE_PCF) == ENABLE_PCF);
-					shadow = CalculateDirectonalShadow(inPosinLightSpace, N, enablePCF);
+					shadow = CalculateDirectonalShadow(inPosinLightSpace, N, HAS_FEATURE(ENABLE_PCF));
 				}
 			}
 
 			// Compute directional light if IBL is disabled
 			// Otherwise the ambient light is picked from
 			// Diffuse Irradiance and Specular IBL Maps
-			if(g_Info.enableIBL == 0)
+			if(!HAS_FEATURE(ENABLE_IBL))
 			{
 		 		// There is no attenuation for directional light
 				radiance = lightColor * light.intensity * attenuation * (1.0f - shadow);
@@ -189,7 +187,7 @@ void main()
 		}
 	}
 
-	if(g_Info.enableIBL == 1)
+	if(HAS_FEATURE(ENABLE_IBL))
 	{
 		// Ambient lighting to use IBL
 		vec3 F = FresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughMetal.x);
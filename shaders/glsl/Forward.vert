@@ -30,7 +30,7 @@ vec3 MakeTangentOrthogonal(in vec3 N, in vec3 T)
 
 void main() 
 {
-	MeshData meshData 					= g_meshUniform.data[g_pushConstant.mesh_id];
+	MeshData meshData 					= g_meshUniform.data[g_pushConstant.mesh_id + gl_InstanceIndex];
 	outUV 								= inUV;	
 	outNormalinViewSpace 				= normalize((meshData.normalMatrix * vec4(inNormal.x, inNormal.y, inNormal.z, 0.0f))).xyz; 
 	outTangentinVieSpace	 			= normalize((meshData.normalMatrix * vec4(inTangent.x, inTangent.y, inTangent.z, 0.0f))).xyz; 
@@ -15,7 +15,7 @@ layout (location = 3) in vec4 inTangent;
 
 void main() 
 {
-	MeshData meshData 			= g_meshUniform.data[g_pushConstant.mesh_id];
+	MeshData meshData 			= g_meshUniform.data[g_pushConstant.mesh_id + gl_InstanceIndex];
 
 	for(int i = 0; i < g_lights.count; i++)
 	{
@@ -9,9 +9,10 @@ struct MeshData
 	mat4  modelMatrix;			// model matrix for this vertex buffer
 	mat4  normalMatrix;			// inverse transpose of (view * model)
 };
-layout(set = 1, binding = 0) uniform Mesh
+// One entry per mesh instance. Instanced draws index it with mesh_id + gl_InstanceIndex
+layout(set = 1, binding = 0) readonly buffer Mesh
 {
-	MeshData data[1];
+	MeshData data[];
 } g_meshUniform;
 
 layout(set = 1, binding = 1) uniform samplerCube g_env_specular_Sampler;
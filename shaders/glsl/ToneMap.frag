@@ -83,13 +83,13 @@ void main()
 {    
     vec3 color = texture(sampler2D(g_RT_SampledImages[SAMPLE_PRIMARY_COLOR], g_LinearSampler), inUV).xyz;
 
-    if(g_Info.enabelSSAO == 1)
+    if(HAS_FEATURE(ENABLE_SSAO))
 	{
 		float ssaoFactor = imageLoad(g_RT_StorageImages[STORE_SSAO_AND_BLUR], ivec2(gl_FragCoord.xy)).y;
         color *=  ssaoFactor;
 	}
 
-    if(g_Info.ssrEnabled == 1)
+    if(HAS_FEATURE(ENABLE_SSR))
     {
         vec4 reflectedColor = texture(sampler2D(g_RT_SampledImages[SAMPLE_SS_REFLECTION], g_LinearSampler), inUV).xyzw;
         if(reflectedColor.w < 0.8)
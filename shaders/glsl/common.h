@@ -42,6 +42,11 @@ layout(set = 0, binding = 0) uniform GlobalBuffer
 	float	UNASSIGINED_Float2;
 } g_Info;
 
+// The ENABLE_ flags the pipeline was built with, see CPass::SelectPermutation. Branches on HAS_FEATURE are
+// resolved when the pipeline is specialized, a disabled feature costs neither ALU nor texture fetches
+layout(constant_id = FEATURE_PERMUTATION_ID) const uint c_features = 0;
+#define HAS_FEATURE(feature) ((c_features & uint(feature)) == uint(feature))
+
 layout(set = 0, binding = 1) uniform sampler g_LinearSampler;
 layout(set = 0, binding = 2) uniform sampler g_NearestSampler;
 
@@ -0,0 +1,710 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "core/Global.h"
+#include "core/AssetLoader.h"
+#include "core/FileIO.h"
+#include "core/GltfParser.h"
+#include "core/MeshDecoder.h"
+#include "core/TextureCompressor.h"
+#include "core/TextureIngester.h"
+#include "core/RandGen.h"
+
+// CPU side microbenchmarks of the asset pipeline. Nothing here touches Vulkan, so it runs on machines
+// without a GPU. Every case runs a number of iterations and reports the median, which keeps a single
+// slow iteration (page faults, a busy build machine) out of the numbers compared across releases
+//
+//  VFrameAssetBench [--default-path <path>] [--iterations <n>] [--out <path>] [--file-backend stream|mapped|uring]
+//                   [--gltf-parser tinygltf|streaming]
+typedef std::chrono::high_resolution_clock Clock;
+
+struct BenchResult
+{
+    std::string                 name;
+    double                      medianMs;
+    double                      throughput;
+    const char*                 unit;
+};
+
+static std::vector<BenchResult> s_results;
+
+// Keeps the optimizer from dropping work whose result is otherwise unused
+static volatile uint64_t s_sink = 0;
+
+static double MedianMs(std::vector<double>& p_times)
+{
+    std::sort(p_times.begin(), p_times.end());
+    return p_times[p_times.size() / 2];
+}
+
+// Runs p_func p_iterations times and adds one result per unit, p_amounts being the work done per iteration.
+// The loaders log every file they read, the log is silenced while measuring
+static bool Measure(const std::string& p_name, uint32_t p_iterations, std::function<bool()> p_func,
+    const std::vector<std::pair<double, const char*>>& p_amounts)
+{
+    std::streambuf* clogBuffer = std::clog.rdbuf(nullptr);
+
+    std::vector<double> times;
+    bool success = true;
+    for (uint32_t i = 0; i < p_iterations && success; i++)
+    {
+        Clock::time_point start = Clock::now();
+        success = p_func();
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    std::clog.rdbuf(clogBuffer);
+    std::clog.clear();
+
+    if (!success)
+    {
+        std::cerr << "AssetBenchmark Error: " << p_name << " failed" << std::endl;
+        return false;
+    }
+
+    double medianMs = MedianMs(times);
+    for (const auto& amount : p_amounts)
+    {
+        BenchResult result{ p_name, medianMs, amount.first / (medianMs / 1000.0), amount.second };
+        std::cout << result.name << ": " << result.medianMs << " ms, " << result.throughput << " " << result.unit << std::endl;
+        s_results.push_back(result);
+    }
+    return true;
+}
+
+static size_t GetPeakRSS()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return (size_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss * 1024;     // kilobytes on Linux
+#endif
+}
+
+static size_t CountVertices(const SceneRaw& p_scene)
+{
+    size_t count = 0;
+    for (const auto& mesh : p_scene.meshList)
+        count += mesh.vertexList.size() / mesh.vertexList.GetVertexSize();
+    return count;
+}
+
+static void FreeScene(SceneRaw& p_scene)
+{
+    for (auto& image : p_scene.textureList)
+        FreeRawImage(image);
+    p_scene = SceneRaw{};
+}
+
+static bool BenchModels(const std::filesystem::path& p_folder, uint32_t p_iterations)
+{
+    if (!std::filesystem::is_directory(p_folder))
+    {
+        std::cerr << "AssetBenchmark Error: No models folder " << p_folder << std::endl;
+        return false;
+    }
+
+    // compressed glTF meshes are decoded on the workers, as the scene loads them
+    CMeshDecoder meshDecoder;
+    RETURN_FALSE_IF_FALSE(meshDecoder.Create(CMeshDecoder::Settings{}));
+
+    for (const auto& entry : std::filesystem::directory_iterator(p_folder))
+    {
+        std::string extn = entry.path().extension().string();
+        bool isGltf = (extn == ".gltf" || extn == ".glb");
+        bool isObj = (extn == ".obj");
+        if (!isGltf && !isObj)
+            continue;
+
+        // the loaders split the folder off at the last '/'. Throughput is of the model file alone,
+        // external buffers and textures are read but not counted
+        std::string path = entry.path().generic_string();
+        double megaBytes = (double)std::filesystem::file_size(entry.path()) / (1024.0 * 1024.0);
+
+        // one load outside of the measurement to count the vertices and warm the file cache
+        ObjLoadData loadData{};
+        loadData.meshDecoder = &meshDecoder;
+        SceneRaw scene{};
+        if (!(isGltf ? LoadGltf(path.c_str(), scene, loadData) : LoadObj(path.c_str(), scene, loadData)))
+        {
+            std::cerr << "AssetBenchmark Error: Failed to load " << path << std::endl;
+            return false;
+        }
+        double vertices = (double)CountVertices(scene);
+        FreeScene(scene);
+
+        RETURN_FALSE_IF_FALSE(Measure((isGltf ? "LoadGltf " : "LoadObj ") + entry.path().filename().string(), p_iterations,
+            [&]()
+            {
+                SceneRaw loadedScene{};
+                bool loaded = isGltf ? LoadGltf(path.c_str(), loadedScene, loadData) : LoadObj(path.c_str(), loadedScene, loadData);
+                s_sink += CountVertices(loadedScene);
+                FreeScene(loadedScene);
+                return loaded;
+            },
+            { { megaBytes, "MB/s" }, { vertices, "vertices/s" } }));
+    }
+    return true;
+}
+
+// A .gltf of many small nodes, meshes and materials around an embedded base64 buffer, the shape of the large
+// scenes exporters write, as the models folder has few of those
+static bool WriteSyntheticGltf(const std::filesystem::path& p_path, uint32_t p_meshCount, uint32_t p_nodeCount, uint32_t p_materialCount)
+{
+    // 3 positions and 3 16 bit indices a mesh
+    std::vector<unsigned char> data((size_t)p_meshCount * 44);
+    int seed = 11;
+    for (uint32_t i = 0; i < p_meshCount; i++)
+    {
+        float* positions = reinterpret_cast<float*>(data.data() + (size_t)i * 36);
+        for (uint32_t c = 0; c < 9; c++)
+            positions[c] = frand(&seed) * 10.0f;
+
+        uint16_t indices[3] = { 0, 1, 2 };
+        memcpy(data.data() + (size_t)p_meshCount * 36 + (size_t)i * 8, indices, sizeof(indices));
+    }
+
+    const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string base64;
+    base64.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+        uint32_t bits = (uint32_t)data[i] << 16 | (i + 1 < data.size() ? (uint32_t)data[i + 1] << 8 : 0) | (i + 2 < data.size() ? data[i + 2] : 0);
+        base64 += alphabet[bits >> 18];
+        base64 += alphabet[(bits >> 12) & 63];
+        base64 += (i + 1 < data.size()) ? alphabet[(bits >> 6) & 63] : '=';
+        base64 += (i + 2 < data.size()) ? alphabet[bits & 63] : '=';
+    }
+
+    std::ofstream file(p_path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "AssetBenchmark Error: Failed to write " << p_path << std::endl;
+        return false;
+    }
+
+    file << "{\n    \"asset\": { \"version\": \"2.0\", \"generator\": \"VFrameAssetBench\" },\n    \"scene\": 0,\n";
+    file << "    \"scenes\": [ { \"nodes\": [";
+    for (uint32_t i = 0; i < p_nodeCount; i++)
+        file << (i == 0 ? " " : ", ") << i;
+    file << " ] } ],\n    \"nodes\": [\n";
+    for (uint32_t i = 0; i < p_nodeCount; i++)
+    {
+        file << "        {\n            \"name\": \"Node_" << i << "\",\n            \"mesh\": " << i % p_meshCount << ",\n";
+        file << "            \"translation\": [ " << frand(&seed) * 100.0f << ", " << frand(&seed) * 100.0f << ", " << frand(&seed) * 100.0f << " ]\n";
+        file << "        }" << (i + 1 < p_nodeCount ? "," : "") << "\n";
+    }
+    file << "    ],\n    \"meshes\": [\n";
+    for (uint32_t i = 0; i < p_meshCount; i++)
+    {
+        file << "        {\n            \"name\": \"Mesh_" << i << "\",\n            \"primitives\": [ {\n";
+        file << "                \"attributes\": { \"POSITION\": " << i * 2 << " },\n";
+        file << "                \"indices\": " << i * 2 + 1 << ",\n                \"material\": " << i % p_materialCount << "\n";
+        file << "            } ]\n        }" << (i + 1 < p_meshCount ? "," : "") << "\n";
+    }
+    file << "    ],\n    \"accessors\": [\n";
+    for (uint32_t i = 0; i < p_meshCount; i++)
+    {
+        const float* positions = reinterpret_cast<const float*>(data.data() + (size_t)i * 36);
+        float bbMin[3], bbMax[3];
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            bbMin[c] = (std::min)({ positions[c], positions[3 + c], positions[6 + c] });
+            bbMax[c] = (std::max)({ positions[c], positions[3 + c], positions[6 + c] });
+        }
+
+        file << "        { \"bufferView\": 0, \"byteOffset\": " << i * 36 << ", \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\",\n";
+        file << "          \"min\": [ " << bbMin[0] << ", " << bbMin[1] << ", " << bbMin[2] << " ], \"max\": [ " << bbMax[0] << ", " << bbMax[1] << ", " << bbMax[2] << " ] },\n";
+        file << "        { \"bufferView\": 1, \"byteOffset\": " << i * 8 << ", \"componentType\": 5123, \"count\": 3, \"type\": \"SCALAR\" }";
+        file << (i + 1 < p_meshCount ? "," : "") << "\n";
+    }
+    file << "    ],\n    \"materials\": [\n";
+    for (uint32_t i = 0; i < p_materialCount; i++)
+    {
+        file << "        {\n            \"name\": \"Material_" << i << "\",\n            \"pbrMetallicRoughness\": {\n";
+        file << "                \"baseColorFactor\": [ " << frand(&seed) << ", " << frand(&seed) << ", " << frand(&seed) << ", 1.0 ],\n";
+        file << "                \"metallicFactor\": " << frand(&seed) << ",\n                \"roughnessFactor\": " << frand(&seed) << "\n";
+        file << "            },\n            \"emissiveFactor\": [ 0.0, 0.0, 0.0 ],\n            \"doubleSided\": false\n";
+        file << "        }" << (i + 1 < p_materialCount ? "," : "") << "\n";
+    }
+    file << "    ],\n    \"bufferViews\": [\n";
+    file << "        { \"buffer\": 0, \"byteOffset\": 0, \"byteLength\": " << p_meshCount * 36 << ", \"byteStride\": 12, \"target\": 34962 },\n";
+    file << "        { \"buffer\": 0, \"byteOffset\": " << p_meshCount * 36 << ", \"byteLength\": " << p_meshCount * 8 << ", \"target\": 34963 }\n";
+    file << "    ],\n    \"buffers\": [\n        { \"byteLength\": " << data.size() << ", \"uri\": \"data:application/octet-stream;base64," << base64 << "\" }\n    ]\n}\n";
+
+    return (bool)file;
+}
+
+// LoadGltf of the same files with each JSON parser. Images are only sized, not decoded, so the parse and the mesh
+// reads are most of what is measured
+static bool BenchGltfParsers(const std::filesystem::path& p_folder, uint32_t p_iterations)
+{
+    std::vector<std::filesystem::path> paths;
+    if (std::filesystem::is_directory(p_folder))
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(p_folder))
+        {
+            std::string extn = entry.path().extension().string();
+            if (extn == ".gltf" || extn == ".glb")
+                paths.push_back(entry.path());
+        }
+    }
+
+    std::filesystem::path syntheticPath = std::filesystem::temp_directory_path() / "VFrameAssetBench_Synthetic.gltf";
+    RETURN_FALSE_IF_FALSE(WriteSyntheticGltf(syntheticPath, 16384, 65536, 1024));
+    paths.push_back(syntheticPath);
+
+    CMeshDecoder meshDecoder;
+    RETURN_FALSE_IF_FALSE(meshDecoder.Create(CMeshDecoder::Settings{}));
+
+    ObjLoadData loadData{};
+    loadData.meshDecoder = &meshDecoder;
+    loadData.deferDecode = true;
+
+    const std::pair<GltfParser, const char*> parsers[] = { { gp_tinygltf, "tinygltf" }, { gp_streaming, "streaming" } };
+    GltfParser selected = GetGltfParser();
+    bool success = true;
+    for (const auto& filePath : paths)
+    {
+        std::string path = filePath.generic_string();
+        double megaBytes = (double)std::filesystem::file_size(filePath) / (1024.0 * 1024.0);
+        for (const auto& parser : parsers)
+        {
+            SetGltfParser(parser.first);
+            success = Measure(std::string("LoadGltf ") + parser.second + " " + filePath.filename().string(), p_iterations,
+                [&]()
+                {
+                    SceneRaw scene{};
+                    bool loaded = LoadGltf(path.c_str(), scene, loadData);
+                    s_sink += CountVertices(scene);
+                    FreeScene(scene);
+                    return loaded;
+                },
+                { { megaBytes, "MB/s" } });
+
+            if (!success)
+                break;
+        }
+
+        if (!success)
+            break;
+    }
+
+    SetGltfParser(selected);
+    std::filesystem::remove(syntheticPath);
+    return success;
+}
+
+static bool BenchImages(const std::filesystem::path& p_folder, uint32_t p_iterations)
+{
+    if (!std::filesystem::is_directory(p_folder))
+    {
+        std::cerr << "AssetBenchmark Error: No textures folder " << p_folder << std::endl;
+        return false;
+    }
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(p_folder))
+    {
+        std::string extn = entry.path().extension().string();
+        std::transform(extn.begin(), extn.end(), extn.begin(), [](char c) { return (char)tolower(c); });
+        bool isDDS = (extn == ".dds");
+        if (!isDDS && extn != ".png" && extn != ".jpg" && extn != ".tga" && extn != ".hdr" && extn != ".ktx2")
+            continue;
+
+        std::string path = entry.path().generic_string();
+        double megaBytes = (double)std::filesystem::file_size(entry.path()) / (1024.0 * 1024.0);
+
+        RETURN_FALSE_IF_FALSE(Measure((isDDS ? "LoadDDS " : "LoadRawImage ") + entry.path().filename().string(), p_iterations,
+            [&]()
+            {
+                ImageRaw image{};
+                bool loaded = isDDS ? LoadDDS(path.c_str(), image) : LoadRawImage(path.c_str(), image);
+
+                // LoadDDS leaves the extension empty, FreeRawImage picks the deallocation by it
+                if (isDDS)
+                    image.fileExtn = "dds";
+
+                s_sink += (uint64_t)image.width;
+                FreeRawImage(image);
+                return loaded;
+            },
+            { { megaBytes, "MB/s" } }));
+    }
+    return true;
+}
+
+// Reads every texture file of the folder together through each file backend, touching a byte of every page so the
+// mapped views are read too. Past the first iteration the files come from the page cache, which leaves out the
+// round trips of network storage the batched reads are for
+static bool BenchFileRead(const std::filesystem::path& p_folder, uint32_t p_iterations)
+{
+    if (!std::filesystem::is_directory(p_folder))
+    {
+        std::cerr << "AssetBenchmark Error: No textures folder " << p_folder << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> paths;
+    double megaBytes = 0.0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(p_folder))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        paths.push_back(entry.path().generic_string());
+        megaBytes += (double)entry.file_size() / (1024.0 * 1024.0);
+    }
+
+    const std::pair<FileBackend, const char*> backends[] = { { fb_stream, "stream" }, { fb_mapped, "mapped" }, { fb_uring, "uring" } };
+    FileBackend selected = GetFileBackend();
+    bool success = true;
+    for (const auto& backend : backends)
+    {
+        SetFileBackend(backend.first);
+        success = Measure(std::string("ReadFiles ") + backend.second, p_iterations,
+            [&]()
+            {
+                std::vector<CFileView> files;
+                bool read = ReadFiles(paths, files);
+                for (const auto& file : files)
+                    for (size_t offset = 0; offset < file.GetSize(); offset += 4096)
+                        s_sink += file.GetData()[offset];
+                return read;
+            },
+            { { megaBytes, "MB/s" }, { (double)paths.size(), "files/s" } });
+
+        if (!success)
+            break;
+    }
+
+    SetFileBackend(selected);
+    return success;
+}
+
+// Block compresses every texture of the folder as each usage would, without the disk cache
+static bool BenchCompression(const std::filesystem::path& p_folder, uint32_t p_iterations)
+{
+    if (!std::filesystem::is_directory(p_folder))
+    {
+        std::cerr << "AssetBenchmark Error: No textures folder " << p_folder << std::endl;
+        return false;
+    }
+
+    CTextureCompressor compressor;
+    RETURN_FALSE_IF_FALSE(compressor.Create(CTextureCompressor::Settings{}));
+
+    const std::pair<TextureUsage, const char*> usages[] = { { tu_color, "BC7" }, { tu_normal, "BC5" }, { tu_emissive, "BC1" } };
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(p_folder))
+    {
+        std::string extn = entry.path().extension().string();
+        std::transform(extn.begin(), extn.end(), extn.begin(), [](char c) { return (char)tolower(c); });
+        if (extn != ".png" && extn != ".jpg" && extn != ".tga")
+            continue;
+
+        std::string path = entry.path().generic_string();
+        ImageRaw source{};
+        if (!LoadRawImage(path.c_str(), source))
+        {
+            std::cerr << "AssetBenchmark Error: Failed to load " << path << std::endl;
+            return false;
+        }
+
+        size_t sourceSize = (size_t)source.width * source.height * 4;
+        double megaPixels = (double)source.width * source.height / (1000.0 * 1000.0);
+        for (const auto& usage : usages)
+        {
+            RETURN_FALSE_IF_FALSE(Measure(std::string("Compress ") + usage.second + " " + entry.path().filename().string(), p_iterations,
+                [&]()
+                {
+                    std::vector<ImageRaw> textures(1, source);
+                    textures[0].raw = (unsigned char*)malloc(sourceSize);
+                    memcpy(textures[0].raw, source.raw, sourceSize);
+                    textures[0].usage = usage.first;
+
+                    bool compressed = compressor.Compress(textures);
+                    s_sink += textures[0].dataSize;
+                    FreeRawImage(textures[0]);
+                    return compressed;
+                },
+                { { megaPixels, "MPixels/s" } }));
+        }
+        FreeRawImage(source);
+    }
+    return true;
+}
+
+// Loads every glTF model of the folder with its images kept encoded and runs them through the ingester with
+// the compressor, staging nothing. The peak of decoded data in flight is of the last iteration
+static bool BenchIngest(const std::filesystem::path& p_folder, uint32_t p_iterations)
+{
+    if (!std::filesystem::is_directory(p_folder))
+    {
+        std::cerr << "AssetBenchmark Error: No models folder " << p_folder << std::endl;
+        return false;
+    }
+
+    CTextureCompressor compressor;
+    RETURN_FALSE_IF_FALSE(compressor.Create(CTextureCompressor::Settings{}));
+
+    CTextureIngester ingester;
+    RETURN_FALSE_IF_FALSE(ingester.Create(CTextureIngester::Settings{ (size_t)TEXTURE_INGEST_BUDGET_MB * 1024 * 1024, 0 }));
+
+    for (const auto& entry : std::filesystem::directory_iterator(p_folder))
+    {
+        std::string extn = entry.path().extension().string();
+        if (extn != ".gltf" && extn != ".glb")
+            continue;
+
+        std::string path = entry.path().generic_string();
+        ObjLoadData loadData{};
+        loadData.deferDecode = true;
+
+        SceneRaw scene{};
+        if (!LoadGltf(path.c_str(), scene, loadData))
+        {
+            std::cerr << "AssetBenchmark Error: Failed to load " << path << std::endl;
+            return false;
+        }
+        double textures = (double)scene.textureList.size();
+        FreeScene(scene);
+
+        RETURN_FALSE_IF_FALSE(Measure("Ingest " + entry.path().filename().string(), p_iterations,
+            [&]()
+            {
+                SceneRaw loadedScene{};
+                bool ingested = LoadGltf(path.c_str(), loadedScene, loadData) &&
+                    ingester.Ingest(loadedScene.textureList, &compressor, [](size_t, ImageRaw& p_texture) { s_sink += p_texture.dataSize; return true; });
+                FreeScene(loadedScene);
+                return ingested;
+            },
+            { { textures, "textures/s" } }));
+
+        std::cout << "Ingest " << entry.path().filename().string() << ": peak " << (double)ingester.GetStats().peakBytes / (1024.0 * 1024.0)
+            << " MB decoded in flight" << std::endl;
+    }
+    return true;
+}
+
+// Welds the unindexed triangle list of a UV sphere, as LoadObj receives faces from tinyobj
+static bool BenchWelding(uint32_t p_iterations)
+{
+    RawSphere sphere;
+    GenerateSphere(256, 512, sphere);
+
+    VertexList source(Vertex::AttributeFlag::position | Vertex::AttributeFlag::normal | Vertex::AttributeFlag::uv | Vertex::AttributeFlag::tangent);
+    std::vector<Vertex> unindexed;
+    unindexed.reserve(sphere.indices.size());
+    const float* positions = sphere.vertices.data();
+    for (int index : sphere.indices)
+    {
+        const float* position = &positions[index * sphere.vertices.GetVertexSize()];
+        float uv[2] = { position[0], position[1] };
+        float tangent[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+        Vertex vertex = source.CreateVertex();
+        vertex.AddAttribute(Vertex::AttributeFlag::position, position);
+        vertex.AddAttribute(Vertex::AttributeFlag::normal, position);
+        vertex.AddAttribute(Vertex::AttributeFlag::uv, uv);
+        vertex.AddAttribute(Vertex::AttributeFlag::tangent, tangent);
+        unindexed.push_back(vertex);
+    }
+
+    return Measure("WeldVertex", p_iterations,
+        [&]()
+        {
+            VertexList welded(Vertex::AttributeFlag::position | Vertex::AttributeFlag::normal | Vertex::AttributeFlag::uv | Vertex::AttributeFlag::tangent);
+            std::vector<uint32_t> indices;
+            indices.reserve(unindexed.size());
+            std::unordered_map<Vertex, uint32_t> uniqueVertices;
+            for (const auto& vertex : unindexed)
+                indices.push_back(WeldVertex(vertex, welded, uniqueVertices));
+            s_sink += welded.size();
+            return true;
+        },
+        { { (double)unindexed.size(), "vertices/s" } });
+}
+
+static void RandomBoxes(uint32_t p_count, float p_extent, std::vector<BBox>& p_boxes)
+{
+    int seed = 7;
+    p_boxes.clear();
+    p_boxes.reserve(p_count);
+    for (uint32_t i = 0; i < p_count; i++)
+    {
+        nm::float3 center = nm::float3(frand(&seed), frand(&seed), frand(&seed)) * (2.0f * p_extent) - nm::float3(p_extent);
+        nm::float3 halfSize = nm::float3(frand(&seed), frand(&seed), frand(&seed)) + nm::float3(0.1f);
+        p_boxes.push_back(BBox(BBox::Type::Custom, BBox::Origin::Center, center - halfSize, center + halfSize));
+    }
+}
+
+static bool BenchBBox(uint32_t p_iterations)
+{
+    const uint32_t boxCount = 100000;
+    std::vector<BBox> boxes;
+    RandomBoxes(boxCount, 100.0f, boxes);
+
+    nm::float4x4 transform = nm::translation(nm::float3(1.0f, 2.0f, 3.0f)) * nm::rotation_y(0.7f) * nm::rotation_x(0.3f);
+
+    RETURN_FALSE_IF_FALSE(Measure("BBox transform", p_iterations,
+        [&]()
+        {
+            float sum = 0.0f;
+            for (auto& box : boxes)
+                sum += (box * transform).bbMax[0];
+            s_sink += (uint64_t)sum;
+            return true;
+        },
+        { { (double)boxCount, "boxes/s" } }));
+
+    return Measure("BBox merge", p_iterations,
+        [&]()
+        {
+            BBox merged = boxes[0];
+            for (const auto& box : boxes)
+                merged.Merge(box);
+            s_sink += (uint64_t)merged.bbMax[0];
+            return true;
+        },
+        { { (double)boxCount, "boxes/s" } });
+}
+
+static bool BenchSphere(uint32_t p_iterations)
+{
+    const int stacks = 256;
+    const int sectors = 512;
+    return Measure("GenerateSphere", p_iterations,
+        [&]()
+        {
+            RawSphere sphere;
+            GenerateSphere(stacks, sectors, sphere);
+            s_sink += sphere.indices.size();
+            return true;
+        },
+        { { (double)((stacks + 1) * (sectors + 1)), "vertices/s" } });
+}
+
+static bool BenchVisibility(uint32_t p_iterations)
+{
+    const uint32_t boxCount = 100000;
+    std::vector<BBox> boxes;
+    RandomBoxes(boxCount, 100.0f, boxes);
+
+    nm::float4x4 view = nm::lookAtRH(nm::float3(0.0f, 0.0f, 0.0f), nm::float3(0.0f, 0.0f, -1.0f), nm::float3(0.0f, 1.0f, 0.0f));
+    nm::float4x4 projection = nm::perspective(45.0f * (float)PI / 180.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+    BFrustum frustum(projection * view);
+
+    RETURN_FALSE_IF_FALSE(Measure("BFrustum visibility", p_iterations,
+        [&]()
+        {
+            uint64_t visible = 0;
+            for (const auto& box : boxes)
+                visible += frustum.isVisiable(box) ? 1 : 0;
+            s_sink += visible;
+            return true;
+        },
+        { { (double)boxCount, "boxes/s" } }));
+
+    BBox region(BBox::Type::Custom, BBox::Origin::Center, nm::float3(-50.0f), nm::float3(50.0f));
+    return Measure("BBox visibility", p_iterations,
+        [&]()
+        {
+            uint64_t visible = 0;
+            for (const auto& box : boxes)
+                visible += region.isVisiable(box) ? 1 : 0;
+            s_sink += visible;
+            return true;
+        },
+        { { (double)boxCount, "boxes/s" } });
+}
+
+static bool WriteResults(const std::string& p_path, size_t p_peakRSS)
+{
+    std::ofstream file(p_path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "AssetBenchmark Error: Failed to open " << p_path << std::endl;
+        return false;
+    }
+
+    file.precision(4);
+    file << std::fixed;
+    file << "{\n\"peakRSSBytes\":" << p_peakRSS << ",\n\"results\":[";
+    for (size_t i = 0; i < s_results.size(); i++)
+    {
+        const BenchResult& result = s_results[i];
+        file << (i == 0 ? "\n" : ",\n");
+        file << "{\"name\":\"" << result.name << "\",\"medianMs\":" << result.medianMs
+            << ",\"throughput\":" << result.throughput << ",\"unit\":\"" << result.unit << "\"}";
+    }
+    file << "\n]\n}\n";
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = 5;
+    std::string outputPath;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--default-path") == 0)
+            g_DefaultPath = argv[i + 1];
+        else if (strcmp(argv[i], "--iterations") == 0)
+            iterations = (uint32_t)(std::max)(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--out") == 0)
+            outputPath = argv[i + 1];
+        else if (strcmp(argv[i], "--file-backend") == 0 && strcmp(argv[i + 1], "stream") == 0)
+            SetFileBackend(fb_stream);
+        else if (strcmp(argv[i], "--file-backend") == 0 && strcmp(argv[i + 1], "mapped") == 0)
+            SetFileBackend(fb_mapped);
+        else if (strcmp(argv[i], "--file-backend") == 0 && strcmp(argv[i + 1], "uring") == 0)
+            SetFileBackend(fb_uring);
+        else if (strcmp(argv[i], "--gltf-parser") == 0 && strcmp(argv[i + 1], "tinygltf") == 0)
+            SetGltfParser(gp_tinygltf);
+        else if (strcmp(argv[i], "--gltf-parser") == 0 && strcmp(argv[i + 1], "streaming") == 0)
+            SetGltfParser(gp_streaming);
+        else
+        {
+            std::cerr << "Usage: VFrameAssetBench [--default-path <path>] [--iterations <n>] [--out <path>] [--file-backend stream|mapped|uring]"
+                " [--gltf-parser tinygltf|streaming]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool success = true;
+    success &= BenchModels(g_DefaultPath / "3D", iterations);
+    success &= BenchGltfParsers(g_DefaultPath / "3D", iterations);
+    success &= BenchImages(g_DefaultPath / "Textures", iterations);
+    success &= BenchFileRead(g_DefaultPath / "Textures", iterations);
+    success &= BenchCompression(g_DefaultPath / "Textures", iterations);
+    success &= BenchIngest(g_DefaultPath / "3D", iterations);
+    success &= BenchWelding(iterations);
+    success &= BenchBBox(iterations);
+    success &= BenchSphere(iterations);
+    success &= BenchVisibility(iterations);
+
+    size_t peakRSS = GetPeakRSS();
+    std::cout << "Peak RSS: " << (double)peakRSS / (1024.0 * 1024.0) << " MB" << std::endl;
+
+    if (!outputPath.empty())
+        success &= WriteResults(outputPath, peakRSS);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,326 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+CBenchmark::CBenchmark()
+	: m_settings{}
+	, m_run(0)
+	, m_frame(0)
+	, m_nextMove(0)
+	, m_pipelineCreationMs(0.0f)
+	, m_timeToFirstFrameMs(0.0f)
+	, m_timeToFullSceneMs(0.0f)
+{
+}
+
+CBenchmark::~CBenchmark()
+{
+}
+
+bool CBenchmark::Create(const Settings& p_settings)
+{
+	m_settings = p_settings;
+
+	if (m_settings.renderers.empty() || m_settings.frames == 0 || m_settings.timeStep <= 0.0f)
+	{
+		std::cerr << "CBenchmark::Create Error: At least one renderer, one frame and a positive time step are required" << std::endl;
+		return false;
+	}
+
+	if (!m_settings.scriptPath.empty())
+		RETURN_FALSE_IF_FALSE(LoadScript(m_settings.scriptPath));
+
+	// entities are created with the scene, so their transforms are only captured on the first ApplyFrame
+	m_frameTimes.reserve(m_settings.frames);
+	m_lastFrameEnd = Clock::now();
+
+	std::clog << "CBenchmark::Create - " << m_settings.renderers.size() << " runs of " << m_settings.warmupFrames << " + " << m_settings.frames << " frames, "
+		<< m_cameraKeys.size() << " camera keys, " << m_moves.size() << " entity moves" << std::endl;
+
+	return true;
+}
+
+bool CBenchmark::LoadScript(const std::string& p_path)
+{
+	std::ifstream file(p_path);
+	if (!file.is_open())
+	{
+		std::cerr << "CBenchmark::LoadScript Error: Failed to open " << p_path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.resize(comment);
+
+		std::istringstream stream(line);
+		std::string command;
+		if (!(stream >> command))
+			continue;
+
+		bool valid = false;
+		if (command == "camera")
+		{
+			CameraKey key{};
+			float x, y, z;
+			valid = (bool)(stream >> key.time >> x >> y >> z >> key.yaw >> key.pitch);
+			key.position = nm::float3(x, y, z);
+			if (valid)
+				m_cameraKeys.push_back(key);
+		}
+		else if (command == "move")
+		{
+			EntityMove move{};
+			float x, y, z, rx, ry, rz;
+			valid = (bool)(stream >> move.time >> move.entity >> x >> y >> z >> rx >> ry >> rz);
+			move.position = nm::float3(x, y, z);
+			move.rotation = nm::float3(rx, ry, rz);
+			if (valid)
+				m_moves.push_back(move);
+		}
+
+		if (!valid)
+		{
+			std::cerr << "CBenchmark::LoadScript Error: " << p_path << ":" << lineNumber << " - " << line << std::endl;
+			return false;
+		}
+	}
+
+	std::stable_sort(m_cameraKeys.begin(), m_cameraKeys.end(), [](const CameraKey& a, const CameraKey& b) { return a.time < b.time; });
+	std::stable_sort(m_moves.begin(), m_moves.end(), [](const EntityMove& a, const EntityMove& b) { return a.time < b.time; });
+
+	return true;
+}
+
+CEntity* CBenchmark::FindEntity(const std::string& p_name) const
+{
+	CSceneGraph::EntityList* entities = CSceneGraph::GetEntities();
+	for (CEntity* entity : *entities)
+	{
+		if (p_name == entity->GetName())
+			return entity;
+	}
+	return nullptr;
+}
+
+void CBenchmark::ApplyFrame(CVulkanRHI* p_rhi, CPerspectiveCamera* p_camera)
+{
+	if (m_run == 0 && m_frame == 0)
+	{
+		for (const auto& move : m_moves)
+		{
+			CEntity* entity = FindEntity(move.entity);
+			if (!entity)
+			{
+				std::cerr << "CBenchmark::ApplyFrame Error: No entity named " << move.entity << ", move ignored" << std::endl;
+				continue;
+			}
+
+			bool captured = false;
+			for (const auto& initial : m_initialTransforms)
+				captured |= (initial.entity == entity);
+			if (!captured)
+				m_initialTransforms.push_back(InitialTransform{ entity, entity->GetTransform() });
+		}
+	}
+
+	// the script starts with the measured frames, the warm up renders its first frame
+	float time = (m_frame < m_settings.warmupFrames) ? 0.0f : (float)(m_frame - m_settings.warmupFrames) * m_settings.timeStep;
+
+	if (!m_cameraKeys.empty())
+	{
+		size_t next = 0;
+		while (next < m_cameraKeys.size() && m_cameraKeys[next].time <= time)
+			++next;
+
+		if (next == 0 || next == m_cameraKeys.size())
+		{
+			const CameraKey& key = m_cameraKeys[next == 0 ? 0 : next - 1];
+			p_camera->SetPose(key.position, key.yaw, key.pitch);
+		}
+		else
+		{
+			const CameraKey& a = m_cameraKeys[next - 1];
+			const CameraKey& b = m_cameraKeys[next];
+			float t = (time - a.time) / (b.time - a.time);
+			p_camera->SetPose(
+				a.position + (b.position - a.position) * t,
+				a.yaw + (b.yaw - a.yaw) * t,
+				a.pitch + (b.pitch - a.pitch) * t);
+		}
+	}
+
+	while (m_nextMove < m_moves.size() && m_moves[m_nextMove].time <= time)
+	{
+		const EntityMove& move = m_moves[m_nextMove++];
+		CEntity* entity = FindEntity(move.entity);
+		if (!entity)
+			continue;
+
+		const float toRadians = (float)M_PI / 180.0f;
+		nm::Transform transform = entity->GetTransform();
+		transform.SetTranslate(nm::translation(move.position));
+		transform.SetRotation(
+			nm::rotation_z(move.rotation.z() * toRadians) *
+			nm::rotation_y(move.rotation.y() * toRadians) *
+			nm::rotation_x(move.rotation.x() * toRadians));
+		entity->SetTransform(p_rhi, transform);
+	}
+}
+
+bool CBenchmark::EndFrame(CVulkanRHI* p_rhi, CFramePacer* p_framePacer, CGpuProfiler* p_gpuProfiler, const CRenderTargets* p_renderTargets)
+{
+	Clock::time_point frameEnd = Clock::now();
+	if (m_frame >= m_settings.warmupFrames)
+		m_frameTimes.push_back(std::chrono::duration<float, std::milli>(frameEnd - m_lastFrameEnd).count());
+
+	++m_frame;
+
+	if (m_frame == m_settings.warmupFrames)
+	{
+		// the warm up frames still in flight must not end up in the timings of the run
+		RETURN_FALSE_IF_FALSE(p_framePacer->WaitForAllFrames(p_rhi));
+		p_gpuProfiler->CollectAll(p_rhi);
+		p_gpuProfiler->ResetSummary();
+	}
+	else if (m_frame == m_settings.warmupFrames + m_settings.frames)
+	{
+		RETURN_FALSE_IF_FALSE(p_framePacer->WaitForAllFrames(p_rhi));
+		p_gpuProfiler->CollectAll(p_rhi);
+		StoreRun(p_rhi, p_gpuProfiler, p_renderTargets);
+		p_gpuProfiler->ResetSummary();
+
+		++m_run;
+		m_frame = 0;
+		m_frameTimes.clear();
+		ResetScene(p_rhi);
+
+		if (IsDone())
+			RETURN_FALSE_IF_FALSE(WriteResults());
+	}
+
+	// waiting on the GPU above is not part of the next frame
+	m_lastFrameEnd = Clock::now();
+
+	return true;
+}
+
+void CBenchmark::SetStartupTimes(float p_pipelineCreationMs, float p_timeToFirstFrameMs)
+{
+	m_pipelineCreationMs = p_pipelineCreationMs;
+	m_timeToFirstFrameMs = p_timeToFirstFrameMs;
+}
+
+void CBenchmark::StoreRun(CVulkanRHI* p_rhi, CGpuProfiler* p_gpuProfiler, const CRenderTargets* p_renderTargets)
+{
+	RunResult result{};
+	result.renderer = GetRendererType();
+	result.cpuFrameMs = ComputePercentiles(m_frameTimes);
+	p_gpuProfiler->GetSummary(result.passes, result.gpuFrame);
+	p_rhi->GetDeviceMemoryStats(result.deviceMemory, result.peakDeviceMemory, result.deviceAllocations);
+	result.renderTargetMemoryRequired = p_renderTargets->GetRequiredMemory();
+	result.renderTargetMemoryAllocated = p_renderTargets->GetAllocatedMemory();
+
+	std::clog << "CBenchmark::StoreRun - " << (result.renderer == CVulkanRHI::RendererType::Forward ? "Forward" : "Deferred")
+		<< ": CPU frame p50 " << result.cpuFrameMs.p50 << " ms, p99 " << result.cpuFrameMs.p99 << " ms, GPU frame avg " << result.gpuFrame.avgMs << " ms" << std::endl;
+
+	m_results.push_back(result);
+}
+
+void CBenchmark::ResetScene(CVulkanRHI* p_rhi)
+{
+	m_nextMove = 0;
+	for (const auto& initial : m_initialTransforms)
+		initial.entity->SetTransform(p_rhi, initial.transform);
+}
+
+CBenchmark::Percentiles CBenchmark::ComputePercentiles(std::vector<float> p_values)
+{
+	Percentiles percentiles{};
+	if (p_values.empty())
+		return percentiles;
+
+	std::sort(p_values.begin(), p_values.end());
+
+	// nearest rank
+	auto at = [&p_values](float p_percentile) -> float
+		{
+			size_t rank = (size_t)std::ceil(p_percentile / 100.0f * (float)p_values.size());
+			return p_values[(std::min)((std::max)(rank, (size_t)1), p_values.size()) - 1];
+		};
+
+	double sum = 0.0;
+	for (float value : p_values)
+		sum += value;
+
+	percentiles.avg = (float)(sum / (double)p_values.size());
+	percentiles.p50 = at(50.0f);
+	percentiles.p90 = at(90.0f);
+	percentiles.p95 = at(95.0f);
+	percentiles.p99 = at(99.0f);
+	percentiles.max = p_values.back();
+
+	return percentiles;
+}
+
+bool CBenchmark::WriteResults() const
+{
+	std::ofstream file(m_settings.outputPath, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "CBenchmark::WriteResults Error: Failed to open " << m_settings.outputPath << std::endl;
+		return false;
+	}
+
+	auto writePass = [&file](const CGpuProfiler::PassSummary& p_pass)
+		{
+			file << "{\"name\":\"" << p_pass.name << "\",\"frames\":" << p_pass.frames
+				<< ",\"minMs\":" << p_pass.minMs << ",\"avgMs\":" << p_pass.avgMs << ",\"maxMs\":" << p_pass.maxMs << "}";
+		};
+
+	file.precision(4);
+	file << std::fixed;
+	file << "{\n\"script\":\"" << std::filesystem::path(m_settings.scriptPath).generic_string() << "\",\n\"warmupFrames\":" << m_settings.warmupFrames << ",\n\"frames\":" << m_settings.frames
+		<< ",\n\"timeStep\":" << m_settings.timeStep
+		<< ",\n\"startup\":{\"pipelineCreationMs\":" << m_pipelineCreationMs << ",\"timeToFirstFrameMs\":" << m_timeToFirstFrameMs << ",\"timeToFullSceneMs\":" << m_timeToFullSceneMs << "}"
+		<< ",\n\"runs\":[";
+
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		const RunResult& run = m_results[i];
+		const Percentiles& cpu = run.cpuFrameMs;
+
+		file << (i == 0 ? "\n" : ",\n");
+		file << "{\"renderer\":\"" << (run.renderer == CVulkanRHI::RendererType::Forward ? "Forward" : "Deferred") << "\""
+			<< ",\n \"cpuFrameMs\":{\"avg\":" << cpu.avg << ",\"p50\":" << cpu.p50 << ",\"p90\":" << cpu.p90
+			<< ",\"p95\":" << cpu.p95 << ",\"p99\":" << cpu.p99 << ",\"max\":" << cpu.max << "}";
+
+		file << ",\n \"gpuFrame\":";
+		writePass(run.gpuFrame);
+		file << ",\n \"gpuPasses\":[";
+		for (size_t j = 0; j < run.passes.size(); j++)
+		{
+			file << (j == 0 ? "\n  " : ",\n  ");
+			writePass(run.passes[j]);
+		}
+
+		file << "],\n \"memory\":{\"deviceBytes\":" << run.deviceMemory << ",\"peakDeviceBytes\":" << run.peakDeviceMemory
+			<< ",\"deviceAllocations\":" << run.deviceAllocations << ",\"renderTargetRequiredBytes\":" << run.renderTargetMemoryRequired
+			<< ",\"renderTargetAllocatedBytes\":" << run.renderTargetMemoryAllocated << "}}";
+	}
+	file << "\n]\n}\n";
+
+	std::clog << "CBenchmark::WriteResults - " << m_settings.outputPath << std::endl;
+
+	return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "core/VulkanRHI.h"
+#include "core/Camera.h"
+#include "core/SceneGraph.h"
+#include "core/Asset.h"
+#include "FramePacer.h"
+#include "GpuProfiler.h"
+
+#include "core/Global.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Drives a headless benchmark run. The script replays camera keyframes, interpolated linearly, and moves
+// entities to fixed transforms at given times. Time advances by the fixed step of the headless loop only,
+// so every run renders the same frames. Every renderer to compare gets a run of its own over the same
+// script: warm up frames first, then the measured frames. The results of all runs go to one JSON file
+//
+// Script, one entry per line, '#' starts a comment:
+//	camera <time> <x> <y> <z> <yaw> <pitch>							angles in radians, as the camera keeps them
+//	move <time> <entity name> <x> <y> <z> <rx> <ry> <rz>			angles in degrees, entity names without spaces
+class CBenchmark
+{
+public:
+	struct Settings
+	{
+		std::string						scriptPath;			// empty for a static camera
+		std::string						outputPath;
+		uint32_t						warmupFrames;
+		uint32_t						frames;
+		float							timeStep;
+		std::vector<CVulkanRHI::RendererType> renderers;
+	};
+
+	CBenchmark();
+	~CBenchmark();
+
+	bool Create(const Settings& p_settings);
+
+	CVulkanRHI::RendererType GetRendererType() const	{ return m_settings.renderers[m_run]; }
+	bool IsDone() const									{ return m_run == (uint32_t)m_settings.renderers.size(); }
+
+	// Poses the camera and moves the entities for the current frame, before the scene graph updates
+	void ApplyFrame(CVulkanRHI* p_rhi, CPerspectiveCamera* p_camera);
+
+	// After the frame is submitted. At the end of the warm up and of every run it waits for all frames to
+	// finish on the GPU, so the timings can be collected; the results are written once the last run is done
+	bool EndFrame(CVulkanRHI* p_rhi, CFramePacer* p_framePacer, CGpuProfiler* p_gpuProfiler, const CRenderTargets* p_renderTargets);
+
+	// Startup costs of the renderer, reported along with the runs
+	void SetStartupTimes(float p_pipelineCreationMs, float p_timeToFirstFrameMs);
+	// The scene streams in after the first frame, the runs start once it has
+	void SetTimeToFullScene(float p_timeToFullSceneMs) { m_timeToFullSceneMs = p_timeToFullSceneMs; }
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	struct CameraKey
+	{
+		float							time;
+		nm::float3						position;
+		float							yaw;
+		float							pitch;
+	};
+
+	struct EntityMove
+	{
+		float							time;
+		std::string						entity;
+		nm::float3						position;
+		nm::float3						rotation;			// degrees around x, y and z
+	};
+
+	struct Percentiles
+	{
+		float							avg;
+		float							p50;
+		float							p90;
+		float							p95;
+		float							p99;
+		float							max;
+	};
+
+	struct RunResult
+	{
+		CVulkanRHI::RendererType		renderer;
+		Percentiles						cpuFrameMs;
+		CGpuProfiler::PassSummary		gpuFrame;
+		std::vector<CGpuProfiler::PassSummary> passes;
+		VkDeviceSize					deviceMemory;
+		VkDeviceSize					peakDeviceMemory;
+		uint32_t						deviceAllocations;
+		VkDeviceSize					renderTargetMemoryRequired;
+		VkDeviceSize					renderTargetMemoryAllocated;
+	};
+
+	struct InitialTransform
+	{
+		CEntity*						entity;
+		nm::Transform					transform;
+	};
+
+	Settings							m_settings;
+	std::vector<CameraKey>				m_cameraKeys;
+	std::vector<EntityMove>				m_moves;
+	std::vector<InitialTransform>		m_initialTransforms;	// of every moved entity, restored for every run
+
+	uint32_t							m_run;
+	uint32_t							m_frame;				// in the current run, warm up frames included
+	uint32_t							m_nextMove;				// moves are sorted by time
+	Clock::time_point					m_lastFrameEnd;
+	std::vector<float>					m_frameTimes;			// ms, measured frames only
+	std::vector<RunResult>				m_results;
+	float								m_pipelineCreationMs;
+	float								m_timeToFirstFrameMs;
+	float								m_timeToFullSceneMs;
+
+	bool LoadScript(const std::string& p_path);
+	CEntity* FindEntity(const std::string& p_name) const;
+	void StoreRun(CVulkanRHI* p_rhi, CGpuProfiler* p_gpuProfiler, const CRenderTargets* p_renderTargets);
+	void ResetScene(CVulkanRHI* p_rhi);
+	static Percentiles ComputePercentiles(std::vector<float> p_values);
+	bool WriteResults() const;
+};
@@ -0,0 +1,151 @@
+#include "FramePacer.h"
+
+// Stats are averaged over this many frames before they are shown
+#define STATS_FRAMES		60
+
+CFramePacer::CFramePacer()
+	: CUIParticipant(CUIParticipant::ParticipationType::pt_everyFrame, CUIParticipant::UIDPanelType::uipt_same)
+	, m_vkTimeline(VK_NULL_HANDLE)
+	, m_renderCompleteCount(0)
+	, m_framesInFlight(DEFAULT_FRAMES_IN_FLIGHT)
+	, m_requestedFramesInFlight(DEFAULT_FRAMES_IN_FLIGHT)
+	, m_frameIndex(0)
+	, m_submittedFrames(0)
+	, m_accumulated{}
+	, m_accumulatedFrames(0)
+	, m_stats{}
+{
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		m_vkAcquireSemaphore[i] = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < MAX_SWAPCHAIN_IMAGES; i++)
+		m_vkRenderCompleteSemaphore[i] = VK_NULL_HANDLE;
+}
+
+CFramePacer::~CFramePacer()
+{
+}
+
+bool CFramePacer::Create(CVulkanRHI* p_rhi, uint32_t p_framesInFlight)
+{
+	if (p_framesInFlight < 1 || p_framesInFlight > MAX_FRAMES_IN_FLIGHT)
+	{
+		std::cerr << "CFramePacer::Create Error: " << p_framesInFlight << " frames in flight requested, supporting 1 to " << MAX_FRAMES_IN_FLIGHT << std::endl;
+		return false;
+	}
+
+	m_framesInFlight			= p_framesInFlight;
+	m_requestedFramesInFlight	= (int32_t)p_framesInFlight;
+
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateTimelineSemaphore(m_vkTimeline, 0, "Frame Timeline Semaphore"));
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateSemaphor(m_vkAcquireSemaphore[i], "Acquire Swap Chain Semaphore " + std::to_string(i)));
+
+	// present is not tracked by the timeline, so render complete semaphores are kept per swapchain image.
+	// An image is only handed out by the acquire again after its previous present consumed the semaphore
+	m_renderCompleteCount = p_rhi->GetSwapchainImageCount();
+	for (uint32_t i = 0; i < m_renderCompleteCount; i++)
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateSemaphor(m_vkRenderCompleteSemaphore[i], "Gfx Queue Submit Complete Semaphore " + std::to_string(i)));
+
+	m_lastFrameStart = Clock::now();
+
+	std::clog << "CFramePacer::Create - " << m_framesInFlight << " frames in flight, " << m_renderCompleteCount << " swapchain images" << std::endl;
+
+	return true;
+}
+
+void CFramePacer::Destroy(CVulkanRHI* p_rhi)
+{
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		p_rhi->DestroySemaphore(m_vkAcquireSemaphore[i]);
+	for (uint32_t i = 0; i < m_renderCompleteCount; i++)
+		p_rhi->DestroySemaphore(m_vkRenderCompleteSemaphore[i]);
+	p_rhi->DestroySemaphore(m_vkTimeline);
+}
+
+bool CFramePacer::BeginFrame(CVulkanRHI* p_rhi)
+{
+	Clock::time_point frameStart = Clock::now();
+
+	// Frame slots are assigned round robin on the frame count, so changing the count
+	// is only safe once nothing is in flight anymore
+	if ((uint32_t)m_requestedFramesInFlight != m_framesInFlight)
+	{
+		RETURN_FALSE_IF_FALSE(WaitForAllFrames(p_rhi));
+		m_framesInFlight = (uint32_t)m_requestedFramesInFlight;
+		std::clog << "CFramePacer::BeginFrame - " << m_framesInFlight << " frames in flight" << std::endl;
+	}
+
+	// frame n - framesInFlight used this slot last and signals n - framesInFlight + 1
+	if (m_submittedFrames >= m_framesInFlight)
+		RETURN_FALSE_IF_FALSE(p_rhi->WaitTimelineSemaphore(m_vkTimeline, m_submittedFrames - m_framesInFlight + 1));
+
+	Clock::time_point waitEnd = Clock::now();
+
+	// whatever is still queued now executes on the GPU while this frame is recorded on the CPU
+	uint64_t completed		= p_rhi->GetTimelineSemaphoreValue(m_vkTimeline);
+	uint64_t queued			= m_submittedFrames - completed;
+
+	m_frameIndex = (uint32_t)(m_submittedFrames % m_framesInFlight);
+
+	if (m_submittedFrames > 0)
+	{
+		m_accumulated.cpuFrameMs		+= std::chrono::duration<float, std::milli>(frameStart - m_lastFrameStart).count();
+		m_accumulated.cpuWaitMs			+= std::chrono::duration<float, std::milli>(waitEnd - frameStart).count();
+		m_accumulated.gpuFramesQueued	+= (float)queued;
+		m_accumulated.overlap			+= (queued > 0) ? 1.0f : 0.0f;
+
+		if (++m_accumulatedFrames == STATS_FRAMES)
+		{
+			float inv = 1.0f / (float)STATS_FRAMES;
+			m_stats.cpuFrameMs			= m_accumulated.cpuFrameMs * inv;
+			m_stats.cpuWaitMs			= m_accumulated.cpuWaitMs * inv;
+			m_stats.gpuFramesQueued		= m_accumulated.gpuFramesQueued * inv;
+			m_stats.overlap				= m_accumulated.overlap * inv;
+
+			m_accumulated				= Stats{};
+			m_accumulatedFrames			= 0;
+		}
+	}
+	m_lastFrameStart = frameStart;
+
+	return true;
+}
+
+bool CFramePacer::SubmitFrame(CVulkanRHI* p_rhi, CVulkanRHI::CommandBufferList* p_cmdBfrs, uint32_t p_swapchainIndex)
+{
+	CVulkanRHI::PipelineStageFlagsList psfList{ VkPipelineStageFlags {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT} };
+	CVulkanRHI::SemaphoreList signalList{ m_vkRenderCompleteSemaphore[p_swapchainIndex], m_vkTimeline };
+	CVulkanRHI::SemaphoreValueList signalValues{ 0 /* binary, ignored */, m_submittedFrames + 1 };
+	CVulkanRHI::SemaphoreList waitList{ m_vkAcquireSemaphore[m_frameIndex] };
+	bool waitForFinish = false;
+	bool waitForFence = false;
+	RETURN_FALSE_IF_FALSE(p_rhi->SubmitCommandBuffers(
+		p_cmdBfrs, &psfList, waitForFinish, nullptr,
+		waitForFence, &signalList, &waitList, CVulkanRHI::QueueType::qt_Primary, &signalValues));
+
+	++m_submittedFrames;
+
+	return true;
+}
+
+bool CFramePacer::WaitForAllFrames(CVulkanRHI* p_rhi)
+{
+	if (m_submittedFrames == 0)
+		return true;
+
+	return p_rhi->WaitTimelineSemaphore(m_vkTimeline, m_submittedFrames);
+}
+
+void CFramePacer::Show(CVulkanRHI* p_rhi)
+{
+	if (Header("Frame Pacing"))
+	{
+		SliderInt("Frames In Flight", &m_requestedFramesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+
+		Text("CPU Frame: %.2f ms", m_stats.cpuFrameMs);
+		Text("CPU Wait On GPU: %.2f ms", m_stats.cpuWaitMs);
+		Text("GPU Frames Queued: %.2f", m_stats.gpuFramesQueued);
+		Text("CPU/GPU Overlap: %.0f %%", m_stats.overlap * 100.0f);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "core/VulkanRHI.h"
+#include "core/UI.h"
+#include "core/Global.h"
+
+#include <chrono>
+
+// Paces the CPU against the GPU with a single timeline semaphore. Frame n signals the timeline with n + 1
+// when its submission finishes, so before frame n reuses the resource slot n % framesInFlight it only
+// has to wait for the value of the frame that used the slot last. The number of frames in flight can be
+// changed at runtime, up to MAX_FRAMES_IN_FLIGHT, trading latency for CPU/GPU overlap
+class CFramePacer : public CUIParticipant
+{
+public:
+	CFramePacer();
+	~CFramePacer();
+
+	bool Create(CVulkanRHI* p_rhi, uint32_t p_framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+	void Destroy(CVulkanRHI* p_rhi);
+
+	// Blocks until the frame that last used this frame's resource slot has finished on the GPU.
+	// A change of the frames in flight count is applied here, after all frames have finished
+	bool BeginFrame(CVulkanRHI* p_rhi);
+
+	// Submission waits on the swapchain acquire of this frame, signals the render complete
+	// semaphore of the swapchain image for presenting and the timeline for pacing
+	bool SubmitFrame(CVulkanRHI* p_rhi, CVulkanRHI::CommandBufferList* p_cmdBfrs, uint32_t p_swapchainIndex);
+
+	// Blocks until the last submitted frame, and with it every frame before it, has finished on the GPU
+	bool WaitForAllFrames(CVulkanRHI* p_rhi);
+
+	uint32_t GetFrameIndex() const									{ return m_frameIndex; }
+	uint32_t GetFramesInFlight() const								{ return m_framesInFlight; }
+	VkSemaphore GetAcquireSemaphore() const							{ return m_vkAcquireSemaphore[m_frameIndex]; }
+	VkSemaphore GetRenderCompleteSemaphore(uint32_t p_scIdx) const	{ return m_vkRenderCompleteSemaphore[p_scIdx]; }
+
+	virtual void Show(CVulkanRHI* p_rhi) override;
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	struct Stats
+	{
+		float							cpuFrameMs;				// wall time between the start of two frames
+		float							cpuWaitMs;				// time blocked on the GPU in BeginFrame
+		float							gpuFramesQueued;		// frames still executing on the GPU when a frame starts
+		float							overlap;				// share of frames whose CPU work ran while the GPU was busy
+	};
+
+	VkSemaphore							m_vkTimeline;
+	VkSemaphore							m_vkAcquireSemaphore[MAX_FRAMES_IN_FLIGHT];
+	VkSemaphore							m_vkRenderCompleteSemaphore[MAX_SWAPCHAIN_IMAGES];
+	uint32_t							m_renderCompleteCount;
+
+	uint32_t							m_framesInFlight;
+	int32_t								m_requestedFramesInFlight;
+	uint32_t							m_frameIndex;
+	uint64_t							m_submittedFrames;		// also the timeline value of the last submitted frame
+
+	Clock::time_point					m_lastFrameStart;
+	Stats								m_accumulated;
+	uint32_t							m_accumulatedFrames;
+	Stats								m_stats;				// averaged over the last STATS_FRAMES frames
+};
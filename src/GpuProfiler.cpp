@@ -0,0 +1,244 @@
+#include "GpuProfiler.h"
+
+// Rolling window the min/avg/max are taken over
+#define STATS_WINDOW		120
+
+CGpuProfiler::CGpuProfiler()
+	: CUIParticipant(CUIParticipant::ParticipationType::pt_everyFrame, CUIParticipant::UIDPanelType::uipt_same)
+	, m_timestampPeriod(0.0f)
+	, m_results{}
+	, m_frameStats{}
+	, m_captureFrames(60)
+	, m_captureRemaining(0)
+	, m_captureStartNs(0)
+	, m_captureEndNs(0)
+	, m_tracePath("trace.json")
+{
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		m_frames[i].pool = VK_NULL_HANDLE;
+		m_frames[i].passCount = 0;
+		m_frames[i].submitNs = 0;
+	}
+}
+
+CGpuProfiler::~CGpuProfiler()
+{
+}
+
+bool CGpuProfiler::Create(CVulkanRHI* p_rhi)
+{
+	m_timestampPeriod = p_rhi->GetTimestampPeriod();
+	if (!IsEnabled())
+	{
+		std::clog << "CGpuProfiler::Create - GPU timestamps not supported, profiler disabled" << std::endl;
+		return true;
+	}
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateTimestampQueryPool(m_frames[i].pool, MAX_PROFILED_PASSES * 2, "GPU Profiler Query Pool " + std::to_string(i)));
+
+	return true;
+}
+
+void CGpuProfiler::Destroy(CVulkanRHI* p_rhi)
+{
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (m_frames[i].pool != VK_NULL_HANDLE)
+			p_rhi->DestroyQueryPool(m_frames[i].pool);
+		m_frames[i].pool = VK_NULL_HANDLE;
+	}
+}
+
+void CGpuProfiler::BeginFrame(CVulkanRHI* p_rhi, uint32_t p_frameIndex)
+{
+	if (!IsEnabled())
+		return;
+
+	FrameQueries& frame = m_frames[p_frameIndex];
+	if (frame.passCount == 0)
+		return;
+
+	// the frame pacer waited for this slot, so the results are normally there. If they are not, the frame is
+	// dropped rather than waited for
+	if (p_rhi->GetQueryPoolResults(frame.pool, 0, frame.passCount * 2, m_results))
+		Collect(p_frameIndex);
+
+	p_rhi->ResetQueryPool(frame.pool, 0, frame.passCount * 2);
+	frame.passCount = 0;
+}
+
+void CGpuProfiler::CollectAll(CVulkanRHI* p_rhi)
+{
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		BeginFrame(p_rhi, i);
+}
+
+void CGpuProfiler::ResetSummary()
+{
+	for (auto& pass : m_passStats)
+		pass.second.totalFrames = 0;
+	m_frameStats.totalFrames = 0;
+}
+
+void CGpuProfiler::GetSummary(std::vector<PassSummary>& p_passes, PassSummary& p_frame) const
+{
+	auto summarize = [](const std::string& p_name, const PassStats& p_stats) -> PassSummary
+		{
+			PassSummary summary{ p_name, 0.0f, 0.0f, 0.0f, p_stats.totalFrames };
+			if (p_stats.totalFrames > 0)
+			{
+				summary.minMs = p_stats.totalMinMs;
+				summary.avgMs = (float)(p_stats.totalMs / p_stats.totalFrames);
+				summary.maxMs = p_stats.totalMaxMs;
+			}
+			return summary;
+		};
+
+	p_passes.clear();
+	for (const auto& pass : m_passStats)
+	{
+		if (pass.second.totalFrames > 0)
+			p_passes.push_back(summarize(pass.first, pass.second));
+	}
+	p_frame = summarize("GPU Frame", m_frameStats);
+}
+
+void CGpuProfiler::EndFrame(uint32_t p_frameIndex)
+{
+	m_frames[p_frameIndex].submitNs = CCpuProfiler::Now();
+}
+
+void CGpuProfiler::SetPass(uint32_t p_frameIndex, uint32_t p_passIdx, const char* p_name)
+{
+	if (!IsEnabled() || p_passIdx >= MAX_PROFILED_PASSES)
+		return;
+
+	FrameQueries& frame = m_frames[p_frameIndex];
+	frame.passNames[p_passIdx] = p_name;
+	frame.passCount = (std::max)(frame.passCount, p_passIdx + 1);
+}
+
+void CGpuProfiler::WriteBeginPass(CVulkanRHI* p_rhi, VkCommandBuffer p_cmdBfr, uint32_t p_frameIndex, uint32_t p_passIdx) const
+{
+	if (!IsEnabled() || p_passIdx >= MAX_PROFILED_PASSES)
+		return;
+
+	p_rhi->WriteTimestamp(p_cmdBfr, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_frames[p_frameIndex].pool, p_passIdx * 2);
+}
+
+void CGpuProfiler::WriteEndPass(CVulkanRHI* p_rhi, VkCommandBuffer p_cmdBfr, uint32_t p_frameIndex, uint32_t p_passIdx) const
+{
+	if (!IsEnabled() || p_passIdx >= MAX_PROFILED_PASSES)
+		return;
+
+	p_rhi->WriteTimestamp(p_cmdBfr, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[p_frameIndex].pool, p_passIdx * 2 + 1);
+}
+
+void CGpuProfiler::Collect(uint32_t p_frameIndex)
+{
+	const FrameQueries& frame = m_frames[p_frameIndex];
+
+	uint64_t frameBegin = m_results[0];
+	uint64_t frameEnd = m_results[1];
+	for (uint32_t i = 0; i < frame.passCount; i++)
+		frameBegin = (std::min)(frameBegin, m_results[i * 2]);
+
+	bool capture = (m_captureRemaining > 0 && frame.submitNs >= m_captureStartNs);
+	double frameStartUs = (double)(frame.submitNs - m_captureStartNs) * 1e-3;
+
+	m_passOrder.clear();
+	for (uint32_t i = 0; i < frame.passCount; i++)
+	{
+		uint64_t begin = m_results[i * 2];
+		uint64_t end = m_results[i * 2 + 1];
+		frameEnd = (std::max)(frameEnd, end);
+
+		float ms = (end > begin) ? ToMs(end - begin) : 0.0f;
+		AddSample(m_passStats[frame.passNames[i]], ms);
+		m_passOrder.push_back(frame.passNames[i]);
+
+		if (capture)
+			m_trace.AddEvent(frame.passNames[i], "gpu", CTraceWriter::pid_GPU, 0, frameStartUs + (double)ToMs(begin - frameBegin) * 1000.0, (double)ms * 1000.0);
+	}
+
+	AddSample(m_frameStats, (frameEnd > frameBegin) ? ToMs(frameEnd - frameBegin) : 0.0f);
+
+	if (capture)
+	{
+		m_captureEndNs = frame.submitNs;
+		if (--m_captureRemaining == 0)
+			WriteTrace(m_captureStartNs, m_captureEndNs);
+	}
+}
+
+void CGpuProfiler::WriteTrace(int64_t p_fromNs, int64_t p_toNs)
+{
+	m_trace.SetTrackName(CTraceWriter::pid_GPU, "GPU");
+	CCpuProfiler::Export(m_trace, p_fromNs, p_toNs);
+	m_trace.Write(m_tracePath);
+	m_trace.Clear();
+}
+
+void CGpuProfiler::AddSample(PassStats& p_stats, float p_ms)
+{
+	p_stats.samples.push_back(p_ms);
+	if (p_stats.samples.size() > STATS_WINDOW)
+		p_stats.samples.pop_front();
+
+	p_stats.minMs = p_stats.samples.front();
+	p_stats.maxMs = p_stats.samples.front();
+	float sum = 0.0f;
+	for (float sample : p_stats.samples)
+	{
+		p_stats.minMs = (std::min)(p_stats.minMs, sample);
+		p_stats.maxMs = (std::max)(p_stats.maxMs, sample);
+		sum += sample;
+	}
+	p_stats.avgMs = sum / (float)p_stats.samples.size();
+
+	if (p_stats.totalFrames == 0)
+	{
+		p_stats.totalMs = 0.0;
+		p_stats.totalMinMs = p_ms;
+		p_stats.totalMaxMs = p_ms;
+	}
+	p_stats.totalMs += p_ms;
+	p_stats.totalMinMs = (std::min)(p_stats.totalMinMs, p_ms);
+	p_stats.totalMaxMs = (std::max)(p_stats.totalMaxMs, p_ms);
+	p_stats.totalFrames++;
+}
+
+void CGpuProfiler::Show(CVulkanRHI* p_rhi)
+{
+	if (Header("GPU Profiler"))
+	{
+		if (!IsEnabled())
+			Text("GPU timestamps not supported");
+
+		Text("%-22s %7s %7s %7s", "Pass (ms)", "min", "avg", "max");
+		for (const std::string& name : m_passOrder)
+		{
+			const PassStats& stats = m_passStats[name];
+			Text("%-22s %7.3f %7.3f %7.3f", name.c_str(), stats.minMs, stats.avgMs, stats.maxMs);
+		}
+		Text("%-22s %7.3f %7.3f %7.3f", "GPU Frame", m_frameStats.minMs, m_frameStats.avgMs, m_frameStats.maxMs);
+
+		SliderInt("Capture Frames", &m_captureFrames, 1, 600);
+		if (m_captureRemaining > 0)
+		{
+			Text("Capturing, %d frames left", m_captureRemaining);
+		}
+		else if (IsEnabled() && Button("Capture Trace"))
+		{
+			m_captureRemaining = m_captureFrames;
+			m_captureStartNs = CCpuProfiler::Now();
+		}
+
+		// everything the CPU zone rings still hold, which covers loading the scene on startup
+		if (m_captureRemaining == 0 && Button("Export CPU Zones Since Start"))
+			WriteTrace(CCpuProfiler::GetStartNs(), CCpuProfiler::Now());
+		Text("Trace: %s", m_tracePath.c_str());
+	}
+}
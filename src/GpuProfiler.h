@@ -0,0 +1,104 @@
+#pragma once
+
+#include "core/VulkanRHI.h"
+#include "core/UI.h"
+#include "core/Global.h"
+#include "core/Profiler.h"
+
+#include <deque>
+#include <map>
+
+// Passes beyond this count in a frame are not timed
+#define MAX_PROFILED_PASSES		32
+
+// Times every pass of the render graph on the GPU with a timestamp written at the start and the end of its
+// command buffer. Every frame slot has a query pool of its own, which is read back and reset once the
+// frame pacer has waited for the slot, so the results arrive frames in flight late but never stall the CPU.
+// The per pass times are kept over a rolling window, and a number of frames can be captured to a Chrome trace
+// together with the CPU zones of the same time span. GPU frames are placed at the CPU time they were submitted
+// at, as the GPU cannot start on them any earlier; the times within a frame are exact
+class CGpuProfiler : public CUIParticipant
+{
+public:
+	// Over every frame collected since the last ResetSummary, unlike the rolling window of the UI
+	struct PassSummary
+	{
+		std::string					name;
+		float						minMs;
+		float						avgMs;
+		float						maxMs;
+		uint32_t					frames;
+	};
+
+	CGpuProfiler();
+	~CGpuProfiler();
+
+	bool Create(CVulkanRHI* p_rhi);
+	void Destroy(CVulkanRHI* p_rhi);
+
+	// Call after CFramePacer::BeginFrame; collects the results of the frame that used the slot last
+	void BeginFrame(CVulkanRHI* p_rhi, uint32_t p_frameIndex);
+
+	// Marks the CPU time the frame was submitted at, call after submitting
+	void EndFrame(uint32_t p_frameIndex);
+
+	// Names the pass timed with p_passIdx this frame, before any of it is recorded
+	void SetPass(uint32_t p_frameIndex, uint32_t p_passIdx, const char* p_name);
+
+	// Safe to call from the recording threads, every pass writes its own queries
+	void WriteBeginPass(CVulkanRHI* p_rhi, VkCommandBuffer p_cmdBfr, uint32_t p_frameIndex, uint32_t p_passIdx) const;
+	void WriteEndPass(CVulkanRHI* p_rhi, VkCommandBuffer p_cmdBfr, uint32_t p_frameIndex, uint32_t p_passIdx) const;
+
+	// Collects every slot still holding results; only valid once all frames have finished on the GPU
+	void CollectAll(CVulkanRHI* p_rhi);
+
+	void ResetSummary();
+	void GetSummary(std::vector<PassSummary>& p_passes, PassSummary& p_frame) const;
+
+	bool IsEnabled() const { return m_timestampPeriod > 0.0f; }
+
+	virtual void Show(CVulkanRHI* p_rhi) override;
+
+private:
+	struct FrameQueries
+	{
+		VkQueryPool					pool;
+		uint32_t					passCount;				// passes written this frame, 0 once collected
+		int64_t						submitNs;
+		std::string					passNames[MAX_PROFILED_PASSES];
+	};
+
+	struct PassStats
+	{
+		std::deque<float>			samples;				// ms, last STATS_WINDOW frames
+		float						minMs;
+		float						avgMs;
+		float						maxMs;
+
+		// since the last ResetSummary
+		double						totalMs;
+		float						totalMinMs;
+		float						totalMaxMs;
+		uint32_t					totalFrames;
+	};
+
+	FrameQueries					m_frames[MAX_FRAMES_IN_FLIGHT];
+	float							m_timestampPeriod;		// ns per tick
+	uint64_t						m_results[MAX_PROFILED_PASSES * 2];
+
+	std::map<std::string, PassStats> m_passStats;
+	std::vector<std::string>		m_passOrder;			// passes of the last collected frame, in execution order
+	PassStats						m_frameStats;			// first pass begin to last pass end
+
+	CTraceWriter					m_trace;
+	int32_t							m_captureFrames;
+	int32_t							m_captureRemaining;
+	int64_t							m_captureStartNs;
+	int64_t							m_captureEndNs;
+	std::string						m_tracePath;
+
+	void Collect(uint32_t p_frameIndex);
+	void WriteTrace(int64_t p_fromNs, int64_t p_toNs);
+	void AddSample(PassStats& p_stats, float p_ms);
+	float ToMs(uint64_t p_ticks) const { return (float)((double)p_ticks * m_timestampPeriod * 1e-6); }
+};
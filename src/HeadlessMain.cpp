@@ -0,0 +1,115 @@
+#include <cstring>
+#include <cstdlib>
+
+#include "core/Global.h"
+#include "RasterRender.h"
+#include "Benchmark.h"
+
+// Entry point of the headless build, see CBenchmark for the script format and SceneDescription for the scene's
+//
+//  VFrameHeadless [--scene <path>] [--script <path>] [--frames <n>] [--warmup <n>] [--width <w>] [--height <h>]
+//                 [--renderer forward|deferred|both] [--out <path>]
+//                 [--engine-path <path>] [--asset-path <path>] [--default-path <path>]
+static void PrintUsage()
+{
+    std::cerr << "Usage: VFrameHeadless [--scene <path>] [--script <path>] [--frames <n>] [--warmup <n>] [--width <w>] [--height <h>] "
+        "[--renderer forward|deferred|both] [--out <path>] [--engine-path <path>] [--asset-path <path>] [--default-path <path>]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    init_console();
+
+    CBenchmark::Settings settings{};
+    settings.outputPath = "benchmark.json";
+    settings.warmupFrames = 60;
+    settings.frames = 600;
+    settings.timeStep = 1.0f / 60.0f;
+    settings.renderers = { CVulkanRHI::RendererType::Forward, CVulkanRHI::RendererType::Deferred };
+
+    std::string scenePath;
+    int width = RENDER_RESOLUTION_X;
+    int height = RENDER_RESOLUTION_Y;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+        ++i;
+
+        if (strcmp(arg, "--scene") == 0)
+            scenePath = value;
+        else if (strcmp(arg, "--script") == 0)
+            settings.scriptPath = value;
+        else if (strcmp(arg, "--frames") == 0)
+            settings.frames = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--warmup") == 0)
+            settings.warmupFrames = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--width") == 0)
+            width = atoi(value);
+        else if (strcmp(arg, "--height") == 0)
+            height = atoi(value);
+        else if (strcmp(arg, "--out") == 0)
+            settings.outputPath = value;
+        else if (strcmp(arg, "--engine-path") == 0)
+            g_EnginePath = value;
+        else if (strcmp(arg, "--asset-path") == 0)
+            g_AssetPath = value;
+        else if (strcmp(arg, "--default-path") == 0)
+            g_DefaultPath = value;
+        else if (strcmp(arg, "--renderer") == 0)
+        {
+            if (strcmp(value, "forward") == 0)
+                settings.renderers = { CVulkanRHI::RendererType::Forward };
+            else if (strcmp(value, "deferred") == 0)
+                settings.renderers = { CVulkanRHI::RendererType::Deferred };
+            else if (strcmp(value, "both") == 0)
+                settings.renderers = { CVulkanRHI::RendererType::Forward, CVulkanRHI::RendererType::Deferred };
+            else
+            {
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (width <= 0 || height <= 0)
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    CLOG("Default Path - " << g_DefaultPath << std::endl);
+    CLOG("Engine Path - " << g_EnginePath << std::endl);
+    CLOG("Asset Path - " << g_AssetPath << std::endl);
+
+    CBenchmark benchmark;
+    if (!benchmark.Create(settings))
+        return EXIT_FAILURE;
+
+    bool exitState = true;
+    {
+        CRasterRender rasterRender("VFrame Headless", width, height, 1);
+        rasterRender.SetBenchmark(&benchmark);
+        if (!scenePath.empty())
+            rasterRender.SetScenePath(scenePath);
+        rasterRender.SetFixedDelta(settings.timeStep);
+
+        if (!rasterRender.initialize())
+            return EXIT_FAILURE;
+
+        exitState = rasterRender.run();
+    }
+
+    return (exitState && benchmark.IsDone()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,6 +1,20 @@
 #include "LightingPass.h"
 #include "core/Global.h"
 
+// The ENABLE_ flags the lighting shaders are specialized for this frame. Shadow and IBL are set by the
+// passes updated before the lighting ones; without a shadow its RT and PCF flags build no permutations of their own
+static uint32_t GetLightingFeatures(const CFixedBuffers::PrimaryUniformData* p_uniformData)
+{
+	uint32_t features = p_uniformData->enable_Shadow_RT_PCF;
+	if ((features & ENABLE_SHADOW) == 0)
+		features = 0;
+
+	if (p_uniformData->enableIBL)
+		features |= ENABLE_IBL;
+
+	return features;
+}
+
 CForwardPass::CForwardPass(CVulkanRHI* p_rhi)
 	:CDynamicRenderingPass(p_rhi)
 {}
@@ -99,50 +113,58 @@ bool CForwardPass::CreatePipeline(CVulkanRHI::Pipeline p_pipeline)
 	return true;
 }
 
-bool CForwardPass::Update(UpdateData*)
+bool CForwardPass::Update(UpdateData* p_updateData)
 {
-	return true;
+	PROFILE_FUNCTION();
+
+	// permutations are only built for the renderer in use
+	if (m_rhi->GetRendererType() != CVulkanRHI::RendererType::Forward)
+		return true;
+
+	return SelectPermutation(GetLightingFeatures(p_updateData->uniformData));
 }
 
 bool CForwardPass::Render(RenderData* p_renderData)
 {
-	uint32_t scId											= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx										= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr						= p_renderData->cmdBfr;
 	const CScene* scene										= p_renderData->loadedAssets->GetScene();
 	const CPrimaryDescriptors* primaryDesc					= p_renderData->primaryDescriptors;
 
-	//RETURN_FALSE_IF_FALSE(m_rhi->BeginCommandBuffer(cmdBfr, "Forward"));
+	m_renderQueue.Build(scene, m_passIndex, CRenderQueue::sm_Opaque, p_renderData->sceneGraph->GetPrimaryCamera());
+
+	// Secondary command buffers do not inherit state from the primary, so every one of them binds it again
+	auto bindState = [&](CVulkanRHI::CommandBuffer p_cmdBfr)
+	{
+		m_rhi->SetViewport(p_cmdBfr, 0.0f, 1.0f, (float)m_rhi->GetRenderWidth(), -(float)m_rhi->GetRenderHeight());
+		m_rhi->SetScissors(p_cmdBfr, 0, 0, m_rhi->GetRenderWidth(), m_rhi->GetRenderHeight());
+
+		vkCmdBindPipeline(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
+
+		vkCmdBindDescriptorSets(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
+		vkCmdBindDescriptorSets(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, frameIdx), 0, nullptr);
+	};
+
+	bool useSecondaries = m_renderQueue.UseSecondaries(p_renderData);
+	m_renderingInfo.flags = useSecondaries ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+
 	{
 		vkCmdBeginRendering(cmdBfr, &m_renderingInfo);
+		if (useSecondaries)
+		{
+			VkCommandBufferInheritanceRenderingInfo renderingInheritance = GetInheritanceRenderingInfo();
+			VkCommandBufferInheritanceInfo inheritance{};
+			inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritance.pNext = &renderingInheritance;
+
+			RETURN_FALSE_IF_FALSE(m_renderQueue.DrawSecondaries(m_rhi, p_renderData, inheritance, bindState, m_pipeline.pipeLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT));
+		}
+		else
 		{
-			m_rhi->SetViewport(cmdBfr, 0.0f, 1.0f, (float)m_rhi->GetRenderWidth(), -(float)m_rhi->GetRenderHeight());
-			m_rhi->SetScissors(cmdBfr, 0, 0, m_rhi->GetRenderWidth(), m_rhi->GetRenderHeight());
-
-			vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
-
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, scId), 0, nullptr);
-
-			// Bind Index and Vertices buffers
-			VkDeviceSize offsets[1] = { 0 };
-			for (unsigned int i = 0; i < scene->GetRenderableMeshCount(); i++)
-			{
-				const CRenderableMesh* mesh = scene->GetRenderableMesh(i);
-
-				std::vector<VkBuffer> vtxBuffers{ mesh->GetVertexBuffer().descInfo.buffer };
-				vkCmdBindVertexBuffers(cmdBfr, 0, (uint32_t)vtxBuffers.size(), vtxBuffers.data(), offsets);
-				vkCmdBindIndexBuffer(cmdBfr, mesh->GetIndexBuffer().descInfo.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-				for (uint32_t j = 0; j < mesh->GetSubmeshCount(); j++)
-				{
-					const SubMesh* submesh = mesh->GetSubmesh(j);
-					VkPipelineStageFlags pipelineStage = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-					CScene::MeshPushConst pc{ mesh->GetMeshId(), submesh->materialId };
-
-					vkCmdPushConstants(cmdBfr, m_pipeline.pipeLayout, pipelineStage, 0, sizeof(CScene::MeshPushConst), (void*)&pc);
-					vkCmdDrawIndexed(cmdBfr, submesh->indexCount, 1, submesh->firstIndex, 0, 1);
-				}
-			}
+			bindState(cmdBfr);
+			m_renderQueue.Draw(cmdBfr, m_pipeline.pipeLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
 		}
 		vkCmdEndRendering(cmdBfr);
 	}
@@ -217,7 +239,9 @@ bool CSkyboxPass::Update(UpdateData*)
 
 bool CSkyboxPass::Render(RenderData* p_renderData)
 {
-	uint32_t scId											= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx										= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr						= p_renderData->cmdBfr;
 	const CScene* scene										= p_renderData->loadedAssets->GetScene();
 	const CPrimaryDescriptors* primaryDesc					= p_renderData->primaryDescriptors;
@@ -234,8 +258,8 @@ bool CSkyboxPass::Render(RenderData* p_renderData)
 
 		vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
 
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, frameIdx), 0, nullptr);
 
 		VkDeviceSize offsets[1] = { 0 };
 		const CRenderable* mesh = scene->GetSkyBoxMesh();
@@ -361,51 +385,60 @@ bool CDeferredPass::CreatePipeline(CVulkanRHI::Pipeline p_pipeline)
 
 bool CDeferredPass::Update(UpdateData* p_updateData)
 {
+	PROFILE_FUNCTION();
+
 	p_updateData->uniformData->enableIBL = m_enableIBL;
 	p_updateData->uniformData->pbrAmbientFactor = m_ambientFactor;
 	return true;
 }
 
+void CDeferredPass::ApplySettings(const CFixedBuffers::PrimaryUniformData* p_uniformData)
+{
+	m_enableIBL = (p_uniformData->enableIBL != 0);
+	m_ambientFactor = p_uniformData->pbrAmbientFactor;
+}
+
 bool CDeferredPass::Render(RenderData* p_renderData)
 {
-	uint32_t scId												= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx											= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr							= p_renderData->cmdBfr;
 	CScene* scene											= p_renderData->loadedAssets->GetScene();
 	const CPrimaryDescriptors* primaryDesc						= p_renderData->primaryDescriptors;
 
-	{
-		vkCmdBeginRendering(cmdBfr, &m_renderingInfo);
-		{
-			m_rhi->SetViewport(cmdBfr, 0.0f, 1.0f, (float)m_rhi->GetRenderWidth(), -(float)m_rhi->GetRenderHeight());
-			m_rhi->SetScissors(cmdBfr, 0, 0, m_rhi->GetRenderWidth(), m_rhi->GetRenderHeight());
-
-			vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
-
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, scId), 0, nullptr);
+	m_renderQueue.Build(scene, m_passIndex, CRenderQueue::sm_Opaque, p_renderData->sceneGraph->GetPrimaryCamera());
 
-			// Bind Index and Vertices buffers
-			VkDeviceSize offsets[1] = { 0 };
-			for (unsigned int i = 0; i < scene->GetRenderableMeshCount(); i++)
-			{
-				const CRenderableMesh* mesh = scene->GetRenderableMesh(i);
+	// Secondary command buffers do not inherit state from the primary, so every one of them binds it again
+	auto bindState = [&](CVulkanRHI::CommandBuffer p_cmdBfr)
+	{
+		m_rhi->SetViewport(p_cmdBfr, 0.0f, 1.0f, (float)m_rhi->GetRenderWidth(), -(float)m_rhi->GetRenderHeight());
+		m_rhi->SetScissors(p_cmdBfr, 0, 0, m_rhi->GetRenderWidth(), m_rhi->GetRenderHeight());
 
-				std::vector<VkBuffer> vtxBuffers{ mesh->GetVertexBuffer().descInfo.buffer };
-				vkCmdBindVertexBuffers(cmdBfr, 0, (uint32_t)vtxBuffers.size(), vtxBuffers.data(), offsets);
-				vkCmdBindIndexBuffer(cmdBfr, mesh->GetIndexBuffer().descInfo.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdBindPipeline(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
 
-				for (uint32_t j = 0; j < mesh->GetSubmeshCount(); j++)
-				{
-					const SubMesh* submesh = mesh->GetSubmesh(j);
+		vkCmdBindDescriptorSets(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
+		vkCmdBindDescriptorSets(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, frameIdx), 0, nullptr);
+	};
 
-					CScene::MeshPushConst pc{ mesh->GetMeshId(), submesh->materialId };
+	bool useSecondaries = m_renderQueue.UseSecondaries(p_renderData);
+	m_renderingInfo.flags = useSecondaries ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
 
-					VkPipelineStageFlags vertex_frag = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-					vkCmdPushConstants(cmdBfr, m_pipeline.pipeLayout, vertex_frag, 0, sizeof(CScene::MeshPushConst), (void*)&pc);
+	{
+		vkCmdBeginRendering(cmdBfr, &m_renderingInfo);
+		if (useSecondaries)
+		{
+			VkCommandBufferInheritanceRenderingInfo renderingInheritance = GetInheritanceRenderingInfo();
+			VkCommandBufferInheritanceInfo inheritance{};
+			inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritance.pNext = &renderingInheritance;
 
-					vkCmdDrawIndexed(cmdBfr, submesh->indexCount, 1, submesh->firstIndex, 0, 1);
-				}
-			}
+			RETURN_FALSE_IF_FALSE(m_renderQueue.DrawSecondaries(m_rhi, p_renderData, inheritance, bindState, m_pipeline.pipeLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT));
+		}
+		else
+		{
+			bindState(cmdBfr);
+			m_renderQueue.Draw(cmdBfr, m_pipeline.pipeLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
 		}
 		vkCmdEndRendering(cmdBfr);
 	}
@@ -422,6 +455,7 @@ void CDeferredPass::Show(CVulkanRHI* p_rhi)
 	{
 		ImGui::Checkbox("IBL", &m_enableIBL);
 		ImGui::SliderFloat("Ambient Factor", &m_ambientFactor, 0.00f, 1.0f);
+		m_renderQueue.ShowStats();
 		ImGui::TreePop();
 	}
 }
@@ -451,14 +485,22 @@ bool CDeferredLightingPass::CreatePipeline(CVulkanRHI::Pipeline p_pipeline)
 	return true;
 }
 
-bool CDeferredLightingPass::Update(UpdateData*)
+bool CDeferredLightingPass::Update(UpdateData* p_updateData)
 {
-	return true;
+	PROFILE_FUNCTION();
+
+	// permutations are only built for the renderer in use
+	if (m_rhi->GetRendererType() != CVulkanRHI::RendererType::Deferred)
+		return true;
+
+	return SelectPermutation(GetLightingFeatures(p_updateData->uniformData));
 }
 
 bool CDeferredLightingPass::Dispatch(RenderData* p_renderData)
 {
-	uint32_t scId												= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx											= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr							= p_renderData->cmdBfr;
 	const CPrimaryDescriptors* primaryDesc						= p_renderData->primaryDescriptors;
 	const CScene* scene											= p_renderData->loadedAssets->GetScene();
@@ -474,11 +516,11 @@ bool CDeferredLightingPass::Dispatch(RenderData* p_renderData)
 
 		vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
 
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, frameIdx), 0, nullptr);
 		
 		if(m_rhi->IsRayTracingEnabled())
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Scene_RayTracing, 1, scene->GetDescriptorSet(1, scId), 0, nullptr);
+			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Scene_RayTracing, 1, scene->GetDescriptorSet(1, frameIdx), 0, nullptr);
 
 		vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
 	}
@@ -547,7 +589,9 @@ bool CSkyboxDeferredPass::Update(UpdateData*)
 
 bool CSkyboxDeferredPass::Render(RenderData* p_renderData)
 {
-	uint32_t scId											= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx										= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr						= p_renderData->cmdBfr;
 	CScene* scene										= p_renderData->loadedAssets->GetScene();
 	const CPrimaryDescriptors* primaryDesc					= p_renderData->primaryDescriptors;
@@ -564,8 +608,8 @@ bool CSkyboxDeferredPass::Render(RenderData* p_renderData)
 
 		vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
 
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, frameIdx), 0, nullptr);
 
 		VkDeviceSize offsets[1] = { 0 };
 		const CRenderable* mesh = scene->GetSkyBoxMesh();
@@ -688,6 +732,8 @@ bool CStaticShadowPrepass::CreatePipeline(CVulkanCore::Pipeline p_Pipeline)
 
 bool CStaticShadowPrepass::Update(UpdateData* p_updateData)
 {
+	PROFILE_FUNCTION();
+
 	uint32_t enable_Shadow_RT_PCF = 0;
 	enable_Shadow_RT_PCF |= (m_isEnabled * ENABLE_SHADOW);
 	enable_Shadow_RT_PCF |= (m_enableRayTracedShadow * ENABLE_RT_SHADOW);
@@ -700,51 +746,53 @@ bool CStaticShadowPrepass::Update(UpdateData* p_updateData)
 	return true;
 }
 
+void CStaticShadowPrepass::ApplySettings(const CFixedBuffers::PrimaryUniformData* p_uniformData)
+{
+	// ray traced shadows are only restored where the device traces rays
+	m_isEnabled = (p_uniformData->enable_Shadow_RT_PCF & ENABLE_SHADOW) != 0;
+	m_enableRayTracedShadow = (p_uniformData->enable_Shadow_RT_PCF & ENABLE_RT_SHADOW) != 0 && m_rhi->IsRayTracingEnabled();
+	m_enablePCF = (p_uniformData->enable_Shadow_RT_PCF & ENABLE_PCF) != 0;
+}
+
 bool CStaticShadowPrepass::Render(RenderData* p_renderData)
 {
-	uint32_t scId = p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx = p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr = p_renderData->cmdBfr;
 	CVulkanRHI::Renderpass renderPass = m_pipeline.renderpassData;
 	const CScene* scene = p_renderData->loadedAssets->GetScene();
 	const CPrimaryDescriptors* primaryDesc = p_renderData->primaryDescriptors;
 
-	{
-		m_rhi->BeginRenderpass(m_frameBuffer[0], renderPass, p_renderData->cmdBfr);
+	// depth only, so draws are grouped by sub-mesh to merge as many instances as possible
+	m_renderQueue.Build(scene, m_passIndex, CRenderQueue::sm_DepthOnly);
 
-		uint32_t fbWidth = renderPass.framebufferWidth;
-		uint32_t fbHeight = renderPass.framebufferHeight;
-		m_rhi->SetViewport(p_renderData->cmdBfr, 0.0f, 1.0f, (float)fbWidth, (float)fbHeight);
-		m_rhi->SetScissors(p_renderData->cmdBfr, 0, 0, fbWidth, fbHeight);
+	uint32_t fbWidth = renderPass.framebufferWidth;
+	uint32_t fbHeight = renderPass.framebufferHeight;
+	auto bindState = [&](CVulkanRHI::CommandBuffer p_cmdBfr)
+	{
+		m_rhi->SetViewport(p_cmdBfr, 0.0f, 1.0f, (float)fbWidth, (float)fbHeight);
+		m_rhi->SetScissors(p_cmdBfr, 0, 0, fbWidth, fbHeight);
 
-		vkCmdBindPipeline(p_renderData->cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
-		vkCmdBindDescriptorSets(p_renderData->cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
-		vkCmdBindDescriptorSets(p_renderData->cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, scId), 0, nullptr);
+		vkCmdBindPipeline(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
+		vkCmdBindDescriptorSets(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
+		vkCmdBindDescriptorSets(p_cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, frameIdx), 0, nullptr);
+	};
 
-		// Bind Index and Vertices buffers
-		VkDeviceSize offsets[1] = { 0 };
-		for (unsigned int i = 0; i < scene->GetRenderableMeshCount(); i++)
+	bool useSecondaries = m_renderQueue.UseSecondaries(p_renderData);
+	{
+		m_rhi->BeginRenderpass(m_frameBuffer[0], renderPass, cmdBfr, useSecondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+		if (useSecondaries)
 		{
-			const CRenderableMesh* mesh = scene->GetRenderableMesh(i);
-			const CVulkanRHI::Buffer vertex = mesh->GetVertexBuffer();
-			const CVulkanRHI::Buffer index = mesh->GetIndexBuffer();
-
-			vkCmdBindVertexBuffers(p_renderData->cmdBfr, 0, 1, &vertex.descInfo.buffer, offsets);
-			vkCmdBindIndexBuffer(p_renderData->cmdBfr, index.descInfo.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-			for (uint32_t j = 0; j < mesh->GetSubmeshCount(); j++)
-			{
-				const SubMesh* submesh = mesh->GetSubmesh(j);
-				VkPipelineStageFlags vertex_frag = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-				CScene::MeshPushConst pc{ mesh->GetMeshId(), submesh->materialId };
-
-				vkCmdPushConstants(p_renderData->cmdBfr, m_pipeline.pipeLayout, vertex_frag, 0, sizeof(CScene::MeshPushConst), (void*)&pc);
-
-				//uint32_t count = (uint32_t)mesh.indexBuffer.descInfo.range / sizeof(uint32_t);
-				vkCmdDrawIndexed(p_renderData->cmdBfr, submesh->indexCount, 1, submesh->firstIndex, 0, 1);
-			}
+			VkCommandBufferInheritanceInfo inheritance = GetInheritanceInfo(0);
+			RETURN_FALSE_IF_FALSE(m_renderQueue.DrawSecondaries(m_rhi, p_renderData, inheritance, bindState, m_pipeline.pipeLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT));
 		}
-
-		m_rhi->EndRenderPass(p_renderData->cmdBfr);
+		else
+		{
+			bindState(cmdBfr);
+			m_renderQueue.Draw(cmdBfr, m_pipeline.pipeLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+		}
+		m_rhi->EndRenderPass(cmdBfr);
 	}
 
 	return true;
@@ -766,6 +814,7 @@ void CStaticShadowPrepass::Show(CVulkanRHI* p_rhi)
 		if(!m_enableRayTracedShadow)
 			ImGui::Checkbox("Rasterized PCF", &m_enablePCF);
 
+		m_renderQueue.ShowStats();
 		ImGui::TreePop();
 	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Pass.h"
+#include "RenderQueue.h"
 
 class CForwardPass : public CDynamicRenderingPass
 {
@@ -16,7 +17,7 @@ public:
 
 	virtual void GetVertexBindingInUse(CVulkanCore::VertexBinding&)override;
 private:
-
+	CRenderQueue m_renderQueue;
 };
 
 class CSkyboxPass : public CStaticRenderPass
@@ -60,6 +61,7 @@ public:
 
 	virtual bool Update(UpdateData*) override;
 	virtual bool Render(RenderData*) override;
+	virtual void ApplySettings(const CFixedBuffers::PrimaryUniformData*) override;
 	virtual void Show(CVulkanRHI* p_rhi) override;
 
 	virtual void GetVertexBindingInUse(CVulkanCore::VertexBinding&)override;
@@ -67,6 +69,7 @@ public:
 private:
 	bool m_enableIBL;
 	float m_ambientFactor;
+	CRenderQueue m_renderQueue;
 };
 
 class CDeferredLightingPass : public CComputePass
@@ -94,6 +97,7 @@ public:
 
 	virtual bool Update(UpdateData*) override;
 	virtual bool Render(RenderData*) override;
+	virtual void ApplySettings(const CFixedBuffers::PrimaryUniformData*) override;
 
 	virtual void Show(CVulkanRHI* p_rhi) override;
 
@@ -106,4 +110,5 @@ private:
 	bool m_enableRayTracedShadow;
 	bool m_enablePCF;
 	bool m_bReuseShadowMap;
+	CRenderQueue m_renderQueue;
 };
\ No newline at end of file
@@ -10,4 +10,69 @@ CPass::CPass(CVulkanRHI* p_rhi)
 }
 
 CPass::~CPass()
-{}
\ No newline at end of file
+{}
+
+void CPass::Destroy()
+{
+	for (auto& permutation : m_permutations)
+	{
+		if (permutation.first != m_pipeline.features && permutation.second.pipeline != VK_NULL_HANDLE)
+			m_rhi->DestroyPipelinePermutation(permutation.second);
+	}
+	m_permutations.clear();
+
+	m_rhi->DestroyPipeline(m_pipeline);
+}
+
+bool CPass::ReloadPipeline(const std::vector<std::filesystem::path>& p_sources)
+{
+	if (m_permutations.empty())
+		return m_rhi->ReloadPipeline(m_pipeline, p_sources);
+
+	bool reloaded = false;
+	for (auto permutation = m_permutations.begin(); permutation != m_permutations.end();)
+	{
+		// the permutations that failed to build get another chance with the changed sources
+		if (permutation->second.pipeline == VK_NULL_HANDLE)
+		{
+			permutation = m_permutations.erase(permutation);
+			continue;
+		}
+
+		reloaded |= m_rhi->ReloadPipeline(permutation->second, p_sources);
+		++permutation;
+	}
+
+	m_pipeline = m_permutations[m_pipeline.features];
+	return reloaded;
+}
+
+bool CPass::SelectPermutation(uint32_t p_features)
+{
+	if (m_pipeline.features == p_features)
+		return true;
+
+	PROFILE_FUNCTION();
+
+	m_permutations[m_pipeline.features] = m_pipeline;
+
+	auto found = m_permutations.find(p_features);
+	if (found != m_permutations.end() && found->second.pipeline == VK_NULL_HANDLE)
+		return false;
+
+	if (found == m_permutations.end())
+	{
+		CVulkanRHI::Pipeline permutation;
+		if (!m_rhi->CreatePipelinePermutation(m_pipeline, p_features, permutation))
+		{
+			// remembered as failed, so it is not built again every frame
+			m_permutations[p_features] = CVulkanRHI::Pipeline();
+			std::cerr << "CPass::SelectPermutation Error: Failed to build the permutation for features " << p_features << ", the current one stays in use" << std::endl;
+			return false;
+		}
+		found = m_permutations.emplace(p_features, permutation).first;
+	}
+
+	m_pipeline = found->second;
+	return true;
+}
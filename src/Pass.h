@@ -3,15 +3,20 @@
 
 #include "core/VulkanRHI.h"
 #include "core/Asset.h"
+#include "core/Profiler.h"
 
 extern uint32_t g_passIndex;
 
+class CThreadPool;
+class CSecondaryCommandBuffers;
+
 class CPass
 {
 public:
 	struct RenderData
 	{
-		uint32_t					scIdx;
+		uint32_t					scIdx;					// swapchain image, only for passes rendering to the swapchain
+		uint32_t					frameIdx;				// per frame resources: descriptor sets, uniforms, UI and debug buffers
 		CVulkanRHI::CommandBuffer	cmdBfr;
 		CLoadableAssets*			loadedAssets;
 		CFixedAssets*				fixedAssets;
@@ -19,6 +24,8 @@ public:
 		CVulkanRHI::BufferList*		stagingBuffers;			// used during the initializing phase
 		CSceneGraph*				sceneGraph;
 		CVulkanRHI::RendererType	rendererType;
+		CThreadPool*				threadPool;				// nullptr records every draw inline on the calling thread
+		CSecondaryCommandBuffers*	secondaryCmdBfrs;
 	};
 
 	struct UpdateData
@@ -38,20 +45,29 @@ public:
 	virtual bool CreatePipeline(CVulkanRHI::Pipeline) = 0;
 	
 	virtual bool Update(UpdateData*) = 0;
-	virtual void Destroy() {
-		m_rhi->DestroyPipeline(m_pipeline);
-	}
+	virtual void Destroy();
+
+	// Takes back the settings Update writes to the uniform data, when a scene file restores them
+	virtual void ApplySettings(const CFixedBuffers::PrimaryUniformData*) {}
 
 	void Enable(bool p_enable) { m_isEnabled = p_enable; }
 	bool IsEnabled() { return m_isEnabled; }
 
+	// Hot reload, see CVulkanCore::ReloadPipeline. Only while none of the frames using the pipeline are in flight
+	bool ReloadPipeline(const std::vector<std::filesystem::path>& p_sources);
+
 protected:
 	bool m_isEnabled;
 	CVulkanRHI* m_rhi;
 	CVulkanRHI::Pipeline m_pipeline;
 
+	// Makes m_pipeline the permutation built for p_features, the ENABLE_ flags. A permutation is built the first
+	// time it is selected and kept until Destroy, so frames still in flight may go on using the previous one
+	bool SelectPermutation(uint32_t p_features);
+
 	uint32_t m_passIndex;
 private:
+	std::unordered_map<uint32_t, CVulkanRHI::Pipeline> m_permutations;		// by features, m_pipeline included once there is more than one
 };
 
 class CComputePass : public CPass
@@ -129,6 +145,17 @@ public:
 	CVulkanRHI::Renderpass GetRenderpass() { return m_pipeline.renderpassData; }
 	CVulkanRHI::FrameBuffer& GetFrameBuffer() { return m_frameBuffer; }
 
+	// describes the render pass to secondary command buffers recorded inside it
+	VkCommandBufferInheritanceInfo GetInheritanceInfo(uint32_t p_frameBufferIdx)
+	{
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass				= m_pipeline.renderpassData.renderpass;
+		inheritance.subpass					= 0;
+		inheritance.framebuffer				= m_frameBuffer[p_frameBufferIdx];
+		return inheritance;
+	}
+
 	virtual void GetVertexBindingInUse(CVulkanRHI::VertexBinding&) = 0;
 
 protected:
@@ -157,6 +184,18 @@ public:
 
 	virtual void GetVertexBindingInUse(CVulkanRHI::VertexBinding&) = 0;
 
+	// describes the rendering scope to secondary command buffers recorded inside it
+	VkCommandBufferInheritanceRenderingInfo GetInheritanceRenderingInfo()
+	{
+		VkCommandBufferInheritanceRenderingInfo renderingInheritance{};
+		renderingInheritance.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+		renderingInheritance.colorAttachmentCount		= (uint32_t)m_pipeline.colorAttachFormats.size();
+		renderingInheritance.pColorAttachmentFormats	= m_pipeline.colorAttachFormats.data();
+		renderingInheritance.depthAttachmentFormat		= m_pipeline.depthAttachFormat;
+		renderingInheritance.rasterizationSamples		= VK_SAMPLE_COUNT_1_BIT;
+		return renderingInheritance;
+	}
+
 protected:
 	std::vector<VkRenderingAttachmentInfo> m_colorAttachInfos;
 	VkRenderingAttachmentInfo m_depthAttachInfo;
@@ -8,7 +8,6 @@ CToneMapPass::CToneMapPass(CVulkanRHI* p_rhi)
     , m_toneMapper(ToneMapper::AMD)
     , m_exposure(1.0f)
 {
-    m_frameBuffer.resize(FRAME_BUFFER_COUNT);
 }
 
 CToneMapPass::~CToneMapPass()
@@ -27,13 +26,15 @@ bool CToneMapPass::CreateRenderpass(RenderData* p_renderData)
     renderpass->framebufferWidth = m_rhi->GetRenderWidth();
     renderpass->framebufferHeight = m_rhi->GetRenderHeight();
     std::vector<VkImageView> attachments(1, VkImageView{});
-    attachments[0] = m_rhi->GetSCImageView(0);
-    if (!m_rhi->CreateFramebuffer(renderpass->renderpass, m_frameBuffer[0], attachments.data(), (uint32_t)attachments.size(), renderpass->framebufferWidth, renderpass->framebufferHeight))
-        return false;
 
-    attachments[0] = m_rhi->GetSCImageView(1);
-    if (!m_rhi->CreateFramebuffer(renderpass->renderpass, m_frameBuffer[1], attachments.data(), (uint32_t)attachments.size(), renderpass->framebufferWidth, renderpass->framebufferHeight))
-        return false;
+    // one frame buffer per swapchain image
+    m_frameBuffer.resize(m_rhi->GetSwapchainImageCount());
+    for (uint32_t i = 0; i < (uint32_t)m_frameBuffer.size(); i++)
+    {
+        attachments[0] = m_rhi->GetSCImageView(i);
+        if (!m_rhi->CreateFramebuffer(renderpass->renderpass, m_frameBuffer[i], attachments.data(), (uint32_t)attachments.size(), renderpass->framebufferWidth, renderpass->framebufferHeight))
+            return false;
+    }
 
     return true;
 }
@@ -59,15 +60,30 @@ bool CToneMapPass::CreatePipeline(CVulkanCore::Pipeline p_Pipeline)
 
 bool CToneMapPass::Update(UpdateData* p_updateData)
 {
+    PROFILE_FUNCTION();
+
     p_updateData->uniformData->toneMappingSelection = (float)m_toneMapper;
     p_updateData->uniformData->toneMappingExposure = m_exposure;
 
-    return true;
+    // SSAO and SSR are composited here, their flags are final once the renderer has updated every pass before
+    uint32_t features = 0;
+    features |= (p_updateData->uniformData->enableSSAO != 0) ? ENABLE_SSAO : 0;
+    features |= (p_updateData->uniformData->ssrEnable != 0.0f) ? ENABLE_SSR : 0;
+
+    return SelectPermutation(features);
+}
+
+void CToneMapPass::ApplySettings(const CFixedBuffers::PrimaryUniformData* p_uniformData)
+{
+    m_toneMapper = (ToneMapper)(int)p_uniformData->toneMappingSelection;
+    m_exposure = p_uniformData->toneMappingExposure;
 }
 
 bool CToneMapPass::Render(RenderData* p_renderData)
 {
-    uint32_t scId = p_renderData->scIdx;
+    PROFILE_FUNCTION();
+
+    uint32_t frameIdx = p_renderData->frameIdx;
     CVulkanRHI::CommandBuffer cmdBfr = p_renderData->cmdBfr;
     CVulkanRHI::Renderpass renderPass = m_pipeline.renderpassData;
     const CRenderableUI* ui = p_renderData->loadedAssets->GetUI();
@@ -83,20 +99,17 @@ bool CToneMapPass::Render(RenderData* p_renderData)
         m_rhi->SetScissors(cmdBfr, 0, 0, renderPass.framebufferWidth, renderPass.framebufferHeight);
 
         vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
-        vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+        vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
         vkCmdDraw(cmdBfr, 3, 1, 0, 0);
         m_rhi->EndRenderPass(cmdBfr);
 
-        m_rhi->InsertMarker(cmdBfr, "Resources Copy/Clear");
+        m_rhi->InsertMarker(cmdBfr, "Resources Copy");
 
+        // the render graph orders the copy after the sampling above; SSR writes every pixel of its target,
+        // which is transient and may share its memory with another render target, so it is not cleared here
         CVulkanRHI::Image colorRT = p_renderData->fixedAssets->GetRenderTargets()->GetTexture(CRenderTargets::rt_PrimaryColor);
         CVulkanRHI::Image prevColorlRT = p_renderData->fixedAssets->GetRenderTargets()->GetTexture(CRenderTargets::rt_Prev_PrimaryColor);
         m_rhi->CopyImage(cmdBfr, colorRT, prevColorlRT);
-
-        VkClearValue clear{};
-        clear.color = { 0.0, 0.0, 0.0, 1.0 };
-        CVulkanRHI::Image ssrRT = p_renderData->fixedAssets->GetRenderTargets()->GetTexture(CRenderTargets::rt_SSReflection);
-        m_rhi->ClearImage(cmdBfr, ssrRT, clear);
     }
     //m_rhi->EndCommandBuffer(cmdBfr);
 
@@ -161,6 +174,8 @@ bool CTAAComputePass::CreatePipeline(CVulkanRHI::Pipeline p_Pipeline)
 
 bool CTAAComputePass::Update(UpdateData* p_updateData)
 {
+    PROFILE_FUNCTION();
+
     p_updateData->uniformData->taaResolveWeight         = m_resolveWeight;
     p_updateData->uniformData->taaUseMotionVectors      = m_useMotionVectors;
     p_updateData->uniformData->taaFlickerCorectionMode  = (float)m_flickerCorrectionMode;
@@ -169,9 +184,19 @@ bool CTAAComputePass::Update(UpdateData* p_updateData)
     return true;
 }
 
+void CTAAComputePass::ApplySettings(const CFixedBuffers::PrimaryUniformData* p_uniformData)
+{
+    m_resolveWeight             = p_uniformData->taaResolveWeight;
+    m_useMotionVectors          = (p_uniformData->taaUseMotionVectors != 0.0f);
+    m_flickerCorrectionMode     = (FlickerCorrection)(int)p_uniformData->taaFlickerCorectionMode;
+    m_reprojectionFilter        = (ReprojectionFilter)(int)p_uniformData->taaReprojectionFilter;
+}
+
 bool CTAAComputePass::Dispatch(RenderData* p_renderData)
 {
-    uint32_t scId = p_renderData->scIdx;
+    PROFILE_FUNCTION();
+
+    uint32_t frameIdx = p_renderData->frameIdx;
     CVulkanRHI::CommandBuffer cmdBfr = p_renderData->cmdBfr;
     const CPrimaryDescriptors* primaryDesc = p_renderData->primaryDescriptors;
     uint32_t dispatchDim_x = m_rhi->GetRenderWidth() / THREAD_GROUP_SIZE_X;
@@ -180,7 +205,7 @@ bool CTAAComputePass::Dispatch(RenderData* p_renderData)
     //if (!m_rhi->BeginCommandBuffer(cmdBfr, "Compute TAA"))
     {
         vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
-        vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+        vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
         vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
     }    
     //m_rhi->EndCommandBuffer(cmdBfr);
@@ -21,6 +21,7 @@ public:
 
 	virtual bool Update(UpdateData*) override;
 	virtual bool Render(RenderData*) override;
+	virtual void ApplySettings(const CFixedBuffers::PrimaryUniformData*) override;
 
 	virtual void GetVertexBindingInUse(CVulkanCore::VertexBinding&)override;
 
@@ -88,6 +89,7 @@ public:
 
 	virtual bool Update(UpdateData*) override;
 	virtual bool Dispatch(RenderData*) override;
+	virtual void ApplySettings(const CFixedBuffers::PrimaryUniformData*) override;
 
 	virtual void Show(CVulkanRHI* p_rhi) override;
 
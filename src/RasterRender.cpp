@@ -8,14 +8,20 @@
 //nm::float4 g_sunDirection = nm::float4(0.0f, 1.0f, 0.0f, 0.0f);// -93.83f);
 
 CRasterRender::CRasterRender(const char* name, int screen_width_, int screen_height_, int window_scale)
-	: CWinCore(name, screen_width_, screen_height_, window_scale)
+	: CPlatformCore(name, screen_width_, screen_height_, window_scale)
+	, m_benchmark(nullptr)
+	, m_startTime(std::chrono::steady_clock::now())
+	, m_pipelineCreationMs(0.0f)
+	, m_sceneLoaded(false)
+	, m_nonCriticalPipelineState(ncp_Ready)
+	, m_shaderReloadTimer(0.0f)
 	, m_pickObject(false)
-	, m_activeAcquireSemaphore(VK_NULL_HANDLE)
-	, m_activeCmdBfrFreeFence(VK_NULL_HANDLE)
+	, m_swapchainIndex(0)
+	, m_frameIndex(0)
 	, m_frameCount(0)
 
 {			
-	m_rhi					= new CVulkanRHI(name, RENDER_RESOLUTION_X, RENDER_RESOLUTION_Y);
+	m_rhi					= new CVulkanRHI(name, screen_width_, screen_height_);
 
 	m_primaryCamera			= new CPerspectiveCamera();
 
@@ -25,6 +31,9 @@ CRasterRender::CRasterRender(const char* name, int screen_width_, int screen_hei
 	m_loadableAssets		= new CLoadableAssets(m_sceneGraph);
 	m_primaryDescriptors	= new CPrimaryDescriptors();
 
+	m_threadPool			= new CThreadPool();
+	m_secondaryCmdBfrs		= new CSecondaryCommandBuffers();
+
 	m_staticShadowPass		= new CStaticShadowPrepass(m_rhi);
 	m_skyboxForwardPass		= new CSkyboxPass(m_rhi);
 	m_skyboxDeferredPass	= new CSkyboxDeferredPass(m_rhi);
@@ -41,31 +50,31 @@ CRasterRender::CRasterRender(const char* name, int screen_width_, int screen_hei
 	m_taaComputePass		= new CTAAComputePass(m_rhi);
 	m_copyComputePass		= new CCopyComputePass(m_rhi);
 
-	m_cmdBufferNames[0][cb_TAA]					= "TAA_0";
-	m_cmdBufferNames[0][cb_SSR]					= "SSR_0";
-	m_cmdBufferNames[0][cb_ShadowMap]			= "ShadowMap_0";
-	m_cmdBufferNames[0][cb_SSAO]				= "SSAO_0";
-	m_cmdBufferNames[0][cb_Forward]				= "Forward_0";
-	m_cmdBufferNames[0][cb_Deferred_GBuf]		= "Deferred_GBuf_0";
-	m_cmdBufferNames[0][cb_Deferred_Lighting]	= "Deferred_Lighting_0";
-	m_cmdBufferNames[0][cb_DebugDraw]			= "DebugDraw_0";
-	m_cmdBufferNames[0][cb_UI]					= "UI_0";
-	m_cmdBufferNames[0][cb_PickerCopy2CPU]		= "PickerCopy2CPU_0";
-	m_cmdBufferNames[0][cb_ToneMapping]			= "ToneMapping_0";
-	m_cmdBufferNames[0][cb_Skybox]				= "Skybox_0";
-
-	m_cmdBufferNames[1][cb_TAA]					= "TAA_1";
-	m_cmdBufferNames[1][cb_SSR]					= "SSR_1";
-	m_cmdBufferNames[1][cb_ShadowMap]			= "ShadowMap_1";
-	m_cmdBufferNames[1][cb_SSAO]				= "SSAO_1";
-	m_cmdBufferNames[1][cb_Forward]				= "Forward_1";
-	m_cmdBufferNames[1][cb_Deferred_GBuf]		= "Deferred_GBuf_1";
-	m_cmdBufferNames[1][cb_Deferred_Lighting]	= "Deferred_Lighting_1";
-	m_cmdBufferNames[1][cb_DebugDraw]			= "DebugDraw_1";
-	m_cmdBufferNames[1][cb_UI]					= "UI_1";
-	m_cmdBufferNames[1][cb_PickerCopy2CPU]		= "PickerCopy2CPU_1";
-	m_cmdBufferNames[1][cb_ToneMapping]			= "ToneMapping_1";
-	m_cmdBufferNames[1][cb_Skybox]				= "Skybox_1";
+	m_framePacer			= new CFramePacer();
+	m_renderGraph			= new CRenderGraph();
+	m_gpuProfiler			= new CGpuProfiler();
+
+	const char* cmdBufferNames[CommandBufferId::cb_max]{};
+	cmdBufferNames[cb_TAA]						= "TAA_";
+	cmdBufferNames[cb_SSR]						= "SSR_";
+	cmdBufferNames[cb_ShadowMap]				= "ShadowMap_";
+	cmdBufferNames[cb_SSAO]						= "SSAO_";
+	cmdBufferNames[cb_Forward]					= "Forward_";
+	cmdBufferNames[cb_Deferred_GBuf]			= "Deferred_GBuf_";
+	cmdBufferNames[cb_Deferred_Lighting]		= "Deferred_Lighting_";
+	cmdBufferNames[cb_DebugDraw]				= "DebugDraw_";
+	cmdBufferNames[cb_UI]						= "UI_";
+	cmdBufferNames[cb_PickerCopy2CPU]			= "PickerCopy2CPU_";
+	cmdBufferNames[cb_ToneMapping]				= "ToneMapping_";
+	cmdBufferNames[cb_Skybox]					= "Skybox_";
+	cmdBufferNames[cb_SSAO_Blur]				= "SSAO_Blur_";
+	cmdBufferNames[cb_SSR_Blur]					= "SSR_Blur_";
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		for (int j = 0; j < CommandBufferId::cb_max; j++)
+			m_cmdBufferNames[i][j] = cmdBufferNames[j] + std::to_string(i);
+	}
 }
 
 CRasterRender::~CRasterRender() 
@@ -92,6 +101,12 @@ CRasterRender::~CRasterRender()
 	delete m_skyboxForwardPass;
 	delete m_staticShadowPass;
 
+	delete m_secondaryCmdBfrs;
+	delete m_threadPool;
+	delete m_framePacer;
+	delete m_renderGraph;
+	delete m_gpuProfiler;
+
 	delete m_primaryDescriptors;
 	delete m_loadableAssets;
 	delete m_fixedAssets;
@@ -101,13 +116,29 @@ CRasterRender::~CRasterRender()
 
 void CRasterRender::on_destroy()
 {
+	// nothing may be destroyed while frames are still in flight
+	m_framePacer->WaitForAllFrames(m_rhi);
+
+#if !defined(VFRAME_HEADLESS)
+	// the session is kept for the next start, see SetScenePath
+	if (m_frameCount > 0)
+		SaveScene(g_EnginePath / "cache/session.vscene");
+#endif
+
+	// neither may the pipelines still being created in the background, the jobs left waiting never created theirs
+	m_threadPool->Wait(m_nonCriticalPipelineGroup);
+	bool nonCriticalPipelinesCreated = m_nonCriticalPipelineJobs.empty();
+
 	m_uiPass->Destroy();
 	m_copyComputePass->Destroy();
 	m_taaComputePass->Destroy();
 	m_toneMapPass->Destroy();
-	m_debugDrawPass->Destroy();
-	m_ssrBlurPass->Destroy();
-	m_ssrComputePass->Destroy();
+	if (nonCriticalPipelinesCreated)
+	{
+		m_debugDrawPass->Destroy();
+		m_ssrBlurPass->Destroy();
+		m_ssrComputePass->Destroy();
+	}
 	m_ssaoBlurPass->Destroy();
 	m_ssaoComputePass->Destroy();
 	m_deferredLightPass->Destroy();
@@ -121,19 +152,34 @@ void CRasterRender::on_destroy()
 	m_loadableAssets->Destroy(m_rhi);
 	m_fixedAssets->Destroy(m_rhi);
 
-	DestroySyncPremitives();
+	m_threadPool->Destroy();
+	m_secondaryCmdBfrs->Destroy(m_rhi);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		for (int j = 0; j < CommandBufferId::cb_max; j++)
+			m_rhi->DestroyCommandPool(m_vkRecordCmdPool[i][j]);
+	}
+
+	m_framePacer->Destroy(m_rhi);
+	m_gpuProfiler->Destroy(m_rhi);
 
 	m_rhi->cleanUp();
 }
 
 bool CRasterRender::on_create(HINSTANCE pInstance)
 {
+	PROFILE_THREAD("Main");
+	PROFILE_FUNCTION();
+
 	CVulkanRHI::InitData initData{};
 	initData.winInstance							= pInstance;
-	initData.winHandle								= CWinCore::s_Window.handle;
+	initData.winHandle								= s_Window.handle;
 	initData.queueType								= VK_QUEUE_GRAPHICS_BIT;
 	initData.swapChaineImageUsage					= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 	initData.swapchainImageFormat					= VK_FORMAT_B8G8R8A8_UNORM;
+#if defined(VFRAME_HEADLESS)
+	initData.headless								= true;
+#endif
 
 	RETURN_FALSE_IF_FALSE(m_rhi->initialize(initData));
 
@@ -141,45 +187,52 @@ bool CRasterRender::on_create(HINSTANCE pInstance)
 	// (might be graphics compatible as well)
 	RETURN_FALSE_IF_FALSE(m_rhi->CreateCommandPool(m_rhi->GetQueueFamiliyIndex(), m_vkCmdPool));
 
-	for (int i = 0; i < FRAME_BUFFER_COUNT; i++)
+	// Command pools have to be externally synchronized, so every per pass command buffer gets a pool of its own.
+	// That lets the recording jobs of RenderFrame run on any worker without locking
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		RETURN_FALSE_IF_FALSE(m_rhi->CreateCommandBuffers(m_vkCmdPool, m_vkCmdBfr[i], CommandBufferId::cb_max, m_cmdBufferNames[i]));
+		for (int j = 0; j < CommandBufferId::cb_max; j++)
+		{
+			RETURN_FALSE_IF_FALSE(m_rhi->CreateCommandPool(m_rhi->GetQueueFamiliyIndex(), m_vkRecordCmdPool[i][j]));
+			RETURN_FALSE_IF_FALSE(m_rhi->CreateCommandBuffers(m_vkRecordCmdPool[i][j], &m_vkCmdBfr[i][j], 1, &m_cmdBufferNames[i][j]));
+		}
 	}
 
-	RETURN_FALSE_IF_FALSE(CreateSyncPremitives());
+	RETURN_FALSE_IF_FALSE(m_threadPool->Create());
+	RETURN_FALSE_IF_FALSE(m_secondaryCmdBfrs->Create(m_rhi, m_threadPool->GetThreadCount()));
+
+	RETURN_FALSE_IF_FALSE(m_framePacer->Create(m_rhi));
+	RETURN_FALSE_IF_FALSE(m_gpuProfiler->Create(m_rhi));
+
+	// Transient render targets that are never alive at the same time share memory. As the passes and with them
+	// the lifetimes change with the settings, the sharing is decided on graphs with every pass of both renderers
+	{
+		CRenderGraph forwardGraph;
+		CRenderGraph deferredGraph;
+		BuildRenderGraph(forwardGraph, CVulkanRHI::RendererType::Forward, true);
+		BuildRenderGraph(deferredGraph, CVulkanRHI::RendererType::Deferred, true);
+
+		std::vector<CRenderGraph*> graphs{ &forwardGraph, &deferredGraph };
+		std::vector<uint32_t> memorySlots;
+		CRenderGraph::ComputeAliasing(graphs, memorySlots);
+
+		m_fixedAssets->GetRenderTargets()->SetMemorySlots(memorySlots);
+		m_renderGraph->SetMemorySlots(memorySlots);
+	}
 
 	RETURN_FALSE_IF_FALSE(m_fixedAssets->Create(m_rhi, m_vkCmdPool));
 
-	RETURN_FALSE_IF_FALSE(m_loadableAssets->Create(m_rhi, *m_fixedAssets, m_vkCmdPool));
+	SceneDescription sceneDescription;
+	RETURN_FALSE_IF_FALSE(sceneDescription.Load(m_scenePath.empty() ? g_DefaultPath / "Scenes/default.vscene" : m_scenePath));
+
+	RETURN_FALSE_IF_FALSE(m_loadableAssets->Create(m_rhi, *m_fixedAssets, m_vkCmdPool, sceneDescription));
 
 	RETURN_FALSE_IF_FALSE(m_primaryDescriptors->Create(m_rhi, *m_fixedAssets, *m_loadableAssets));
 
 	RETURN_FALSE_IF_FALSE(CreatePasses());
 
-	{
-		RETURN_FALSE_IF_FALSE(m_rhi->BeginCommandBuffer(m_vkCmdBfr[0][0], "Preparing Render Targets"));
-
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, m_vkCmdBfr[0][0], CRenderTargets::rt_PrimaryDepth);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_Position);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_Normal);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_Albedo);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_SSAO_Blur);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_vkCmdBfr[0][0], CRenderTargets::rt_DirectionalShadowDepth);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_PrimaryColor);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_RoughMetal);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_Motion);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_SSReflection);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_Prev_PrimaryColor);
-		m_fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, m_vkCmdBfr[0][0], CRenderTargets::rt_SSRBlur);
-		
-		RETURN_FALSE_IF_FALSE(m_rhi->EndCommandBuffer(m_vkCmdBfr[0][0]));
-
-		CVulkanRHI::CommandBufferList cbrList{ m_vkCmdBfr[0][0] };
-		CVulkanRHI::PipelineStageFlagsList psfList{ VkPipelineStageFlags {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT} };
-		bool waitForFinish = true;
-		RETURN_FALSE_IF_FALSE(m_rhi->SubmitCommandBuffers(&cbrList, &psfList, waitForFinish, &m_vkFenceCmdBfrFree[0]));
-		RETURN_FALSE_IF_FALSE(m_rhi->ResetFence(m_vkFenceCmdBfrFree[0]));
-	}
+	// the render targets start in an undefined layout, the graph transitions them on their first use
+	m_renderGraph->Create(m_fixedAssets->GetRenderTargets());
 
 	RETURN_FALSE_IF_FALSE(InitCamera());
 
@@ -188,13 +241,31 @@ bool CRasterRender::on_create(HINSTANCE pInstance)
 	m_ssrComputePass->Enable(false);
 	m_taaComputePass->Enable(false);
 
+	RETURN_FALSE_IF_FALSE(ApplySceneSettings(sceneDescription));
+
+	if (m_benchmark)
+		m_rhi->SetRenderType(m_benchmark->GetRendererType());
+
 	return true;
 }
 
 bool CRasterRender::on_update(float delta)
 {
-	m_activeAcquireSemaphore = GetAvailableAcquireSemaphore(m_activeAcquireSemaphore);
-	RETURN_FALSE_IF_FALSE(m_rhi->AcquireNextSwapChain(m_activeAcquireSemaphore, m_swapchainIndex));
+	PROFILE_FUNCTION();
+
+	RETURN_FALSE_IF_FALSE(ReloadChangedShaders(delta));
+
+	// Everything indexed with m_frameIndex below is free to be overwritten once this returns
+	RETURN_FALSE_IF_FALSE(m_framePacer->BeginFrame(m_rhi));
+	m_frameIndex = m_framePacer->GetFrameIndex();
+	m_gpuProfiler->BeginFrame(m_rhi, m_frameIndex);
+
+	RETURN_FALSE_IF_FALSE(m_rhi->AcquireNextSwapChain(m_framePacer->GetAcquireSemaphore(), m_swapchainIndex));
+
+	// the runs measure the whole scene, frames drawn while it streams in are not part of them
+	bool benchmarkFrame = (m_benchmark && m_sceneLoaded);
+	if (benchmarkFrame)
+		m_benchmark->ApplyFrame(m_rhi, m_primaryCamera);
 
 	m_sceneGraph->Update();
 
@@ -214,7 +285,7 @@ bool CRasterRender::on_update(float delta)
 		loadedUpdate.isLeftMouseDown				= m_keys[LEFT_MOUSE_BUTTON].down;
 		loadedUpdate.isRightMouseDown				= m_keys[RIGHT_MOUSE_BUTTON].down;
 		loadedUpdate.screenRes						= nm::float2((float)s_Window.screenWidth, (float)s_Window.screenHeight);
-		loadedUpdate.swapchainIndex					= m_swapchainIndex;
+		loadedUpdate.frameIndex						= m_frameIndex;
 		loadedUpdate.timeElapsed					= delta;
 		loadedUpdate.commandPool					= m_vkCmdPool;
 		loadedUpdate.cameraData						= camUpdateData;
@@ -224,6 +295,12 @@ bool CRasterRender::on_update(float delta)
 		RETURN_FALSE_IF_FALSE(m_loadableAssets->Update(m_rhi, loadedUpdate));
 	}
 
+	if (!m_sceneLoaded && m_loadableAssets->GetScene()->IsLoaded())
+	{
+		m_sceneLoaded = true;
+		LogTimeToFullScene();
+	}
+
 	{
 		CFixedBuffers::PrimaryUniformData* uniformData = m_fixedAssets->GetFixedBuffers()->GetPrimaryUnifromData();
 		uniformData->cameraInvView					= nm::inverse(m_primaryCamera->GetView());
@@ -242,6 +319,8 @@ bool CRasterRender::on_update(float delta)
 		updateData.sceneGraph						= m_sceneGraph;
 		updateData.uniformData						= uniformData;
 
+		// The lighting and tone map passes select their pipeline permutation from the feature flags in the
+		// uniform data, so they are updated after every pass writing one of those
 		m_staticShadowPass->Update(&updateData);
 		m_skyboxForwardPass->Update(&updateData);
 		m_skyboxDeferredPass->Update(&updateData);
@@ -249,8 +328,14 @@ bool CRasterRender::on_update(float delta)
 		m_ssaoBlurPass->Update(&updateData);
 		m_ssrComputePass->Update(&updateData);
 		m_ssrBlurPass->Update(&updateData);
-		m_forwardPass->Update(&updateData);
+
+		// SSR only runs in the deferred renderer, without it the reflection targets are never written.
+		// Neither are they before its pipelines are created
+		if (m_rhi->GetRendererType() != CVulkanRHI::RendererType::Deferred || !IsNonCriticalPipelineReady())
+			uniformData->ssrEnable				= 0.0f;
+
 		m_deferredPass->Update(&updateData);
+		m_forwardPass->Update(&updateData);
 		m_deferredLightPass->Update(&updateData);
 		m_debugDrawPass->Update(&updateData);
 		m_toneMapPass->Update(&updateData);
@@ -258,7 +343,7 @@ bool CRasterRender::on_update(float delta)
 		m_uiPass->Update(&updateData);
 
 		FixedUpdateData fixedUpdate{};
-		fixedUpdate.swapchainIndex					= m_swapchainIndex;
+		fixedUpdate.frameIndex						= m_frameIndex;
 		RETURN_FALSE_IF_FALSE(m_fixedAssets->Update(m_rhi, fixedUpdate));
 	}
 	
@@ -266,24 +351,32 @@ bool CRasterRender::on_update(float delta)
 
 	if (m_pickObject)
 	{
-		m_cmdBfrsInUse.push_back(m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_PickerCopy2CPU]);
-		if (!DoReadBackObjPickerBuffer(m_swapchainIndex, m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_PickerCopy2CPU]))
+		m_cmdBfrsInUse.push_back(m_vkCmdBfr[m_frameIndex][CommandBufferId::cb_PickerCopy2CPU]);
+		if (!DoReadBackObjPickerBuffer(m_vkCmdBfr[m_frameIndex][CommandBufferId::cb_PickerCopy2CPU]))
 			return false;
 	}
 
-	CVulkanRHI::PipelineStageFlagsList psfList{ VkPipelineStageFlags {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT} };
-	bool waitForFinish = false;
-	bool waitForFence = false;
-	CVulkanRHI::SemaphoreList signalList{ m_vksubmitCompleteSemaphore };
-	CVulkanRHI::SemaphoreList waitList{ m_activeAcquireSemaphore };
-	RETURN_FALSE_IF_FALSE(m_rhi->SubmitCommandBuffers(
-		&m_cmdBfrsInUse, &psfList, waitForFinish, VK_NULL_HANDLE/*&m_vkFenceCmdBfrFree[m_swapchainIndex]*/, 
-		waitForFence, &signalList, &waitList));
+	RETURN_FALSE_IF_FALSE(m_framePacer->SubmitFrame(m_rhi, &m_cmdBfrsInUse, m_swapchainIndex));
+	m_gpuProfiler->EndFrame(m_frameIndex);
 
 	m_cmdBfrsInUse.clear();
 
+	RETURN_FALSE_IF_FALSE(UpdateNonCriticalPipelines());
+
+	if (benchmarkFrame)
+	{
+		RETURN_FALSE_IF_FALSE(m_benchmark->EndFrame(m_rhi, m_framePacer, m_gpuProfiler, m_fixedAssets->GetRenderTargets()));
+		if (m_benchmark->IsDone())
+			quit();
+		else
+			m_rhi->SetRenderType(m_benchmark->GetRendererType());
+	}
+
 	if (m_pickObject)
 	{
+		// the picker buffer is shared by all frames, so the read back has to wait for this one
+		RETURN_FALSE_IF_FALSE(m_framePacer->WaitForAllFrames(m_rhi));
+
 		int meshID = -1;
 		RETURN_FALSE_IF_FALSE(m_rhi->ReadFromBuffer((uint8_t*)&meshID, m_fixedAssets->GetFixedBuffers()->GetBuffer(CFixedBuffers::fb_ObjectPickerRead)));
 		m_loadableAssets->GetScene()->SetSelectedRenderableMesh(meshID);
@@ -295,68 +388,46 @@ bool CRasterRender::on_update(float delta)
 
 void CRasterRender::on_present()
 {
+	if (m_rhi->IsHeadless())
+	{
+		if (!m_rhi->PresentHeadless(m_framePacer->GetRenderCompleteSemaphore(m_swapchainIndex)))
+			std::cerr << "CRasterRender::on_present Error: Headless present failed" << std::endl;
+
+		if (m_frameCount == 0)
+			LogTimeToFirstFrame();
+		++m_frameCount;
+		return;
+	}
+
 	CVulkanRHI::SwapChain swapchain				= m_rhi->GetSwapChain();
-	CVulkanRHI::Queue queue						= m_rhi->GetQueue();
 
 	VkPresentInfoKHR presentInfo{};
 	VkResult presentResult						= VkResult::VK_RESULT_MAX_ENUM;
 	presentInfo.sType							= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount				= 1;
-	presentInfo.pWaitSemaphores					= &m_vksubmitCompleteSemaphore;
+	VkSemaphore renderComplete					= m_framePacer->GetRenderCompleteSemaphore(m_swapchainIndex);
+	presentInfo.pWaitSemaphores					= &renderComplete;
 	presentInfo.swapchainCount					= 1;
 	presentInfo.pSwapchains						= &swapchain;
 	presentInfo.pImageIndices					= &m_swapchainIndex;
 	presentInfo.pResults						= &presentResult;
-	VkResult res = vkQueuePresentKHR(queue, &presentInfo);
+	VkResult res = m_rhi->QueuePresent(presentInfo);
 	if (res != VK_SUCCESS)
 	{
 		std::cerr << "CRasterRender::on_present Error: vkQueueSubmit failed " << res << std::endl;
 	}
 
-	m_rhi->WaitToFinish(queue);
+	// no wait here, the next frame's BeginFrame blocks only when the frames in flight are used up
+	if (m_frameCount == 0)
+		LogTimeToFirstFrame();
 	++m_frameCount;
 }
 
-VkSemaphore CRasterRender::GetAvailableAcquireSemaphore(VkSemaphore p_in)
-{
-	return (p_in == m_vkswapchainAcquireSemaphore[1] || p_in == VK_NULL_HANDLE) ? m_vkswapchainAcquireSemaphore[0] : m_vkswapchainAcquireSemaphore[1];
-}
-
-VkFence CRasterRender::WaitForFinishIfNecessary(VkFence p_in)
-{
-	if (p_in == m_vkFenceCmdBfrFree[0])
-	{
-		if (m_swapchainIndex == 0) 
-		{
-			m_rhi->WaitFence(p_in);
-			m_rhi->ResetFence(p_in);
-			return m_vkFenceCmdBfrFree[1];
-		}
-		return p_in;
-	}
-		
-	if (p_in == m_vkFenceCmdBfrFree[1])
-	{
-		if(m_swapchainIndex == 1)
-		{
-			m_rhi->WaitFence(p_in);
-			m_rhi->ResetFence(p_in);
-			return m_vkFenceCmdBfrFree[0];
-		}
-		return p_in;
-	}
-
-	if (p_in == VK_NULL_HANDLE)
-		return m_vkFenceCmdBfrFree[0];
-
-	return p_in;
-}
-
 bool CRasterRender::InitCamera()
 {
 	CPerspectiveCamera::PerpspectiveInitdData persIntData{};
 	persIntData.fov								= 45.0f;
-	persIntData.aspect							= (float)CWinCore::s_Window.screenWidth / CWinCore::s_Window.screenHeight;
+	persIntData.aspect							= (float)s_Window.screenWidth / s_Window.screenHeight;
 	persIntData.lookFrom						= nm::float4(0.0f, 0.0f, 4.0f, 1.0f);
 	persIntData.lookAt							= nm::float3{ 0.0f, 0.0f, 0.0f };
 	persIntData.up								= nm::float3{ 0.0f, 1.0f,  0.0f };
@@ -369,28 +440,52 @@ bool CRasterRender::InitCamera()
 	return true;
 }
 
-bool CRasterRender::CreateSyncPremitives()
+// The passes own the render settings and write them to the uniform data as they update. The scene file's are laid over
+// those and taken back by the passes, so the settings the file leaves out keep their defaults
+bool CRasterRender::ApplySceneSettings(const SceneDescription& p_sceneDescription)
 {
-	for (int i = 0; i < FRAME_BUFFER_COUNT; i++)
-	{
-		RETURN_FALSE_IF_FALSE(m_rhi->CreateSemaphor(m_vkswapchainAcquireSemaphore[i], "Acquire Swap Chain Semaphore " + std::to_string(i)));
-		RETURN_FALSE_IF_FALSE(m_rhi->CreateFence(VK_FENCE_CREATE_SIGNALED_BIT, m_vkFenceCmdBfrFree[i], "Cmd Bfr Free Fence " + std::to_string(1)));
-		m_rhi->ResetFence(m_vkFenceCmdBfrFree[i]);
-	}
+	if (p_sceneDescription.hasCamera)
+		m_primaryCamera->SetPose(p_sceneDescription.camera.position, p_sceneDescription.camera.yaw, p_sceneDescription.camera.pitch);
+
+	if (p_sceneDescription.settings.empty())
+		return true;
+
+	CFixedBuffers* fixedBuffers = m_fixedAssets->GetFixedBuffers();
+	CPass::UpdateData updateData{};
+	updateData.sceneGraph						= m_sceneGraph;
+	updateData.uniformData						= fixedBuffers->GetPrimaryUnifromData();
+
+	CPass* passes[] = { m_staticShadowPass, m_ssaoComputePass, m_ssrComputePass, m_deferredPass, m_toneMapPass, m_taaComputePass };
+	for (CPass* pass : passes)
+		RETURN_FALSE_IF_FALSE(pass->Update(&updateData));
+
+	fixedBuffers->SetSettings(p_sceneDescription.settings);
 
-	RETURN_FALSE_IF_FALSE(m_rhi->CreateSemaphor(m_vksubmitCompleteSemaphore, "Gfx Queue Submit Complete Semaphore"));
+	for (CPass* pass : passes)
+		pass->ApplySettings(updateData.uniformData);
 
 	return true;
 }
 
-void CRasterRender::DestroySyncPremitives()
+bool CRasterRender::SaveScene(const std::filesystem::path& p_path)
 {
-	for (int i = 0; i < FRAME_BUFFER_COUNT; i++)
+	SceneDescription sceneDescription;
+	m_loadableAssets->GetScene()->GetSceneDescription(sceneDescription);
+	m_fixedAssets->GetFixedBuffers()->GetSettings(sceneDescription.settings);
+
+	// the uniform data has SSR off wherever it cannot run, the pass keeps whether it is on
+	for (auto& setting : sceneDescription.settings)
 	{
-		m_rhi->DestroySemaphore(m_vkswapchainAcquireSemaphore[i]);
-		m_rhi->DestroyFence(m_vkFenceCmdBfrFree[i]);
+		if (setting.name == "ssrEnable")
+			setting.value = m_ssrComputePass->IsEnabled() ? 1.0f : 0.0f;
 	}
-	m_rhi->DestroySemaphore(m_vksubmitCompleteSemaphore);
+
+	sceneDescription.hasCamera = true;
+	sceneDescription.camera.position = m_primaryCamera->GetLookFrom();
+	sceneDescription.camera.yaw = m_primaryCamera->GetYaw();
+	sceneDescription.camera.pitch = m_primaryCamera->GetPitch();
+
+	return sceneDescription.Save(p_path);
 }
 
 bool CRasterRender::CreatePasses()
@@ -452,6 +547,9 @@ bool CRasterRender::CreatePasses()
 	renderData.loadedAssets					= m_loadableAssets;
 	renderData.rendererType					= m_rhi->GetRendererType();
 
+	std::chrono::steady_clock::time_point pipelineStart = std::chrono::steady_clock::now();
+
+	// The vertex binding of the shadow pass is what the other scene passes are created with, so it goes first
 	CVulkanRHI::Pipeline pipeline;
 	pipeline.pipeLayout						= primaryAndSceneLayout;
 	pipeline.cullMode						= VK_CULL_MODE_BACK_BIT;		// to fix peter-panning issue
@@ -461,55 +559,45 @@ bool CRasterRender::CreatePasses()
 	CVulkanRHI::VertexBinding vertexBindinginUse;
 	m_staticShadowPass->GetVertexBindingInUse(vertexBindinginUse);
 
-	pipeline								= CVulkanRHI::Pipeline{};
-	pipeline.pipeLayout						= primaryAndSceneLayout;
-	pipeline.vertexInBinding				= vertexBindinginUse.bindingDescription;
-	pipeline.vertexAttributeDesc			= vertexBindinginUse.attributeDescription;
-	RETURN_FALSE_IF_FALSE(m_forwardPass->Initalize(&renderData, pipeline));
-
-	pipeline								= CVulkanRHI::Pipeline{};
-	pipeline.pipeLayout						= primaryAndSceneLayout;
-	pipeline.vertexInBinding				= vertexBindinginUse.bindingDescription;
-	pipeline.vertexAttributeDesc			= vertexBindinginUse.attributeDescription;
-	RETURN_FALSE_IF_FALSE(m_skyboxForwardPass->Initalize(&renderData, pipeline));
-
-	pipeline								= CVulkanRHI::Pipeline{};
-	pipeline.pipeLayout						= primaryAndSceneLayout;
-	pipeline.vertexInBinding				= vertexBindinginUse.bindingDescription;
-	pipeline.vertexAttributeDesc			= vertexBindinginUse.attributeDescription;
-	RETURN_FALSE_IF_FALSE(m_skyboxDeferredPass->Initalize(&renderData, pipeline));
+	// Initalize only touches its own pass and creates device objects, so every other pass is created on the
+	// thread pool. Each job gets copies of the render data and the pipeline description
+	std::vector<CThreadPool::Job> jobs;
+	std::vector<CThreadPool::Job>& nonCriticalJobs = ASYNC_NONCRITICAL_PIPELINES ? m_nonCriticalPipelineJobs : jobs;
 
 	pipeline								= CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout						= primaryAndSceneLayout;
 	pipeline.vertexInBinding				= vertexBindinginUse.bindingDescription;
 	pipeline.vertexAttributeDesc			= vertexBindinginUse.attributeDescription;
-	RETURN_FALSE_IF_FALSE(m_deferredPass->Initalize(&renderData, pipeline));
+	jobs.push_back([this, renderData, pipeline](uint32_t) mutable { return m_forwardPass->Initalize(&renderData, pipeline); });
+	jobs.push_back([this, renderData, pipeline](uint32_t) mutable { return m_skyboxForwardPass->Initalize(&renderData, pipeline); });
+	jobs.push_back([this, renderData, pipeline](uint32_t) mutable { return m_skyboxDeferredPass->Initalize(&renderData, pipeline); });
+	jobs.push_back([this, renderData, pipeline](uint32_t) mutable { return m_deferredPass->Initalize(&renderData, pipeline); });
 
 	pipeline								= CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout						= primaryLayout;
-	RETURN_FALSE_IF_FALSE(m_ssaoComputePass->Initalize(pipeline));
-	RETURN_FALSE_IF_FALSE(m_ssaoBlurPass->Initalize(pipeline));
+	jobs.push_back([this, pipeline](uint32_t) { return m_ssaoComputePass->Initalize(pipeline); });
+	jobs.push_back([this, pipeline](uint32_t) { return m_ssaoBlurPass->Initalize(pipeline); });
 
 	pipeline								= CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout						= m_rhi->IsRayTracingEnabled() ? primaryAndSceneRayTracingLayout : primaryAndSceneLayout;
-	RETURN_FALSE_IF_FALSE(m_deferredLightPass->Initalize(pipeline));
+	jobs.push_back([this, pipeline](uint32_t) { return m_deferredLightPass->Initalize(pipeline); });
 
 	pipeline								= CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout						= primaryAndSceneLayout;
-	RETURN_FALSE_IF_FALSE(m_ssrComputePass->Initalize(pipeline));
-	RETURN_FALSE_IF_FALSE(m_ssrBlurPass->Initalize(pipeline));
+	nonCriticalJobs.push_back([this, pipeline](uint32_t) { return m_ssrComputePass->Initalize(pipeline); });
+	nonCriticalJobs.push_back([this, pipeline](uint32_t) { return m_ssrBlurPass->Initalize(pipeline); });
 
 	pipeline								= CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout						= debugLayout;
-	RETURN_FALSE_IF_FALSE(m_debugDrawPass->Initalize(&renderData, pipeline));
+	nonCriticalJobs.push_back([this, renderData, pipeline](uint32_t) mutable { return m_debugDrawPass->Initalize(&renderData, pipeline); });
 
 	pipeline								= CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout						= primaryLayout;
-	RETURN_FALSE_IF_FALSE(m_toneMapPass->Initalize(&renderData, pipeline));
+	jobs.push_back([this, renderData, pipeline](uint32_t) mutable { return m_toneMapPass->Initalize(&renderData, pipeline); });
 
 	pipeline = CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout = primaryLayout;
-	RETURN_FALSE_IF_FALSE(m_taaComputePass->Initalize(pipeline));
+	jobs.push_back([this, pipeline](uint32_t) { return m_taaComputePass->Initalize(pipeline); });
 
 	pipeline								= CVulkanRHI::Pipeline{};
 	pipeline.pipeLayout						= uiLayout;
@@ -517,11 +605,109 @@ bool CRasterRender::CreatePasses()
 	pipeline.enableBlending					= true;
 	pipeline.enableDepthTest				= false;
 	pipeline.enableDepthWrite				= false;
-	RETURN_FALSE_IF_FALSE(m_uiPass->Initalize(&renderData, pipeline));
+	jobs.push_back([this, renderData, pipeline](uint32_t) mutable { return m_uiPass->Initalize(&renderData, pipeline); });
+
+	CThreadPool::JobGroup pipelineJobs;
+	for (auto& job : jobs)
+		m_threadPool->Submit(pipelineJobs, std::move(job));
+
+	if (!m_threadPool->Wait(pipelineJobs))
+	{
+		std::cerr << "CRasterRender::CreatePasses Error: Failed to create the pass pipelines" << std::endl;
+		return false;
+	}
+
+	m_pipelineCreationMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+	CLOG("Pass pipelines created in " << m_pipelineCreationMs << " ms on " << m_threadPool->GetThreadCount() << " threads, "
+		<< m_nonCriticalPipelineJobs.size() << " left for after the first frame" << std::endl);
+
+	m_nonCriticalPipelineState = m_nonCriticalPipelineJobs.empty() ? ncp_Ready : ncp_Deferred;
 
 	return true;
 }
 
+// Hands the pipelines left out of startup to the thread pool once the first frame is submitted, and picks
+// them up without waiting once they are all created
+bool CRasterRender::UpdateNonCriticalPipelines()
+{
+	if (m_nonCriticalPipelineState == ncp_Deferred)
+	{
+		for (auto& job : m_nonCriticalPipelineJobs)
+			m_threadPool->Submit(m_nonCriticalPipelineGroup, std::move(job));
+		m_nonCriticalPipelineJobs.clear();
+
+		m_nonCriticalPipelineState = ncp_Pending;
+	}
+	else if (m_nonCriticalPipelineState == ncp_Pending && m_nonCriticalPipelineGroup.pending == 0)
+	{
+		if (!m_nonCriticalPipelineGroup.succeeded)
+		{
+			std::cerr << "CRasterRender::UpdateNonCriticalPipelines Error: Failed to create the debug draw and SSR pipelines" << std::endl;
+			return false;
+		}
+
+		m_nonCriticalPipelineState = ncp_Ready;
+		CLOG("Debug draw and SSR pipelines ready at frame " << m_frameCount << std::endl);
+
+		// every pipeline exists now, the cache is saved right away rather than only on a clean exit
+		m_rhi->SavePipelineCache();
+	}
+
+	return true;
+}
+
+// Checks the shader sources twice a second. Pipelines are only swapped with every frame retired, the check itself is a stat per file
+bool CRasterRender::ReloadChangedShaders(float p_delta)
+{
+	m_shaderReloadTimer += p_delta;
+	if (m_shaderReloadTimer < 0.5f)
+		return true;
+	m_shaderReloadTimer = 0.0f;
+
+	std::vector<std::filesystem::path> changedSources;
+	m_rhi->GetOutdatedShaderSources(changedSources);
+	if (changedSources.empty())
+		return true;
+
+	for (const auto& source : changedSources)
+		CLOG("Shader changed - " << source.generic_string() << std::endl);
+
+	RETURN_FALSE_IF_FALSE(m_framePacer->WaitForAllFrames(m_rhi));
+
+	std::vector<CPass*> passes{ m_staticShadowPass, m_skyboxForwardPass, m_skyboxDeferredPass, m_forwardPass, m_deferredPass,
+		m_deferredLightPass, m_ssaoComputePass, m_ssaoBlurPass, m_toneMapPass, m_taaComputePass, m_uiPass };
+
+	// still being created otherwise; an edit made while they are has to be saved again to reach them
+	if (IsNonCriticalPipelineReady())
+		passes.insert(passes.end(), { m_ssrComputePass, m_ssrBlurPass, m_debugDrawPass });
+
+	// every pass owns its pipeline, so they compile in parallel. A failed compile keeps the old pipeline and is not fatal
+	CThreadPool::JobGroup reloadJobs;
+	for (CPass* pass : passes)
+		m_threadPool->Submit(reloadJobs, [pass, &changedSources](uint32_t) { pass->ReloadPipeline(changedSources); return true; });
+	m_threadPool->Wait(reloadJobs);
+
+	return true;
+}
+
+void CRasterRender::LogTimeToFirstFrame()
+{
+	float timeToFirstFrameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+	CLOG_YELLOW("Time to first frame " << timeToFirstFrameMs << " ms, pass pipelines " << m_pipelineCreationMs << " ms" << std::endl);
+
+	if (m_benchmark)
+		m_benchmark->SetStartupTimes(m_pipelineCreationMs, timeToFirstFrameMs);
+}
+
+void CRasterRender::LogTimeToFullScene()
+{
+	float timeToFullSceneMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+	CLOG_YELLOW("Time to full scene " << timeToFullSceneMs << " ms" << std::endl);
+
+	if (m_benchmark)
+		m_benchmark->SetTimeToFullScene(timeToFullSceneMs);
+}
+
 void CRasterRender::UpdateCamera(CCamera::UpdateData& p_updateData)
 {
 	p_updateData.moveCamera							= m_keys[MIDDLE_MOUSE_BUTTON].down;
@@ -571,7 +757,7 @@ void CRasterRender::UpdateSceneGraphDependencies(float p_delta)
 	//m_sunLight->Update(cdata);
 }
 
-bool CRasterRender::DoReadBackObjPickerBuffer(uint32_t p_swapchainIndex, CVulkanRHI::CommandBuffer& p_cmdBfr)
+bool CRasterRender::DoReadBackObjPickerBuffer(CVulkanRHI::CommandBuffer& p_cmdBfr)
 {
 	CVulkanRHI::Buffer buffer				= m_fixedAssets->GetFixedBuffers()->GetBuffer(CFixedBuffers::fb_ObjectPickerWrite);
 	
@@ -594,120 +780,206 @@ bool CRasterRender::DoReadBackObjPickerBuffer(uint32_t p_swapchainIndex, CVulkan
 	return true;
 }
 
-bool CRasterRender::BeginAllCommandBuffers(uint32_t p_swapchainIndex)
-{
-	for (uint32_t i = 0; i < CommandBufferId::cb_max; i++)
-		RETURN_FALSE_IF_FALSE(m_rhi->BeginCommandBuffer(m_vkCmdBfr[p_swapchainIndex][i], m_cmdBufferNames[p_swapchainIndex][i].c_str()));
-
-	return true;
-}
-
-bool CRasterRender::EndAllCommandBuffers(uint32_t p_swapchainIndex)
+void CRasterRender::BuildRenderGraph(CRenderGraph& p_graph, CVulkanRHI::RendererType p_renderType, bool p_allPasses)
 {
-	for (uint32_t i = 0; i < CommandBufferId::cb_max; i++)
-		RETURN_FALSE_IF_FALSE(m_rhi->EndCommandBuffer(m_vkCmdBfr[p_swapchainIndex][i]));
-
-	return true;
-}
+	typedef CRenderTargets RT;
+	typedef CRenderGraph RG;
+	const VkImageLayout general		= VK_IMAGE_LAYOUT_GENERAL;
+	const VkImageLayout shaderRead	= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-bool CRasterRender::RenderFrame(CVulkanRHI::RendererType p_renderType)
-{
-	// If there is any edit to the scene, the instance buffer needs to be updated and 
-	// the TLAS needs to be updated as well. Otherwise the BVH will not update
-	// TODO: Insert a barrier here to ensure TLAS has finished updating before the Ray Tracing can happen
-	// Also might be valuable to pass the command buffer that only participates in first ray tracing pass.
-	// As of now there is a hard sync with a device wait for finish here.
-	if (m_sceneGraph->GetSceneStatus() >= CSceneGraph::SceneStatus::ss_SceneMoved)
-		RETURN_FALSE_IF_FALSE(m_loadableAssets->GetScene()->UpdateTLAS(m_rhi, m_vkCmdPool, m_swapchainIndex))
+	// Passes recorded with render passes declare the layout the render pass starts and ends in
+	if (p_allPasses || (m_staticShadowPass->IsEnabled() && !m_staticShadowPass->IsRTShadowEnabled()))
+	{
+		uint32_t pass = p_graph.AddPass("Shadow Map", cb_ShadowMap, [this](CPass::RenderData* p_data) { return m_staticShadowPass->Render(p_data); });
+		p_graph.Write(pass, RT::rt_DirectionalShadowDepth, RG::ra_DepthAttachment, shaderRead);
+	}
 
-	RETURN_FALSE_IF_FALSE(BeginAllCommandBuffers(m_swapchainIndex));
+	if (p_renderType == CVulkanRHI::RendererType::Forward)
+	{
+		uint32_t pass = p_graph.AddPass("Skybox", cb_Skybox, [this](CPass::RenderData* p_data) { return m_skyboxForwardPass->Render(p_data); });
+		p_graph.Write(pass, RT::rt_PrimaryColor, RG::ra_ColorAttachment, general);
+		p_graph.Write(pass, RT::rt_PrimaryDepth, RG::ra_DepthAttachment);
+
+		pass = p_graph.AddPass("Forward", cb_Forward, [this](CPass::RenderData* p_data) { return m_forwardPass->Render(p_data); });
+		p_graph.Write(pass, RT::rt_Position, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_Normal, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_RoughMetal, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_Motion, RG::ra_ColorAttachment);
+		p_graph.Read(pass, RT::rt_PrimaryColor, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_PrimaryColor, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_PrimaryDepth, RG::ra_DepthAttachment);
+		p_graph.Read(pass, RT::rt_DirectionalShadowDepth, RG::ra_FragmentRead);
+	}
+	else
+	{
+		uint32_t pass = p_graph.AddPass("Skybox", cb_Skybox, [this](CPass::RenderData* p_data) { return m_skyboxDeferredPass->Render(p_data); });
+		p_graph.Write(pass, RT::rt_PrimaryColor, RG::ra_ColorAttachment, general);
+		p_graph.Write(pass, RT::rt_PrimaryDepth, RG::ra_DepthAttachment);
+
+		pass = p_graph.AddPass("GBuffer", cb_Deferred_GBuf, [this](CPass::RenderData* p_data) { return m_deferredPass->Render(p_data); });
+		p_graph.Write(pass, RT::rt_Position, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_Normal, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_Albedo, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_RoughMetal, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_Motion, RG::ra_ColorAttachment);
+		p_graph.Write(pass, RT::rt_PrimaryDepth, RG::ra_DepthAttachment);
+	}
 
-	CPass::RenderData renderData{};
-	renderData.fixedAssets = m_fixedAssets;
-	renderData.loadedAssets = m_loadableAssets;
-	renderData.primaryDescriptors = m_primaryDescriptors;
-	renderData.scIdx = m_swapchainIndex;
-	renderData.sceneGraph = m_sceneGraph;
+	// culled when tone mapping does not apply the occlusion
+	{
+		uint32_t pass = p_graph.AddPass("SSAO", cb_SSAO, [this](CPass::RenderData* p_data) { return m_ssaoComputePass->Dispatch(p_data); });
+		p_graph.Read(pass, RT::rt_Position, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_Normal, RG::ra_ComputeRead);
+		p_graph.Write(pass, RT::rt_SSAO_Blur, RG::ra_ComputeWrite);
+
+		pass = p_graph.AddPass("SSAO Blur", cb_SSAO_Blur, [this](CPass::RenderData* p_data) { return m_ssaoBlurPass->Dispatch(p_data); });
+		p_graph.Read(pass, RT::rt_SSAO_Blur, RG::ra_ComputeWrite);
+		p_graph.Write(pass, RT::rt_SSAO_Blur, RG::ra_ComputeWrite);
+	}
 
-	if (m_staticShadowPass->IsEnabled() && !m_staticShadowPass->IsRTShadowEnabled())
+	bool ssr = false;
+	if (p_renderType == CVulkanRHI::RendererType::Deferred)
 	{
-		//if (!m_staticShadowPass->ReuseShadowMap())
+		uint32_t pass = p_graph.AddPass("Deferred Lighting", cb_Deferred_Lighting, [this](CPass::RenderData* p_data) { return m_deferredLightPass->Dispatch(p_data); });
+		p_graph.Read(pass, RT::rt_Position, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_Normal, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_Albedo, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_RoughMetal, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_DirectionalShadowDepth, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_PrimaryColor, RG::ra_ComputeWrite);
+		p_graph.Write(pass, RT::rt_PrimaryColor, RG::ra_ComputeWrite);
+
+		ssr = p_allPasses || (m_ssrComputePass->IsEnabled() && IsNonCriticalPipelineReady());
+		if (ssr)
 		{
-			renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_ShadowMap];
-			RETURN_FALSE_IF_FALSE(m_staticShadowPass->Render(&renderData));
-			m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+			pass = p_graph.AddPass("SSR", cb_SSR, [this](CPass::RenderData* p_data) { return m_ssrComputePass->Dispatch(p_data); });
+			p_graph.Read(pass, RT::rt_Position, RG::ra_ComputeRead);
+			p_graph.Read(pass, RT::rt_Normal, RG::ra_ComputeRead);
+			p_graph.Read(pass, RT::rt_PrimaryColor, RG::ra_ComputeRead);
+			p_graph.Read(pass, RT::rt_RoughMetal, RG::ra_ComputeRead);
+			p_graph.Write(pass, RT::rt_SSReflection, RG::ra_ComputeWrite);
+
+			pass = p_graph.AddPass("SSR Blur", cb_SSR_Blur, [this](CPass::RenderData* p_data) { return m_ssrBlurPass->Dispatch(p_data); });
+			p_graph.Read(pass, RT::rt_SSReflection, RG::ra_ComputeRead);
+			p_graph.Write(pass, RT::rt_SSRBlur, RG::ra_ComputeWrite);
 		}
 	}
 
-	if (p_renderType == CVulkanRHI::RendererType::Forward)
+	// A failed debug draw is not fatal, the command buffer is submitted with whatever it recorded
+	if (p_allPasses || IsNonCriticalPipelineReady())
 	{
-		renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_Skybox];
-		RETURN_FALSE_IF_FALSE(m_skyboxForwardPass->Render(&renderData));
-		m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+		uint32_t pass = p_graph.AddPass("Debug Draw", cb_DebugDraw, [this](CPass::RenderData* p_data) { m_debugDrawPass->Render(p_data); return true; });
+		p_graph.Read(pass, RT::rt_PrimaryColor, RG::ra_ColorAttachment, general);
+		p_graph.Write(pass, RT::rt_PrimaryColor, RG::ra_ColorAttachment, general);
+		p_graph.Read(pass, RT::rt_PrimaryDepth, RG::ra_DepthAttachment);
+		p_graph.Write(pass, RT::rt_PrimaryDepth, RG::ra_DepthAttachment);
+	}
 
-		renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_Forward];
-		RETURN_FALSE_IF_FALSE(m_forwardPass->Render(&renderData));
-		m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+	if (p_allPasses || m_taaComputePass->IsEnabled())
+	{
+		uint32_t pass = p_graph.AddPass("TAA", cb_TAA, [this](CPass::RenderData* p_data) { return m_taaComputePass->Dispatch(p_data); });
+		p_graph.Read(pass, RT::rt_Motion, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_Prev_PrimaryColor, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_PrimaryDepth, RG::ra_ComputeRead);
+		p_graph.Read(pass, RT::rt_PrimaryColor, RG::ra_ComputeWrite);
+		p_graph.Write(pass, RT::rt_PrimaryColor, RG::ra_ComputeWrite);
 	}
-	else
+
+	// Tone mapping and UI present, nothing in the graph reads what they write
 	{
-		renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_Skybox];
-		RETURN_FALSE_IF_FALSE(m_skyboxDeferredPass->Render(&renderData));
-		m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+		uint32_t pass = p_graph.AddPass("Tone Mapping", cb_ToneMapping, [this](CPass::RenderData* p_data) { return m_toneMapPass->Render(p_data); }, true);
+		p_graph.Read(pass, RT::rt_PrimaryColor, RG::ra_FragmentRead);
+		if (p_allPasses || m_ssaoComputePass->IsEnabled())
+			p_graph.Read(pass, RT::rt_SSAO_Blur, RG::ra_FragmentRead);
+		if (ssr)
+		{
+			p_graph.Read(pass, RT::rt_SSReflection, RG::ra_FragmentRead);
+			p_graph.Read(pass, RT::rt_SSRBlur, RG::ra_FragmentRead);
+		}
+		// copy of the color for the next frame's TAA
+		p_graph.Read(pass, RT::rt_PrimaryColor, RG::ra_TransferRead);
+		p_graph.Write(pass, RT::rt_Prev_PrimaryColor, RG::ra_TransferWrite);
 
-		renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_Deferred_GBuf];
-		RETURN_FALSE_IF_FALSE(m_deferredPass->Render(&renderData));
-		m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+		p_graph.AddPass("UI", cb_UI, [this](CPass::RenderData* p_data) { return m_uiPass->Render(p_data); }, true);
 	}
+}
+
+// Records one command buffer from start to end on whichever thread picks the job up
+void CRasterRender::SubmitRecordJob(CThreadPool::JobGroup& p_jobs, uint32_t p_passIdx, const CPass::RenderData& p_renderData)
+{
+	uint32_t cbId					= m_renderGraph->GetCommandBufferId(p_passIdx);
+	CRenderGraph::RecordFunc record	= m_renderGraph->GetRecordFunc(p_passIdx);
+
+	CPass::RenderData renderData	= p_renderData;
+	renderData.cmdBfr				= m_vkCmdBfr[m_frameIndex][cbId];
+	const char* debugMarker			= m_cmdBufferNames[m_frameIndex][cbId].c_str();
 
-	renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_SSAO];
-	RETURN_FALSE_IF_FALSE(m_ssaoComputePass->Dispatch(&renderData));
-	
-	renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_SSAO];
-	RETURN_FALSE_IF_FALSE(m_ssaoBlurPass->Dispatch(&renderData));
 	m_cmdBfrsInUse.push_back(renderData.cmdBfr);
 
-	if (p_renderType == CVulkanRHI::RendererType::Deferred)
-	{
-		renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_Deferred_Lighting];
-		RETURN_FALSE_IF_FALSE(m_deferredLightPass->Dispatch(&renderData));
-		m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+	m_gpuProfiler->SetPass(m_frameIndex, p_passIdx, m_renderGraph->GetPassName(p_passIdx));
 
-		if (m_ssrComputePass->IsEnabled())
+	m_threadPool->Submit(p_jobs, [this, renderData, debugMarker, record, p_passIdx](uint32_t) mutable -> bool
 		{
-			renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_SSR];
-			RETURN_FALSE_IF_FALSE(m_ssrComputePass->Dispatch(&renderData));
+			RETURN_FALSE_IF_FALSE(m_rhi->BeginCommandBuffer(renderData.cmdBfr, debugMarker));
+			// the pass is timed including the barriers it waits on
+			m_gpuProfiler->WriteBeginPass(m_rhi, renderData.cmdBfr, renderData.frameIdx, p_passIdx);
+			m_renderGraph->RecordBarriers(m_rhi, p_passIdx, renderData.cmdBfr);
+			if (!record(&renderData))
+			{
+				std::cerr << "CRasterRender::RenderFrame Error: Failed recording " << debugMarker << std::endl;
+				return false;
+			}
+			m_gpuProfiler->WriteEndPass(m_rhi, renderData.cmdBfr, renderData.frameIdx, p_passIdx);
+			RETURN_FALSE_IF_FALSE(m_rhi->EndCommandBuffer(renderData.cmdBfr));
+			return true;
+		});
+}
 
-			renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_SSR];
-			RETURN_FALSE_IF_FALSE(m_ssrBlurPass->Dispatch(&renderData));
-			m_cmdBfrsInUse.push_back(renderData.cmdBfr);
-		}
-	}
+bool CRasterRender::RenderFrame(CVulkanRHI::RendererType p_renderType)
+{
+	PROFILE_FUNCTION();
 
-	// placing debug draw here because I do not want the depth buffer to go through another layout barrier
-	// from depth stencil attachment to shader read used in SSAO pass
-	renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_DebugDraw];
-	if (m_debugDrawPass->Render(&renderData))
+	// If there is any edit to the scene, the instance buffer needs to be updated and 
+	// the TLAS needs to be updated as well. Otherwise the BVH will not update
+	// TODO: Insert a barrier here to ensure TLAS has finished updating before the Ray Tracing can happen
+	// Also might be valuable to pass the command buffer that only participates in first ray tracing pass.
+	// As of now there is a hard sync with a device wait for finish here. The TLAS is shared by all
+	// frames, so the frames in flight have to finish before it is rebuilt.
+	if (m_sceneGraph->GetSceneStatus() >= CSceneGraph::SceneStatus::ss_SceneMoved && m_rhi->IsRayTracingEnabled())
 	{
-		m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+		RETURN_FALSE_IF_FALSE(m_framePacer->WaitForAllFrames(m_rhi));
+		RETURN_FALSE_IF_FALSE(m_loadableAssets->GetScene()->UpdateTLAS(m_rhi, m_vkCmdPool, m_frameIndex))
 	}
 
-	if (m_taaComputePass->IsEnabled())
-	{
-		renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_TAA];
-		RETURN_FALSE_IF_FALSE(m_taaComputePass->Dispatch(&renderData));
-		m_cmdBfrsInUse.push_back(renderData.cmdBfr);
-	}
+	CPass::RenderData renderData{};
+	renderData.fixedAssets = m_fixedAssets;
+	renderData.loadedAssets = m_loadableAssets;
+	renderData.primaryDescriptors = m_primaryDescriptors;
+	renderData.scIdx = m_swapchainIndex;
+	renderData.frameIdx = m_frameIndex;
+	renderData.sceneGraph = m_sceneGraph;
+	renderData.threadPool = m_threadPool;
+	renderData.secondaryCmdBfrs = m_secondaryCmdBfrs;
 
-	renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_ToneMapping];
-	RETURN_FALSE_IF_FALSE(m_toneMapPass->Render(&renderData));
-	m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+	// previous submission of this frame slot has finished (see CFramePacer::BeginFrame), so its secondaries can be reused
+	m_secondaryCmdBfrs->Reset(m_frameIndex);
 
-	renderData.cmdBfr = m_vkCmdBfr[m_swapchainIndex][CommandBufferId::cb_UI];
-	RETURN_FALSE_IF_FALSE(m_uiPass->Render(&renderData));
-	m_cmdBfrsInUse.push_back(renderData.cmdBfr);
+	m_renderGraph->Reset();
+	BuildRenderGraph(*m_renderGraph, p_renderType, false);
+	RETURN_FALSE_IF_FALSE(m_renderGraph->Compile());
+
+	// Every pass that survived culling records its own command buffer as a job on the thread pool, starting
+	// with the barriers the graph collected for it. The command buffers are added to m_cmdBfrsInUse in the
+	// order the jobs are submitted, which is the order they are executed in
+	CThreadPool::JobGroup recordJobs;
+	for (uint32_t i = 0; i < m_renderGraph->GetPassCount(); i++)
+		SubmitRecordJob(recordJobs, i, renderData);
 
-	RETURN_FALSE_IF_FALSE(EndAllCommandBuffers(m_swapchainIndex));
+	if (!m_threadPool->Wait(recordJobs))
+	{
+		std::cerr << "CRasterRender::RenderFrame Error: Failed to record the frame's command buffers" << std::endl;
+		return false;
+	}
 
 	return true;
 }
@@ -1,20 +1,33 @@
 #pragma once
 
 #include <unordered_map>
+#if defined(VFRAME_HEADLESS)
+#include "core/HeadlessCore.h"
+typedef CHeadlessCore CPlatformCore;
+#else
 #include "core/WinCore.h"
+typedef CWinCore CPlatformCore;
+#endif
 #include "core/VulkanRHI.h"
 #include "core/Camera.h"
 #include "core/SceneGraph.h"
 #include "core/Asset.h"
+#include "core/ThreadPool.h"
 
 #include "LightingPass.h"
 #include "ScreenSpacePass.h"
 #include "UIPass.h"
 #include "PostProcessingPasses.h"
+#include "FramePacer.h"
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "Benchmark.h"
 
 #include "core/Global.h"
 
-class CRasterRender : public CWinCore
+#include <chrono>
+
+class CRasterRender : public CPlatformCore
 {
 public:
 	CRasterRender(const char* name, int screen_width_, int screen_height_, int window_scale);
@@ -25,6 +38,15 @@ public:
 	bool on_update(float delta) override;
 	void on_present() override;	
 
+	// Set before on_create; the benchmark then drives the camera, the renderer and when to quit
+	void SetBenchmark(CBenchmark* p_benchmark) { m_benchmark = p_benchmark; }
+
+	// Set before on_create; the scene file to load, the default scene otherwise
+	void SetScenePath(const std::filesystem::path& p_path) { m_scenePath = p_path; }
+
+	// The assets, lights, camera and render settings, as a scene file restoring this session
+	bool SaveScene(const std::filesystem::path& p_path);
+
 private:
 	enum CommandBufferId
 	{
@@ -40,9 +62,19 @@ private:
 		, cb_Skybox					= 9
 		, cb_SSR					= 10
 		, cb_TAA					= 11
+		, cb_SSAO_Blur				= 12
+		, cb_SSR_Blur				= 13
 		, cb_max
 	};
 
+	// Pipelines no frame depends on, debug draw and SSR, can be left for after the first frame
+	enum NonCriticalPipelineState
+	{
+		  ncp_Deferred				= 0		// jobs waiting for the first frame to be out
+		, ncp_Pending				= 1
+		, ncp_Ready					= 2
+	};
+
 	enum FragTexType
 	{
 		  ft_diffuse				= 0
@@ -51,20 +83,32 @@ private:
 	};
 
 	uint32_t							m_swapchainIndex;
+	uint32_t							m_frameIndex;			// slot of the per frame resources this frame uses
 	uint64_t							m_frameCount;
 
-	VkSemaphore							m_activeAcquireSemaphore;
-	VkSemaphore							m_vkswapchainAcquireSemaphore[FRAME_BUFFER_COUNT];
-	VkSemaphore							m_vksubmitCompleteSemaphore;
+	CFramePacer*						m_framePacer;
+	CRenderGraph*						m_renderGraph;
+	CGpuProfiler*						m_gpuProfiler;
+	CBenchmark*							m_benchmark;			// not owned, null unless benchmarking
+	std::filesystem::path				m_scenePath;
 
-	VkFence								m_activeCmdBfrFreeFence;
-	VkFence								m_vkFenceCmdBfrFree[FRAME_BUFFER_COUNT];
+	std::chrono::steady_clock::time_point m_startTime;			// construction, time to first frame is measured from here
+	float								m_pipelineCreationMs;
+	bool								m_sceneLoaded;			// all of the scene has streamed in, benchmarks wait for it
+	std::vector<CThreadPool::Job>		m_nonCriticalPipelineJobs;
+	CThreadPool::JobGroup				m_nonCriticalPipelineGroup;
+	NonCriticalPipelineState			m_nonCriticalPipelineState;
+	float								m_shaderReloadTimer;	// seconds since the shader sources were last checked
 
 	VkCommandPool						m_vkCmdPool;
-	std::string							m_cmdBufferNames[FRAME_BUFFER_COUNT][CommandBufferId::cb_max];
-	CVulkanRHI::CommandBuffer			m_vkCmdBfr[FRAME_BUFFER_COUNT][CommandBufferId::cb_max];
+	VkCommandPool						m_vkRecordCmdPool[MAX_FRAMES_IN_FLIGHT][CommandBufferId::cb_max];	// one per command buffer so each can be recorded on any thread
+	std::string							m_cmdBufferNames[MAX_FRAMES_IN_FLIGHT][CommandBufferId::cb_max];
+	CVulkanRHI::CommandBuffer			m_vkCmdBfr[MAX_FRAMES_IN_FLIGHT][CommandBufferId::cb_max];
 	CVulkanRHI::CommandBufferList		m_cmdBfrsInUse;
 
+	CThreadPool*						m_threadPool;
+	CSecondaryCommandBuffers*			m_secondaryCmdBfrs;
+
 	CPerspectiveCamera*					m_primaryCamera;
 		
 	bool								m_pickObject;
@@ -91,21 +135,24 @@ private:
 	CCopyComputePass*					m_copyComputePass;
 	CUIPass*							m_uiPass;
 	
-	VkSemaphore GetAvailableAcquireSemaphore(VkSemaphore p_in);
-	VkFence WaitForFinishIfNecessary(VkFence p_in);
-
 	bool InitCamera();
-	bool CreateSyncPremitives();																															
-	void DestroySyncPremitives();
 	bool CreatePasses();
+	bool ApplySceneSettings(const SceneDescription& p_sceneDescription);
+	bool UpdateNonCriticalPipelines();
+	bool IsNonCriticalPipelineReady() const { return m_nonCriticalPipelineState == ncp_Ready; }
+	void LogTimeToFirstFrame();
+	void LogTimeToFullScene();
+	bool ReloadChangedShaders(float p_delta);
 
 	void UpdateCamera(CCamera::UpdateData&);
 	void UpdateSceneGraphDependencies(float p_delta);
 
-	bool DoReadBackObjPickerBuffer(uint32_t p_swapchainIndex, CVulkanRHI::CommandBuffer& p_cmdBfr);
+	bool DoReadBackObjPickerBuffer(CVulkanRHI::CommandBuffer& p_cmdBfr);
 
-	bool BeginAllCommandBuffers(uint32_t p_swapchainIndex);
-	bool EndAllCommandBuffers(uint32_t p_swapchainIndex);
+	// Declares the passes of a frame with the render targets they use. With p_allPasses every optional
+	// pass is declared regardless of its state, which is what the render target aliasing is computed from
+	void BuildRenderGraph(CRenderGraph& p_graph, CVulkanRHI::RendererType p_renderType, bool p_allPasses);
+	void SubmitRecordJob(CThreadPool::JobGroup& p_jobs, uint32_t p_passIdx, const CPass::RenderData& p_renderData);
 
 	bool RenderFrame(CVulkanRHI::RendererType p_renderType);
 };
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+struct AccessInfo
+{
+	VkPipelineStageFlags2		stages;
+	VkAccessFlags2				readAccess;
+	VkAccessFlags2				writeAccess;
+	VkImageLayout				layout;					// VK_IMAGE_LAYOUT_UNDEFINED, the layout the descriptors were written with
+};
+
+static const AccessInfo s_accessInfo[CRenderGraph::Access::ra_max] =
+{
+	// ra_ColorAttachment
+	{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+	  VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,							VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+	// ra_DepthAttachment
+	{ VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+	  VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL },
+	// ra_FragmentRead
+	{ VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+	  VK_ACCESS_2_SHADER_READ_BIT, 0,																		VK_IMAGE_LAYOUT_UNDEFINED },
+	// ra_ComputeRead
+	{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	  VK_ACCESS_2_SHADER_READ_BIT, 0,																		VK_IMAGE_LAYOUT_UNDEFINED },
+	// ra_ComputeWrite
+	{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	  VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,											VK_IMAGE_LAYOUT_UNDEFINED },
+	// ra_TransferRead
+	{ VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	  VK_ACCESS_2_TRANSFER_READ_BIT, 0,																		VK_IMAGE_LAYOUT_UNDEFINED },
+	// ra_TransferWrite
+	{ VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	  VK_ACCESS_2_TRANSFER_READ_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,										VK_IMAGE_LAYOUT_UNDEFINED },
+};
+
+CRenderGraph::CRenderGraph()
+	: CUIParticipant(CUIParticipant::ParticipationType::pt_everyFrame, CUIParticipant::UIDPanelType::uipt_same)
+	, m_renderTargets(nullptr)
+	, m_stats{}
+	, m_declarationError(false)
+{
+	// nothing is in a known layout before the first frame
+	m_resourceStates.resize(CRenderTargets::RenderTargetId::rt_max, ResourceState{ VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0 });
+	m_firstUse.resize(CRenderTargets::RenderTargetId::rt_max, UINT32_MAX);
+	m_lastUse.resize(CRenderTargets::RenderTargetId::rt_max, UINT32_MAX);
+}
+
+CRenderGraph::~CRenderGraph()
+{
+}
+
+void CRenderGraph::Create(const CRenderTargets* p_renderTargets)
+{
+	m_renderTargets = p_renderTargets;
+}
+
+void CRenderGraph::SetMemorySlots(const std::vector<uint32_t>& p_memorySlots)
+{
+	m_memorySlots = p_memorySlots;
+
+	uint32_t slotCount = 0;
+	for (uint32_t slot : m_memorySlots)
+	{
+		if (slot != UINT32_MAX)
+			slotCount = (std::max)(slotCount, slot + 1);
+	}
+	m_slotStates.assign(slotCount, ResourceState{ VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0 });
+}
+
+void CRenderGraph::Reset()
+{
+	m_passes.clear();
+	m_compiledPasses.clear();
+	m_barriers.clear();
+	m_declarationError = false;
+}
+
+uint32_t CRenderGraph::AddPass(const char* p_name, uint32_t p_cmdBfrId, RecordFunc p_record, bool p_hasSideEffects)
+{
+	Pass pass{};
+	pass.name				= p_name;
+	pass.cmdBfrId			= p_cmdBfrId;
+	pass.record				= p_record;
+	pass.hasSideEffects		= p_hasSideEffects;
+	pass.culled				= false;
+	m_passes.push_back(pass);
+
+	return (uint32_t)m_passes.size() - 1;
+}
+
+void CRenderGraph::Read(uint32_t p_passId, uint32_t p_rtId, Access p_access, VkImageLayout p_layout)
+{
+	AddAccess(p_passId, p_rtId, p_access, p_layout, false);
+}
+
+void CRenderGraph::Write(uint32_t p_passId, uint32_t p_rtId, Access p_access, VkImageLayout p_layout)
+{
+	AddAccess(p_passId, p_rtId, p_access, p_layout, true);
+}
+
+void CRenderGraph::AddAccess(uint32_t p_passId, uint32_t p_rtId, Access p_access, VkImageLayout p_layout, bool p_write)
+{
+	const AccessInfo& info	= s_accessInfo[p_access];
+	VkImageLayout layout	= (p_layout != VK_IMAGE_LAYOUT_UNDEFINED) ? p_layout : info.layout;
+
+	ResourceAccess access{};
+	access.rtId				= p_rtId;
+	access.stages			= info.stages;
+	access.readAccess		= p_write ? 0 : info.readAccess;
+	access.writeAccess		= p_write ? info.writeAccess : 0;
+	access.layout			= layout;
+
+	Pass& pass = m_passes[p_passId];
+
+	// a pass using the same render target more than once, like a load and store of an attachment,
+	// needs all of its accesses covered by a single barrier, so they have to agree on the layout
+	for (auto& existing : pass.accesses)
+	{
+		if (existing.rtId != p_rtId)
+			continue;
+
+		if (existing.layout != layout)
+		{
+			std::cerr << "CRenderGraph::AddAccess Error: Pass " << pass.name << " uses render target " << p_rtId << " in two different layouts" << std::endl;
+			m_declarationError = true;
+			return;
+		}
+
+		existing.stages			|= access.stages;
+		existing.readAccess		|= access.readAccess;
+		existing.writeAccess	|= access.writeAccess;
+		return;
+	}
+
+	pass.accesses.push_back(access);
+}
+
+bool CRenderGraph::Compile()
+{
+	if (m_declarationError)
+		return false;
+
+	if (m_renderTargets == nullptr)
+	{
+		std::cerr << "CRenderGraph::Compile Error: Render targets are not set" << std::endl;
+		return false;
+	}
+
+	Cull();
+	ComputeLifetimes();
+	BuildBarriers();
+
+	m_stats.declaredPasses		= (uint32_t)m_passes.size();
+	m_stats.culledPasses		= (uint32_t)(m_passes.size() - m_compiledPasses.size());
+	m_stats.barrierBatches		= 0;
+	for (const auto& pass : m_passes)
+		m_stats.barrierBatches	+= (pass.barrierCount > 0) ? 1 : 0;
+	m_stats.imageBarriers		= (uint32_t)m_barriers.size();
+
+	return true;
+}
+
+// Walks the passes backwards, a pass survives if it has side effects, writes a render target that outlives
+// the frame or writes something a surviving pass later reads
+void CRenderGraph::Cull()
+{
+	std::vector<bool> needed(CRenderTargets::RenderTargetId::rt_max, false);
+
+	for (int32_t i = (int32_t)m_passes.size() - 1; i >= 0; i--)
+	{
+		Pass& pass = m_passes[i];
+
+		bool keep = pass.hasSideEffects;
+		for (const auto& access : pass.accesses)
+		{
+			if (access.writeAccess != 0 && (needed[access.rtId] || !CRenderTargets::IsTransient((CRenderTargets::RenderTargetId)access.rtId)))
+				keep = true;
+		}
+
+		pass.culled = !keep;
+		if (pass.culled)
+			continue;
+
+		// a write without a read replaces the content, earlier writers are not needed for it anymore
+		for (const auto& access : pass.accesses)
+		{
+			if (access.writeAccess != 0 && access.readAccess == 0)
+				needed[access.rtId] = false;
+		}
+		for (const auto& access : pass.accesses)
+		{
+			if (access.readAccess != 0)
+				needed[access.rtId] = true;
+		}
+	}
+}
+
+void CRenderGraph::ComputeLifetimes()
+{
+	m_compiledPasses.clear();
+	std::fill(m_firstUse.begin(), m_firstUse.end(), UINT32_MAX);
+	std::fill(m_lastUse.begin(), m_lastUse.end(), UINT32_MAX);
+
+	for (uint32_t i = 0; i < (uint32_t)m_passes.size(); i++)
+	{
+		if (m_passes[i].culled)
+			continue;
+
+		uint32_t compiledIdx = (uint32_t)m_compiledPasses.size();
+		m_compiledPasses.push_back(i);
+
+		for (const auto& access : m_passes[i].accesses)
+		{
+			if (m_firstUse[access.rtId] == UINT32_MAX)
+				m_firstUse[access.rtId] = compiledIdx;
+			m_lastUse[access.rtId] = compiledIdx;
+		}
+	}
+}
+
+VkImageLayout CRenderGraph::ResolveLayout(const ResourceAccess& p_access) const
+{
+	if (p_access.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		return p_access.layout;
+
+	return m_renderTargets->GetShaderLayout((CRenderTargets::RenderTargetId)p_access.rtId);
+}
+
+void CRenderGraph::AddBarrier(uint32_t p_rtId, VkImageLayout p_oldLayout, VkImageLayout p_newLayout, const ResourceState& p_src, const ResourceAccess& p_dst)
+{
+	const CVulkanRHI::Image renderTarget = m_renderTargets->GetTexture(p_rtId);
+
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType								= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask						= p_src.writeStages | p_src.readStages;
+	barrier.srcAccessMask						= p_src.writeAccess;
+	barrier.dstStageMask						= p_dst.stages;
+	barrier.dstAccessMask						= p_dst.readAccess | p_dst.writeAccess;
+	barrier.oldLayout							= p_oldLayout;
+	barrier.newLayout							= p_newLayout;
+	barrier.srcQueueFamilyIndex					= VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex					= VK_QUEUE_FAMILY_IGNORED;
+	barrier.image								= renderTarget.image;
+	barrier.subresourceRange.aspectMask			= (renderTarget.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel		= 0;
+	barrier.subresourceRange.levelCount			= VK_REMAINING_MIP_LEVELS;
+	barrier.subresourceRange.baseArrayLayer		= 0;
+	barrier.subresourceRange.layerCount			= VK_REMAINING_ARRAY_LAYERS;
+
+	m_barriers.push_back(barrier);
+}
+
+// A write or a layout transition waits on every access since the previous write. A read only waits when the
+// last write is not yet visible to its stage. The first use of a transient render target in a frame discards
+// the content and waits on whatever used its memory last, which may be another render target aliasing it
+void CRenderGraph::BuildBarriers()
+{
+	m_barriers.clear();
+
+	std::vector<bool> usedThisFrame(CRenderTargets::RenderTargetId::rt_max, false);
+	std::vector<uint32_t> slotOwner(m_slotStates.size(), UINT32_MAX);
+
+	for (uint32_t passIdx : m_compiledPasses)
+	{
+		Pass& pass				= m_passes[passIdx];
+		pass.barrierOffset		= (uint32_t)m_barriers.size();
+
+		for (const auto& access : pass.accesses)
+		{
+			uint32_t rtId			= access.rtId;
+			ResourceState& state	= m_resourceStates[rtId];
+			VkImageLayout layout	= ResolveLayout(access);
+
+			bool firstUse			= !usedThisFrame[rtId] && CRenderTargets::IsTransient((CRenderTargets::RenderTargetId)rtId);
+			usedThisFrame[rtId]		= true;
+
+			if (firstUse)
+			{
+				uint32_t slot = m_memorySlots.empty() ? UINT32_MAX : m_memorySlots[rtId];
+				if (slot != UINT32_MAX)
+				{
+					const ResourceState& slotState = (slotOwner[slot] != UINT32_MAX) ? m_resourceStates[slotOwner[slot]] : m_slotStates[slot];
+					AddBarrier(rtId, VK_IMAGE_LAYOUT_UNDEFINED, layout, slotState, access);
+					slotOwner[slot] = rtId;
+				}
+				else
+				{
+					AddBarrier(rtId, VK_IMAGE_LAYOUT_UNDEFINED, layout, state, access);
+				}
+
+				// the transition is a write the accesses of this pass already wait on
+				state = ResourceState{ layout, access.stages, access.writeAccess, access.writeAccess ? 0 : access.stages, access.writeAccess ? 0 : access.readAccess };
+			}
+			else if (access.writeAccess != 0 || layout != state.layout)
+			{
+				AddBarrier(rtId, state.layout, layout, state, access);
+
+				state = ResourceState{ layout, access.stages, access.writeAccess, access.writeAccess ? 0 : access.stages, access.writeAccess ? 0 : access.readAccess };
+			}
+			else if ((state.writeStages != 0) && (((access.stages & ~state.readStages) != 0) || ((access.readAccess & ~state.readAccess) != 0)))
+			{
+				ResourceState src	= state;
+				src.readStages		= 0;
+				AddBarrier(rtId, layout, layout, src, access);
+
+				state.readStages	|= access.stages;
+				state.readAccess	|= access.readAccess;
+			}
+		}
+
+		pass.barrierCount = (uint32_t)m_barriers.size() - pass.barrierOffset;
+	}
+
+	// the next frame's first occupant of a slot waits on its last occupant of this frame
+	for (uint32_t slot = 0; slot < (uint32_t)slotOwner.size(); slot++)
+	{
+		if (slotOwner[slot] != UINT32_MAX)
+			m_slotStates[slot] = m_resourceStates[slotOwner[slot]];
+	}
+}
+
+void CRenderGraph::RecordBarriers(CVulkanRHI* p_rhi, uint32_t p_idx, VkCommandBuffer p_cmdBfr) const
+{
+	const Pass& pass = m_passes[m_compiledPasses[p_idx]];
+	if (pass.barrierCount == 0)
+		return;
+
+	p_rhi->IssuePipelineBarrier2(&m_barriers[pass.barrierOffset], pass.barrierCount, p_cmdBfr);
+}
+
+void CRenderGraph::ComputeAliasing(std::vector<CRenderGraph*>& p_graphs, std::vector<uint32_t>& p_memorySlots)
+{
+	for (auto graph : p_graphs)
+	{
+		graph->Cull();
+		graph->ComputeLifetimes();
+	}
+
+	auto overlaps = [&](uint32_t p_a, uint32_t p_b)
+	{
+		for (const auto graph : p_graphs)
+		{
+			if (graph->m_firstUse[p_a] == UINT32_MAX || graph->m_firstUse[p_b] == UINT32_MAX)
+				continue;
+
+			if (graph->m_firstUse[p_a] <= graph->m_lastUse[p_b] && graph->m_firstUse[p_b] <= graph->m_lastUse[p_a])
+				return true;
+		}
+		return false;
+	};
+
+	p_memorySlots.assign(CRenderTargets::RenderTargetId::rt_max, UINT32_MAX);
+	std::vector<std::vector<uint32_t>> slotMembers;
+
+	for (uint32_t rtId = 0; rtId < CRenderTargets::RenderTargetId::rt_max; rtId++)
+	{
+		if (!CRenderTargets::IsTransient((CRenderTargets::RenderTargetId)rtId))
+			continue;
+
+		uint32_t slot = 0;
+		for (; slot < (uint32_t)slotMembers.size(); slot++)
+		{
+			bool conflict = false;
+			for (uint32_t member : slotMembers[slot])
+				conflict |= overlaps(rtId, member);
+
+			if (!conflict)
+				break;
+		}
+
+		if (slot == (uint32_t)slotMembers.size())
+			slotMembers.push_back(std::vector<uint32_t>{});
+
+		slotMembers[slot].push_back(rtId);
+		p_memorySlots[rtId] = slot;
+	}
+
+	std::clog << "CRenderGraph::ComputeAliasing - " << slotMembers.size() << " memory slots for the transient render targets" << std::endl;
+}
+
+void CRenderGraph::Show(CVulkanRHI* p_rhi)
+{
+	if (Header("Render Graph"))
+	{
+		Text("Passes: %d declared, %d culled", m_stats.declaredPasses, m_stats.culledPasses);
+		Text("Barriers: %d images in %d batches", m_stats.imageBarriers, m_stats.barrierBatches);
+
+		for (const auto& pass : m_passes)
+			Text(pass.culled ? "  %s (culled)" : "  %s", pass.name.c_str());
+	}
+}
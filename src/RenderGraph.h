@@ -0,0 +1,127 @@
+#pragma once
+
+#include "core/VulkanRHI.h"
+#include "core/Asset.h"
+#include "core/UI.h"
+#include "Pass.h"
+
+#include <functional>
+
+// Frame graph over the render targets. Every frame the passes are added in execution order along with the
+// render targets they read and write. Compile() culls passes whose results are never used, tracks the
+// lifetime of every render target and collects all the barriers a pass needs into one batch that is
+// recorded with a single vkCmdPipelineBarrier2 at the start of the pass's command buffer.
+// Transient render targets (see CRenderTargets::IsTransient) whose lifetimes never overlap share memory,
+// the sharing is worked out once by ComputeAliasing() from graphs built with every pass enabled
+class CRenderGraph : public CUIParticipant
+{
+public:
+	enum Access
+	{
+		  ra_ColorAttachment		= 0		// color attachment of a render pass or rendering scope
+		, ra_DepthAttachment		= 1		// depth test and depth write
+		, ra_FragmentRead			= 2		// sampled or storage image read in a fragment shader
+		, ra_ComputeRead			= 3		// sampled or storage image read in a compute shader
+		, ra_ComputeWrite			= 4		// storage image write in a compute shader
+		, ra_TransferRead			= 5
+		, ra_TransferWrite			= 6
+		, ra_max
+	};
+
+	typedef std::function<bool(CPass::RenderData*)> RecordFunc;
+
+	struct Stats
+	{
+		uint32_t					declaredPasses;
+		uint32_t					culledPasses;
+		uint32_t					barrierBatches;			// one vkCmdPipelineBarrier2 per pass that needs any barrier
+		uint32_t					imageBarriers;
+	};
+
+	CRenderGraph();
+	~CRenderGraph();
+
+	// Render targets are only needed once the graph is compiled with barriers
+	void Create(const CRenderTargets* p_renderTargets);
+	void SetMemorySlots(const std::vector<uint32_t>& p_memorySlots);
+
+	// Drops the passes of the previous frame; the state of the render targets carries over
+	void Reset();
+
+	uint32_t AddPass(const char* p_name, uint32_t p_cmdBfrId, RecordFunc p_record, bool p_hasSideEffects = false);
+
+	// p_layout defaults to the attachment's optimal layout for attachments and to the layout the primary
+	// descriptors were written with for shader and transfer accesses. A pass loading an attachment reads and writes it
+	void Read(uint32_t p_passId, uint32_t p_rtId, Access p_access, VkImageLayout p_layout = VK_IMAGE_LAYOUT_UNDEFINED);
+	void Write(uint32_t p_passId, uint32_t p_rtId, Access p_access, VkImageLayout p_layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	bool Compile();
+
+	// Compiled passes, culled ones excluded, in execution order
+	uint32_t GetPassCount() const												{ return (uint32_t)m_compiledPasses.size(); }
+	uint32_t GetCommandBufferId(uint32_t p_idx) const							{ return m_passes[m_compiledPasses[p_idx]].cmdBfrId; }
+	const char* GetPassName(uint32_t p_idx) const								{ return m_passes[m_compiledPasses[p_idx]].name.c_str(); }
+	const RecordFunc& GetRecordFunc(uint32_t p_idx) const						{ return m_passes[m_compiledPasses[p_idx]].record; }
+	void RecordBarriers(CVulkanRHI* p_rhi, uint32_t p_idx, VkCommandBuffer p_cmdBfr) const;
+
+	// Assigns every transient render target a memory slot so that no two render targets sharing a slot
+	// are alive at the same time in any of the graphs. Persistent render targets get UINT32_MAX
+	static void ComputeAliasing(std::vector<CRenderGraph*>& p_graphs, std::vector<uint32_t>& p_memorySlots);
+
+	const Stats& GetStats() const { return m_stats; }
+
+	virtual void Show(CVulkanRHI* p_rhi) override;
+
+private:
+	struct ResourceAccess
+	{
+		uint32_t					rtId;
+		VkPipelineStageFlags2		stages;
+		VkAccessFlags2				readAccess;				// 0 if the pass does not read the render target
+		VkAccessFlags2				writeAccess;			// 0 if the pass does not write the render target
+		VkImageLayout				layout;					// VK_IMAGE_LAYOUT_UNDEFINED resolves to the layout of the descriptors
+	};
+
+	struct Pass
+	{
+		std::string					name;
+		uint32_t					cmdBfrId;
+		RecordFunc					record;
+		bool						hasSideEffects;
+		bool						culled;
+		std::vector<ResourceAccess>	accesses;
+		uint32_t					barrierOffset;
+		uint32_t					barrierCount;
+	};
+
+	// The last write, or layout transition, and the reads since that already see it
+	struct ResourceState
+	{
+		VkImageLayout				layout;
+		VkPipelineStageFlags2		writeStages;
+		VkAccessFlags2				writeAccess;
+		VkPipelineStageFlags2		readStages;
+		VkAccessFlags2				readAccess;
+	};
+
+	const CRenderTargets*			m_renderTargets;
+	std::vector<Pass>				m_passes;
+	std::vector<uint32_t>			m_compiledPasses;
+	std::vector<VkImageMemoryBarrier2> m_barriers;
+
+	std::vector<uint32_t>			m_memorySlots;
+	std::vector<ResourceState>		m_resourceStates;		// carried across frames
+	std::vector<ResourceState>		m_slotStates;			// last accesses of the memory of each slot, carried across frames
+	std::vector<uint32_t>			m_firstUse;				// compiled pass index, UINT32_MAX if unused
+	std::vector<uint32_t>			m_lastUse;
+
+	Stats							m_stats;
+	bool							m_declarationError;
+
+	void AddAccess(uint32_t p_passId, uint32_t p_rtId, Access p_access, VkImageLayout p_layout, bool p_write);
+	void Cull();
+	void ComputeLifetimes();
+	void BuildBarriers();
+	VkImageLayout ResolveLayout(const ResourceAccess& p_access) const;
+	void AddBarrier(uint32_t p_rtId, VkImageLayout p_oldLayout, VkImageLayout p_newLayout, const ResourceState& p_src, const ResourceAccess& p_dst);
+};
@@ -0,0 +1,344 @@
+#include "RenderQueue.h"
+#include "core/Global.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Sort key layout (most significant bits first)
+//	sm_Opaque		: pipeline(8) | material(20) | depth(12) | group(24)
+//	sm_DepthOnly	: pipeline(8) | unused(56)
+// Items are sorted on the key, then mesh, sub-mesh and instance slot, and merged. A group is the merged draws of
+// one sub-mesh; for opaques the group then takes the depth bucket of its nearest draw, so the instances of a
+// sub-mesh spread over the view still merge while the groups are ordered front to back
+#define KEY_PIPELINE(id)		((uint64_t)((id) & 0xFF) << 56)
+#define KEY_MATERIAL(id)		((uint64_t)((id) & 0xFFFFF) << 36)
+#define KEY_DEPTH(q)			((uint64_t)((q) & 0xFFF) << 24)
+#define KEY_GROUP(id)			((uint64_t)((id) & 0xFFFFFF))
+
+// Below this many draws per secondary command buffer the recording is not worth splitting
+#define MIN_DRAWS_PER_SECONDARY		64
+
+CSecondaryCommandBuffers::CSecondaryCommandBuffers()
+{
+}
+
+CSecondaryCommandBuffers::~CSecondaryCommandBuffers()
+{
+}
+
+bool CSecondaryCommandBuffers::Create(CVulkanRHI* p_rhi, uint32_t p_threadCount)
+{
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		m_perThread[i].resize(p_threadCount);
+		for (auto& perThread : m_perThread[i])
+		{
+			perThread.inUse = 0;
+			RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandPool(p_rhi->GetQueueFamiliyIndex(), perThread.cmdPool));
+		}
+	}
+
+	return true;
+}
+
+void CSecondaryCommandBuffers::Destroy(CVulkanRHI* p_rhi)
+{
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		for (auto& perThread : m_perThread[i])
+			p_rhi->DestroyCommandPool(perThread.cmdPool);		// frees its command buffers as well
+
+		m_perThread[i].clear();
+	}
+}
+
+void CSecondaryCommandBuffers::Reset(uint32_t p_frameIdx)
+{
+	// command buffers are reset implicitly when they are begun again
+	for (auto& perThread : m_perThread[p_frameIdx])
+		perThread.inUse = 0;
+}
+
+bool CSecondaryCommandBuffers::Acquire(CVulkanRHI* p_rhi, uint32_t p_frameIdx, uint32_t p_threadId, CVulkanRHI::CommandBuffer& p_cmdBfr)
+{
+	if (p_threadId >= m_perThread[p_frameIdx].size())
+	{
+		std::cerr << "CSecondaryCommandBuffers::Acquire Error: No command pool for thread " << p_threadId << std::endl;
+		return false;
+	}
+
+	PerThread& perThread = m_perThread[p_frameIdx][p_threadId];
+	if (perThread.inUse == perThread.cmdBfrs.size())
+	{
+		std::string debugName = "Secondary F" + std::to_string(p_frameIdx) + " T" + std::to_string(p_threadId) + " #" + std::to_string(perThread.inUse);
+		CVulkanRHI::CommandBuffer cmdBfr = VK_NULL_HANDLE;
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffers(perThread.cmdPool, &cmdBfr, 1, &debugName, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+		perThread.cmdBfrs.push_back(cmdBfr);
+	}
+
+	p_cmdBfr = perThread.cmdBfrs[perThread.inUse++];
+	return true;
+}
+
+CRenderQueue::CRenderQueue()
+	: m_stats()
+{
+}
+
+CRenderQueue::~CRenderQueue()
+{
+}
+
+// Positive IEEE floats sort the same way as their bit patterns, so the top bits are a cheap
+// logarithmic depth bucket: 8 bits of exponent and 3 bits of mantissa (~12% steps)
+uint64_t CRenderQueue::QuantizeDepth(float p_depth)
+{
+	if (!(p_depth > 0.0f))
+		return 0;
+
+	uint32_t bits = 0;
+	std::memcpy(&bits, &p_depth, sizeof(float));
+	return (uint64_t)(bits >> 20);
+}
+
+void CRenderQueue::Build(const CScene* p_scene, uint32_t p_pipelineId, SortMode p_sortMode, const CPerspectiveCamera* p_camera)
+{
+	m_items.clear();
+	m_draws.clear();
+	m_stats = Stats{};
+
+	nm::float3 viewPos = (p_camera != nullptr) ? p_camera->GetLookFrom() : nm::float3();
+	nm::float4x4 viewProj = (p_camera != nullptr) ? p_camera->GetViewProj() : nm::float4x4::identity();
+
+	for (uint32_t i = 0; i < p_scene->GetRenderableMeshCount(); i++)
+	{
+		const CRenderableMesh* mesh = p_scene->GetRenderableMesh(i);
+		nm::Transform meshTransform = mesh->GetTransform();
+		nm::float4x4 entityTransform = meshTransform.GetTransform();
+
+		uint32_t meshDraws = 0;
+		for (uint32_t k = 0; k < mesh->GetSharedMeshCount(); k++)
+		{
+			const SharedMesh* sharedMesh = mesh->GetSharedMesh(k);
+
+			// before the queue every sub-mesh of a shared mesh was one instanced draw
+			meshDraws += sharedMesh->submeshCount;
+
+			for (uint32_t n = 0; n < sharedMesh->instanceCount; n++)
+			{
+				uint32_t instanceId = sharedMesh->firstInstance + n;
+				nm::float4x4 model = entityTransform * mesh->GetMeshInstance(instanceId)->transform;
+
+				// The sub-mesh boxes are in mesh space, the frustum is taken there rather than every box to world space
+				BFrustum frustum(viewProj * model);
+
+				for (uint32_t s = 0; s < sharedMesh->submeshCount; s++)
+				{
+					const BBox& bbox = sharedMesh->submeshesBbox[s];
+					if (p_camera != nullptr && !frustum.isVisiable(bbox))
+					{
+						m_stats.culledItems++;
+						continue;
+					}
+
+					uint32_t submeshId = sharedMesh->firstSubmesh + s;
+					const SubMesh* submesh = mesh->GetSubmesh(submeshId);
+
+					DrawItem item{};
+					item.mesh				= mesh;
+					item.submeshId			= submeshId;
+					item.materialId			= submesh->materialId;
+					item.firstInstanceId	= mesh->GetFirstInstanceId() + instanceId;
+					item.instanceCount		= 1;
+
+					if (p_sortMode == sm_Opaque)
+					{
+						nm::float3 center	= (model * nm::float4((bbox.bbMin + bbox.bbMax) * 0.5f, 1.0f)).xyz();
+						item.depth			= nm::length(center - viewPos);
+						item.sortKey		= KEY_PIPELINE(p_pipelineId) | KEY_MATERIAL(item.materialId);
+					}
+					else
+					{
+						item.sortKey		= KEY_PIPELINE(p_pipelineId);
+					}
+
+					m_items.push_back(item);
+				}
+			}
+		}
+
+		// load order: vertex and index buffer bind per mesh, push constant and draw per sub-mesh
+		m_stats.drawCallsBefore		+= meshDraws;
+		m_stats.stateChangesBefore	+= (meshDraws > 0) ? (2 + meshDraws) : 0;
+	}
+	m_stats.drawItems = (uint32_t)m_items.size();
+
+	std::sort(m_items.begin(), m_items.end(), [](const DrawItem& a, const DrawItem& b)
+		{
+			if (a.sortKey != b.sortKey)
+				return a.sortKey < b.sortKey;
+			if (a.mesh->GetMeshId() != b.mesh->GetMeshId())
+				return a.mesh->GetMeshId() < b.mesh->GetMeshId();
+			if (a.submeshId != b.submeshId)
+				return a.submeshId < b.submeshId;
+			return a.firstInstanceId < b.firstInstanceId;
+		});
+
+	// Merge runs of the same sub-mesh whose instances occupy contiguous slots in the mesh data
+	// buffer; the vertex shaders fetch the instance data at mesh_id + gl_InstanceIndex
+	for (const DrawItem& item : m_items)
+	{
+		if (!m_draws.empty())
+		{
+			DrawItem& last = m_draws.back();
+			if (IsSameGroup(last, item) && last.firstInstanceId + last.instanceCount == item.firstInstanceId)
+			{
+				last.instanceCount += item.instanceCount;
+				last.depth = (std::min)(last.depth, item.depth);
+				continue;
+			}
+		}
+		m_draws.push_back(item);
+	}
+
+	if (p_sortMode != sm_Opaque)
+		return;
+
+	// Every group goes by the depth of its nearest draw, its draws stay together and in instance order
+	uint32_t groupId = 0;
+	for (size_t first = 0, last = 0; first < m_draws.size(); first = last, groupId++)
+	{
+		float nearest = m_draws[first].depth;
+		for (last = first + 1; last < m_draws.size() && IsSameGroup(m_draws[first], m_draws[last]); last++)
+			nearest = (std::min)(nearest, m_draws[last].depth);
+
+		for (size_t i = first; i < last; i++)
+			m_draws[i].sortKey |= KEY_DEPTH(QuantizeDepth(nearest)) | KEY_GROUP(groupId);
+	}
+
+	std::sort(m_draws.begin(), m_draws.end(), [](const DrawItem& a, const DrawItem& b)
+		{
+			return (a.sortKey != b.sortKey) ? (a.sortKey < b.sortKey) : (a.firstInstanceId < b.firstInstanceId);
+		});
+}
+
+bool CRenderQueue::IsSameGroup(const DrawItem& p_a, const DrawItem& p_b)
+{
+	return p_a.mesh == p_b.mesh && p_a.submeshId == p_b.submeshId && p_a.materialId == p_b.materialId;
+}
+
+void CRenderQueue::Draw(CVulkanRHI::CommandBuffer p_cmdBfr, VkPipelineLayout p_pipeLayout, VkShaderStageFlags p_pcStages)
+{
+	m_stats.stateChangesAfter	= DrawRange(p_cmdBfr, p_pipeLayout, p_pcStages, 0, (uint32_t)m_draws.size());
+	m_stats.drawCallsAfter		= (uint32_t)m_draws.size();
+}
+
+uint32_t CRenderQueue::GetSecondaryCount(const CPass::RenderData* p_renderData) const
+{
+	if (p_renderData->threadPool == nullptr || p_renderData->secondaryCmdBfrs == nullptr)
+		return 0;
+
+	uint32_t count = (std::min)(p_renderData->threadPool->GetThreadCount(), (uint32_t)m_draws.size() / MIN_DRAWS_PER_SECONDARY);
+	return (count > 1) ? count : 0;
+}
+
+bool CRenderQueue::UseSecondaries(const CPass::RenderData* p_renderData) const
+{
+	return GetSecondaryCount(p_renderData) > 0;
+}
+
+bool CRenderQueue::DrawSecondaries(CVulkanRHI* p_rhi, const CPass::RenderData* p_renderData, const VkCommandBufferInheritanceInfo& p_inheritance,
+	const BindStateFunc& p_bindState, VkPipelineLayout p_pipeLayout, VkShaderStageFlags p_pcStages)
+{
+	uint32_t secondaryCount = GetSecondaryCount(p_renderData);
+	if (secondaryCount == 0)
+	{
+		std::cerr << "CRenderQueue::DrawSecondaries Error: Too few draws to split into secondary command buffers" << std::endl;
+		return false;
+	}
+
+	uint32_t drawCount = (uint32_t)m_draws.size();
+	uint32_t drawsPerSecondary = (drawCount + secondaryCount - 1) / secondaryCount;
+
+	CVulkanRHI::CommandBufferList secondaries(secondaryCount, VK_NULL_HANDLE);
+	std::vector<uint32_t> stateChanges(secondaryCount, 0);
+
+	CThreadPool::JobGroup recordJobs;
+	for (uint32_t i = 0; i < secondaryCount; i++)
+	{
+		p_renderData->threadPool->Submit(recordJobs, [&, i](uint32_t p_threadId) -> bool
+			{
+				uint32_t first = i * drawsPerSecondary;
+				uint32_t count = (std::min)(drawsPerSecondary, drawCount - first);
+
+				CVulkanRHI::CommandBuffer cmdBfr = VK_NULL_HANDLE;
+				RETURN_FALSE_IF_FALSE(p_renderData->secondaryCmdBfrs->Acquire(p_rhi, p_renderData->frameIdx, p_threadId, cmdBfr));
+				RETURN_FALSE_IF_FALSE(p_rhi->BeginSecondaryCommandBuffer(cmdBfr, p_inheritance, "Render Queue Draws"));
+
+				p_bindState(cmdBfr);
+				stateChanges[i] = DrawRange(cmdBfr, p_pipeLayout, p_pcStages, first, count);
+
+				RETURN_FALSE_IF_FALSE(p_rhi->EndCommandBuffer(cmdBfr));
+				secondaries[i] = cmdBfr;
+				return true;
+			});
+	}
+
+	if (!p_renderData->threadPool->Wait(recordJobs))
+	{
+		std::cerr << "CRenderQueue::DrawSecondaries Error: Failed to record secondary command buffers" << std::endl;
+		return false;
+	}
+
+	// executed in queue order, so the sorted draw order is preserved
+	vkCmdExecuteCommands(p_renderData->cmdBfr, secondaryCount, secondaries.data());
+
+	m_stats.drawCallsAfter		= drawCount;
+	m_stats.stateChangesAfter	= 0;
+	for (uint32_t changes : stateChanges)
+		m_stats.stateChangesAfter += changes;
+
+	return true;
+}
+
+uint32_t CRenderQueue::DrawRange(CVulkanRHI::CommandBuffer p_cmdBfr, VkPipelineLayout p_pipeLayout, VkShaderStageFlags p_pcStages, uint32_t p_first, uint32_t p_count)
+{
+	uint32_t stateChanges = 0;
+
+	VkDeviceSize offsets[1] = { 0 };
+	const CRenderableMesh* boundMesh = nullptr;
+	CScene::MeshPushConst boundPc{ UINT32_MAX, UINT32_MAX };
+
+	for (uint32_t i = p_first; i < p_first + p_count; i++)
+	{
+		const DrawItem& draw = m_draws[i];
+		if (draw.mesh != boundMesh)
+		{
+			VkBuffer vtxBuffer = draw.mesh->GetVertexBuffer().descInfo.buffer;
+			vkCmdBindVertexBuffers(p_cmdBfr, 0, 1, &vtxBuffer, offsets);
+			vkCmdBindIndexBuffer(p_cmdBfr, draw.mesh->GetIndexBuffer().descInfo.buffer, 0, VK_INDEX_TYPE_UINT32);
+			boundMesh = draw.mesh;
+			stateChanges += 2;
+		}
+
+		CScene::MeshPushConst pc{ draw.firstInstanceId, draw.materialId };
+		if (pc.mesh_id != boundPc.mesh_id || pc.material_id != boundPc.material_id)
+		{
+			vkCmdPushConstants(p_cmdBfr, p_pipeLayout, p_pcStages, 0, sizeof(CScene::MeshPushConst), (void*)&pc);
+			boundPc = pc;
+			stateChanges++;
+		}
+
+		const SubMesh* submesh = draw.mesh->GetSubmesh(draw.submeshId);
+		vkCmdDrawIndexed(p_cmdBfr, submesh->indexCount, draw.instanceCount, submesh->firstIndex, 0, 0);
+	}
+
+	return stateChanges;
+}
+
+void CRenderQueue::ShowStats() const
+{
+	ImGui::Text("Draw Items: %u (%u culled)", m_stats.drawItems, m_stats.culledItems);
+	ImGui::Text("Draw Calls: %u -> %u", m_stats.drawCallsBefore, m_stats.drawCallsAfter);
+	ImGui::Text("State Changes: %u -> %u", m_stats.stateChangesBefore, m_stats.stateChangesAfter);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "core/VulkanRHI.h"
+#include "core/Asset.h"
+#include "core/ThreadPool.h"
+#include "Pass.h"
+
+#include <functional>
+
+// Secondary command buffers handed out per frame and per thread of the thread pool. Every thread records
+// from its own command pool, so no locking is needed while recording in parallel
+class CSecondaryCommandBuffers
+{
+public:
+	CSecondaryCommandBuffers();
+	~CSecondaryCommandBuffers();
+
+	bool Create(CVulkanRHI* p_rhi, uint32_t p_threadCount);
+	void Destroy(CVulkanRHI* p_rhi);
+
+	// Command buffers of a frame are recycled once that frame's previous submission is known to be finished
+	void Reset(uint32_t p_frameIdx);
+	bool Acquire(CVulkanRHI* p_rhi, uint32_t p_frameIdx, uint32_t p_threadId, CVulkanRHI::CommandBuffer& p_cmdBfr);
+
+private:
+	struct PerThread
+	{
+		CVulkanRHI::CommandPool			cmdPool;
+		CVulkanRHI::CommandBufferList	cmdBfrs;
+		uint32_t						inUse;
+	};
+
+	std::vector<PerThread>				m_perThread[MAX_FRAMES_IN_FLIGHT];
+};
+
+// Collects the draws of the scene's renderable meshes, sorts them on a 64 bit key and merges
+// consecutive draws of the same sub-mesh into instanced draws. Each raster pass owns one queue,
+// builds it right before recording and then submits it through Draw()
+class CRenderQueue
+{
+public:
+	enum SortMode
+	{
+		  sm_Opaque			= 0			// pipeline, material, sub-meshes front to back by their nearest instance
+		, sm_DepthOnly		= 1			// pipeline, sub-mesh; material and depth do not matter for depth only passes
+	};
+
+	struct DrawItem
+	{
+		uint64_t					sortKey;
+		const CRenderableMesh*		mesh;
+		uint32_t					submeshId;
+		uint32_t					materialId;
+		uint32_t					firstInstanceId;		// slot in the scene's mesh data buffer
+		uint32_t					instanceCount;
+		float						depth;					// of the nearest instance, opaques only
+	};
+
+	struct Stats
+	{
+		uint32_t					drawItems;				// one per instance per sub-mesh in the frustum
+		uint32_t					culledItems;			// outside of it
+		uint32_t					drawCallsBefore;		// draw calls and state changes of one instanced draw per
+		uint32_t					stateChangesBefore;		// sub-mesh of every shared mesh, in load order and unculled
+		uint32_t					drawCallsAfter;			// draw calls and state changes recorded by Draw()
+		uint32_t					stateChangesAfter;
+	};
+
+	CRenderQueue();
+	~CRenderQueue();
+
+	// Secondary command buffers do not inherit any state, so each one calls this before its draws
+	typedef std::function<void(CVulkanRHI::CommandBuffer)> BindStateFunc;
+
+	// Items outside of the camera's frustum are culled; without a camera, as for a light's depth, none are
+	void Build(const CScene* p_scene, uint32_t p_pipelineId, SortMode p_sortMode, const CPerspectiveCamera* p_camera = nullptr);
+	void Draw(CVulkanRHI::CommandBuffer p_cmdBfr, VkPipelineLayout p_pipeLayout, VkShaderStageFlags p_pcStages);
+
+	// Splits the draws into secondary command buffers recorded in parallel on the thread pool and executes them,
+	// in queue order, from p_renderData->cmdBfr. Only valid when UseSecondaries() returned true; the pass or
+	// rendering scope must have been begun with secondary command buffer contents
+	bool UseSecondaries(const CPass::RenderData* p_renderData) const;
+	bool DrawSecondaries(CVulkanRHI* p_rhi, const CPass::RenderData* p_renderData, const VkCommandBufferInheritanceInfo& p_inheritance,
+		const BindStateFunc& p_bindState, VkPipelineLayout p_pipeLayout, VkShaderStageFlags p_pcStages);
+
+	const Stats& GetStats() const { return m_stats; }
+	void ShowStats() const;
+
+private:
+	static uint64_t QuantizeDepth(float p_depth);
+	static bool IsSameGroup(const DrawItem& p_a, const DrawItem& p_b);
+
+	uint32_t GetSecondaryCount(const CPass::RenderData* p_renderData) const;
+	uint32_t DrawRange(CVulkanRHI::CommandBuffer p_cmdBfr, VkPipelineLayout p_pipeLayout, VkShaderStageFlags p_pcStages, uint32_t p_first, uint32_t p_count);
+
+	std::vector<DrawItem>			m_items;
+	std::vector<DrawItem>			m_draws;				// sorted and merged items
+	Stats							m_stats;
+};
@@ -28,7 +28,9 @@ bool CSSRBlurPass::Update(UpdateData*)
 
 bool CSSRBlurPass::Dispatch(RenderData* p_renderData)
 {
-	uint32_t scId = p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx = p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr = p_renderData->cmdBfr;
 	const CPrimaryDescriptors* primaryDesc = p_renderData->primaryDescriptors;
 
@@ -38,14 +40,14 @@ bool CSSRBlurPass::Dispatch(RenderData* p_renderData)
 	m_rhi->InsertMarker(cmdBfr, "Blur SSR Pass 1/2");
 	{
 		vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
 		vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
 	}
 
 	//m_rhi->InsertMarker(cmdBfr, "Blur SSR Pass 2/2");
 	//{
 	//	vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
-	//	vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+	//	vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
 	//	vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
 	//}
 
@@ -113,6 +115,8 @@ bool CSSAOComputePass::CreatePipeline(CVulkanCore::Pipeline p_Pipeline)
 
 bool CSSAOComputePass::Update(UpdateData* p_updateData)
 {
+	PROFILE_FUNCTION();
+
 	p_updateData->uniformData->biasSSAO = m_bias;
 	p_updateData->uniformData->enableSSAO = m_isEnabled;
 	p_updateData->uniformData->ssaoKernelSize = m_kernelSize;
@@ -122,9 +126,19 @@ bool CSSAOComputePass::Update(UpdateData* p_updateData)
 	return true;
 }
 
+void CSSAOComputePass::ApplySettings(const CFixedBuffers::PrimaryUniformData* p_uniformData)
+{
+	m_bias = p_uniformData->biasSSAO;
+	m_isEnabled = (p_uniformData->enableSSAO != 0);
+	m_kernelSize = p_uniformData->ssaoKernelSize;
+	m_kernelRadius = p_uniformData->ssaoRadius;
+}
+
 bool CSSAOComputePass::Dispatch(RenderData* p_renderData)
 {
-	uint32_t scId											= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx										= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr						= p_renderData->cmdBfr;
 	const CPrimaryDescriptors* primaryDesc					= p_renderData->primaryDescriptors;
 	uint32_t dispatchDim_x									= m_rhi->GetRenderWidth() / THREAD_GROUP_SIZE_X;
@@ -133,10 +147,8 @@ bool CSSAOComputePass::Dispatch(RenderData* p_renderData)
 	//RETURN_FALSE_IF_FALSE(m_rhi->BeginCommandBuffer(cmdBfr, "Compute SSAO"));
 	m_rhi->InsertMarker(cmdBfr, "SSAO Compute");
 	{
-		p_renderData->fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, cmdBfr, CRenderTargets::rt_SSAO_Blur);
-
 		vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
 		vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
 	}
 	//RETURN_FALSE_IF_FALSE(m_rhi->EndCommandBuffer(cmdBfr));
@@ -184,7 +196,9 @@ bool CSSAOBlurPass::Update(UpdateData*)
 
 bool CSSAOBlurPass::Dispatch(RenderData* p_renderData)
 {
-	uint32_t scId											= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx										= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr						= p_renderData->cmdBfr;
 	const CPrimaryDescriptors* primaryDesc					= p_renderData->primaryDescriptors;
 
@@ -195,7 +209,7 @@ bool CSSAOBlurPass::Dispatch(RenderData* p_renderData)
 	m_rhi->InsertMarker(cmdBfr, "SSAO Blur Compute");
 	{
 		vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
 		vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
 	}
 	//RETURN_FALSE_IF_FALSE(m_rhi->EndCommandBuffer(cmdBfr));
@@ -229,6 +243,8 @@ bool CSSRComputePass::CreatePipeline(CVulkanCore::Pipeline p_Pipeline)
 
 bool CSSRComputePass::Update(UpdateData* p_updateData)
 {
+	PROFILE_FUNCTION();
+
 	p_updateData->uniformData->ssrEnable		= IsEnabled();
 	p_updateData->uniformData->ssrMaxDistance	= m_maxDistance;
 	p_updateData->uniformData->ssrResolution	= m_resolution;
@@ -238,9 +254,20 @@ bool CSSRComputePass::Update(UpdateData* p_updateData)
 	return true;
 }
 
+void CSSRComputePass::ApplySettings(const CFixedBuffers::PrimaryUniformData* p_uniformData)
+{
+	m_isEnabled		= (p_uniformData->ssrEnable != 0.0f);
+	m_maxDistance	= p_uniformData->ssrMaxDistance;
+	m_resolution	= p_uniformData->ssrResolution;
+	m_thickness		= p_uniformData->ssrThickness;
+	m_steps			= p_uniformData->ssrSteps;
+}
+
 bool CSSRComputePass::Dispatch(RenderData* p_renderData)
 {
-	uint32_t scId = p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx = p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr = p_renderData->cmdBfr;
 	const CPrimaryDescriptors* primaryDesc = p_renderData->primaryDescriptors;
 	const CScene* scene = p_renderData->loadedAssets->GetScene();
@@ -251,11 +278,9 @@ bool CSSRComputePass::Dispatch(RenderData* p_renderData)
 	{
 		m_rhi->InsertMarker(cmdBfr, "SSR Compute");
 		{
-			p_renderData->fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, cmdBfr, CRenderTargets::rt_SSReflection);
-
 			vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, scId), 0, nullptr);
+			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
+			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Scene_Raster, 1, scene->GetDescriptorSet(0, frameIdx), 0, nullptr);
 			vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
 		}
 	}
@@ -308,7 +333,9 @@ bool CCopyComputePass::Update(UpdateData*)
 
 bool CCopyComputePass::Dispatch(RenderData* p_renderData)
 {
-	uint32_t scId = p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx = p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr = p_renderData->cmdBfr;
 	const CPrimaryDescriptors* primaryDesc = p_renderData->primaryDescriptors;
 	uint32_t dispatchDim_x = m_rhi->GetRenderWidth() / THREAD_GROUP_SIZE_X;
@@ -316,10 +343,8 @@ bool CCopyComputePass::Dispatch(RenderData* p_renderData)
 	
 	//RETURN_FALSE_IF_FALSE(m_rhi->BeginCommandBuffer(cmdBfr, "Copy Compute"));
 	{
-		p_renderData->fixedAssets->GetRenderTargets()->IssueLayoutBarrier(m_rhi, VK_IMAGE_LAYOUT_GENERAL, cmdBfr, CRenderTargets::rt_SSReflection);
-
 		vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeline);
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
 		vkCmdDispatch(cmdBfr, dispatchDim_x, dispatchDim_y, 1);
 	}
 	//RETURN_FALSE_IF_FALSE(m_rhi->EndCommandBuffer(cmdBfr));
@@ -24,6 +24,7 @@ public:
 
 	virtual bool Update(UpdateData*) override;
 	virtual bool Dispatch(RenderData*) override;
+	virtual void ApplySettings(const CFixedBuffers::PrimaryUniformData*) override;
 
 	virtual void Show(CVulkanRHI* p_rhi) override;
 
@@ -56,6 +57,7 @@ public:
 
 	virtual bool Update(UpdateData*) override;
 	virtual bool Dispatch(RenderData*) override;
+	virtual void ApplySettings(const CFixedBuffers::PrimaryUniformData*) override;
 
 	virtual void Show(CVulkanRHI* p_rhi) override;
 
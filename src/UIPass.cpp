@@ -4,7 +4,6 @@
 CUIPass::CUIPass(CVulkanRHI* p_rhi)
 	: CStaticRenderPass(p_rhi)
 {
-	m_frameBuffer.resize(FRAME_BUFFER_COUNT);
 }
 
 CUIPass::~CUIPass()
@@ -23,13 +22,15 @@ bool CUIPass::CreateRenderpass(RenderData* p_renderData)
 	renderpass->framebufferWidth				= m_rhi->GetRenderWidth();
 	renderpass->framebufferHeight				= m_rhi->GetRenderHeight();
 	std::vector<VkImageView> attachments(1, VkImageView{});
-	attachments[0]								= m_rhi->GetSCImageView(0);
-	if (!m_rhi->CreateFramebuffer(renderpass->renderpass, m_frameBuffer[0], attachments.data(), (uint32_t)attachments.size(), renderpass->framebufferWidth, renderpass->framebufferHeight))
-		return false;
 
-	attachments[0]								= m_rhi->GetSCImageView(1);
-	if (!m_rhi->CreateFramebuffer(renderpass->renderpass, m_frameBuffer[1], attachments.data(), (uint32_t)attachments.size(), renderpass->framebufferWidth, renderpass->framebufferHeight))
-		return false;
+	// one frame buffer per swapchain image
+	m_frameBuffer.resize(m_rhi->GetSwapchainImageCount());
+	for (uint32_t i = 0; i < (uint32_t)m_frameBuffer.size(); i++)
+	{
+		attachments[0]							= m_rhi->GetSCImageView(i);
+		if (!m_rhi->CreateFramebuffer(renderpass->renderpass, m_frameBuffer[i], attachments.data(), (uint32_t)attachments.size(), renderpass->framebufferWidth, renderpass->framebufferHeight))
+			return false;
+	}
 
 	return true;
 }
@@ -99,13 +100,15 @@ bool CUIPass::Update(UpdateData* p_updateData)
 
 bool CUIPass::Render(RenderData* p_renderData)
 {
-	uint32_t scId								= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx							= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr			= p_renderData->cmdBfr;
 	CVulkanRHI::Renderpass renderPass			= m_pipeline.renderpassData;
 	const CRenderableUI* ui						= p_renderData->loadedAssets->GetUI();
 	const CPrimaryDescriptors* primaryDesc		= p_renderData->primaryDescriptors;
 	
-	const_cast<CRenderableUI*>(ui)->PreDraw(m_rhi, p_renderData->scIdx);
+	const_cast<CRenderableUI*>(ui)->PreDraw(m_rhi, p_renderData->frameIdx);
 
 	ImDrawData* drawData						= ImGui::GetDrawData();
 	int fbWidth									= (int)(drawData->DisplaySize.x * drawData->FramebufferScale.x);
@@ -127,13 +130,13 @@ bool CUIPass::Render(RenderData* p_renderData)
 		// Bind Vertex And Index Buffer:
 		if (drawData->TotalVtxCount > 0)
 		{
-			VkBuffer vrtxBfrs[1] = { ui->GetVertexBuffer(p_renderData->scIdx).descInfo.buffer };
+			VkBuffer vrtxBfrs[1] = { ui->GetVertexBuffer(p_renderData->frameIdx).descInfo.buffer };
 			VkDeviceSize vrtxOffset[1] = { 0 };
 			vkCmdBindVertexBuffers(cmdBfr, 0, 1, vrtxBfrs, vrtxOffset);
-			vkCmdBindIndexBuffer(cmdBfr, ui->GetIndexBuffer(p_renderData->scIdx).descInfo.buffer, 0, sizeof(ImDrawIdx) == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(cmdBfr, ui->GetIndexBuffer(p_renderData->frameIdx).descInfo.buffer, 0, sizeof(ImDrawIdx) == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
 		}
 
-		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
 		vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_UI, 1, ui->GetDescriptorSet(), 0, nullptr);
 
 		// Will project scissor/clipping rectangles into frame buffer space
@@ -286,14 +289,16 @@ bool CDebugDrawPass::Update(UpdateData*)
 
 bool CDebugDrawPass::Render(RenderData* p_renderData)
 {
-	uint32_t scId												= p_renderData->scIdx;
+	PROFILE_FUNCTION();
+
+	uint32_t frameIdx											= p_renderData->frameIdx;
 	CVulkanRHI::CommandBuffer cmdBfr							= p_renderData->cmdBfr;
 	CVulkanRHI::Renderpass renderPass							= m_pipeline.renderpassData;
 	CRenderableDebug* debugRender								= p_renderData->fixedAssets->GetDebugRenderer();
 	const CPrimaryDescriptors* primaryDesc						= p_renderData->primaryDescriptors;
 
 	// instanced indexed draw
-	RETURN_FALSE_IF_FALSE(debugRender->PreDrawInstanced(m_rhi, scId, p_renderData->fixedAssets->GetFixedBuffers(), p_renderData->sceneGraph, cmdBfr));
+	RETURN_FALSE_IF_FALSE(debugRender->PreDrawInstanced(m_rhi, frameIdx, p_renderData->fixedAssets->GetFixedBuffers(), p_renderData->sceneGraph, cmdBfr));
 	
 	//RETURN_FALSE_IF_FALSE(m_rhi->BeginCommandBuffer(cmdBfr, "Debug Draw Instanced"));
 	{
@@ -304,7 +309,7 @@ bool CDebugDrawPass::Render(RenderData* p_renderData)
 			m_rhi->SetScissors(cmdBfr, 0, 0, renderPass.framebufferWidth, renderPass.framebufferHeight);
 
 			vkCmdBindPipeline(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeline);
-			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(scId), 0, nullptr);
+			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_Primary, 1, primaryDesc->GetDescriptorSet(frameIdx), 0, nullptr);
 			vkCmdBindDescriptorSets(cmdBfr, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.pipeLayout, BindingSet::bs_DebugDisplay, 1, debugRender->GetDescriptorSet(), 0, nullptr);
 
 			VkDeviceSize offsets[1] = { 0 };
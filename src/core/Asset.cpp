@@ -1,8 +1,13 @@
 #include "Asset.h"
 #include "SceneGraph.h"
 #include "RandGen.h"
+#include "EnvironmentBaker.h"
+#include "Profiler.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <set>
 #include <thread>
 
 #include "external/imgui/imgui.h"
@@ -183,6 +188,28 @@ void C2DDescriptor::BindlessWrite(uint32_t p_setId, uint32_t p_index, const VkAc
 	}
 }
 
+void C2DDescriptor::BindlessWritePerCopy(uint32_t p_setId, uint32_t p_index, const VkDescriptorBufferInfo* const* p_bufferInfoPerCopy)
+{
+	if (p_setId >= m_descList2D.size())
+	{
+		std::cerr << "Attempting to Bindless Write a descriptor with a bad local set index" << std::endl;
+		return;
+	}
+
+
+	if (p_index >= m_descList2D[p_setId][0].descDataList.size())
+	{
+		std::cerr << "Attempting to Bindless Write a descriptor with a bad binding index" << std::endl;
+		return;
+	}
+
+	for (int i = 0; i < m_descList2D[p_setId].size(); i++)
+	{
+		m_descList2D[p_setId][i].descDataList[p_index].count = 1;
+		m_descList2D[p_setId][i].descDataList[p_index].bufDesInfo = p_bufferInfoPerCopy[i];
+	}
+}
+
 void C2DDescriptor::BindlessUpdate(CVulkanRHI* p_rhi, uint32_t p_setId)
 {
 	if (p_setId >= m_descList2D.size())
@@ -237,6 +264,136 @@ void C2DDescriptor::Destroy(CVulkanRHI* p_rhi)
 	m_descList2D.clear();
 }
 
+CBindlessTextureTable::CBindlessTextureTable()
+	: m_appliedCount{}
+	, m_descLayout(VK_NULL_HANDLE)
+	, m_binding(0)
+	, m_capacity(0)
+{
+}
+
+bool CBindlessTextureTable::Create(CVulkanRHI* p_rhi, VkDescriptorSetLayout p_descLayout, uint32_t p_binding, uint32_t p_capacity)
+{
+	if (p_capacity == 0)
+	{
+		std::cerr << "CBindlessTextureTable::Create Error: The device allows no bindless textures" << std::endl;
+		return false;
+	}
+
+	m_descLayout = p_descLayout;
+	m_binding = p_binding;
+	m_capacity = p_capacity;
+	m_chunkTemplates.assign((m_capacity + BINDLESS_WRITE_CHUNK - 1) / BINDLESS_WRITE_CHUNK, VK_NULL_HANDLE);
+	m_imageInfos.reserve(BINDLESS_WRITE_CHUNK);
+
+	return true;
+}
+
+void CBindlessTextureTable::Destroy(CVulkanRHI* p_rhi)
+{
+	for (auto& chunkTemplate : m_chunkTemplates)
+	{
+		if (chunkTemplate != VK_NULL_HANDLE)
+			p_rhi->DestroyDescriptorUpdateTemplate(chunkTemplate);
+	}
+	m_chunkTemplates.clear();
+	m_imageInfos.clear();
+	for (auto& updatedSlots : m_updatedSlots)
+		updatedSlots.clear();
+}
+
+bool CBindlessTextureTable::Stage(const VkDescriptorImageInfo* p_imageInfos, uint32_t p_count)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_imageInfos.size() + p_count > m_capacity)
+	{
+		std::cerr << "CBindlessTextureTable::Stage Error: " << m_imageInfos.size() + p_count << " textures exceed the " << m_capacity << " bindless slots" << std::endl;
+		return false;
+	}
+
+	m_imageInfos.insert(m_imageInfos.end(), p_imageInfos, p_imageInfos + p_count);
+	return true;
+}
+
+uint32_t CBindlessTextureTable::GetStagedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (uint32_t)m_imageInfos.size();
+}
+
+bool CBindlessTextureTable::Update(uint32_t p_slot, const VkDescriptorImageInfo& p_imageInfo)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (p_slot >= m_imageInfos.size())
+	{
+		std::cerr << "CBindlessTextureTable::Update Error: Slot " << p_slot << " is not staged" << std::endl;
+		return false;
+	}
+
+	m_imageInfos[p_slot] = p_imageInfo;
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (p_slot < m_appliedCount[i])
+			m_updatedSlots[i].push_back(p_slot);
+	}
+	return true;
+}
+
+bool CBindlessTextureTable::Apply(CVulkanRHI* p_rhi, VkDescriptorSet p_descSet, uint32_t p_copyId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint32_t stagedCount = (uint32_t)m_imageInfos.size();
+	if (m_appliedCount[p_copyId] == stagedCount && m_updatedSlots[p_copyId].empty())
+		return true;
+
+	PROFILE_FUNCTION();
+
+	// Chunks holding updated slots are written again whole, along with the chunks of the new slots
+	std::vector<uint32_t> chunks;
+	for (uint32_t slot : m_updatedSlots[p_copyId])
+		chunks.push_back(slot / BINDLESS_WRITE_CHUNK);
+	if (m_appliedCount[p_copyId] < stagedCount)
+	{
+		for (uint32_t chunk = m_appliedCount[p_copyId] / BINDLESS_WRITE_CHUNK; chunk <= (stagedCount - 1) / BINDLESS_WRITE_CHUNK; chunk++)
+			chunks.push_back(chunk);
+	}
+	std::sort(chunks.begin(), chunks.end());
+	chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+
+	// Templates write whole chunks. The slots of the last chunk past the staged ones get its first slot; shaders
+	// never index them and they are written again once staged
+	VkDescriptorImageInfo chunkInfos[BINDLESS_WRITE_CHUNK];
+	for (uint32_t chunk : chunks)
+	{
+		uint32_t firstSlot = chunk * BINDLESS_WRITE_CHUNK;
+		uint32_t chunkSize = (std::min)((uint32_t)BINDLESS_WRITE_CHUNK, m_capacity - firstSlot);
+
+		if (m_chunkTemplates[chunk] == VK_NULL_HANDLE)
+		{
+			VkDescriptorUpdateTemplateEntry entry{};
+			entry.dstBinding		= m_binding;
+			entry.dstArrayElement	= firstSlot;
+			entry.descriptorCount	= chunkSize;
+			entry.descriptorType	= VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			entry.offset			= 0;
+			entry.stride			= sizeof(VkDescriptorImageInfo);
+			RETURN_FALSE_IF_FALSE(p_rhi->CreateDescriptorUpdateTemplate(&entry, 1, m_descLayout, m_chunkTemplates[chunk]));
+		}
+
+		for (uint32_t i = 0; i < chunkSize; i++)
+			chunkInfos[i] = (firstSlot + i < stagedCount) ? m_imageInfos[firstSlot + i] : m_imageInfos[firstSlot];
+
+		p_rhi->UpdateDescriptorSetWithTemplate(p_descSet, m_chunkTemplates[chunk], chunkInfos);
+	}
+
+	m_appliedCount[p_copyId] = stagedCount;
+	m_updatedSlots[p_copyId].clear();
+	return true;
+}
+
 CRenderable::CRenderable(VkMemoryPropertyFlags p_memPropFlags, uint32_t p_BufferCount)
 	: m_vertexBuffers(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, p_memPropFlags, p_BufferCount)
 	, m_indexBuffers(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, p_memPropFlags, p_BufferCount)
@@ -446,52 +603,69 @@ CTextures::CTextures(int p_maxSize)
 }
 
 bool CTextures::CreateRenderTarget(CVulkanRHI* p_rhi, uint32_t p_id, VkFormat p_format, uint32_t p_width, uint32_t p_height, 
-	uint32_t p_mipLevel, VkImageLayout p_layout, std::string p_debugName, VkImageUsageFlags p_usage)
+	uint32_t p_mipLevel, VkImageLayout p_layout, std::string p_debugName, VkImageUsageFlags p_usage, bool p_bindMemory)
 {
 	CVulkanRHI::Image renderTarget;
-	RETURN_FALSE_IF_FALSE(p_rhi->CreateRenderTarget(p_format, p_width, p_height, p_mipLevel, p_layout, p_usage, renderTarget, p_debugName));
+	renderTarget.devMem = VK_NULL_HANDLE;
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateRenderTarget(p_format, p_width, p_height, p_mipLevel, p_layout, p_usage, renderTarget, p_debugName, p_bindMemory));
 
 	m_textures[p_id] = renderTarget;
 
 	return true;
 }
 
-bool CTextures::CreateTexture(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& p_stg, const ImageRaw* p_rawImg, VkFormat p_format, 
-							  CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, int p_id)
+static VkFormat GetBlockFormat(TextureEncoding p_encoding)
 {
-	std::clog << "Creating GPU Texture Buffer for " << p_debugName << std::endl;
-
-	if (p_rawImg->raw != nullptr)
+	switch (p_encoding)
 	{
-		CVulkanRHI::Image img;
-
-		size_t texSize = p_rawImg->width * p_rawImg->height * p_rawImg->channels;
+	case TextureEncoding::te_bc1:	return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case TextureEncoding::te_bc4:	return VK_FORMAT_BC4_UNORM_BLOCK;
+	case TextureEncoding::te_bc5:	return VK_FORMAT_BC5_UNORM_BLOCK;
+	case TextureEncoding::te_bc7:	return VK_FORMAT_BC7_UNORM_BLOCK;
+	default:						return VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
 
-		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(texSize, p_stg, 
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, p_debugName + "_transfer"));
+// "0rg1" reads zero for r, the stored r for g, the stored g for b and one for a
+static VkComponentMapping GetSwizzle(const std::string& p_swizzle)
+{
+	VkComponentSwizzle components[4] = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+	for (size_t i = 0; i < 4 && i < p_swizzle.size(); i++)
+	{
+		switch (p_swizzle[i])
+		{
+		case 'r': components[i] = VK_COMPONENT_SWIZZLE_R; break;
+		case 'g': components[i] = VK_COMPONENT_SWIZZLE_G; break;
+		case 'b': components[i] = VK_COMPONENT_SWIZZLE_B; break;
+		case 'a': components[i] = VK_COMPONENT_SWIZZLE_A; break;
+		case '0': components[i] = VK_COMPONENT_SWIZZLE_ZERO; break;
+		case '1': components[i] = VK_COMPONENT_SWIZZLE_ONE; break;
+		}
+	}
+	return VkComponentMapping{ components[0], components[1], components[2], components[3] };
+}
 
-		RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer((uint8_t*)p_rawImg->raw, p_stg));
+// Basis Universal textures the compressor could not transcode, and block compressed ones on a device without
+// BC support, are replaced by the default texture
+static bool CanUploadTexture(CVulkanRHI* p_rhi, const ImageRaw& p_rawImg)
+{
+	if (p_rawImg.raw == nullptr || p_rawImg.encoding == TextureEncoding::te_basis || p_rawImg.encoding == TextureEncoding::te_file)
+		return false;
 
-		img.format = p_format;//VK_FORMAT_R8G8B8A8_UNORM;
-		img.width = p_rawImg->width;
-		img.height = p_rawImg->height;
-		img.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		img.SetLevelCount(p_rawImg->mipLevels);
+	return p_rawImg.encoding == TextureEncoding::te_rgba8 || p_rhi->IsTextureCompressionBCEnabled();
+}
 
-		VkImageCreateInfo imgCrtInfo = CVulkanCore::ImageCreateInfo();
-		imgCrtInfo.extent.width = p_rawImg->width;
-		imgCrtInfo.extent.height = p_rawImg->height;
-		imgCrtInfo.format = img.format;
-		imgCrtInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-		imgCrtInfo.mipLevels = p_rawImg->mipLevels;
+bool CTextures::CreateTexture(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& p_stg, const ImageRaw* p_rawImg, VkFormat p_format, 
+							  CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, int p_id, uint32_t p_firstMip)
+{
+	PROFILE_FUNCTION();
 
-		// If the mip count is more than 1, we will use the texture
-		// to read from and write to when generating the mip chain
-		// Hence the usage needs to be both Source and Destination
-		if (imgCrtInfo.mipLevels > 1)
-			imgCrtInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	std::clog << "Creating GPU Texture Buffer for " << p_debugName << std::endl;
 
-		RETURN_FALSE_IF_FALSE(p_rhi->CreateTexture(p_stg, img, imgCrtInfo, p_cmdBfr, p_debugName))
+	if (p_rawImg->raw != nullptr)
+	{
+		CVulkanRHI::Image img;
+		RETURN_FALSE_IF_FALSE(CreateTextureImage(p_rhi, p_stg, p_rawImg, p_format, p_cmdBfr, p_debugName, p_firstMip, img));
 
 		// Doing this because; if the id is set to -1, then the intent is to grow the image list at runtime and not a fixed size
 		if (p_id == -1)
@@ -509,9 +683,75 @@ bool CTextures::CreateTexture(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& p_stg, cons
 	return false;
 }
 
+bool CTextures::CreateTextureImage(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& p_stg, const ImageRaw* p_rawImg, VkFormat p_format,
+	CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, uint32_t p_firstMip, CVulkanRHI::Image& p_img)
+{
+	size_t texSize = p_rawImg->width * p_rawImg->height * p_rawImg->channels;
+
+	// Block compressed textures come with their mip chain, p_format only applies to uncompressed ones.
+	// Uncompressed ones may come with theirs too, as KTX2 files do
+	bool compressed = (p_rawImg->encoding != TextureEncoding::te_rgba8);
+	bool mipsProvided = compressed || p_rawImg->dataSize > 0;
+	if (mipsProvided)
+		texSize = p_rawImg->dataSize;
+
+	if (compressed)
+	{
+		p_format = GetBlockFormat(p_rawImg->encoding);
+		p_img.swizzle = GetSwizzle(p_rawImg->swizzle);
+	}
+
+	// The mips are stored largest first, the chain from p_firstMip on is the tail of raw
+	uint32_t width = p_rawImg->width;
+	uint32_t height = p_rawImg->height;
+	size_t offset = 0;
+	if (p_firstMip > 0)
+	{
+		if (!mipsProvided || p_firstMip >= p_rawImg->mipLevels)
+		{
+			std::cerr << "CTextures::CreateTextureImage Error: Mip " << p_firstMip << " is not provided - " << p_debugName << std::endl;
+			return false;
+		}
+
+		offset = CVulkanRHI::Image::GetTextureSizePerLayer(width, height, p_format, p_firstMip, nullptr);
+		texSize -= offset;
+		width = (std::max)(width >> p_firstMip, 1u);
+		height = (std::max)(height >> p_firstMip, 1u);
+	}
+
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(texSize, p_stg, 
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, p_debugName + "_transfer"));
+
+	RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer((uint8_t*)p_rawImg->raw + offset, p_stg));
+
+	p_img.format = p_format;//VK_FORMAT_R8G8B8A8_UNORM;
+	p_img.width = width;
+	p_img.height = height;
+	p_img.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	p_img.SetLevelCount(p_rawImg->mipLevels - p_firstMip);
+
+	VkImageCreateInfo imgCrtInfo = CVulkanCore::ImageCreateInfo();
+	imgCrtInfo.extent.width = width;
+	imgCrtInfo.extent.height = height;
+	imgCrtInfo.format = p_img.format;
+	imgCrtInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imgCrtInfo.mipLevels = p_img.GetLevelCount();
+
+	// If the mip count is more than 1, we will use the texture
+	// to read from and write to when generating the mip chain
+	// Hence the usage needs to be both Source and Destination
+	if (imgCrtInfo.mipLevels > 1 && !mipsProvided)
+		imgCrtInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateTexture(p_stg, p_img, imgCrtInfo, p_cmdBfr, p_debugName, !mipsProvided /* mips are blit unless provided in staging */))
+
+	return true;
+}
+
 bool CTextures::CreateCubemap(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& p_stg, ImageRaw& cubeMapRaw, const CVulkanRHI::SamplerList& p_samplers, CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, int p_id)
 {
-	VkFormat cubeMapFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+	// the DDS cube maps are RGBA16F, the baked ones RGB9E5
+	VkFormat cubeMapFormat = (cubeMapRaw.encoding == TextureEncoding::te_rgb9e5) ? VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 : VK_FORMAT_R16G16B16A16_SFLOAT;
 
 	size_t cubeMapSize = CVulkanRHI::Image::GetTextureSizePerLayer(cubeMapRaw.width, cubeMapRaw.height, cubeMapFormat,
 		cubeMapRaw.mipLevels, nullptr);
@@ -578,20 +818,30 @@ void CTextures::PushBackPreLoadedTexture(uint32_t p_texIndex)
 	m_textures.push_back(m_textures[p_texIndex]);
 }
 
+CVulkanRHI::Image CTextures::ReplaceTexture(uint32_t p_id, const CVulkanRHI::Image& p_image)
+{
+	CVulkanRHI::Image replaced = m_textures[p_id];
+	m_textures[p_id] = p_image;
+	return replaced;
+}
+
+void CTextures::DestroyTextureImage(CVulkanRHI* p_rhi, CVulkanRHI::Image& p_img)
+{
+	p_rhi->DestroyImage(p_img.image);
+	p_rhi->DestroyImageView(p_img.descInfo.imageView);
+	p_rhi->FreeDeviceMemory(p_img.devMem);
+}
+
 void CTextures::Destroy(CVulkanRHI* p_rhi)
 {
 	for (auto& tex : m_textures)
-	{
-		p_rhi->DestroyImage(tex.image);
-		p_rhi->DestroyImageView(tex.descInfo.imageView);
-		p_rhi->FreeDeviceMemory(tex.devMem);
-	}
+		DestroyTextureImage(p_rhi, tex);
 	m_textures.clear();
 }
 
 uint32_t CRenderableUI::fontID;
 CRenderableUI::CRenderableUI()
-	: CRenderable(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, FRAME_BUFFER_COUNT)
+	: CRenderable(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MAX_FRAMES_IN_FLIGHT)
 	, CUIParticipant(CUIParticipant::ParticipationType::pt_everyFrame, CUIParticipant::UIDPanelType::uipt_new, "VFrame Interface")
 	, CSelectionListener()
 	, m_showImguiDemo(false)
@@ -649,7 +899,7 @@ void CRenderableUI::Show(CVulkanRHI* p_rhi)
 				refresh_time += 1.0f / 60.0f;
 			}
 			char overlay[32];
-			sprintf_s(overlay, "avg %f", m_latestFPS.Average());
+			snprintf(overlay, sizeof(overlay), "avg %f", m_latestFPS.Average());
 			ImGui::PlotLines("CPU (ms)", data.data(), (int)data.size(), values_offset, overlay, 0.0f, 32.0f, ImVec2(0, 60.0f));
 		}
 	}
@@ -855,7 +1105,7 @@ bool CRenderableUI::ShowUI(CVulkanRHI* p_rhi)
 	return true;
 }
 
-bool CRenderableUI::PreDraw(CVulkanRHI* p_rhi, uint32_t p_scIdx)
+bool CRenderableUI::PreDraw(CVulkanRHI* p_rhi, uint32_t p_frameIdx)
 {
 	ImGui::Render();
 	ImDrawData* drawData					= ImGui::GetDrawData();
@@ -878,9 +1128,9 @@ bool CRenderableUI::PreDraw(CVulkanRHI* p_rhi, uint32_t p_scIdx)
 			data.indexBufferSize = drawData->TotalIdxCount * sizeof(ImDrawIdx);
 
 			// if the vertex buffer if already created from previous frame, destroy them and free the associated memory for this frame's use
-			if (m_vertexBuffers.GetBuffer(p_scIdx).descInfo.buffer != VK_NULL_HANDLE)
+			if (m_vertexBuffers.GetBuffer(p_frameIdx).descInfo.buffer != VK_NULL_HANDLE)
 			{
-				Clear(p_rhi, p_scIdx);
+				Clear(p_rhi, p_frameIdx);
 			}
 
 			// Creating vertex and index buffers and upload all data to single continuous GPU buffers respectively
@@ -896,7 +1146,7 @@ bool CRenderableUI::PreDraw(CVulkanRHI* p_rhi, uint32_t p_scIdx)
 
 				data.vertexBufferData = vertexMemIdx.data();
 				data.indexBufferData = indexMemIdx.data();
-				RETURN_FALSE_IF_FALSE(CreateVertexIndexBuffer(p_rhi, data, "imgui", p_scIdx));
+				RETURN_FALSE_IF_FALSE(CreateVertexIndexBuffer(p_rhi, data, "imgui", p_frameIdx));
 			}
 		}
 	}
@@ -904,10 +1154,11 @@ bool CRenderableUI::PreDraw(CVulkanRHI* p_rhi, uint32_t p_scIdx)
 	return true;
 }
 
-CRenderableMesh::CRenderableMesh(std::string p_name, uint32_t p_meshId, nm::Transform p_modelMat, VkBufferUsageFlags p_usage)
+CRenderableMesh::CRenderableMesh(std::string p_name, uint32_t p_meshId, uint32_t p_firstInstanceId, nm::Transform p_modelMat, VkBufferUsageFlags p_usage)
 	: CEntity(p_name)
 	, CRenderable(p_usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0)
 	, m_mesh_id(p_meshId)
+	, m_firstInstanceId(p_firstInstanceId)
 	, m_selectedSubMeshId(-1)
 {
 	CEntity::m_transform = p_modelMat;
@@ -923,6 +1174,8 @@ void CRenderableMesh::Destroy(CVulkanRHI* p_rhi)
 {
 	m_submeshes.clear();
 	m_subBoundingBoxes.clear();
+	m_sharedMeshes.clear();
+	m_instances.clear();
 	CRenderable::Destroy(p_rhi);
 }
 
@@ -984,11 +1237,19 @@ CScene::CScene(CSceneGraph* p_sceneGraph)
 	: CUIParticipant(CUIParticipant::ParticipationType::pt_everyFrame, CUIParticipant::UIDPanelType::uipt_new, "Scene")
 	, C2DDescriptor(CVulkanRHI::DescriptorBindFlag::Variable_Count | CVulkanRHI::DescriptorBindFlag::Bindless, 2) // requesting for 2 descriptor sets (raster and ray-tracing resource sets)
 	, m_sceneGraph(p_sceneGraph)
+	, m_meshInstanceCount(0)
+	, m_loaderPool(nullptr)
+	, m_cancelLoading(false)
+	, m_environmentStreamed(false)
+	, m_streamedEnvironment{}
+	, m_committedAssets(0)
+	, m_environmentCommitted(false)
+	, m_loaded(false)
 {
 	m_sceneTextures = new CTextures();
 	m_sceneLights = new CLights();
 	m_materialsList.reserve(MAX_SUPPORTED_MATERIALS);
-	m_accStructInstances.resize(MAX_SUPPORTED_MESHES, VkAccelerationStructureInstanceKHR{});
+	m_accStructInstances.resize(MAX_SUPPORTED_MESH_INSTANCES, VkAccelerationStructureInstanceKHR{});
 }
 
 CScene::~CScene()
@@ -997,7 +1258,7 @@ CScene::~CScene()
 	delete m_sceneTextures;
 }
 
-bool CScene::Create(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, const CVulkanRHI::CommandPool& p_cmdPool)
+bool CScene::Create(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, const CVulkanRHI::CommandPool& p_cmdPool, const SceneDescription& p_sceneDescription)
 {
 	m_cmdPool = p_cmdPool;
 	RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandPool(p_rhi->GetQueueFamiliyIndex(), m_assetLoaderCommandPool));
@@ -1005,7 +1266,35 @@ bool CScene::Create(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerL
 	CVulkanRHI::CommandBuffer cmdBfr;
 	CVulkanRHI::BufferList stgList;
 
-	std::string debugMarker = "Default Resources/Scene Loading";
+	if (p_rhi->IsTextureCompressionBCEnabled())
+	{
+		CTextureCompressor::Settings compressorSettings{};
+		compressorSettings.cacheDir = g_EnginePath / "cache/textures";
+		RETURN_FALSE_IF_FALSE(m_textureCompressor.Create(compressorSettings));
+	}
+
+	{
+		CTextureIngester::Settings ingesterSettings{};
+		ingesterSettings.budget = (size_t)TEXTURE_INGEST_BUDGET_MB * 1024 * 1024;
+		RETURN_FALSE_IF_FALSE(m_textureIngester.Create(ingesterSettings));
+	}
+
+	RETURN_FALSE_IF_FALSE(m_meshDecoder.Create(CMeshDecoder::Settings{}));
+
+#if TEXTURE_STREAMING
+	{
+		CTextureStreamer::Settings streamerSettings{};
+		streamerSettings.budget = (VkDeviceSize)TEXTURE_STREAMING_BUDGET_MB * 1024 * 1024;
+		streamerSettings.tailSize = TEXTURE_STREAMING_TAIL_SIZE;
+		streamerSettings.uploadBytesPerFrame = (VkDeviceSize)TEXTURE_STREAMING_UPLOAD_MB_PER_FRAME * 1024 * 1024;
+		streamerSettings.mipBias = 0.0f;
+		RETURN_FALSE_IF_FALSE(m_textureStreamer.Create(p_rhi, streamerSettings));
+	}
+#endif
+
+	// What the first frame draws: the placeholder textures, the skybox and the lights. The environment and the assets
+	// of the description stream in after it, see StartStreaming
+	std::string debugMarker = "Default Resources Loading";
 	{
 		RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffer(p_cmdPool, &cmdBfr, debugMarker));
 		if (!LoadDefaultTextures(p_rhi, p_samplerList, stgList, cmdBfr))
@@ -1014,11 +1303,8 @@ bool CScene::Create(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerL
 			return false;
 		}
 
-		if (!LoadDefaultScene(p_rhi, stgList, cmdBfr))
-		{
-			std::cerr << "CScene::Create Error: Failed to Load Scene" << std::endl;
-			return false;
-		}
+		for (const SceneDescription::Light& light : p_sceneDescription.lights)
+			m_sceneLights->ApplyLight(light.type, light.name.c_str(), light.castShadow, light.color, light.transform);
 
 		if (!LoadLights(p_rhi, stgList, cmdBfr))
 		{
@@ -1040,18 +1326,34 @@ bool CScene::Create(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerL
 
 	DestroyStaging(p_rhi, stgList);
 
+	RETURN_FALSE_IF_FALSE(LoadMaterialStorage(p_rhi));
+
 	RETURN_FALSE_IF_FALSE(CreateMeshUniformBuffer(p_rhi));
 
 	RETURN_FALSE_IF_FALSE(Create2DSceneDescriptors(p_rhi));
 
+	RETURN_FALSE_IF_FALSE(StartStreaming(p_rhi, p_samplerList, p_sceneDescription));
+
+#if !PROGRESSIVE_SCENE_LOADING
+	m_loaderPool->Wait(m_loaderJobs);
+	RETURN_FALSE_IF_FALSE(CommitStreamed(p_rhi, p_cmdPool));
+#endif
+
 	return true;
 }
 
 void CScene::Destroy(CVulkanRHI* p_rhi)
 {
+	StopStreaming(p_rhi);
+
 	m_skyBox->Destroy(p_rhi);
 	delete m_skyBox;
 
+	m_textureIngester.Destroy();
+	m_textureCompressor.Destroy();
+	m_meshDecoder.Destroy();
+	m_textureStreamer.Destroy(p_rhi);
+	m_bindlessTextures.Destroy(p_rhi);
 	C2DDescriptor::Destroy(p_rhi);
 	m_sceneTextures->Destroy(p_rhi);
 
@@ -1069,14 +1371,16 @@ void CScene::Destroy(CVulkanRHI* p_rhi)
 
 	p_rhi->FreeMemoryDestroyBuffer(m_material_storage);
 
-	for(int i =0; i< FRAME_BUFFER_COUNT; i++)
+	for(int i =0; i< MAX_FRAMES_IN_FLIGHT; i++)
 		p_rhi->FreeMemoryDestroyBuffer(m_meshInfo_uniform[i]);
 
 	p_rhi->DestroyCommandPool(m_assetLoaderCommandPool);
 }
 
-bool CScene::UpdateTLAS(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool, uint32_t p_scId)
+bool CScene::UpdateTLAS(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool, uint32_t p_frameIdx)
 {
+	PROFILE_FUNCTION();
+
 	if (!p_rhi->IsRayTracingEnabled())
 		return true;
 
@@ -1096,7 +1400,12 @@ void CScene::Show(CVulkanRHI* p_rhi)
 	int32_t sceneIndex = 0;
 	if (Header("Entity Settings"))
 	{
-		if (ImGui::Button("Load Asset"))
+		// assets are added once the scene has streamed in
+		if (!m_loaded)
+		{
+			ImGui::Text("Streaming in: %u of %u assets%s", m_committedAssets, (uint32_t)m_streamingAssets.size(), m_environmentCommitted ? "" : ", environment");
+		}
+		else if (ImGui::Button("Load Asset"))
 		{
 			m_fileDialog.Open();
 		}
@@ -1165,10 +1474,42 @@ void CScene::Show(CVulkanRHI* p_rhi)
 			//}
 		}
 	}
+
+	if (m_textureStreamer.IsCreated() && Header("Texture Streaming"))
+	{
+		CTextureStreamer::Stats stats = m_textureStreamer.GetStats();
+		ImGui::Text("Textures: %u of %u with finer mips than their tail", stats.streamedCount, stats.textureCount);
+		ImGui::Text("Memory: %.1f MB of %d MB", (float)stats.residentBytes / (1024.0f * 1024.0f), TEXTURE_STREAMING_BUDGET_MB);
+		ImGui::Text("Streamed in: %u, evicted: %u", stats.streamedIn, stats.evicted);
+	}
+
+	if (Header("Texture Registry"))
+	{
+		CTextureRegistry::Stats stats = m_textureRegistry.GetStats();
+		ImGui::Text("Textures: %u, referenced %u times", stats.textureCount, stats.references);
+
+		CTextureIngester::Stats ingestStats = m_textureIngester.GetStats();
+		ImGui::Text("Last load: %u textures, %.1f textures/s", ingestStats.textureCount, (double)ingestStats.textureCount / (std::max)(ingestStats.seconds, 1e-6));
+		ImGui::Text("Peak decoded in flight: %.1f MB of %d MB", (float)ingestStats.peakBytes / (1024.0f * 1024.0f), TEXTURE_INGEST_BUDGET_MB);
+	}
 }
 
 bool CScene::Update(CVulkanRHI* p_rhi, const LoadedUpdateData& p_loadedUpdate)
 {
+	PROFILE_FUNCTION();
+
+	RETURN_FALSE_IF_FALSE(CommitStreamed(p_rhi, p_loadedUpdate.commandPool));
+
+	// The loader thread grows the mesh and material lists while an asset loads, streaming waits for it to finish
+	if (m_textureStreamer.IsCreated() && m_assetLoadingTracker.state != AssetLoadingState::als_Loading)
+	{
+		RequestTextureMips(p_loadedUpdate);
+		RETURN_FALSE_IF_FALSE(m_textureStreamer.Update(p_rhi, m_bindlessTextures, p_loadedUpdate.frameIndex));
+	}
+
+	// No pending frame reads this frame's copy of the raster set anymore, it takes the textures staged since it was last used
+	RETURN_FALSE_IF_FALSE(m_bindlessTextures.Apply(p_rhi, *GetDescriptorSet(0, p_loadedUpdate.frameIndex), p_loadedUpdate.frameIndex));
+
 	m_sceneLights->Update(p_loadedUpdate.cameraData, m_sceneGraph);
 	if (m_sceneLights->IsDirty())
 	{
@@ -1190,6 +1531,9 @@ bool CScene::Update(CVulkanRHI* p_rhi, const LoadedUpdateData& p_loadedUpdate)
 		if (!p_rhi->EndCommandBuffer(cmdBfr))
 			return false;
 
+		// the light storage is shared by all frames, frames still in flight may be reading it
+		p_rhi->WaitToFinish(p_rhi->GetQueue());
+
 		CVulkanRHI::CommandBufferList cbrList{ cmdBfr };
 		CVulkanRHI::PipelineStageFlagsList psfList{ VkPipelineStageFlags {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT} };
 		bool waitForFinish = true;
@@ -1202,26 +1546,81 @@ bool CScene::Update(CVulkanRHI* p_rhi, const LoadedUpdateData& p_loadedUpdate)
 	}
 
 	std::vector<float> perMeshUniformData;
-	perMeshUniformData.reserve(m_meshInfo_uniform[p_loadedUpdate.swapchainIndex].reqMemSize);
+	perMeshUniformData.reserve(m_meshInfo_uniform[p_loadedUpdate.frameIndex].reqMemSize);
 	for (auto& mesh : m_meshes)
 	{
 		mesh->SetDirty(false);
-		mesh->m_viewNormalTransform					= (p_loadedUpdate.camView * mesh->GetTransform().GetTransform());	// nm::inverse(nm::transpose(p_loadedUpdate.viewMatrix * mesh->GetTransform().GetTransform()));
 
-		const float* modelMat						= &(mesh->GetTransform().GetTransform()).column[0][0];
+		// Every instance owns a slot starting from the mesh's first instance id. Meshes are created 
+		// in order of their first instance id, so the slots are written contiguously
+		nm::float4x4 entityTransform				= mesh->GetTransform().GetTransform();
+		for (const auto& instance : mesh->m_instances)
+		{
+			nm::float4x4 model						= entityTransform * instance.transform;
+			nm::float4x4 viewNormalTransform		= (p_loadedUpdate.camView * model);	// nm::inverse(nm::transpose(p_loadedUpdate.viewMatrix * model));
+
+			const float* modelMat					= &model.column[0][0];
 
-		const float* trn_inv_model					= &mesh->m_viewNormalTransform.column[0][0];							// this needs to be inverse transpose so as to negate the scaling in the matrix before multiplying with normal. But this isn't working and I do not know why !
+			const float* trn_inv_model				= &viewNormalTransform.column[0][0];							// this needs to be inverse transpose so as to negate the scaling in the matrix before multiplying with normal. But this isn't working and I do not know why !
 
-		std::copy(&modelMat[0], &modelMat[16], std::back_inserter(perMeshUniformData));										// model matrix for this mesh
-		std::copy(&trn_inv_model[0], &trn_inv_model[16], std::back_inserter(perMeshUniformData));							// Transpose(inverse(view * model)) for transforming normal to view space
+			std::copy(&modelMat[0], &modelMat[16], std::back_inserter(perMeshUniformData));									// model matrix for this instance
+			std::copy(&trn_inv_model[0], &trn_inv_model[16], std::back_inserter(perMeshUniformData));						// Transpose(inverse(view * model)) for transforming normal to view space
+		}
 	}
 
 	uint8_t* data = (uint8_t*)(perMeshUniformData.data());
-	RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer(data, m_meshInfo_uniform[p_loadedUpdate.swapchainIndex], false));
+	RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer(data, m_meshInfo_uniform[p_loadedUpdate.frameIndex], false));
 
 	return true;
 }
 
+// Asks the streamer for the mip each sub-mesh instance in the camera's frustum needs: a UV unit spans uvDensity in
+// mesh space, which projects to as many pixels as the instance's scale and its bounding sphere's distance to the
+// camera allow. Those out of view ask for nothing, so they do not evict the mips of textures on screen
+void CScene::RequestTextureMips(const LoadedUpdateData& p_loadedUpdate)
+{
+	PROFILE_FUNCTION();
+
+	nm::float3 cameraPos = nm::inverse(p_loadedUpdate.camView).column[3].xyz();
+	nm::float4x4 viewProj = p_loadedUpdate.camProjection * p_loadedUpdate.camView;
+	float pixelsPerUnit = p_loadedUpdate.screenRes.y() * 0.5f * std::abs(p_loadedUpdate.camProjection.column[1][1]);
+
+	for (const auto& mesh : m_meshes)
+	{
+		nm::float4x4 entityTransform = mesh->GetTransform().GetTransform();
+		for (const auto& instance : mesh->m_instances)
+		{
+			nm::float4x4 model = entityTransform * instance.transform;
+			float scale = (std::max)({ nm::length(model.column[0].xyz()), nm::length(model.column[1].xyz()), nm::length(model.column[2].xyz()) });
+
+			// the sub-mesh boxes are in mesh space, the frustum is taken there
+			BFrustum frustum(viewProj * model);
+
+			const SharedMesh& sharedMesh = mesh->m_sharedMeshes[instance.sharedMeshId];
+			for (uint32_t i = 0; i < sharedMesh.submeshCount; i++)
+			{
+				const SubMesh& submesh = mesh->m_submeshes[sharedMesh.firstSubmesh + i];
+				const BBox& bbox = sharedMesh.submeshesBbox[i];
+				if (submesh.uvDensity <= 0.0f || submesh.materialId >= m_materialsList.size() || !frustum.isVisiable(bbox))
+					continue;
+
+				nm::float3 center = (model * nm::float4((bbox.bbMin + bbox.bbMax) * 0.5f, 1.0f)).xyz();
+				float radius = nm::length(bbox.bbMax - bbox.bbMin) * 0.5f * scale;
+				float distance = (std::max)(nm::length(center - cameraPos) - radius, 0.01f);
+
+				float pixelsPerUV = submesh.uvDensity * scale * pixelsPerUnit / distance;
+
+				const Material& material = m_materialsList[submesh.materialId];
+				for (uint32_t slot : { material.color_id, material.normal_id, material.roughMetal_id, material.emissive_id })
+				{
+					if (slot != MAX_SUPPORTED_TEXTURES)
+						m_textureStreamer.RequestMip(slot, pixelsPerUV);
+				}
+			}
+		}
+	}
+}
+
 bool CScene::LoadDefaultTextures(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, CVulkanRHI::BufferList& p_stgList, CVulkanRHI::CommandBuffer& p_cmdBfr)
 {
 	// load default texture to compensate for bad textures
@@ -1239,133 +1638,447 @@ bool CScene::LoadDefaultTextures(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerLis
 		FreeRawImage(tex);
 		p_stgList.push_back(stg);
 	}
-
-	// Load specular environment map
+
+	// Uniform stand-ins for the image based lighting until StreamEnvironment has baked it, a dim sky keeps the first
+	// frames from flashing
+	{
+		const float placeholderRadiance[3] = { 0.3f, 0.35f, 0.4f };
+		ImageRaw specularRaw, diffuseRaw;
+		CEnvironmentBaker::MakeUniformEnvironment(placeholderRadiance, specularRaw, diffuseRaw);
+
+		CVulkanRHI::Buffer specularStg;
+		RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateCubemap(p_rhi, specularStg, specularRaw, *p_samplerList, p_cmdBfr, "environment_specular_placeholder"));
+		p_stgList.push_back(specularStg);
+
+		CVulkanRHI::Buffer diffuseStg;
+		RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateCubemap(p_rhi, diffuseStg, diffuseRaw, *p_samplerList, p_cmdBfr, "environment_diffuse_placeholder"));
+		p_stgList.push_back(diffuseStg);
+
+		FreeRawImage(specularRaw);
+		FreeRawImage(diffuseRaw);
+	}
+
+	{
+		ImageRaw tex;
+		CEnvironmentBaker::MakeUniformBrdfLut(tex);
+
+		CVulkanRHI::Buffer stg;
+		RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateTexture(p_rhi, stg, &tex, VK_FORMAT_R8G8B8A8_UNORM, p_cmdBfr, "brdf_lut_placeholder"));
+
+		FreeRawImage(tex);
+		p_stgList.push_back(stg);
+	}
+
+	// Load skybox geometry
+	{
+		SceneRaw sceneraw;
+		ObjLoadData loadData{};
+		loadData.flipUV = false;
+		loadData.loadMeshOnly = true;
+
+		RETURN_FALSE_IF_FALSE(LoadObj((g_DefaultPath / "3D/cube.obj").string().c_str(), sceneraw, loadData));
+
+		MeshRaw meshraw = sceneraw.meshList[0];
+		m_skyBox = new CRenderable(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+		RETURN_FALSE_IF_FALSE(m_skyBox->CreateVertexIndexBuffer(p_rhi, p_stgList, &meshraw, p_cmdBfr, "skybox"));
+	}
+
+	return true;
+}
+
+// Loader threads wait on a fence of their own, waiting for the queue to idle would wait on the frames as well
+static bool SubmitAndWaitFence(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName)
+{
+	VkFence fence;
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateFence(0, fence, p_debugName + "_fence"));
+	RETURN_FALSE_IF_FALSE(p_rhi->EndCommandBuffer(p_cmdBfr));
+
+	CVulkanRHI::CommandBufferList cbrList{ p_cmdBfr };
+	CVulkanRHI::PipelineStageFlagsList psfList{ VkPipelineStageFlags {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT} };
+	bool submitted = p_rhi->SubmitCommandBuffers(&cbrList, &psfList, false, &fence, true/*wait for fence*/);
+
+	p_rhi->DestroyFence(fence);
+	return submitted;
+}
+
+// Created for a scene without assets as well, the assets streamed or loaded later upload their materials to it
+bool CScene::LoadMaterialStorage(CVulkanRHI* p_rhi)
+{
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(sizeof(Material) * MAX_SUPPORTED_MATERIALS, m_material_storage,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "scene_materials"));
+
+	return true;
+}
+
+// The first frame is drawn with what Create loaded; the environment is baked on one loader job and the assets of the
+// description are loaded on another, every asset importing on a job of its own. What they finish is added to the scene
+// by the render thread at the start of a frame, see CommitStreamed
+bool CScene::StartStreaming(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, const SceneDescription& p_sceneDescription)
+{
+	m_streamingAssets = p_sceneDescription.assets;
+	m_streamingStart = std::chrono::steady_clock::now();
+
+	// one worker at least, nothing waits on the jobs before they are done
+	m_loaderPool = new CThreadPool();
+	RETURN_FALSE_IF_FALSE(m_loaderPool->Create((std::max)(std::thread::hardware_concurrency(), 2u) - 1));
+
+	m_loaderPool->Submit(m_loaderJobs, [this, p_rhi, p_samplerList](uint32_t) { return StreamEnvironment(p_rhi, p_samplerList); });
+	m_loaderPool->Submit(m_loaderJobs, [this, p_rhi](uint32_t) { return StreamAssets(p_rhi); });
+
+	return true;
+}
+
+void CScene::StopStreaming(CVulkanRHI* p_rhi)
+{
+	if (!m_loaderPool)
+		return;
+
+	// the asset loader stops before its next asset, an environment bake runs to its end
+	m_cancelLoading = true;
+	m_loaderPool->Wait(m_loaderJobs);
+	m_loaderPool->Destroy();
+	delete m_loaderPool;
+	m_loaderPool = nullptr;
+
+	// Streamed in but never committed. The textures of the assets are in the scene's list and are destroyed with it
+	if (m_environmentStreamed)
+	{
+		CTextures::DestroyTextureImage(p_rhi, m_streamedEnvironment.specular);
+		CTextures::DestroyTextureImage(p_rhi, m_streamedEnvironment.diffuse);
+		CTextures::DestroyTextureImage(p_rhi, m_streamedEnvironment.brdfLut);
+		m_environmentStreamed = false;
+	}
+	m_streamedAssets.clear();
+}
+
+// Bakes the environment, or loads the prefiltered DDS cube maps without it, and the BRDF LUT. They are uploaded
+// apart from the scene textures, the render thread swaps them in for the stand-ins
+bool CScene::StreamEnvironment(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList)
+{
+	PROFILE_FUNCTION();
+
+	CEnvironmentBaker::Settings bakerSettings{};
+	bakerSettings.cacheDir = g_EnginePath / "cache/ibl";
+	bakerSettings.specularSize = IBL_SPECULAR_SIZE;
+	bakerSettings.specularSamples = IBL_SPECULAR_SAMPLES;
+	bakerSettings.diffuseSize = IBL_DIFFUSE_SIZE;
+	bakerSettings.brdfLutSize = IBL_BRDF_LUT_SIZE;
+
+	CEnvironmentBaker environmentBaker;
+	RETURN_FALSE_IF_FALSE(environmentBaker.Create(bakerSettings));
+
+	ImageRaw specularRaw, diffuseRaw, brdfLutRaw;
+
+	std::filesystem::path environmentPath = g_DefaultPath / IBL_ENVIRONMENT_MAP;
+	if (std::filesystem::exists(environmentPath))
+	{
+		CLOG("Baking IBL: " << environmentPath.string() << std::endl);
+		RETURN_FALSE_IF_FALSE(environmentBaker.BakeEnvironment(environmentPath, specularRaw, diffuseRaw));
+	}
+	else
+	{
+		std::filesystem::path cubemap_path = g_DefaultPath / "Textures/IBL/georgentor_Specular.dds";
+		CLOG("Loading Specular IBL Mips: " << cubemap_path.string() << std::endl);
+		RETURN_FALSE_IF_FALSE(LoadRawImage(cubemap_path.string().c_str(), specularRaw));
+
+		cubemap_path = g_DefaultPath / "Textures/IBL/georgentor_Diffuse.dds";
+		CLOG("Loading Diffuse Irradiance Mips: " << cubemap_path.string() << std::endl);
+		RETURN_FALSE_IF_FALSE(LoadRawImage(cubemap_path.string().c_str(), diffuseRaw));
+	}
+
+	// Bake BRDFLut, linear with the roughness along v as the lighting shaders read it
+	RETURN_FALSE_IF_FALSE(environmentBaker.BakeBrdfLut(brdfLutRaw));
+	environmentBaker.Destroy();
+
+	if (m_cancelLoading)
+	{
+		FreeRawImage(specularRaw);
+		FreeRawImage(diffuseRaw);
+		FreeRawImage(brdfLutRaw);
+		return true;
+	}
+
+	CTextures environment(TextureType::tt_scene);
+	CVulkanRHI::BufferList stgList;
+	VkCommandPool cmdPool;
+	CVulkanRHI::CommandBuffer cmdBfr;
+	std::string debugMarker = "Environment Streaming";
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandPool(p_rhi->GetQueueFamiliyIndex(), cmdPool));
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffer(cmdPool, &cmdBfr, debugMarker));
+
+	CVulkanRHI::Buffer specularStg;
+	RETURN_FALSE_IF_FALSE(environment.CreateCubemap(p_rhi, specularStg, specularRaw, *p_samplerList, cmdBfr, "environment_specular", TextureType::tt_env_specular));
+	stgList.push_back(specularStg);
+
+	CVulkanRHI::Buffer diffuseStg;
+	RETURN_FALSE_IF_FALSE(environment.CreateCubemap(p_rhi, diffuseStg, diffuseRaw, *p_samplerList, cmdBfr, "environment_diffuse", TextureType::tt_env_diffuse));
+	stgList.push_back(diffuseStg);
+
+	CVulkanRHI::Buffer brdfLutStg;
+	RETURN_FALSE_IF_FALSE(environment.CreateTexture(p_rhi, brdfLutStg, &brdfLutRaw, VK_FORMAT_R8G8B8A8_UNORM, cmdBfr, "brdf_lut", TextureType::tt_brdfLut));
+	stgList.push_back(brdfLutStg);
+
+	FreeRawImage(specularRaw);
+	FreeRawImage(diffuseRaw);
+	FreeRawImage(brdfLutRaw);
+
+	bool uploaded = SubmitAndWaitFence(p_rhi, cmdBfr, debugMarker);
+	DestroyStaging(p_rhi, stgList);
+	p_rhi->DestroyCommandPool(cmdPool);
+	RETURN_FALSE_IF_FALSE(uploaded);
+
+	{
+		std::lock_guard<std::mutex> lock(m_streamedMutex);
+		m_streamedEnvironment.specular = environment.GetTexture(TextureType::tt_env_specular);
+		m_streamedEnvironment.diffuse = environment.GetTexture(TextureType::tt_env_diffuse);
+		m_streamedEnvironment.brdfLut = environment.GetTexture(TextureType::tt_brdfLut);
+		m_environmentStreamed = true;
+	}
+
+	return true;
+}
+
+// Every asset is imported on a job of its own, into a scene of its own as if it were the only one; the importers share
+// the texture registry and the workers of the mesh decoder. The textures are then ingested asset by asset in the order
+// the description lists them, so the texture slots come out the same on every load, while the assets after the one
+// ingesting keep importing. An asset is handed to the render thread as soon as its textures are uploaded
+bool CScene::StreamAssets(CVulkanRHI* p_rhi)
+{
+	PROFILE_FUNCTION();
+
+	VkCommandPool cmdPool;
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandPool(p_rhi->GetQueueFamiliyIndex(), cmdPool));
+
+	std::vector<SceneRaw> assetScenes(m_streamingAssets.size());
+	std::vector<CThreadPool::JobGroup> importJobs(m_streamingAssets.size());
+	for (size_t i = 0; i < m_streamingAssets.size(); i++)
+	{
+		m_loaderPool->Submit(importJobs[i], [this, &assetScenes, i](uint32_t)
+		{
+			return m_cancelLoading || ImportAsset(m_streamingAssets[i], assetScenes[i]);
+		});
+	}
+
+	bool succeeded = true;
+	for (size_t i = 0; i < m_streamingAssets.size() && succeeded && !m_cancelLoading; i++)
+	{
+		succeeded = m_loaderPool->Wait(importJobs[i]) && (m_cancelLoading || StreamAsset(p_rhi, cmdPool, (uint32_t)i, assetScenes[i]));
+		p_rhi->ResetCommandPool(cmdPool);
+	}
+
+	// the imports still running write to the scenes above
+	if (!succeeded)
+		m_cancelLoading = true;
+	for (auto& jobs : importJobs)
+		m_loaderPool->Wait(jobs);
+
+	p_rhi->DestroyCommandPool(cmdPool);
+
+	for (auto& sceneraw : assetScenes)
+	{
+		for (auto& tex : sceneraw.textureList)
+			FreeRawImage(tex);
+	}
+
+	if (!succeeded)
+		std::cerr << "CScene::StreamAssets Error: Failed to load the scene's assets" << std::endl;
+
+	return succeeded;
+}
+
+bool CScene::ImportAsset(const SceneDescription::Asset& p_asset, SceneRaw& p_sceneRaw)
+{
+	std::filesystem::path path = SceneDescription::ResolveAssetPath(p_asset.path);
+	CLOG("Loading Scene Resources - " << path.string() << std::endl);
+
+	p_sceneRaw.materialOffset = 0;
+	p_sceneRaw.textureOffset = 0;
+
+	ObjLoadData loadData{};
+	loadData.flipUV = p_asset.flipUV;
+	loadData.loadMeshOnly = false;
+	loadData.textureRegistry = &m_textureRegistry;
+	loadData.deferDecode = true;
+	loadData.meshDecoder = &m_meshDecoder;
+
+	if (path.extension() == ".gltf" || path.extension() == ".glb")
+	{
+		RETURN_FALSE_IF_FALSE(LoadGltf(path.string().c_str(), p_sceneRaw, loadData));
+	}
+	else if (path.extension() == ".obj")
+	{
+		RETURN_FALSE_IF_FALSE(LoadObj(path.string().c_str(), p_sceneRaw, loadData));
+	}
+	else
 	{
-		ImageRaw cubeMapRaw;
+		std::cerr << "CScene::ImportAsset Error: Invalid file extension - " << path.extension() << std::endl;
+		return false;
+	}
 
-		std::filesystem::path cubemap_path = g_DefaultPath / "Textures/IBL/georgentor_Specular.dds";
-		std::clog << "Loading Specular IBL Mips: " << cubemap_path.string().c_str() << std::endl;
-		
-		RETURN_FALSE_IF_FALSE(LoadRawImage(cubemap_path.string().c_str(), cubeMapRaw));
+	for (auto& meshraw : p_sceneRaw.meshList)
+		meshraw.transform = p_asset.transform;
 
-		CVulkanRHI::Buffer stg;
-		RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateCubemap(p_rhi, stg, cubeMapRaw, *p_samplerList, p_cmdBfr, "environment_specular"));
+	return true;
+}
 
-		p_stgList.push_back(stg);
+// Runs on the asset loader: decodes, compresses and uploads the textures of an imported asset, which is then queued
+// for the render thread with its materials pointed at the new slots
+bool CScene::StreamAsset(CVulkanRHI* p_rhi, VkCommandPool p_cmdPool, uint32_t p_index, SceneRaw& p_sceneRaw)
+{
+	PROFILE_FUNCTION();
 
-		FreeRawImage(cubeMapRaw);
+	uint32_t firstTexture = (uint32_t)m_sceneTextures->GetTextures().size();
+	if (firstTexture - TextureType::tt_scene + p_sceneRaw.textureList.size() > m_bindlessTextures.GetCapacity())
+	{
+		std::cerr << "CScene::StreamAsset Error: Max Supported Texture Count exceeded" << std::endl;
+		return false;
 	}
 
-	// Load diffuse environment map
-	{
-		ImageRaw cubeMapRaw;
-		std::filesystem::path cubemap_path = g_DefaultPath / "Textures/IBL/georgentor_Diffuse.dds";
-		std::clog << "Loading Diffuse Irradiance Mips: " << cubemap_path.string().c_str() << std::endl;
+	CVulkanRHI::CommandBuffer cmdBfr;
+	CVulkanRHI::BufferList stgList;
+	std::string debugMarker = "Asset Streaming";
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffer(p_cmdPool, &cmdBfr, debugMarker));
 
-		RETURN_FALSE_IF_FALSE(LoadRawImage(cubemap_path.string().c_str(), cubeMapRaw));
+	bool uploaded = LoadSceneTextures(p_rhi, p_sceneRaw, 0, stgList, cmdBfr) && SubmitAndWaitFence(p_rhi, cmdBfr, debugMarker);
+	DestroyStaging(p_rhi, stgList);
+	RETURN_FALSE_IF_FALSE(uploaded);
+	p_sceneRaw.textureList.clear();
 
-		CVulkanRHI::Buffer stg;
-		RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateCubemap(p_rhi, stg, cubeMapRaw, *p_samplerList, p_cmdBfr, "environment_diffuse"));
+	StreamedAsset streamed{};
+	streamed.index = p_index;
+	streamed.sceneRaw = std::move(p_sceneRaw);
+	streamed.firstTexture = firstTexture;
+	streamed.textureCount = (uint32_t)m_sceneTextures->GetTextures().size() - firstTexture;
+	{
+		std::lock_guard<std::mutex> lock(m_streamedMutex);
+		m_streamedAssets.push_back(std::move(streamed));
+	}
 
-		p_stgList.push_back(stg);
+	return true;
+}
 
-		FreeRawImage(cubeMapRaw);
-	}
+// Adds what the loaders finished since the last frame. Frames in flight read the environment, the materials and the
+// TLAS this changes, so the queue is waited idle first. The meshes are created here rather than on the loaders, as
+// entities join the scene graph when constructed
+bool CScene::CommitStreamed(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool)
+{
+	if (m_loaded)
+		return true;
 
-	// Load BRDFLut
+	bool environmentStreamed = false;
+	StreamedEnvironment environment{};
+	std::vector<StreamedAsset> assets;
 	{
-		ImageRaw tex;
+		std::lock_guard<std::mutex> lock(m_streamedMutex);
+		std::swap(environmentStreamed, m_environmentStreamed);
+		environment = m_streamedEnvironment;
+		assets.swap(m_streamedAssets);
+	}
 
-		std::filesystem::path resourcePath = g_DefaultPath / "Textures/BRDF/BrdfLut.dds";
-		std::clog << "Loading BRDF Lut: " << resourcePath.string().c_str() << std::endl;
+	if (environmentStreamed || !assets.empty())
+		RETURN_FALSE_IF_FALSE(p_rhi->WaitToFinish(p_rhi->GetQueue()));
 
-		RETURN_FALSE_IF_FALSE(LoadRawImage(resourcePath.string().c_str(), tex));
+	if (environmentStreamed)
+		RETURN_FALSE_IF_FALSE(CommitEnvironment(p_rhi, environment));
 
-		CVulkanRHI::Buffer stg;
-		RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateTexture(p_rhi, stg, &tex, VK_FORMAT_B8G8R8A8_SRGB, p_cmdBfr, "brdf_lut"));
+	for (StreamedAsset& asset : assets)
+		RETURN_FALSE_IF_FALSE(CommitAsset(p_rhi, p_cmdPool, asset));
 
-		FreeRawImage(tex);
-		p_stgList.push_back(stg);
+	// the failing loader logged why
+	if (m_loaderJobs.pending == 0 && !m_loaderJobs.succeeded)
+	{
+		std::cerr << "CScene::CommitStreamed Error: Failed to stream the scene in" << std::endl;
+		return false;
 	}
 
-	// Load skybox geometry
+	if (m_environmentCommitted && m_committedAssets == m_streamingAssets.size())
 	{
-		SceneRaw sceneraw;
-		ObjLoadData loadData{};
-		loadData.flipUV = false;
-		loadData.loadMeshOnly = true;
+		m_loaded = true;
+		CLOG("Scene streamed in after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_streamingStart).count() << " ms - "
+			<< m_meshes.size() << " meshes, " << m_sceneTextures->GetTextures().size() - TextureType::tt_scene << " textures" << std::endl);
+	}
 
-		RETURN_FALSE_IF_FALSE(LoadObj((g_DefaultPath / "3D/cube.obj").string().c_str(), sceneraw, loadData));
+	return true;
+}
 
-		MeshRaw meshraw = sceneraw.meshList[0];
-		m_skyBox = new CRenderable(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
-		RETURN_FALSE_IF_FALSE(m_skyBox->CreateVertexIndexBuffer(p_rhi, p_stgList, &meshraw, p_cmdBfr, "skybox"));
+bool CScene::CommitEnvironment(CVulkanRHI* p_rhi, StreamedEnvironment& p_environment)
+{
+	CVulkanRHI::Image placeholders[3];
+	{
+		std::lock_guard<std::mutex> lock(m_sceneTexturesMutex);
+		placeholders[0] = m_sceneTextures->ReplaceTexture(TextureType::tt_env_specular, p_environment.specular);
+		placeholders[1] = m_sceneTextures->ReplaceTexture(TextureType::tt_env_diffuse, p_environment.diffuse);
+		placeholders[2] = m_sceneTextures->ReplaceTexture(TextureType::tt_brdfLut, p_environment.brdfLut);
+
+		// Every binding of the set is written again; these point into the texture list, which the loader may have grown
+		uint32_t rasterDescsetId = 0;
+		BindlessWrite(rasterDescsetId, BindingDest::bd_Env_Specular,	&m_sceneTextures->GetTexture(TextureType::tt_env_specular).descInfo, 1);
+		BindlessWrite(rasterDescsetId, BindingDest::bd_Env_Diffuse,		&m_sceneTextures->GetTexture(TextureType::tt_env_diffuse).descInfo, 1);
+		BindlessWrite(rasterDescsetId, BindingDest::bd_Brdf_Lut,		&m_sceneTextures->GetTexture(TextureType::tt_brdfLut).descInfo, 1);
+		BindlessUpdate(p_rhi, rasterDescsetId);
 	}
 
+	for (CVulkanRHI::Image& placeholder : placeholders)
+		CTextures::DestroyTextureImage(p_rhi, placeholder);
+
+	m_environmentCommitted = true;
+	CLOG("Environment streamed in after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_streamingStart).count() << " ms" << std::endl);
+
 	return true;
 }
 
-bool CScene::LoadDefaultScene(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgList, CVulkanRHI::CommandBuffer& p_cmdBfr, bool p_dumpBinaryToDisk)
+// Creates the meshes of a streamed asset and appends its materials; its textures are uploaded already, only their
+// bindless slots are staged. The TLAS is built again for the instances added
+bool CScene::CommitAsset(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool, StreamedAsset& p_asset)
 {
-	std::vector<std::filesystem::path>		defaultScenePaths;
-	defaultScenePaths.push_back(g_AssetPath / "glTF-Sample-Assets/Models/Sponza/glTF/Sponza.gltf");
-	//defaultScenePaths.push_back(g_AssetPath / "glTF-Sample-Assets/Models/SciFiHelmet/glTF/SciFiHelmet.gltf");
-	//defaultScenePaths.push_back(g_AssetPath / "glTF-Sample-Assets/Models/Suzanne/glTF/Suzanne.gltf");
-	//defaultScenePaths.push_back(g_AssetPath / "intel_sponza/NewSponza_Main_glTF_003.gltf");
-	
-	std::vector<bool> flipYList{ false, false, false };
+	PROFILE_FUNCTION();
 
-	SceneRaw sceneraw;
-	sceneraw.materialOffset = 0;
-	sceneraw.textureOffset = 0;
-	
-	// Load the assets to system memory
-	for (unsigned int i = 0; i < defaultScenePaths.size(); i++)
-	{
-		std::clog << "Loading Scene Resources - " << defaultScenePaths[i] << std::endl;
+	SceneRaw& sceneraw = p_asset.sceneRaw;
+	const SceneDescription::Asset& asset = m_streamingAssets[p_asset.index];
 
-		ObjLoadData loadData{};
-		loadData.flipUV = flipYList[i];
-		loadData.loadMeshOnly = false;
+	if (m_materialsList.size() + sceneraw.materialsList.size() > MAX_SUPPORTED_MATERIALS)
+	{
+		std::cerr << "CScene::CommitAsset Error: Max Supported Material Size exceeded - " << asset.path << std::endl;
+		return false;
+	}
 
-		if (defaultScenePaths[i].extension() == ".gltf" || defaultScenePaths[i].extension() == ".glb")
-		{
-			RETURN_FALSE_IF_FALSE(LoadGltf(defaultScenePaths[i].string().c_str(), sceneraw, loadData));
-		}
-		else if (defaultScenePaths[i].extension() == ".obj")
-		{
-			RETURN_FALSE_IF_FALSE(LoadObj(defaultScenePaths[i].string().c_str(), sceneraw, loadData));
-		}
-		else
+	// the sub-meshes refer to the asset's own materials, which follow the ones committed before it
+	uint32_t materialBase = (uint32_t)m_materialsList.size();
+	for (auto& meshraw : sceneraw.meshList)
+	{
+		for (auto& submesh : meshraw.submeshes)
 		{
-			std::cerr << "Invalid file extension - " << defaultScenePaths[i].extension() << std::endl;
-			return false;
+			if (submesh.materialId < sceneraw.materialsList.size())
+				submesh.materialId += materialBase;
 		}
+	}
 
-		if (p_dumpBinaryToDisk)
-		{
-			std::string outName = "D:/" + defaultScenePaths[i].stem().string();
-			WriteToDisk(std::filesystem::path(outName + "_vertex_float_p3_n3_uv2_t4.charp"), sizeof(Vertex) * sceneraw.meshList[i].vertexList.size(), (char*)sceneraw.meshList[i].vertexList.data());
-			WriteToDisk(std::filesystem::path(outName + "_index_uint32.charp"), sizeof(uint32_t) * sceneraw.meshList[i].indicesList.size(), (char*)sceneraw.meshList[i].indicesList.data());
-		}
+	CVulkanRHI::CommandBuffer cmdBfr;
+	CVulkanRHI::BufferList stgList;
+	std::string debugMarker = "Asset Streaming";
+	RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffer(p_cmdPool, &cmdBfr, debugMarker));
 
-		m_textureOffset = sceneraw.textureOffset;
-		m_materialOffset = sceneraw.materialOffset;
-	}
-	
 	// Load to staging and set loading of mesh to device memory
+	uint32_t firstMesh = (uint32_t)m_meshes.size();
 	for (auto& meshraw : sceneraw.meshList)
 	{
-		std::clog << "CScene::LoadDefaultScene: Loading Asset to GPU - " << meshraw.name << std::endl;
+		std::clog << "CScene::CommitAsset: Loading Asset to GPU - " << meshraw.name << std::endl;
+		if (m_meshInstanceCount + meshraw.instances.size() > MAX_SUPPORTED_MESH_INSTANCES)
+		{
+			std::cerr << "CScene::CommitAsset Error: Max Supported Mesh Instances exceeded - " << meshraw.name << std::endl;
+			return false;
+		}
+
 		CRenderableMesh* mesh = nullptr;
 		
 		if (p_rhi->IsRayTracingEnabled())
-			mesh = new CRayTracingRenderable(meshraw.name, (uint32_t)m_meshes.size(), meshraw.transform, &m_accStructInstances[m_meshes.size()]);
+			mesh = new CRayTracingRenderable(meshraw.name, (uint32_t)m_meshes.size(), m_meshInstanceCount, meshraw.transform, &m_accStructInstances[m_meshInstanceCount]);
 		else
-			mesh = new CRenderableMesh(meshraw.name, (uint32_t)m_meshes.size(), meshraw.transform);
+			mesh = new CRenderableMesh(meshraw.name, (uint32_t)m_meshes.size(), m_meshInstanceCount, meshraw.transform);
 		
 		mesh->m_submeshes = meshraw.submeshes;
+		mesh->SetInstances(meshraw);
+		m_meshInstanceCount += (uint32_t)meshraw.instances.size();
 
 		BVolume* bVol = new BBox(meshraw.bbox);
 		mesh->SetBoundingVolume(bVol);
@@ -1375,62 +2088,168 @@ bool CScene::LoadDefaultScene(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgLi
 			mesh->SetSubBoundingBox(bbox);
 		}
 
-		RETURN_FALSE_IF_FALSE(mesh->CreateVertexIndexBuffer(p_rhi, p_stgList, &meshraw, p_cmdBfr, meshraw.name));
+		RETURN_FALSE_IF_FALSE(mesh->CreateVertexIndexBuffer(p_rhi, stgList, &meshraw, cmdBfr, meshraw.name));
 
 		// TODO: Insert a memory barrier here
 		if(p_rhi->IsRayTracingEnabled())
-			RETURN_FALSE_IF_FALSE(dynamic_cast<CRayTracingRenderable*>(mesh)->CreateBuildBLAS(p_rhi, p_stgList, p_cmdBfr, meshraw.name + " BLAS"));
+			RETURN_FALSE_IF_FALSE(dynamic_cast<CRayTracingRenderable*>(mesh)->CreateBuildBLAS(p_rhi, stgList, cmdBfr, meshraw.name + " BLAS"));
 
 		m_meshes.push_back(mesh);
 	}
-	
-	// Load to staging and set loading of textures to device memory
-	for (const auto& tex : sceneraw.textureList)
-	{
-		CVulkanRHI::Image img;
-		{
-			if (tex.raw != nullptr)
-			{
-				CVulkanRHI::Buffer stg;
-				RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateTexture(p_rhi, stg, &tex, VK_FORMAT_R8G8B8A8_UNORM, p_cmdBfr, tex.name));
-				p_stgList.push_back(stg);
-			}
-			else
-			{
-				m_sceneTextures->PushBackPreLoadedTexture(TextureType::tt_default);
-			}
-		}
-	}
 
 	// Load to staging and set loading of materials to device memory
 	std::copy(sceneraw.materialsList.begin(), sceneraw.materialsList.end(), std::back_inserter(m_materialsList));
-	if(!m_materialsList.empty())
+	if (!m_materialsList.empty())
 	{
 		CVulkanRHI::Buffer matStg;
-		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(sizeof(Material) * MAX_SUPPORTED_MATERIALS, matStg,
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(sizeof(Material) * m_materialsList.size(), matStg,
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "scene_materials_transfer"));
 
 		RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer((uint8_t*)m_materialsList.data(), matStg));
 
-		p_stgList.push_back(matStg);
+		stgList.push_back(matStg);
+
+		RETURN_FALSE_IF_FALSE(p_rhi->UploadFromHostToDevice(matStg, m_material_storage, cmdBfr));
+	}
+
+	RETURN_FALSE_IF_FALSE(p_rhi->SubmitCommandBuffer(cmdBfr, true/*wait for finish*/));
+
+	// built on the BLAS of the new meshes, which are done by now
+	if (p_rhi->IsRayTracingEnabled())
+	{
+		debugMarker = "TLAS Building";
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffer(p_cmdPool, &cmdBfr, debugMarker));
+		RETURN_FALSE_IF_FALSE(UpdateTLAS(p_rhi, cmdBfr, true/*rebuild*/));
+		RETURN_FALSE_IF_FALSE(p_rhi->SubmitCommandBuffer(cmdBfr, true/*wait for finish*/));
+	}
+
+	DestroyStaging(p_rhi, stgList);
+
+	// Stage the new slots of the bindless table, default textures standing in for missing ones included.
+	// Every descriptor set copy takes them at the start of its next frame
+	{
+		std::lock_guard<std::mutex> lock(m_sceneTexturesMutex);
 
-		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(matStg.descInfo.range, m_material_storage, 
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "scene_materials"));
+		std::vector<VkDescriptorImageInfo> imageInfoList;
+		for (uint32_t i = p_asset.firstTexture; i < p_asset.firstTexture + p_asset.textureCount; i++)
+			imageInfoList.push_back(m_sceneTextures->GetTextures()[i].descInfo);
 
-		RETURN_FALSE_IF_FALSE(p_rhi->UploadFromHostToDevice(matStg, m_material_storage, p_cmdBfr));
+		RETURN_FALSE_IF_FALSE(m_bindlessTextures.Stage(imageInfoList.data(), (uint32_t)imageInfoList.size()));
 	}
 
-	// Clear all loaded resources from system memory
-	// can binary dump in future to optimized format for faster binary loading
-	{		
-		sceneraw.meshList.clear();
+	m_textureOffset = p_asset.firstTexture + p_asset.textureCount - TextureType::tt_scene;
+	m_materialOffset = (uint32_t)m_materialsList.size();
+	m_loadedAssets.push_back(LoadedAsset{ asset.path, asset.flipUV, firstMesh, (uint32_t)m_meshes.size() - firstMesh });
+	m_committedAssets++;
 
-		for (auto& tex : sceneraw.textureList)
+	CSceneGraph::RequestSceneBBoxUpdate();
+
+	CLOG(asset.path << " streamed in after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_streamingStart).count() << " ms - "
+		<< m_meshes.size() - firstMesh << " meshes, " << p_asset.textureCount << " textures" << std::endl);
+
+	return true;
+}
+
+void CScene::GetSceneDescription(SceneDescription& p_sceneDescription)
+{
+	// the meshes of an asset are placed together, the first one gives the transform
+	p_sceneDescription.assets.clear();
+	for (const LoadedAsset& loaded : m_loadedAssets)
+	{
+		SceneDescription::Asset asset{ loaded.path, loaded.flipUV, nm::Transform() };
+		if (loaded.meshCount > 0)
+			asset.transform = m_meshes[loaded.firstMesh]->GetTransform();
+		p_sceneDescription.assets.push_back(asset);
+	}
+
+	// assets are committed in the order the description lists them, the rest are still streaming in
+	for (size_t i = m_committedAssets; i < m_streamingAssets.size(); i++)
+		p_sceneDescription.assets.push_back(m_streamingAssets[i]);
+
+	p_sceneDescription.lights.clear();
+	for (CLight* light : m_sceneLights->GetLights())
+		p_sceneDescription.lights.push_back(SceneDescription::Light{ light->GetType(), light->GetBaseName(), light->IsCastsShadow(), light->GetColor(), light->GetTransform() });
+}
+
+// The materials of the loaded assets give their textures as p_firstSlot plus the position in the texture list. Textures
+// with the content and usage of a registered one, found by the loader, here or earlier in the list, are neither uploaded
+// nor given a slot of their own, the materials are pointed at the registered slot. The rest go through the ingester,
+// which decodes and compresses them on its workers while this thread records their uploads
+bool CScene::LoadSceneTextures(CVulkanRHI* p_rhi, SceneRaw& p_sceneRaw, uint32_t p_firstSlot, CVulkanRHI::BufferList& p_stgList, CVulkanRHI::CommandBuffer& p_cmdBfr)
+{
+	// Repeats within the list in the same usage are staged after the first one and share its slot, they are never
+	// decoded. Neither are those registered already, the loader only finds those whose usage it knows
+	std::set<std::pair<uint64_t, TextureUsage>> listedContent;
+	for (auto& tex : p_sceneRaw.textureList)
+	{
+		if (tex.contentHash != 0 && (!listedContent.insert({ tex.contentHash, tex.usage }).second
+			|| m_textureRegistry.Find(tex.contentHash, tex.usage) != MAX_SUPPORTED_TEXTURES))
+		{
+			uint64_t contentHash = tex.contentHash;
+			TextureUsage usage = tex.usage;
 			FreeRawImage(tex);
+			tex.contentHash = contentHash;
+			tex.usage = usage;
+		}
+	}
+
+	std::vector<uint32_t> slots(p_sceneRaw.textureList.size(), MAX_SUPPORTED_TEXTURES);
+	uint32_t sharedCount = 0;
+	auto stageTexture = [&](size_t p_index, ImageRaw& p_tex)
+	{
+		if (p_tex.contentHash != 0)
+		{
+			slots[p_index] = m_textureRegistry.Acquire(p_tex.contentHash, p_tex.usage);
+			if (slots[p_index] != MAX_SUPPORTED_TEXTURES)
+			{
+				sharedCount++;
+				return true;
+			}
+		}
+
+		// the render thread reads the list while the scene streams in
+		std::lock_guard<std::mutex> lock(m_sceneTexturesMutex);
+		if (CanUploadTexture(p_rhi, p_tex))
+		{
+			// Streamable textures are loaded with their tail mips, the streamer takes the rest of the chain
+			uint32_t tailMip = m_textureStreamer.GetTailMip(p_tex);
+			std::string name = p_tex.name;
+			TextureUsage usage = p_tex.usage;
+
+			CVulkanRHI::Buffer stg;
+			RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateTexture(p_rhi, stg, &p_tex, VK_FORMAT_R8G8B8A8_UNORM, p_cmdBfr, p_tex.name, -1, tailMip));
+			p_stgList.push_back(stg);
+
+			uint32_t textureId = (uint32_t)m_sceneTextures->GetTextures().size() - 1;
+			if (tailMip > 0)
+				m_textureStreamer.Register(textureId - TextureType::tt_scene, p_tex, m_sceneTextures->GetTexture(textureId));
+
+			if (p_tex.contentHash != 0)
+				m_textureRegistry.Add(p_tex.contentHash, usage, textureId - TextureType::tt_scene, name);
+		}
+		else
+		{
+			m_sceneTextures->PushBackPreLoadedTexture(TextureType::tt_default);
+		}
 
-		sceneraw.textureList.clear();
+		slots[p_index] = (uint32_t)m_sceneTextures->GetTextures().size() - 1 - TextureType::tt_scene;
+		return true;
+	};
+
+	RETURN_FALSE_IF_FALSE(m_textureIngester.Ingest(p_sceneRaw.textureList, &m_textureCompressor, stageTexture));
+
+	for (auto& material : p_sceneRaw.materialsList)
+	{
+		for (uint32_t* id : { &material.color_id, &material.normal_id, &material.roughMetal_id, &material.emissive_id })
+		{
+			if (*id != MAX_SUPPORTED_TEXTURES && *id >= p_firstSlot && *id - p_firstSlot < slots.size())
+				*id = slots[*id - p_firstSlot];
+		}
 	}
 
+	if (sharedCount > 0)
+		CLOG(sharedCount << " of " << p_sceneRaw.textureList.size() << " textures shared with loaded ones" << std::endl);
+
 	return true;
 }
 
@@ -1475,15 +2294,15 @@ bool CScene::LoadLights(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferLi
 bool CScene::LoadTLAS(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer& p_cmdBfr)
 {
 	// Needs one TLAS, that will be updated every frame if we are moving
-	// objects
-	size_t meshCount = m_meshes.size();
+	// objects. Sized for every instance the scene can hold, it is built
+	// again in place as the streamed assets add theirs
+	size_t meshCount = m_meshInstanceCount;
+	size_t maxMeshCount = MAX_SUPPORTED_MESH_INSTANCES;
 
-	// TODO: As of now, I am only packing transform data
-	// of the meshes I am rendering. Once instancing is 
-	// implemented, it ll get valuable to implement TLASs
-	// that reflect the feature
+	// One TLAS instance per mesh instance. All instances of a shared mesh
+	// reference the same BLAS
 	{
-		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(sizeof(VkAccelerationStructureInstanceKHR) * meshCount, m_instanceBuffer,
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(sizeof(VkAccelerationStructureInstanceKHR) * maxMeshCount, m_instanceBuffer,
 			VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "TLAS Instance Resource"));
 		
@@ -1508,7 +2327,7 @@ bool CScene::LoadTLAS(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList
 	buildInfo.pGeometries = &geometry;
 
 	VkAccelerationStructureBuildSizesInfoKHR sizeInfo{};
-	p_rhi->GetAccelerationStructureBuildSize(VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, (uint32_t)meshCount, &sizeInfo);
+	p_rhi->GetAccelerationStructureBuildSize(VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, (uint32_t)maxMeshCount, &sizeInfo);
 
 	std::clog << "LoadTLAS: Total Acceleration Structure Size: " << sizeInfo.accelerationStructureSize / 1048576.0f << " Mb." << std::endl;
 	std::clog << "LoadTLAS: Total Scratch Size: " << sizeInfo.buildScratchSize / 1048576.0f << " Mb." << std::endl;
@@ -1551,7 +2370,8 @@ bool CScene::LoadTLAS(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList
 	return true;
 }
 
-bool CScene::UpdateTLAS(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer& p_cmdBfr)
+// Refits the TLAS to the instances' transforms, or builds it again when instances were added
+bool CScene::UpdateTLAS(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer& p_cmdBfr, bool p_rebuild)
 {
 	RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer((uint8_t*)m_accStructInstances.data(), m_instanceBuffer));
 
@@ -1565,7 +2385,7 @@ bool CScene::UpdateTLAS(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer& p_cmdBfr)
 	VkAccelerationStructureBuildGeometryInfoKHR buildInfo = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
 	buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
 	buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
-	buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+	buildInfo.mode = p_rebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
 	buildInfo.geometryCount = 1;
 	buildInfo.pGeometries = &geometry;
 
@@ -1574,7 +2394,7 @@ bool CScene::UpdateTLAS(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer& p_cmdBfr)
 	buildInfo.scratchData.deviceAddress = p_rhi->GetBufferDeviceAddress(m_TLASscratchBuffer.descInfo.buffer);
 
 	VkAccelerationStructureBuildRangeInfoKHR buildRange = {};
-	buildRange.primitiveCount = (uint32_t)m_meshes.size();
+	buildRange.primitiveCount = m_meshInstanceCount;
 	const VkAccelerationStructureBuildRangeInfoKHR* buildRangePtr = &buildRange;
 
 	p_rhi->BuildAccelerationStructure(p_cmdBfr, 1, &buildInfo, &buildRangePtr);	
@@ -1584,15 +2404,16 @@ bool CScene::UpdateTLAS(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer& p_cmdBfr)
 
 bool CScene::CreateMeshUniformBuffer(CVulkanRHI* p_rhi)
 {
-	size_t uniBufize = MAX_SUPPORTED_MESHES * (
+	// One entry per mesh instance. Storage buffer since this outgrows the uniform buffer range limits
+	size_t uniBufize = MAX_SUPPORTED_MESH_INSTANCES * (
 		(sizeof(float) * 16)	// model matrix
 	+	(sizeof(float) * 16)	// transpose(inverse(model)) for transforming normal to world space
 		);
 
-	for (int i = 0; i < FRAME_BUFFER_COUNT; i++)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(uniBufize, m_meshInfo_uniform[i], 
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "mesh_uniform"));
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "mesh_uniform_" + std::to_string(i)));
 	}
 
 	return true;
@@ -1625,7 +2446,7 @@ bool CScene::CreateSceneDescriptors(CVulkanRHI* p_rhi)
 	//VkShaderStageFlags frag				= VK_SHADER_STAGE_FRAGMENT_BIT;
 	//VkShaderStageFlags vert_frag_comp	= VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 	//VkShaderStageFlags frag_comp		= VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
-	//for (uint32_t i = 0; i < FRAME_BUFFER_COUNT; i++)
+	//for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	//{
 	//	// Creating Descriptors and descriptor set based on following type and count
 	//	AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Scene_MeshInfo_Uniform,	1,						VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,				vertex_frag},	i);
@@ -1644,7 +2465,7 @@ bool CScene::CreateSceneDescriptors(CVulkanRHI* p_rhi)
 	//}
 
 	//// Calling for Descriptor Write and Update since we are using Bindless for this descriptor
-	//for (uint32_t i = 0; i < FRAME_BUFFER_COUNT; i++)
+	//for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	//{
 	//	BindlessWrite(i, BindingDest::bd_Scene_MeshInfo_Uniform,	&m_meshInfo_uniform[0].descInfo, 1);
 	//	BindlessWrite(i, BindingDest::bd_Env_Specular,				&m_sceneTextures->GetTexture(TextureType::tt_env_specular).descInfo, 1);
@@ -1689,31 +2510,40 @@ bool CScene::Create2DSceneDescriptors(CVulkanRHI* p_rhi)
 	
 	// Creating and Updating Scene Rasterizer Descriptors - Set 0
 	uint32_t rasterDescsetId = 0;
+	uint32_t bindlessCapacity = p_rhi->GetMaxBindlessTextures();
 	{
 		// Creating Descriptors and descriptor set based on following type and count
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Scene_MeshInfo_Uniform,	1,						VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,				vertex_frag},	rasterDescsetId);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Scene_MeshInfo_Uniform,	1,						VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,				vertex_frag},	rasterDescsetId);
 		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Env_Specular,				1,						VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,		frag_comp },	rasterDescsetId);
 		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Env_Diffuse,				1,						VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,		frag_comp },	rasterDescsetId);
 		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Brdf_Lut,					1,						VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,				frag_comp },	rasterDescsetId);
 		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Material_Storage,			1,						VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,				frag },			rasterDescsetId);
 		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Scene_Lights,				1,						VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,				vert_frag_comp},rasterDescsetId);	
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_SceneRead_TexArray,		MAX_SUPPORTED_TEXTURES,	VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,				frag },	        rasterDescsetId);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_SceneRead_TexArray,		bindlessCapacity,		VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,				frag },	        rasterDescsetId);
 		
-		// We are creating 2 descriptors because we have 2 frames in flights. And during 
-		// that process we need to update 1 uniform buffer while the 
-		// other is getting updated. Not doing this leads to undefined
-		// behavior.
-		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, rasterDescsetId, FRAME_BUFFER_COUNT, "SceneRasterDescriptorSet_"));
+		// We are creating one descriptor set per frame that can be in flight. The mesh info of a frame
+		// is updated while the GPU may still be reading the other frames' copies. Not doing this leads 
+		// to undefined behavior.
+		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, rasterDescsetId, MAX_FRAMES_IN_FLIGHT, "SceneRasterDescriptorSet_"));
 		
 		// Calling for Descriptor Write and Update since we are using Bindless for this descriptor
-		BindlessWrite(rasterDescsetId, BindingDest::bd_Scene_MeshInfo_Uniform,	&m_meshInfo_uniform[0].descInfo, 1);
+		const VkDescriptorBufferInfo* meshInfoPerFrame[MAX_FRAMES_IN_FLIGHT];
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			meshInfoPerFrame[i] = &m_meshInfo_uniform[i].descInfo;
+		BindlessWritePerCopy(rasterDescsetId, BindingDest::bd_Scene_MeshInfo_Uniform, meshInfoPerFrame);
 		BindlessWrite(rasterDescsetId, BindingDest::bd_Env_Specular,			&m_sceneTextures->GetTexture(TextureType::tt_env_specular).descInfo, 1);
 		BindlessWrite(rasterDescsetId, BindingDest::bd_Env_Diffuse,				&m_sceneTextures->GetTexture(TextureType::tt_env_diffuse).descInfo, 1);
 		BindlessWrite(rasterDescsetId, BindingDest::bd_Brdf_Lut,				&m_sceneTextures->GetTexture(TextureType::tt_brdfLut).descInfo, 1);
 		BindlessWrite(rasterDescsetId, BindingDest::bd_Material_Storage,		&m_material_storage.descInfo, 1);
 		BindlessWrite(rasterDescsetId, BindingDest::bd_Scene_Lights,			&m_light_storage.descInfo, 1);
-		BindlessWrite(rasterDescsetId, BindingDest::bd_SceneRead_TexArray,		imageInfoList.data(), (uint32_t)imageInfoList.size());
 		BindlessUpdate(p_rhi, rasterDescsetId);
+
+		// The texture array is written through the bindless table. Nothing is in flight yet, every copy takes the
+		// textures loaded so far right away
+		RETURN_FALSE_IF_FALSE(m_bindlessTextures.Create(p_rhi, GetDescriptorSetLayout(rasterDescsetId), BindingDest::bd_SceneRead_TexArray, bindlessCapacity));
+		RETURN_FALSE_IF_FALSE(m_bindlessTextures.Stage(imageInfoList.data(), (uint32_t)imageInfoList.size()));
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			RETURN_FALSE_IF_FALSE(m_bindlessTextures.Apply(p_rhi, *GetDescriptorSet(rasterDescsetId, i), i));
 	}
 
 	// Creating and Updating Scene Ray Tracing Descriptors - Set 1
@@ -1723,11 +2553,8 @@ bool CScene::Create2DSceneDescriptors(CVulkanRHI* p_rhi)
 		// Creating Descriptors and descriptor set based on following type and count
 		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Scene_TLAS,			1,						VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR,	frag_comp }, rayTracingDescsetId);
 
-		// We are creating 2 descriptors because we have 2 frames in flights. And during 
-		// that process we need to update 1 uniform buffer while the 
-		// other is getting updated. Not doing this leads to undefined
-		// behavior.
-		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, rayTracingDescsetId, FRAME_BUFFER_COUNT, "SceneRayTraceDescriptorSet_"));
+		// One descriptor set per frame that can be in flight, like the raster set
+		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, rayTracingDescsetId, MAX_FRAMES_IN_FLIGHT, "SceneRayTraceDescriptorSet_"));
 
 		// Calling for Descriptor Write and Update since we are using Bindless for this descriptor
 		BindlessWrite(rayTracingDescsetId, BindingDest::bd_Scene_TLAS, &m_TLAS, 1);
@@ -1807,14 +2634,16 @@ bool CScene::AddEntity(CVulkanRHI* p_rhi, std::string p_path)
 				// Spawning a new CPU thread to load the asset to RAM, prepare buffers and textures and 
 				// upload to GPU. Wait for Command buffer execution to complete.
 				std::thread assetLoaderThread([=]() {
+					PROFILE_THREAD("Asset Loader");
+
 					CVulkanRHI::CommandBuffer cmdBfr;
 					CVulkanRHI::BufferList stgList;
 
 					std::string debugMarker = "Entity Loading";
 					RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffer(m_assetLoaderCommandPool, &cmdBfr, debugMarker));
 
-					std::vector<VkDescriptorImageInfo> imageInfoList;
-					uint32_t arrayDestIndex = (uint32_t)m_sceneTextures->GetTextures().size() - TextureType::tt_scene;
+					uint32_t firstNewTexture = (uint32_t)m_sceneTextures->GetTextures().size();
+					uint32_t firstNewMesh = (uint32_t)m_meshes.size();
 					{
 						SceneRaw sceneraw;
 						sceneraw.materialOffset = m_materialOffset;
@@ -1823,6 +2652,9 @@ bool CScene::AddEntity(CVulkanRHI* p_rhi, std::string p_path)
 						ObjLoadData loadData{};
 						loadData.flipUV = false;
 						loadData.loadMeshOnly = false;
+						loadData.textureRegistry = &m_textureRegistry;
+						loadData.deferDecode = true;
+						loadData.meshDecoder = &m_meshDecoder;
 
 						if (fileExtn == "gltf" || fileExtn == "glb")
 						{
@@ -1840,19 +2672,26 @@ bool CScene::AddEntity(CVulkanRHI* p_rhi, std::string p_path)
 							return false;
 						}
 
-						m_textureOffset += sceneraw.textureOffset;
 						m_materialOffset += sceneraw.materialOffset;
 
 						// Load vertex and index buffers
 						for (auto& meshraw : sceneraw.meshList)
 						{
+							if (m_meshInstanceCount + meshraw.instances.size() > MAX_SUPPORTED_MESH_INSTANCES)
+							{
+								std::cerr << "Max Supported Mesh Instances has been exceeded. Loading failed." << std::endl;
+								return false;
+							}
+
 							CRenderableMesh* mesh = nullptr;
 							if (p_rhi->IsRayTracingEnabled())
-								mesh = new CRayTracingRenderable(meshraw.name, (uint32_t)m_meshes.size(), meshraw.transform, &m_accStructInstances[m_meshes.size()]);
+								mesh = new CRayTracingRenderable(meshraw.name, (uint32_t)m_meshes.size(), m_meshInstanceCount, meshraw.transform, &m_accStructInstances[m_meshInstanceCount]);
 							else
-								mesh = new CRenderableMesh(meshraw.name, (uint32_t)m_meshes.size(), meshraw.transform);
+								mesh = new CRenderableMesh(meshraw.name, (uint32_t)m_meshes.size(), m_meshInstanceCount, meshraw.transform);
 
 							mesh->m_submeshes = meshraw.submeshes;
+							mesh->SetInstances(meshraw);
+							m_meshInstanceCount += (uint32_t)meshraw.instances.size();
 
 							std::clog << "Setting Bounding Volume" << std::endl;
 							BVolume* bVol = new BBox(meshraw.bbox);
@@ -1869,26 +2708,15 @@ bool CScene::AddEntity(CVulkanRHI* p_rhi, std::string p_path)
 
 						m_assetLoadingTracker.progress = 0.4f;
 						// Load textures
-						for (const auto& tex : sceneraw.textureList)
+						if (firstNewTexture - TextureType::tt_scene + sceneraw.textureList.size() > m_bindlessTextures.GetCapacity())
 						{
-							CVulkanRHI::Image img;
-							{
-								if (tex.raw != nullptr)
-								{
-									CVulkanRHI::Buffer stg;
-									RETURN_FALSE_IF_FALSE(m_sceneTextures->CreateTexture(p_rhi, stg, &tex, VK_FORMAT_R8G8B8A8_UNORM, cmdBfr, tex.name));
-									stgList.push_back(stg);
-
-									uint32_t texIndex = (uint32_t)m_sceneTextures->GetTextures().size() - 1;
-									imageInfoList.push_back(m_sceneTextures->GetTextures()[texIndex].descInfo);
-								}
-								else
-								{
-									m_sceneTextures->PushBackPreLoadedTexture(TextureType::tt_default);
-								}
-							}
+							std::cerr << "Max Supported Texture Count has been exceeded. Loading failed." << std::endl;
+							return false;
 						}
 
+						RETURN_FALSE_IF_FALSE(LoadSceneTextures(p_rhi, sceneraw, m_textureOffset, stgList, cmdBfr));
+						m_textureOffset = (uint32_t)m_sceneTextures->GetTextures().size() - TextureType::tt_scene;
+
 						m_assetLoadingTracker.progress = 0.5;
 						// Load Materials
 						std::copy(sceneraw.materialsList.begin(), sceneraw.materialsList.end(), std::back_inserter(m_materialsList));
@@ -1944,22 +2772,18 @@ bool CScene::AddEntity(CVulkanRHI* p_rhi, std::string p_path)
 					p_rhi->ResetCommandPool(m_assetLoaderCommandPool);
 					m_assetLoadingTracker.progress = 1.0f;
 					
-					// Update the bindless descriptors
-					std::clog << "Updating Scene's Bindless Texture Descriptors" << std::endl;
-					if(!imageInfoList.empty())
+					// Stage the new slots of the bindless table, default textures standing in for missing ones included.
+					// The descriptor set copies are written by the render thread, each at the start of its next frame
+					std::clog << "Staging Scene's Bindless Texture Descriptors" << std::endl;
 					{
-						for (uint32_t i = 0; i < FRAME_BUFFER_COUNT; i++)
-						{
-							// TODO: I have no idea why, but this is causing a crash on debug. Release works fine.
-							// m_DescData[][BindingDest::bd_CubeMap_Texture].imgDesinfo is null right after control returns from
-							// Creating and loading textures - m_sceneTextures->CreateTexture 
-							BindlessWrite(i, BindingDest::bd_Env_Specular, &m_sceneTextures->GetTexture(TextureType::tt_env_specular).descInfo, 1);
-							BindlessWrite(i, BindingDest::bd_Env_Diffuse, &m_sceneTextures->GetTexture(TextureType::tt_env_diffuse).descInfo, 1);
-							BindlessWrite(i, BindingDest::bd_Brdf_Lut, &m_sceneTextures->GetTexture(TextureType::tt_brdfLut).descInfo, 1);
-							BindlessWrite(i, BindingDest::bd_SceneRead_TexArray, imageInfoList.data(), (uint32_t)imageInfoList.size(), arrayDestIndex);
-							BindlessUpdate(p_rhi, i);
-						}
-					}					
+						std::vector<VkDescriptorImageInfo> imageInfoList;
+						for (uint32_t i = firstNewTexture; i < (uint32_t)m_sceneTextures->GetTextures().size(); i++)
+							imageInfoList.push_back(m_sceneTextures->GetTextures()[i].descInfo);
+
+						RETURN_FALSE_IF_FALSE(m_bindlessTextures.Stage(imageInfoList.data(), (uint32_t)imageInfoList.size()));
+					}
+
+					m_loadedAssets.push_back(LoadedAsset{ SceneDescription::MakeAssetPath(p_path), false, firstNewMesh, (uint32_t)m_meshes.size() - firstNewMesh });
 
 					std::clog << "Asset Loading Successful." << std::endl;
 					m_assetLoadingTracker.state = AssetLoadingState::als_RequestComplete;
@@ -2148,11 +2972,11 @@ CLoadableAssets::~CLoadableAssets()
 {
 }
 
-bool CLoadableAssets::Create(CVulkanRHI* p_rhi, const CFixedAssets& p_fixedAssets, const CVulkanRHI::CommandPool& p_cmdPool)
+bool CLoadableAssets::Create(CVulkanRHI* p_rhi, const CFixedAssets& p_fixedAssets, const CVulkanRHI::CommandPool& p_cmdPool, const SceneDescription& p_sceneDescription)
 {
 	const CVulkanRHI::SamplerList* samplers = p_fixedAssets.GetSamplers();
 
-	RETURN_FALSE_IF_FALSE(m_scene.Create(p_rhi, samplers, p_cmdPool));
+	RETURN_FALSE_IF_FALSE(m_scene.Create(p_rhi, samplers, p_cmdPool, p_sceneDescription));
 	RETURN_FALSE_IF_FALSE(m_ui.Create(p_rhi, p_cmdPool));
 	
 	CFixedBuffers& fixeBuffer = *const_cast<CFixedBuffers*>(p_fixedAssets.GetFixedBuffers());
@@ -2180,8 +3004,11 @@ bool CLoadableAssets::Update(CVulkanRHI* p_rhi, const LoadedUpdateData& p_update
 CRenderTargets::CRenderTargets()
 	: CTextures(CRenderTargets::RenderTargetId::rt_max)
 	, CUIParticipant(CUIParticipant::ParticipationType::pt_onSelect, CUIParticipant::UIDPanelType::uipt_same)
+	, m_requiredMemory(0)
+	, m_allocatedMemory(0)
 {
 	m_rtID.resize(CRenderTargets::RenderTargetId::rt_max);
+	m_shaderLayouts.resize(CRenderTargets::RenderTargetId::rt_max, VK_IMAGE_LAYOUT_UNDEFINED);
 }
 
 CRenderTargets::~CRenderTargets()
@@ -2205,18 +3032,99 @@ bool CRenderTargets::Create(CVulkanRHI* p_rhi)
 
 	//uint32_t maxMip = static_cast<uint32_t>(std::floor(std::log2(max(fullResWidth, fullResHeight)) + 1));
 
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_PrimaryDepth,			VK_FORMAT_D32_SFLOAT,			fullResWidth, fullResHeight, 1,			shaderRead,	"primary_depth",		sample_depth));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Position,				VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"position",				sample_storage_color));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Normal,					VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"normal",				sample_storage_color));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Albedo,					VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"albedo",				sample_storage_color));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_SSAO_Blur,				VK_FORMAT_R16G16_SFLOAT,		fullResWidth, fullResHeight, 1,			general,	"ssao_and_blur",		sample_storage_color));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_DirectionalShadowDepth,  VK_FORMAT_D32_SFLOAT,			4096, 4096,					 1,			shaderRead,	"directional_shadow",	sample_depth));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_PrimaryColor,			VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"primary_color",		sample_storage_color_src));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_RoughMetal,				VK_FORMAT_R16G16_SFLOAT,		fullResWidth, fullResHeight, 1,			general,	"Rough_Metal",			sample_storage_color));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Motion,					VK_FORMAT_R16G16_SFLOAT,		fullResWidth, fullResHeight, 1,			general,	"Motion",				sample_storage_color));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_SSReflection,			VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"ss_reflection",		sample_storage_color_dest));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_SSRBlur,					VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"ssr_blur",				sample_storage_color_src_dest));
-	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Prev_PrimaryColor,		VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"prev_primary_color",	sample_storage_color_dest));
+	// render targets in a memory slot get their memory bound once all of them exist
+	std::vector<bool> own(rt_max, true);
+	for (uint32_t i = 0; i < (uint32_t)m_memorySlots.size() && i < rt_max; i++)
+		own[i] = (m_memorySlots[i] == UINT32_MAX);
+
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_PrimaryDepth,			VK_FORMAT_D32_SFLOAT,			fullResWidth, fullResHeight, 1,			shaderRead,	"primary_depth",		sample_depth, own[rt_PrimaryDepth]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Position,				VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"position",				sample_storage_color, own[rt_Position]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Normal,					VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"normal",				sample_storage_color, own[rt_Normal]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Albedo,					VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"albedo",				sample_storage_color, own[rt_Albedo]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_SSAO_Blur,				VK_FORMAT_R16G16_SFLOAT,		fullResWidth, fullResHeight, 1,			general,	"ssao_and_blur",		sample_storage_color, own[rt_SSAO_Blur]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_DirectionalShadowDepth,  VK_FORMAT_D32_SFLOAT,			4096, 4096,					 1,			shaderRead,	"directional_shadow",	sample_depth, own[rt_DirectionalShadowDepth]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_PrimaryColor,			VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"primary_color",		sample_storage_color_src, own[rt_PrimaryColor]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_RoughMetal,				VK_FORMAT_R16G16_SFLOAT,		fullResWidth, fullResHeight, 1,			general,	"Rough_Metal",			sample_storage_color, own[rt_RoughMetal]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Motion,					VK_FORMAT_R16G16_SFLOAT,		fullResWidth, fullResHeight, 1,			general,	"Motion",				sample_storage_color, own[rt_Motion]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_SSReflection,			VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"ss_reflection",		sample_storage_color_dest, own[rt_SSReflection]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_SSRBlur,					VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"ssr_blur",				sample_storage_color_src_dest, own[rt_SSRBlur]));
+	RETURN_FALSE_IF_FALSE(CreateRenderTarget(p_rhi, rt_Prev_PrimaryColor,		VK_FORMAT_R32G32B32A32_SFLOAT,	fullResWidth, fullResHeight, 1,			general,	"prev_primary_color",	sample_storage_color_dest, own[rt_Prev_PrimaryColor]));
+
+	RETURN_FALSE_IF_FALSE(BindAliasedMemory(p_rhi));
+
+	for (uint32_t i = 0; i < rt_max; i++)
+		m_shaderLayouts[i] = m_textures[i].descInfo.imageLayout;
+
+	return true;
+}
+
+bool CRenderTargets::BindAliasedMemory(CVulkanRHI* p_rhi)
+{
+	m_requiredMemory = 0;
+	m_allocatedMemory = 0;
+
+	uint32_t slotCount = 0;
+	for (uint32_t i = 0; i < (uint32_t)m_memorySlots.size() && i < rt_max; i++)
+	{
+		if (m_memorySlots[i] != UINT32_MAX)
+			slotCount = (std::max)(slotCount, m_memorySlots[i] + 1);
+	}
+
+	for (uint32_t i = 0; i < rt_max; i++)
+	{
+		VkMemoryRequirements memReq{};
+		p_rhi->GetImageMemoryRequirements(m_textures[i].image, memReq);
+		m_requiredMemory += memReq.size;
+		if (i >= m_memorySlots.size() || m_memorySlots[i] == UINT32_MAX)
+			m_allocatedMemory += memReq.size;
+	}
+
+	for (uint32_t slot = 0; slot < slotCount; slot++)
+	{
+		// the memory has to be large enough for the largest render target and of a type all of them accept
+		VkMemoryRequirements slotReq{};
+		slotReq.memoryTypeBits = UINT32_MAX;
+		std::vector<uint32_t> members;
+		for (uint32_t i = 0; i < (uint32_t)m_memorySlots.size() && i < rt_max; i++)
+		{
+			if (m_memorySlots[i] != slot)
+				continue;
+
+			VkMemoryRequirements memReq{};
+			p_rhi->GetImageMemoryRequirements(m_textures[i].image, memReq);
+			slotReq.size			= (std::max)(slotReq.size, memReq.size);
+			slotReq.alignment		= (std::max)(slotReq.alignment, memReq.alignment);
+			slotReq.memoryTypeBits	&= memReq.memoryTypeBits;
+			members.push_back(i);
+		}
+
+		if (members.empty())
+			continue;
+
+		if (slotReq.memoryTypeBits == 0)
+		{
+			std::clog << "CRenderTargets::BindAliasedMemory - No memory type shared by the render targets of slot " << slot << ", not aliasing them" << std::endl;
+			for (uint32_t i : members)
+			{
+				VkMemoryRequirements memReq{};
+				p_rhi->GetImageMemoryRequirements(m_textures[i].image, memReq);
+				RETURN_FALSE_IF_FALSE(p_rhi->AllocateMemory(memReq, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_textures[i].devMem));
+				RETURN_FALSE_IF_FALSE(p_rhi->BindRenderTargetMemory(m_textures[i], m_textures[i].devMem));
+				m_allocatedMemory += memReq.size;
+			}
+			continue;
+		}
+
+		VkDeviceMemory devMem = VK_NULL_HANDLE;
+		RETURN_FALSE_IF_FALSE(p_rhi->AllocateMemory(slotReq, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, devMem));
+		m_aliasedMemory.push_back(devMem);
+		m_allocatedMemory += slotReq.size;
+
+		for (uint32_t i : members)
+			RETURN_FALSE_IF_FALSE(p_rhi->BindRenderTargetMemory(m_textures[i], devMem));
+	}
+
+	std::clog << "CRenderTargets::BindAliasedMemory - " << (m_allocatedMemory >> 20) << " MB allocated for " << (m_requiredMemory >> 20) << " MB of render targets" << std::endl;
 
 	return true;
 }
@@ -2224,15 +3132,42 @@ bool CRenderTargets::Create(CVulkanRHI* p_rhi)
 void CRenderTargets::Destroy(CVulkanRHI* p_rhi)
 {
 	CTextures::Destroy(p_rhi);
+
+	for (auto& devMem : m_aliasedMemory)
+		p_rhi->FreeDeviceMemory(devMem);
+	m_aliasedMemory.clear();
+}
+
+bool CRenderTargets::IsTransient(RenderTargetId p_id)
+{
+	switch (p_id)
+	{
+	case rt_Position:
+	case rt_Normal:
+	case rt_Albedo:
+	case rt_SSAO_Blur:
+	case rt_RoughMetal:
+	case rt_Motion:
+	case rt_SSReflection:
+	case rt_SSRBlur:
+		return true;
+	default:
+		// depth and shadow are read back by later frames' passes, the color history by TAA
+		return false;
+	}
 }
 
 void CRenderTargets::Show(CVulkanRHI* p_rhi)
 {
 	CVulkanRHI::ImageList rendTargetList = GetTextures();
 	ImGui::Indent();
+	ImGui::Text("Memory: %.1f MB allocated for %.1f MB", (float)m_allocatedMemory / (1024.0f * 1024.0f), (float)m_requiredMemory / (1024.0f * 1024.0f));
 	for (int i = 0; i < CRenderTargets::RenderTargetId::rt_max; i++)
 	{
 		std::string rtName = GetRenderTargetIDinString((CRenderTargets::RenderTargetId)i);
+		// aliased render targets only hold valid content between their first and last use in the frame
+		if (i < (int)m_memorySlots.size() && m_memorySlots[i] != UINT32_MAX)
+			rtName += " (aliased)";
 		CVulkanCore::Image renderTarget = rendTargetList[i];
 		if (ImGui::TreeNode(rtName.c_str()))
 		{
@@ -2323,6 +3258,83 @@ CFixedBuffers::~CFixedBuffers()
 {
 }
 
+// The members of the uniform data a scene file records; the camera and the resolution are set every frame
+struct RenderSetting
+{
+	typedef CFixedBuffers::PrimaryUniformData Data;
+
+	const char*						name;
+	float Data::*					floatMember;
+	int Data::*						intMember;
+	uint32_t Data::*				uintMember;
+
+	RenderSetting(const char* p_name, float Data::* p_member) : name(p_name), floatMember(p_member), intMember(nullptr), uintMember(nullptr) {}
+	RenderSetting(const char* p_name, int Data::* p_member) : name(p_name), floatMember(nullptr), intMember(p_member), uintMember(nullptr) {}
+	RenderSetting(const char* p_name, uint32_t Data::* p_member) : name(p_name), floatMember(nullptr), intMember(nullptr), uintMember(p_member) {}
+
+	float Get(const Data& p_data) const
+	{
+		return floatMember ? p_data.*floatMember : intMember ? (float)(p_data.*intMember) : (float)(p_data.*uintMember);
+	}
+
+	void Set(Data& p_data, float p_value) const
+	{
+		if (floatMember)
+			p_data.*floatMember = p_value;
+		else if (intMember)
+			p_data.*intMember = (int)p_value;
+		else
+			p_data.*uintMember = (uint32_t)p_value;
+	}
+};
+
+static const RenderSetting s_renderSettings[] =
+{
+	  RenderSetting("toneMappingSelection",		&RenderSetting::Data::toneMappingSelection)
+	, RenderSetting("toneMappingExposure",		&RenderSetting::Data::toneMappingExposure)
+	, RenderSetting("enable_Shadow_RT_PCF",		&RenderSetting::Data::enable_Shadow_RT_PCF)
+	, RenderSetting("enableIBL",				&RenderSetting::Data::enableIBL)
+	, RenderSetting("pbrAmbientFactor",			&RenderSetting::Data::pbrAmbientFactor)
+	, RenderSetting("enableSSAO",				&RenderSetting::Data::enableSSAO)
+	, RenderSetting("ssaoKernelSize",			&RenderSetting::Data::ssaoKernelSize)
+	, RenderSetting("ssaoRadius",				&RenderSetting::Data::ssaoRadius)
+	, RenderSetting("biasSSAO",					&RenderSetting::Data::biasSSAO)
+	, RenderSetting("ssrEnable",				&RenderSetting::Data::ssrEnable)
+	, RenderSetting("ssrMaxDistance",			&RenderSetting::Data::ssrMaxDistance)
+	, RenderSetting("ssrResolution",			&RenderSetting::Data::ssrResolution)
+	, RenderSetting("ssrThickness",				&RenderSetting::Data::ssrThickness)
+	, RenderSetting("ssrSteps",					&RenderSetting::Data::ssrSteps)
+	, RenderSetting("taaResolveWeight",			&RenderSetting::Data::taaResolveWeight)
+	, RenderSetting("taaUseMotionVectors",		&RenderSetting::Data::taaUseMotionVectors)
+	, RenderSetting("taaFlickerCorectionMode",	&RenderSetting::Data::taaFlickerCorectionMode)
+	, RenderSetting("taaReprojectionFilter",	&RenderSetting::Data::taaReprojectionFilter)
+};
+
+void CFixedBuffers::GetSettings(std::vector<SceneDescription::Setting>& p_settings) const
+{
+	p_settings.clear();
+	for (const RenderSetting& setting : s_renderSettings)
+		p_settings.push_back(SceneDescription::Setting{ setting.name, setting.Get(m_primaryUniformData) });
+}
+
+void CFixedBuffers::SetSettings(const std::vector<SceneDescription::Setting>& p_settings)
+{
+	for (const SceneDescription::Setting& setting : p_settings)
+	{
+		const RenderSetting* known = nullptr;
+		for (const RenderSetting& renderSetting : s_renderSettings)
+		{
+			if (setting.name == renderSetting.name)
+				known = &renderSetting;
+		}
+
+		if (known)
+			known->Set(m_primaryUniformData, setting.value);
+		else
+			std::cerr << "CFixedBuffers::SetSettings Error: Unknown setting " << setting.name << ", ignored" << std::endl;
+	}
+}
+
 bool CFixedBuffers::Create(CVulkanRHI* p_rhi)
 {
 	size_t primaryUniformBufferSize =
@@ -2372,12 +3384,13 @@ bool CFixedBuffers::Create(CVulkanRHI* p_rhi)
 	VkMemoryPropertyFlags hv = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
 
 
-	RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, uniform,		hv_hc,	primaryUniformBufferSize, "primary_uniform_0",	fb_PrimaryUniform_0));
-	RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, uniform,		hv_hc,	primaryUniformBufferSize, "primary_uniform_1",	fb_PrimaryUniform_1));
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, uniform,	hv_hc,	primaryUniformBufferSize, "primary_uniform_" + std::to_string(i),	fb_PrimaryUniform_0 + i));
+		RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, uniform,	hv_hc,	debugDrawUniformSize	, "debug_uniform_" + std::to_string(i),		fb_DebugUniform_0 + i));
+	}
 	RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, dest,			hv,		objPickerBufferSize		, "pick_read",			fb_ObjectPickerRead));
 	RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, src_storage,	hv,		objPickerBufferSize		, "pick_write",			fb_ObjectPickerWrite));
-	RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, uniform,		hv_hc,	debugDrawUniformSize	, "debug_uniform_0",	fb_DebugUniform_0));
-	RETURN_FALSE_IF_FALSE(CreateBuffer(p_rhi, uniform,		hv_hc,	debugDrawUniformSize	, "debug_uniform_1",	fb_DebugUniform_1));
 
 	return true;
 }
@@ -2408,7 +3421,7 @@ void CFixedBuffers::Destroy(CVulkanRHI* p_rhi)
 	CBuffers::Destroy(p_rhi);
 }
 
-bool CFixedBuffers::Update(CVulkanRHI* p_rhi, uint32_t p_scId)
+bool CFixedBuffers::Update(CVulkanRHI* p_rhi, uint32_t p_frameIdx)
 {
 	float* cameraViewProj					= const_cast<float*>(&m_primaryUniformData.cameraViewProj.column[0][0]);
 	float* cameraJitteredViewProj			= const_cast<float*>(&m_primaryUniformData.cameraJitteredViewProj.column[0][0]);
@@ -2462,7 +3475,7 @@ bool CFixedBuffers::Update(CVulkanRHI* p_rhi, uint32_t p_scId)
 	uniformValues.push_back((float)m_primaryUniformData.UNASSIGNED_float2);																					// UNASSIGINED_2
 	
 	uint8_t* data							= (uint8_t*)(uniformValues.data());
-	RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer(data, m_buffers[p_scId], false));
+	RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer(data, m_buffers[fb_PrimaryUniform_0 + p_frameIdx], false));
 		
 	return true;
 }
@@ -2496,7 +3509,7 @@ void CFixedAssets::Destroy(CVulkanRHI* p_rhi)
 
 bool CFixedAssets::Update(CVulkanRHI* p_rhi, const FixedUpdateData& p_updateData)
 {
-	RETURN_FALSE_IF_FALSE(m_fixedBuffers.Update(p_rhi, p_updateData.swapchainIndex));
+	RETURN_FALSE_IF_FALSE(m_fixedBuffers.Update(p_rhi, p_updateData.frameIndex));
 	return true;
 }
 
@@ -2540,7 +3553,7 @@ bool CFixedAssets::CreateSamplers(CVulkanRHI* p_rhi)
 }
 
 CPrimaryDescriptors::CPrimaryDescriptors()
-	:CDescriptor(CVulkanRHI::DescriptorBindFlag::Bindless, FRAME_BUFFER_COUNT)
+	:CDescriptor(CVulkanRHI::DescriptorBindFlag::Bindless, MAX_FRAMES_IN_FLIGHT)
 {
 }
 
@@ -2595,32 +3608,20 @@ bool CPrimaryDescriptors::Create(CVulkanRHI* p_rhi, CFixedAssets& p_fixedAssets,
 	VkDescriptorType storage_buf	= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	VkDescriptorType sampled_img	= VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
 	VkDescriptorType storage_img	= VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Gloabl_Uniform,			1,								uniform,		all},			0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Linear_Sampler,			1,								sampler,		all},			0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Nearest_Sampler,			1,								sampler,		all},			0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_ObjPicker_Storage,			1,								storage_buf,	fragment},		0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_SSAOKernel_Storage,		1,								storage_buf,	compute,},		0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_PrimaryRead_TexArray,		CReadOnlyTextures::tr_max,		sampled_img,	compute},		0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_RTs_StorageImages,			STORE_MAX_RENDER_TARGETS,		storage_img,	frag_compute},	0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_RTs_SampledImages,			SAMPLE_MAX_RENDER_TARGETS,		sampled_img,	frag_compute},	0);
-		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, 0, "PrimaryDescriptors_0"));
-	}
-
-	{
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Gloabl_Uniform,			1,								uniform,		all},			1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Linear_Sampler,			1,								sampler,		all},			1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Nearest_Sampler,			1,								sampler,		all},			1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_ObjPicker_Storage,			1,								storage_buf,	fragment},		1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_SSAOKernel_Storage,		1,								storage_buf,	compute},		1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_PrimaryRead_TexArray,		CReadOnlyTextures::tr_max,		sampled_img,	compute},		1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_RTs_StorageImages,			STORE_MAX_RENDER_TARGETS,		storage_img,	frag_compute},  1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_RTs_SampledImages,			SAMPLE_MAX_RENDER_TARGETS,		sampled_img,	frag_compute},	1);
-		
-		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, 1, "PrimaryDescriptors_1"));
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Gloabl_Uniform,			1,								uniform,		all},			i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Linear_Sampler,			1,								sampler,		all},			i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Nearest_Sampler,			1,								sampler,		all},			i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_ObjPicker_Storage,			1,								storage_buf,	fragment},		i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_SSAOKernel_Storage,		1,								storage_buf,	compute},		i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_PrimaryRead_TexArray,		CReadOnlyTextures::tr_max,		sampled_img,	compute},		i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_RTs_StorageImages,			STORE_MAX_RENDER_TARGETS,		storage_img,	frag_compute},	i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_RTs_SampledImages,			SAMPLE_MAX_RENDER_TARGETS,		sampled_img,	frag_compute},	i);
+		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, i, "PrimaryDescriptors_" + std::to_string(i)));
 	}
 
-	for (uint32_t i = 0; i < FRAME_BUFFER_COUNT; i++)
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		BindlessWrite(i, BindingDest::bd_Gloabl_Uniform, &fixedBuf->GetBuffer(CFixedBuffers::fb_PrimaryUniform_0 + i).descInfo);
 		BindlessWrite(i, BindingDest::bd_Linear_Sampler, &(*samplers)[s_Linear].descInfo);
@@ -2642,7 +3643,7 @@ void CPrimaryDescriptors::Destroy(CVulkanRHI* p_rhi)
 }
 
 CRenderableDebug::CRenderableDebug()
-	: CDescriptor(false/* is bindless */, FRAME_BUFFER_COUNT)
+	: CDescriptor(false/* is bindless */, MAX_FRAMES_IN_FLIGHT)
 	, CRenderable(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0)
 {
 }
@@ -2679,7 +3680,7 @@ bool CRenderableDebug::Update()
 	return false;
 }
 
-bool CRenderableDebug::PreDrawInstanced(CVulkanRHI* p_rhi, uint32_t p_scIdx, const CFixedBuffers* p_fixedBuffers, 
+bool CRenderableDebug::PreDrawInstanced(CVulkanRHI* p_rhi, uint32_t p_frameIdx, const CFixedBuffers* p_fixedBuffers, 
 	const CSceneGraph* p_sceneGraph, CVulkanRHI::CommandBuffer& p_cmdBfr)
 {
 	bool						bufferStale = false;
@@ -2795,12 +3796,11 @@ bool CRenderableDebug::PreDrawInstanced(CVulkanRHI* p_rhi, uint32_t p_scIdx, con
 		bufferStale = true;
 	}
 
-	// Irrespective of the swap chain buffer id, nuke both uniform buffers and reload them
+	// Only this frame's uniform buffer is reloaded, the other frames' copies might still be read by the GPU
 	if (bufferStale && !allSelectedTransformData.empty())
 	{
 		uint8_t* data = (uint8_t*)(allSelectedTransformData.data());
-		RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer(data, p_fixedBuffers->GetBuffer(CFixedBuffers::fb_DebugUniform_0), true));
-		RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer(data, p_fixedBuffers->GetBuffer(CFixedBuffers::fb_DebugUniform_1), true));
+		RETURN_FALSE_IF_FALSE(p_rhi->WriteToBuffer(data, p_fixedBuffers->GetBuffer(CFixedBuffers::fb_DebugUniform_0 + p_frameIdx), true));
 	}
 
 	return m_instanceCount > 0;
@@ -2815,16 +3815,11 @@ void CRenderableDebug::Destroy(CVulkanRHI* p_rhi)
 bool CRenderableDebug::CreateDebugDescriptors(CVulkanRHI* p_rhi, const CFixedBuffers* p_fixedBuffers)
 {
 	VkShaderStageFlags vertex_frag = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		CVulkanRHI::Buffer uniformBuffer = p_fixedBuffers->GetBuffer(CFixedBuffers::fb_DebugUniform_0);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Debug_Transforms_Uniform,	1,	VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	vertex_frag,	&uniformBuffer.descInfo,	VK_NULL_HANDLE}, 0);
-		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, 0, "UIDescriptorSet_0"));
-	}
-
-	{
-		CVulkanRHI::Buffer uniformBuffer = p_fixedBuffers->GetBuffer(CFixedBuffers::fb_DebugUniform_1);
-		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Debug_Transforms_Uniform,	1,	VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	vertex_frag,	&uniformBuffer.descInfo,	VK_NULL_HANDLE }, 1);
-		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, 1, "UIDescriptorSet_1"));
+		CVulkanRHI::Buffer uniformBuffer = p_fixedBuffers->GetBuffer(CFixedBuffers::fb_DebugUniform_0 + i);
+		AddDescriptor(CVulkanRHI::DescriptorData{ 0, BindingDest::bd_Debug_Transforms_Uniform,	1,	VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	vertex_frag,	&uniformBuffer.descInfo,	VK_NULL_HANDLE}, i);
+		RETURN_FALSE_IF_FALSE(CreateDescriptors(p_rhi, i, "UIDescriptorSet_" + std::to_string(i)));
 	}
 
 	return true;
@@ -2887,25 +3882,26 @@ bool CRenderableDebug::CreateBoxSphereBuffers(CVulkanRHI* p_rhi, CVulkanRHI::Buf
 	return true;
 }
 
-CRayTracingRenderable::CRayTracingRenderable(std::string p_name, uint32_t p_meshId, nm::Transform p_modelMat, VkAccelerationStructureInstanceKHR* p_accStructInstance)
-	: CRenderableMesh(p_name, p_meshId, p_modelMat, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR)
+CRayTracingRenderable::CRayTracingRenderable(std::string p_name, uint32_t p_meshId, uint32_t p_firstInstanceId, nm::Transform p_modelMat, VkAccelerationStructureInstanceKHR* p_accStructInstance)
+	: CRenderableMesh(p_name, p_meshId, p_firstInstanceId, p_modelMat, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR)
 	, m_accStructInstance(p_accStructInstance)
 	, m_blasBuffer(VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0)
-	, m_BLAS(VK_NULL_HANDLE)
 {
 }
 
 void CRayTracingRenderable::Destroy(CVulkanRHI* p_rhi)
 {
 	m_blasBuffer.Destroy(p_rhi);
-	p_rhi->DestroyAccelerationStrucutre(m_BLAS);	
+	for (auto& blas : m_BLAS)
+		p_rhi->DestroyAccelerationStrucutre(blas);
+	m_BLAS.clear();
 	CRenderableMesh::Destroy(p_rhi);
 }
 
 void CRayTracingRenderable::SetTransform(CVulkanRHI* p_rhi, nm::Transform p_transform, bool p_bRecomputeSceneBBox)
 {
 	// Update the BVH with the new transform
-	UpdateBLASInstance(p_rhi, m_transform);
+	UpdateBLASInstance(p_rhi, p_transform);
 	CRenderableMesh::SetTransform(p_rhi, p_transform, p_bRecomputeSceneBBox);
 }
 
@@ -2918,87 +3914,105 @@ void CRayTracingRenderable::SetTransform(CVulkanRHI* p_rhi, nm::Transform p_tran
 
 bool CRayTracingRenderable::CreateBuildBLAS(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugStr)
 {
+	PROFILE_FUNCTION();
+
 	VkDeviceAddress vbAddress = p_rhi->GetBufferDeviceAddress(GetVertexBuffer().descInfo.buffer);
 	VkDeviceAddress ibAddress = p_rhi->GetBufferDeviceAddress(GetIndexBuffer().descInfo.buffer);
 
-	// Providing the mesh vertex and index data and defining the geometry
-	VkAccelerationStructureGeometryKHR geometry{};
-	geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-	geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-	geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-	geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-	geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT; // refer vertex attribute defined for shadow pass and reused everywhere else
-	geometry.geometry.triangles.vertexStride = GetVertexStrideInBytes();
-	geometry.geometry.triangles.maxVertex = GetVertexCount();
-	geometry.geometry.triangles.vertexData.deviceAddress = vbAddress;
-	geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
-	geometry.geometry.triangles.indexData.deviceAddress = ibAddress;
-
-	// Might want to revisit this when using instancing
-	VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
-	buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-	buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-	buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
-	buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;	// might want to use the update flag when add geometry at runtime?
-	buildInfo.geometryCount = 1;
-	buildInfo.pGeometries = &geometry; // as of now, I am using 1 geometry per Mesh (includes all its sub-meshes)
-
-	// Build type is device because we are choosing to create the resources on the device instead
-	// of host. The driver spawns a compute shader to build the acceleration structure
-
-	VkAccelerationStructureBuildSizesInfoKHR sizeInfo{};
-	p_rhi->GetAccelerationStructureBuildSize(VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, GetPrimitiveCount(), &sizeInfo);
-
-	std::clog << "CRenderable::CreateBuildBLAS: Total Acceleration Structure Size: " << sizeInfo.accelerationStructureSize / 1048576.0f << " Mb." << std::endl;
-	std::clog << "CRenderable::CreateBuildBLAS: Total Scratch Size: " << sizeInfo.buildScratchSize / 1048576.0f << " Mb." << std::endl;
-
-	// Create Scratch Buffer
-	VkDeviceAddress scratchAddress;
-	{
-		CVulkanRHI::Buffer scratchBuffer;
-		RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(sizeInfo.buildScratchSize, scratchBuffer,
-			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "BLAS Scratch"));
-
-		scratchAddress = p_rhi->GetBufferDeviceAddress(scratchBuffer.descInfo.buffer);
+	// One BLAS is built per shared mesh over its range of the index buffer. 
+	// All instances of the shared mesh reference the same BLAS from the TLAS
+	m_BLAS.resize(m_sharedMeshes.size(), VK_NULL_HANDLE);
+	for (uint32_t i = 0; i < (uint32_t)m_sharedMeshes.size(); i++)
+	{
+		const SharedMesh& sharedMesh = m_sharedMeshes[i];
+		std::string debugStr = p_debugStr + "_" + std::to_string(i);
+
+		// Providing the mesh vertex and index data and defining the geometry
+		VkAccelerationStructureGeometryKHR geometry{};
+		geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+		geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+		geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+		geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+		geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT; // refer vertex attribute defined for shadow pass and reused everywhere else
+		geometry.geometry.triangles.vertexStride = GetVertexStrideInBytes();
+		geometry.geometry.triangles.maxVertex = GetVertexCount();
+		geometry.geometry.triangles.vertexData.deviceAddress = vbAddress;
+		geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+		geometry.geometry.triangles.indexData.deviceAddress = ibAddress;
+
+		VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+		buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+		buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+		buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+		buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;	// might want to use the update flag when add geometry at runtime?
+		buildInfo.geometryCount = 1;
+		buildInfo.pGeometries = &geometry; // 1 geometry per shared mesh (includes all its sub-meshes)
+
+		// Build type is device because we are choosing to create the resources on the device instead
+		// of host. The driver spawns a compute shader to build the acceleration structure
+		uint32_t primitiveCount = sharedMesh.indexCount / 3;
+
+		VkAccelerationStructureBuildSizesInfoKHR sizeInfo{};
+		p_rhi->GetAccelerationStructureBuildSize(VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, primitiveCount, &sizeInfo);
+
+		std::clog << "CRenderable::CreateBuildBLAS: Total Acceleration Structure Size: " << sizeInfo.accelerationStructureSize / 1048576.0f << " Mb." << std::endl;
+		std::clog << "CRenderable::CreateBuildBLAS: Total Scratch Size: " << sizeInfo.buildScratchSize / 1048576.0f << " Mb." << std::endl;
+
+		// Create Scratch Buffer
+		VkDeviceAddress scratchAddress;
+		{
+			CVulkanRHI::Buffer scratchBuffer;
+			RETURN_FALSE_IF_FALSE(p_rhi->CreateAllocateBindBuffer(sizeInfo.buildScratchSize, scratchBuffer,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "BLAS Scratch"));
 
-		p_stgbufferList.push_back(scratchBuffer);
-	}
+			scratchAddress = p_rhi->GetBufferDeviceAddress(scratchBuffer.descInfo.buffer);
 
-	VkAccelerationStructureBuildRangeInfoKHR buildRanges{};
-	const VkAccelerationStructureBuildRangeInfoKHR* buildRangePtrs;
+			p_stgbufferList.push_back(scratchBuffer);
+		}
 
-	// Create Acceleration Buffer
-	RETURN_FALSE_IF_FALSE(m_blasBuffer.CreateBuffer(p_rhi, sizeInfo.accelerationStructureSize, p_debugStr));
+		// Create Acceleration Buffer
+		RETURN_FALSE_IF_FALSE(m_blasBuffer.CreateBuffer(p_rhi, sizeInfo.accelerationStructureSize, debugStr));
 
-	VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{};
-	accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-	accelerationStructureCreateInfo.buffer = m_blasBuffer.GetBuffer().descInfo.buffer;
-	accelerationStructureCreateInfo.offset = 0;
-	accelerationStructureCreateInfo.size = sizeInfo.accelerationStructureSize;
-	accelerationStructureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-	RETURN_FALSE_IF_FALSE(p_rhi->CreateAccelerationStructure(&accelerationStructureCreateInfo, m_BLAS));
-	std::clog << "CRenderable::CreateBuildBLAS: Creating Bottom Acceleration Structure for " << p_debugStr << std::endl;
+		VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{};
+		accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+		accelerationStructureCreateInfo.buffer = m_blasBuffer.GetBuffer(i).descInfo.buffer;
+		accelerationStructureCreateInfo.offset = 0;
+		accelerationStructureCreateInfo.size = sizeInfo.accelerationStructureSize;
+		accelerationStructureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateAccelerationStructure(&accelerationStructureCreateInfo, m_BLAS[i]));
+		std::clog << "CRenderable::CreateBuildBLAS: Creating Bottom Acceleration Structure for " << debugStr << std::endl;
 
-	buildInfo.dstAccelerationStructure = m_BLAS;
-	buildInfo.scratchData.deviceAddress = scratchAddress;
+		buildInfo.dstAccelerationStructure = m_BLAS[i];
+		buildInfo.scratchData.deviceAddress = scratchAddress;
 
-	buildRanges.primitiveCount = GetPrimitiveCount();
-	buildRangePtrs = &buildRanges;
+		// primitive offset is in bytes into the index buffer
+		VkAccelerationStructureBuildRangeInfoKHR buildRanges{};
+		buildRanges.primitiveCount = primitiveCount;
+		buildRanges.primitiveOffset = sharedMesh.firstIndex * sizeof(uint32_t);
+		const VkAccelerationStructureBuildRangeInfoKHR* buildRangePtrs = &buildRanges;
 
-	p_rhi->BuildAccelerationStructure(p_cmdBfr, 1, &buildInfo, &buildRangePtrs);
-	std::clog << "CRenderable::CreateBuildBLAS: Building Acceleration Structures for " << p_debugStr << std::endl;
+		p_rhi->BuildAccelerationStructure(p_cmdBfr, 1, &buildInfo, &buildRangePtrs);
+		std::clog << "CRenderable::CreateBuildBLAS: Building Acceleration Structures for " << debugStr << std::endl;
+	}
 
-	UpdateBLASInstance(p_rhi, nm::Transform());
+	UpdateBLASInstance(p_rhi, m_transform);
 
 	return true;
 }
 
 void CRayTracingRenderable::UpdateBLASInstance(CVulkanRHI* p_rhi, const nm::Transform& p_transform)
 {
-	m_accStructInstance->transform = p_transform.GetTransformAffine();
-	m_accStructInstance->instanceCustomIndex = 0;
-	m_accStructInstance->mask = 0xFF;
-	m_accStructInstance->instanceShaderBindingTableRecordOffset = 0;
-	m_accStructInstance->flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-	m_accStructInstance->accelerationStructureReference = p_rhi->GetAccelerationStructureDeviceAddress(m_BLAS);
+	nm::float4x4 entityTransform = p_transform.GetTransform();
+	for (uint32_t i = 0; i < (uint32_t)m_instances.size(); i++)
+	{
+		const MeshInstance& instance = m_instances[i];
+		VkAccelerationStructureInstanceKHR* accStructInstance = &m_accStructInstance[i];
+
+		accStructInstance->transform = nm::Transform(entityTransform * instance.transform).GetTransformAffine();
+		accStructInstance->instanceCustomIndex = m_firstInstanceId + i;
+		accStructInstance->mask = 0xFF;
+		accStructInstance->instanceShaderBindingTableRecordOffset = 0;
+		accStructInstance->flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+		accStructInstance->accelerationStructureReference = p_rhi->GetAccelerationStructureDeviceAddress(m_BLAS[instance.sharedMeshId]);
+	}
 }
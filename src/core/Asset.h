@@ -3,12 +3,22 @@
 #include "VulkanRHI.h"
 #include "SceneGraph.h"
 #include "AssetLoader.h"
+#include "TextureCompressor.h"
+#include "TextureStreamer.h"
+#include "TextureRegistry.h"
+#include "TextureIngester.h"
+#include "MeshDecoder.h"
 #include "Camera.h"
 #include "Light.h"
+#include "SceneFile.h"
+#include "ThreadPool.h"
 
 #include "external/NiceMath.h"
 
+#include <atomic>
+#include <chrono>
 #include <list>
+#include <mutex>
 
 class CCircularList
 {
@@ -83,7 +93,7 @@ enum BindingDest
 
 struct LoadedUpdateData
 {
-	uint32_t							swapchainIndex;
+	uint32_t							frameIndex;			// selects the per frame resources in flight
 	float								timeElapsed;
 	nm::float2							screenRes;
 	nm::float2							curMousePos;
@@ -147,6 +157,7 @@ public:
 	void BindlessWrite(uint32_t p_setId, uint32_t p_index, const VkDescriptorImageInfo* p_imageInfo, uint32_t p_count = 1, uint32_t p_arrayDestIndex = 0);
 	void BindlessWrite(uint32_t p_setId, uint32_t p_index, const VkDescriptorBufferInfo* p_bufferInfo, uint32_t p_count = 1);
 	void BindlessWrite(uint32_t p_setId, uint32_t p_index, const VkAccelerationStructureKHR* p_accStructure, uint32_t p_count = 1);
+	void BindlessWritePerCopy(uint32_t p_setId, uint32_t p_index, const VkDescriptorBufferInfo* const* p_bufferInfoPerCopy);	// one buffer per set copy
 	void BindlessUpdate(CVulkanRHI* p_rhi, uint32_t p_setId);
 
 	const VkDescriptorSet* GetDescriptorSet(uint32_t p_setId = 0, uint32_t p_copyId = 0) const { return &m_descList2D[p_setId][p_copyId].descSet; }
@@ -162,6 +173,42 @@ protected:
 	CVulkanRHI::DescriptorBindFlags m_bindFlags;
 };
 
+// The bindless array of sampled images, with one descriptor set copy per frame in flight. Slots are only ever
+// appended. Stage may be called from any thread, the asset loader's included, and only records the new slots.
+// Apply writes them to one copy at the frame boundary, once no pending command buffer uses that copy, so a
+// copy is never written while the GPU or the recording thread reads it. Update replaces a staged slot, as the
+// texture streamer does when it swaps mip chains, and reaches every copy the same way
+class CBindlessTextureTable
+{
+public:
+	CBindlessTextureTable();
+	~CBindlessTextureTable() {};
+
+	bool Create(CVulkanRHI* p_rhi, VkDescriptorSetLayout p_descLayout, uint32_t p_binding, uint32_t p_capacity);
+	void Destroy(CVulkanRHI* p_rhi);
+
+	// Fails without staging anything if the slots do not fit
+	bool Stage(const VkDescriptorImageInfo* p_imageInfos, uint32_t p_count);
+	// Replaces a staged slot. Copies keep the previous image until their next Apply
+	bool Update(uint32_t p_slot, const VkDescriptorImageInfo& p_imageInfo);
+	// Writes the slots staged since the last Apply to p_copyId, only from the thread recording the frames
+	bool Apply(CVulkanRHI* p_rhi, VkDescriptorSet p_descSet, uint32_t p_copyId);
+
+	uint32_t GetCapacity() const { return m_capacity; }
+	uint32_t GetStagedCount();
+
+private:
+	std::mutex								m_mutex;
+	std::vector<VkDescriptorImageInfo>		m_imageInfos;							// every slot staged so far
+	uint32_t								m_appliedCount[MAX_FRAMES_IN_FLIGHT];	// slots each copy holds
+	std::vector<uint32_t>					m_updatedSlots[MAX_FRAMES_IN_FLIGHT];	// applied slots each copy has to write again
+
+	VkDescriptorSetLayout					m_descLayout;
+	uint32_t								m_binding;
+	uint32_t								m_capacity;
+	std::vector<VkDescriptorUpdateTemplate>	m_chunkTemplates;						// one per BINDLESS_WRITE_CHUNK slots, created on first use
+};
+
 class CBuffers
 {
 public:
@@ -211,8 +258,9 @@ public:
 	CTextures(int p_maxSize = 0);
 	~CTextures() {};
 
-	bool CreateRenderTarget(CVulkanRHI* p_rhi, uint32_t p_id, VkFormat p_format,uint32_t p_width, uint32_t p_height, uint32_t p_mipLevel, VkImageLayout p_layout, std::string p_debugName, VkImageUsageFlags p_usage);
-	bool CreateTexture(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& stg, const ImageRaw*, VkFormat p_format, CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, int p_id = -1);
+	bool CreateRenderTarget(CVulkanRHI* p_rhi, uint32_t p_id, VkFormat p_format,uint32_t p_width, uint32_t p_height, uint32_t p_mipLevel, VkImageLayout p_layout, std::string p_debugName, VkImageUsageFlags p_usage, bool p_bindMemory = true);
+	// p_firstMip skips the larger mips of a texture whose mip chain is provided, see CTextureStreamer
+	bool CreateTexture(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& stg, const ImageRaw*, VkFormat p_format, CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, int p_id = -1, uint32_t p_firstMip = 0);
 	bool CreateCubemap(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& p_stg, ImageRaw&, const CVulkanRHI::SamplerList& p_samplers, CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, int p_id = -1);
 
 	// Pushes a specific texture index into list to repeat the usage of the texture
@@ -222,6 +270,13 @@ public:
 
 	void Destroy(CVulkanRHI* p_rhi);
 
+	// Creates and uploads the image of a texture without adding it to any list
+	static bool CreateTextureImage(CVulkanRHI* p_rhi, CVulkanRHI::Buffer& p_stg, const ImageRaw* p_rawImg, VkFormat p_format, CVulkanRHI::CommandBuffer& p_cmdBfr, std::string p_debugName, uint32_t p_firstMip, CVulkanRHI::Image& p_img);
+	static void DestroyTextureImage(CVulkanRHI* p_rhi, CVulkanRHI::Image& p_img);
+
+	// Puts p_image in place of texture p_id and returns the one it replaces, for the caller to destroy once no frame reads it
+	CVulkanRHI::Image ReplaceTexture(uint32_t p_id, const CVulkanRHI::Image& p_image);
+
 	void IssueLayoutBarrier(CVulkanRHI* p_rhi, CVulkanRHI::ImageLayout p_imageLayout, CVulkanRHI::CommandBuffer& p_cmdBfr, uint32_t p_id, int p_mipLevel = -1);
 
 	const CVulkanRHI::Image& GetTexture(uint32_t p_id) { return m_textures[p_id]; }
@@ -237,13 +292,11 @@ class CFixedBuffers : public CBuffers, public CUIParticipant
 public:
 	enum FixedBufferId
 	{
-		  fb_PrimaryUniform_0		= 0
-		, fb_PrimaryUniform_1
-		, fb_ObjectPickerRead
+		  fb_PrimaryUniform_0		= 0												// one per frame in flight
+		, fb_ObjectPickerRead		= fb_PrimaryUniform_0 + MAX_FRAMES_IN_FLIGHT
 		, fb_ObjectPickerWrite
-		, fb_DebugUniform_0
-		, fb_DebugUniform_1
-		, fb_max
+		, fb_DebugUniform_0															// one per frame in flight
+		, fb_max					= fb_DebugUniform_0 + MAX_FRAMES_IN_FLIGHT
 	};
 
 	struct PrimaryUniformData
@@ -291,7 +344,12 @@ public:
 
 	PrimaryUniformData* GetPrimaryUnifromData() { return &m_primaryUniformData; }
 
-	bool Update(CVulkanRHI*, uint32_t p_scId);
+	// The render settings of the uniform data by name, as scene files record them. The passes write theirs every
+	// frame, see CPass::ApplySettings for restoring them
+	void GetSettings(std::vector<SceneDescription::Setting>& p_settings) const;
+	void SetSettings(const std::vector<SceneDescription::Setting>& p_settings);
+
+	bool Update(CVulkanRHI*, uint32_t p_frameIdx);
 
 	virtual void Show(CVulkanRHI* p_rhi) override;
 
@@ -301,7 +359,7 @@ private:
 
 struct FixedUpdateData
 {
-	int	swapchainIndex;
+	int	frameIndex;
 };
 
 class CRenderTargets : public CTextures, public CUIParticipant
@@ -332,6 +390,16 @@ public:
 
 	void Show(CVulkanRHI* p_rhi) override;
 
+	// Transient render targets are produced and consumed within a frame, so their content does not
+	// have to survive until the next one and their memory can be shared, see CRenderGraph
+	static bool IsTransient(RenderTargetId);
+
+	// Render targets sharing a slot share memory; UINT32_MAX for own memory. Has to be set before Create
+	void SetMemorySlots(const std::vector<uint32_t>& p_memorySlots) { m_memorySlots = p_memorySlots; }
+
+	// Layout the render target is in whenever it is accessed through the primary descriptors
+	VkImageLayout GetShaderLayout(RenderTargetId p_id) const { return m_shaderLayouts[p_id]; }
+
 	// temporary hack - to create the primary descriptor set, the render targets
 	// need to be in a specific layout as some of them are required in compute
 	// shaders as shader resources. Once the primary descriptors are created all
@@ -341,9 +409,20 @@ public:
 
 	std::string GetRenderTargetIDinString(RenderTargetId);
 
+	VkDeviceSize GetRequiredMemory() const { return m_requiredMemory; }
+	VkDeviceSize GetAllocatedMemory() const { return m_allocatedMemory; }
+
 private:
 
 	std::vector<uint32_t> m_rtID;
+	std::vector<VkImageLayout> m_shaderLayouts;
+
+	std::vector<uint32_t> m_memorySlots;
+	std::vector<VkDeviceMemory> m_aliasedMemory;		// one per memory slot
+	VkDeviceSize m_requiredMemory;						// sum of the render targets' sizes
+	VkDeviceSize m_allocatedMemory;
+
+	bool BindAliasedMemory(CVulkanRHI* p_rhi);
 };
 
 class CRenderable
@@ -428,7 +507,7 @@ public:
 	void Destroy(CVulkanRHI* p_rhi);
 
 	bool Update(CVulkanRHI* p_rhi, const LoadedUpdateData&);
-	bool PreDraw(CVulkanRHI* p_rhi, uint32_t p_scIdx);
+	bool PreDraw(CVulkanRHI* p_rhi, uint32_t p_frameIdx);
 
 private:
 	Guizmo								m_guizmo;
@@ -446,7 +525,7 @@ class CRenderableMesh : public CEntity, public CRenderable
 {
 	friend class CScene;
 public:
-	CRenderableMesh(std::string p_name, uint32_t p_meshId, nm::Transform p_modelMat, VkBufferUsageFlags p_usage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+	CRenderableMesh(std::string p_name, uint32_t p_meshId, uint32_t p_firstInstanceId, nm::Transform p_modelMat, VkBufferUsageFlags p_usage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 	~CRenderableMesh();
 
 	void Destroy(CVulkanRHI*);
@@ -457,6 +536,13 @@ public:
 	uint32_t GetSubmeshCount() const { return (uint32_t)m_submeshes.size(); }
 	const SubMesh* GetSubmesh(uint32_t p_idx) const { return &m_submeshes[p_idx]; }
 
+	void SetInstances(const MeshRaw& p_meshRaw) { m_sharedMeshes = p_meshRaw.sharedMeshes; m_instances = p_meshRaw.instances; }
+	uint32_t GetFirstInstanceId() const { return m_firstInstanceId; }
+	uint32_t GetSharedMeshCount() const { return (uint32_t)m_sharedMeshes.size(); }
+	const SharedMesh* GetSharedMesh(uint32_t p_idx) const { return &m_sharedMeshes[p_idx]; }
+	uint32_t GetMeshInstanceCount() const { return (uint32_t)m_instances.size(); }
+	const MeshInstance* GetMeshInstance(uint32_t p_idx) const { return &m_instances[p_idx]; }
+
 	void SetSubBoundingBox(BBox p_bbox) { m_subBoundingBoxes.push_back(p_bbox); }
 	BBox* GetSubBoundingBox(uint32_t p_id) { return &(m_subBoundingBoxes[p_id]); }
 	uint32_t GetSubBoundingBoxCount() { return (uint32_t)m_subBoundingBoxes.size(); }
@@ -466,8 +552,10 @@ public:
 protected:
 	std::vector<SubMesh>			m_submeshes;
 	std::vector<BBox>				m_subBoundingBoxes;
+	std::vector<SharedMesh>			m_sharedMeshes;
+	std::vector<MeshInstance>		m_instances;
 	uint32_t						m_mesh_id;
-	nm::float4x4					m_viewNormalTransform;
+	uint32_t						m_firstInstanceId;		// first slot of the instances in the scene's mesh data buffer and TLAS instance list
 
 	// few members needed for ui
 	int								m_selectedSubMeshId;
@@ -477,7 +565,7 @@ class CRayTracingRenderable : public CRenderableMesh
 {
 public:
 	//CRayTracingRenderable(VkAccelerationStructureInstanceKHR* p_accStructInstance);
-	CRayTracingRenderable(std::string p_name, uint32_t p_meshId, nm::Transform p_modelMat, VkAccelerationStructureInstanceKHR* p_accStructInstance);
+	CRayTracingRenderable(std::string p_name, uint32_t p_meshId, uint32_t p_firstInstanceId, nm::Transform p_modelMat, VkAccelerationStructureInstanceKHR* p_accStructInstance);
 	~CRayTracingRenderable() {};
 
 	void Destroy(CVulkanRHI*);
@@ -488,13 +576,13 @@ public:
 
 	bool CreateBuildBLAS(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer&, std::string p_debugStr);
 
-	VkAccelerationStructureKHR GetBLAS() { return m_BLAS; }
-	const CVulkanRHI::Buffer GetBLASBuffer() { return m_blasBuffer.GetBuffer(0); }
+	VkAccelerationStructureKHR GetBLAS(uint32_t p_sharedMeshId) { return m_BLAS[p_sharedMeshId]; }
+	const CVulkanRHI::Buffer GetBLASBuffer(uint32_t p_sharedMeshId) { return m_blasBuffer.GetBuffer(p_sharedMeshId); }
 
 protected:
 	CBuffers							m_blasBuffer;
-	VkAccelerationStructureKHR			m_BLAS;
-	VkAccelerationStructureInstanceKHR* m_accStructInstance;
+	std::vector<VkAccelerationStructureKHR> m_BLAS;				// one per shared mesh, referenced by all its instances
+	VkAccelerationStructureInstanceKHR* m_accStructInstance;		// first of the mesh's instances in the TLAS instance list
 
 	void UpdateBLASInstance(CVulkanRHI* p_rhi, const nm::Transform& p_transform);
 };
@@ -524,7 +612,7 @@ public:
 	bool Create(CVulkanRHI* p_rhi, const CFixedBuffers*, const CVulkanRHI::CommandPool&);
 	bool Update();
 	void Destroy(CVulkanRHI* p_rhi);
-	bool PreDrawInstanced(CVulkanRHI* p_rhi, uint32_t p_scIdx, const CFixedBuffers*, const CSceneGraph*, CVulkanRHI::CommandBuffer&);
+	bool PreDrawInstanced(CVulkanRHI* p_rhi, uint32_t p_frameIdx, const CFixedBuffers*, const CSceneGraph*, CVulkanRHI::CommandBuffer&);
 
 	DebugDrawDetails GetBBoxDrawDetails() { return m_bBoxDetails; }
 	DebugDrawDetails GetBSphereDrawDetails() { return m_bSphereDetails; }
@@ -554,23 +642,31 @@ public:
 
 	struct MeshPushConst
 	{
-		uint32_t					mesh_id;
+		uint32_t					mesh_id;			// slot of the first instance in the mesh data buffer
 		uint32_t					material_id;
 	};
 
 	CScene(CSceneGraph*);
 	~CScene();
 
-	bool Create(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, const CVulkanRHI::CommandPool& p_cmdPool);
+	bool Create(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, const CVulkanRHI::CommandPool& p_cmdPool, const SceneDescription& p_sceneDescription);
 	void Destroy(CVulkanRHI* p_rhi);
 
-	bool UpdateTLAS(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool, uint32_t p_scId);
+	// The assets as loaded, placed where their meshes are now, the ones still streaming in as the description gave them,
+	// and the lights
+	void GetSceneDescription(SceneDescription& p_sceneDescription);
+
+	// Until then the environment is a uniform stand-in and the assets of the description join the scene one by one
+	bool IsLoaded() const { return m_loaded; }
+
+	bool UpdateTLAS(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool, uint32_t p_frameIdx);
 
 	virtual void Show(CVulkanRHI* p_rhi) override;
 
 	bool Update(CVulkanRHI* p_rhi, const LoadedUpdateData&);
 	void SetSelectedRenderableMesh(int p_id) { m_curSelecteRenderableMesh = p_id; }
 	uint32_t GetRenderableMeshCount() const { return (uint32_t)m_meshes.size(); }
+	uint32_t GetMeshInstanceCount() const { return m_meshInstanceCount; }
 	const CRenderableMesh* GetRenderableMesh(uint32_t p_idx) const { return m_meshes[p_idx]; }
 	const CRenderable* GetSkyBoxMesh() const { return m_skyBox; }
 
@@ -583,6 +679,32 @@ private:
 		, als_RequestComplete
 	};
 
+	// What the assets of the scene were loaded from, for saving it
+	struct LoadedAsset
+	{
+		std::string							path;				// as a scene file gives it
+		bool								flipUV;
+		uint32_t							firstMesh;
+		uint32_t							meshCount;
+	};
+
+	// The image based lighting baked on a loader thread, the render thread swaps it in for the stand-ins
+	struct StreamedEnvironment
+	{
+		CVulkanRHI::Image					specular;
+		CVulkanRHI::Image					diffuse;
+		CVulkanRHI::Image					brdfLut;
+	};
+
+	// An asset of the description with its textures uploaded, the render thread creates its meshes
+	struct StreamedAsset
+	{
+		uint32_t							index;				// in the description
+		SceneRaw							sceneRaw;			// meshes and materials, the materials refer to bindless slots
+		uint32_t							firstTexture;		// of m_sceneTextures, the ones it added
+		uint32_t							textureCount;
+	};
+
 	struct AssetLoadingTracker
 	{
 		AssetLoadingState state;
@@ -603,6 +725,7 @@ private:
 	// ray tracing resources but will be rendered in the frame.
 	CRenderable*							m_skyBox;
 	std::vector<CRenderableMesh*>			m_meshes;			// list of all meshes used by the scene
+	std::vector<LoadedAsset>				m_loadedAssets;
 		
 	CTextures*                              m_sceneTextures;	// list of all the textures used by the scene
 	std::vector<Material>					m_materialsList;	// List of all the materials used by the scene
@@ -619,23 +742,58 @@ private:
 	// TODO: need to fix the current selected render-able mesh 
 	// it is used by object picker pass and is not the best way to do.
 	int										m_curSelecteRenderableMesh;
-	CVulkanRHI::Buffer						m_meshInfo_uniform[FRAME_BUFFER_COUNT];	// stores all meshes uniform data
+	CVulkanRHI::Buffer						m_meshInfo_uniform[MAX_FRAMES_IN_FLIGHT];	// stores all meshes uniform data
 	CVulkanRHI::Buffer						m_material_storage;
 	CVulkanRHI::Buffer						m_light_storage;						// buffer for holding light count, raw light list data
 		
+	CBindlessTextureTable					m_bindlessTextures;						// slot i is m_sceneTextures tt_scene + i
+	CTextureCompressor						m_textureCompressor;					// created only if the device samples BC formats
+	CTextureStreamer						m_textureStreamer;						// owns the finer mips of the scene textures
+	CTextureRegistry						m_textureRegistry;						// bindless slot of every scene texture by content
+	CTextureIngester						m_textureIngester;						// decodes, compresses and stages the loaded textures
+	CMeshDecoder							m_meshDecoder;							// decodes meshopt and Draco compressed glTF meshes
+
 	VkCommandPool							m_assetLoaderCommandPool;				// specially for transfer queues
 	AssetLoadingTracker						m_assetLoadingTracker;
 
+	// The environment and the assets of the description stream in on the loader's workers once the first frame can be drawn
+	CThreadPool*							m_loaderPool;
+	CThreadPool::JobGroup					m_loaderJobs;
+	std::atomic<bool>						m_cancelLoading;
+	std::vector<SceneDescription::Asset>	m_streamingAssets;						// all of the description's, committed or not
+	std::chrono::steady_clock::time_point	m_streamingStart;
+	std::mutex								m_streamedMutex;						// guards the two below
+	bool									m_environmentStreamed;
+	StreamedEnvironment						m_streamedEnvironment;
+	std::vector<StreamedAsset>				m_streamedAssets;
+	uint32_t								m_committedAssets;
+	bool									m_environmentCommitted;
+	bool									m_loaded;
+	std::mutex								m_sceneTexturesMutex;					// loaders append to m_sceneTextures while the render thread reads it
+
 	uint32_t m_textureOffset;
 	uint32_t m_materialOffset;
+	uint32_t m_meshInstanceCount;												// instances of all meshes, each owns a slot in mesh uniform and TLAS
 
 	bool LoadDefaultTextures(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer&);
-	bool LoadDefaultScene(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer&, bool p_dumpBinaryToDisk = false);
+	bool LoadMaterialStorage(CVulkanRHI* p_rhi);
 	bool LoadLights(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer&, bool p_dumpBinaryToDisk = false);
+	bool LoadSceneTextures(CVulkanRHI* p_rhi, SceneRaw& p_sceneRaw, uint32_t p_firstSlot, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer&);
 	bool LoadTLAS(CVulkanRHI* p_rhi, CVulkanRHI::BufferList& p_stgbufferList, CVulkanRHI::CommandBuffer&);
-	bool UpdateTLAS(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer&);
+	bool UpdateTLAS(CVulkanRHI* p_rhi, CVulkanRHI::CommandBuffer&, bool p_rebuild = false);
+
+	bool StartStreaming(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList, const SceneDescription& p_sceneDescription);
+	void StopStreaming(CVulkanRHI* p_rhi);
+	bool StreamEnvironment(CVulkanRHI* p_rhi, const CVulkanRHI::SamplerList* p_samplerList);
+	bool StreamAssets(CVulkanRHI* p_rhi);
+	bool ImportAsset(const SceneDescription::Asset& p_asset, SceneRaw& p_sceneRaw);
+	bool StreamAsset(CVulkanRHI* p_rhi, VkCommandPool p_cmdPool, uint32_t p_index, SceneRaw& p_sceneRaw);
+	bool CommitStreamed(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool);
+	bool CommitEnvironment(CVulkanRHI* p_rhi, StreamedEnvironment& p_environment);
+	bool CommitAsset(CVulkanRHI* p_rhi, const CVulkanRHI::CommandPool& p_cmdPool, StreamedAsset& p_asset);
 
 	bool CreateMeshUniformBuffer(CVulkanRHI* p_rhi);
+	void RequestTextureMips(const LoadedUpdateData& p_loadedUpdate);
 	bool CreateSceneDescriptors(CVulkanRHI* p_rhi);
 	bool Create2DSceneDescriptors(CVulkanRHI* p_rhi);
 
@@ -705,7 +863,7 @@ public:
 	CLoadableAssets(CSceneGraph*);
 	~CLoadableAssets();
 
-	bool Create(CVulkanRHI*, const CFixedAssets&, const CVulkanRHI::CommandPool& );
+	bool Create(CVulkanRHI*, const CFixedAssets&, const CVulkanRHI::CommandPool&, const SceneDescription&);
 	void Destroy(CVulkanRHI*);
 
 	bool Update(CVulkanRHI*, const LoadedUpdateData&);
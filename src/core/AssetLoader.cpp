@@ -1,21 +1,30 @@
 #include "AssetLoader.h"
 #include "Global.h"
+#include "Profiler.h"
+#include "TextureRegistry.h"
+#include "FileIO.h"
+#include "GltfParser.h"
+#include "MeshDecoder.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "external/tiny_obj_loader.h"
 #define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_EXTERNAL_IMAGE		// read by LoadTextures, all together through the file backend
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "external/tinygltf/tiny_gltf.h"
 
 #include <fstream>
 #include <filesystem>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
 
-// using this for DDS loader
-#include <fcntl.h>
-#include <io.h>
-#define S_ISREG(e) (((e) & _S_IFMT) == _S_IFREG)
-#define S_ISDIR(e) (((e) & _S_IFMT) == _S_IFDIR)
+#include <cstring>
+
+#if KTX2_ZSTD_SUPERCOMPRESSION
+#include <zstd.h>
+#endif
 
 bool GetFileExtention(const std::string fileName, std::string& pExtentionn)
 {
@@ -84,6 +93,16 @@ nm::float4 ComputeTangent(Vertex p_a, Vertex p_b, Vertex p_c)
 	return tangent;
 }
 
+uint32_t WeldVertex(const Vertex& p_vertex, VertexList& p_vertexList, std::unordered_map<Vertex, uint32_t>& p_uniqueVertices)
+{
+	uint32_t newIndex = (uint32_t)(p_vertexList.size() / p_vertexList.GetVertexSize());
+	auto inserted = p_uniqueVertices.emplace(p_vertex, newIndex);
+	if (inserted.second)
+		p_vertexList.AddVertex(p_vertex);
+
+	return inserted.first->second;
+}
+
 void ComputeBBox(BBox& p_bbox)
 {
 	//p_bbox.bBox[0] = nm::float3{ p_bbox.bbMin[0], p_bbox.bbMin[1], p_bbox.bbMin[2] };
@@ -96,6 +115,25 @@ void ComputeBBox(BBox& p_bbox)
 	//p_bbox.bBox[7] = nm::float3{ p_bbox.bbMin[0], p_bbox.bbMax[1], p_bbox.bbMax[2] };
 }
 
+void CreateSingleInstance(MeshRaw& p_mesh)
+{
+	SharedMesh sharedMesh{};
+	sharedMesh.name				= p_mesh.name;
+	sharedMesh.firstSubmesh		= 0;
+	sharedMesh.submeshCount		= (uint32_t)p_mesh.submeshes.size();
+	sharedMesh.firstIndex		= 0;
+	sharedMesh.indexCount		= (uint32_t)p_mesh.indicesList.size();
+	sharedMesh.firstInstance	= 0;
+	sharedMesh.instanceCount	= 1;
+	sharedMesh.submeshesBbox	= p_mesh.submeshesBbox;
+
+	p_mesh.sharedMeshes.clear();
+	p_mesh.sharedMeshes.push_back(sharedMesh);
+
+	p_mesh.instances.clear();
+	p_mesh.instances.push_back(MeshInstance{ 0, nm::float4x4::identity() });
+}
+
 // Heavily inspired from - http://www.songho.ca/opengl/gl_sphere.html
 void GenerateSphere(int p_stackCount, int p_sectorCount, RawSphere& p_sphere, float p_radius)
 {
@@ -170,105 +208,6 @@ void GenerateSphere(int p_stackCount, int p_sectorCount, RawSphere& p_sphere, fl
 	}
 }
 
-int64_t GetFileSize(const char* fileName)
-{
-	// Try to open
-	int file = -1;
-	(void)_sopen_s(&file, fileName, _O_RDONLY | _O_NOINHERIT | _O_BINARY | _O_SEQUENTIAL, _SH_DENYNO, _S_IREAD);
-
-	// Can't open file for some reason
-	if (file == -1)
-		return -1;
-
-	// Something went wrong. Permissions or not found
-	struct _stat64 fileStatus;
-	if (_fstat64(file, &fileStatus) != 0)
-	{
-		_close(file);
-		return -1;
-	}
-
-	// Done
-	(void)_close(file);
-
-	return fileStatus.st_size;
-}
-
-int64_t ReadFilePartial(const char* fileName, void* buffer, size_t bufferLen, int64_t readOffset/*= 0*/)
-{
-	// Try to open the file
-	int file = -1;
-	(void)_sopen_s(&file, fileName, _O_RDONLY | _O_NOINHERIT | _O_BINARY | _O_SEQUENTIAL, _SH_DENYNO, _S_IREAD);
-
-	// Unable to open file
-	if (file == -1)
-		return -1;
-
-	// Get the file size
-	struct _stat64 fileStatus;
-	if (_fstat64(file, &fileStatus) != 0)
-	{
-		// Unable to get size
-		(void)_close(file);
-		return -1;
-	}
-
-	// Check if file is valid
-	if (!S_ISREG(fileStatus.st_mode))
-	{
-		// Not a regular file
-		(void)_close(file);
-		return -1;
-	}
-
-	// Check we aren't trying to read a size greater than the file
-	const uint64_t fileLengthBytes = static_cast<uint64_t>(std::max<int64_t>(fileStatus.st_size, 0));
-	if (fileLengthBytes < bufferLen)
-		return -1;
-
-	// If we requested reading from an offset within the file, move the read head now
-	if (readOffset)
-	{
-		int64_t fileOffset = _lseeki64(file, readOffset, 0);
-		if (fileOffset != readOffset)   // The offset from start of file should always match the requested read offset
-			return -1;
-	}
-
-	// Fill in the buffer
-	char* pFileBuffer = (char*)buffer;
-	for (uint64_t bytesLeft = bufferLen; bytesLeft > 0;)
-	{
-		uint32_t bytesRequested = static_cast<uint32_t>(std::min<uint64_t>(bytesLeft, INT32_MAX));
-		auto bytesReceivedOrStatus = _read(file, pFileBuffer, bytesRequested);
-
-		// Break into 4GB chunks
-		if (bytesReceivedOrStatus > 0)
-		{
-			bytesLeft -= bytesReceivedOrStatus;
-			pFileBuffer += bytesReceivedOrStatus;
-		}
-
-		// Going past eof... not good
-		else if (bytesReceivedOrStatus == 0)
-		{
-			(void)_close(file);
-			return -1;
-		}
-
-		// Error reported during read
-		else if (bytesReceivedOrStatus < 0)
-		{
-			(void)_close(file);
-			return -1;
-		}
-	}
-
-	// All done
-	(void)_close(file);
-
-	return bufferLen;
-}
-
 typedef enum RESOURCE_DIMENSION
 {
 	RESOURCE_DIMENSION_UNKNOWN = 0,
@@ -385,29 +324,28 @@ bool GetChannelInfo(uint32_t formatId, uint32_t& bitsPerChannel, int& channelCou
 
 bool LoadDDS(const char* textureFile, ImageRaw& p_data)
 {
-	// Get the file size
-	int64_t fileSize = GetFileSize(textureFile);
-	int64_t rawTextureSize = fileSize;
-	if (fileSize == -1)
+	// Viewing the file through the backend, the header is parsed in place and the texture data copied once
+	CFileView file;
+	if (!file.Open(textureFile))
 	{
-		std::cerr << "LoadDDS: Could not get file size of " << textureFile << std::endl;;
+		std::cerr << "LoadDDS: Could not open " << textureFile << std::endl;
 		return false;
 	}
 
+	int64_t fileSize = static_cast<int64_t>(file.GetSize());
+	int64_t rawTextureSize = fileSize;
+
 	// read the header
 	constexpr int32_t c_HEADER_SIZE = 4 + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
-	char headerData[c_HEADER_SIZE];
-	uint32_t bytesRead = 0;
-
-	int64_t sizeRead = ReadFilePartial(textureFile, headerData, c_HEADER_SIZE, 0);
-	if (sizeRead != c_HEADER_SIZE)
+	if (fileSize < c_HEADER_SIZE)
 	{
 		std::cerr << "LoadDDS: Error reading texture header data for file " << textureFile << std::endl;
 		return false;
 	}
 
-	char* pByteData = headerData;
-	uint32_t magicNumber = *reinterpret_cast<uint32_t*>(pByteData);
+	const char* pByteData = reinterpret_cast<const char*>(file.GetData());
+	uint32_t magicNumber = 0;
+	memcpy(&magicNumber, pByteData, sizeof(magicNumber));
 	if (magicNumber != ' SDD')   // "DDS "
 	{
 		std::cerr << "LoadDDS: Could not find DDS indicator in header info " << textureFile << std::endl;
@@ -417,7 +355,7 @@ bool LoadDDS(const char* textureFile, ImageRaw& p_data)
 	pByteData += 4;
 	rawTextureSize -= 4;
 
-	DDS_HEADER* pHeader = reinterpret_cast<DDS_HEADER*>(pByteData);
+	const DDS_HEADER* pHeader = reinterpret_cast<const DDS_HEADER*>(pByteData);
 	pByteData += sizeof(DDS_HEADER);
 	rawTextureSize -= sizeof(DDS_HEADER);
 
@@ -431,7 +369,7 @@ bool LoadDDS(const char* textureFile, ImageRaw& p_data)
 
 	if (pHeader->ddspf.fourCC == '01XD')
 	{
-		DDS_HEADER_DXT10* pHeader10 = reinterpret_cast<DDS_HEADER_DXT10*>((char*)pHeader + sizeof(DDS_HEADER));
+		const DDS_HEADER_DXT10* pHeader10 = reinterpret_cast<const DDS_HEADER_DXT10*>(pByteData);
 		rawTextureSize -= sizeof(DDS_HEADER_DXT10);
 
 		RETURN_FALSE_IF_FALSE(GetChannelInfo(pHeader10->format, bitsPerChannel, p_data.channels));
@@ -465,27 +403,203 @@ bool LoadDDS(const char* textureFile, ImageRaw& p_data)
 	}
 
 	// Will load HDR data without tone mapping
+	// The texture data is the remainder of the file after the header
 	p_data.raw = new unsigned char[rawTextureSize];
-	sizeRead = ReadFilePartial(textureFile, p_data.raw, rawTextureSize, fileSize - rawTextureSize);
-	
-	// Read in the data representing the texture (remainder of the file after the header)
-	if (sizeRead != rawTextureSize)
+	memcpy(p_data.raw, file.GetData() + (fileSize - rawTextureSize), static_cast<size_t>(rawTextureSize));
+
+	return true;
+}
+
+static const unsigned char c_KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };	// "«KTX 20»\r\n\x1A\n"
+
+struct KTX2_HEADER
+{
+	uint8_t				identifier[12];
+	uint32_t			vkFormat;				// VK_FORMAT_UNDEFINED for the Basis Universal encodings
+	uint32_t			typeSize;
+	uint32_t			pixelWidth;
+	uint32_t			pixelHeight;
+	uint32_t			pixelDepth;
+	uint32_t			layerCount;
+	uint32_t			faceCount;
+	uint32_t			levelCount;				// 0 asks the loader to generate the mips
+	uint32_t			supercompressionScheme;
+	uint32_t			dfdByteOffset;
+	uint32_t			dfdByteLength;
+	uint32_t			kvdByteOffset;
+	uint32_t			kvdByteLength;
+	uint64_t			sgdByteOffset;
+	uint64_t			sgdByteLength;
+};
+static_assert(sizeof(KTX2_HEADER) == 80, "The level index follows the 80 byte KTX2 header");
+
+// One per mip, the base level first. The data itself is stored smallest mip first
+struct KTX2_LEVEL
+{
+	uint64_t			byteOffset;
+	uint64_t			byteLength;
+	uint64_t			uncompressedByteLength;
+};
+
+enum KTX2_SUPERCOMPRESSION
+{
+	  KTX2_SUPERCOMPRESSION_NONE	= 0
+	, KTX2_SUPERCOMPRESSION_BASISLZ	= 1
+	, KTX2_SUPERCOMPRESSION_ZSTD	= 2
+};
+
+// sRGB formats are read as UNORM like the PNG and JPG textures are
+static bool GetKTX2Encoding(uint32_t p_vkFormat, TextureEncoding& p_encoding)
+{
+	switch (p_vkFormat)
 	{
-		if(p_data.raw)
-			delete[](p_data.raw);
-		else if(p_data.raw_hdr)
-			delete[](p_data.raw);
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:		p_encoding = te_rgba8; return true;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:	p_encoding = te_bc1; return true;
+	case VK_FORMAT_BC4_UNORM_BLOCK:		p_encoding = te_bc4; return true;
+	case VK_FORMAT_BC5_UNORM_BLOCK:		p_encoding = te_bc5; return true;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:		p_encoding = te_bc7; return true;
+	default:							return false;
+	}
+}
 
-		std::cerr << "LoadDDS: Error reading texture data for file: " << textureFile << std::endl;
-		
+static size_t GetKTX2LevelSize(uint32_t p_width, uint32_t p_height, TextureEncoding p_encoding)
+{
+	if (p_encoding == te_rgba8)
+		return (size_t)p_width * p_height * 4;
+
+	size_t bytesPerBlock = (p_encoding == te_bc1 || p_encoding == te_bc4) ? 8 : 16;
+	return (size_t)((p_width + 3) / 4) * ((p_height + 3) / 4) * bytesPerBlock;
+}
+
+bool LoadKTX2(const unsigned char* p_fileData, size_t p_fileSize, ImageRaw& p_data)
+{
+	KTX2_HEADER header;
+	if (p_fileSize < sizeof(header) || memcmp(p_fileData, c_KTX2_IDENTIFIER, sizeof(c_KTX2_IDENTIFIER)) != 0)
+	{
+		std::cerr << "LoadKTX2: Could not find KTX2 identifier in header info " << p_data.name << std::endl;
+		return false;
+	}
+	memcpy(&header, p_fileData, sizeof(header));
+
+	if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+	{
+		std::cerr << "LoadKTX2: Only 2D textures are supported " << p_data.name << std::endl;
+		return false;
+	}
+
+	uint32_t levelCount = std::max(header.levelCount, 1u);
+	if (p_fileSize < sizeof(header) + levelCount * sizeof(KTX2_LEVEL))
+	{
+		std::cerr << "LoadKTX2: Error reading level index for file " << p_data.name << std::endl;
+		return false;
+	}
+
+	std::vector<KTX2_LEVEL> levels(levelCount);
+	memcpy(levels.data(), p_fileData + sizeof(header), levelCount * sizeof(KTX2_LEVEL));
+	for (const auto& level : levels)
+	{
+		if (level.byteOffset > p_fileSize || level.byteLength > p_fileSize - level.byteOffset)
+		{
+			std::cerr << "LoadKTX2: Level data past the end of file " << p_data.name << std::endl;
+			return false;
+		}
+	}
+
+	p_data.width = static_cast<int>(header.pixelWidth);
+	p_data.height = static_cast<int>(header.pixelHeight);
+	p_data.depthOrArraySize = 1;
+	p_data.channels = 4;
+	p_data.mipLevels = levelCount;
+
+	// ETC1S and UASTC are transcoded to whichever BC format suits the usage, which the materials only tell
+	// later; the file is kept whole for CTextureCompressor
+	if (header.vkFormat == VK_FORMAT_UNDEFINED)
+	{
+		p_data.raw = static_cast<unsigned char*>(malloc(p_fileSize));
+		memcpy(p_data.raw, p_fileData, p_fileSize);
+		p_data.encoding = te_basis;
+		p_data.dataSize = p_fileSize;
+		return true;
+	}
+
+	if (!GetKTX2Encoding(header.vkFormat, p_data.encoding))
+	{
+		std::cerr << "LoadKTX2: Unsupported vkFormat " << header.vkFormat << " in file " << p_data.name << std::endl;
+		return false;
+	}
+
+	if (header.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE &&
+		(header.supercompressionScheme != KTX2_SUPERCOMPRESSION_ZSTD || !KTX2_ZSTD_SUPERCOMPRESSION))
+	{
+		std::cerr << "LoadKTX2: Unsupported supercompression scheme " << header.supercompressionScheme << " in file " << p_data.name << std::endl;
 		return false;
 	}
 
+	// Levels are copied, or inflated, straight into the layout of the upload: the largest first and tightly packed
+	std::vector<size_t> levelSizes(levelCount);
+	size_t dataSize = 0;
+	for (uint32_t mip = 0; mip < levelCount; mip++)
+	{
+		levelSizes[mip] = GetKTX2LevelSize(std::max(header.pixelWidth >> mip, 1u), std::max(header.pixelHeight >> mip, 1u), p_data.encoding);
+		dataSize += levelSizes[mip];
+	}
+
+	p_data.raw = static_cast<unsigned char*>(malloc(dataSize));
+	unsigned char* pDst = p_data.raw;
+	for (uint32_t mip = 0; mip < levelCount; pDst += levelSizes[mip], mip++)
+	{
+		const unsigned char* pSrc = p_fileData + levels[mip].byteOffset;
+		bool levelRead = false;
+		if (header.supercompressionScheme == KTX2_SUPERCOMPRESSION_NONE)
+		{
+			levelRead = (levels[mip].byteLength >= levelSizes[mip]);
+			if (levelRead)
+				memcpy(pDst, pSrc, levelSizes[mip]);
+		}
+#if KTX2_ZSTD_SUPERCOMPRESSION
+		else
+		{
+			size_t inflated = ZSTD_decompress(pDst, levelSizes[mip], pSrc, static_cast<size_t>(levels[mip].byteLength));
+			levelRead = (!ZSTD_isError(inflated) && inflated == levelSizes[mip]);
+		}
+#endif
+		if (!levelRead)
+		{
+			free(p_data.raw);
+			p_data.raw = nullptr;
+			std::cerr << "LoadKTX2: Error reading level " << mip << " of file " << p_data.name << std::endl;
+			return false;
+		}
+	}
+
+	// Without a mip chain in the file RGBA8 falls back to the mips blit on the GPU, block compressed formats keep the one level
+	if (header.levelCount == 0 && p_data.encoding == te_rgba8)
+		p_data.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(p_data.width, p_data.height)) + 1));
+	else
+		p_data.dataSize = dataSize;
+
 	return true;
 }
 
+bool LoadKTX2(const char* p_path, ImageRaw& p_data)
+{
+	CFileView file;
+	if (!file.Open(p_path))
+	{
+		std::cerr << "LoadKTX2: Could not open " << p_path << std::endl;
+		return false;
+	}
+
+	return LoadKTX2(file.GetData(), file.GetSize(), p_data);
+}
+
 bool LoadRawImage(const char* p_path, ImageRaw& p_data)
 {
+	PROFILE_FUNCTION();
+
 	GetFileName(p_path, p_data.name);
 
 	std::string extn;
@@ -497,17 +611,30 @@ bool LoadRawImage(const char* p_path, ImageRaw& p_data)
 
 	p_data.fileExtn = extn;
 
-	if (extn == "HDR" || extn == "hdr")
+	if (extn == "DDS" || extn == "dds")
 	{
-		p_data.raw_hdr = stbi_loadf(p_path, &p_data.width, &p_data.height, &p_data.channels, STBI_rgb_alpha);
+		RETURN_FALSE_IF_FALSE(LoadDDS(p_path, p_data));
 	}
-	else if (extn == "DDS" || extn == "dds")
+	else if (extn == "KTX2" || extn == "ktx2")
 	{
-		RETURN_FALSE_IF_FALSE(LoadDDS(p_path, p_data));
+		// comes with its mip count and format
+		return LoadKTX2(p_path, p_data);
 	}
 	else
 	{
-		p_data.raw = stbi_load(p_path, &p_data.width, &p_data.height, &p_data.channels, STBI_rgb_alpha);
+		// stb_image decodes from the view, where its own reads would go through a FILE*
+		CFileView file;
+		if (!file.Open(p_path))
+		{
+			std::cerr << "LoadRawImage Error: Could not open " << p_path << std::endl;
+			return false;
+		}
+
+		int fileSize = static_cast<int>(file.GetSize());
+		if (extn == "HDR" || extn == "hdr")
+			p_data.raw_hdr = stbi_loadf_from_memory(file.GetData(), fileSize, &p_data.width, &p_data.height, &p_data.channels, STBI_rgb_alpha);
+		else
+			p_data.raw = stbi_load_from_memory(file.GetData(), fileSize, &p_data.width, &p_data.height, &p_data.channels, STBI_rgb_alpha);
 	}
 
 	p_data.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(p_data.width, p_data.height)) + 1));
@@ -526,6 +653,56 @@ bool LoadRawImage(const char* p_path, ImageRaw& p_data)
 	return true;
 }
 
+// Keeps the file as is, width and height are read from its header for the loader to budget the decode
+static bool LoadEncodedImage(const unsigned char* p_fileData, size_t p_fileSize, ImageRaw& p_data)
+{
+	int width = 0, height = 0, channels = 0;
+	if (!stbi_info_from_memory(p_fileData, static_cast<int>(p_fileSize), &width, &height, &channels))
+		return false;
+
+	p_data.width = width;
+	p_data.height = height;
+	p_data.depthOrArraySize = 1;
+	p_data.channels = STBI_rgb_alpha;
+	p_data.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)) + 1));
+	p_data.encoding = te_file;
+	p_data.dataSize = p_fileSize;
+	p_data.raw = static_cast<unsigned char*>(malloc(p_fileSize));
+	memcpy(p_data.raw, p_fileData, p_fileSize);
+
+	return true;
+}
+
+bool DecodeRawImage(ImageRaw& p_data)
+{
+	PROFILE_FUNCTION();
+
+	if (p_data.encoding != te_file)
+		return true;
+
+	unsigned char* fileData = p_data.raw;
+	int fileSize = static_cast<int>(p_data.dataSize);
+	p_data.raw = nullptr;
+	p_data.encoding = te_rgba8;
+	p_data.dataSize = 0;
+
+	int channels = 0;
+	if (stbi_is_hdr_from_memory(fileData, fileSize))
+		p_data.raw_hdr = stbi_loadf_from_memory(fileData, fileSize, &p_data.width, &p_data.height, &channels, STBI_rgb_alpha);
+	else
+		p_data.raw = stbi_load_from_memory(fileData, fileSize, &p_data.width, &p_data.height, &channels, STBI_rgb_alpha);
+	free(fileData);
+
+	if (p_data.raw == nullptr &&
+		p_data.raw_hdr == nullptr)
+	{
+		std::cerr << "DecodeRawImage Error: stbi_load_from_memory Failed - " << p_data.name << ": " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
 void FreeRawImage(ImageRaw& p_data)
 {
 	bool needsDelete = (p_data.fileExtn == "DDS" || p_data.fileExtn == "dds");
@@ -546,7 +723,114 @@ void FreeRawImage(ImageRaw& p_data)
 	p_data = ImageRaw{};
 }
 
-bool LoadMaterials(tinygltf::Model p_gltfInput, SceneRaw& p_objScene, uint32_t p_texOffset)
+// KHR_texture_basisu moves the KTX2 image of a texture to the extension, the source then names a fallback for
+// loaders without the extension, or is missing
+static int GetTextureSource(const tinygltf::Texture& p_texture)
+{
+	auto basisu = p_texture.extensions.find("KHR_texture_basisu");
+	if (KTX2_BASIS_TRANSCODING || p_texture.source < 0)
+	{
+		if (basisu != p_texture.extensions.end() && basisu->second.Has("source"))
+			return basisu->second.Get("source").GetNumberAsInt();
+	}
+	return p_texture.source;
+}
+
+// Fills in the slot of the registered texture with the content of the file at p_path and the usage, false if there is
+// none and the file is to be loaded. Files are hashed once, from p_file when it is read already, their repeats are found
+// by path without reading them; without p_file a file not hashed yet is to be read too
+static bool FindRegisteredImage(CTextureRegistry* p_registry, const std::string& p_path, const CFileView* p_file, TextureUsage p_usage, ImageRaw& p_data)
+{
+	if (p_registry == nullptr)
+		return false;
+
+	uint64_t hash = 0;
+	if (!p_registry->FindFileHash(p_path, hash))
+	{
+		if (p_file == nullptr)
+			return false;
+
+		hash = CTextureRegistry::HashContent(p_file->GetData(), p_file->GetSize());
+		p_registry->AddFileHash(p_path, hash);
+	}
+
+	p_data.contentHash = hash;
+	p_data.usage = p_usage;
+	p_data.sharedSlot = p_registry->Find(hash, p_usage);
+	if (p_data.sharedSlot == MAX_SUPPORTED_TEXTURES)
+		return false;
+
+	GetFileName(p_path, p_data.name);
+	return true;
+}
+
+// Images LoadGltfImageData keeps from stb_image by index, LoadTextures picks them up
+struct GltfImages
+{
+	CTextureRegistry*						registry;
+	std::unordered_map<int, ImageRaw>		images;					// KTX2 ones and those registered already, without their data
+	std::vector<TextureUsage>				usages;					// by image, from the materials once they are parsed
+	std::unordered_map<int, uint64_t>		contentHashes;			// of every image when there is a registry
+	bool									deferDecode;
+};
+
+// tinygltf hands the bytes of every image to this, from the file of the uri or from the buffer. Images the registry
+// holds in the role the materials sample them in are not decoded, KTX2 images are parsed right from those bytes;
+// everything else goes to stb_image, now or later when the decode is deferred. Images of the buffers come before the
+// materials are parsed, their role is not known yet and they are looked up when staged
+static bool LoadGltfImageData(tinygltf::Image* p_image, const int p_imageIndex, std::string* p_error, std::string* p_warning,
+	int p_reqWidth, int p_reqHeight, const unsigned char* p_bytes, int p_size, void* p_userData)
+{
+	auto& gltfImages = *static_cast<GltfImages*>(p_userData);
+	if (gltfImages.registry != nullptr)
+	{
+		uint64_t hash = CTextureRegistry::HashContent(p_bytes, static_cast<size_t>(p_size));
+		gltfImages.contentHashes[p_imageIndex] = hash;
+
+		uint32_t slot = MAX_SUPPORTED_TEXTURES;
+		if (p_imageIndex < (int)gltfImages.usages.size())
+			slot = gltfImages.registry->Find(hash, gltfImages.usages[p_imageIndex]);
+
+		if (slot != MAX_SUPPORTED_TEXTURES)
+		{
+			ImageRaw& iraw = gltfImages.images[p_imageIndex];
+			iraw.name = p_image->uri.empty() ? p_image->name : p_image->uri;
+			iraw.usage = gltfImages.usages[p_imageIndex];
+			iraw.contentHash = hash;
+			iraw.sharedSlot = slot;
+			return true;
+		}
+	}
+
+	if (p_size < (int)sizeof(c_KTX2_IDENTIFIER) || memcmp(p_bytes, c_KTX2_IDENTIFIER, sizeof(c_KTX2_IDENTIFIER)) != 0)
+	{
+		if (gltfImages.deferDecode)
+		{
+			ImageRaw& iraw = gltfImages.images[p_imageIndex];
+			iraw.name = p_image->uri.empty() ? p_image->name : p_image->uri;
+			if (LoadEncodedImage(p_bytes, static_cast<size_t>(p_size), iraw))
+				return true;
+
+			gltfImages.images.erase(p_imageIndex);
+		}
+		return tinygltf::LoadImageData(p_image, p_imageIndex, p_error, p_warning, p_reqWidth, p_reqHeight, p_bytes, p_size, nullptr);
+	}
+
+	ImageRaw& iraw = gltfImages.images[p_imageIndex];
+	iraw.name = p_image->uri.empty() ? p_image->name : p_image->uri;
+	iraw.fileExtn = "ktx2";
+	if (!LoadKTX2(p_bytes, static_cast<size_t>(p_size), iraw))
+	{
+		if (p_error)
+			*p_error += "Failed to load KTX2 image " + iraw.name + "\n";
+		gltfImages.images.erase(p_imageIndex);
+		return false;
+	}
+
+	return true;
+}
+
+bool LoadMaterials(const tinygltf::Model& p_gltfInput, SceneRaw& p_objScene, uint32_t p_texOffset)
 {
 	// load materials
 	int materialCount = 0;
@@ -557,26 +841,26 @@ bool LoadMaterials(tinygltf::Model p_gltfInput, SceneRaw& p_objScene, uint32_t p
 		Material mat;
 		if (gltf_mat.values.find("baseColorTexture") != gltf_mat.values.end())
 		{
-			mat.color_id = p_texOffset + p_gltfInput.textures[gltf_mat.values["baseColorTexture"].TextureIndex()].source;
+			mat.color_id = p_texOffset + GetTextureSource(p_gltfInput.textures[gltf_mat.values.at("baseColorTexture").TextureIndex()]);
 		}
 
 		if (gltf_mat.additionalValues.find("normalTexture") != gltf_mat.additionalValues.end())
 		{
-			mat.normal_id = p_texOffset + p_gltfInput.textures[gltf_mat.additionalValues["normalTexture"].TextureIndex()].source;
+			mat.normal_id = p_texOffset + GetTextureSource(p_gltfInput.textures[gltf_mat.additionalValues.at("normalTexture").TextureIndex()]);
 		}
 
 		if (gltf_mat.values.find("metallicRoughnessTexture") != gltf_mat.values.end())
 		{
-			mat.roughMetal_id = p_texOffset + p_gltfInput.textures[gltf_mat.values["metallicRoughnessTexture"].TextureIndex()].source;
+			mat.roughMetal_id = p_texOffset + GetTextureSource(p_gltfInput.textures[gltf_mat.values.at("metallicRoughnessTexture").TextureIndex()]);
 		}
 
 		if (gltf_mat.values.find("emissiveTexture") != gltf_mat.values.end())
 		{
-			mat.emissive_id = p_texOffset + p_gltfInput.textures[gltf_mat.values["emissiveTexture"].TextureIndex()].source;
+			mat.emissive_id = p_texOffset + GetTextureSource(p_gltfInput.textures[gltf_mat.values.at("emissiveTexture").TextureIndex()]);
 		}
 		else if(gltf_mat.additionalValues.find("emissiveTexture") != gltf_mat.additionalValues.end())
 		{ 
-			mat.emissive_id = p_texOffset + p_gltfInput.textures[gltf_mat.additionalValues["emissiveTexture"].TextureIndex()].source;
+			mat.emissive_id = p_texOffset + GetTextureSource(p_gltfInput.textures[gltf_mat.additionalValues.at("emissiveTexture").TextureIndex()]);
 		}
 				
 		mat.pbr_color = nm::float3((float)gltf_mat.pbrMetallicRoughness.baseColorFactor[0], (float)gltf_mat.pbrMetallicRoughness.baseColorFactor[1], (float)gltf_mat.pbrMetallicRoughness.baseColorFactor[2]);
@@ -591,9 +875,62 @@ bool LoadMaterials(tinygltf::Model p_gltfInput, SceneRaw& p_objScene, uint32_t p
 	return true;
 }
 
-bool LoadTextures(tinygltf::Model p_gltfInput, SceneRaw& p_objScene, std::string p_folder)
+bool LoadTextures(const tinygltf::Model& p_gltfInput, SceneRaw& p_objScene, std::string p_folder, GltfImages& p_gltfImages)
 {
+	// Tagging every image with the role the materials sample it in, the texture compressor picks the format by it and
+	// the registry only shares a texture with an image of the same role
+	p_gltfImages.usages.assign(p_gltfInput.images.size(), tu_unknown);
+	auto tagUsage = [&](const tinygltf::ParameterMap& p_parameters, const char* p_name, TextureUsage p_usage)
+	{
+		auto parameter = p_parameters.find(p_name);
+		if (parameter == p_parameters.end())
+			return;
+
+		int source = GetTextureSource(p_gltfInput.textures[parameter->second.TextureIndex()]);
+		if (source < 0 || source >= (int)p_gltfInput.images.size())
+			return;
+
+		TextureUsage& usage = p_gltfImages.usages[source];
+		usage = (usage == tu_unknown || usage == p_usage) ? p_usage : tu_shared;
+	};
+
+	for (const auto& gltf_mat : p_gltfInput.materials)
+	{
+		tagUsage(gltf_mat.values,				"baseColorTexture",			tu_color);
+		tagUsage(gltf_mat.additionalValues,		"normalTexture",			tu_normal);
+		tagUsage(gltf_mat.values,				"metallicRoughnessTexture",	tu_roughMetal);
+		tagUsage(gltf_mat.values,				"emissiveTexture",			tu_emissive);
+		tagUsage(gltf_mat.additionalValues,		"emissiveTexture",			tu_emissive);
+	}
+
+	// tinygltf leaves the images of external files to this, see TINYGLTF_NO_EXTERNAL_IMAGE. Those the registry does
+	// not hold already are read together, then handed to LoadGltfImageData as the images of the file are
+	std::vector<int> externalImages;
+	std::vector<std::string> externalPaths;
+	for (int i = 0; i < static_cast<int>(p_gltfInput.images.size()); i++)
+	{
+		const tinygltf::Image& image = p_gltfInput.images[i];
+		if (!image.image.empty() || image.uri.empty() || p_gltfImages.images.count(i) > 0)
+			continue;
+
+		std::string path = (p_folder + "/" + image.uri);
+		ImageRaw shared{};
+		if (FindRegisteredImage(p_gltfImages.registry, path, nullptr, p_gltfImages.usages[i], shared))
+		{
+			p_gltfImages.images[i] = shared;
+			p_gltfImages.contentHashes[i] = shared.contentHash;
+			continue;
+		}
+
+		externalImages.push_back(i);
+		externalPaths.push_back(path);
+	}
+
+	std::vector<CFileView> externalFiles;
+	ReadFiles(externalPaths, externalFiles);
+
 	int textureCount = 0;
+	size_t externalCount = 0;
 	for (const auto& image : p_gltfInput.images)
 	{
 		std::clog << "Loading Texture: " << textureCount + 1 << " of " << p_gltfInput.images.size() << std::endl;
@@ -601,22 +938,60 @@ bool LoadTextures(tinygltf::Model p_gltfInput, SceneRaw& p_objScene, std::string
 		ImageRaw iraw{};
 		std::string path = (p_folder + "/" + image.uri);
 
-		if (image.image.empty())
+		// the external file is let go as soon as its image is loaded
+		const tinygltf::Image* loadedImage = &image;
+		tinygltf::Image externalImage;
+		if (externalCount < externalImages.size() && externalImages[externalCount] == textureCount)
+		{
+			CFileView& file = externalFiles[externalCount++];
+			if (file.GetData() == nullptr)
+			{
+				std::cerr << "LoadTextures Error: Failed to read " << path << std::endl;
+				return false;
+			}
+
+			std::string error, warning;
+			externalImage = image;
+			if (!LoadGltfImageData(&externalImage, textureCount, &error, &warning, 0, 0, file.GetData(), static_cast<int>(file.GetSize()), &p_gltfImages))
+			{
+				std::cerr << "LoadTextures Error: Failed to load " << path << " - " << error << std::endl;
+				return false;
+			}
+
+			if (p_gltfImages.registry != nullptr)
+				p_gltfImages.registry->AddFileHash(path, p_gltfImages.contentHashes[textureCount]);
+
+			file.Close();
+			loadedImage = &externalImage;
+		}
+
+		auto gltfImage = p_gltfImages.images.find(textureCount);
+		if (gltfImage != p_gltfImages.images.end())
 		{
-			RETURN_FALSE_IF_FALSE(LoadRawImage(path.c_str(), iraw));
+			iraw = gltfImage->second;
+		}
+		else if (loadedImage->image.empty())
+		{
+			if (!FindRegisteredImage(p_gltfImages.registry, path, nullptr, p_gltfImages.usages[textureCount], iraw))
+				RETURN_FALSE_IF_FALSE(LoadRawImage(path.c_str(), iraw));
 		}
 		else
 		{
-			unsigned char* test = nullptr;
 			iraw.name = image.uri;
-			iraw.width = image.width;
-			iraw.height = image.height;
-			iraw.channels = image.component;
+			iraw.width = loadedImage->width;
+			iraw.height = loadedImage->height;
+			iraw.channels = loadedImage->component;
 			iraw.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(iraw.width, iraw.height)) + 1));
 
-			iraw.raw = static_cast<unsigned char*>(malloc(image.image.size()));
-			memcpy(iraw.raw, image.image.data(), image.image.size());
-		}		
+			iraw.raw = static_cast<unsigned char*>(malloc(loadedImage->image.size()));
+			memcpy(iraw.raw, loadedImage->image.data(), loadedImage->image.size());
+		}
+
+		auto contentHash = p_gltfImages.contentHashes.find(textureCount);
+		if (contentHash != p_gltfImages.contentHashes.end())
+			iraw.contentHash = contentHash->second;
+
+		iraw.usage = p_gltfImages.usages[textureCount];
 		p_objScene.textureList.push_back(iraw);
 		
 		textureCount++;
@@ -631,9 +1006,189 @@ bool LoadTextures(tinygltf::Model p_gltfInput, SceneRaw& p_objScene, std::string
 	return true;
 }
 
-bool LoadNode(const tinygltf::Node node, tinygltf::Model input, MeshRaw& objMesh, const ObjLoadData& p_loadData, uint32_t p_matOffset, nm::float4x4 transform)
+// Mesh space length one UV unit spans on the surface, from the areas the triangles cover in space and in UV
+static float ComputeUVDensity(MeshRaw& p_objMesh, uint32_t p_firstIndex, uint32_t p_indexCount)
+{
+	const float* vertices = p_objMesh.vertexList.data();
+	uint32_t vertexSize = p_objMesh.vertexList.GetVertexSize();
+	uint32_t positionOffset = p_objMesh.vertexList.GetOffsetOf(Vertex::AttributeFlag::position);
+	uint32_t uvOffset = p_objMesh.vertexList.GetOffsetOf(Vertex::AttributeFlag::uv);
+
+	double area = 0.0;
+	double uvArea = 0.0;
+	for (uint32_t i = p_firstIndex; i + 2 < p_firstIndex + p_indexCount; i += 3)
+	{
+		const float* v0 = &vertices[p_objMesh.indicesList[i + 0] * vertexSize];
+		const float* v1 = &vertices[p_objMesh.indicesList[i + 1] * vertexSize];
+		const float* v2 = &vertices[p_objMesh.indicesList[i + 2] * vertexSize];
+
+		nm::float3 p0(v0[positionOffset + 0], v0[positionOffset + 1], v0[positionOffset + 2]);
+		nm::float3 p1(v1[positionOffset + 0], v1[positionOffset + 1], v1[positionOffset + 2]);
+		nm::float3 p2(v2[positionOffset + 0], v2[positionOffset + 1], v2[positionOffset + 2]);
+		area += 0.5 * nm::length(nm::cross(p1 - p0, p2 - p0));
+
+		float du1 = v1[uvOffset + 0] - v0[uvOffset + 0], dv1 = v1[uvOffset + 1] - v0[uvOffset + 1];
+		float du2 = v2[uvOffset + 0] - v0[uvOffset + 0], dv2 = v2[uvOffset + 1] - v0[uvOffset + 1];
+		uvArea += 0.5 * std::abs(du1 * dv2 - du2 * dv1);
+	}
+
+	return (uvArea > 0.0) ? (float)std::sqrt(area / uvArea) : 0.0f;
+}
+
+bool LoadMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& input, MeshRaw& objMesh, uint32_t p_matOffset)
+{
+	SharedMesh sharedMesh{};
+	sharedMesh.name = mesh.name;
+	sharedMesh.firstSubmesh = static_cast<uint32_t>(objMesh.submeshes.size());
+	sharedMesh.firstIndex = static_cast<uint32_t>(objMesh.indicesList.size());
+
+	for (size_t i = 0; i < mesh.primitives.size(); i++)
+	{
+		const tinygltf::Primitive& glTFPrimitive = mesh.primitives[i];
+		uint32_t firstIndex = static_cast<uint32_t>(objMesh.indicesList.size());
+		uint32_t vertexStart = static_cast<uint32_t>(objMesh.vertexList.size() / objMesh.vertexList.GetVertexSize());
+		uint32_t indexCount = 0;
+		nm::float3 bbMin{ FLT_MAX, FLT_MAX, FLT_MAX };
+		nm::float3 bbMax{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		bool flipUV = false;
+		bool hasUVs = false;
+
+		//Vertices
+		{
+			// Every attribute is read to floats whatever its stride and component type, see ReadGltfAccessor
+			std::vector<float> positions, normals, texCoords, tangents;
+			size_t vertexCount = 0;
+
+			auto position = glTFPrimitive.attributes.find("POSITION");
+			if (position != glTFPrimitive.attributes.end())
+			{
+				RETURN_FALSE_IF_FALSE(ReadGltfAccessor(input, position->second, 3, positions));
+				vertexCount = input.accessors[position->second].count;
+			}
+
+			// An attribute with a count other than the positions' is left out
+			auto readAttribute = [&](const char* p_name, uint32_t p_components, std::vector<float>& p_values)
+			{
+				auto attribute = glTFPrimitive.attributes.find(p_name);
+				if (attribute == glTFPrimitive.attributes.end())
+					return true;
+
+				RETURN_FALSE_IF_FALSE(ReadGltfAccessor(input, attribute->second, p_components, p_values));
+				if (p_values.size() != vertexCount * p_components)
+				{
+					std::cerr << "LoadMesh Error: " << p_name << " of " << mesh.name << " does not match its positions" << std::endl;
+					p_values.clear();
+				}
+				return true;
+			};
+
+			RETURN_FALSE_IF_FALSE(readAttribute("NORMAL", 3, normals));
+			// glTF supports multiple sets, we only load the first one
+			RETURN_FALSE_IF_FALSE(readAttribute("TEXCOORD_0", 2, texCoords));
+			// POI: This sample uses normal mapping, so we also need to load the tangents from the glTF file
+			RETURN_FALSE_IF_FALSE(readAttribute("TANGENT", 4, tangents));
+
+			if (!texCoords.empty())
+			{
+				hasUVs = true;
+
+				// UV.y is over 1, must current this.
+				const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("TEXCOORD_0")->second];
+				if ((accessor.minValues.size() == 2 && accessor.minValues[1] > 1.0) || 
+					(accessor.maxValues.size() == 2 && accessor.maxValues[1] > 1.0))
+				{
+					flipUV = true;
+				}
+			}
+
+			// Positions are kept in mesh space, node transforms are carried by the instances
+			Vertex vert = objMesh.vertexList.CreateVertex();
+			for (size_t v = 0; v < vertexCount; v++) {
+				vert.AddAttribute(Vertex::AttributeFlag::position, &positions[v * 3]);
+				
+				vert.AddAttribute(Vertex::AttributeFlag::normal, 
+					&(!normals.empty() ? 
+						nm::normalize(nm::float3(normals[(v * 3) + 0], normals[(v * 3) + 1], normals[(v * 3) + 2])) : 
+						nm::float3(0.0f))[0]);
+				
+				vert.AddAttribute(Vertex::AttributeFlag::uv, 
+					&(!texCoords.empty() ? 
+						nm::float2(texCoords[(v * 2) + 0], texCoords[(v * 2) + 1]) : 
+						nm::float2(0.0f))[0]);
+				
+				vert.AddAttribute(Vertex::AttributeFlag::tangent, 
+					&(!tangents.empty() ? 
+						nm::float4(tangents[(v * 4) + 0], tangents[(v * 4) + 1], tangents[(v * 4) + 2], tangents[(v * 4) + 3]) : 
+						nm::float4(0.0))[0]);
+
+				if (flipUV == true)
+				{
+					float* uv = vert.GetAttribute(Vertex::AttributeFlag::uv);
+					uv[1] = 1.0f - uv[1];
+				}
+
+				float* position = vert.GetAttribute(Vertex::AttributeFlag::position);
+				bbMin[0] = std::min(bbMin[0], position[0]);
+				bbMin[1] = std::min(bbMin[1], position[1]);
+				bbMin[2] = std::min(bbMin[2], position[2]);
+
+				bbMax[0] = std::max(bbMax[0], position[0]);
+				bbMax[1] = std::max(bbMax[1], position[1]);
+				bbMax[2] = std::max(bbMax[2], position[2]);
+
+				objMesh.vertexList.AddVertex(vert);
+			}
+		}
+
+		{
+			// glTF supports different component types of indices, a primitive without is a plain triangle list
+			std::vector<uint32_t> indices;
+			if (glTFPrimitive.indices >= 0)
+			{
+				RETURN_FALSE_IF_FALSE(ReadGltfIndices(input, glTFPrimitive.indices, indices));
+			}
+			else
+			{
+				uint32_t vertexCount = static_cast<uint32_t>(objMesh.vertexList.size() / objMesh.vertexList.GetVertexSize()) - vertexStart;
+				for (uint32_t index = 0; index < vertexCount; index++)
+					indices.push_back(index);
+			}
+
+			indexCount += static_cast<uint32_t>(indices.size());
+			for (uint32_t index : indices)
+				objMesh.indicesList.push_back(index + vertexStart);
+		}
+
+		SubMesh submesh{};
+		submesh.name = mesh.name + "_" + std::to_string(objMesh.submeshes.size());	// this is to make sure all names are unique
+		submesh.firstIndex = firstIndex;
+		submesh.indexCount = indexCount;
+		submesh.materialId = p_matOffset + glTFPrimitive.material;
+		submesh.uvDensity = hasUVs ? ComputeUVDensity(objMesh, firstIndex, indexCount) : 0.0f;
+		objMesh.submeshes.push_back(submesh);
+
+		BBox meshbox(BBox::Type::Custom, BBox::Origin::Center, bbMin, bbMax);
+		sharedMesh.submeshesBbox.push_back(meshbox);
+	}
+
+	sharedMesh.submeshCount = static_cast<uint32_t>(objMesh.submeshes.size()) - sharedMesh.firstSubmesh;
+	sharedMesh.indexCount = static_cast<uint32_t>(objMesh.indicesList.size()) - sharedMesh.firstIndex;
+	objMesh.sharedMeshes.push_back(sharedMesh);
+
+	return true;
+}
+
+// p_meshToShared maps a glTF mesh index to its shared mesh in objMesh, -1 if it is not loaded yet
+bool LoadNode(const tinygltf::Node& node, const tinygltf::Model& input, MeshRaw& objMesh, std::vector<int>& p_meshToShared, uint32_t p_matOffset, nm::float4x4 transform)
 {
 	nm::float4x4 temp_transform = transform;
+	if (node.matrix.size() == 16) {
+		nm::float4x4 node_mat = nm::float4x4::identity();
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				node_mat.column[c][r] = (float)node.matrix[(c * 4) + r];
+		temp_transform = temp_transform * node_mat;
+	}
 	if (node.translation.size() == 3) {
 		temp_transform = temp_transform * nm::translation(nm::float3((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]));
 	}
@@ -649,166 +1204,77 @@ bool LoadNode(const tinygltf::Node node, tinygltf::Model input, MeshRaw& objMesh
 	// Load node's children
 	if (node.children.size() > 0) {
 		for (size_t i = 0; i < node.children.size(); i++) {
-			LoadNode(input.nodes[node.children[i]], input, objMesh, p_loadData, p_matOffset, temp_transform);
+			RETURN_FALSE_IF_FALSE(LoadNode(input.nodes[node.children[i]], input, objMesh, p_meshToShared, p_matOffset, temp_transform));
 		}
 	}
 
 	if (node.mesh > -1)
 	{
-		const tinygltf::Mesh mesh = input.meshes[node.mesh];
-		for (size_t i = 0; i < mesh.primitives.size(); i++)
+		// A mesh referenced by many nodes is loaded only once
+		if (p_meshToShared[node.mesh] < 0)
 		{
-			const tinygltf::Primitive& glTFPrimitive = mesh.primitives[i];
-			uint32_t firstIndex = static_cast<uint32_t>(objMesh.indicesList.size());
-			uint32_t vertexStart = static_cast<uint32_t>(objMesh.vertexList.size() / objMesh.vertexList.GetVertexSize());
-			uint32_t indexCount = 0;
-			nm::float3 bbMin{ 0, 0, 0 };
-			nm::float3 bbMax{ 0, 0, 0 };
-			bool flipUV = false;
-
-			//Vertices
-			{
-				const float* positionBuffer = nullptr;
-				const float* normalsBuffer = nullptr;
-				const float* texCoordsBuffer = nullptr;
-				const float* tangentsBuffer = nullptr;
-				size_t vertexCount = 0;
-
-				// Get buffer data for vertex normals
-				if (glTFPrimitive.attributes.find("POSITION") != glTFPrimitive.attributes.end()) {
-					const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("POSITION")->second];
-					const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
-					positionBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-					vertexCount = accessor.count;
-				}
-				// Get buffer data for vertex normals
-				if (glTFPrimitive.attributes.find("NORMAL") != glTFPrimitive.attributes.end()) {
-					const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("NORMAL")->second];
-					const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
-					normalsBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-				}
-				// Get buffer data for vertex texture coordinates
-				// glTF supports multiple sets, we only load the first one
-				if (glTFPrimitive.attributes.find("TEXCOORD_0") != glTFPrimitive.attributes.end()) {
-					const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("TEXCOORD_0")->second];
-					const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
-					texCoordsBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-
-					// UV.y is over 1, must current this.
-					if ((accessor.minValues.size() == 2 && accessor.minValues[1] > 1.0) || 
-						(accessor.maxValues.size() == 2 && accessor.maxValues[1] > 1.0))
-					{
-						flipUV = true;
-					}
-				}
-				// POI: This sample uses normal mapping, so we also need to load the tangents from the glTF file
-				if (glTFPrimitive.attributes.find("TANGENT") != glTFPrimitive.attributes.end()) {
-					const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("TANGENT")->second];
-					const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
-					tangentsBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-
-					if (!tangentsBuffer)
-						CLOG_RED("Tangents not found in the Asset. Must add support for creation." << std::endl);
-
-				}
+			RETURN_FALSE_IF_FALSE(LoadMesh(input.meshes[node.mesh], input, objMesh, p_matOffset));
+			p_meshToShared[node.mesh] = static_cast<int>(objMesh.sharedMeshes.size()) - 1;
+		}
 
-				for (size_t v = 0; v < vertexCount; v++) {
-					Vertex vert = objMesh.vertexList.CreateVertex();
-					vert.AddAttribute(Vertex::AttributeFlag::position, &((temp_transform * 
-						nm::float4(positionBuffer[(v * 3) + 0], positionBuffer[(v * 3) + 1], positionBuffer[(v * 3) + 2], 1.0f)).xyz())[0]);
-					
-					vert.AddAttribute(Vertex::AttributeFlag::normal, 
-						&(normalsBuffer ? 
-							nm::normalize(nm::float3(normalsBuffer[(v * 3) + 0], normalsBuffer[(v * 3) + 1], normalsBuffer[(v * 3) + 2])) : 
-							nm::float3(0.0f))[0]);
-					
-					vert.AddAttribute(Vertex::AttributeFlag::uv, 
-						&(texCoordsBuffer ? 
-							nm::float2(texCoordsBuffer[(v * 2) + 0], texCoordsBuffer[(v * 2) + 1]) : 
-							nm::float2(0.0f))[0]);
-					
-					vert.AddAttribute(Vertex::AttributeFlag::tangent, 
-						&(tangentsBuffer ? 
-							nm::float4(tangentsBuffer[(v * 4) + 0], tangentsBuffer[(v * 4) + 1], tangentsBuffer[(v * 4) + 2], tangentsBuffer[(v * 4) + 3]) : 
-							nm::float4(0.0))[0]);
-
-					if (flipUV == true)
-					{
-						float* uv = vert.GetAttribute(Vertex::AttributeFlag::uv);
-						uv[1] = 1.0f - uv[1];
-					}
-
-					float* position = vert.GetAttribute(Vertex::AttributeFlag::position);
-					bbMin[0] = std::min(bbMin[0], position[0]);
-					bbMin[1] = std::min(bbMin[1], position[1]);
-					bbMin[2] = std::min(bbMin[2], position[2]);
-
-					bbMax[0] = std::max(bbMax[0], position[0]);
-					bbMax[1] = std::max(bbMax[1], position[1]);
-					bbMax[2] = std::max(bbMax[2], position[2]);
-
-					objMesh.vertexList.AddVertex(vert);
-				}
-			}
+		objMesh.instances.push_back(MeshInstance{ static_cast<uint32_t>(p_meshToShared[node.mesh]), temp_transform });
+	}
 
-			{
-				const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.indices];
-				const tinygltf::BufferView& bufferView = input.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer& buffer = input.buffers[bufferView.buffer];
-
-				indexCount += static_cast<uint32_t>(accessor.count);
-
-				// glTF supports different component types of indices
-				switch (accessor.componentType) {
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-					const uint32_t* buf = reinterpret_cast<const uint32_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-					for (size_t index = 0; index < accessor.count; index++) {
-						objMesh.indicesList.push_back(buf[index] + vertexStart);
-					}
-					break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-					const uint16_t* buf = reinterpret_cast<const uint16_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-					for (size_t index = 0; index < accessor.count; index++) {
-						objMesh.indicesList.push_back(buf[index] + vertexStart);
-					}
-					break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-					const uint8_t* buf = reinterpret_cast<const uint8_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-					for (size_t index = 0; index < accessor.count; index++) {
-						objMesh.indicesList.push_back(buf[index] + vertexStart);
-					}
-					break;
-				}
-				default:
-					std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
-					return false;
-				}
-			}
+	return true;
+}
 
-			SubMesh submesh{};
-			submesh.name = mesh.name + "_" + std::to_string(objMesh.submeshes.size());	// this is to make sure all names are unique
-			submesh.firstIndex = firstIndex;
-			submesh.indexCount = indexCount;
-			submesh.materialId = p_matOffset + glTFPrimitive.material;
-			objMesh.submeshes.push_back(submesh);
+// tinygltf reads the external buffers through the file backend as well
+static bool ReadGltfFile(std::vector<unsigned char>* p_out, std::string* p_error, const std::string& p_path, void*)
+{
+	CFileView file;
+	if (!file.Open(p_path.c_str()))
+	{
+		if (p_error)
+			*p_error += "File read error : " + p_path + "\n";
+		return false;
+	}
 
-			BBox meshbox(BBox::Type::Custom, BBox::Origin::Center, bbMin, bbMax);
-			objMesh.submeshesBbox.push_back(meshbox);
+	p_out->assign(file.GetData(), file.GetData() + file.GetSize());
+	return true;
+}
 
-		}
+static bool GetGltfFileSize(size_t* p_size, std::string* p_error, const std::string& p_path, void*)
+{
+	std::error_code error;
+	std::uintmax_t size = std::filesystem::file_size(p_path, error);
+	if (error)
+	{
+		if (p_error)
+			*p_error += "File size error : " + p_path + "\n";
+		return false;
 	}
 
+	*p_size = static_cast<size_t>(size);
 	return true;
 }
 
 bool LoadGltf(const char* p_path, SceneRaw& p_objScene, const ObjLoadData& p_loadData)
 {
+	PROFILE_FUNCTION();
+
 	tinygltf::Model input;
 	tinygltf::TinyGLTF gltfContext;
 	std::string error, warning;
 
+	GltfImages gltfImages;
+	gltfImages.registry = p_loadData.textureRegistry;
+	gltfImages.deferDecode = p_loadData.deferDecode;
+	gltfContext.SetImageLoader(LoadGltfImageData, &gltfImages);
+
+	tinygltf::FsCallbacks fsCallbacks{};
+	fsCallbacks.FileExists = &tinygltf::FileExists;
+	fsCallbacks.ExpandFilePath = &tinygltf::ExpandFilePath;
+	fsCallbacks.ReadWholeFile = &ReadGltfFile;
+	fsCallbacks.WriteWholeFile = &tinygltf::WriteWholeFile;
+	fsCallbacks.GetFileSizeInBytes = &GetGltfFileSize;
+	fsCallbacks.user_data = nullptr;
+	gltfContext.SetFsCallbacks(fsCallbacks);
+
 	std::string strPath = std::string(p_path);
 	std::size_t found = strPath.find_last_of("/");
 	if (found == std::string::npos)
@@ -829,9 +1295,28 @@ bool LoadGltf(const char* p_path, SceneRaw& p_objScene, const ObjLoadData& p_loa
 		return false;
 	}
 
-	if (fileExtn == "gltf")
+	// Parsed from the view of the file, tinygltf only copies the buffers out of a .glb
+	CFileView gltfFile;
+	if (!gltfFile.Open(p_path))
 	{
-		if (!gltfContext.LoadASCIIFromFile(&input, &error, &warning, p_path))
+		std::cerr << "LoadGltf Error: Failed to read Gltf - " << p_path << std::endl;
+		return false;
+	}
+
+	const unsigned char* gltfData = gltfFile.GetData();
+	unsigned int gltfSize = static_cast<unsigned int>(gltfFile.GetSize());
+	if (GetGltfParser() == gp_streaming && (fileExtn == "gltf" || fileExtn == "glb"))
+	{
+		if (!ParseGltf(gltfData, gltfFile.GetSize(), folderPath, &LoadGltfImageData, &gltfImages, input, error))
+		{
+			std::cerr << "LoadGltf Error: Failed to load Gltf - " << p_path << std::endl;
+			std::cerr << error << std::endl;
+			return false;
+		}
+	}
+	else if (fileExtn == "gltf")
+	{
+		if (!gltfContext.LoadASCIIFromString(&input, &error, &warning, reinterpret_cast<const char*>(gltfData), gltfSize, folderPath))
 		{
 			std::cerr << "LoadGltf Error: Failed to load Gltf - " << p_path << std::endl;
 			std::cerr << error << std::endl;
@@ -840,19 +1325,29 @@ bool LoadGltf(const char* p_path, SceneRaw& p_objScene, const ObjLoadData& p_loa
 	}
 	else if (fileExtn == "glb")
 	{
-		if (!gltfContext.LoadBinaryFromFile(&input, &error, &warning, p_path))
+		if (!gltfContext.LoadBinaryFromMemory(&input, &error, &warning, gltfData, gltfSize, folderPath))
 		{
 			std::cerr << "LoadGltf Error: Failed to load Gltf - " << p_path << std::endl;
 			std::cerr << error << std::endl;
 			return false;
 		}
 	}
+	gltfFile.Close();
+
+	// Meshopt and Draco compressed meshes are decoded to plain accessors before anything reads them
+	CMeshDecoder localMeshDecoder;
+	CMeshDecoder* meshDecoder = (p_loadData.meshDecoder != nullptr) ? p_loadData.meshDecoder : &localMeshDecoder;
+	if (!meshDecoder->Decode(input))
+	{
+		std::cerr << "LoadGltf Error: Failed to decode the compressed meshes of " << p_path << std::endl;
+		return false;
+	}
 
 	//uint32_t material_offset = (uint32_t)p_objScene.materialsList.size();
 	//uint32_t texture_offset = (uint32_t)p_objScene.textureList.size();
 
 	RETURN_FALSE_IF_FALSE(LoadMaterials(input, p_objScene, p_objScene.textureOffset));
-	RETURN_FALSE_IF_FALSE(LoadTextures(input, p_objScene, folderPath));
+	RETURN_FALSE_IF_FALSE(LoadTextures(input, p_objScene, folderPath, gltfImages));
 			
 	MeshRaw objMesh;
 	objMesh.vertexList = VertexList(Vertex::AttributeFlag::position | Vertex::AttributeFlag::normal | Vertex::AttributeFlag::uv | Vertex::AttributeFlag::tangent);
@@ -865,13 +1360,39 @@ bool LoadGltf(const char* p_path, SceneRaw& p_objScene, const ObjLoadData& p_loa
 		}
 	}
 
-	const tinygltf::Scene& scene = input.scenes[0];
+	// Every glTF mesh is loaded once and every node referencing it is loaded as an instance
+	std::vector<int> meshToShared(input.meshes.size(), -1);
+	const tinygltf::Scene& scene = input.scenes[input.defaultScene > -1 ? input.defaultScene : 0];
 	for (size_t n_id = 0; n_id < scene.nodes.size(); n_id++)
 	{
 		std::clog << "Loading GLTF Node: " << n_id << " of " << scene.nodes.size() << std::endl;
-		const tinygltf::Node node = input.nodes[n_id];
-		LoadNode(node, input, objMesh, p_loadData, p_objScene.materialOffset, nm::float4x4::identity());
+		const tinygltf::Node& node = input.nodes[scene.nodes[n_id]];
+		RETURN_FALSE_IF_FALSE(LoadNode(node, input, objMesh, meshToShared, p_objScene.materialOffset, nm::float4x4::identity()));
+	}
+
+	// Keeping the instances of a shared mesh contiguous so they can be drawn with a single instanced draw
+	std::stable_sort(objMesh.instances.begin(), objMesh.instances.end(), 
+		[](const MeshInstance& a, const MeshInstance& b) { return a.sharedMeshId < b.sharedMeshId; });
+
+	for (auto& sharedMesh : objMesh.sharedMeshes)
+	{
+		sharedMesh.firstInstance = 0;
+		sharedMesh.instanceCount = 0;
 	}
+
+	for (uint32_t i = 0; i < (uint32_t)objMesh.instances.size(); i++)
+	{
+		SharedMesh& sharedMesh = objMesh.sharedMeshes[objMesh.instances[i].sharedMeshId];
+		if (sharedMesh.instanceCount == 0)
+			sharedMesh.firstInstance = i;
+		sharedMesh.instanceCount++;
+
+		// sub-mesh bounding boxes are placed relative to the asset for every instance
+		for (auto& bbox : sharedMesh.submeshesBbox)
+			objMesh.submeshesBbox.push_back(bbox * objMesh.instances[i].transform);
+	}
+
+	std::clog << "LoadGltf: " << objMesh.sharedMeshes.size() << " unique meshes, " << objMesh.instances.size() << " instances" << std::endl;
 			
 	nm::float3 bbMin = nm::float3{ 0.0f, 0.0f, 0.0f };
 	nm::float3 bbMax = nm::float3{ 0.0f, 0.0f, 0.0f };
@@ -895,7 +1416,7 @@ bool LoadGltf(const char* p_path, SceneRaw& p_objScene, const ObjLoadData& p_loa
 		//objMesh.transform.SetTranslate((nm::translation(translationFactor)));
 	}
 
-	p_objScene.meshList.push_back(objMesh);
+	p_objScene.meshList.push_back(std::move(objMesh));
 
 	p_objScene.materialOffset = (uint32_t)p_objScene.materialsList.size();
 	p_objScene.textureOffset = (uint32_t)p_objScene.textureList.size();
@@ -976,62 +1497,68 @@ bool LoadObj(const char* p_path, SceneRaw& p_objScene, const ObjLoadData& p_load
 					attrib.colors[3 * index.vertex_index + 2]*/
 				//};
 
-				if (uniqueVertices.count(vertex) == 0)
-				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertList->size() / vertList->GetVertexSize());
-					vertList->AddVertex(vertex);
-				}
-
-				indList->push_back(uniqueVertices[vertex]);
+				indList->push_back(WeldVertex(vertex, *vertList, uniqueVertices));
 				i++;
 			}
 		}
 		meshCount++;
 	}
-	p_objScene.meshList.push_back(objMesh);
+	CreateSingleInstance(objMesh);
+	p_objScene.meshList.push_back(std::move(objMesh));
 
 	if (p_loadData.loadMeshOnly == true)
 		return true;
 
+	// Every material has a diffuse and a normal texture, the files of all of them are read together
 	auto& materials = objReader.GetMaterials();
+	std::vector<std::string> texturePaths;
 	for (auto& material : materials)
 	{
-		int width, height, channels;
-		// loading diffuse textures
-		{
-			ImageRaw diffuse{};		// initializing diffuse raw texture
-			if (!material.diffuse_texname.empty())
-			{
-				std::string diffusePath = folderPath + "/" + material.diffuse_texname.c_str();
-				diffuse.raw = stbi_load(diffusePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-				diffuse.width = width;
-				diffuse.height = height;
-				diffuse.channels = channels;
-			}
-			else
-				std::clog << "Diffuse Mat Not Found: " << material.name << std::endl;
+		if (material.diffuse_texname.empty())
+			std::clog << "Diffuse Mat Not Found: " << material.name << std::endl;
+		if (material.bump_texname.empty())
+			std::clog << "Normal Mat Not Found: " << material.name << std::endl;
 
-			p_objScene.textureList.push_back(diffuse);
-		}
-		{
-			ImageRaw normal{};	// initialized normal raw texture
-			if (!material.bump_texname.empty())
-			{
-				std::string normalPath = folderPath + "/" + material.bump_texname.c_str();
-				normal.raw = stbi_load(normalPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-				normal.width = width;
-				normal.height = height;
-				normal.channels = channels;
-			}
-			else
-			{
-				std::clog << "Normal Mat Not Found: " << material.name << std::endl;
-			}
+		texturePaths.push_back(material.diffuse_texname.empty() ? std::string() : folderPath + "/" + material.diffuse_texname);
+		texturePaths.push_back(material.bump_texname.empty() ? std::string() : folderPath + "/" + material.bump_texname);
+	}
+
+	std::vector<ImageRaw> textures(texturePaths.size());
+	std::vector<size_t> readTextures;
+	std::vector<std::string> readPaths;
+	for (size_t i = 0; i < texturePaths.size(); i++)
+	{
+		if (texturePaths[i].empty() || FindRegisteredImage(p_loadData.textureRegistry, texturePaths[i], nullptr, tu_unknown, textures[i]))
+			continue;
+
+		readTextures.push_back(i);
+		readPaths.push_back(texturePaths[i]);
+	}
+
+	// a texture that fails to read or decode is left without data, the default texture stands in for it
+	std::vector<CFileView> files;
+	ReadFiles(readPaths, files);
+	for (size_t i = 0; i < readTextures.size(); i++)
+	{
+		ImageRaw& texture = textures[readTextures[i]];
+		CFileView& file = files[i];
+		if (file.GetData() == nullptr || FindRegisteredImage(p_loadData.textureRegistry, readPaths[i], &file, tu_unknown, texture))
+			continue;
 
-			p_objScene.textureList.push_back(normal);
+		GetFileName(readPaths[i], texture.name);
+		if (!p_loadData.deferDecode || !LoadEncodedImage(file.GetData(), file.GetSize(), texture))
+		{
+			int width = 0, height = 0, channels = 0;
+			texture.raw = stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &width, &height, &channels, STBI_rgb_alpha);
+			texture.width = width;
+			texture.height = height;
+			texture.channels = channels;
 		}
+		file.Close();
 	}
 
+	p_objScene.textureList.insert(p_objScene.textureList.end(), textures.begin(), textures.end());
+
 	return true;
 }
 
@@ -1194,18 +1721,12 @@ float BBox::GetWidth() const
 	return std::abs(bbMin[0]) + std::abs(bbMax[0]);
 }
 
+// true if the boxes overlap
 bool BBox::isVisiable(BBox p_b)
 {
-	//for (int i = 0; i < 8; i++)
-	//{
-	//	if (p_b.bBox[i].x() > this->bbMin.x() && p_b.bBox[i].x() <= this->bbMax.x() &&
-	//		p_b.bBox[i].x() > this->bbMin.y() && p_b.bBox[i].y() <= this->bbMax.y() &&
-	//		p_b.bBox[i].x() > this->bbMin.z() && p_b.bBox[i].z() <= this->bbMax.z())
-	//	{
-	//		return true;
-	//	}
-	//}
-	return false;
+	return	p_b.bbMin[0] <= this->bbMax[0] && p_b.bbMax[0] >= this->bbMin[0] &&
+			p_b.bbMin[1] <= this->bbMax[1] && p_b.bbMax[1] >= this->bbMin[1] &&
+			p_b.bbMin[2] <= this->bbMax[2] && p_b.bbMax[2] >= this->bbMin[2];
 }
 
 bool BBox::isVisiable(BSphere p_s)
@@ -1374,6 +1895,35 @@ BFrustum::BFrustum(nm::float4x4 p_viewProj)
 	: BVolume(BVolume::BType::Frustum)
 	, viewProjection(p_viewProj)
 {
+	// rows of the view projection; a point is inside when -w <= x, y, z <= w in clip space. The camera projects
+	// depth to -1 to 1, for a 0 to 1 projection the near plane ends up slightly behind the real one
+	nm::float4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = nm::float4(p_viewProj.column[0][i], p_viewProj.column[1][i], p_viewProj.column[2][i], p_viewProj.column[3][i]);
+
+	planes[0] = row[3] + row[0];
+	planes[1] = row[3] - row[0];
+	planes[2] = row[3] + row[1];
+	planes[3] = row[3] - row[1];
+	planes[4] = row[3] + row[2];
+	planes[5] = row[3] - row[2];
+}
+
+bool BFrustum::isVisiable(const BBox& p_b) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// the corner furthest along the plane's normal
+		nm::float4 corner(
+			planes[i][0] >= 0.0f ? p_b.bbMax[0] : p_b.bbMin[0],
+			planes[i][1] >= 0.0f ? p_b.bbMax[1] : p_b.bbMin[1],
+			planes[i][2] >= 0.0f ? p_b.bbMax[2] : p_b.bbMin[2],
+			1.0f);
+
+		if (nm::dot(planes[i], corner) < 0.0f)
+			return false;
+	}
+	return true;
 }
 
 /*
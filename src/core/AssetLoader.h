@@ -4,16 +4,50 @@
 #include <vector>
 #include <cmath>
 #include <map>
+#include <unordered_map>
 
 #include "external/NiceMath.h"
 
 
 #include "Global.h"
 
+// KTX2 levels supercompressed with Zstandard are inflated at load; the build has to link zstd
+#if !defined(KTX2_ZSTD_SUPERCOMPRESSION)
+#define KTX2_ZSTD_SUPERCOMPRESSION 0
+#endif
+// KTX2 files in the Basis Universal encodings are transcoded to BC by CTextureCompressor; the build has to
+// compile external/basis_universal/transcoder/basisu_transcoder.cpp
+#if !defined(KTX2_BASIS_TRANSCODING)
+#define KTX2_BASIS_TRANSCODING 0
+#endif
+
 bool GetFileExtention(const std::string fileName, std::string& pExtentionn);
 
 bool GetFileName(const std::string fileName, std::string& pExtentionn, const char pDelimiter[2] = "/");
 
+// Role of a texture in the materials sampling it
+enum TextureUsage
+{
+	  tu_unknown					= 0		// not referenced by a material, or by a loader that does not tell
+	, tu_color
+	, tu_normal
+	, tu_roughMetal
+	, tu_emissive
+	, tu_shared								// sampled in more than one role
+};
+
+enum TextureEncoding
+{
+	  te_rgba8						= 0		// raw holds the base level only and the mips are blit on the GPU, unless dataSize is set
+	, te_bc1
+	, te_bc4
+	, te_bc5
+	, te_bc7
+	, te_basis								// raw holds a whole KTX2 file in ETC1S or UASTC, to be transcoded before upload
+	, te_file								// raw holds a whole PNG, JPG or other stb_image file of dataSize bytes, see DecodeRawImage
+	, te_rgb9e5								// raw holds RGB9E5 cube map texels, every mip of a face before the next face, see CEnvironmentBaker
+};
+
 struct ImageRaw
 {
 	std::string					name;
@@ -25,6 +59,12 @@ struct ImageRaw
 	int							channels;
 	uint32_t					mipLevels;
 	std::string					fileExtn;
+	TextureUsage				usage;
+	TextureEncoding				encoding;	// block compressed encodings hold every mip in raw, the largest first
+	size_t						dataSize;	// bytes in raw when it holds more than the base level
+	std::string					swizzle;	// what the view's r, g, b and a read: r, g, b, a, 0 or 1
+	uint64_t					contentHash;// of the encoded file, 0 when loaded without a CTextureRegistry
+	uint32_t					sharedSlot;	// bindless slot of a registered texture with the content, raw is then not loaded
 	ImageRaw()
 		: name("")
 		, raw_hdr(nullptr)
@@ -33,7 +73,13 @@ struct ImageRaw
 		, height(-1)
 		, channels(-1)
 		, mipLevels(1)
-		, depthOrArraySize(-1){}
+		, depthOrArraySize(-1)
+		, usage(tu_unknown)
+		, encoding(te_rgba8)
+		, dataSize(0)
+		, swizzle("rgba")
+		, contentHash(0)
+		, sharedSlot(MAX_SUPPORTED_TEXTURES){}
 };
 
 struct Material
@@ -263,8 +309,12 @@ struct BFrustum : BVolume
 
 	nm::float4x4 GetViewProjection() { return viewProjection; }
 
+	// Conservative, a box outside of the frustum but crossing two of its planes' extensions passes
+	bool isVisiable(const BBox& p_b) const;
+
 private:
 	nm::float4x4 viewProjection;
+	nm::float4 planes[6];			// left, right, bottom, top, near, far; pointing inwards
 };
 
 struct BBox : BVolume
@@ -346,6 +396,28 @@ struct SubMesh
 	uint32_t					firstIndex;
 	uint32_t					indexCount;
 	uint32_t					materialId;
+	float						uvDensity;			// mesh space length a UV unit spans, 0 without UVs; see CTextureStreamer
+};
+
+// A unique mesh of an asset (a glTF mesh). Its sub-meshes are stored once in the
+// vertex and index list of MeshRaw and are referenced by one or more MeshInstance
+struct SharedMesh
+{
+	std::string					name;
+	uint32_t					firstSubmesh;
+	uint32_t					submeshCount;
+	uint32_t					firstIndex;
+	uint32_t					indexCount;
+	uint32_t					firstInstance;		// instances are sorted by shared mesh, so they are contiguous
+	uint32_t					instanceCount;
+	std::vector<BBox>			submeshesBbox;		// in mesh space
+};
+
+// A node of the asset referencing a shared mesh
+struct MeshInstance
+{
+	uint32_t					sharedMeshId;
+	nm::float4x4				transform;			// node's transform relative to the asset
 };
 
 struct MeshRaw
@@ -355,7 +427,9 @@ struct MeshRaw
 	VertexList					vertexList;
 	std::vector<uint32_t>		indicesList;
 	std::vector<SubMesh>		submeshes;
-	std::vector<BBox>			submeshesBbox;
+	std::vector<SharedMesh>		sharedMeshes;
+	std::vector<MeshInstance>	instances;
+	std::vector<BBox>			submeshesBbox;		// one per instance per sub-mesh, relative to the asset
 	BBox						bbox;
 
 	MeshRaw(): 
@@ -374,15 +448,28 @@ struct SceneRaw
 	uint32_t					textureOffset;
 };
 
+class CTextureRegistry;
+class CMeshDecoder;
+
 struct ObjLoadData
 {
 	bool						flipUV;
 	bool						loadMeshOnly;
+	CTextureRegistry*			textureRegistry;	// textures it holds are not loaded again, may be null
+	bool						deferDecode;		// images stb_image reads are kept as te_file, only their size is read
+	CMeshDecoder*				meshDecoder;		// decodes compressed glTF meshes on its workers, null decodes them on the calling thread
 };
 
 nm::float4 ComputeTangent(Vertex p_a, Vertex p_b, Vertex p_c);
+
+// Adds the vertex to the list unless a bit identical one was added before, returns the index of the vertex
+uint32_t WeldVertex(const Vertex& p_vertex, VertexList& p_vertexList, std::unordered_map<Vertex, uint32_t>& p_uniqueVertices);
 void ComputeBBox(BBox& p_bbox);
 
+// Wraps all the sub-meshes of a mesh raw in a single shared mesh with one identity instance.
+// Used by loaders that have no notion of instancing
+void CreateSingleInstance(MeshRaw& p_mesh);
+
 struct RawSphere
 {
 	VertexList vertices;
@@ -394,7 +481,11 @@ struct RawSphere
 void GenerateSphere(int p_stackCount, int p_sectorCount, RawSphere& p_sphere, float p_radius = 1.0f);
 
 bool LoadDDS(const char* p_path, ImageRaw& p_data);
+// The mips stored in the file are kept, in the layout of the block compressed encodings; see TextureEncoding
+bool LoadKTX2(const char* p_path, ImageRaw& p_data);
+bool LoadKTX2(const unsigned char* p_fileData, size_t p_fileSize, ImageRaw& p_data);
 bool LoadRawImage(const char* p_path, ImageRaw& p_data);
+bool DecodeRawImage(ImageRaw& p_data);		// decodes a te_file image to RGBA8 or HDR, any other is left as is
 void FreeRawImage(ImageRaw& p_data);
 
 bool LoadGltf(const char* p_path, SceneRaw& p_objScene, const ObjLoadData& p_loadData);
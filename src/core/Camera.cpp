@@ -90,6 +90,13 @@ void CPerspectiveCamera::Move(nm::float3 p_lookFrom)
     m_viewProj = m_projection * m_view;
 }
 
+void CPerspectiveCamera::SetPose(nm::float3 p_lookFrom, float p_yaw, float p_pitch)
+{
+    m_lookFrom = nm::float4(p_lookFrom, 1.0f);
+    m_yaw = p_yaw;
+    m_pitch = p_pitch;
+}
+
 bool CPerspectiveCamera::Init(InitData* p_initData)
 {
     PerpspectiveInitdData* persInitData = dynamic_cast<PerpspectiveInitdData*>(p_initData);
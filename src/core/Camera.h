@@ -126,6 +126,8 @@ public:
     const nm::float3& GetVetical() const { return m_vertical; }
 
     void Move(nm::float3 p_lookFrom);
+    // Places the camera without input, the view is rebuilt by the next Update
+    void SetPose(nm::float3 p_lookFrom, float p_yaw, float p_pitch);
     virtual bool Init(InitData* p_initData) override;
     virtual void Update(UpdateData data) override;
 
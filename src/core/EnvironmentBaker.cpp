@@ -0,0 +1,1059 @@
+#include "EnvironmentBaker.h"
+#include "TextureRegistry.h"
+#include "Global.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+// Prefilter samples and irradiance texels are taken four at a time with SSE2, part of every x64 target
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENVIRONMENT_BAKER_SSE2				1
+#include <emmintrin.h>
+#else
+#define ENVIRONMENT_BAKER_SSE2				0
+#endif
+
+// Bumped whenever the baked output changes, which orphans the cache entries of older versions
+#define ENVIRONMENT_BAKER_VERSION			2
+#define ENVIRONMENT_BAKER_ROWS_PER_JOB		8
+#define ENVIRONMENT_BAKER_BRDF_SAMPLES		512
+
+struct EnvironmentCacheHeader
+{
+	uint32_t								magic;
+	uint32_t								version;
+	uint32_t								specularSize;
+	uint32_t								specularMips;
+	uint32_t								diffuseSize;
+	uint32_t								padding;
+	uint64_t								specularBytes;
+	uint64_t								diffuseBytes;
+};
+static const uint32_t c_environmentCacheMagic = 0x4C424956;	// "VIBL"
+
+static const float c_pi = 3.14159265358979f;
+
+// Direction through a point of a cube map face, p_u and p_v in [-1, 1], in the face order and orientation Vulkan samples
+static void GetCubeDirection(uint32_t p_face, float p_u, float p_v, float p_dir[3])
+{
+	switch (p_face)
+	{
+	case 0:  p_dir[0] = 1.0f;	p_dir[1] = -p_v;	p_dir[2] = -p_u;	break;
+	case 1:  p_dir[0] = -1.0f;	p_dir[1] = -p_v;	p_dir[2] = p_u;		break;
+	case 2:  p_dir[0] = p_u;	p_dir[1] = 1.0f;	p_dir[2] = p_v;		break;
+	case 3:  p_dir[0] = p_u;	p_dir[1] = -1.0f;	p_dir[2] = -p_v;	break;
+	case 4:  p_dir[0] = p_u;	p_dir[1] = -p_v;	p_dir[2] = 1.0f;	break;
+	default: p_dir[0] = -p_u;	p_dir[1] = -p_v;	p_dir[2] = -1.0f;	break;
+	}
+
+	float invLength = 1.0f / std::sqrt(p_dir[0] * p_dir[0] + p_dir[1] * p_dir[1] + p_dir[2] * p_dir[2]);
+	p_dir[0] *= invLength;
+	p_dir[1] *= invLength;
+	p_dir[2] *= invLength;
+}
+
+// Inverse of GetCubeDirection, p_u and p_v in [0, 1]
+static uint32_t GetCubeFace(const float p_dir[3], float& p_u, float& p_v)
+{
+	float absX = std::fabs(p_dir[0]);
+	float absY = std::fabs(p_dir[1]);
+	float absZ = std::fabs(p_dir[2]);
+
+	uint32_t face;
+	float major, sc, tc;
+	if (absX >= absY && absX >= absZ)
+	{
+		face = (p_dir[0] > 0.0f) ? 0 : 1;
+		major = absX;
+		sc = (p_dir[0] > 0.0f) ? -p_dir[2] : p_dir[2];
+		tc = -p_dir[1];
+	}
+	else if (absY >= absZ)
+	{
+		face = (p_dir[1] > 0.0f) ? 2 : 3;
+		major = absY;
+		sc = p_dir[0];
+		tc = (p_dir[1] > 0.0f) ? p_dir[2] : -p_dir[2];
+	}
+	else
+	{
+		face = (p_dir[2] > 0.0f) ? 4 : 5;
+		major = absZ;
+		sc = (p_dir[2] > 0.0f) ? p_dir[0] : -p_dir[0];
+		tc = -p_dir[1];
+	}
+
+	p_u = 0.5f * (sc / major + 1.0f);
+	p_v = 0.5f * (tc / major + 1.0f);
+	return face;
+}
+
+// Bilinear within the face, clamped at its edges
+static void SampleFace(const float* p_face, uint32_t p_size, float p_u, float p_v, float p_rgb[3])
+{
+	float x = p_u * (float)p_size - 0.5f;
+	float y = p_v * (float)p_size - 0.5f;
+	float floorX = std::floor(x);
+	float floorY = std::floor(y);
+	float fx = x - floorX;
+	float fy = y - floorY;
+
+	int maxCoord = (int)p_size - 1;
+	int x0 = (std::min)((std::max)((int)floorX, 0), maxCoord);
+	int y0 = (std::min)((std::max)((int)floorY, 0), maxCoord);
+	int x1 = (std::min)((std::max)((int)floorX + 1, 0), maxCoord);
+	int y1 = (std::min)((std::max)((int)floorY + 1, 0), maxCoord);
+
+	const float* t00 = &p_face[((size_t)y0 * p_size + x0) * 3];
+	const float* t10 = &p_face[((size_t)y0 * p_size + x1) * 3];
+	const float* t01 = &p_face[((size_t)y1 * p_size + x0) * 3];
+	const float* t11 = &p_face[((size_t)y1 * p_size + x1) * 3];
+	for (int c = 0; c < 3; c++)
+	{
+		float top = t00[c] + (t10[c] - t00[c]) * fx;
+		float bottom = t01[c] + (t11[c] - t01[c]) * fx;
+		p_rgb[c] = top + (bottom - top) * fy;
+	}
+}
+
+#if ENVIRONMENT_BAKER_SSE2
+static inline __m128 Select4(__m128 p_mask, __m128 p_a, __m128 p_b)
+{
+	return _mm_or_ps(_mm_and_ps(p_mask, p_a), _mm_andnot_ps(p_mask, p_b));
+}
+
+static inline float HorizontalSum4(__m128 p_value)
+{
+	__m128 shuffled = _mm_shuffle_ps(p_value, p_value, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(p_value, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+
+// GetCubeDirection of four points of a face
+static void GetCubeDirection4(uint32_t p_face, __m128 p_u, __m128 p_v, __m128 p_dir[3])
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 negU = _mm_xor_ps(p_u, signMask);
+	__m128 negV = _mm_xor_ps(p_v, signMask);
+	__m128 negOne = _mm_xor_ps(one, signMask);
+
+	switch (p_face)
+	{
+	case 0:  p_dir[0] = one;	p_dir[1] = negV;	p_dir[2] = negU;	break;
+	case 1:  p_dir[0] = negOne;	p_dir[1] = negV;	p_dir[2] = p_u;		break;
+	case 2:  p_dir[0] = p_u;	p_dir[1] = one;		p_dir[2] = p_v;		break;
+	case 3:  p_dir[0] = p_u;	p_dir[1] = negOne;	p_dir[2] = negV;	break;
+	case 4:  p_dir[0] = p_u;	p_dir[1] = negV;	p_dir[2] = one;		break;
+	default: p_dir[0] = negU;	p_dir[1] = negV;	p_dir[2] = negOne;	break;
+	}
+
+	__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p_dir[0], p_dir[0]), _mm_mul_ps(p_dir[1], p_dir[1])), _mm_mul_ps(p_dir[2], p_dir[2]));
+	__m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(length2));
+	for (int c = 0; c < 3; c++)
+		p_dir[c] = _mm_mul_ps(p_dir[c], invLength);
+}
+
+// GetCubeFace of four directions, the faces are picked with the same ties
+static void GetCubeFace4(const __m128 p_dir[3], __m128& p_u, __m128& p_v, uint32_t p_face[4])
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128 absX = _mm_andnot_ps(signMask, p_dir[0]);
+	__m128 absY = _mm_andnot_ps(signMask, p_dir[1]);
+	__m128 absZ = _mm_andnot_ps(signMask, p_dir[2]);
+	__m128 negX = _mm_xor_ps(p_dir[0], signMask);
+	__m128 negY = _mm_xor_ps(p_dir[1], signMask);
+	__m128 negZ = _mm_xor_ps(p_dir[2], signMask);
+
+	__m128 isX = _mm_and_ps(_mm_cmpge_ps(absX, absY), _mm_cmpge_ps(absX, absZ));
+	__m128 isY = _mm_andnot_ps(isX, _mm_cmpge_ps(absY, absZ));
+	__m128 positiveX = _mm_cmpgt_ps(p_dir[0], zero);
+	__m128 positiveY = _mm_cmpgt_ps(p_dir[1], zero);
+	__m128 positiveZ = _mm_cmpgt_ps(p_dir[2], zero);
+
+	__m128 major = Select4(isX, absX, Select4(isY, absY, absZ));
+	__m128 sc = Select4(isX, Select4(positiveX, negZ, p_dir[2]), Select4(isY, p_dir[0], Select4(positiveZ, p_dir[0], negX)));
+	__m128 tc = Select4(isY, Select4(positiveY, p_dir[2], negZ), negY);
+
+	p_u = _mm_mul_ps(half, _mm_add_ps(_mm_div_ps(sc, major), _mm_set1_ps(1.0f)));
+	p_v = _mm_mul_ps(half, _mm_add_ps(_mm_div_ps(tc, major), _mm_set1_ps(1.0f)));
+
+	int maskX = _mm_movemask_ps(isX);
+	int maskY = _mm_movemask_ps(isY);
+	int maskPositive[3] = { _mm_movemask_ps(positiveX), _mm_movemask_ps(positiveY), _mm_movemask_ps(positiveZ) };
+	for (int i = 0; i < 4; i++)
+	{
+		uint32_t axis = ((maskX >> i) & 1) ? 0 : (((maskY >> i) & 1) ? 1 : 2);
+		p_face[i] = axis * 2 + (((maskPositive[axis] >> i) & 1) ? 0 : 1);
+	}
+}
+
+// SampleFace of four samples, every one from its own face of p_sizes texels; the texels are gathered one by one
+// and filtered together, a channel per vector
+static void SampleFace4(const float* const p_faces[4], const uint32_t p_sizes[4], __m128 p_u, __m128 p_v, __m128 p_rgb[3])
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128 size = _mm_setr_ps((float)p_sizes[0], (float)p_sizes[1], (float)p_sizes[2], (float)p_sizes[3]);
+	__m128 maxCoord = _mm_sub_ps(size, one);
+
+	__m128 x = _mm_sub_ps(_mm_mul_ps(p_u, size), half);
+	__m128 y = _mm_sub_ps(_mm_mul_ps(p_v, size), half);
+
+	// truncation rounds the coordinates in [-0.5, 0) up, they are taken back down
+	__m128 truncX = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	__m128 truncY = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+	__m128 floorX = _mm_sub_ps(truncX, _mm_and_ps(_mm_cmpgt_ps(truncX, x), one));
+	__m128 floorY = _mm_sub_ps(truncY, _mm_and_ps(_mm_cmpgt_ps(truncY, y), one));
+	__m128 fx = _mm_sub_ps(x, floorX);
+	__m128 fy = _mm_sub_ps(y, floorY);
+
+	alignas(16) int32_t x0[4], y0[4], x1[4], y1[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(x0), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(floorX, zero), maxCoord)));
+	_mm_store_si128(reinterpret_cast<__m128i*>(y0), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(floorY, zero), maxCoord)));
+	_mm_store_si128(reinterpret_cast<__m128i*>(x1), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(floorX, one), zero), maxCoord)));
+	_mm_store_si128(reinterpret_cast<__m128i*>(y1), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(floorY, one), zero), maxCoord)));
+
+	alignas(16) float t00[3][4], t10[3][4], t01[3][4], t11[3][4];
+	for (int i = 0; i < 4; i++)
+	{
+		size_t stride = p_sizes[i];
+		const float* texel00 = &p_faces[i][((size_t)y0[i] * stride + x0[i]) * 3];
+		const float* texel10 = &p_faces[i][((size_t)y0[i] * stride + x1[i]) * 3];
+		const float* texel01 = &p_faces[i][((size_t)y1[i] * stride + x0[i]) * 3];
+		const float* texel11 = &p_faces[i][((size_t)y1[i] * stride + x1[i]) * 3];
+		for (int c = 0; c < 3; c++)
+		{
+			t00[c][i] = texel00[c];
+			t10[c][i] = texel10[c];
+			t01[c][i] = texel01[c];
+			t11[c][i] = texel11[c];
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+	{
+		__m128 top00 = _mm_load_ps(t00[c]);
+		__m128 bottom01 = _mm_load_ps(t01[c]);
+		__m128 top = _mm_add_ps(top00, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(t10[c]), top00), fx));
+		__m128 bottom = _mm_add_ps(bottom01, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(t11[c]), bottom01), fx));
+		p_rgb[c] = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+	}
+}
+#endif
+
+// 2^(-16) to 65408 in 9 bit mantissas sharing a 5 bit exponent, as VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 reads them
+static uint32_t PackRGB9E5(const float p_rgb[3])
+{
+	const float maxValue = 65408.0f;
+	float r = (std::min)((std::max)(p_rgb[0], 0.0f), maxValue);
+	float g = (std::min)((std::max)(p_rgb[1], 0.0f), maxValue);
+	float b = (std::min)((std::max)(p_rgb[2], 0.0f), maxValue);
+	float maxChannel = (std::max)(r, (std::max)(g, b));
+	if (maxChannel < 1.0e-9f)
+		return 0;
+
+	int exponent = (std::max)(-16, (int)std::floor(std::log2(maxChannel))) + 16;
+	float scale = std::exp2((float)(9 - (exponent - 15)));
+	if ((int)std::floor(maxChannel * scale + 0.5f) == 512)
+	{
+		exponent++;
+		scale *= 0.5f;
+	}
+
+	uint32_t mantissaR = (uint32_t)std::floor(r * scale + 0.5f);
+	uint32_t mantissaG = (uint32_t)std::floor(g * scale + 0.5f);
+	uint32_t mantissaB = (uint32_t)std::floor(b * scale + 0.5f);
+	return mantissaR | (mantissaG << 9) | (mantissaB << 18) | ((uint32_t)exponent << 27);
+}
+
+static float RadicalInverse(uint32_t p_bits)
+{
+	p_bits = (p_bits << 16u) | (p_bits >> 16u);
+	p_bits = ((p_bits & 0x55555555u) << 1u) | ((p_bits & 0xAAAAAAAAu) >> 1u);
+	p_bits = ((p_bits & 0x33333333u) << 2u) | ((p_bits & 0xCCCCCCCCu) >> 2u);
+	p_bits = ((p_bits & 0x0F0F0F0Fu) << 4u) | ((p_bits & 0xF0F0F0F0u) >> 4u);
+	p_bits = ((p_bits & 0x00FF00FFu) << 8u) | ((p_bits & 0xFF00FF00u) >> 8u);
+	return (float)p_bits * 2.3283064365386963e-10f;
+}
+
+// Half vector of the i-th Hammersley point around +z, GGX distributed for p_alpha
+static void ImportanceSampleGGX(uint32_t p_index, uint32_t p_count, float p_alpha, float p_halfVector[3])
+{
+	float phi = 2.0f * c_pi * ((float)p_index / (float)p_count);
+	float xi = RadicalInverse(p_index);
+	float cosTheta = std::sqrt((1.0f - xi) / (1.0f + (p_alpha * p_alpha - 1.0f) * xi));
+	float sinTheta = std::sqrt((std::max)(1.0f - cosTheta * cosTheta, 0.0f));
+	p_halfVector[0] = sinTheta * std::cos(phi);
+	p_halfVector[1] = sinTheta * std::sin(phi);
+	p_halfVector[2] = cosTheta;
+}
+
+CEnvironmentBaker::CEnvironmentBaker()
+	: m_settings{}
+	, m_threadPool(nullptr)
+{
+}
+
+CEnvironmentBaker::~CEnvironmentBaker()
+{
+	Destroy();
+}
+
+bool CEnvironmentBaker::Create(const Settings& p_settings)
+{
+	m_settings = p_settings;
+
+	if ((m_settings.specularSize & (m_settings.specularSize - 1)) != 0 || m_settings.specularSize == 0)
+	{
+		std::cerr << "CEnvironmentBaker::Create Error: Specular size " << m_settings.specularSize << " is not a power of two" << std::endl;
+		return false;
+	}
+
+	if (!m_settings.cacheDir.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_settings.cacheDir, error);
+		if (error)
+		{
+			std::cerr << "CEnvironmentBaker::Create Error: Failed to create " << m_settings.cacheDir.generic_string() << " - " << error.message() << std::endl;
+			return false;
+		}
+	}
+
+	m_threadPool = new CThreadPool();
+	RETURN_FALSE_IF_FALSE(m_threadPool->Create(m_settings.workerCount));
+
+	return true;
+}
+
+void CEnvironmentBaker::Destroy()
+{
+	if (m_threadPool)
+	{
+		m_threadPool->Destroy();
+		delete m_threadPool;
+		m_threadPool = nullptr;
+	}
+}
+
+bool CEnvironmentBaker::ForEachRow(uint32_t p_rowCount, const std::function<void(uint32_t p_row)>& p_func)
+{
+	CThreadPool::JobGroup rowJobs;
+	for (uint32_t firstRow = 0; firstRow < p_rowCount; firstRow += ENVIRONMENT_BAKER_ROWS_PER_JOB)
+	{
+		uint32_t lastRow = (std::min)(firstRow + ENVIRONMENT_BAKER_ROWS_PER_JOB, p_rowCount);
+		m_threadPool->Submit(rowJobs, [&p_func, firstRow, lastRow](uint32_t)
+			{
+				for (uint32_t row = firstRow; row < lastRow; row++)
+					p_func(row);
+				return true;
+			});
+	}
+	return m_threadPool->Wait(rowJobs);
+}
+
+bool CEnvironmentBaker::ResampleEquirect(const ImageRaw& p_equirect, CubeLevel& p_cube)
+{
+	PROFILE_FUNCTION();
+
+	uint32_t size = p_cube.size;
+	int width = p_equirect.width;
+	int height = p_equirect.height;
+	const float* source = p_equirect.raw_hdr;
+	p_cube.texels.resize((size_t)6 * size * size * 3);
+
+	// rows of every face one after the other
+	return ForEachRow(6 * size, [&](uint32_t p_row)
+		{
+			uint32_t face = p_row / size;
+			uint32_t y = p_row % size;
+			float* out = &p_cube.texels[(((size_t)face * size + y) * size) * 3];
+			for (uint32_t x = 0; x < size; x++)
+			{
+				float dir[3];
+				GetCubeDirection(face, 2.0f * ((float)x + 0.5f) / (float)size - 1.0f, 2.0f * ((float)y + 0.5f) / (float)size - 1.0f, dir);
+
+				// longitude from +x towards +z, latitude from +y down
+				float u = std::atan2(dir[2], dir[0]) / (2.0f * c_pi) + 0.5f;
+				float v = std::acos((std::min)((std::max)(dir[1], -1.0f), 1.0f)) / c_pi;
+
+				float sx = u * (float)width - 0.5f;
+				float sy = (std::min)((std::max)(v * (float)height - 0.5f, 0.0f), (float)(height - 1));
+				float floorX = std::floor(sx);
+				float fx = sx - floorX;
+				float fy = sy - std::floor(sy);
+				int x0 = (((int)floorX % width) + width) % width;
+				int x1 = (x0 + 1) % width;
+				int y0 = (int)sy;
+				int y1 = (std::min)(y0 + 1, height - 1);
+
+				const float* t00 = &source[((size_t)y0 * width + x0) * 4];
+				const float* t10 = &source[((size_t)y0 * width + x1) * 4];
+				const float* t01 = &source[((size_t)y1 * width + x0) * 4];
+				const float* t11 = &source[((size_t)y1 * width + x1) * 4];
+				for (int c = 0; c < 3; c++)
+				{
+					float top = t00[c] + (t10[c] - t00[c]) * fx;
+					float bottom = t01[c] + (t11[c] - t01[c]) * fx;
+					out[x * 3 + c] = top + (bottom - top) * fy;
+				}
+			}
+		});
+}
+
+// Filtered importance sampling, every sample reads the mip of the source whose texels cover about the solid angle
+// the sample stands for, which keeps a few dozen samples free of the aliasing of bright spots
+bool CEnvironmentBaker::PrefilterSpecular(const std::vector<CubeLevel>& p_source, uint32_t p_mip, CubeLevel& p_prefiltered)
+{
+	PROFILE_FUNCTION();
+
+	float roughness = (std::min)((float)p_mip / (float)IBL_MAX_REFLECTION_LOD, 1.0f);
+	float alpha = roughness * roughness;
+	uint32_t sampleCount = m_settings.specularSamples;
+	float sourceSize = (float)p_source[0].size;
+	float texelSolidAngle = 4.0f * c_pi / (6.0f * sourceSize * sourceSize);
+	float maxLod = (float)(p_source.size() - 1);
+
+	// The samples only depend on the roughness, they are laid out around +z once and turned to every texel's normal
+	std::vector<float> sampleX;
+	std::vector<float> sampleY;
+	std::vector<float> sampleZ;
+	std::vector<float> sampleWeights;
+	std::vector<float> sampleLods;
+	for (uint32_t i = 0; i < sampleCount; i++)
+	{
+		float halfVector[3];
+		ImportanceSampleGGX(i, sampleCount, alpha, halfVector);
+
+		// reflected around the half vector with the view along the normal
+		float cosTheta = halfVector[2];
+		float light[3] = { 2.0f * cosTheta * halfVector[0], 2.0f * cosTheta * halfVector[1], 2.0f * cosTheta * cosTheta - 1.0f };
+		if (light[2] <= 0.0f)
+			continue;
+
+		float alpha2 = alpha * alpha;
+		float denom = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+		float distribution = alpha2 / (c_pi * denom * denom);
+		float pdf = distribution * 0.25f;
+		float sampleSolidAngle = 1.0f / ((float)sampleCount * pdf + 1.0e-6f);
+		float lod = (std::min)((std::max)(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f, 0.0f), maxLod);
+
+		sampleX.push_back(light[0]);
+		sampleY.push_back(light[1]);
+		sampleZ.push_back(light[2]);
+		sampleWeights.push_back(light[2]);
+		sampleLods.push_back(lod);
+	}
+
+	uint32_t size = p_prefiltered.size;
+	p_prefiltered.texels.resize((size_t)6 * size * size * 3);
+	return ForEachRow(6 * size, [&](uint32_t p_row)
+		{
+			uint32_t face = p_row / size;
+			uint32_t y = p_row % size;
+			float* out = &p_prefiltered.texels[(((size_t)face * size + y) * size) * 3];
+			for (uint32_t x = 0; x < size; x++)
+			{
+				float normal[3];
+				GetCubeDirection(face, 2.0f * ((float)x + 0.5f) / (float)size - 1.0f, 2.0f * ((float)y + 0.5f) / (float)size - 1.0f, normal);
+
+				float up[3] = { 0.0f, 0.0f, 1.0f };
+				if (std::fabs(normal[2]) > 0.999f)
+				{
+					up[0] = 1.0f;
+					up[2] = 0.0f;
+				}
+				float tangent[3] = { up[1] * normal[2] - up[2] * normal[1], up[2] * normal[0] - up[0] * normal[2], up[0] * normal[1] - up[1] * normal[0] };
+				float invLength = 1.0f / std::sqrt(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+				tangent[0] *= invLength;
+				tangent[1] *= invLength;
+				tangent[2] *= invLength;
+				float bitangent[3] = { normal[1] * tangent[2] - normal[2] * tangent[1], normal[2] * tangent[0] - normal[0] * tangent[2], normal[0] * tangent[1] - normal[1] * tangent[0] };
+
+				float sum[3] = { 0.0f, 0.0f, 0.0f };
+				float weightSum = 0.0f;
+				size_t s = 0;
+#if ENVIRONMENT_BAKER_SSE2
+				__m128 sum4[3] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+				__m128 weightSum4 = _mm_setzero_ps();
+				for (; s + 4 <= sampleWeights.size(); s += 4)
+				{
+					__m128 localX = _mm_loadu_ps(&sampleX[s]);
+					__m128 localY = _mm_loadu_ps(&sampleY[s]);
+					__m128 localZ = _mm_loadu_ps(&sampleZ[s]);
+					__m128 dir[3];
+					for (int c = 0; c < 3; c++)
+					{
+						dir[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tangent[c]), localX), _mm_mul_ps(_mm_set1_ps(bitangent[c]), localY)),
+							_mm_mul_ps(_mm_set1_ps(normal[c]), localZ));
+					}
+
+					__m128 u, v;
+					uint32_t sampleFaces[4];
+					GetCubeFace4(dir, u, v, sampleFaces);
+
+					const float* faces0[4];
+					const float* faces1[4];
+					uint32_t sizes0[4], sizes1[4];
+					for (int i = 0; i < 4; i++)
+					{
+						uint32_t lod0 = (uint32_t)sampleLods[s + i];
+						uint32_t lod1 = (std::min)(lod0 + 1, (uint32_t)p_source.size() - 1);
+						const CubeLevel& level0 = p_source[lod0];
+						const CubeLevel& level1 = p_source[lod1];
+						faces0[i] = &level0.texels[(size_t)sampleFaces[i] * level0.size * level0.size * 3];
+						faces1[i] = &level1.texels[(size_t)sampleFaces[i] * level1.size * level1.size * 3];
+						sizes0[i] = level0.size;
+						sizes1[i] = level1.size;
+					}
+
+					__m128 rgb0[3], rgb1[3];
+					SampleFace4(faces0, sizes0, u, v, rgb0);
+					SampleFace4(faces1, sizes1, u, v, rgb1);
+
+					// the lods are never negative, truncation floors them
+					__m128 lod = _mm_loadu_ps(&sampleLods[s]);
+					__m128 lodBlend = _mm_sub_ps(lod, _mm_cvtepi32_ps(_mm_cvttps_epi32(lod)));
+					__m128 weight = _mm_loadu_ps(&sampleWeights[s]);
+					for (int c = 0; c < 3; c++)
+						sum4[c] = _mm_add_ps(sum4[c], _mm_mul_ps(_mm_add_ps(rgb0[c], _mm_mul_ps(_mm_sub_ps(rgb1[c], rgb0[c]), lodBlend)), weight));
+					weightSum4 = _mm_add_ps(weightSum4, weight);
+				}
+
+				for (int c = 0; c < 3; c++)
+					sum[c] = HorizontalSum4(sum4[c]);
+				weightSum = HorizontalSum4(weightSum4);
+#endif
+				for (; s < sampleWeights.size(); s++)
+				{
+					const float local[3] = { sampleX[s], sampleY[s], sampleZ[s] };
+					float dir[3];
+					for (int c = 0; c < 3; c++)
+						dir[c] = tangent[c] * local[0] + bitangent[c] * local[1] + normal[c] * local[2];
+
+					float u, v;
+					uint32_t sampleFace = GetCubeFace(dir, u, v);
+
+					// trilinear between the two source mips around the sample's
+					uint32_t lod0 = (uint32_t)sampleLods[s];
+					uint32_t lod1 = (std::min)(lod0 + 1, (uint32_t)p_source.size() - 1);
+					float lodBlend = sampleLods[s] - (float)lod0;
+
+					float rgb0[3], rgb1[3];
+					const CubeLevel& level0 = p_source[lod0];
+					const CubeLevel& level1 = p_source[lod1];
+					SampleFace(&level0.texels[(size_t)sampleFace * level0.size * level0.size * 3], level0.size, u, v, rgb0);
+					SampleFace(&level1.texels[(size_t)sampleFace * level1.size * level1.size * 3], level1.size, u, v, rgb1);
+
+					float weight = sampleWeights[s];
+					for (int c = 0; c < 3; c++)
+						sum[c] += (rgb0[c] + (rgb1[c] - rgb0[c]) * lodBlend) * weight;
+					weightSum += weight;
+				}
+
+				for (int c = 0; c < 3; c++)
+					out[x * 3 + c] = (weightSum > 0.0f) ? sum[c] / weightSum : 0.0f;
+			}
+		});
+}
+
+// Projects the radiance on the first 9 real spherical harmonics, every texel weighted by the solid angle it covers
+void CEnvironmentBaker::ProjectIrradiance(const CubeLevel& p_source, float p_sh[9][3]) const
+{
+	PROFILE_FUNCTION();
+
+	memset(p_sh, 0, sizeof(float) * 9 * 3);
+
+	uint32_t size = p_source.size;
+	for (uint32_t face = 0; face < 6; face++)
+	{
+		for (uint32_t y = 0; y < size; y++)
+		{
+			uint32_t x = 0;
+#if ENVIRONMENT_BAKER_SSE2
+			{
+				const float invSize = 1.0f / (float)size;
+				const __m128 one = _mm_set1_ps(1.0f);
+				const __m128 two = _mm_set1_ps(2.0f);
+				const __m128 half = _mm_set1_ps(0.5f);
+				float v = 2.0f * ((float)y + 0.5f) / (float)size - 1.0f;
+				__m128 v4 = _mm_set1_ps(v);
+
+				__m128 sh4[9][3];
+				for (int i = 0; i < 9; i++)
+					for (int c = 0; c < 3; c++)
+						sh4[i][c] = _mm_setzero_ps();
+
+				for (; x + 4 <= size; x += 4)
+				{
+					__m128 column = _mm_setr_ps((float)x, (float)(x + 1), (float)(x + 2), (float)(x + 3));
+					__m128 u4 = _mm_sub_ps(_mm_div_ps(_mm_mul_ps(two, _mm_add_ps(column, half)), _mm_set1_ps((float)size)), one);
+					__m128 dir[3];
+					GetCubeDirection4(face, u4, v4, dir);
+
+					__m128 distance2 = _mm_add_ps(_mm_add_ps(one, _mm_mul_ps(u4, u4)), _mm_mul_ps(v4, v4));
+					__m128 solidAngle = _mm_div_ps(_mm_set1_ps(4.0f * invSize * invSize), _mm_mul_ps(distance2, _mm_sqrt_ps(distance2)));
+
+					__m128 basis[9] =
+					{
+						_mm_set1_ps(0.282095f),
+						_mm_mul_ps(_mm_set1_ps(0.488603f), dir[1]),
+						_mm_mul_ps(_mm_set1_ps(0.488603f), dir[2]),
+						_mm_mul_ps(_mm_set1_ps(0.488603f), dir[0]),
+						_mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(dir[0], dir[1])),
+						_mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(dir[1], dir[2])),
+						_mm_mul_ps(_mm_set1_ps(0.315392f), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(dir[2], dir[2])), one)),
+						_mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(dir[0], dir[2])),
+						_mm_mul_ps(_mm_set1_ps(0.546274f), _mm_sub_ps(_mm_mul_ps(dir[0], dir[0]), _mm_mul_ps(dir[1], dir[1])))
+					};
+
+					const float* radiance = &p_source.texels[(((size_t)face * size + y) * size + x) * 3];
+					__m128 weighted[3];
+					for (int c = 0; c < 3; c++)
+						weighted[c] = _mm_mul_ps(_mm_setr_ps(radiance[c], radiance[3 + c], radiance[6 + c], radiance[9 + c]), solidAngle);
+
+					for (int i = 0; i < 9; i++)
+						for (int c = 0; c < 3; c++)
+							sh4[i][c] = _mm_add_ps(sh4[i][c], _mm_mul_ps(weighted[c], basis[i]));
+				}
+
+				for (int i = 0; i < 9; i++)
+					for (int c = 0; c < 3; c++)
+						p_sh[i][c] += HorizontalSum4(sh4[i][c]);
+			}
+#endif
+			for (; x < size; x++)
+			{
+				float u = 2.0f * ((float)x + 0.5f) / (float)size - 1.0f;
+				float v = 2.0f * ((float)y + 0.5f) / (float)size - 1.0f;
+				float dir[3];
+				GetCubeDirection(face, u, v, dir);
+
+				float distance2 = 1.0f + u * u + v * v;
+				float solidAngle = 4.0f / ((float)size * (float)size * distance2 * std::sqrt(distance2));
+
+				float basis[9] =
+				{
+					0.282095f,
+					0.488603f * dir[1],
+					0.488603f * dir[2],
+					0.488603f * dir[0],
+					1.092548f * dir[0] * dir[1],
+					1.092548f * dir[1] * dir[2],
+					0.315392f * (3.0f * dir[2] * dir[2] - 1.0f),
+					1.092548f * dir[0] * dir[2],
+					0.546274f * (dir[0] * dir[0] - dir[1] * dir[1])
+				};
+
+				const float* radiance = &p_source.texels[(((size_t)face * size + y) * size + x) * 3];
+				for (int i = 0; i < 9; i++)
+					for (int c = 0; c < 3; c++)
+						p_sh[i][c] += radiance[c] * basis[i] * solidAngle;
+			}
+		}
+	}
+}
+
+bool CEnvironmentBaker::BakeEnvironment(const std::filesystem::path& p_path, ImageRaw& p_specular, ImageRaw& p_diffuse)
+{
+	PROFILE_FUNCTION();
+
+	if (!m_threadPool)
+	{
+		std::cerr << "CEnvironmentBaker::BakeEnvironment Error: Not created" << std::endl;
+		return false;
+	}
+
+	uint32_t specularMips = (uint32_t)std::floor(std::log2((float)m_settings.specularSize)) + 1;
+	uint32_t diffuseSize = m_settings.diffuseSize;
+
+	std::filesystem::path cachePath;
+	if (!m_settings.cacheDir.empty())
+	{
+		std::ifstream file(p_path, std::ios::binary | std::ios::in | std::ios::ate);
+		if (file.is_open())
+		{
+			std::vector<char> content((size_t)file.tellg());
+			file.seekg(0, std::ios::beg);
+			file.read(content.data(), (std::streamsize)content.size());
+
+			uint64_t key[] = { CTextureRegistry::HashContent(content.data(), content.size()), ENVIRONMENT_BAKER_VERSION,
+				m_settings.specularSize, m_settings.specularSamples, diffuseSize, IBL_MAX_REFLECTION_LOD };
+
+			std::ostringstream name;
+			name << std::hex << std::setw(16) << std::setfill('0') << CTextureRegistry::HashContent(key, sizeof(key)) << ".ibl";
+			cachePath = m_settings.cacheDir / name.str();
+
+			if (ReadCache(cachePath, p_specular, p_diffuse))
+			{
+				CLOG("Environment read from cache - " << p_path.filename().generic_string() << std::endl);
+				return true;
+			}
+		}
+	}
+
+	ImageRaw equirect;
+	if (!LoadRawImage(p_path.string().c_str(), equirect) || equirect.raw_hdr == nullptr)
+	{
+		std::cerr << "CEnvironmentBaker::BakeEnvironment Error: Failed to load HDR image " << p_path.generic_string() << std::endl;
+		FreeRawImage(equirect);
+		return false;
+	}
+
+	// The environment and its box filtered mips, the prefilters read them
+	std::vector<CubeLevel> levels(specularMips);
+	levels[0].size = m_settings.specularSize;
+	bool baked = ResampleEquirect(equirect, levels[0]);
+	FreeRawImage(equirect);
+	RETURN_FALSE_IF_FALSE(baked);
+
+	for (uint32_t mip = 1; mip < specularMips; mip++)
+	{
+		const CubeLevel& parent = levels[mip - 1];
+		CubeLevel& level = levels[mip];
+		level.size = parent.size / 2;
+		level.texels.resize((size_t)6 * level.size * level.size * 3);
+		for (uint32_t face = 0; face < 6; face++)
+		{
+			const float* in = &parent.texels[(size_t)face * parent.size * parent.size * 3];
+			float* out = &level.texels[(size_t)face * level.size * level.size * 3];
+			for (uint32_t y = 0; y < level.size; y++)
+			{
+				for (uint32_t x = 0; x < level.size; x++)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						out[((size_t)y * level.size + x) * 3 + c] = 0.25f * (
+							in[(((size_t)y * 2) * parent.size + x * 2) * 3 + c] + in[(((size_t)y * 2) * parent.size + x * 2 + 1) * 3 + c] +
+							in[(((size_t)y * 2 + 1) * parent.size + x * 2) * 3 + c] + in[(((size_t)y * 2 + 1) * parent.size + x * 2 + 1) * 3 + c]);
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<CubeLevel> prefiltered(specularMips);
+	for (uint32_t mip = 1; mip < specularMips; mip++)
+	{
+		prefiltered[mip].size = levels[mip].size;
+		RETURN_FALSE_IF_FALSE(PrefilterSpecular(levels, mip, prefiltered[mip]));
+	}
+
+	// Every mip of a face before the next face, as the cube map staging is laid out
+	size_t specularTexels = 0;
+	for (uint32_t mip = 0; mip < specularMips; mip++)
+		specularTexels += (size_t)levels[mip].size * levels[mip].size * 6;
+
+	p_specular = ImageRaw{};
+	p_specular.name = p_path.filename().string();
+	p_specular.width = (int)m_settings.specularSize;
+	p_specular.height = (int)m_settings.specularSize;
+	p_specular.depthOrArraySize = 6;
+	p_specular.channels = 3;
+	p_specular.mipLevels = specularMips;
+	p_specular.encoding = te_rgb9e5;
+	p_specular.dataSize = specularTexels * sizeof(uint32_t);
+	p_specular.raw = (unsigned char*)malloc(p_specular.dataSize);
+
+	uint32_t* packed = (uint32_t*)p_specular.raw;
+	for (uint32_t face = 0; face < 6; face++)
+	{
+		for (uint32_t mip = 0; mip < specularMips; mip++)
+		{
+			const CubeLevel& level = (mip == 0) ? levels[0] : prefiltered[mip];
+			size_t faceTexels = (size_t)level.size * level.size;
+			const float* texels = &level.texels[face * faceTexels * 3];
+			for (size_t i = 0; i < faceTexels; i++)
+				*packed++ = PackRGB9E5(&texels[i * 3]);
+		}
+	}
+
+	// Irradiance from the SH9 of a mip small enough to project at once, scaled by the cosine lobe and divided by pi
+	// as the shaders multiply it with the albedo alone
+	const CubeLevel& projected = levels[(std::min)((uint32_t)std::floor(std::log2((float)m_settings.specularSize / 64.0f)), specularMips - 1)];
+	float sh[9][3];
+	ProjectIrradiance(projected, sh);
+
+	const float lobe[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+	p_diffuse = ImageRaw{};
+	p_diffuse.name = p_specular.name;
+	p_diffuse.width = (int)diffuseSize;
+	p_diffuse.height = (int)diffuseSize;
+	p_diffuse.depthOrArraySize = 6;
+	p_diffuse.channels = 3;
+	p_diffuse.mipLevels = 1;
+	p_diffuse.encoding = te_rgb9e5;
+	p_diffuse.dataSize = (size_t)6 * diffuseSize * diffuseSize * sizeof(uint32_t);
+	p_diffuse.raw = (unsigned char*)malloc(p_diffuse.dataSize);
+
+	packed = (uint32_t*)p_diffuse.raw;
+	for (uint32_t face = 0; face < 6; face++)
+	{
+		for (uint32_t y = 0; y < diffuseSize; y++)
+		{
+			for (uint32_t x = 0; x < diffuseSize; x++)
+			{
+				float dir[3];
+				GetCubeDirection(face, 2.0f * ((float)x + 0.5f) / (float)diffuseSize - 1.0f, 2.0f * ((float)y + 0.5f) / (float)diffuseSize - 1.0f, dir);
+
+				float basis[9] =
+				{
+					0.282095f,
+					0.488603f * dir[1],
+					0.488603f * dir[2],
+					0.488603f * dir[0],
+					1.092548f * dir[0] * dir[1],
+					1.092548f * dir[1] * dir[2],
+					0.315392f * (3.0f * dir[2] * dir[2] - 1.0f),
+					1.092548f * dir[0] * dir[2],
+					0.546274f * (dir[0] * dir[0] - dir[1] * dir[1])
+				};
+
+				float irradiance[3] = { 0.0f, 0.0f, 0.0f };
+				for (int i = 0; i < 9; i++)
+					for (int c = 0; c < 3; c++)
+						irradiance[c] += lobe[i] * sh[i][c] * basis[i];
+
+				*packed++ = PackRGB9E5(irradiance);
+			}
+		}
+	}
+
+	if (!cachePath.empty())
+		WriteCache(cachePath, p_specular, p_diffuse);
+
+	CLOG("Environment baked - " << p_specular.name << ", " << m_settings.specularSize << " specular, " << diffuseSize << " diffuse" << std::endl);
+
+	return true;
+}
+
+bool CEnvironmentBaker::BakeBrdfLut(ImageRaw& p_brdfLut)
+{
+	PROFILE_FUNCTION();
+
+	if (!m_threadPool)
+	{
+		std::cerr << "CEnvironmentBaker::BakeBrdfLut Error: Not created" << std::endl;
+		return false;
+	}
+
+	uint32_t size = m_settings.brdfLutSize;
+	size_t dataSize = (size_t)size * size * 4;
+
+	p_brdfLut = ImageRaw{};
+	p_brdfLut.name = "brdf_lut";
+	p_brdfLut.width = (int)size;
+	p_brdfLut.height = (int)size;
+	p_brdfLut.depthOrArraySize = 1;
+	p_brdfLut.channels = 4;
+	p_brdfLut.mipLevels = 1;
+
+	std::filesystem::path cachePath;
+	if (!m_settings.cacheDir.empty())
+	{
+		std::ostringstream name;
+		name << "brdf_lut_" << size << "_v" << ENVIRONMENT_BAKER_VERSION << ".rgba8";
+		cachePath = m_settings.cacheDir / name.str();
+
+		std::ifstream file(cachePath, std::ios::binary | std::ios::in | std::ios::ate);
+		if (file.is_open() && (size_t)file.tellg() == dataSize)
+		{
+			p_brdfLut.raw = (unsigned char*)malloc(dataSize);
+			file.seekg(0, std::ios::beg);
+			file.read((char*)p_brdfLut.raw, (std::streamsize)dataSize);
+			if (file.gcount() == (std::streamsize)dataSize)
+				return true;
+
+			free(p_brdfLut.raw);
+			p_brdfLut.raw = nullptr;
+		}
+	}
+
+	p_brdfLut.raw = (unsigned char*)malloc(dataSize);
+	uint8_t* texels = p_brdfLut.raw;
+	RETURN_FALSE_IF_FALSE(ForEachRow(size, [&](uint32_t p_row)
+		{
+			float roughness = ((float)p_row + 0.5f) / (float)size;
+			float alpha = roughness * roughness;
+			float k = alpha / 2.0f;
+
+			// the half vectors of the row's roughness serve every N.V of it
+			float halfVectors[ENVIRONMENT_BAKER_BRDF_SAMPLES][3];
+			for (uint32_t s = 0; s < ENVIRONMENT_BAKER_BRDF_SAMPLES; s++)
+				ImportanceSampleGGX(s, ENVIRONMENT_BAKER_BRDF_SAMPLES, alpha, halfVectors[s]);
+
+			for (uint32_t x = 0; x < size; x++)
+			{
+				float NdotV = ((float)x + 0.5f) / (float)size;
+				float view[3] = { std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV };
+				float geometryV = NdotV / (NdotV * (1.0f - k) + k);
+
+				float scale = 0.0f;
+				float bias = 0.0f;
+				for (uint32_t s = 0; s < ENVIRONMENT_BAKER_BRDF_SAMPLES; s++)
+				{
+					const float* halfVector = halfVectors[s];
+					float VdotH = view[0] * halfVector[0] + view[2] * halfVector[2];
+					float NdotL = 2.0f * VdotH * halfVector[2] - view[2];
+					if (NdotL <= 0.0f)
+						continue;
+
+					float NdotH = halfVector[2];
+					float geometry = geometryV * NdotL / (NdotL * (1.0f - k) + k);
+					float visibility = geometry * (std::max)(VdotH, 0.0f) / (NdotH * NdotV);
+					float fresnel = std::pow(1.0f - (std::max)(VdotH, 0.0f), 5.0f);
+					scale += (1.0f - fresnel) * visibility;
+					bias += fresnel * visibility;
+				}
+
+				uint8_t* texel = &texels[((size_t)p_row * size + x) * 4];
+				texel[0] = 0;
+				texel[1] = (uint8_t)std::lround((std::min)(bias / ENVIRONMENT_BAKER_BRDF_SAMPLES, 1.0f) * 255.0f);
+				texel[2] = (uint8_t)std::lround((std::min)(scale / ENVIRONMENT_BAKER_BRDF_SAMPLES, 1.0f) * 255.0f);
+				texel[3] = 255;
+			}
+		}));
+
+	if (!cachePath.empty())
+	{
+		std::ofstream file(cachePath, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (file.is_open())
+			file.write((const char*)p_brdfLut.raw, (std::streamsize)dataSize);
+	}
+
+	return true;
+}
+
+void CEnvironmentBaker::MakeUniformEnvironment(const float p_radiance[3], ImageRaw& p_specular, ImageRaw& p_diffuse)
+{
+	// the irradiance of a uniform environment divided by pi, as BakeEnvironment stores it, is its radiance
+	for (ImageRaw* image : { &p_specular, &p_diffuse })
+	{
+		*image = ImageRaw{};
+		image->name = "uniform_environment";
+		image->width = 1;
+		image->height = 1;
+		image->depthOrArraySize = 6;
+		image->channels = 3;
+		image->mipLevels = 1;
+		image->encoding = te_rgb9e5;
+		image->dataSize = 6 * sizeof(uint32_t);
+		image->raw = (unsigned char*)malloc(image->dataSize);
+
+		uint32_t* packed = (uint32_t*)image->raw;
+		for (uint32_t face = 0; face < 6; face++)
+			packed[face] = PackRGB9E5(p_radiance);
+	}
+}
+
+void CEnvironmentBaker::MakeUniformBrdfLut(ImageRaw& p_brdfLut)
+{
+	p_brdfLut = ImageRaw{};
+	p_brdfLut.name = "brdf_lut_uniform";
+	p_brdfLut.width = 1;
+	p_brdfLut.height = 1;
+	p_brdfLut.depthOrArraySize = 1;
+	p_brdfLut.channels = 4;
+	p_brdfLut.mipLevels = 1;
+	p_brdfLut.raw = (unsigned char*)malloc(4);
+
+	// no bias, a scale of 1
+	p_brdfLut.raw[0] = 0;
+	p_brdfLut.raw[1] = 0;
+	p_brdfLut.raw[2] = 255;
+	p_brdfLut.raw[3] = 255;
+}
+
+bool CEnvironmentBaker::ReadCache(const std::filesystem::path& p_path, ImageRaw& p_specular, ImageRaw& p_diffuse) const
+{
+	std::ifstream file(p_path, std::ios::binary | std::ios::in | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size < (std::streamsize)sizeof(EnvironmentCacheHeader))
+		return false;
+
+	EnvironmentCacheHeader header{};
+	file.seekg(0, std::ios::beg);
+	file.read((char*)&header, sizeof(header));
+
+	// a truncated, foreign or colliding entry is baked over
+	if (header.magic != c_environmentCacheMagic || header.version != ENVIRONMENT_BAKER_VERSION ||
+		header.specularSize != m_settings.specularSize || header.diffuseSize != m_settings.diffuseSize ||
+		header.specularBytes + header.diffuseBytes != (uint64_t)(size - (std::streamsize)sizeof(EnvironmentCacheHeader)))
+		return false;
+
+	p_specular = ImageRaw{};
+	p_specular.width = p_specular.height = (int)header.specularSize;
+	p_specular.depthOrArraySize = 6;
+	p_specular.channels = 3;
+	p_specular.mipLevels = header.specularMips;
+	p_specular.encoding = te_rgb9e5;
+	p_specular.dataSize = (size_t)header.specularBytes;
+	p_specular.raw = (unsigned char*)malloc(p_specular.dataSize);
+	file.read((char*)p_specular.raw, (std::streamsize)p_specular.dataSize);
+
+	p_diffuse = ImageRaw{};
+	p_diffuse.width = p_diffuse.height = (int)header.diffuseSize;
+	p_diffuse.depthOrArraySize = 6;
+	p_diffuse.channels = 3;
+	p_diffuse.mipLevels = 1;
+	p_diffuse.encoding = te_rgb9e5;
+	p_diffuse.dataSize = (size_t)header.diffuseBytes;
+	p_diffuse.raw = (unsigned char*)malloc(p_diffuse.dataSize);
+	file.read((char*)p_diffuse.raw, (std::streamsize)p_diffuse.dataSize);
+
+	if (!file)
+	{
+		FreeRawImage(p_specular);
+		FreeRawImage(p_diffuse);
+		return false;
+	}
+
+	return true;
+}
+
+void CEnvironmentBaker::WriteCache(const std::filesystem::path& p_path, const ImageRaw& p_specular, const ImageRaw& p_diffuse) const
+{
+	EnvironmentCacheHeader header{};
+	header.magic = c_environmentCacheMagic;
+	header.version = ENVIRONMENT_BAKER_VERSION;
+	header.specularSize = (uint32_t)p_specular.width;
+	header.specularMips = p_specular.mipLevels;
+	header.diffuseSize = (uint32_t)p_diffuse.width;
+	header.specularBytes = p_specular.dataSize;
+	header.diffuseBytes = p_diffuse.dataSize;
+
+	std::filesystem::path tempPath = p_path;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "CEnvironmentBaker::WriteCache Error: Failed to open " << tempPath.generic_string() << std::endl;
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)p_specular.raw, (std::streamsize)p_specular.dataSize);
+		file.write((const char*)p_diffuse.raw, (std::streamsize)p_diffuse.dataSize);
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, p_path, error);
+	if (error)
+		std::filesystem::remove(tempPath, error);
+}
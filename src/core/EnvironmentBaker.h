@@ -0,0 +1,71 @@
+#pragma once
+
+#include "AssetLoader.h"
+#include "ThreadPool.h"
+
+#include <filesystem>
+#include <functional>
+
+#define IBL_ENVIRONMENT_MAP						"Textures/IBL/georgentor_4k.hdr"	// under g_DefaultPath, the prefiltered DDS cube maps are loaded without it
+#define IBL_SPECULAR_SIZE						512
+#define IBL_SPECULAR_SAMPLES					64		// per texel of the specular mips, filtered by the source mip they read
+#define IBL_MAX_REFLECTION_LOD					9		// MAX_REFLECTION_LOD of the lighting shaders, the mip sampled at roughness 1
+#define IBL_DIFFUSE_SIZE						32
+#define IBL_BRDF_LUT_SIZE						256
+
+// Bakes the image based lighting on the CPU. From an equirectangular HDR environment come the specular cube map,
+// the environment itself in mip 0 and GGX importance sampled prefilters of it in the others, and the diffuse
+// irradiance cube map, evaluated from the SH9 projection of the environment. Both are stored RGB9E5, a quarter of
+// the RGBA32F stb_image decodes to. The split sum BRDF LUT does not depend on the environment and is baked alone.
+// Texels are spread over the worker threads and the results are cached on disk under a hash of the source file
+// and the options, so switching to an environment baked once only reads the cache
+class CEnvironmentBaker
+{
+public:
+	struct Settings
+	{
+		std::filesystem::path			cacheDir;				// empty disables the disk cache
+		uint32_t						workerCount;			// 0 = one per hardware thread minus the calling thread
+		uint32_t						specularSize;			// power of two
+		uint32_t						specularSamples;
+		uint32_t						diffuseSize;
+		uint32_t						brdfLutSize;
+	};
+
+	CEnvironmentBaker();
+	~CEnvironmentBaker();
+
+	bool Create(const Settings& p_settings);
+	void Destroy();
+
+	// Cube maps of te_rgb9e5 texels, every mip of a face before the next face
+	bool BakeEnvironment(const std::filesystem::path& p_path, ImageRaw& p_specular, ImageRaw& p_diffuse);
+
+	// RGBA8 with the scale of the split sum in b and its bias in g, N.V along u and roughness along v
+	bool BakeBrdfLut(ImageRaw& p_brdfLut);
+
+	// Stand-ins while the environment bakes, laid out as the baked ones: cube maps of a texel per face lit evenly by
+	// p_radiance, and a LUT of one texel that reflects F0 alone
+	static void MakeUniformEnvironment(const float p_radiance[3], ImageRaw& p_specular, ImageRaw& p_diffuse);
+	static void MakeUniformBrdfLut(ImageRaw& p_brdfLut);
+
+	bool IsCreated() const { return m_threadPool != nullptr; }
+
+private:
+	// RGB floats of the 6 faces one after the other
+	struct CubeLevel
+	{
+		uint32_t						size;
+		std::vector<float>				texels;
+	};
+
+	Settings							m_settings;
+	CThreadPool*						m_threadPool;
+
+	bool ForEachRow(uint32_t p_rowCount, const std::function<void(uint32_t p_row)>& p_func);
+	bool ResampleEquirect(const ImageRaw& p_equirect, CubeLevel& p_cube);
+	bool PrefilterSpecular(const std::vector<CubeLevel>& p_source, uint32_t p_mip, CubeLevel& p_prefiltered);
+	void ProjectIrradiance(const CubeLevel& p_source, float p_sh[9][3]) const;
+	bool ReadCache(const std::filesystem::path& p_path, ImageRaw& p_specular, ImageRaw& p_diffuse) const;
+	void WriteCache(const std::filesystem::path& p_path, const ImageRaw& p_specular, const ImageRaw& p_diffuse) const;
+};
@@ -0,0 +1,438 @@
+#include "FileIO.h"
+#include "Global.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if FILE_IO_URING
+#include <liburing.h>
+#endif
+
+static std::atomic<FileBackend> g_fileBackend(FILE_IO_URING ? fb_uring : fb_mapped);
+
+void SetFileBackend(FileBackend p_backend)
+{
+	g_fileBackend = p_backend;
+}
+
+FileBackend GetFileBackend()
+{
+	return g_fileBackend;
+}
+
+CFileView::CFileView()
+	: m_data(nullptr)
+	, m_size(0)
+	, m_mapped(false)
+{
+}
+
+CFileView::~CFileView()
+{
+	Close();
+}
+
+CFileView::CFileView(CFileView&& p_other) noexcept
+	: m_data(nullptr)
+	, m_size(0)
+	, m_mapped(false)
+{
+	*this = std::move(p_other);
+}
+
+CFileView& CFileView::operator=(CFileView&& p_other) noexcept
+{
+	if (this == &p_other)
+		return *this;
+
+	Close();
+
+	// moving the vector keeps its data where it is, the pointer into it stays valid
+	m_buffer = std::move(p_other.m_buffer);
+	m_data = p_other.m_data;
+	m_size = p_other.m_size;
+	m_mapped = p_other.m_mapped;
+
+	p_other.m_data = nullptr;
+	p_other.m_size = 0;
+	p_other.m_mapped = false;
+	return *this;
+}
+
+bool CFileView::Open(const char* p_path)
+{
+	Close();
+
+	if (g_fileBackend != fb_stream && Map(p_path))
+		return true;
+
+	return Read(p_path);
+}
+
+void CFileView::Close()
+{
+	if (m_mapped && m_data != nullptr)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(m_data);
+#else
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+	}
+
+	m_buffer.clear();
+	m_buffer.shrink_to_fit();
+	m_data = nullptr;
+	m_size = 0;
+	m_mapped = false;
+}
+
+bool CFileView::Map(const char* p_path)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(p_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize{};
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	// the view keeps the mapping and the file alive
+	void* view = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	CloseHandle(file);
+
+	if (view == nullptr)
+		return false;
+
+	m_data = static_cast<const unsigned char*>(view);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = open(p_path, O_RDONLY | O_CLOEXEC);
+	if (file == -1)
+		return false;
+
+	struct stat fileStatus;
+	void* view = MAP_FAILED;
+	if (fstat(file, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && fileStatus.st_size > 0)
+		view = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	(void)madvise(view, static_cast<size_t>(fileStatus.st_size), MADV_SEQUENTIAL);
+	m_data = static_cast<const unsigned char*>(view);
+	m_size = static_cast<size_t>(fileStatus.st_size);
+#endif
+	m_mapped = true;
+	return true;
+}
+
+bool CFileView::Read(const char* p_path)
+{
+	// a directory opens as a stream of no defined size
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(p_path, error))
+		return false;
+
+	std::ifstream file(p_path, std::ios::binary | std::ios::in | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size < 0)
+		return false;
+
+	m_buffer.resize(static_cast<size_t>(size));
+	file.seekg(0, std::ios::beg);
+	if (size > 0 && !file.read(reinterpret_cast<char*>(m_buffer.data()), size))
+	{
+		m_buffer.clear();
+		return false;
+	}
+
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+	return true;
+}
+
+#if FILE_IO_URING
+// Files are opened as their first block is queued and closed once their last one completes, so no more files are
+// open than there are reads in flight. False only when the ring cannot be set up, the caller then reads them alone
+static bool ReadFilesUring(const std::vector<std::string>& p_paths, std::vector<std::vector<unsigned char>>& p_buffers, std::vector<bool>& p_read)
+{
+	struct io_uring ring;
+	if (io_uring_queue_init(FILE_IO_URING_QUEUE_DEPTH, &ring, 0) < 0)
+		return false;
+
+	struct PendingFile
+	{
+		int								file;
+		size_t							queued;			// bytes of the file queued so far
+		size_t							completed;
+		uint32_t						inFlight;
+		bool							failed;
+		bool							finished;
+	};
+
+	struct Request
+	{
+		size_t							index;
+		size_t							offset;
+		size_t							length;
+	};
+
+	std::vector<PendingFile> files(p_paths.size(), PendingFile{ -1, 0, 0, 0, false, false });
+	std::vector<Request> requests(FILE_IO_URING_QUEUE_DEPTH);
+	std::vector<uint32_t> freeRequests;
+	for (uint32_t i = 0; i < FILE_IO_URING_QUEUE_DEPTH; i++)
+		freeRequests.push_back(FILE_IO_URING_QUEUE_DEPTH - 1 - i);
+
+	auto finish = [&](size_t p_index)
+	{
+		PendingFile& pending = files[p_index];
+		if (pending.file != -1)
+			close(pending.file);
+		pending.file = -1;
+		pending.finished = true;
+
+		if (pending.failed)
+			p_buffers[p_index].clear();
+		p_read[p_index] = !pending.failed;
+	};
+
+	auto queue = [&](uint32_t p_request)
+	{
+		const Request& request = requests[p_request];
+		struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+		io_uring_prep_read(sqe, files[request.index].file, p_buffers[request.index].data() + request.offset,
+			static_cast<unsigned>(request.length), request.offset);
+		io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(p_request)));
+		files[request.index].inFlight++;
+	};
+
+	size_t next = 0;
+	uint32_t inFlight = 0;
+	while (next < p_paths.size() || inFlight > 0)
+	{
+		// Filling the queue with the blocks of the files in order
+		while (!freeRequests.empty() && next < p_paths.size())
+		{
+			PendingFile& pending = files[next];
+			if (pending.failed)
+			{
+				// its blocks in flight let it go as they complete
+				if (pending.inFlight == 0 && !pending.finished)
+					finish(next);
+				next++;
+				continue;
+			}
+
+			if (pending.file == -1)
+			{
+				pending.file = open(p_paths[next].c_str(), O_RDONLY | O_CLOEXEC);
+				struct stat fileStatus;
+				if (pending.file == -1 || fstat(pending.file, &fileStatus) != 0 || !S_ISREG(fileStatus.st_mode))
+				{
+					pending.failed = true;
+					continue;
+				}
+
+				p_buffers[next].resize(static_cast<size_t>(fileStatus.st_size));
+				if (fileStatus.st_size == 0)
+				{
+					finish(next++);
+					continue;
+				}
+			}
+
+			uint32_t request = freeRequests.back();
+			freeRequests.pop_back();
+			size_t length = (std::min)(p_buffers[next].size() - pending.queued, (size_t)FILE_IO_URING_BLOCK_SIZE);
+			requests[request] = Request{ next, pending.queued, length };
+			pending.queued += length;
+			queue(request);
+			inFlight++;
+
+			if (pending.queued == p_buffers[next].size())
+				next++;
+		}
+
+		if (inFlight == 0)
+			continue;
+
+		io_uring_submit(&ring);
+
+		struct io_uring_cqe* cqe = nullptr;
+		int waited = io_uring_wait_cqe(&ring, &cqe);
+		if (waited == -EINTR)
+			continue;
+		if (waited < 0)
+			break;
+
+		uint32_t request = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+		int result = cqe->res;
+		io_uring_cqe_seen(&ring, cqe);
+
+		Request& completed = requests[request];
+		PendingFile& pending = files[completed.index];
+		pending.inFlight--;
+
+		// A short read is queued again for the rest of the block, a file truncated under the read fails on the next
+		if (result > 0 && static_cast<size_t>(result) < completed.length && !pending.failed)
+		{
+			completed.offset += static_cast<size_t>(result);
+			completed.length -= static_cast<size_t>(result);
+			pending.completed += static_cast<size_t>(result);
+			queue(request);
+			continue;
+		}
+
+		if (result <= 0)
+			pending.failed = true;
+		else
+			pending.completed += completed.length;
+
+		freeRequests.push_back(request);
+		inFlight--;
+
+		if (pending.inFlight == 0 && !pending.finished && (pending.failed || pending.completed == p_buffers[completed.index].size()))
+			finish(completed.index);
+	}
+
+	// Waiting failed with reads still in flight. They are cancelled and their completions collected before the ring goes,
+	// the kernel would otherwise still be writing into buffers the caller frees or reads
+	if (inFlight > 0)
+	{
+		const uintptr_t cancelTag = FILE_IO_URING_QUEUE_DEPTH;
+		std::vector<bool> freeRequest(FILE_IO_URING_QUEUE_DEPTH, false);
+		for (uint32_t request : freeRequests)
+			freeRequest[request] = true;
+
+		uint32_t cancels = 0;
+		for (uint32_t request = 0; request < FILE_IO_URING_QUEUE_DEPTH; request++)
+		{
+			if (freeRequest[request])
+				continue;
+
+			struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+			if (sqe == nullptr)
+			{
+				io_uring_submit(&ring);
+				sqe = io_uring_get_sqe(&ring);
+			}
+			io_uring_prep_cancel(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(request)), 0);
+			io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(cancelTag));
+			cancels++;
+		}
+		io_uring_submit(&ring);
+
+		// every read completes once, cancelled or not, and so does every cancel
+		while (inFlight > 0 || cancels > 0)
+		{
+			struct io_uring_cqe* cqe = nullptr;
+			int waited = io_uring_wait_cqe(&ring, &cqe);
+			if (waited == -EINTR)
+				continue;
+			if (waited < 0)
+				break;
+
+			uintptr_t data = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+			io_uring_cqe_seen(&ring, cqe);
+			if (data == cancelTag)
+			{
+				cancels--;
+				continue;
+			}
+
+			files[requests[data].index].inFlight--;
+			inFlight--;
+		}
+
+		// Not even the completions could be collected, the buffers still read into are left to the kernel rather than freed under it
+		for (size_t i = 0; i < files.size() && inFlight > 0; i++)
+		{
+			if (files[i].inFlight > 0)
+				new std::vector<unsigned char>(std::move(p_buffers[i]));
+		}
+	}
+
+	// the files that did not complete fail, the caller reads them alone
+	io_uring_queue_exit(&ring);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (!files[i].finished)
+		{
+			files[i].failed = true;
+			finish(i);
+		}
+	}
+
+	return true;
+}
+#endif
+
+bool ReadFiles(const std::vector<std::string>& p_paths, std::vector<CFileView>& p_views)
+{
+	PROFILE_FUNCTION();
+
+	p_views.clear();
+	p_views.resize(p_paths.size());
+
+	std::vector<bool> read(p_paths.size(), false);
+	bool batched = false;
+#if FILE_IO_URING
+	std::vector<std::vector<unsigned char>> buffers(p_paths.size());
+	if (g_fileBackend == fb_uring)
+		batched = ReadFilesUring(p_paths, buffers, read);
+#endif
+
+	bool succeeded = true;
+	for (size_t i = 0; i < p_paths.size(); i++)
+	{
+		if (!batched)
+		{
+			read[i] = p_views[i].Open(p_paths[i].c_str());
+		}
+#if FILE_IO_URING
+		else if (read[i])
+		{
+			p_views[i].m_buffer = std::move(buffers[i]);
+			p_views[i].m_data = p_views[i].m_buffer.data();
+			p_views[i].m_size = p_views[i].m_buffer.size();
+		}
+		else
+		{
+			read[i] = p_views[i].Open(p_paths[i].c_str());
+		}
+#endif
+
+		if (!read[i])
+		{
+			std::cerr << "ReadFiles Error: Failed to read " << p_paths[i] << std::endl;
+			succeeded = false;
+		}
+	}
+
+	return succeeded;
+}
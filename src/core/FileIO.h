@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Batched reads go through io_uring on Linux; the build has to link liburing
+#if !defined(FILE_IO_URING)
+#define FILE_IO_URING 0
+#endif
+
+#define FILE_IO_URING_QUEUE_DEPTH				64		// reads in flight at once
+#define FILE_IO_URING_BLOCK_SIZE				(1024 * 1024)	// large files are read in blocks of this, spread over the queue
+
+// How the asset loaders read files
+enum FileBackend
+{
+	  fb_stream						= 0		// std::ifstream into a buffer, works on every file system
+	, fb_mapped								// memory mapped, random access containers are parsed in place
+	, fb_uring								// mapped, and the files read together are read through io_uring at once
+};
+
+// Read only bytes of a whole file, mapped or read into a buffer of the view depending on the backend. A file
+// that cannot be mapped, an empty one or one on a file system without mmap support, is read instead
+class CFileView
+{
+public:
+	CFileView();
+	~CFileView();
+
+	CFileView(CFileView&& p_other) noexcept;
+	CFileView& operator=(CFileView&& p_other) noexcept;
+	CFileView(const CFileView&) = delete;
+	CFileView& operator=(const CFileView&) = delete;
+
+	bool Open(const char* p_path);
+	void Close();
+
+	const unsigned char* GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+	bool IsMapped() const { return m_mapped; }
+
+private:
+	const unsigned char*				m_data;
+	size_t								m_size;
+	bool								m_mapped;
+	std::vector<unsigned char>			m_buffer;
+
+	bool Map(const char* p_path);
+	bool Read(const char* p_path);
+
+	friend bool ReadFiles(const std::vector<std::string>& p_paths, std::vector<CFileView>& p_views);
+};
+
+// Process wide, fb_uring without FILE_IO_URING reads like fb_mapped
+void SetFileBackend(FileBackend p_backend);
+FileBackend GetFileBackend();
+
+// Reads the files together, the views in the order of the paths. With fb_uring all the reads are queued at once,
+// which keeps a network file system busy where reading the files one after the other waits on every round trip;
+// the other backends, or a kernel without io_uring, open them one after the other. A file that fails leaves its
+// view empty and makes it return false, the others are read all the same
+bool ReadFiles(const std::vector<std::string>& p_paths, std::vector<CFileView>& p_views);
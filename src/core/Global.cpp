@@ -1,7 +1,12 @@
 #include "Global.h"
+#if defined(_WIN32)
 #include <windows.h>
+#endif
 
 std::ostringstream g_oss = std::ostringstream();
+std::mutex g_logMutex;
+
+#if defined(_WIN32)
 HANDLE g_hConsole;
 
 void init_console()
@@ -23,6 +28,19 @@ void clog_stream(int pMsgColor)
 	g_oss.clear();
 	SetConsoleTextAttribute(g_hConsole, 0x0007);
 };
+#else
+// headless builds log to the terminal they run in, without colors
+void init_console()
+{
+}
+
+void clog_stream(int)
+{
+	std::clog << g_oss.str();
+	g_oss.str("");
+	g_oss.clear();
+};
+#endif
 
 void clog_stream()
 {
@@ -7,29 +7,42 @@
 #include <filesystem>
 
 #include <iostream>
+#include <mutex>
 #include <sstream>
 
 extern std::ostringstream g_oss;
+extern std::mutex g_logMutex;			// the CLOG macros share g_oss and may be used from any thread
 
-#define CLOG_GREEN(x)											\
-g_oss << x;														\
-clog_stream(0x0002)												
+// Keeps the platform facing signatures the same on headless non Win32 builds, where they are always null
+#if !defined(_WIN32)
+typedef void* HINSTANCE;
+typedef void* HWND;
+#endif
+
+#define CLOG_GREEN(x)										\
+{ std::lock_guard<std::mutex> logLock(g_logMutex);			\
+g_oss << x;													\
+clog_stream(0x0002); }
 
-#define CLOG_RED(x)												\
-g_oss << x;														\
-clog_stream(0x0004)											
+#define CLOG_RED(x)											\
+{ std::lock_guard<std::mutex> logLock(g_logMutex);			\
+g_oss << x;													\
+clog_stream(0x0004); }
 
-#define CLOG_BLUE(x)											\
-g_oss << x;														\
-clog_stream(0x0001)											
+#define CLOG_BLUE(x)										\
+{ std::lock_guard<std::mutex> logLock(g_logMutex);			\
+g_oss << x;													\
+clog_stream(0x0001); }
 
-#define CLOG_YELLOW(x)											\
-g_oss << x;														\
-clog_stream(0x0006)											
+#define CLOG_YELLOW(x)										\
+{ std::lock_guard<std::mutex> logLock(g_logMutex);			\
+g_oss << x;													\
+clog_stream(0x0006); }
 
-#define CLOG(x)													\
-g_oss << x;														\
-clog_stream()												
+#define CLOG(x)												\
+{ std::lock_guard<std::mutex> logLock(g_logMutex);			\
+g_oss << x;													\
+clog_stream(); }
 
 extern void init_console();
 extern void clog_stream(int pMsgColor);
@@ -47,6 +60,9 @@ extern std::filesystem::path g_AssetPath;
 #endif
 
 #define RAY_TRACING_ENABLED						1
+#define CPU_PROFILER_ENABLED					1		// 0 compiles the CPU zones out, see Profiler.h
+#define ASYNC_NONCRITICAL_PIPELINES				1		// 0 creates the debug draw and SSR pipelines before the first frame too
+#define PROGRESSIVE_SCENE_LOADING				1		// 0 loads the environment and the scene's assets before the first frame
 
 #define PI                                      3.14159265359
 
@@ -60,11 +76,16 @@ extern std::filesystem::path g_AssetPath;
 #define THREAD_GROUP_SIZE_Y						8
 #define THREAD_GROUP_SIZE_Z						1
 
-#define FRAME_BUFFER_COUNT                      2
+#define MAX_FRAMES_IN_FLIGHT                    4       // per frame resources are allocated for this many frames
+#define DEFAULT_FRAMES_IN_FLIGHT                2
+#define MAX_SWAPCHAIN_IMAGES                    8
 #define MAX_SUPPORTED_DEBUG_DRAW_ENTITES        256
 #define MAX_SUPPORTED_MESHES                    100
+#define MAX_SUPPORTED_MESH_INSTANCES            4096
 #define MAX_SUPPORTED_MATERIALS                 1000000
-#define MAX_SUPPORTED_TEXTURES                  2048
+#define MAX_SUPPORTED_TEXTURES                  65536   // upper bound of the bindless texture table, the device limits may lower it
+#define BINDLESS_RESERVED_DESCRIPTORS           64      // sampled images per stage left to the bindings next to the bindless table
+#define BINDLESS_WRITE_CHUNK                    64      // bindless slots written by one descriptor update template
 
 #define TEXTURE_READ_ID_SSAO_NOISE              0
 #define DEFAULT_TEXTURE_ID                      0
@@ -99,6 +120,13 @@ extern std::filesystem::path g_AssetPath;
 #define ENABLE_SHADOW							1
 #define ENABLE_RT_SHADOW						2
 #define ENABLE_PCF								4
+
+// Feature flags, together with the shadow flags they make up the specialization constant
+// FEATURE_PERMUTATION_ID the lighting and tone map pipelines are built for
+#define ENABLE_IBL								8
+#define ENABLE_SSAO								16
+#define ENABLE_SSR								32
+#define FEATURE_PERMUTATION_ID					0
 #define SHADOW_BIAS                             0.005
 
 #define DIRECTIONAL_LIGHT_TYPE                  0
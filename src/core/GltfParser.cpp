@@ -0,0 +1,1302 @@
+#include "GltfParser.h"
+#include "FileIO.h"
+#include "Global.h"
+#include "Profiler.h"
+
+#include "external/tinygltf/tiny_gltf.h"
+
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Strings, whitespace and skipped values are scanned 16 bytes at a time with SSE2, part of every x64 target
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLTF_PARSER_SSE2				1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define GLTF_PARSER_SSE2				0
+#endif
+
+#define GLB_MAGIC						0x46546C67		// "glTF"
+#define GLB_CHUNK_JSON					0x4E4F534A
+#define GLB_CHUNK_BIN					0x004E4942
+
+static std::atomic<GltfParser> g_gltfParser(gp_streaming);
+
+void SetGltfParser(GltfParser p_parser)
+{
+	g_gltfParser = p_parser;
+}
+
+GltfParser GetGltfParser()
+{
+	return g_gltfParser;
+}
+
+#if GLTF_PARSER_SSE2
+static uint32_t FirstBit(uint32_t p_mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, p_mask);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctz(p_mask);
+#endif
+}
+#endif
+
+static bool IsSpace(char p_char)
+{
+	return p_char == ' ' || p_char == '\n' || p_char == '\r' || p_char == '\t';
+}
+
+// First quote or backslash, the only characters that end a run of string content
+static const char* FindStringEnd(const char* p_cur, const char* p_end)
+{
+#if GLTF_PARSER_SSE2
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	for (; p_cur + 16 <= p_end; p_cur += 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_cur));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+		if (mask != 0)
+			return p_cur + FirstBit(mask);
+	}
+#endif
+	for (; p_cur < p_end; p_cur++)
+	{
+		if (*p_cur == '"' || *p_cur == '\\')
+			return p_cur;
+	}
+	return p_end;
+}
+
+// First quote or bracket, what a skipped object or array has to be looked at for
+static const char* FindStructural(const char* p_cur, const char* p_end)
+{
+#if GLTF_PARSER_SSE2
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i openBrace = _mm_set1_epi8('{');
+	const __m128i closeBrace = _mm_set1_epi8('}');
+	const __m128i openBracket = _mm_set1_epi8('[');
+	const __m128i closeBracket = _mm_set1_epi8(']');
+	for (; p_cur + 16 <= p_end; p_cur += 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_cur));
+		__m128i braces = _mm_or_si128(_mm_cmpeq_epi8(chunk, openBrace), _mm_cmpeq_epi8(chunk, closeBrace));
+		__m128i brackets = _mm_or_si128(_mm_cmpeq_epi8(chunk, openBracket), _mm_cmpeq_epi8(chunk, closeBracket));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_or_si128(braces, brackets)));
+		if (mask != 0)
+			return p_cur + FirstBit(mask);
+	}
+#endif
+	for (; p_cur < p_end; p_cur++)
+	{
+		char c = *p_cur;
+		if (c == '"' || c == '{' || c == '}' || c == '[' || c == ']')
+			return p_cur;
+	}
+	return p_end;
+}
+
+// On demand reader over the JSON text: values are parsed as the caller asks for them, anything it does not ask for is
+// skipped without being parsed
+class CJsonReader
+{
+public:
+	CJsonReader(const char* p_data, size_t p_size)
+		: m_begin(p_data)
+		, m_cur(p_data)
+		, m_end(p_data + p_size)
+	{
+	}
+
+	const std::string& GetError() const { return m_error; }
+
+	bool Fail(const char* p_message)
+	{
+		if (m_error.empty())
+			m_error = std::string(p_message) + " at offset " + std::to_string(m_cur - m_begin);
+		return false;
+	}
+
+	void SkipWhitespace()
+	{
+		// mostly a single space or none, indentation runs are skipped a chunk at a time
+		if (m_cur < m_end && !IsSpace(*m_cur))
+			return;
+#if GLTF_PARSER_SSE2
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i newLine = _mm_set1_epi8('\n');
+		const __m128i carriageReturn = _mm_set1_epi8('\r');
+		const __m128i tab = _mm_set1_epi8('\t');
+		for (; m_cur + 16 <= m_end; m_cur += 16)
+		{
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_cur));
+			__m128i spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newLine)),
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, carriageReturn), _mm_cmpeq_epi8(chunk, tab)));
+			uint32_t mask = ~(uint32_t)_mm_movemask_epi8(spaces) & 0xFFFF;
+			if (mask != 0)
+			{
+				m_cur += FirstBit(mask);
+				return;
+			}
+		}
+#endif
+		while (m_cur < m_end && IsSpace(*m_cur))
+			m_cur++;
+	}
+
+	char Peek()
+	{
+		SkipWhitespace();
+		return (m_cur < m_end) ? *m_cur : '\0';
+	}
+
+	bool Consume(char p_char)
+	{
+		if (Peek() != p_char)
+			return Fail((std::string("Expected '") + p_char + "'").c_str());
+		m_cur++;
+		return true;
+	}
+
+	// Calls p_member(key) for every member, which has to read or skip its value
+	template <typename F>
+	bool ReadObject(F&& p_member)
+	{
+		RETURN_FALSE_IF_FALSE(Consume('{'));
+		if (Peek() == '}')
+		{
+			m_cur++;
+			return true;
+		}
+
+		while (true)
+		{
+			std::string_view key;
+			RETURN_FALSE_IF_FALSE(ReadKey(key));
+			RETURN_FALSE_IF_FALSE(Consume(':'));
+			RETURN_FALSE_IF_FALSE(p_member(key));
+
+			// truncated input peeks '\0' and fails here, with the cursor left at the end
+			char next = Peek();
+			if (next != ',' && next != '}')
+				return Fail("Expected ',' or '}'");
+			m_cur++;
+			if (next == '}')
+				return true;
+		}
+	}
+
+	// Calls p_element(index) for every element, which has to read or skip it
+	template <typename F>
+	bool ReadArray(F&& p_element)
+	{
+		RETURN_FALSE_IF_FALSE(Consume('['));
+		if (Peek() == ']')
+		{
+			m_cur++;
+			return true;
+		}
+
+		for (size_t index = 0;; index++)
+		{
+			RETURN_FALSE_IF_FALSE(p_element(index));
+
+			char next = Peek();
+			if (next != ',' && next != ']')
+				return Fail("Expected ',' or ']'");
+			m_cur++;
+			if (next == ']')
+				return true;
+		}
+	}
+
+	bool ReadString(std::string& p_value)
+	{
+		RETURN_FALSE_IF_FALSE(Consume('"'));
+		p_value.clear();
+		while (true)
+		{
+			const char* stop = FindStringEnd(m_cur, m_end);
+			p_value.append(m_cur, stop);
+			m_cur = stop;
+			if (m_cur == m_end)
+				return Fail("Unterminated string");
+
+			if (*m_cur++ == '"')
+				return true;
+			RETURN_FALSE_IF_FALSE(ReadEscape(p_value));
+		}
+	}
+
+	// Keys are read in place, only one with escapes is copied
+	bool ReadKey(std::string_view& p_key)
+	{
+		if (Peek() != '"')
+			return Fail("Expected a key");
+
+		const char* start = m_cur + 1;
+		const char* stop = FindStringEnd(start, m_end);
+		if (stop < m_end && *stop == '"')
+		{
+			p_key = std::string_view(start, (size_t)(stop - start));
+			m_cur = stop + 1;
+			return true;
+		}
+
+		RETURN_FALSE_IF_FALSE(ReadString(m_key));
+		p_key = m_key;
+		return true;
+	}
+
+	bool ReadDouble(double& p_value)
+	{
+		SkipWhitespace();
+		auto result = std::from_chars(m_cur, m_end, p_value);
+		if (result.ec != std::errc())
+			return Fail("Expected a number");
+		m_cur = result.ptr;
+		return true;
+	}
+
+	// Integers are parsed as such, a number written with a fraction or an exponent is truncated
+	bool ReadInteger(int64_t& p_value)
+	{
+		SkipWhitespace();
+		auto result = std::from_chars(m_cur, m_end, p_value);
+		if (result.ec == std::errc() && (result.ptr == m_end || (*result.ptr != '.' && *result.ptr != 'e' && *result.ptr != 'E')))
+		{
+			m_cur = result.ptr;
+			return true;
+		}
+
+		double value;
+		RETURN_FALSE_IF_FALSE(ReadDouble(value));
+		p_value = (int64_t)value;
+		return true;
+	}
+
+	bool ReadInt(int& p_value)
+	{
+		int64_t value;
+		RETURN_FALSE_IF_FALSE(ReadInteger(value));
+		if (value < INT_MIN || value > INT_MAX)
+			return Fail("Integer out of range");
+		p_value = (int)value;
+		return true;
+	}
+
+	bool ReadSize(size_t& p_value)
+	{
+		int64_t value;
+		RETURN_FALSE_IF_FALSE(ReadInteger(value));
+		if (value < 0)
+			return Fail("Expected a positive integer");
+		p_value = (size_t)value;
+		return true;
+	}
+
+	bool ReadBool(bool& p_value)
+	{
+		SkipWhitespace();
+		if (m_end - m_cur >= 4 && memcmp(m_cur, "true", 4) == 0)
+		{
+			p_value = true;
+			m_cur += 4;
+			return true;
+		}
+		if (m_end - m_cur >= 5 && memcmp(m_cur, "false", 5) == 0)
+		{
+			p_value = false;
+			m_cur += 5;
+			return true;
+		}
+		return Fail("Expected a boolean");
+	}
+
+	bool ReadDoubles(std::vector<double>& p_values)
+	{
+		p_values.clear();
+		return ReadArray([&](size_t)
+		{
+			double value;
+			RETURN_FALSE_IF_FALSE(ReadDouble(value));
+			p_values.push_back(value);
+			return true;
+		});
+	}
+
+	bool ReadInts(std::vector<int>& p_values)
+	{
+		p_values.clear();
+		return ReadArray([&](size_t)
+		{
+			int value;
+			RETURN_FALSE_IF_FALSE(ReadInt(value));
+			p_values.push_back(value);
+			return true;
+		});
+	}
+
+	bool ReadStrings(std::vector<std::string>& p_values)
+	{
+		p_values.clear();
+		return ReadArray([&](size_t p_index)
+		{
+			p_values.emplace_back();
+			return ReadString(p_values[p_index]);
+		});
+	}
+
+	// Any value as a tinygltf one, for the extensions
+	bool ReadValue(tinygltf::Value& p_value)
+	{
+		char c = Peek();
+		if (c == '{')
+		{
+			tinygltf::Value::Object object;
+			RETURN_FALSE_IF_FALSE(ReadObject([&](std::string_view p_key)
+			{
+				return ReadValue(object[std::string(p_key)]);
+			}));
+			p_value = tinygltf::Value(std::move(object));
+			return true;
+		}
+		if (c == '[')
+		{
+			tinygltf::Value::Array array;
+			RETURN_FALSE_IF_FALSE(ReadArray([&](size_t)
+			{
+				array.emplace_back();
+				return ReadValue(array.back());
+			}));
+			p_value = tinygltf::Value(std::move(array));
+			return true;
+		}
+		if (c == '"')
+		{
+			std::string value;
+			RETURN_FALSE_IF_FALSE(ReadString(value));
+			p_value = tinygltf::Value(std::move(value));
+			return true;
+		}
+		if (c == 't' || c == 'f')
+		{
+			bool value;
+			RETURN_FALSE_IF_FALSE(ReadBool(value));
+			p_value = tinygltf::Value(value);
+			return true;
+		}
+		if (c == 'n')
+		{
+			RETURN_FALSE_IF_FALSE(Skip());
+			p_value = tinygltf::Value();
+			return true;
+		}
+
+		// whole numbers in the range of an int are kept as one, as tinygltf does
+		const char* start = m_cur;
+		int64_t integer;
+		auto result = std::from_chars(m_cur, m_end, integer);
+		if (result.ec == std::errc() && (result.ptr == m_end || (*result.ptr != '.' && *result.ptr != 'e' && *result.ptr != 'E'))
+			&& integer >= INT_MIN && integer <= INT_MAX)
+		{
+			m_cur = result.ptr;
+			p_value = tinygltf::Value((int)integer);
+			return true;
+		}
+
+		m_cur = start;
+		double value;
+		RETURN_FALSE_IF_FALSE(ReadDouble(value));
+		p_value = tinygltf::Value(value);
+		return true;
+	}
+
+	bool ReadExtensions(tinygltf::ExtensionMap& p_extensions)
+	{
+		return ReadObject([&](std::string_view p_key)
+		{
+			return ReadValue(p_extensions[std::string(p_key)]);
+		});
+	}
+
+	// Skips a value of any kind; objects and arrays are only looked at for their strings and brackets
+	bool Skip()
+	{
+		char c = Peek();
+		if (c == '"')
+		{
+			m_cur++;
+			return SkipString();
+		}
+
+		if (c != '{' && c != '[')
+		{
+			// a number or a literal runs to the next delimiter
+			const char* start = m_cur;
+			while (m_cur < m_end && *m_cur != ',' && *m_cur != '}' && *m_cur != ']' && !IsSpace(*m_cur))
+				m_cur++;
+			return (m_cur != start) || Fail("Expected a value");
+		}
+
+		uint32_t depth = 0;
+		while (true)
+		{
+			m_cur = FindStructural(m_cur, m_end);
+			if (m_cur == m_end)
+				return Fail("Unterminated object or array");
+
+			char structural = *m_cur++;
+			if (structural == '"')
+			{
+				RETURN_FALSE_IF_FALSE(SkipString());
+			}
+			else if (structural == '{' || structural == '[')
+			{
+				depth++;
+			}
+			else if (--depth == 0)
+			{
+				return true;
+			}
+		}
+	}
+
+private:
+	const char*							m_begin;
+	const char*							m_cur;
+	const char*							m_end;
+	std::string							m_key;					// holds a key that had escapes
+	std::string							m_error;
+
+	// Past the opening quote
+	bool SkipString()
+	{
+		while (true)
+		{
+			m_cur = FindStringEnd(m_cur, m_end);
+			if (m_cur == m_end)
+				return Fail("Unterminated string");
+			if (*m_cur++ == '"')
+				return true;
+			if (m_cur == m_end)
+				return Fail("Unterminated string");
+			m_cur++;
+		}
+	}
+
+	static void AppendUtf8(std::string& p_value, uint32_t p_codePoint)
+	{
+		if (p_codePoint < 0x80)
+		{
+			p_value += (char)p_codePoint;
+		}
+		else if (p_codePoint < 0x800)
+		{
+			p_value += (char)(0xC0 | (p_codePoint >> 6));
+			p_value += (char)(0x80 | (p_codePoint & 0x3F));
+		}
+		else if (p_codePoint < 0x10000)
+		{
+			p_value += (char)(0xE0 | (p_codePoint >> 12));
+			p_value += (char)(0x80 | ((p_codePoint >> 6) & 0x3F));
+			p_value += (char)(0x80 | (p_codePoint & 0x3F));
+		}
+		else
+		{
+			p_value += (char)(0xF0 | (p_codePoint >> 18));
+			p_value += (char)(0x80 | ((p_codePoint >> 12) & 0x3F));
+			p_value += (char)(0x80 | ((p_codePoint >> 6) & 0x3F));
+			p_value += (char)(0x80 | (p_codePoint & 0x3F));
+		}
+	}
+
+	bool ReadHex4(uint32_t& p_value)
+	{
+		if (m_end - m_cur < 4)
+			return Fail("Invalid \\u escape");
+
+		p_value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = *m_cur++;
+			uint32_t digit = (c >= '0' && c <= '9') ? (uint32_t)(c - '0') : (c >= 'a' && c <= 'f') ? (uint32_t)(c - 'a' + 10) :
+				(c >= 'A' && c <= 'F') ? (uint32_t)(c - 'A' + 10) : 16;
+			if (digit == 16)
+				return Fail("Invalid \\u escape");
+			p_value = (p_value << 4) | digit;
+		}
+		return true;
+	}
+
+	// Past the backslash
+	bool ReadEscape(std::string& p_value)
+	{
+		if (m_cur == m_end)
+			return Fail("Unterminated string");
+
+		char c = *m_cur++;
+		switch (c)
+		{
+		case '"':	p_value += '"';		return true;
+		case '\\':	p_value += '\\';	return true;
+		case '/':	p_value += '/';		return true;
+		case 'b':	p_value += '\b';	return true;
+		case 'f':	p_value += '\f';	return true;
+		case 'n':	p_value += '\n';	return true;
+		case 'r':	p_value += '\r';	return true;
+		case 't':	p_value += '\t';	return true;
+		case 'u':
+		{
+			uint32_t codePoint;
+			RETURN_FALSE_IF_FALSE(ReadHex4(codePoint));
+
+			// a high surrogate pairs with the low one escaped after it
+			if (codePoint >= 0xD800 && codePoint < 0xDC00 && m_end - m_cur >= 6 && m_cur[0] == '\\' && m_cur[1] == 'u')
+			{
+				m_cur += 2;
+				uint32_t low;
+				RETURN_FALSE_IF_FALSE(ReadHex4(low));
+				if (low < 0xDC00 || low >= 0xE000)
+					return Fail("Invalid surrogate pair");
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+			}
+			AppendUtf8(p_value, codePoint);
+			return true;
+		}
+		}
+		return Fail("Invalid escape");
+	}
+};
+
+// 6 bit value of a base64 character, 0xFF for any other
+static const unsigned char* GetBase64Table()
+{
+	static const struct Table
+	{
+		unsigned char						values[256];
+
+		Table()
+		{
+			memset(values, 0xFF, sizeof(values));
+			const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			for (unsigned char i = 0; i < 64; i++)
+				values[(unsigned char)alphabet[i]] = i;
+		}
+	} table;
+	return table.values;
+}
+
+bool DecodeBase64(const char* p_src, size_t p_size, std::vector<unsigned char>& p_out)
+{
+	while (p_size > 0 && p_src[p_size - 1] == '=')
+		p_size--;
+	if (p_size % 4 == 1)
+		return false;
+
+	p_out.resize(p_size / 4 * 3 + (p_size % 4 == 0 ? 0 : p_size % 4 - 1));
+	unsigned char* out = p_out.data();
+	size_t i = 0;
+
+#if GLTF_PARSER_SSE2
+	// 16 characters to 12 bytes: the ranges of the alphabet are told apart by compares, each shifted to its values,
+	// then pairs of 6 bits are merged to 12 and pairs of those to 24
+	const __m128i upperLow = _mm_set1_epi8('A' - 1), upperHigh = _mm_set1_epi8('Z' + 1);
+	const __m128i lowerLow = _mm_set1_epi8('a' - 1), lowerHigh = _mm_set1_epi8('z' + 1);
+	const __m128i digitLow = _mm_set1_epi8('0' - 1), digitHigh = _mm_set1_epi8('9' + 1);
+	const __m128i plus = _mm_set1_epi8('+'), slash = _mm_set1_epi8('/');
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	const __m128i mergePairs = _mm_set1_epi32(0x00011000);
+	for (; i + 16 <= p_size; i += 16)
+	{
+		__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src + i));
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chars, upperLow), _mm_cmplt_epi8(chars, upperHigh));
+		__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(chars, lowerLow), _mm_cmplt_epi8(chars, lowerHigh));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chars, digitLow), _mm_cmplt_epi8(chars, digitHigh));
+		__m128i isPlus = _mm_cmpeq_epi8(chars, plus);
+		__m128i isSlash = _mm_cmpeq_epi8(chars, slash);
+
+		__m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, isPlus), isSlash));
+		if (_mm_movemask_epi8(valid) != 0xFFFF)
+			return false;
+
+		__m128i shift = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)), _mm_and_si128(lower, _mm_set1_epi8(-71))),
+			_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(4)), _mm_or_si128(_mm_and_si128(isPlus, _mm_set1_epi8(19)), _mm_and_si128(isSlash, _mm_set1_epi8(16)))));
+		__m128i values = _mm_add_epi8(chars, shift);
+
+		// the first character of a pair is the low byte of its 16 bit lane
+		__m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, lowBytes), 6), _mm_srli_epi16(values, 8));
+		__m128i quads = _mm_madd_epi16(pairs, mergePairs);
+
+		uint32_t words[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(words), quads);
+		for (int w = 0; w < 4; w++)
+		{
+			*out++ = (unsigned char)(words[w] >> 16);
+			*out++ = (unsigned char)(words[w] >> 8);
+			*out++ = (unsigned char)words[w];
+		}
+	}
+#endif
+
+	const unsigned char* table = GetBase64Table();
+	uint32_t bits = 0;
+	uint32_t bitCount = 0;
+	for (; i < p_size; i++)
+	{
+		uint32_t value = table[(unsigned char)p_src[i]];
+		if (value == 0xFF)
+			return false;
+
+		bits = (bits << 6) | value;
+		bitCount += 6;
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			*out++ = (unsigned char)(bits >> bitCount);
+		}
+	}
+	return true;
+}
+
+// Bytes of a base64 data URI, false if the uri is not one
+static bool IsDataUri(const std::string& p_uri)
+{
+	return p_uri.compare(0, 5, "data:") == 0;
+}
+
+static bool DecodeDataUri(const std::string& p_uri, std::vector<unsigned char>& p_data)
+{
+	size_t comma = p_uri.find(',');
+	if (comma == std::string::npos || comma < 7 || p_uri.compare(comma - 7, 7, ";base64") != 0)
+		return false;
+	return DecodeBase64(p_uri.data() + comma + 1, p_uri.size() - comma - 1, p_data);
+}
+
+// External file names are URIs, their %XX escapes name the file's bytes
+static std::string DecodeUri(const std::string& p_uri)
+{
+	std::string path;
+	path.reserve(p_uri.size());
+	for (size_t i = 0; i < p_uri.size(); i++)
+	{
+		if (p_uri[i] == '%' && i + 2 < p_uri.size() && isxdigit((unsigned char)p_uri[i + 1]) && isxdigit((unsigned char)p_uri[i + 2]))
+		{
+			path += (char)std::stoi(p_uri.substr(i + 1, 2), nullptr, 16);
+			i += 2;
+			continue;
+		}
+		path += p_uri[i];
+	}
+	return path;
+}
+
+template <typename T>
+static bool ReadTextureInfo(CJsonReader& p_reader, T& p_info, tinygltf::Parameter& p_parameter, const char* p_factorName = nullptr, double* p_factor = nullptr)
+{
+	return p_reader.ReadObject([&](std::string_view p_key)
+	{
+		if (p_key == "index")
+		{
+			RETURN_FALSE_IF_FALSE(p_reader.ReadInt(p_info.index));
+			p_parameter.json_double_value["index"] = p_info.index;
+			return true;
+		}
+		if (p_key == "texCoord")
+		{
+			RETURN_FALSE_IF_FALSE(p_reader.ReadInt(p_info.texCoord));
+			p_parameter.json_double_value["texCoord"] = p_info.texCoord;
+			return true;
+		}
+		if (p_factor != nullptr && p_key == p_factorName)
+		{
+			RETURN_FALSE_IF_FALSE(p_reader.ReadDouble(*p_factor));
+			p_parameter.json_double_value[p_factorName] = *p_factor;
+			return true;
+		}
+		if (p_key == "extensions")
+			return p_reader.ReadExtensions(p_info.extensions);
+		return p_reader.Skip();
+	});
+}
+
+static void SetNumberParameter(tinygltf::ParameterMap& p_parameters, const char* p_name, double p_value)
+{
+	tinygltf::Parameter& parameter = p_parameters[p_name];
+	parameter.number_value = p_value;
+	parameter.has_number_value = true;
+}
+
+// The legacy values and additionalValues maps are filled as tinygltf fills them, LoadMaterials reads the textures there
+static bool ReadMaterial(CJsonReader& p_reader, tinygltf::Material& p_material)
+{
+	return p_reader.ReadObject([&](std::string_view p_key)
+	{
+		if (p_key == "name")
+			return p_reader.ReadString(p_material.name);
+		if (p_key == "pbrMetallicRoughness")
+		{
+			tinygltf::PbrMetallicRoughness& pbr = p_material.pbrMetallicRoughness;
+			return p_reader.ReadObject([&](std::string_view p_pbrKey)
+			{
+				if (p_pbrKey == "baseColorFactor")
+				{
+					RETURN_FALSE_IF_FALSE(p_reader.ReadDoubles(pbr.baseColorFactor));
+					p_material.values["baseColorFactor"].number_array = pbr.baseColorFactor;
+					return true;
+				}
+				if (p_pbrKey == "metallicFactor")
+				{
+					RETURN_FALSE_IF_FALSE(p_reader.ReadDouble(pbr.metallicFactor));
+					SetNumberParameter(p_material.values, "metallicFactor", pbr.metallicFactor);
+					return true;
+				}
+				if (p_pbrKey == "roughnessFactor")
+				{
+					RETURN_FALSE_IF_FALSE(p_reader.ReadDouble(pbr.roughnessFactor));
+					SetNumberParameter(p_material.values, "roughnessFactor", pbr.roughnessFactor);
+					return true;
+				}
+				if (p_pbrKey == "baseColorTexture")
+					return ReadTextureInfo(p_reader, pbr.baseColorTexture, p_material.values["baseColorTexture"]);
+				if (p_pbrKey == "metallicRoughnessTexture")
+					return ReadTextureInfo(p_reader, pbr.metallicRoughnessTexture, p_material.values["metallicRoughnessTexture"]);
+				if (p_pbrKey == "extensions")
+					return p_reader.ReadExtensions(pbr.extensions);
+				return p_reader.Skip();
+			});
+		}
+		if (p_key == "normalTexture")
+			return ReadTextureInfo(p_reader, p_material.normalTexture, p_material.additionalValues["normalTexture"], "scale", &p_material.normalTexture.scale);
+		if (p_key == "occlusionTexture")
+			return ReadTextureInfo(p_reader, p_material.occlusionTexture, p_material.additionalValues["occlusionTexture"], "strength", &p_material.occlusionTexture.strength);
+		if (p_key == "emissiveTexture")
+			return ReadTextureInfo(p_reader, p_material.emissiveTexture, p_material.additionalValues["emissiveTexture"]);
+		if (p_key == "emissiveFactor")
+		{
+			RETURN_FALSE_IF_FALSE(p_reader.ReadDoubles(p_material.emissiveFactor));
+			p_material.additionalValues["emissiveFactor"].number_array = p_material.emissiveFactor;
+			return true;
+		}
+		if (p_key == "alphaMode")
+		{
+			RETURN_FALSE_IF_FALSE(p_reader.ReadString(p_material.alphaMode));
+			p_material.additionalValues["alphaMode"].string_value = p_material.alphaMode;
+			return true;
+		}
+		if (p_key == "alphaCutoff")
+		{
+			RETURN_FALSE_IF_FALSE(p_reader.ReadDouble(p_material.alphaCutoff));
+			SetNumberParameter(p_material.additionalValues, "alphaCutoff", p_material.alphaCutoff);
+			return true;
+		}
+		if (p_key == "doubleSided")
+		{
+			RETURN_FALSE_IF_FALSE(p_reader.ReadBool(p_material.doubleSided));
+			p_material.additionalValues["doubleSided"].bool_value = p_material.doubleSided;
+			return true;
+		}
+		if (p_key == "extensions")
+			return p_reader.ReadExtensions(p_material.extensions);
+		return p_reader.Skip();
+	});
+}
+
+static bool ReadAccessor(CJsonReader& p_reader, tinygltf::Accessor& p_accessor)
+{
+	return p_reader.ReadObject([&](std::string_view p_key)
+	{
+		if (p_key == "bufferView")
+			return p_reader.ReadInt(p_accessor.bufferView);
+		if (p_key == "byteOffset")
+			return p_reader.ReadSize(p_accessor.byteOffset);
+		if (p_key == "componentType")
+			return p_reader.ReadInt(p_accessor.componentType);
+		if (p_key == "normalized")
+			return p_reader.ReadBool(p_accessor.normalized);
+		if (p_key == "count")
+			return p_reader.ReadSize(p_accessor.count);
+		if (p_key == "min")
+			return p_reader.ReadDoubles(p_accessor.minValues);
+		if (p_key == "max")
+			return p_reader.ReadDoubles(p_accessor.maxValues);
+		if (p_key == "name")
+			return p_reader.ReadString(p_accessor.name);
+		if (p_key == "extensions")
+			return p_reader.ReadExtensions(p_accessor.extensions);
+		if (p_key == "type")
+		{
+			std::string type;
+			RETURN_FALSE_IF_FALSE(p_reader.ReadString(type));
+			p_accessor.type = (type == "SCALAR") ? TINYGLTF_TYPE_SCALAR : (type == "VEC2") ? TINYGLTF_TYPE_VEC2 : (type == "VEC3") ? TINYGLTF_TYPE_VEC3 :
+				(type == "VEC4") ? TINYGLTF_TYPE_VEC4 : (type == "MAT2") ? TINYGLTF_TYPE_MAT2 : (type == "MAT3") ? TINYGLTF_TYPE_MAT3 :
+				(type == "MAT4") ? TINYGLTF_TYPE_MAT4 : -1;
+			return (p_accessor.type != -1) || p_reader.Fail("Unknown accessor type");
+		}
+		if (p_key == "sparse")
+		{
+			auto& sparse = p_accessor.sparse;
+			sparse.isSparse = true;
+			return p_reader.ReadObject([&](std::string_view p_sparseKey)
+			{
+				if (p_sparseKey == "count")
+					return p_reader.ReadInt(sparse.count);
+				if (p_sparseKey == "indices")
+				{
+					return p_reader.ReadObject([&](std::string_view p_indicesKey)
+					{
+						size_t byteOffset = 0;
+						if (p_indicesKey == "bufferView")
+							return p_reader.ReadInt(sparse.indices.bufferView);
+						if (p_indicesKey == "componentType")
+							return p_reader.ReadInt(sparse.indices.componentType);
+						if (p_indicesKey != "byteOffset")
+							return p_reader.Skip();
+						RETURN_FALSE_IF_FALSE(p_reader.ReadSize(byteOffset));
+						sparse.indices.byteOffset = byteOffset;
+						return true;
+					});
+				}
+				if (p_sparseKey == "values")
+				{
+					return p_reader.ReadObject([&](std::string_view p_valuesKey)
+					{
+						size_t byteOffset = 0;
+						if (p_valuesKey == "bufferView")
+							return p_reader.ReadInt(sparse.values.bufferView);
+						if (p_valuesKey != "byteOffset")
+							return p_reader.Skip();
+						RETURN_FALSE_IF_FALSE(p_reader.ReadSize(byteOffset));
+						sparse.values.byteOffset = byteOffset;
+						return true;
+					});
+				}
+				return p_reader.Skip();
+			});
+		}
+		return p_reader.Skip();
+	});
+}
+
+static bool ReadMesh(CJsonReader& p_reader, tinygltf::Mesh& p_mesh)
+{
+	return p_reader.ReadObject([&](std::string_view p_key)
+	{
+		if (p_key == "name")
+			return p_reader.ReadString(p_mesh.name);
+		if (p_key == "weights")
+			return p_reader.ReadDoubles(p_mesh.weights);
+		if (p_key == "extensions")
+			return p_reader.ReadExtensions(p_mesh.extensions);
+		if (p_key != "primitives")
+			return p_reader.Skip();
+
+		return p_reader.ReadArray([&](size_t)
+		{
+			p_mesh.primitives.emplace_back();
+			tinygltf::Primitive& primitive = p_mesh.primitives.back();
+			return p_reader.ReadObject([&](std::string_view p_primitiveKey)
+			{
+				if (p_primitiveKey == "indices")
+					return p_reader.ReadInt(primitive.indices);
+				if (p_primitiveKey == "material")
+					return p_reader.ReadInt(primitive.material);
+				if (p_primitiveKey == "mode")
+					return p_reader.ReadInt(primitive.mode);
+				if (p_primitiveKey == "extensions")
+					return p_reader.ReadExtensions(primitive.extensions);
+				if (p_primitiveKey != "attributes")
+					return p_reader.Skip();
+
+				return p_reader.ReadObject([&](std::string_view p_attribute)
+				{
+					return p_reader.ReadInt(primitive.attributes[std::string(p_attribute)]);
+				});
+			});
+		});
+	});
+}
+
+static bool ReadNode(CJsonReader& p_reader, tinygltf::Node& p_node)
+{
+	return p_reader.ReadObject([&](std::string_view p_key)
+	{
+		if (p_key == "name")
+			return p_reader.ReadString(p_node.name);
+		if (p_key == "mesh")
+			return p_reader.ReadInt(p_node.mesh);
+		if (p_key == "children")
+			return p_reader.ReadInts(p_node.children);
+		if (p_key == "matrix")
+			return p_reader.ReadDoubles(p_node.matrix);
+		if (p_key == "translation")
+			return p_reader.ReadDoubles(p_node.translation);
+		if (p_key == "rotation")
+			return p_reader.ReadDoubles(p_node.rotation);
+		if (p_key == "scale")
+			return p_reader.ReadDoubles(p_node.scale);
+		if (p_key == "skin")
+			return p_reader.ReadInt(p_node.skin);
+		if (p_key == "camera")
+			return p_reader.ReadInt(p_node.camera);
+		if (p_key == "extensions")
+			return p_reader.ReadExtensions(p_node.extensions);
+		return p_reader.Skip();
+	});
+}
+
+// Reads the elements of a top level array into p_list, one ReadElement per element
+template <typename T, typename F>
+static bool ReadList(CJsonReader& p_reader, std::vector<T>& p_list, F&& p_readElement)
+{
+	return p_reader.ReadArray([&](size_t)
+	{
+		p_list.emplace_back();
+		return p_readElement(p_list.back());
+	});
+}
+
+// tinygltf::Buffer has no byte length of its own, it is returned in p_byteLengths
+static bool ReadModel(CJsonReader& p_reader, tinygltf::Model& p_model, std::vector<size_t>& p_byteLengths)
+{
+	return p_reader.ReadObject([&](std::string_view p_key)
+	{
+		if (p_key == "accessors")
+			return ReadList(p_reader, p_model.accessors, [&](tinygltf::Accessor& p_accessor) { return ReadAccessor(p_reader, p_accessor); });
+		if (p_key == "meshes")
+			return ReadList(p_reader, p_model.meshes, [&](tinygltf::Mesh& p_mesh) { return ReadMesh(p_reader, p_mesh); });
+		if (p_key == "nodes")
+			return ReadList(p_reader, p_model.nodes, [&](tinygltf::Node& p_node) { return ReadNode(p_reader, p_node); });
+		if (p_key == "materials")
+			return ReadList(p_reader, p_model.materials, [&](tinygltf::Material& p_material) { return ReadMaterial(p_reader, p_material); });
+		if (p_key == "scene")
+			return p_reader.ReadInt(p_model.defaultScene);
+		if (p_key == "extensionsUsed")
+			return p_reader.ReadStrings(p_model.extensionsUsed);
+		if (p_key == "extensionsRequired")
+			return p_reader.ReadStrings(p_model.extensionsRequired);
+		if (p_key == "extensions")
+			return p_reader.ReadExtensions(p_model.extensions);
+
+		if (p_key == "asset")
+		{
+			return p_reader.ReadObject([&](std::string_view p_assetKey)
+			{
+				if (p_assetKey == "version")
+					return p_reader.ReadString(p_model.asset.version);
+				if (p_assetKey == "generator")
+					return p_reader.ReadString(p_model.asset.generator);
+				if (p_assetKey == "minVersion")
+					return p_reader.ReadString(p_model.asset.minVersion);
+				if (p_assetKey == "copyright")
+					return p_reader.ReadString(p_model.asset.copyright);
+				return p_reader.Skip();
+			});
+		}
+
+		if (p_key == "scenes")
+		{
+			return ReadList(p_reader, p_model.scenes, [&](tinygltf::Scene& p_scene)
+			{
+				return p_reader.ReadObject([&](std::string_view p_sceneKey)
+				{
+					if (p_sceneKey == "name")
+						return p_reader.ReadString(p_scene.name);
+					if (p_sceneKey == "nodes")
+						return p_reader.ReadInts(p_scene.nodes);
+					return p_reader.Skip();
+				});
+			});
+		}
+
+		if (p_key == "buffers")
+		{
+			return ReadList(p_reader, p_model.buffers, [&](tinygltf::Buffer& p_buffer)
+			{
+				p_byteLengths.push_back(0);
+				return p_reader.ReadObject([&](std::string_view p_bufferKey)
+				{
+					if (p_bufferKey == "uri")
+						return p_reader.ReadString(p_buffer.uri);
+					if (p_bufferKey == "name")
+						return p_reader.ReadString(p_buffer.name);
+					if (p_bufferKey == "extensions")
+						return p_reader.ReadExtensions(p_buffer.extensions);
+					if (p_bufferKey != "byteLength")
+						return p_reader.Skip();
+
+					return p_reader.ReadSize(p_byteLengths.back());
+				});
+			});
+		}
+
+		if (p_key == "bufferViews")
+		{
+			return ReadList(p_reader, p_model.bufferViews, [&](tinygltf::BufferView& p_view)
+			{
+				return p_reader.ReadObject([&](std::string_view p_viewKey)
+				{
+					if (p_viewKey == "buffer")
+						return p_reader.ReadInt(p_view.buffer);
+					if (p_viewKey == "byteOffset")
+						return p_reader.ReadSize(p_view.byteOffset);
+					if (p_viewKey == "byteLength")
+						return p_reader.ReadSize(p_view.byteLength);
+					if (p_viewKey == "byteStride")
+						return p_reader.ReadSize(p_view.byteStride);
+					if (p_viewKey == "target")
+						return p_reader.ReadInt(p_view.target);
+					if (p_viewKey == "name")
+						return p_reader.ReadString(p_view.name);
+					if (p_viewKey == "extensions")
+						return p_reader.ReadExtensions(p_view.extensions);
+					return p_reader.Skip();
+				});
+			});
+		}
+
+		if (p_key == "textures")
+		{
+			return ReadList(p_reader, p_model.textures, [&](tinygltf::Texture& p_texture)
+			{
+				return p_reader.ReadObject([&](std::string_view p_textureKey)
+				{
+					if (p_textureKey == "source")
+						return p_reader.ReadInt(p_texture.source);
+					if (p_textureKey == "sampler")
+						return p_reader.ReadInt(p_texture.sampler);
+					if (p_textureKey == "name")
+						return p_reader.ReadString(p_texture.name);
+					if (p_textureKey == "extensions")
+						return p_reader.ReadExtensions(p_texture.extensions);
+					return p_reader.Skip();
+				});
+			});
+		}
+
+		if (p_key == "images")
+		{
+			return ReadList(p_reader, p_model.images, [&](tinygltf::Image& p_image)
+			{
+				return p_reader.ReadObject([&](std::string_view p_imageKey)
+				{
+					if (p_imageKey == "uri")
+						return p_reader.ReadString(p_image.uri);
+					if (p_imageKey == "bufferView")
+						return p_reader.ReadInt(p_image.bufferView);
+					if (p_imageKey == "mimeType")
+						return p_reader.ReadString(p_image.mimeType);
+					if (p_imageKey == "name")
+						return p_reader.ReadString(p_image.name);
+					if (p_imageKey == "extensions")
+						return p_reader.ReadExtensions(p_image.extensions);
+					return p_reader.Skip();
+				});
+			});
+		}
+
+		if (p_key == "samplers")
+		{
+			return ReadList(p_reader, p_model.samplers, [&](tinygltf::Sampler& p_sampler)
+			{
+				return p_reader.ReadObject([&](std::string_view p_samplerKey)
+				{
+					if (p_samplerKey == "magFilter")
+						return p_reader.ReadInt(p_sampler.magFilter);
+					if (p_samplerKey == "minFilter")
+						return p_reader.ReadInt(p_sampler.minFilter);
+					if (p_samplerKey == "wrapS")
+						return p_reader.ReadInt(p_sampler.wrapS);
+					if (p_samplerKey == "wrapT")
+						return p_reader.ReadInt(p_sampler.wrapT);
+					if (p_samplerKey == "name")
+						return p_reader.ReadString(p_sampler.name);
+					return p_reader.Skip();
+				});
+			});
+		}
+
+		return p_reader.Skip();
+	});
+}
+
+// Fills in the data of every buffer: data URIs are decoded, external files read together, the first buffer of a
+// .glb without a uri is its binary chunk
+static bool LoadBuffers(tinygltf::Model& p_model, const std::vector<size_t>& p_byteLengths, const std::string& p_folder, const unsigned char* p_bin,
+	size_t p_binSize, std::string& p_error)
+{
+	std::vector<size_t> externalBuffers;
+	std::vector<std::string> externalPaths;
+	for (size_t i = 0; i < p_model.buffers.size(); i++)
+	{
+		tinygltf::Buffer& buffer = p_model.buffers[i];
+		if (IsDataUri(buffer.uri))
+		{
+			if (!DecodeDataUri(buffer.uri, buffer.data))
+			{
+				p_error = "Invalid data URI of buffer " + std::to_string(i);
+				return false;
+			}
+		}
+		else if (!buffer.uri.empty())
+		{
+			externalBuffers.push_back(i);
+			externalPaths.push_back(p_folder + "/" + DecodeUri(buffer.uri));
+		}
+		else if (i == 0 && p_bin != nullptr)
+		{
+			buffer.data.assign(p_bin, p_bin + p_binSize);
+		}
+		else if (buffer.extensions.count("EXT_meshopt_compression") == 0)
+		{
+			p_error = "Buffer " + std::to_string(i) + " has no data";
+			return false;
+		}
+	}
+
+	std::vector<CFileView> externalFiles;
+	if (!ReadFiles(externalPaths, externalFiles))
+	{
+		p_error = "Failed to read the external buffers";
+		return false;
+	}
+
+	for (size_t i = 0; i < externalBuffers.size(); i++)
+	{
+		const CFileView& file = externalFiles[i];
+		p_model.buffers[externalBuffers[i]].data.assign(file.GetData(), file.GetData() + file.GetSize());
+	}
+
+	// A buffer holding more than its byteLength is cut to it, the binary chunk is padded
+	for (size_t i = 0; i < p_model.buffers.size(); i++)
+	{
+		tinygltf::Buffer& buffer = p_model.buffers[i];
+		size_t byteLength = p_byteLengths[i];
+
+		if (buffer.data.empty() && buffer.uri.empty() && buffer.extensions.count("EXT_meshopt_compression") > 0)
+			continue;
+
+		if (buffer.data.size() < byteLength)
+		{
+			p_error = "Buffer " + std::to_string(i) + " holds " + std::to_string(buffer.data.size()) + " bytes of " + std::to_string(byteLength);
+			return false;
+		}
+		buffer.data.resize(byteLength);
+	}
+
+	return true;
+}
+
+// Images in a buffer view or a data URI go to the loader, those in files of their own are left as their uri
+static bool LoadImages(tinygltf::Model& p_model, GltfImageLoader p_imageLoader, void* p_imageUserData, std::string& p_error)
+{
+	std::vector<unsigned char> decoded;
+	for (size_t i = 0; i < p_model.images.size(); i++)
+	{
+		tinygltf::Image& image = p_model.images[i];
+		const unsigned char* bytes = nullptr;
+		size_t size = 0;
+
+		if (image.bufferView >= 0)
+		{
+			if (image.bufferView >= (int)p_model.bufferViews.size())
+			{
+				p_error = "Invalid buffer view of image " + std::to_string(i);
+				return false;
+			}
+
+			const tinygltf::BufferView& view = p_model.bufferViews[image.bufferView];
+			if (view.buffer < 0 || view.buffer >= (int)p_model.buffers.size() || view.byteOffset + view.byteLength > p_model.buffers[view.buffer].data.size())
+			{
+				p_error = "Image " + std::to_string(i) + " reaches out of its buffer";
+				return false;
+			}
+			bytes = p_model.buffers[view.buffer].data.data() + view.byteOffset;
+			size = view.byteLength;
+		}
+		else if (IsDataUri(image.uri))
+		{
+			if (!DecodeDataUri(image.uri, decoded))
+			{
+				p_error = "Invalid data URI of image " + std::to_string(i);
+				return false;
+			}
+			image.uri.clear();
+			bytes = decoded.data();
+			size = decoded.size();
+		}
+		else
+		{
+			continue;
+		}
+
+		std::string warning;
+		if (p_imageLoader != nullptr && !p_imageLoader(&image, (int)i, &p_error, &warning, 0, 0, bytes, (int)size, p_imageUserData))
+			return false;
+	}
+
+	return true;
+}
+
+bool ParseGltf(const unsigned char* p_data, size_t p_size, const std::string& p_folder, GltfImageLoader p_imageLoader, void* p_imageUserData,
+	tinygltf::Model& p_model, std::string& p_error)
+{
+	PROFILE_FUNCTION();
+
+	p_model = tinygltf::Model();
+	const char* json = reinterpret_cast<const char*>(p_data);
+	size_t jsonSize = p_size;
+	const unsigned char* bin = nullptr;
+	size_t binSize = 0;
+
+	// A .glb is a header, the JSON chunk and an optional binary chunk
+	uint32_t header[5] = {};
+	if (p_size >= sizeof(header))
+		memcpy(header, p_data, sizeof(header));
+	if (p_size >= sizeof(header) && header[0] == GLB_MAGIC)
+	{
+		if (header[1] != 2 || header[2] > p_size || header[4] != GLB_CHUNK_JSON || header[3] > p_size - sizeof(header))
+		{
+			p_error = "Invalid .glb header";
+			return false;
+		}
+
+		json = reinterpret_cast<const char*>(p_data + sizeof(header));
+		jsonSize = header[3];
+
+		size_t binChunk = sizeof(header) + ((jsonSize + 3) & ~(size_t)3);
+		uint32_t binHeader[2] = {};
+		if (binChunk + sizeof(binHeader) <= header[2])
+		{
+			memcpy(binHeader, p_data + binChunk, sizeof(binHeader));
+			if (binHeader[1] == GLB_CHUNK_BIN && binHeader[0] <= header[2] - binChunk - sizeof(binHeader))
+			{
+				bin = p_data + binChunk + sizeof(binHeader);
+				binSize = binHeader[0];
+			}
+		}
+	}
+
+	CJsonReader reader(json, jsonSize);
+	std::vector<size_t> byteLengths;
+	if (!ReadModel(reader, p_model, byteLengths))
+	{
+		p_error = reader.GetError();
+		return false;
+	}
+
+	RETURN_FALSE_IF_FALSE(LoadBuffers(p_model, byteLengths, p_folder, bin, binSize, p_error));
+	RETURN_FALSE_IF_FALSE(LoadImages(p_model, p_imageLoader, p_imageUserData, p_error));
+	return true;
+}
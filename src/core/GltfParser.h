@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace tinygltf
+{
+	class Model;
+	struct Image;
+}
+
+// How LoadGltf parses the JSON of .gltf and .glb files
+enum GltfParser
+{
+	  gp_tinygltf					= 0		// tinygltf's DOM parser, every part of the format
+	, gp_streaming							// ParseGltf, the parts the importer reads
+};
+
+// Process wide
+void SetGltfParser(GltfParser p_parser);
+GltfParser GetGltfParser();
+
+// Signature of tinygltf::LoadImageDataFunction, called for the images embedded in a buffer view or a data URI
+typedef bool (*GltfImageLoader)(tinygltf::Image* p_image, const int p_imageIndex, std::string* p_error, std::string* p_warning,
+	int p_reqWidth, int p_reqHeight, const unsigned char* p_bytes, int p_size, void* p_userData);
+
+// Parses a .gltf or .glb file to the tinygltf model in a single pass over the JSON, without building a DOM. Strings
+// and skipped values are scanned 16 bytes at a time with SSE2 and data URIs are base64 decoded the same way; the
+// external buffers are read together through the file backend. Fills the asset, scenes, nodes, meshes, accessors,
+// buffer views, buffers, materials, textures, images and samplers, with the extensions of each; animations, skins
+// and cameras are skipped. Like tinygltf with TINYGLTF_NO_EXTERNAL_IMAGE, images in files of their own are left to the
+// caller. A buffer without a uri that only stands in for EXT_meshopt_compression data is left empty
+bool ParseGltf(const unsigned char* p_data, size_t p_size, const std::string& p_folder, GltfImageLoader p_imageLoader, void* p_imageUserData,
+	tinygltf::Model& p_model, std::string& p_error);
+
+// Decodes standard base64, with or without padding; false on any other character
+bool DecodeBase64(const char* p_src, size_t p_size, std::vector<unsigned char>& p_out);
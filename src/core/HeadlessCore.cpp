@@ -0,0 +1,83 @@
+#include "HeadlessCore.h"
+#include "external/imgui/imgui.h"
+
+CHeadlessCore::WindowData CHeadlessCore::s_Window = CHeadlessCore::WindowData{};
+
+CHeadlessCore::CHeadlessCore(const char* name, int screen_width_, int screen_height_, int window_scale)
+    : m_active(false)
+    , m_failed(false)
+    , m_fixedDelta(1.0f / 60.0f)
+{
+    CHeadlessCore::s_Window.title = name;
+    CHeadlessCore::s_Window.handle = NULL;
+    CHeadlessCore::s_Window.screenWidth = screen_width_;
+    CHeadlessCore::s_Window.screenHeight = screen_height_;
+    CHeadlessCore::s_Window.windowWidth = screen_width_ * window_scale;
+    CHeadlessCore::s_Window.windowHeight = screen_height_ * window_scale;
+    CHeadlessCore::s_Window.swapchainID = 0;
+    CHeadlessCore::s_Window.inFocus = false;
+}
+
+bool CHeadlessCore::initialize()
+{
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+
+    // there is no platform backend to fill these in every frame
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)CHeadlessCore::s_Window.screenWidth, (float)CHeadlessCore::s_Window.screenHeight);
+    io.IniFilename = nullptr;
+
+    return true;
+}
+
+bool CHeadlessCore::run(HINSTANCE p_instance)
+{
+    if (!on_create(p_instance))
+    {
+        shutdown();
+        return false;
+    }
+
+    // the mouse rests in the center of the screen, without any buttons held
+    cur_mouse_pos[0] = prev_mouse_pos[0] = CHeadlessCore::s_Window.screenWidth / 2;
+    cur_mouse_pos[1] = prev_mouse_pos[1] = CHeadlessCore::s_Window.screenHeight / 2;
+
+    m_active = true;
+    while (m_active)
+    {
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2((float)CHeadlessCore::s_Window.screenWidth, (float)CHeadlessCore::s_Window.screenHeight);
+        io.DeltaTime = m_fixedDelta;
+
+        // a failed frame may not have signaled what the present waits on
+        if (!on_update(m_fixedDelta))
+        {
+            m_failed = true;
+            break;
+        }
+
+        CHeadlessCore::s_Window.swapchainID ^= 1;
+        on_present();
+    }
+
+    on_destroy();
+    shutdown();
+
+    return !m_failed;
+}
+
+void CHeadlessCore::quit()
+{
+    m_active = false;
+}
+
+void CHeadlessCore::GetCurrentMousePosition(int& x, int& y)
+{
+    x = cur_mouse_pos[0]; y = cur_mouse_pos[1];
+}
+
+void CHeadlessCore::shutdown()
+{
+    ImGui::DestroyContext();
+}
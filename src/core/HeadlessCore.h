@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Global.h"
+
+#include <chrono>
+#include <string>
+#include <iostream>
+
+#define LEFT_MOUSE_BUTTON       1
+#define RIGHT_MOUSE_BUTTON      2
+#define MIDDLE_MOUSE_BUTTON     4
+
+// Stand-in for CWinCore without a window, for benchmarking on machines without a display. It offers the
+// same interface to the renderer, but there is no input and every frame advances by a fixed time step,
+// so two runs of the same scene render the same frames. The loop runs until quit() is called
+class CHeadlessCore
+{
+protected:
+    struct WindowData
+    {
+        const char* title;
+
+        HWND handle;                // always null
+        bool inFocus;
+
+        int screenWidth;
+        int screenHeight;
+        int windowWidth;
+        int windowHeight;
+
+        int swapchainID;
+    };
+    static WindowData s_Window;
+
+public:
+    virtual ~CHeadlessCore() = default;
+    virtual bool on_create(HINSTANCE = NULL) = 0;
+    virtual void on_destroy() = 0;
+    virtual bool on_update(float delta) = 0;
+    virtual void on_present() = 0;
+
+    CHeadlessCore(const char* name, int screen_width_ = 320, int screen_height_ = 240, int window_scale = 1);
+
+    bool initialize();
+    bool run(HINSTANCE p_instance = NULL);
+    void quit();
+
+    void GetCurrentMousePosition(int& x, int& y);
+
+    void SetFixedDelta(float p_delta) { m_fixedDelta = p_delta; }
+
+protected:
+    struct KeyState
+    {
+        bool pressed;
+        bool released;
+        bool down;
+    };
+
+    KeyState m_keys[256] = {};
+    int prev_mouse_pos[2] = {0,0};
+    int mouse_delta[2] = {};
+    int cur_mouse_pos[2] = { -1, -1 };
+
+private:
+    bool m_active;
+    bool m_failed;
+    float m_fixedDelta;
+
+    void shutdown();
+};
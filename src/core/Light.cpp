@@ -248,7 +248,10 @@ void CLights::Update(const CCamera::UpdateData& p_updateData, const CSceneGraph*
 				static_cast<CDirectionaLight*>(light)->GetDirection() :
 				static_cast<CPointLight*>(light)->GetPosition();
 
+			nm::float3 color = light->GetColor();
+			m_rawGPUData[i].type_castShadow = ((uint32_t)light->GetType() << 16) | (uint32_t)(light->IsCastsShadow());
 			m_rawGPUData[i].intensity = light->GetIntensity();
+			std::copy(std::begin(color.data), std::end(color.data), std::begin(m_rawGPUData[i].color));
 			std::copy(std::begin(vector3.data), std::end(vector3.data), std::begin(m_rawGPUData[i].vector3));
 
 			if (light->IsCastsShadow())
@@ -315,3 +318,29 @@ void CLights::DestroyLights()
 	m_lights.clear();
 	m_rawGPUData.clear();
 }
+
+void CLights::ApplyLight(CLight::Type p_type, const char* p_name, bool p_castShadow, nm::float3 p_color, nm::Transform p_transform)
+{
+	CLight* light = nullptr;
+	for (auto& existing : m_lights)
+	{
+		if (existing->GetType() == p_type && existing->GetBaseName() == p_name)
+		{
+			light = existing;
+			break;
+		}
+	}
+
+	// the direction or position and the intensity follow from the transform on the next update, as for an edited light
+	if (!light)
+	{
+		CreateLight(p_type, p_name, p_castShadow, p_color, p_transform.GetScaleVector()[0], p_transform.GetTranslateVector());
+		light = m_lights.back();
+	}
+
+	light->SetColor(p_color);
+	light->SetCastShadow(p_castShadow);
+	light->SetTransform(nullptr, p_transform);
+	m_isDirty = true;
+}
+
@@ -66,6 +66,10 @@ public:
 	bool IsCastsShadow() { return m_castShadow; }
 	nm::float3 GetColor() { return m_color; }
 	float GetIntensity() { return m_intensity; }
+	std::string GetBaseName() { return m_name.substr(0, m_name.rfind('_')); }	// as created, without the entity id
+
+	void SetColor(nm::float3 p_color) { m_color = p_color; m_dirty = true; }
+	void SetCastShadow(bool p_castShadow) { m_castShadow = p_castShadow; m_dirty = true; }
 
 	void SetId(uint32_t id) { m_id = id; }
 	uint32_t GetId() { return m_id; }
@@ -137,6 +141,11 @@ public:
 	void CreateLight(CLight::Type p_type, const char* p_name, bool p_castShadow, nm::float3 p_color, float p_intensity, nm::float3 p_position);
 	void DestroyLights();
 
+	// Sets the light of that type and name, created if there is none. Lights are never removed, the scene graph
+	// keeps every entity for the lifetime of the scene
+	void ApplyLight(CLight::Type p_type, const char* p_name, bool p_castShadow, nm::float3 p_color, nm::Transform p_transform);
+	const std::vector<CLight*>& GetLights() const { return m_lights; }
+
 	bool IsDirty() { return m_isDirty; }
 	void SetDirty(bool pDirty) { m_isDirty = pDirty; }
 	std::vector<LightGPUData> GetLightsGPUData() { return m_rawGPUData; }
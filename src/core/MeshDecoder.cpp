@@ -0,0 +1,1119 @@
+#include "MeshDecoder.h"
+#include "Global.h"
+#include "Profiler.h"
+
+#include "external/tinygltf/tiny_gltf.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#if GLTF_DRACO_DECODING
+#include <draco/compression/decode.h>
+#endif
+
+// Accessors of quantized components are converted four floats at a time with SSE2, part of every x64 target
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ACCESSOR_SSE2					1
+#include <emmintrin.h>
+#else
+#define ACCESSOR_SSE2					0
+#endif
+
+#define MESHOPT_VERTEX_HEADER				0xa0	// version 0 of the vertex codec, the one the extension specifies
+#define MESHOPT_INDEX_HEADER				0xe0
+#define MESHOPT_SEQUENCE_HEADER				0xd0
+#define MESHOPT_BYTE_GROUP_SIZE				16		// bytes packed together by the vertex codec
+#define MESHOPT_VERTEX_BLOCK_BYTES			8192	// of vertex data per block, at most 256 vertices
+#define MESHOPT_VERTEX_BLOCK_MAX_SIZE		256
+#define MESHOPT_VERTEX_TAIL_MIN_SIZE		32		// the first vertex ends the stream, padded to this
+#define MESHOPT_INDEX_CODE_TABLE_SIZE		16		// ends a triangle stream
+
+// One byte of every element of a block, in groups of 16 each packed in 0, 2, 4 or 8 bits as the 2 bit header of the
+// group says. A packed value at the maximum of its width is an escape for a whole byte stored after the packed bits
+static const unsigned char* DecodeMeshoptBytes(const unsigned char* p_data, const unsigned char* p_end, unsigned char* p_bytes, size_t p_count)
+{
+	size_t groupCount = p_count / MESHOPT_BYTE_GROUP_SIZE;
+	size_t headerSize = (groupCount + 3) / 4;
+	if ((size_t)(p_end - p_data) < headerSize)
+		return nullptr;
+
+	const unsigned char* header = p_data;
+	p_data += headerSize;
+
+	for (size_t group = 0; group < groupCount; group++)
+	{
+		unsigned char* bytes = p_bytes + group * MESHOPT_BYTE_GROUP_SIZE;
+		uint32_t bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+		if (bitsLog2 == 0)
+		{
+			memset(bytes, 0, MESHOPT_BYTE_GROUP_SIZE);
+			continue;
+		}
+
+		if (bitsLog2 == 3)
+		{
+			if ((size_t)(p_end - p_data) < MESHOPT_BYTE_GROUP_SIZE)
+				return nullptr;
+			memcpy(bytes, p_data, MESHOPT_BYTE_GROUP_SIZE);
+			p_data += MESHOPT_BYTE_GROUP_SIZE;
+			continue;
+		}
+
+		uint32_t bits = 1u << bitsLog2;
+		uint32_t escape = (1u << bits) - 1;
+		size_t packedSize = MESHOPT_BYTE_GROUP_SIZE * bits / 8;
+		if ((size_t)(p_end - p_data) < packedSize)
+			return nullptr;
+
+		// values are packed from the high bits of each byte down
+		const unsigned char* escapes = p_data + packedSize;
+		for (uint32_t i = 0; i < MESHOPT_BYTE_GROUP_SIZE; i++)
+		{
+			uint32_t value = (p_data[i * bits / 8] >> (8 - bits - (i * bits) % 8)) & escape;
+			if (value == escape)
+			{
+				if (escapes == p_end)
+					return nullptr;
+				value = *escapes++;
+			}
+			bytes[i] = (unsigned char)value;
+		}
+		p_data = escapes;
+	}
+
+	return p_data;
+}
+
+// Every byte of an element is the zigzag encoded delta to the same byte of the element before it, a byte at a time
+// over the elements of a block; the first element of the buffer is stored at the very end
+static bool DecodeMeshoptVertices(unsigned char* p_dst, size_t p_count, size_t p_stride, const unsigned char* p_src, size_t p_srcSize)
+{
+	if (p_stride == 0 || p_stride > MESHOPT_VERTEX_BLOCK_MAX_SIZE || p_stride % 4 != 0)
+		return false;
+
+	size_t tailSize = (std::max)(p_stride, (size_t)MESHOPT_VERTEX_TAIL_MIN_SIZE);
+	if (p_srcSize < 1 + tailSize || p_src[0] != MESHOPT_VERTEX_HEADER)
+		return false;
+
+	const unsigned char* data = p_src + 1;
+	const unsigned char* dataEnd = p_src + p_srcSize - tailSize;
+
+	unsigned char last[MESHOPT_VERTEX_BLOCK_MAX_SIZE];
+	memcpy(last, p_src + p_srcSize - p_stride, p_stride);
+
+	size_t blockSize = (std::min)((MESHOPT_VERTEX_BLOCK_BYTES / p_stride) & ~(size_t)(MESHOPT_BYTE_GROUP_SIZE - 1), (size_t)MESHOPT_VERTEX_BLOCK_MAX_SIZE);
+	unsigned char deltas[MESHOPT_VERTEX_BLOCK_MAX_SIZE];
+
+	for (size_t first = 0; first < p_count; first += blockSize)
+	{
+		size_t count = (std::min)(blockSize, p_count - first);
+		size_t groupedCount = (count + MESHOPT_BYTE_GROUP_SIZE - 1) & ~(size_t)(MESHOPT_BYTE_GROUP_SIZE - 1);
+		unsigned char* block = p_dst + first * p_stride;
+
+		for (size_t k = 0; k < p_stride; k++)
+		{
+			data = DecodeMeshoptBytes(data, dataEnd, deltas, groupedCount);
+			if (data == nullptr)
+				return false;
+
+			unsigned char value = last[k];
+			for (size_t i = 0; i < count; i++)
+			{
+				unsigned char delta = deltas[i];
+				value += (unsigned char)((delta >> 1) ^ (0u - (delta & 1)));
+				block[i * p_stride + k] = value;
+			}
+			last[k] = value;
+		}
+	}
+
+	return data == dataEnd;
+}
+
+static uint32_t DecodeVByte(const unsigned char*& p_data)
+{
+	uint32_t lead = *p_data++;
+	if (lead < 128)
+		return lead;
+
+	uint32_t result = lead & 127;
+	uint32_t shift = 7;
+	for (int i = 0; i < 4; i++)
+	{
+		uint32_t group = *p_data++;
+		result |= (group & 127) << shift;
+		shift += 7;
+		if (group < 128)
+			break;
+	}
+	return result;
+}
+
+// Free indices are zigzag encoded deltas to the last free index
+static uint32_t DecodeFreeIndex(const unsigned char*& p_data, uint32_t p_last)
+{
+	uint32_t value = DecodeVByte(p_data);
+	return p_last + ((value >> 1) ^ (0u - (value & 1)));
+}
+
+static void WriteIndex(unsigned char* p_dst, size_t p_index, size_t p_stride, uint32_t p_value)
+{
+	if (p_stride == 2)
+	{
+		uint16_t value = (uint16_t)p_value;
+		memcpy(p_dst + p_index * 2, &value, 2);
+	}
+	else
+	{
+		memcpy(p_dst + p_index * 4, &p_value, 4);
+	}
+}
+
+// A code byte per triangle names its vertices from a FIFO of the recent edges and one of the recent vertices, or as
+// the next vertex not seen yet, or as a free index in the data after the codes. A 16 byte table of the most common
+// pairs of vertex codes ends the stream
+static bool DecodeMeshoptTriangles(unsigned char* p_dst, size_t p_count, size_t p_stride, const unsigned char* p_src, size_t p_srcSize)
+{
+	if ((p_stride != 2 && p_stride != 4) || p_count % 3 != 0)
+		return false;
+	if (p_srcSize < 1 + p_count / 3 + MESHOPT_INDEX_CODE_TABLE_SIZE || (p_src[0] & 0xf0) != MESHOPT_INDEX_HEADER)
+		return false;
+
+	uint32_t version = p_src[0] & 0x0f;
+	if (version > 1)
+		return false;
+
+	uint32_t edges[16][2];
+	uint32_t vertices[16];
+	memset(edges, -1, sizeof(edges));
+	memset(vertices, -1, sizeof(vertices));
+	uint32_t edgeOffset = 0;
+	uint32_t vertexOffset = 0;
+
+	auto pushEdge = [&](uint32_t p_a, uint32_t p_b)
+	{
+		edges[edgeOffset][0] = p_a;
+		edges[edgeOffset][1] = p_b;
+		edgeOffset = (edgeOffset + 1) & 15;
+	};
+	auto pushVertex = [&](uint32_t p_vertex, bool p_push)
+	{
+		vertices[vertexOffset] = p_vertex;
+		vertexOffset = (vertexOffset + (p_push ? 1 : 0)) & 15;
+	};
+
+	uint32_t next = 0;
+	uint32_t last = 0;
+	uint32_t fifoCodeMax = (version >= 1) ? 13 : 15;	// version 1 codes the free indices next to the last one as 13 and 14
+
+	const unsigned char* codes = p_src + 1;
+	const unsigned char* data = codes + p_count / 3;
+	const unsigned char* dataSafeEnd = p_src + p_srcSize - MESHOPT_INDEX_CODE_TABLE_SIZE;
+	const unsigned char* codeTable = dataSafeEnd;
+
+	for (size_t i = 0; i < p_count; i += 3)
+	{
+		// a triangle reads 16 bytes at most, the code table ends the stream after the data
+		if (data > dataSafeEnd)
+			return false;
+
+		uint32_t a, b, c;
+		uint32_t code = *codes++;
+		if (code < 0xf0)
+		{
+			// an edge of the FIFO and a third vertex
+			uint32_t edge = (edgeOffset - 1 - (code >> 4)) & 15;
+			a = edges[edge][0];
+			b = edges[edge][1];
+
+			uint32_t vertexCode = code & 15;
+			if (vertexCode < fifoCodeMax)
+			{
+				c = (vertexCode == 0) ? next++ : vertices[(vertexOffset - 1 - vertexCode) & 15];
+				pushVertex(c, vertexCode == 0);
+			}
+			else
+			{
+				c = last = (vertexCode != 15) ? last + (vertexCode == 13 ? -1 : 1) : DecodeFreeIndex(data, last);
+				pushVertex(c, true);
+			}
+
+			pushEdge(c, b);
+			pushEdge(a, c);
+		}
+		else
+		{
+			// three vertices, their codes from the table or from a byte of the data
+			uint32_t codePair = (code < 0xfe) ? codeTable[code & 15] : *data++;
+			uint32_t codeA = (code == 0xff) ? 15 : 0;
+			uint32_t codeB = codePair >> 4;
+			uint32_t codeC = codePair & 15;
+
+			if (code >= 0xfe && codePair == 0)
+				next = 0;
+
+			a = (codeA == 0) ? next++ : 0;
+			b = (codeB == 0) ? next++ : vertices[(vertexOffset - codeB) & 15];
+			c = (codeC == 0) ? next++ : vertices[(vertexOffset - codeC) & 15];
+
+			if (codeA == 15)
+				a = last = DecodeFreeIndex(data, last);
+			if (codeB == 15)
+				b = last = DecodeFreeIndex(data, last);
+			if (codeC == 15)
+				c = last = DecodeFreeIndex(data, last);
+
+			pushVertex(a, true);
+			pushVertex(b, codeB == 0 || codeB == 15);
+			pushVertex(c, codeC == 0 || codeC == 15);
+
+			pushEdge(b, a);
+			pushEdge(c, b);
+			pushEdge(a, c);
+		}
+
+		WriteIndex(p_dst, i + 0, p_stride, a);
+		WriteIndex(p_dst, i + 1, p_stride, b);
+		WriteIndex(p_dst, i + 2, p_stride, c);
+	}
+
+	return data == dataSafeEnd;
+}
+
+// Every index is a zigzag encoded delta to one of the two last indices, the low bit of its code says which
+static bool DecodeMeshoptSequence(unsigned char* p_dst, size_t p_count, size_t p_stride, const unsigned char* p_src, size_t p_srcSize)
+{
+	if (p_stride != 2 && p_stride != 4)
+		return false;
+	if (p_srcSize < 1 + p_count + 4 || (p_src[0] & 0xf0) != MESHOPT_SEQUENCE_HEADER || (p_src[0] & 0x0f) > 1)
+		return false;
+
+	const unsigned char* data = p_src + 1;
+	const unsigned char* dataSafeEnd = p_src + p_srcSize - 4;	// an index reads 5 bytes at most, 4 padding bytes end the stream
+
+	uint32_t last[2] = { 0, 0 };
+	for (size_t i = 0; i < p_count; i++)
+	{
+		if (data >= dataSafeEnd)
+			return false;
+
+		uint32_t code = DecodeVByte(data);
+		uint32_t baseline = code & 1;
+		code >>= 1;
+
+		uint32_t index = last[baseline] + ((code >> 1) ^ (0u - (code & 1)));
+		last[baseline] = index;
+		WriteIndex(p_dst, i, p_stride, index);
+	}
+
+	return data == dataSafeEnd;
+}
+
+// The third component holds 1.0 at the precision of the others, z is rebuilt from it and the vector renormalized
+template <typename T>
+static void DecodeOctahedralFilter(unsigned char* p_data, size_t p_count)
+{
+	const float one = (float)((1 << (sizeof(T) * 8 - 1)) - 1);
+	for (size_t i = 0; i < p_count; i++)
+	{
+		T v[4];
+		memcpy(v, p_data + i * sizeof(v), sizeof(v));
+
+		float x = (float)v[0];
+		float y = (float)v[1];
+		float z = (float)v[2] - fabsf(x) - fabsf(y);
+
+		// the lower hemisphere is folded over the diagonals
+		float t = (std::min)(z, 0.0f);
+		x += (x >= 0.0f) ? t : -t;
+		y += (y >= 0.0f) ? t : -t;
+
+		float scale = one / sqrtf(x * x + y * y + z * z);
+		v[0] = (T)(int)lroundf(x * scale);
+		v[1] = (T)(int)lroundf(y * scale);
+		v[2] = (T)(int)lroundf(z * scale);
+		memcpy(p_data + i * sizeof(v), v, sizeof(v));
+	}
+}
+
+// The fourth component holds the index of the largest one, which was left out, in its low 2 bits and the scale of the
+// other three above them
+static void DecodeQuaternionFilter(unsigned char* p_data, size_t p_count)
+{
+	const float scale = 1.0f / sqrtf(2.0f);
+	for (size_t i = 0; i < p_count; i++)
+	{
+		int16_t v[4];
+		memcpy(v, p_data + i * sizeof(v), sizeof(v));
+
+		float range = scale / (float)(v[3] | 3);
+		float x = (float)v[0] * range;
+		float y = (float)v[1] * range;
+		float z = (float)v[2] * range;
+		float w = sqrtf((std::max)(1.0f - x * x - y * y - z * z, 0.0f));
+
+		uint32_t largest = v[3] & 3;
+		int16_t q[4];
+		q[(largest + 1) & 3] = (int16_t)lroundf(x * 32767.0f);
+		q[(largest + 2) & 3] = (int16_t)lroundf(y * 32767.0f);
+		q[(largest + 3) & 3] = (int16_t)lroundf(z * 32767.0f);
+		q[largest] = (int16_t)lroundf(w * 32767.0f);
+		memcpy(p_data + i * sizeof(q), q, sizeof(q));
+	}
+}
+
+static void DecodeExponentialFilter(unsigned char* p_data, size_t p_count)
+{
+	for (size_t i = 0; i < p_count; i++)
+	{
+		int32_t v;
+		memcpy(&v, p_data + i * 4, 4);
+
+		int32_t exponent = v >> 24;
+		int32_t mantissa = (int32_t)((uint32_t)v << 8) >> 8;
+		float value = ldexpf((float)mantissa, exponent);
+		memcpy(p_data + i * 4, &value, 4);
+	}
+}
+
+bool DecodeMeshoptBuffer(unsigned char* p_dst, size_t p_count, size_t p_stride, const unsigned char* p_src, size_t p_srcSize,
+	MeshoptMode p_mode, MeshoptFilter p_filter)
+{
+	if (p_mode == mm_triangles)
+		return p_filter == mf_none && DecodeMeshoptTriangles(p_dst, p_count, p_stride, p_src, p_srcSize);
+	if (p_mode == mm_indices)
+		return p_filter == mf_none && DecodeMeshoptSequence(p_dst, p_count, p_stride, p_src, p_srcSize);
+
+	RETURN_FALSE_IF_FALSE(DecodeMeshoptVertices(p_dst, p_count, p_stride, p_src, p_srcSize));
+
+	switch (p_filter)
+	{
+	case mf_none:
+		return true;
+	case mf_octahedral:
+		if (p_stride == 4)
+			DecodeOctahedralFilter<int8_t>(p_dst, p_count);
+		else if (p_stride == 8)
+			DecodeOctahedralFilter<int16_t>(p_dst, p_count);
+		else
+			return false;
+		return true;
+	case mf_quaternion:
+		if (p_stride != 8)
+			return false;
+		DecodeQuaternionFilter(p_dst, p_count);
+		return true;
+	case mf_exponential:
+		DecodeExponentialFilter(p_dst, p_count * p_stride / 4);
+		return true;
+	}
+	return false;
+}
+
+// Signed normalized components are clamped, the most negative integer would read below -1
+static float GetNormalizeScale(int p_componentType, bool p_normalized)
+{
+	if (!p_normalized)
+		return 1.0f;
+
+	switch (p_componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_BYTE:				return 1.0f / 127.0f;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:		return 1.0f / 255.0f;
+	case TINYGLTF_COMPONENT_TYPE_SHORT:				return 1.0f / 32767.0f;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:	return 1.0f / 65535.0f;
+	}
+	return 1.0f;
+}
+
+// Converts p_count components stored one after the other to floats
+static void ConvertComponents(const unsigned char* p_src, int p_componentType, bool p_normalized, size_t p_count, float* p_dst)
+{
+	const float scale = GetNormalizeScale(p_componentType, p_normalized);
+	const float minimum = (p_normalized && (p_componentType == TINYGLTF_COMPONENT_TYPE_BYTE || p_componentType == TINYGLTF_COMPONENT_TYPE_SHORT)) ? -1.0f : -FLT_MAX;
+
+	size_t i = 0;
+	switch (p_componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:
+		memcpy(p_dst, p_src, p_count * sizeof(float));
+		return;
+
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+	{
+		bool isSigned = (p_componentType == TINYGLTF_COMPONENT_TYPE_BYTE);
+#if ACCESSOR_SSE2
+		// 16 components at a time, widened to 16 then 32 bits
+		const __m128 scale4 = _mm_set1_ps(scale);
+		const __m128 minimum4 = _mm_set1_ps(minimum);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= p_count; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src + i));
+			__m128i words[2];
+			words[0] = isSigned ? _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8) : _mm_unpacklo_epi8(bytes, zero);
+			words[1] = isSigned ? _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8) : _mm_unpackhi_epi8(bytes, zero);
+			for (int w = 0; w < 2; w++)
+			{
+				__m128i sign = _mm_srai_epi16(words[w], 15);
+				__m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words[w], sign));
+				__m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words[w], sign));
+				_mm_storeu_ps(p_dst + i + w * 8, _mm_max_ps(_mm_mul_ps(low, scale4), minimum4));
+				_mm_storeu_ps(p_dst + i + w * 8 + 4, _mm_max_ps(_mm_mul_ps(high, scale4), minimum4));
+			}
+		}
+#endif
+		for (; i < p_count; i++)
+		{
+			float value = isSigned ? (float)(int8_t)p_src[i] : (float)p_src[i];
+			p_dst[i] = (std::max)(value * scale, minimum);
+		}
+		return;
+	}
+
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+	{
+		bool isSigned = (p_componentType == TINYGLTF_COMPONENT_TYPE_SHORT);
+#if ACCESSOR_SSE2
+		// 8 components at a time, widened to 32 bits
+		const __m128 scale4 = _mm_set1_ps(scale);
+		const __m128 minimum4 = _mm_set1_ps(minimum);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= p_count; i += 8)
+		{
+			__m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src + i * 2));
+			__m128i extend = isSigned ? _mm_srai_epi16(words, 15) : zero;
+			__m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, extend));
+			__m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, extend));
+			_mm_storeu_ps(p_dst + i, _mm_max_ps(_mm_mul_ps(low, scale4), minimum4));
+			_mm_storeu_ps(p_dst + i + 4, _mm_max_ps(_mm_mul_ps(high, scale4), minimum4));
+		}
+#endif
+		for (; i < p_count; i++)
+		{
+			uint16_t bits;
+			memcpy(&bits, p_src + i * 2, 2);
+			float value = isSigned ? (float)(int16_t)bits : (float)bits;
+			p_dst[i] = (std::max)(value * scale, minimum);
+		}
+		return;
+	}
+
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		for (; i < p_count; i++)
+		{
+			uint32_t value;
+			memcpy(&value, p_src + i * 4, 4);
+			p_dst[i] = (float)value;
+		}
+		return;
+	}
+}
+
+static size_t GetComponentSize(int p_componentType)
+{
+	switch (p_componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:		return 1;
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:	return 2;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:				return 4;
+	}
+	return 0;
+}
+
+// Start of p_count elements of p_elementSize bytes, p_stride apart, at p_offset into a buffer view. Null if they do
+// not fit in the view and its buffer
+static const unsigned char* GetViewData(const tinygltf::Model& p_model, int p_view, size_t p_offset, size_t p_count, size_t p_stride, size_t p_elementSize)
+{
+	if (p_view < 0 || p_view >= (int)p_model.bufferViews.size())
+		return nullptr;
+
+	const tinygltf::BufferView& view = p_model.bufferViews[p_view];
+	if (view.buffer < 0 || view.buffer >= (int)p_model.buffers.size())
+		return nullptr;
+
+	size_t size = (p_count > 0) ? (p_count - 1) * p_stride + p_elementSize : 0;
+	const std::vector<unsigned char>& data = p_model.buffers[view.buffer].data;
+	if (p_offset + size > view.byteLength || view.byteOffset + view.byteLength > data.size())
+		return nullptr;
+
+	return data.data() + view.byteOffset + p_offset;
+}
+
+static bool ReadIndexComponents(const unsigned char* p_src, int p_componentType, size_t p_count, size_t p_stride, uint32_t* p_dst)
+{
+	for (size_t i = 0; i < p_count; i++)
+	{
+		const unsigned char* src = p_src + i * p_stride;
+		switch (p_componentType)
+		{
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			p_dst[i] = *src;
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, src, 2);
+			p_dst[i] = value;
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+			memcpy(&p_dst[i], src, 4);
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+// Elements listed by a sparse accessor replace those of its base view, or of zeros without one
+static bool ReadSparseIndices(const tinygltf::Model& p_model, const tinygltf::Accessor& p_accessor, std::vector<uint32_t>& p_indices)
+{
+	const auto& sparse = p_accessor.sparse;
+	size_t count = (size_t)(std::max)(sparse.count, 0);
+	size_t indexSize = GetComponentSize(sparse.indices.componentType);
+	const unsigned char* indices = GetViewData(p_model, sparse.indices.bufferView, sparse.indices.byteOffset, count, indexSize, indexSize);
+
+	p_indices.resize(count);
+	if (indices == nullptr || !ReadIndexComponents(indices, sparse.indices.componentType, count, indexSize, p_indices.data()))
+		return false;
+
+	for (uint32_t index : p_indices)
+	{
+		if (index >= p_accessor.count)
+			return false;
+	}
+	return true;
+}
+
+bool ReadGltfAccessor(const tinygltf::Model& p_model, int p_accessor, uint32_t p_components, std::vector<float>& p_values)
+{
+	if (p_accessor < 0 || p_accessor >= (int)p_model.accessors.size())
+		return false;
+
+	const tinygltf::Accessor& accessor = p_model.accessors[p_accessor];
+	size_t components = (size_t)tinygltf::GetNumComponentsInType(accessor.type);
+	size_t componentSize = GetComponentSize(accessor.componentType);
+	size_t elementSize = components * componentSize;
+	if (elementSize == 0)
+	{
+		std::cerr << "ReadGltfAccessor Error: Accessor " << p_accessor << " has component type " << accessor.componentType << std::endl;
+		return false;
+	}
+
+	size_t count = accessor.count;
+	p_values.assign(count * p_components, 0.0f);
+
+	// Reads an element to the first p_components floats at p_dst
+	float element[16];
+	auto convertElement = [&](const unsigned char* p_src, float* p_dst)
+	{
+		ConvertComponents(p_src, accessor.componentType, accessor.normalized, components, element);
+		memcpy(p_dst, element, (std::min)(components, (size_t)p_components) * sizeof(float));
+	};
+
+	if (accessor.bufferView >= 0)
+	{
+		size_t stride = p_model.bufferViews[accessor.bufferView].byteStride;
+		stride = (stride != 0) ? stride : elementSize;
+
+		const unsigned char* src = GetViewData(p_model, accessor.bufferView, accessor.byteOffset, count, stride, elementSize);
+		if (src == nullptr)
+		{
+			std::cerr << "ReadGltfAccessor Error: Accessor " << p_accessor << " reaches out of its buffer" << std::endl;
+			return false;
+		}
+
+		// tightly packed elements as wide as the output convert as a single run
+		if (stride == elementSize && components == p_components)
+		{
+			ConvertComponents(src, accessor.componentType, accessor.normalized, count * components, p_values.data());
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+				convertElement(src + i * stride, &p_values[i * p_components]);
+		}
+	}
+
+	if (accessor.sparse.isSparse)
+	{
+		std::vector<uint32_t> indices;
+		size_t sparseCount = (size_t)(std::max)(accessor.sparse.count, 0);
+		const unsigned char* values = GetViewData(p_model, accessor.sparse.values.bufferView, accessor.sparse.values.byteOffset, sparseCount, elementSize, elementSize);
+		if (values == nullptr || !ReadSparseIndices(p_model, accessor, indices))
+		{
+			std::cerr << "ReadGltfAccessor Error: Invalid sparse accessor " << p_accessor << std::endl;
+			return false;
+		}
+
+		for (size_t i = 0; i < sparseCount; i++)
+			convertElement(values + i * elementSize, &p_values[(size_t)indices[i] * p_components]);
+	}
+
+	return true;
+}
+
+bool ReadGltfIndices(const tinygltf::Model& p_model, int p_accessor, std::vector<uint32_t>& p_indices)
+{
+	if (p_accessor < 0 || p_accessor >= (int)p_model.accessors.size())
+		return false;
+
+	const tinygltf::Accessor& accessor = p_model.accessors[p_accessor];
+	size_t indexSize = GetComponentSize(accessor.componentType);
+	if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE && accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+		&& accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+	{
+		std::cerr << "ReadGltfIndices Error: Index component type " << accessor.componentType << " not supported!" << std::endl;
+		return false;
+	}
+
+	p_indices.assign(accessor.count, 0);
+	if (accessor.bufferView >= 0)
+	{
+		size_t stride = p_model.bufferViews[accessor.bufferView].byteStride;
+		stride = (stride != 0) ? stride : indexSize;
+
+		const unsigned char* src = GetViewData(p_model, accessor.bufferView, accessor.byteOffset, accessor.count, stride, indexSize);
+		if (src == nullptr)
+		{
+			std::cerr << "ReadGltfIndices Error: Accessor " << p_accessor << " reaches out of its buffer" << std::endl;
+			return false;
+		}
+		ReadIndexComponents(src, accessor.componentType, accessor.count, stride, p_indices.data());
+	}
+
+	if (accessor.sparse.isSparse)
+	{
+		std::vector<uint32_t> indices;
+		size_t sparseCount = (size_t)(std::max)(accessor.sparse.count, 0);
+		const unsigned char* values = GetViewData(p_model, accessor.sparse.values.bufferView, accessor.sparse.values.byteOffset, sparseCount, indexSize, indexSize);
+		std::vector<uint32_t> substitutes(sparseCount);
+		if (values == nullptr || !ReadSparseIndices(p_model, accessor, indices) || !ReadIndexComponents(values, accessor.componentType, sparseCount, indexSize, substitutes.data()))
+		{
+			std::cerr << "ReadGltfIndices Error: Invalid sparse accessor " << p_accessor << std::endl;
+			return false;
+		}
+
+		for (size_t i = 0; i < sparseCount; i++)
+			p_indices[indices[i]] = substitutes[i];
+	}
+
+	return true;
+}
+
+static size_t GetSize(const tinygltf::Value& p_object, const char* p_key, size_t p_default)
+{
+	if (!p_object.Has(p_key) || !p_object.Get(p_key).IsNumber())
+		return p_default;
+
+	double value = p_object.Get(p_key).GetNumberAsDouble();
+	return value > 0.0 ? (size_t)value : 0;
+}
+
+static std::string GetString(const tinygltf::Value& p_object, const char* p_key, const char* p_default)
+{
+	if (!p_object.Has(p_key) || !p_object.Get(p_key).IsString())
+		return p_default;
+	return p_object.Get(p_key).Get<std::string>();
+}
+
+struct MeshoptView
+{
+	int									index;
+	const unsigned char*				src;
+	size_t								srcSize;
+	unsigned char*						dst;
+	size_t								count;
+	size_t								stride;
+	MeshoptMode							mode;
+	MeshoptFilter						filter;
+};
+
+// The views are decoded to where the fallback buffer holds them, which is grown to its byteLength when the file
+// left it empty
+static bool CollectMeshoptViews(tinygltf::Model& p_model, std::vector<MeshoptView>& p_views)
+{
+	std::vector<size_t> bufferSizes(p_model.buffers.size(), 0);
+	std::vector<MeshoptView> views;
+
+	for (size_t i = 0; i < p_model.bufferViews.size(); i++)
+	{
+		const tinygltf::BufferView& bufferView = p_model.bufferViews[i];
+		auto extension = bufferView.extensions.find("EXT_meshopt_compression");
+		if (extension == bufferView.extensions.end())
+			continue;
+
+		const tinygltf::Value& meshopt = extension->second;
+		MeshoptView view{};
+		view.index = (int)i;
+		view.count = GetSize(meshopt, "count", 0);
+		view.stride = GetSize(meshopt, "byteStride", 0);
+
+		std::string mode = GetString(meshopt, "mode", "");
+		std::string filter = GetString(meshopt, "filter", "NONE");
+		view.mode = (mode == "TRIANGLES") ? mm_triangles : (mode == "INDICES") ? mm_indices : mm_attributes;
+		view.filter = (filter == "OCTAHEDRAL") ? mf_octahedral : (filter == "QUATERNION") ? mf_quaternion : (filter == "EXPONENTIAL") ? mf_exponential : mf_none;
+
+		size_t source = GetSize(meshopt, "buffer", SIZE_MAX);
+		size_t sourceOffset = GetSize(meshopt, "byteOffset", 0);
+		size_t sourceSize = GetSize(meshopt, "byteLength", 0);
+		size_t decodedSize = view.count * view.stride;
+
+		bool known = (mode == "ATTRIBUTES" || mode == "TRIANGLES" || mode == "INDICES") && (filter == "NONE" || view.filter != mf_none);
+		if (!known || source >= p_model.buffers.size() || sourceOffset + sourceSize > p_model.buffers[source].data.size()
+			|| bufferView.buffer < 0 || bufferView.buffer >= (int)p_model.buffers.size() || decodedSize > bufferView.byteLength)
+		{
+			std::cerr << "CMeshDecoder::Decode Error: Invalid EXT_meshopt_compression buffer view " << i << std::endl;
+			return false;
+		}
+
+		view.srcSize = sourceSize;
+		size_t& bufferSize = bufferSizes[bufferView.buffer];
+		bufferSize = (std::max)(bufferSize, bufferView.byteOffset + bufferView.byteLength);
+		views.push_back(view);
+	}
+
+	for (size_t i = 0; i < p_model.buffers.size(); i++)
+	{
+		if (p_model.buffers[i].data.size() < bufferSizes[i])
+			p_model.buffers[i].data.resize(bufferSizes[i]);
+	}
+
+	// the buffers are not resized anymore, the pointers into them hold
+	for (MeshoptView& view : views)
+	{
+		const tinygltf::BufferView& bufferView = p_model.bufferViews[view.index];
+		const tinygltf::Value& meshopt = bufferView.extensions.find("EXT_meshopt_compression")->second;
+		view.src = p_model.buffers[GetSize(meshopt, "buffer", 0)].data.data() + GetSize(meshopt, "byteOffset", 0);
+		view.dst = p_model.buffers[bufferView.buffer].data.data() + bufferView.byteOffset;
+	}
+
+	p_views = std::move(views);
+	return true;
+}
+
+struct DracoAttribute
+{
+	int									accessor;
+	int									uniqueId;				// of the attribute in the Draco mesh
+	size_t								components;
+	size_t								offset;					// of its floats in the decoded buffer
+};
+
+struct DracoPrimitive
+{
+	int									mesh;
+	int									primitive;
+	const unsigned char*				src;
+	size_t								srcSize;
+	int									indices;				// accessor, -1 if the primitive is not indexed
+	std::vector<DracoAttribute>			attributes;
+	std::vector<unsigned char>			decoded;				// the 32 bit indices, then the attributes
+};
+
+// Without Draco a primitive can only be loaded if its accessors have an uncompressed fallback
+static bool CollectDracoPrimitives(const tinygltf::Model& p_model, std::vector<DracoPrimitive>& p_primitives)
+{
+	for (size_t m = 0; m < p_model.meshes.size(); m++)
+	{
+		for (size_t p = 0; p < p_model.meshes[m].primitives.size(); p++)
+		{
+			const tinygltf::Primitive& primitive = p_model.meshes[m].primitives[p];
+			auto extension = primitive.extensions.find("KHR_draco_mesh_compression");
+			if (extension == primitive.extensions.end())
+				continue;
+
+			const tinygltf::Value& draco = extension->second;
+			if (!GLTF_DRACO_DECODING)
+			{
+				bool fallback = (primitive.indices < 0 || p_model.accessors[primitive.indices].bufferView >= 0);
+				for (const auto& attribute : primitive.attributes)
+					fallback = fallback && p_model.accessors[attribute.second].bufferView >= 0;
+
+				if (!fallback)
+				{
+					std::cerr << "CMeshDecoder::Decode Error: Mesh " << p_model.meshes[m].name
+						<< " is Draco compressed, the build has to define GLTF_DRACO_DECODING and link Draco" << std::endl;
+					return false;
+				}
+				continue;
+			}
+
+			DracoPrimitive decode{};
+			decode.mesh = (int)m;
+			decode.primitive = (int)p;
+			decode.indices = primitive.indices;
+
+			size_t view = GetSize(draco, "bufferView", SIZE_MAX);
+			if (view >= p_model.bufferViews.size() || !draco.Has("attributes") || !draco.Get("attributes").IsObject())
+			{
+				std::cerr << "CMeshDecoder::Decode Error: Invalid KHR_draco_mesh_compression in mesh " << p_model.meshes[m].name << std::endl;
+				return false;
+			}
+
+			const tinygltf::BufferView& bufferView = p_model.bufferViews[view];
+			if (bufferView.buffer < 0 || bufferView.buffer >= (int)p_model.buffers.size()
+				|| bufferView.byteOffset + bufferView.byteLength > p_model.buffers[bufferView.buffer].data.size())
+			{
+				std::cerr << "CMeshDecoder::Decode Error: Invalid Draco buffer view " << view << std::endl;
+				return false;
+			}
+			decode.src = p_model.buffers[bufferView.buffer].data.data() + bufferView.byteOffset;
+			decode.srcSize = bufferView.byteLength;
+
+			// attributes the extension does not name are not compressed
+			const tinygltf::Value& attributes = draco.Get("attributes");
+			for (const std::string& name : attributes.Keys())
+			{
+				auto attribute = primitive.attributes.find(name);
+				if (attribute == primitive.attributes.end() || !attributes.Get(name).IsNumber())
+					continue;
+
+				const tinygltf::Accessor& accessor = p_model.accessors[attribute->second];
+				decode.attributes.push_back(DracoAttribute{ attribute->second, attributes.Get(name).GetNumberAsInt(),
+					(size_t)tinygltf::GetNumComponentsInType(accessor.type), 0 });
+			}
+
+			p_primitives.push_back(std::move(decode));
+		}
+	}
+
+	return true;
+}
+
+static bool DecodeDracoPrimitive(const tinygltf::Model& p_model, DracoPrimitive& p_primitive)
+{
+#if GLTF_DRACO_DECODING
+	draco::DecoderBuffer buffer;
+	buffer.Init(reinterpret_cast<const char*>(p_primitive.src), p_primitive.srcSize);
+
+	draco::Decoder decoder;
+	auto decoded = decoder.DecodeMeshFromBuffer(&buffer);
+	if (!decoded.ok())
+	{
+		std::cerr << "DecodeDracoPrimitive Error: " << decoded.status().error_msg_string() << std::endl;
+		return false;
+	}
+	std::unique_ptr<draco::Mesh> mesh = std::move(decoded).value();
+
+	size_t indexCount = (size_t)mesh->num_faces() * 3;
+	size_t pointCount = mesh->num_points();
+	if (p_primitive.indices >= 0 && p_model.accessors[p_primitive.indices].count != indexCount)
+	{
+		std::cerr << "DecodeDracoPrimitive Error: Decoded " << indexCount << " indices, the accessor has "
+			<< p_model.accessors[p_primitive.indices].count << std::endl;
+		return false;
+	}
+
+	size_t size = indexCount * sizeof(uint32_t);
+	for (DracoAttribute& attribute : p_primitive.attributes)
+	{
+		attribute.offset = size;
+		size += pointCount * attribute.components * sizeof(float);
+	}
+	p_primitive.decoded.resize(size);
+
+	uint32_t* indices = reinterpret_cast<uint32_t*>(p_primitive.decoded.data());
+	for (draco::FaceIndex f(0); f < mesh->num_faces(); ++f)
+	{
+		const draco::Mesh::Face& face = mesh->face(f);
+		for (int c = 0; c < 3; c++)
+			indices[f.value() * 3 + c] = face[c].value();
+	}
+
+	// normalized integer attributes convert to [0, 1] or [-1, 1]
+	for (const DracoAttribute& attribute : p_primitive.attributes)
+	{
+		const draco::PointAttribute* source = mesh->GetAttributeByUniqueId(attribute.uniqueId);
+		if (source == nullptr || p_model.accessors[attribute.accessor].count != pointCount)
+		{
+			std::cerr << "DecodeDracoPrimitive Error: Attribute " << attribute.uniqueId << " does not match its accessor" << std::endl;
+			return false;
+		}
+
+		float* values = reinterpret_cast<float*>(p_primitive.decoded.data() + attribute.offset);
+		for (draco::PointIndex point(0); point < mesh->num_points(); ++point)
+		{
+			if (!source->ConvertValue<float>(source->mapped_index(point), (int8_t)attribute.components, values + point.value() * attribute.components))
+				return false;
+		}
+	}
+
+	return true;
+#else
+	(void)p_model;
+	(void)p_primitive;
+	return false;
+#endif
+}
+
+CMeshDecoder::CMeshDecoder()
+	: m_settings{}
+	, m_threadPool(nullptr)
+	, m_stats{}
+{
+}
+
+CMeshDecoder::~CMeshDecoder()
+{
+	Destroy();
+}
+
+bool CMeshDecoder::Create(const Settings& p_settings)
+{
+	m_settings = p_settings;
+
+	m_threadPool = new CThreadPool();
+	RETURN_FALSE_IF_FALSE(m_threadPool->Create(m_settings.workerCount));
+
+	CLOG("Mesh decoding - " << m_threadPool->GetWorkerCount() << " decode threads, Draco "
+		<< (GLTF_DRACO_DECODING ? "enabled" : "disabled") << std::endl);
+
+	return true;
+}
+
+void CMeshDecoder::Destroy()
+{
+	if (m_threadPool)
+	{
+		m_threadPool->Destroy();
+		delete m_threadPool;
+		m_threadPool = nullptr;
+	}
+}
+
+CMeshDecoder::Stats CMeshDecoder::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+bool CMeshDecoder::Decode(tinygltf::Model& p_model)
+{
+	PROFILE_FUNCTION();
+
+	// Local until the end, several loaders may decode at once
+	auto start = std::chrono::steady_clock::now();
+	Stats stats{};
+
+	std::vector<MeshoptView> meshoptViews;
+	std::vector<DracoPrimitive> dracoPrimitives;
+	RETURN_FALSE_IF_FALSE(CollectMeshoptViews(p_model, meshoptViews));
+	RETURN_FALSE_IF_FALSE(CollectDracoPrimitives(p_model, dracoPrimitives));
+	if (meshoptViews.empty() && dracoPrimitives.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats = stats;
+		return true;
+	}
+
+	// without workers the jobs run as they are submitted
+	CThreadPool::JobGroup group;
+	bool succeeded = true;
+	auto run = [&](CThreadPool::Job p_job)
+	{
+		if (m_threadPool)
+			m_threadPool->Submit(group, p_job);
+		else if (!p_job(0))
+			succeeded = false;
+	};
+
+	// the largest first, so a big one does not start last
+	std::sort(meshoptViews.begin(), meshoptViews.end(), [](const MeshoptView& a, const MeshoptView& b) { return a.srcSize > b.srcSize; });
+	for (const MeshoptView& view : meshoptViews)
+	{
+		run([&view](uint32_t)
+		{
+			if (DecodeMeshoptBuffer(view.dst, view.count, view.stride, view.src, view.srcSize, view.mode, view.filter))
+				return true;
+
+			std::cerr << "CMeshDecoder::Decode Error: Failed to decode meshopt buffer view " << view.index << std::endl;
+			return false;
+		});
+	}
+
+	for (DracoPrimitive& primitive : dracoPrimitives)
+	{
+		const tinygltf::Model& model = p_model;
+		run([&model, &primitive](uint32_t)
+		{
+			if (DecodeDracoPrimitive(model, primitive))
+				return true;
+
+			std::cerr << "CMeshDecoder::Decode Error: Failed to decode Draco primitive " << primitive.primitive
+				<< " of mesh " << model.meshes[primitive.mesh].name << std::endl;
+			return false;
+		});
+	}
+
+	if (m_threadPool)
+		succeeded = m_threadPool->Wait(group);
+	RETURN_FALSE_IF_FALSE(succeeded);
+
+	// The decoded views now read as plain ones
+	for (const MeshoptView& view : meshoptViews)
+	{
+		tinygltf::BufferView& bufferView = p_model.bufferViews[view.index];
+		bufferView.extensions.erase("EXT_meshopt_compression");
+
+		stats.meshoptViews++;
+		stats.decodedBytes += view.count * view.stride;
+	}
+
+	// Every Draco primitive gets a buffer and a view of its own, its accessors are pointed at their decoded data
+	for (DracoPrimitive& primitive : dracoPrimitives)
+	{
+		int viewIndex = (int)p_model.bufferViews.size();
+		tinygltf::BufferView bufferView;
+		bufferView.buffer = (int)p_model.buffers.size();
+		bufferView.byteOffset = 0;
+		bufferView.byteLength = primitive.decoded.size();
+		p_model.bufferViews.push_back(bufferView);
+
+		if (primitive.indices >= 0)
+		{
+			tinygltf::Accessor& accessor = p_model.accessors[primitive.indices];
+			accessor.bufferView = viewIndex;
+			accessor.byteOffset = 0;
+			accessor.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+		}
+
+		for (const DracoAttribute& attribute : primitive.attributes)
+		{
+			tinygltf::Accessor& accessor = p_model.accessors[attribute.accessor];
+			accessor.bufferView = viewIndex;
+			accessor.byteOffset = attribute.offset;
+			accessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+			accessor.normalized = false;
+		}
+
+		stats.dracoPrimitives++;
+		stats.decodedBytes += primitive.decoded.size();
+
+		tinygltf::Buffer buffer;
+		buffer.data = std::move(primitive.decoded);
+		p_model.buffers.push_back(std::move(buffer));
+		p_model.meshes[primitive.mesh].primitives[primitive.primitive].extensions.erase("KHR_draco_mesh_compression");
+	}
+
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	CLOG("CMeshDecoder::Decode: " << stats.meshoptViews << " meshopt views, " << stats.dracoPrimitives << " Draco primitives, "
+		<< stats.decodedBytes / 1024 << " KB in " << stats.seconds * 1000.0 << " ms" << std::endl);
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats = stats;
+
+	return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// KHR_draco_mesh_compression primitives are decoded with the Draco library; the build has to link it
+#if !defined(GLTF_DRACO_DECODING)
+#define GLTF_DRACO_DECODING 0
+#endif
+
+namespace tinygltf
+{
+	class Model;
+}
+
+// How an EXT_meshopt_compression buffer view is encoded
+enum MeshoptMode
+{
+	  mm_attributes					= 0		// vertex data, byte wise deltas between the elements
+	, mm_triangles							// triangle list indices
+	, mm_indices							// any other index list
+};
+
+// Applied to the attributes once decoded
+enum MeshoptFilter
+{
+	  mf_none						= 0
+	, mf_octahedral							// unit vectors of 4 snorm8 or snorm16, xy octahedral encoded
+	, mf_quaternion							// unit quaternions of 4 snorm16, the largest component left out
+	, mf_exponential						// floats as a 24 bit mantissa and an 8 bit exponent
+};
+
+// Decodes p_count elements of p_stride bytes of an EXT_meshopt_compression buffer view to p_dst. False if the data is
+// malformed or does not hold exactly that many elements
+bool DecodeMeshoptBuffer(unsigned char* p_dst, size_t p_count, size_t p_stride, const unsigned char* p_src, size_t p_srcSize,
+	MeshoptMode p_mode, MeshoptFilter p_filter);
+
+// Reads a glTF accessor as p_components floats per element, whatever its layout: strided buffer views, the normalized
+// and plain 8 and 16 bit integers of KHR_mesh_quantization, and sparse substitution. Missing components are zero and
+// extra ones dropped; tightly packed floats of the same width are copied as they are. False if the accessor reaches
+// out of its buffer
+bool ReadGltfAccessor(const tinygltf::Model& p_model, int p_accessor, uint32_t p_components, std::vector<float>& p_values);
+
+// The same for an index accessor of any unsigned component type
+bool ReadGltfIndices(const tinygltf::Model& p_model, int p_accessor, std::vector<uint32_t>& p_indices);
+
+// Decompresses the mesh data of a glTF model compressed with EXT_meshopt_compression or KHR_draco_mesh_compression,
+// so the loaders read plain accessors. Meshopt buffer views are decoded in place into their fallback buffer; Draco
+// primitives are decoded into a buffer of their own and their accessors pointed at it, as floats and 32 bit indices.
+// Every buffer view and primitive is a job of the workers
+class CMeshDecoder
+{
+public:
+	struct Settings
+	{
+		uint32_t						workerCount;			// 0 = one per hardware thread minus the calling thread
+	};
+
+	// Of the last Decode
+	struct Stats
+	{
+		uint32_t						meshoptViews;
+		uint32_t						dracoPrimitives;
+		size_t							decodedBytes;
+		double							seconds;
+	};
+
+	CMeshDecoder();
+	~CMeshDecoder();
+
+	bool Create(const Settings& p_settings);
+	void Destroy();
+
+	// Blocks the calling thread, which decodes alone if the decoder is not created. False if any view or primitive
+	// fails to decode, or is Draco compressed without an uncompressed fallback in a build without Draco. Several
+	// threads may decode different models at once, their jobs share the workers
+	bool Decode(tinygltf::Model& p_model);
+
+	bool IsCreated() const { return m_threadPool != nullptr; }
+	Stats GetStats() const;
+
+private:
+	Settings							m_settings;
+	CThreadPool*						m_threadPool;
+	Stats								m_stats;
+	mutable std::mutex					m_statsMutex;
+};
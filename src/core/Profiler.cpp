@@ -0,0 +1,62 @@
+#include "Profiler.h"
+
+int64_t CCpuProfiler::s_startNs = CCpuProfiler::Now();
+std::mutex CCpuProfiler::s_mutex;
+std::vector<CCpuProfiler::ThreadBuffer*> CCpuProfiler::s_buffers;
+
+static thread_local void* tl_threadBuffer = nullptr;
+
+CCpuProfiler::ThreadBuffer* CCpuProfiler::GetThreadBuffer()
+{
+	if (tl_threadBuffer == nullptr)
+	{
+		ThreadBuffer* buffer = new ThreadBuffer();
+		buffer->head = 0;
+		buffer->name = nullptr;
+
+		std::lock_guard<std::mutex> lock(s_mutex);
+		buffer->tid = (uint32_t)s_buffers.size();
+		s_buffers.push_back(buffer);
+		tl_threadBuffer = buffer;
+	}
+	return (ThreadBuffer*)tl_threadBuffer;
+}
+
+void CCpuProfiler::SetThreadName(const char* p_name)
+{
+	GetThreadBuffer()->name = p_name;
+}
+
+void CCpuProfiler::Record(const char* p_name, int64_t p_startNs, int64_t p_endNs)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	buffer->zones[head % CPU_PROFILER_RING_SIZE] = Zone{ p_name, p_startNs, p_endNs };
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void CCpuProfiler::Export(CTraceWriter& p_trace, int64_t p_fromNs, int64_t p_toNs)
+{
+	p_trace.SetTrackName(CTraceWriter::pid_CPU, "CPU");
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	for (ThreadBuffer* buffer : s_buffers)
+	{
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t first = (head > CPU_PROFILER_RING_SIZE) ? head - CPU_PROFILER_RING_SIZE : 0;
+
+		if (buffer->name != nullptr)
+			p_trace.SetThreadName(CTraceWriter::pid_CPU, buffer->tid, buffer->name);
+
+		for (uint64_t i = first; i < head; i++)
+		{
+			Zone zone = buffer->zones[i % CPU_PROFILER_RING_SIZE];
+			if (zone.startNs < p_fromNs || zone.startNs > p_toNs)
+				continue;
+
+			p_trace.AddEvent(zone.name, "cpu", CTraceWriter::pid_CPU, buffer->tid, 
+				(double)(zone.startNs - p_fromNs) * 1e-3, (double)(zone.endNs - zone.startNs) * 1e-3);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Global.h"
+#include "TraceWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped CPU zones. Every thread records into a ring buffer of its own, so a zone costs two clock reads
+// and a store without any locking; the buffers are only locked when a thread registers its buffer and
+// when the zones are exported. Zone names have to outlive the export, string literals or __FUNCTION__.
+// With CPU_PROFILER_ENABLED set to 0 the zone macros compile to nothing
+#if CPU_PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b)		a##b
+#define PROFILE_CONCAT(a, b)			PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name)				CProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_FUNCTION()				PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_THREAD(name)			CCpuProfiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#endif
+
+// Zones kept per thread, older zones are overwritten
+#define CPU_PROFILER_RING_SIZE			16384
+
+class CCpuProfiler
+{
+public:
+	// ns on the steady clock, the time base of the zones
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Time the profiler was initialized at, before any zone
+	static int64_t GetStartNs() { return s_startNs; }
+
+	static void SetThreadName(const char* p_name);
+	static void Record(const char* p_name, int64_t p_startNs, int64_t p_endNs);
+
+	// Adds the zones that started in [p_fromNs, p_toNs] with times relative to p_fromNs. Zones written while
+	// exporting may be torn when a ring wraps at the same time, which only ever affects its oldest entries
+	static void Export(CTraceWriter& p_trace, int64_t p_fromNs, int64_t p_toNs);
+
+private:
+	struct Zone
+	{
+		const char*						name;
+		int64_t							startNs;
+		int64_t							endNs;
+	};
+
+	struct ThreadBuffer
+	{
+		Zone							zones[CPU_PROFILER_RING_SIZE];
+		std::atomic<uint64_t>			head;				// zones written so far, only the owning thread writes
+		uint32_t						tid;
+		const char*						name;
+	};
+
+	static int64_t						s_startNs;
+	static std::mutex					s_mutex;
+	static std::vector<ThreadBuffer*>	s_buffers;			// never freed, threads may exit before an export
+
+	static ThreadBuffer* GetThreadBuffer();
+};
+
+class CProfileZone
+{
+public:
+	CProfileZone(const char* p_name)
+		: m_name(p_name)
+		, m_startNs(CCpuProfiler::Now())
+	{}
+
+	~CProfileZone()
+	{
+		CCpuProfiler::Record(m_name, m_startNs, CCpuProfiler::Now());
+	}
+
+private:
+	const char*							m_name;
+	int64_t								m_startNs;
+};
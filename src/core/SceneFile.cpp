@@ -0,0 +1,170 @@
+#include "SceneFile.h"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+static bool ReadTransform(std::istringstream& p_stream, nm::Transform& p_transform)
+{
+	float x, y, z, rx, ry, rz, sx, sy, sz;
+	if (!(p_stream >> x >> y >> z >> rx >> ry >> rz >> sx >> sy >> sz))
+		return false;
+
+	const float toRadians = (float)M_PI / 180.0f;
+	p_transform = nm::Transform();
+	p_transform.SetTranslate(nm::translation(nm::float3(x, y, z)));
+	p_transform.SetRotation(nm::rotation_z(rz * toRadians) * nm::rotation_y(ry * toRadians) * nm::rotation_x(rx * toRadians));
+	p_transform.SetScale(nm::float3(sx, sy, sz));
+	return true;
+}
+
+static void WriteTransform(std::ostream& p_stream, nm::Transform p_transform)
+{
+	// the rotation vector is decomposed the way rotation_z * rotation_y * rotation_x composes it
+	const float toDegrees = 180.0f / (float)M_PI;
+	nm::float3 position = p_transform.GetTranslateVector();
+	nm::float3 rotation = p_transform.GetRotateVector();
+	nm::float3 scale = p_transform.GetScaleVector();
+
+	p_stream << position[0] << " " << position[1] << " " << position[2] << " "
+		<< rotation[0] * toDegrees << " " << rotation[1] * toDegrees << " " << rotation[2] * toDegrees << " "
+		<< scale[0] << " " << scale[1] << " " << scale[2];
+}
+
+bool SceneDescription::Load(const std::filesystem::path& p_path)
+{
+	std::ifstream file(p_path);
+	if (!file.is_open())
+	{
+		std::cerr << "SceneDescription::Load Error: Failed to open " << p_path << std::endl;
+		return false;
+	}
+
+	*this = SceneDescription();
+
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		std::istringstream stream(line);
+		std::string command;
+		if (!(stream >> command) || command[0] == '#')
+			continue;
+
+		bool valid = false;
+		if (command == "asset")
+		{
+			Asset asset{};
+			valid = (bool)(stream >> std::quoted(asset.path) >> asset.flipUV) && ReadTransform(stream, asset.transform);
+			if (valid)
+				assets.push_back(asset);
+		}
+		else if (command == "light")
+		{
+			Light light{};
+			std::string type;
+			float r, g, b;
+			valid = (bool)(stream >> type >> std::quoted(light.name) >> light.castShadow >> r >> g >> b) && ReadTransform(stream, light.transform)
+				&& (type == "directional" || type == "point");
+			light.type = (type == "directional") ? CLight::Type::Directional : CLight::Type::Point;
+			light.color = nm::float3(r, g, b);
+			if (valid)
+				lights.push_back(light);
+		}
+		else if (command == "camera")
+		{
+			float x, y, z;
+			valid = (bool)(stream >> x >> y >> z >> camera.yaw >> camera.pitch);
+			camera.position = nm::float3(x, y, z);
+			hasCamera = valid;
+		}
+		else if (command == "setting")
+		{
+			Setting setting{};
+			valid = (bool)(stream >> setting.name >> setting.value);
+			if (valid)
+				settings.push_back(setting);
+		}
+
+		if (!valid)
+		{
+			std::cerr << "SceneDescription::Load Error: " << p_path.string() << ":" << lineNumber << " - " << line << std::endl;
+			return false;
+		}
+	}
+
+	std::clog << "SceneDescription::Load - " << p_path.string() << ": " << assets.size() << " assets, " << lights.size() << " lights, "
+		<< settings.size() << " settings" << std::endl;
+
+	return true;
+}
+
+bool SceneDescription::Save(const std::filesystem::path& p_path) const
+{
+	if (p_path.has_parent_path())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(p_path.parent_path(), error);
+	}
+
+	std::ofstream file(p_path);
+	if (!file.is_open())
+	{
+		std::cerr << "SceneDescription::Save Error: Failed to open " << p_path << std::endl;
+		return false;
+	}
+
+	// every float reads back to the value written
+	file << std::setprecision(std::numeric_limits<float>::max_digits10);
+
+	file << "# VFrame scene" << std::endl;
+	for (const Asset& asset : assets)
+	{
+		file << "asset " << std::quoted(asset.path) << " " << asset.flipUV << " ";
+		WriteTransform(file, asset.transform);
+		file << std::endl;
+	}
+
+	for (const Light& light : lights)
+	{
+		file << "light " << (light.type == CLight::Type::Directional ? "directional " : "point ") << std::quoted(light.name) << " " << light.castShadow << " "
+			<< light.color[0] << " " << light.color[1] << " " << light.color[2] << " ";
+		WriteTransform(file, light.transform);
+		file << std::endl;
+	}
+
+	if (hasCamera)
+		file << "camera " << camera.position[0] << " " << camera.position[1] << " " << camera.position[2] << " " << camera.yaw << " " << camera.pitch << std::endl;
+
+	for (const Setting& setting : settings)
+		file << "setting " << setting.name << " " << setting.value << std::endl;
+
+	if (!file.good())
+	{
+		std::cerr << "SceneDescription::Save Error: Failed to write " << p_path << std::endl;
+		return false;
+	}
+
+	std::clog << "SceneDescription::Save - " << p_path.string() << ": " << assets.size() << " assets, " << lights.size() << " lights" << std::endl;
+	return true;
+}
+
+std::filesystem::path SceneDescription::ResolveAssetPath(const std::string& p_path)
+{
+	std::filesystem::path path(p_path);
+	return path.is_absolute() ? path : g_AssetPath / path;
+}
+
+std::string SceneDescription::MakeAssetPath(const std::filesystem::path& p_path)
+{
+	// kept absolute when outside of the asset folder
+	std::filesystem::path relative = p_path.lexically_normal().lexically_relative(g_AssetPath.lexically_normal());
+	if (relative.empty() || *relative.begin() == "..")
+		return p_path.generic_string();
+
+	return relative.generic_string();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Light.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// What a session is restored from: the assets and where they are placed, the lights, the camera and the render
+// settings. Its assets stream in after the first frame and join the scene in the order listed, so the same file
+// restores a session and gives benchmarks the same scene on every run
+//
+// Scene file, one entry per line, lines starting with '#' are comments, names and paths are quoted:
+//	asset "<path>" <flip uv> <x> <y> <z> <rx> <ry> <rz> <sx> <sy> <sz>							path relative to the asset folder unless absolute
+//	light <directional|point> "<name>" <cast shadow> <r> <g> <b> <x> <y> <z> <rx> <ry> <rz> <sx> <sy> <sz>	the scale is the intensity
+//	camera <x> <y> <z> <yaw> <pitch>																angles in radians, as the camera keeps them
+//	setting <name> <value>																		a member of the primary uniform data
+// Rotations are in degrees around x, y and z, applied x first
+struct SceneDescription
+{
+	struct Asset
+	{
+		std::string						path;
+		bool							flipUV;
+		nm::Transform					transform;
+	};
+
+	struct Light
+	{
+		CLight::Type					type;
+		std::string						name;				// without the id the entity appends
+		bool							castShadow;
+		nm::float3						color;
+		nm::Transform					transform;
+	};
+
+	struct Camera
+	{
+		nm::float3						position;
+		float							yaw;
+		float							pitch;
+	};
+
+	struct Setting
+	{
+		std::string						name;
+		float							value;
+	};
+
+	std::vector<Asset>					assets;
+	std::vector<Light>					lights;
+	bool								hasCamera;
+	Camera								camera;
+	std::vector<Setting>				settings;
+
+	SceneDescription() : hasCamera(false), camera{} {}
+
+	bool Load(const std::filesystem::path& p_path);
+	bool Save(const std::filesystem::path& p_path) const;
+
+	// The asset folder joined to a relative path, and a path under the asset folder made relative to it
+	static std::filesystem::path ResolveAssetPath(const std::string& p_path);
+	static std::string MakeAssetPath(const std::filesystem::path& p_path);
+};
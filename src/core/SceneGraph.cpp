@@ -1,5 +1,6 @@
 #include "SceneGraph.h"
 #include "Asset.h"
+#include "Profiler.h"
 #include "external/imgui/imgui.h"
 #include "external/imguizmo/ImGuizmo.h"
 
@@ -72,6 +73,8 @@ CSceneGraph::~CSceneGraph()
 
 void CSceneGraph::Update()
 {
+	PROFILE_FUNCTION();
+
 	m_sceneStatus = SceneStatus::ss_NoChange;
 	BBox prevBBox = m_boundingBox;
 
@@ -122,6 +122,7 @@ public:
 
 	virtual void SetTransform(CVulkanRHI* p_rhi, nm::Transform p_transform, bool p_bRecomputeSceneBBox = true) = 0;
 	nm::Transform& GetTransform();
+	const nm::Transform& GetTransform() const { return m_transform; }
 	
 	void SetBoundingVolume(BVolume* p_bvol, bool p_bRecomputeSceneBBox = true);
 	BVolume* GetBoundingVolume() { return m_boundingVolume; }
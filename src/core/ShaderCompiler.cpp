@@ -0,0 +1,373 @@
+#include "ShaderCompiler.h"
+
+#if RUNTIME_SHADER_COMPILATION == 1
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include <shaderc/shaderc.hpp>
+
+// FNV-1a, the key only has to tell sources apart, it is not exposed to anything untrusted
+static uint64_t HashBytes(uint64_t p_hash, const void* p_data, size_t p_size)
+{
+	const uint8_t* bytes = (const uint8_t*)p_data;
+	for (size_t i = 0; i < p_size; i++)
+	{
+		p_hash ^= bytes[i];
+		p_hash *= 0x100000001b3ull;
+	}
+	return p_hash;
+}
+
+static uint64_t HashString(uint64_t p_hash, const std::string& p_string)
+{
+	// the length keeps "ab" + "c" and "a" + "bc" apart
+	uint64_t length = p_string.size();
+	p_hash = HashBytes(p_hash, &length, sizeof(length));
+	return HashBytes(p_hash, p_string.data(), p_string.size());
+}
+
+static bool ReadText(const std::filesystem::path& p_path, std::string& p_text)
+{
+	std::ifstream file(p_path, std::ios::binary | std::ios::in);
+	if (!file.is_open())
+		return false;
+
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	p_text = stream.str();
+	return true;
+}
+
+static bool GetShaderKind(const std::filesystem::path& p_source, shaderc_shader_kind& p_kind)
+{
+	std::string extension = p_source.extension().string();
+	if (extension == ".vert")		p_kind = shaderc_vertex_shader;
+	else if (extension == ".frag")	p_kind = shaderc_fragment_shader;
+	else if (extension == ".comp")	p_kind = shaderc_compute_shader;
+	else if (extension == ".geom")	p_kind = shaderc_geometry_shader;
+	else if (extension == ".tesc")	p_kind = shaderc_tess_control_shader;
+	else if (extension == ".tese")	p_kind = shaderc_tess_evaluation_shader;
+	else
+		return false;
+	return true;
+}
+
+// Resolves "file.h" next to the including file first, then in the source directory. The shaders were written
+// against a case insensitive file system ("Common.h" and "common.h" both appear), so a miss falls back to
+// comparing the names without case
+class CShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+{
+public:
+	CShaderIncluder(const std::filesystem::path& p_sourceDir, std::vector<std::filesystem::path>* p_includes)
+		: m_sourceDir(p_sourceDir)
+		, m_includes(p_includes)
+	{
+	}
+
+	shaderc_include_result* GetInclude(const char* p_requested, shaderc_include_type p_type, const char* p_requesting, size_t) override
+	{
+		IncludeData* data = new IncludeData();
+
+		std::vector<std::filesystem::path> directories;
+		if (p_type == shaderc_include_type_relative)
+			directories.push_back(std::filesystem::path(p_requesting).parent_path());
+		directories.push_back(m_sourceDir);
+
+		std::filesystem::path resolved;
+		for (const auto& directory : directories)
+		{
+			if (Find(directory, p_requested, resolved))
+				break;
+		}
+
+		if (!resolved.empty() && ReadText(resolved, data->content))
+		{
+			data->name = resolved.generic_string();
+			if (m_includes)
+				m_includes->push_back(resolved);
+		}
+		else
+		{
+			// an empty source name tells shaderc the include failed, the content is the error message
+			data->name.clear();
+			data->content = std::string("Cannot find or open include file ") + p_requested;
+		}
+
+		data->result.source_name			= data->name.c_str();
+		data->result.source_name_length		= data->name.size();
+		data->result.content				= data->content.c_str();
+		data->result.content_length			= data->content.size();
+		data->result.user_data				= data;
+		return &data->result;
+	}
+
+	void ReleaseInclude(shaderc_include_result* p_result) override
+	{
+		delete (IncludeData*)p_result->user_data;
+	}
+
+private:
+	struct IncludeData
+	{
+		std::string						name;
+		std::string						content;
+		shaderc_include_result			result;
+	};
+
+	std::filesystem::path				m_sourceDir;
+	std::vector<std::filesystem::path>*	m_includes;
+
+	static bool Find(const std::filesystem::path& p_directory, const std::string& p_name, std::filesystem::path& p_resolved)
+	{
+		std::error_code error;
+		std::filesystem::path candidate = p_directory / p_name;
+		if (std::filesystem::is_regular_file(candidate, error))
+		{
+			p_resolved = candidate;
+			return true;
+		}
+
+		auto lower = [](std::string p_string)
+			{
+				std::transform(p_string.begin(), p_string.end(), p_string.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+				return p_string;
+			};
+
+		std::string wanted = lower(candidate.filename().string());
+		std::filesystem::path directory = candidate.parent_path();
+		for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+		{
+			if (entry.is_regular_file(error) && lower(entry.path().filename().string()) == wanted)
+			{
+				p_resolved = entry.path();
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+CShaderCompiler::CShaderCompiler()
+	: m_settings{}
+	, m_compiled(0)
+	, m_cacheHits(0)
+	, m_failed(0)
+{
+}
+
+CShaderCompiler::~CShaderCompiler()
+{
+}
+
+bool CShaderCompiler::Create(const Settings& p_settings)
+{
+	m_settings = p_settings;
+
+	if (!m_settings.cacheDir.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_settings.cacheDir, error);
+		if (error)
+		{
+			std::cerr << "CShaderCompiler::Create Error: Failed to create " << m_settings.cacheDir.generic_string() << " - " << error.message() << std::endl;
+			return false;
+		}
+	}
+
+	CLOG("Runtime shader compilation - " << m_settings.sourceDir.generic_string() << (m_settings.optimize ? ", optimized" : "")
+		<< (m_settings.cacheDir.empty() ? ", no cache" : ", cache " + m_settings.cacheDir.generic_string()) << std::endl);
+
+	return true;
+}
+
+bool CShaderCompiler::Compile(const std::filesystem::path& p_source, const std::vector<std::string>& p_defines, std::vector<uint32_t>& p_spirv)
+{
+	PROFILE_FUNCTION();
+
+	shaderc_shader_kind kind;
+	if (!GetShaderKind(p_source, kind))
+	{
+		std::cerr << "CShaderCompiler::Compile Error: Unknown shader stage - " << p_source.generic_string() << std::endl;
+		return false;
+	}
+
+	std::string sourceText;
+	if (!ReadText(p_source, sourceText))
+	{
+		std::cerr << "CShaderCompiler::Compile Error: Failed to open " << p_source.generic_string() << std::endl;
+		RecordDependencies(p_source, {});
+		++m_failed;
+		return false;
+	}
+
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+	options.SetSourceLanguage(shaderc_source_language_glsl);
+	if (m_settings.optimize)
+		options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	if (m_settings.debugInfo)
+		options.SetGenerateDebugInfo();
+
+	for (const auto& define : p_defines)
+	{
+		size_t split = define.find('=');
+		if (split == std::string::npos)
+			options.AddMacroDefinition(define);
+		else
+			options.AddMacroDefinition(define.substr(0, split), define.substr(split + 1));
+	}
+
+	std::string sourceName = p_source.generic_string();
+	shaderc::Compiler compiler;
+
+	// Preprocessing resolves the includes, which makes the preprocessed text a complete description of the shader
+	std::vector<std::filesystem::path> includes;
+	shaderc::CompileOptions preprocessOptions(options);
+	preprocessOptions.SetIncluder(std::make_unique<CShaderIncluder>(m_settings.sourceDir, &includes));
+	shaderc::PreprocessedSourceCompilationResult preprocessed = compiler.PreprocessGlsl(sourceText, kind, sourceName.c_str(), preprocessOptions);
+
+	RecordDependencies(p_source, includes);
+
+	if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		std::cerr << "CShaderCompiler::Compile Error: " << preprocessed.GetErrorMessage();
+		++m_failed;
+		return false;
+	}
+
+	std::filesystem::path cachePath;
+	if (!m_settings.cacheDir.empty())
+	{
+		uint32_t spvVersion = 0, spvRevision = 0;
+		shaderc_get_spv_version(&spvVersion, &spvRevision);
+
+		uint64_t hash = 0xcbf29ce484222325ull;
+		hash = HashString(hash, std::string(preprocessed.cbegin(), preprocessed.cend()));
+		for (const auto& define : p_defines)
+			hash = HashString(hash, define);
+		uint32_t keyOptions[] = { (uint32_t)kind, (uint32_t)m_settings.optimize, (uint32_t)m_settings.debugInfo, spvVersion, spvRevision };
+		hash = HashBytes(hash, keyOptions, sizeof(keyOptions));
+
+		std::ostringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+		cachePath = m_settings.cacheDir / name.str();
+
+		if (ReadCache(cachePath, p_spirv))
+		{
+			++m_cacheHits;
+			return true;
+		}
+	}
+
+	options.SetIncluder(std::make_unique<CShaderIncluder>(m_settings.sourceDir, nullptr));
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(sourceText, kind, sourceName.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		std::cerr << "CShaderCompiler::Compile Error: " << result.GetErrorMessage();
+		++m_failed;
+		return false;
+	}
+
+	if (result.GetNumWarnings() > 0)
+	{
+		CLOG_YELLOW(result.GetErrorMessage());
+	}
+
+	p_spirv.assign(result.cbegin(), result.cend());
+	++m_compiled;
+
+	if (!cachePath.empty())
+		WriteCache(cachePath, p_spirv);
+
+	return true;
+}
+
+void CShaderCompiler::GetOutdatedSources(std::vector<std::filesystem::path>& p_sources)
+{
+	std::lock_guard<std::mutex> lock(m_dependencyMutex);
+	for (auto& source : m_dependencies)
+	{
+		bool outdated = false;
+		for (auto& dependency : source.second)
+		{
+			std::error_code error;
+			std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(dependency.file, error);
+			if (!error && writeTime != dependency.writeTime)
+			{
+				dependency.writeTime = writeTime;
+				outdated = true;
+			}
+		}
+
+		if (outdated)
+			p_sources.push_back(source.second.front().file);
+	}
+}
+
+void CShaderCompiler::RecordDependencies(const std::filesystem::path& p_source, const std::vector<std::filesystem::path>& p_includes)
+{
+	std::vector<Dependency> dependencies;
+	dependencies.reserve(p_includes.size() + 1);
+
+	std::error_code error;
+	dependencies.push_back(Dependency{ p_source, std::filesystem::last_write_time(p_source, error) });
+	for (const auto& include : p_includes)
+		dependencies.push_back(Dependency{ include, std::filesystem::last_write_time(include, error) });
+
+	std::lock_guard<std::mutex> lock(m_dependencyMutex);
+	m_dependencies[p_source.generic_string()] = std::move(dependencies);
+}
+
+bool CShaderCompiler::ReadCache(const std::filesystem::path& p_path, std::vector<uint32_t>& p_spirv) const
+{
+	std::ifstream file(p_path, std::ios::binary | std::ios::in | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size <= 0 || size % sizeof(uint32_t) != 0)
+		return false;
+
+	p_spirv.resize((size_t)size / sizeof(uint32_t));
+	file.seekg(0, std::ios::beg);
+	file.read((char*)p_spirv.data(), size);
+
+	// a truncated or foreign file is compiled over
+	const uint32_t spirvMagic = 0x07230203;
+	return file.gcount() == size && p_spirv[0] == spirvMagic;
+}
+
+void CShaderCompiler::WriteCache(const std::filesystem::path& p_path, const std::vector<uint32_t>& p_spirv) const
+{
+	// two threads compiling the same shader write the same bytes, the rename makes either one win whole
+	std::ostringstream suffix;
+	suffix << "." << std::hash<std::thread::id>{}(std::this_thread::get_id()) << ".tmp";
+	std::filesystem::path tempPath = p_path;
+	tempPath += suffix.str();
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "CShaderCompiler::WriteCache Error: Failed to open " << tempPath.generic_string() << std::endl;
+			return;
+		}
+		file.write((const char*)p_spirv.data(), (std::streamsize)(p_spirv.size() * sizeof(uint32_t)));
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, p_path, error);
+	if (error)
+		std::filesystem::remove(tempPath, error);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Global.h"
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 0 loads the SPIR-V shaders/glsl_to_spirv.py wrote to shaders/spirv
+// 1 compiles shaders/glsl at runtime and hot reloads them, see CShaderCompiler; the build has to link shaderc
+#if !defined(RUNTIME_SHADER_COMPILATION)
+#define RUNTIME_SHADER_COMPILATION 1
+#endif
+#define RUNTIME_SHADER_OPTIMIZATION 1		// runs spirv-opt over the shaders compiled at runtime
+
+// Runtime GLSL to SPIR-V compilation through shaderc, the library glslangValidator is built on, as shipped
+// with the Vulkan SDK. Every source is preprocessed first, which resolves its includes, and the SPIR-V is
+// cached on disk under a hash of the preprocessed source, the defines and the options. Editing an include
+// therefore changes the key of every shader using it, and reverting an edit finds the old entry again.
+// Compile may be called from any number of threads at once, each call uses a shaderc compiler of its own
+class CShaderCompiler
+{
+public:
+	struct Settings
+	{
+		std::filesystem::path			sourceDir;				// includes not found next to the including file are looked up here
+		std::filesystem::path			cacheDir;				// empty disables the disk cache
+		bool							optimize;				// runs the spirv-opt performance passes
+		bool							debugInfo;
+	};
+
+	struct Stats
+	{
+		uint32_t						compiled;
+		uint32_t						cacheHits;
+		uint32_t						failed;
+	};
+
+	CShaderCompiler();
+	~CShaderCompiler();
+
+	bool Create(const Settings& p_settings);
+
+	// Stage is taken from the extension: vert, frag, comp, geom, tesc or tese. Defines are NAME or NAME=VALUE
+	bool Compile(const std::filesystem::path& p_source, const std::vector<std::string>& p_defines, std::vector<uint32_t>& p_spirv);
+
+	// Sources whose file, or any file they include, changed on disk since they were last compiled. Each change is reported once
+	void GetOutdatedSources(std::vector<std::filesystem::path>& p_sources);
+
+	Stats GetStats() const { return Stats{ m_compiled, m_cacheHits, m_failed }; }
+
+private:
+	struct Dependency
+	{
+		std::filesystem::path			file;
+		std::filesystem::file_time_type	writeTime;
+	};
+
+	Settings							m_settings;
+
+	std::mutex							m_dependencyMutex;
+	std::unordered_map<std::string, std::vector<Dependency>> m_dependencies;	// by source path, the source itself first
+
+	std::atomic<uint32_t>				m_compiled;
+	std::atomic<uint32_t>				m_cacheHits;
+	std::atomic<uint32_t>				m_failed;
+
+	void RecordDependencies(const std::filesystem::path& p_source, const std::vector<std::filesystem::path>& p_includes);
+	bool ReadCache(const std::filesystem::path& p_path, std::vector<uint32_t>& p_spirv) const;
+	void WriteCache(const std::filesystem::path& p_path, const std::vector<uint32_t>& p_spirv) const;
+};
@@ -0,0 +1,848 @@
+#include "TextureCompressor.h"
+#include "Global.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#if KTX2_BASIS_TRANSCODING
+#include "external/basis_universal/transcoder/basisu_transcoder.h"
+#endif
+
+// Bumped whenever an encoder changes its output, which orphans the cache entries of older versions
+#define TEXTURE_COMPRESSOR_VERSION			1
+#define TEXTURE_COMPRESSOR_ROWS_PER_JOB		16		// rows of 4x4 blocks encoded by one job
+
+struct CacheHeader
+{
+	uint32_t								magic;
+	uint32_t								version;
+	uint32_t								encoding;
+	uint32_t								width;
+	uint32_t								height;
+	uint32_t								mipLevels;
+	char									swizzle[4];
+	uint64_t								dataSize;
+};
+static const uint32_t c_cacheMagic = 0x43425646;	// "FVBC"
+
+// How a texture is encoded, chosen from its usage and, for rough-metal maps, its content
+struct EncodeParams
+{
+	TextureEncoding							encoding;
+	std::string								swizzle;
+	uint32_t								channels[2];	// source channels of the BC4 and BC5 blocks
+	bool									normalMap;		// mips are renormalized
+};
+
+// FNV-1a over 64 bit words with a fold, the key only has to tell textures apart
+static uint64_t HashWords(uint64_t p_hash, const void* p_data, size_t p_size)
+{
+	const uint8_t* bytes = (const uint8_t*)p_data;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= p_size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		p_hash = (p_hash ^ word) * 0x100000001b3ull;
+		p_hash ^= p_hash >> 29;
+	}
+	for (; i < p_size; i++)
+		p_hash = (p_hash ^ bytes[i]) * 0x100000001b3ull;
+	return p_hash;
+}
+
+static uint32_t GetBytesPerBlock(TextureEncoding p_encoding)
+{
+	return (p_encoding == te_bc1 || p_encoding == te_bc4) ? 8 : 16;
+}
+
+static size_t GetLevelSize(uint32_t p_width, uint32_t p_height, TextureEncoding p_encoding)
+{
+	return (size_t)((p_width + 3) / 4) * ((p_height + 3) / 4) * GetBytesPerBlock(p_encoding);
+}
+
+// 2x2 box filter. Odd sizes repeat the last row or column. Normal maps are averaged as vectors and renormalized
+static void Downsample(const uint8_t* p_src, uint32_t p_srcWidth, uint32_t p_srcHeight, uint8_t* p_dst, uint32_t p_dstWidth, uint32_t p_dstHeight, bool p_normalMap)
+{
+	for (uint32_t y = 0; y < p_dstHeight; y++)
+	{
+		const uint8_t* row0 = p_src + (size_t)(std::min)(y * 2, p_srcHeight - 1) * p_srcWidth * 4;
+		const uint8_t* row1 = p_src + (size_t)(std::min)(y * 2 + 1, p_srcHeight - 1) * p_srcWidth * 4;
+		for (uint32_t x = 0; x < p_dstWidth; x++)
+		{
+			uint32_t x0 = (std::min)(x * 2, p_srcWidth - 1) * 4;
+			uint32_t x1 = (std::min)(x * 2 + 1, p_srcWidth - 1) * 4;
+			const uint8_t* texels[4] = { row0 + x0, row0 + x1, row1 + x0, row1 + x1 };
+			uint8_t* dst = p_dst + ((size_t)y * p_dstWidth + x) * 4;
+
+			uint32_t sum[4] = { 0, 0, 0, 0 };
+			for (const uint8_t* texel : texels)
+				for (int c = 0; c < 4; c++)
+					sum[c] += texel[c];
+
+			for (int c = 0; c < 4; c++)
+				dst[c] = (uint8_t)((sum[c] + 2) / 4);
+
+			if (p_normalMap)
+			{
+				float n[3];
+				for (int c = 0; c < 3; c++)
+					n[c] = (float)sum[c] / (4.0f * 127.5f) - 1.0f;
+
+				float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length > 1e-5f)
+				{
+					for (int c = 0; c < 3; c++)
+						dst[c] = (uint8_t)std::lround(std::clamp((n[c] / length + 1.0f) * 127.5f, 0.0f, 255.0f));
+				}
+			}
+		}
+	}
+}
+
+// Reads the 4x4 block at p_blockX, p_blockY. Levels that are not a multiple of 4 repeat their edge texels
+static void FetchBlock(const uint8_t* p_level, uint32_t p_width, uint32_t p_height, uint32_t p_blockX, uint32_t p_blockY, uint8_t p_block[16][4])
+{
+	for (uint32_t y = 0; y < 4; y++)
+	{
+		uint32_t sy = (std::min)(p_blockY * 4 + y, p_height - 1);
+		for (uint32_t x = 0; x < 4; x++)
+		{
+			uint32_t sx = (std::min)(p_blockX * 4 + x, p_width - 1);
+			memcpy(p_block[y * 4 + x], p_level + ((size_t)sy * p_width + sx) * 4, 4);
+		}
+	}
+}
+
+// Endpoints spanning the texels along the principal axis of their first p_channels channels
+static void ComputeEndpoints(const uint8_t p_block[16][4], int p_channels, float p_e0[4], float p_e1[4])
+{
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float minC[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	float maxC[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < p_channels; c++)
+		{
+			float value = p_block[i][c];
+			mean[c] += value;
+			minC[c] = (std::min)(minC[c], value);
+			maxC[c] = (std::max)(maxC[c], value);
+		}
+	}
+	for (int c = 0; c < p_channels; c++)
+		mean[c] /= 16.0f;
+
+	float cov[4][4] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		float d[4];
+		for (int c = 0; c < p_channels; c++)
+			d[c] = p_block[i][c] - mean[c];
+		for (int a = 0; a < p_channels; a++)
+			for (int b = 0; b < p_channels; b++)
+				cov[a][b] += d[a] * d[b];
+	}
+
+	// power iteration, starting from the diagonal of the bounding box
+	float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int c = 0; c < p_channels; c++)
+		axis[c] = maxC[c] - minC[c];
+
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float length = 0.0f;
+		for (int a = 0; a < p_channels; a++)
+		{
+			for (int b = 0; b < p_channels; b++)
+				next[a] += cov[a][b] * axis[b];
+			length += next[a] * next[a];
+		}
+
+		if (length < 1e-8f)
+			break;
+
+		length = 1.0f / std::sqrt(length);
+		for (int c = 0; c < p_channels; c++)
+			axis[c] = next[c] * length;
+	}
+
+	float axisLength = 0.0f;
+	for (int c = 0; c < p_channels; c++)
+		axisLength += axis[c] * axis[c];
+
+	// a flat block collapses both endpoints onto the mean
+	float tMin = 0.0f, tMax = 0.0f;
+	if (axisLength > 1e-8f)
+	{
+		axisLength = 1.0f / std::sqrt(axisLength);
+		for (int c = 0; c < p_channels; c++)
+			axis[c] *= axisLength;
+
+		tMin = FLT_MAX;
+		tMax = -FLT_MAX;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < p_channels; c++)
+				t += (p_block[i][c] - mean[c]) * axis[c];
+			tMin = (std::min)(tMin, t);
+			tMax = (std::max)(tMax, t);
+		}
+	}
+
+	for (int c = 0; c < p_channels; c++)
+	{
+		p_e0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+		p_e1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+	}
+}
+
+static uint16_t PackRGB565(const float p_color[3])
+{
+	uint32_t r = (uint32_t)std::lround(p_color[0] * 31.0f / 255.0f);
+	uint32_t g = (uint32_t)std::lround(p_color[1] * 63.0f / 255.0f);
+	uint32_t b = (uint32_t)std::lround(p_color[2] * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t p_packed, int p_color[3])
+{
+	uint32_t r = (p_packed >> 11) & 31;
+	uint32_t g = (p_packed >> 5) & 63;
+	uint32_t b = p_packed & 31;
+	p_color[0] = (int)((r << 3) | (r >> 2));
+	p_color[1] = (int)((g << 2) | (g >> 4));
+	p_color[2] = (int)((b << 3) | (b >> 2));
+}
+
+// BC1 in its opaque four color mode, which needs the first endpoint to be the larger one
+static void EncodeBC1(const uint8_t p_block[16][4], uint8_t* p_out)
+{
+	float e0[4], e1[4];
+	ComputeEndpoints(p_block, 3, e0, e1);
+
+	uint16_t c0 = PackRGB565(e1);
+	uint16_t c1 = PackRGB565(e0);
+	if (c0 < c1)
+		std::swap(c0, c1);
+
+	uint32_t indices = 0;
+	if (c0 != c1)
+	{
+		int palette[4][3];
+		UnpackRGB565(c0, palette[0]);
+		UnpackRGB565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestError = INT32_MAX;
+			uint32_t best = 0;
+			for (uint32_t p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = (int)p_block[i][c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	memcpy(p_out + 0, &c0, sizeof(c0));
+	memcpy(p_out + 2, &c1, sizeof(c1));
+	memcpy(p_out + 4, &indices, sizeof(indices));
+}
+
+// BC4 in its eight value mode. A flat block stores equal endpoints, which decodes index 0 to the first one
+static void EncodeBC4(const uint8_t p_values[16], uint8_t* p_out)
+{
+	int r0 = *std::max_element(p_values, p_values + 16);
+	int r1 = *std::min_element(p_values, p_values + 16);
+
+	uint64_t indices = 0;
+	if (r0 != r1)
+	{
+		int palette[8] = { r0, r1 };
+		for (int p = 2; p < 8; p++)
+			palette[p] = ((8 - p) * r0 + (p - 1) * r1) / 7;
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestError = INT32_MAX;
+			uint64_t best = 0;
+			for (uint64_t p = 0; p < 8; p++)
+			{
+				int error = std::abs((int)p_values[i] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= best << (i * 3);
+		}
+	}
+
+	p_out[0] = (uint8_t)r0;
+	p_out[1] = (uint8_t)r1;
+	for (int i = 0; i < 6; i++)
+		p_out[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+static void EncodeBC4Channel(const uint8_t p_block[16][4], uint32_t p_channel, uint8_t* p_out)
+{
+	uint8_t values[16];
+	for (int i = 0; i < 16; i++)
+		values[i] = p_block[i][p_channel];
+	EncodeBC4(values, p_out);
+}
+
+// Appends bits to a 128 bit block, least significant first
+struct BlockWriter
+{
+	uint8_t*								out;
+	uint32_t								bit;
+
+	void Write(uint32_t p_value, uint32_t p_bits)
+	{
+		for (uint32_t i = 0; i < p_bits; i++, bit++)
+			out[bit / 8] |= (uint8_t)(((p_value >> i) & 1) << (bit % 8));
+	}
+};
+
+// BC7 mode 6: a single subset of RGBA endpoints, 7 bits each plus a p-bit per endpoint, and 4 bit indices.
+// The one mode that handles alpha and color together at full index precision, good for any color texture
+static void EncodeBC7(const uint8_t p_block[16][4], uint8_t* p_out)
+{
+	static const int c_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float endpoints[2][4];
+	ComputeEndpoints(p_block, 4, endpoints[0], endpoints[1]);
+
+	// each endpoint takes the p-bit that reconstructs it best
+	uint32_t quantized[2][4];
+	uint32_t pbits[2];
+	int decoded[2][4];
+	for (int e = 0; e < 2; e++)
+	{
+		float bestError = FLT_MAX;
+		for (uint32_t p = 0; p < 2; p++)
+		{
+			uint32_t q[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				q[c] = (uint32_t)std::clamp((int)std::lround((endpoints[e][c] - (float)p) / 2.0f), 0, 127);
+				float d = (float)((q[c] << 1) | p) - endpoints[e][c];
+				error += d * d;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pbits[e] = p;
+				memcpy(quantized[e], q, sizeof(q));
+			}
+		}
+
+		for (int c = 0; c < 4; c++)
+			decoded[e][c] = (int)((quantized[e][c] << 1) | pbits[e]);
+	}
+
+	int palette[16][4];
+	for (int p = 0; p < 16; p++)
+		for (int c = 0; c < 4; c++)
+			palette[p][c] = ((64 - c_weights[p]) * decoded[0][c] + c_weights[p] * decoded[1][c] + 32) >> 6;
+
+	uint32_t indices[16];
+	for (int i = 0; i < 16; i++)
+	{
+		int bestError = INT32_MAX;
+		for (uint32_t p = 0; p < 16; p++)
+		{
+			int error = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				int d = (int)p_block[i][c] - palette[p][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = p;
+			}
+		}
+	}
+
+	// the most significant bit of the first index is implied 0, swapping the endpoints flips it
+	if (indices[0] & 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pbits[0], pbits[1]);
+		for (auto& index : indices)
+			index = 15 - index;
+	}
+
+	memset(p_out, 0, 16);
+	BlockWriter writer{ p_out, 0 };
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		writer.Write(quantized[0][c], 7);
+		writer.Write(quantized[1][c], 7);
+	}
+	writer.Write(pbits[0], 1);
+	writer.Write(pbits[1], 1);
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < 16; i++)
+		writer.Write(indices[i], 4);
+}
+
+static void EncodeBlock(const uint8_t p_block[16][4], const EncodeParams& p_params, uint8_t* p_out)
+{
+	switch (p_params.encoding)
+	{
+	case te_bc1:
+		EncodeBC1(p_block, p_out);
+		break;
+	case te_bc4:
+		EncodeBC4Channel(p_block, p_params.channels[0], p_out);
+		break;
+	case te_bc5:
+		EncodeBC4Channel(p_block, p_params.channels[0], p_out);
+		EncodeBC4Channel(p_block, p_params.channels[1], p_out + 8);
+		break;
+	default:
+		EncodeBC7(p_block, p_out);
+		break;
+	}
+}
+
+static EncodeParams SelectEncoding(const ImageRaw& p_texture)
+{
+	switch (p_texture.usage)
+	{
+	case tu_normal:
+		// z is rebuilt from x and y in the shaders
+		return EncodeParams{ te_bc5, "rg01", { 0, 1 }, true };
+	case tu_emissive:
+		return EncodeParams{ te_bc1, "rgb1", { 0, 0 }, false };
+	case tu_roughMetal:
+	{
+		// glTF keeps roughness in g and metalness in b, the shaders read both from there through the swizzle.
+		// Metalness is often the same 0 or 1 everywhere, then the view supplies it and roughness goes to BC4
+		const uint8_t* texels = p_texture.raw;
+		size_t texelCount = (size_t)p_texture.width * p_texture.height;
+		uint8_t metal = texels[2];
+		bool uniformMetal = (metal == 0 || metal == 255);
+		for (size_t i = 1; i < texelCount && uniformMetal; i++)
+			uniformMetal = (texels[i * 4 + 2] == metal);
+
+		if (uniformMetal)
+			return EncodeParams{ te_bc4, (metal == 0) ? "0r01" : "0r11", { 1, 1 }, false };
+		return EncodeParams{ te_bc5, "0rg1", { 1, 2 }, false };
+	}
+	default:
+		return EncodeParams{ te_bc7, "rgba", { 0, 0 }, false };
+	}
+}
+
+CTextureCompressor::CTextureCompressor()
+	: m_settings{}
+	, m_threadPool(nullptr)
+	, m_encoded(0)
+	, m_cacheHits(0)
+	, m_transcoded(0)
+	, m_skipped(0)
+{
+}
+
+CTextureCompressor::~CTextureCompressor()
+{
+	Destroy();
+}
+
+bool CTextureCompressor::Create(const Settings& p_settings)
+{
+	m_settings = p_settings;
+
+	if (!m_settings.cacheDir.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_settings.cacheDir, error);
+		if (error)
+		{
+			std::cerr << "CTextureCompressor::Create Error: Failed to create " << m_settings.cacheDir.generic_string() << " - " << error.message() << std::endl;
+			return false;
+		}
+	}
+
+	// A pool of its own, the asset loader thread compresses while the render thread records on the shared one
+	m_threadPool = new CThreadPool();
+	RETURN_FALSE_IF_FALSE(m_threadPool->Create(m_settings.workerCount));
+
+	CLOG("Texture compression at import - " << m_threadPool->GetThreadCount() << " threads"
+		<< (m_settings.cacheDir.empty() ? ", no cache" : ", cache " + m_settings.cacheDir.generic_string()) << std::endl);
+
+	return true;
+}
+
+void CTextureCompressor::Destroy()
+{
+	if (m_threadPool)
+	{
+		m_threadPool->Destroy();
+		delete m_threadPool;
+		m_threadPool = nullptr;
+	}
+}
+
+bool CTextureCompressor::Compress(std::vector<ImageRaw>& p_textures)
+{
+	PROFILE_FUNCTION();
+
+	if (!m_threadPool)
+	{
+		std::cerr << "CTextureCompressor::Compress Error: Not created" << std::endl;
+		return false;
+	}
+
+	Stats before = GetStats();
+
+	CThreadPool::JobGroup textureJobs;
+	for (auto& texture : p_textures)
+	{
+		ImageRaw* texturePtr = &texture;
+		m_threadPool->Submit(textureJobs, [this, texturePtr](uint32_t) { return CompressTexture(*texturePtr); });
+	}
+
+	if (!m_threadPool->Wait(textureJobs))
+	{
+		std::cerr << "CTextureCompressor::Compress Error: Failed to compress textures" << std::endl;
+		return false;
+	}
+
+	Stats after = GetStats();
+	CLOG("Compressed " << (after.encoded - before.encoded) << " textures, " << (after.cacheHits - before.cacheHits) << " from cache, "
+		<< (after.transcoded - before.transcoded) << " transcoded, " << (after.skipped - before.skipped) << " left uncompressed" << std::endl);
+
+	return true;
+}
+
+bool CTextureCompressor::CompressTexture(ImageRaw& p_texture)
+{
+	PROFILE_FUNCTION();
+
+	if (p_texture.encoding == te_basis)
+		return TranscodeTexture(p_texture);
+
+	// Only 8 bit RGBA data is compressed, DDS files hold their own format
+	bool isDDS = (p_texture.fileExtn == "DDS" || p_texture.fileExtn == "dds");
+	if (p_texture.raw == nullptr || p_texture.encoding != te_rgba8 || p_texture.channels != 4 || isDDS ||
+		p_texture.width <= 0 || p_texture.height <= 0)
+	{
+		++m_skipped;
+		return true;
+	}
+
+	EncodeParams params = SelectEncoding(p_texture);
+	uint32_t width = (uint32_t)p_texture.width;
+	uint32_t height = (uint32_t)p_texture.height;
+	uint32_t mipLevels = (std::max)(p_texture.mipLevels, 1u);
+
+	std::filesystem::path cachePath;
+	if (!m_settings.cacheDir.empty())
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		hash = HashWords(hash, p_texture.raw, (size_t)width * height * 4);
+		uint32_t keyOptions[] = { TEXTURE_COMPRESSOR_VERSION, (uint32_t)params.encoding, params.channels[0], params.channels[1], width, height, mipLevels };
+		hash = HashWords(hash, keyOptions, sizeof(keyOptions));
+		hash = HashWords(hash, params.swizzle.data(), params.swizzle.size());
+
+		std::ostringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << hash << ".bc";
+		cachePath = m_settings.cacheDir / name.str();
+
+		ImageRaw cached = p_texture;
+		cached.encoding = params.encoding;
+		cached.swizzle = params.swizzle;
+		cached.mipLevels = mipLevels;
+		if (ReadCache(cachePath, cached))
+		{
+			free(p_texture.raw);
+			p_texture = cached;
+			++m_cacheHits;
+			return true;
+		}
+	}
+
+	// The mip chain, built from the base level down
+	std::vector<std::vector<uint8_t>> mips(mipLevels - 1);
+	std::vector<const uint8_t*> levels(mipLevels);
+	std::vector<uint32_t> levelWidths(mipLevels), levelHeights(mipLevels);
+	std::vector<size_t> levelOffsets(mipLevels);
+	size_t dataSize = 0;
+
+	levels[0] = p_texture.raw;
+	levelWidths[0] = width;
+	levelHeights[0] = height;
+	for (uint32_t mip = 0; mip < mipLevels; mip++)
+	{
+		if (mip > 0)
+		{
+			levelWidths[mip] = (std::max)(levelWidths[mip - 1] / 2, 1u);
+			levelHeights[mip] = (std::max)(levelHeights[mip - 1] / 2, 1u);
+			mips[mip - 1].resize((size_t)levelWidths[mip] * levelHeights[mip] * 4);
+			Downsample(levels[mip - 1], levelWidths[mip - 1], levelHeights[mip - 1], mips[mip - 1].data(), levelWidths[mip], levelHeights[mip], params.normalMap);
+			levels[mip] = mips[mip - 1].data();
+		}
+
+		levelOffsets[mip] = dataSize;
+		dataSize += GetLevelSize(levelWidths[mip], levelHeights[mip], params.encoding);
+	}
+
+	uint8_t* data = (uint8_t*)malloc(dataSize);
+	if (data == nullptr)
+	{
+		std::cerr << "CTextureCompressor::CompressTexture Error: Out of memory - " << p_texture.name << std::endl;
+		return false;
+	}
+
+	// Rows of blocks are encoded as nested jobs, the waiting thread helps with them
+	uint32_t bytesPerBlock = GetBytesPerBlock(params.encoding);
+	CThreadPool::JobGroup blockJobs;
+	for (uint32_t mip = 0; mip < mipLevels; mip++)
+	{
+		uint32_t blocksX = (levelWidths[mip] + 3) / 4;
+		uint32_t blocksY = (levelHeights[mip] + 3) / 4;
+		for (uint32_t firstRow = 0; firstRow < blocksY; firstRow += TEXTURE_COMPRESSOR_ROWS_PER_JOB)
+		{
+			uint32_t lastRow = (std::min)(firstRow + TEXTURE_COMPRESSOR_ROWS_PER_JOB, blocksY);
+			m_threadPool->Submit(blockJobs, [&, mip, blocksX, firstRow, lastRow](uint32_t)
+			{
+				uint8_t block[16][4];
+				for (uint32_t by = firstRow; by < lastRow; by++)
+				{
+					uint8_t* out = data + levelOffsets[mip] + (size_t)by * blocksX * bytesPerBlock;
+					for (uint32_t bx = 0; bx < blocksX; bx++, out += bytesPerBlock)
+					{
+						FetchBlock(levels[mip], levelWidths[mip], levelHeights[mip], bx, by, block);
+						EncodeBlock(block, params, out);
+					}
+				}
+				return true;
+			});
+		}
+	}
+	m_threadPool->Wait(blockJobs);
+
+	free(p_texture.raw);
+	p_texture.raw = data;
+	p_texture.encoding = params.encoding;
+	p_texture.swizzle = params.swizzle;
+	p_texture.mipLevels = mipLevels;
+	p_texture.dataSize = dataSize;
+	++m_encoded;
+
+	if (!cachePath.empty())
+		WriteCache(cachePath, p_texture);
+
+	return true;
+}
+
+// Basis Universal is designed to be transcoded rather than encoded, so the target is picked from the usage alone
+// and nothing is cached. Levels are transcoded as nested jobs, each with a transcoder state of its own
+bool CTextureCompressor::TranscodeTexture(ImageRaw& p_texture)
+{
+#if KTX2_BASIS_TRANSCODING
+	PROFILE_FUNCTION();
+
+	static std::once_flag s_transcoderInit;
+	std::call_once(s_transcoderInit, []() { basist::basisu_transcoder_init(); });
+
+	basist::ktx2_transcoder transcoder;
+	if (!transcoder.init(p_texture.raw, (uint32_t)p_texture.dataSize) || !transcoder.start_transcoding() ||
+		transcoder.get_layers() > 1 || transcoder.get_faces() != 1)
+	{
+		std::cerr << "CTextureCompressor::TranscodeTexture Error: Failed to read KTX2 - " << p_texture.name << std::endl;
+		return false;
+	}
+
+	basist::transcoder_texture_format format = basist::transcoder_texture_format::cTFBC7_RGBA;
+	EncodeParams params{ te_bc7, "rgba", { 0, 0 }, false };
+	switch (p_texture.usage)
+	{
+	case tu_normal:
+		format = basist::transcoder_texture_format::cTFBC5_RG;
+		params = EncodeParams{ te_bc5, "rg01", { 0, 1 }, true };
+		break;
+	case tu_emissive:
+		format = basist::transcoder_texture_format::cTFBC1_RGB;
+		params = EncodeParams{ te_bc1, "rgb1", { 0, 0 }, false };
+		break;
+	case tu_roughMetal:
+		format = basist::transcoder_texture_format::cTFBC5_RG;
+		params = EncodeParams{ te_bc5, "0rg1", { 1, 2 }, false };
+		break;
+	default:
+		break;
+	}
+	int channel0 = (params.encoding == te_bc5) ? (int)params.channels[0] : -1;
+	int channel1 = (params.encoding == te_bc5) ? (int)params.channels[1] : -1;
+
+	uint32_t mipLevels = (std::max)(transcoder.get_levels(), 1u);
+	std::vector<basist::ktx2_image_level_info> levelInfos(mipLevels);
+	std::vector<size_t> levelOffsets(mipLevels);
+	size_t dataSize = 0;
+	for (uint32_t mip = 0; mip < mipLevels; mip++)
+	{
+		if (!transcoder.get_image_level_info(levelInfos[mip], mip, 0, 0))
+		{
+			std::cerr << "CTextureCompressor::TranscodeTexture Error: Failed to read level " << mip << " - " << p_texture.name << std::endl;
+			return false;
+		}
+
+		levelOffsets[mip] = dataSize;
+		dataSize += (size_t)levelInfos[mip].m_total_blocks * GetBytesPerBlock(params.encoding);
+	}
+
+	uint8_t* data = (uint8_t*)malloc(dataSize);
+	if (data == nullptr)
+	{
+		std::cerr << "CTextureCompressor::TranscodeTexture Error: Out of memory - " << p_texture.name << std::endl;
+		return false;
+	}
+
+	CThreadPool::JobGroup levelJobs;
+	for (uint32_t mip = 0; mip < mipLevels; mip++)
+	{
+		m_threadPool->Submit(levelJobs, [&, mip](uint32_t)
+		{
+			basist::ktx2_transcoder_state state;
+			return transcoder.transcode_image_level(mip, 0, 0, data + levelOffsets[mip], levelInfos[mip].m_total_blocks, format,
+				0, 0, 0, channel0, channel1, &state);
+		});
+	}
+
+	if (!m_threadPool->Wait(levelJobs))
+	{
+		free(data);
+		std::cerr << "CTextureCompressor::TranscodeTexture Error: Failed to transcode - " << p_texture.name << std::endl;
+		return false;
+	}
+
+	free(p_texture.raw);
+	p_texture.raw = data;
+	p_texture.width = (int)levelInfos[0].m_orig_width;
+	p_texture.height = (int)levelInfos[0].m_orig_height;
+	p_texture.encoding = params.encoding;
+	p_texture.swizzle = params.swizzle;
+	p_texture.mipLevels = mipLevels;
+	p_texture.dataSize = dataSize;
+	++m_transcoded;
+
+	return true;
+#else
+	// Left as is, the scene falls back to the default texture
+	static std::once_flag s_reportMissing;
+	std::call_once(s_reportMissing, [&]() { CLOG_YELLOW("Basis Universal KTX2 textures need KTX2_BASIS_TRANSCODING - " << p_texture.name << std::endl); });
+	++m_skipped;
+	return true;
+#endif
+}
+
+bool CTextureCompressor::ReadCache(const std::filesystem::path& p_path, ImageRaw& p_texture) const
+{
+	std::ifstream file(p_path, std::ios::binary | std::ios::in | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size < (std::streamsize)sizeof(CacheHeader))
+		return false;
+
+	CacheHeader header{};
+	file.seekg(0, std::ios::beg);
+	file.read((char*)&header, sizeof(header));
+
+	// a truncated, foreign or colliding entry is compressed over
+	if (header.magic != c_cacheMagic || header.version != TEXTURE_COMPRESSOR_VERSION || header.encoding != (uint32_t)p_texture.encoding ||
+		header.width != (uint32_t)p_texture.width || header.height != (uint32_t)p_texture.height || header.mipLevels != p_texture.mipLevels ||
+		std::string(header.swizzle, sizeof(header.swizzle)) != p_texture.swizzle ||
+		header.dataSize != (uint64_t)(size - (std::streamsize)sizeof(CacheHeader)))
+		return false;
+
+	uint8_t* data = (uint8_t*)malloc((size_t)header.dataSize);
+	if (data == nullptr)
+		return false;
+
+	file.read((char*)data, (std::streamsize)header.dataSize);
+	if (file.gcount() != (std::streamsize)header.dataSize)
+	{
+		free(data);
+		return false;
+	}
+
+	p_texture.raw = data;
+	p_texture.dataSize = (size_t)header.dataSize;
+	return true;
+}
+
+void CTextureCompressor::WriteCache(const std::filesystem::path& p_path, const ImageRaw& p_texture) const
+{
+	CacheHeader header{};
+	header.magic = c_cacheMagic;
+	header.version = TEXTURE_COMPRESSOR_VERSION;
+	header.encoding = (uint32_t)p_texture.encoding;
+	header.width = (uint32_t)p_texture.width;
+	header.height = (uint32_t)p_texture.height;
+	header.mipLevels = p_texture.mipLevels;
+	memcpy(header.swizzle, p_texture.swizzle.data(), (std::min)(p_texture.swizzle.size(), sizeof(header.swizzle)));
+	header.dataSize = p_texture.dataSize;
+
+	// two loads of the same texture write the same bytes, the rename makes either one win whole
+	std::ostringstream suffix;
+	suffix << "." << std::hash<std::thread::id>{}(std::this_thread::get_id()) << ".tmp";
+	std::filesystem::path tempPath = p_path;
+	tempPath += suffix.str();
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "CTextureCompressor::WriteCache Error: Failed to open " << tempPath.generic_string() << std::endl;
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)p_texture.raw, (std::streamsize)p_texture.dataSize);
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, p_path, error);
+	if (error)
+		std::filesystem::remove(tempPath, error);
+}
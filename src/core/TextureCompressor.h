@@ -0,0 +1,60 @@
+#pragma once
+
+#include "AssetLoader.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <filesystem>
+
+// Block compresses the RGBA8 scene textures at import, picking the format by the role the materials
+// sample a texture in, see TextureUsage. The mip chain is built on the CPU and compressed along with
+// the base level, so the GPU no longer blits mips at upload. Textures are spread over the worker threads
+// and the blocks of each mip are split in rows of blocks, which keeps every thread busy even when a
+// single large texture is loaded. Results are cached on disk under a hash of the pixels and the options,
+// a texture compressed once is read back on every later load. KTX2 files in the Basis Universal encodings
+// are transcoded to the same formats instead
+class CTextureCompressor
+{
+public:
+	struct Settings
+	{
+		std::filesystem::path			cacheDir;				// empty disables the disk cache
+		uint32_t						workerCount;			// 0 = one per hardware thread minus the calling thread
+	};
+
+	struct Stats
+	{
+		uint32_t						encoded;
+		uint32_t						cacheHits;
+		uint32_t						transcoded;
+		uint32_t						skipped;				// not RGBA8 or already compressed, left untouched
+	};
+
+	CTextureCompressor();
+	~CTextureCompressor();
+
+	bool Create(const Settings& p_settings);
+	void Destroy();
+
+	// Replaces every RGBA8 and Basis Universal texture of the list by its block compressed mip chain. Blocks the calling thread
+	bool Compress(std::vector<ImageRaw>& p_textures);
+
+	// The same for a single texture, may be called from any thread
+	bool CompressTexture(ImageRaw& p_texture);
+
+	bool IsCreated() const { return m_threadPool != nullptr; }
+	Stats GetStats() const { return Stats{ m_encoded, m_cacheHits, m_transcoded, m_skipped }; }
+
+private:
+	Settings							m_settings;
+	CThreadPool*						m_threadPool;
+
+	std::atomic<uint32_t>				m_encoded;
+	std::atomic<uint32_t>				m_cacheHits;
+	std::atomic<uint32_t>				m_transcoded;
+	std::atomic<uint32_t>				m_skipped;
+
+	bool TranscodeTexture(ImageRaw& p_texture);
+	bool ReadCache(const std::filesystem::path& p_path, ImageRaw& p_texture) const;
+	void WriteCache(const std::filesystem::path& p_path, const ImageRaw& p_texture) const;
+};
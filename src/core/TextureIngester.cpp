@@ -0,0 +1,159 @@
+#include "TextureIngester.h"
+#include "TextureCompressor.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+enum TextureState : uint8_t
+{
+	  ts_queued = 0
+	, ts_ready
+	, ts_failed
+};
+
+// Of the base level once decoded, compressed textures take what the file holds
+static size_t GetDecodedSize(const ImageRaw& p_texture)
+{
+	if (p_texture.width <= 0 || p_texture.height <= 0 || (p_texture.raw == nullptr && p_texture.raw_hdr == nullptr))
+		return 0;
+
+	size_t texelCount = (size_t)p_texture.width * p_texture.height;
+	if (p_texture.raw_hdr != nullptr)
+		return texelCount * 4 * sizeof(float);
+	if (p_texture.encoding != te_file && p_texture.dataSize > 0)
+		return p_texture.dataSize;
+	return texelCount * 4;
+}
+
+CTextureIngester::CTextureIngester()
+	: m_settings{}
+	, m_threadPool(nullptr)
+	, m_stats{}
+{
+}
+
+CTextureIngester::~CTextureIngester()
+{
+	Destroy();
+}
+
+bool CTextureIngester::Create(const Settings& p_settings)
+{
+	m_settings = p_settings;
+
+	m_threadPool = new CThreadPool();
+	RETURN_FALSE_IF_FALSE(m_threadPool->Create(m_settings.workerCount));
+
+	CLOG("Texture ingestion - " << m_threadPool->GetWorkerCount() << " decode threads, "
+		<< m_settings.budget / (1024 * 1024) << " MB decoded in flight" << std::endl);
+
+	return true;
+}
+
+void CTextureIngester::Destroy()
+{
+	if (m_threadPool)
+	{
+		m_threadPool->Destroy();
+		delete m_threadPool;
+		m_threadPool = nullptr;
+	}
+}
+
+CTextureIngester::Stats CTextureIngester::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+bool CTextureIngester::Ingest(std::vector<ImageRaw>& p_textures, CTextureCompressor* p_compressor, const StageFunc& p_stage)
+{
+	PROFILE_FUNCTION();
+
+	if (!m_threadPool)
+	{
+		std::cerr << "CTextureIngester::Ingest Error: Not created" << std::endl;
+		return false;
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	Stats stats{ (uint32_t)p_textures.size(), 0, 0, 0.0 };
+
+	bool compress = (p_compressor != nullptr && p_compressor->IsCreated());
+	std::vector<TextureState> states(p_textures.size(), ts_queued);		// guarded by m_readyMutex
+	std::vector<size_t> sizes(p_textures.size(), 0);
+	std::atomic<uint32_t> decoded(0);
+
+	CThreadPool::JobGroup jobs;
+	size_t inFlight = 0;
+	size_t submitted = 0;
+	bool succeeded = true;
+	for (size_t i = 0; i < p_textures.size() && succeeded; i++)
+	{
+		// Starting the textures that follow while they fit the budget. Texture i is in flight by now or starts alone
+		while (submitted < p_textures.size())
+		{
+			size_t size = GetDecodedSize(p_textures[submitted]);
+			if (submitted > i && inFlight + size > m_settings.budget)
+				break;
+
+			sizes[submitted] = size;
+			inFlight += size;
+			stats.peakBytes = (std::max)(stats.peakBytes, inFlight);
+
+			ImageRaw* texture = &p_textures[submitted];
+			TextureState* state = &states[submitted];
+			m_threadPool->Submit(jobs, [this, texture, state, p_compressor, compress, &decoded](uint32_t)
+			{
+				bool encoded = (texture->encoding == te_file);
+				bool processed = DecodeRawImage(*texture) && (!compress || p_compressor->CompressTexture(*texture));
+				if (encoded)
+					decoded++;
+
+				{
+					std::lock_guard<std::mutex> lock(m_readyMutex);
+					*state = processed ? ts_ready : ts_failed;
+				}
+				m_readyCondition.notify_all();
+				return processed;
+			});
+			submitted++;
+		}
+
+		TextureState state;
+		{
+			std::unique_lock<std::mutex> lock(m_readyMutex);
+			m_readyCondition.wait(lock, [&]() { return states[i] != ts_queued; });
+			state = states[i];
+		}
+
+		succeeded = (state == ts_ready) && p_stage(i, p_textures[i]);
+
+		FreeRawImage(p_textures[i]);
+		inFlight -= sizes[i];
+	}
+
+	// the textures still in flight after a failure are freed by the caller, their jobs point into the list until then
+	succeeded &= m_threadPool->Wait(jobs);
+
+	stats.decoded = decoded;
+	stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats = stats;
+	}
+
+	if (!succeeded)
+	{
+		std::cerr << "CTextureIngester::Ingest Error: Failed to ingest textures" << std::endl;
+		return false;
+	}
+
+	CLOG("Ingested " << stats.textureCount << " textures, " << stats.decoded << " decoded, in " << stats.seconds << " s - "
+		<< (double)stats.textureCount / (std::max)(stats.seconds, 1e-6) << " textures/s, peak "
+		<< (double)stats.peakBytes / (1024.0 * 1024.0) << " MB decoded in flight" << std::endl);
+
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "AssetLoader.h"
+#include "ThreadPool.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#define TEXTURE_INGEST_BUDGET_MB				512		// decoded texture data in RAM at once while a scene loads
+
+class CTextureCompressor;
+
+// Decodes, block compresses and stages the textures of a loaded scene as a pipeline. The loaders keep the images
+// encoded, see ObjLoadData::deferDecode, the workers decode and compress them while the calling thread stages the
+// ones already done, in list order, and frees each as soon as its copy is recorded. Textures start decoding in list
+// order only while the decoded data in flight stays under the budget, which bounds the RAM a large scene takes
+// whatever its texture count; a single texture above the budget is let through alone
+class CTextureIngester
+{
+public:
+	struct Settings
+	{
+		size_t							budget;					// bytes of the decoded base levels in flight
+		uint32_t						workerCount;			// 0 = one per hardware thread minus the calling thread
+	};
+
+	// Of the last Ingest
+	struct Stats
+	{
+		uint32_t						textureCount;
+		uint32_t						decoded;				// kept encoded by the loader
+		size_t							peakBytes;				// decoded data in flight
+		double							seconds;
+	};
+
+	// Records the upload of a texture, called on the thread calling Ingest with the index of the texture in the list
+	typedef std::function<bool(size_t p_index, ImageRaw& p_texture)> StageFunc;
+
+	CTextureIngester();
+	~CTextureIngester();
+
+	bool Create(const Settings& p_settings);
+	void Destroy();
+
+	// Runs the list through the pipeline, the compressor is skipped if it is not created. Blocks the calling thread,
+	// which stages the textures; every texture is freed by the time it returns
+	bool Ingest(std::vector<ImageRaw>& p_textures, CTextureCompressor* p_compressor, const StageFunc& p_stage);
+
+	bool IsCreated() const { return m_threadPool != nullptr; }
+	// read by the UI while the scene's loader ingests
+	Stats GetStats() const;
+
+private:
+	Settings							m_settings;
+	CThreadPool*						m_threadPool;
+	Stats								m_stats;
+	mutable std::mutex					m_statsMutex;
+
+	std::mutex							m_readyMutex;
+	std::condition_variable				m_readyCondition;
+};
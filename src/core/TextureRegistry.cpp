@@ -0,0 +1,150 @@
+#include "TextureRegistry.h"
+
+#include <cstring>
+#include <iostream>
+
+CTextureRegistry::CTextureRegistry()
+	: m_references(0)
+{
+}
+
+CTextureRegistry::~CTextureRegistry()
+{
+}
+
+// FNV-1a over 64 bit words with a fold, the size is mixed in so files that only differ by trailing zeros do not collide
+uint64_t CTextureRegistry::HashContent(const void* p_data, size_t p_size)
+{
+	const uint8_t* bytes = (const uint8_t*)p_data;
+	uint64_t hash = 0xcbf29ce484222325ull;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= p_size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * 0x100000001b3ull;
+		hash ^= hash >> 29;
+	}
+	for (; i < p_size; i++)
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	hash = (hash ^ (uint64_t)p_size) * 0x100000001b3ull;
+
+	// 0 stands for no hash in ImageRaw
+	return hash != 0 ? hash : 1;
+}
+
+bool CTextureRegistry::ResolveFile(const std::filesystem::path& p_path, std::string& p_resolved, FileHash& p_file)
+{
+	std::error_code error;
+	std::filesystem::path resolved = std::filesystem::weakly_canonical(p_path, error);
+	if (error)
+		return false;
+
+	p_file.size = std::filesystem::file_size(resolved, error);
+	if (error)
+		return false;
+
+	p_file.writeTime = std::filesystem::last_write_time(resolved, error);
+	if (error)
+		return false;
+
+	p_resolved = resolved.generic_string();
+	return true;
+}
+
+bool CTextureRegistry::FindFileHash(const std::filesystem::path& p_path, uint64_t& p_hash)
+{
+	std::string resolved;
+	FileHash file{};
+	if (!ResolveFile(p_path, resolved, file))
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto fileHash = m_fileHashes.find(resolved);
+	if (fileHash == m_fileHashes.end() || fileHash->second.size != file.size || fileHash->second.writeTime != file.writeTime)
+		return false;
+
+	p_hash = fileHash->second.hash;
+	return true;
+}
+
+void CTextureRegistry::AddFileHash(const std::filesystem::path& p_path, uint64_t p_hash)
+{
+	std::string resolved;
+	FileHash file{};
+	if (!ResolveFile(p_path, resolved, file))
+		return;
+
+	file.hash = p_hash;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_fileHashes[resolved] = file;
+}
+
+uint32_t CTextureRegistry::Find(uint64_t p_hash, TextureUsage p_usage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto entry = m_entries.find(Key{ p_hash, p_usage });
+	return (entry != m_entries.end()) ? entry->second.slot : MAX_SUPPORTED_TEXTURES;
+}
+
+void CTextureRegistry::Add(uint64_t p_hash, TextureUsage p_usage, uint32_t p_slot, const std::string& p_name)
+{
+	Key key{ p_hash, p_usage };
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto entry = m_entries.find(key);
+	if (entry != m_entries.end())
+	{
+		std::cerr << "CTextureRegistry::Add Error: " << p_name << " has the content of " << entry->second.name << ", already added" << std::endl;
+		return;
+	}
+
+	m_entries[key] = Entry{ p_slot, 1, p_name };
+	m_slotToKey[p_slot] = key;
+	m_references++;
+}
+
+uint32_t CTextureRegistry::Acquire(uint64_t p_hash, TextureUsage p_usage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto entry = m_entries.find(Key{ p_hash, p_usage });
+	if (entry == m_entries.end())
+		return MAX_SUPPORTED_TEXTURES;
+
+	entry->second.refCount++;
+	m_references++;
+	return entry->second.slot;
+}
+
+bool CTextureRegistry::Release(uint32_t p_slot)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto slotKey = m_slotToKey.find(p_slot);
+	if (slotKey == m_slotToKey.end())
+		return false;
+
+	auto entry = m_entries.find(slotKey->second);
+	m_references--;
+	if (--entry->second.refCount > 0)
+		return false;
+
+	m_entries.erase(entry);
+	m_slotToKey.erase(slotKey);
+	return true;
+}
+
+void CTextureRegistry::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.clear();
+	m_slotToKey.clear();
+	m_fileHashes.clear();
+	m_references = 0;
+}
+
+CTextureRegistry::Stats CTextureRegistry::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return Stats{ (uint32_t)m_entries.size(), m_references };
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Global.h"
+#include "AssetLoader.h"
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Scene textures by the content of their file and the role they are sampled in, so a texture referenced again
+// in the same role, by the same asset or by another one, shares the bindless slot it was uploaded to and is
+// neither decoded nor uploaded again. The role picks the format and swizzle the texture is uploaded with, see
+// TextureUsage, so the same file in another role is a texture of its own. The loaders hash the encoded bytes
+// of every image and look the hash up once the role is known; files hashed once are remembered by resolved
+// path, size and write time, their repeats are not read at all. Every material list the texture is given to
+// holds a reference
+class CTextureRegistry
+{
+public:
+	struct Stats
+	{
+		uint32_t						textureCount;
+		uint32_t						references;				// from every loaded asset, textureCount of them by the first
+	};
+
+	CTextureRegistry();
+	~CTextureRegistry();
+
+	static uint64_t HashContent(const void* p_data, size_t p_size);
+
+	// Hash of the file from an earlier AddFileHash, false if it was never hashed or changed on disk since
+	bool FindFileHash(const std::filesystem::path& p_path, uint64_t& p_hash);
+	void AddFileHash(const std::filesystem::path& p_path, uint64_t p_hash);
+
+	// Bindless slot of the texture with the content and usage, MAX_SUPPORTED_TEXTURES if none was added. Takes no reference
+	uint32_t Find(uint64_t p_hash, TextureUsage p_usage);
+
+	// A texture just uploaded to p_slot, with its first reference
+	void Add(uint64_t p_hash, TextureUsage p_usage, uint32_t p_slot, const std::string& p_name);
+
+	// Another reference to the texture, returns its slot or MAX_SUPPORTED_TEXTURES if none was added
+	uint32_t Acquire(uint64_t p_hash, TextureUsage p_usage);
+
+	// Drops a reference, true when it was the last and the texture is removed; the slot is then the caller's to reuse
+	bool Release(uint32_t p_slot);
+
+	void Clear();
+
+	Stats GetStats();
+
+private:
+	struct Key
+	{
+		uint64_t						hash;
+		TextureUsage					usage;
+
+		bool operator==(const Key& p_other) const { return hash == p_other.hash && usage == p_other.usage; }
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& p_key) const { return (size_t)(p_key.hash ^ ((uint64_t)p_key.usage << 56)); }
+	};
+
+	struct Entry
+	{
+		uint32_t						slot;
+		uint32_t						refCount;
+		std::string						name;					// of the first file loaded with the content, for logs
+	};
+
+	struct FileHash
+	{
+		uintmax_t						size;
+		std::filesystem::file_time_type	writeTime;
+		uint64_t						hash;
+	};
+
+	std::mutex							m_mutex;
+	std::unordered_map<Key, Entry, KeyHash> m_entries;
+	std::unordered_map<uint32_t, Key>	m_slotToKey;
+	std::unordered_map<std::string, FileHash> m_fileHashes;	// by resolved path
+	uint32_t							m_references;
+
+	static bool ResolveFile(const std::filesystem::path& p_path, std::string& p_resolved, FileHash& p_file);
+};
@@ -0,0 +1,340 @@
+#include "TextureStreamer.h"
+#include "Asset.h"
+#include "Global.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+CTextureStreamer::CTextureStreamer()
+	: m_settings{}
+	, m_cmdPools{}
+	, m_cmdBfr(VK_NULL_HANDLE)
+	, m_frameIdx(0)
+	, m_frame(0)
+	, m_residentBytes(0)
+	, m_streamedIn(0)
+	, m_evicted(0)
+{
+}
+
+CTextureStreamer::~CTextureStreamer()
+{
+}
+
+bool CTextureStreamer::Create(CVulkanRHI* p_rhi, const Settings& p_settings)
+{
+	m_settings = p_settings;
+
+	// One pool per frame in flight, reset once the frame's fence says its uploads are done
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandPool(p_rhi->GetQueueFamiliyIndex(), m_cmdPools[i]));
+
+	return true;
+}
+
+void CTextureStreamer::Destroy(CVulkanRHI* p_rhi)
+{
+	for (auto& entry : m_entries)
+	{
+		DestroyImage(p_rhi, entry.image);
+		FreeRawImage(entry.rawImg);
+	}
+	m_entries.clear();
+	m_slotToEntry.clear();
+
+	for (auto& entry : m_pending)
+		FreeRawImage(entry.rawImg);
+	m_pending.clear();
+
+	for (auto& retired : m_retired)
+	{
+		DestroyImage(p_rhi, retired.image);
+		if (retired.staging.descInfo.buffer != VK_NULL_HANDLE)
+			p_rhi->FreeMemoryDestroyBuffer(retired.staging);
+	}
+	m_retired.clear();
+
+	for (auto& cmdPool : m_cmdPools)
+	{
+		if (cmdPool != VK_NULL_HANDLE)
+			p_rhi->DestroyCommandPool(cmdPool);
+		cmdPool = VK_NULL_HANDLE;
+	}
+
+	m_residentBytes = 0;
+}
+
+uint32_t CTextureStreamer::GetTailMip(const ImageRaw& p_rawImg) const
+{
+	// Textures whose mips are blit at upload have no chain to stream from
+	bool mipsProvided = (p_rawImg.encoding != TextureEncoding::te_rgba8) || p_rawImg.dataSize > 0;
+	if (!IsCreated() || !mipsProvided || p_rawImg.mipLevels <= 1)
+		return 0;
+
+	uint32_t tailMip = 0;
+	while (tailMip + 1 < p_rawImg.mipLevels &&
+		(std::max)((uint32_t)p_rawImg.width >> tailMip, (uint32_t)p_rawImg.height >> tailMip) > m_settings.tailSize)
+		tailMip++;
+
+	return tailMip;
+}
+
+void CTextureStreamer::Register(uint32_t p_slot, ImageRaw& p_rawImg, const CVulkanRHI::Image& p_tail)
+{
+	Entry entry{};
+	entry.slot				= p_slot;
+	entry.rawImg			= p_rawImg;
+	entry.format			= p_tail.format;
+	entry.tail				= p_tail.descInfo;
+	entry.tailMip			= GetTailMip(p_rawImg);
+	entry.residentMip		= entry.tailMip;
+	entry.image.image		= VK_NULL_HANDLE;
+	entry.imageSize			= 0;
+	entry.requestedMip		= (float)entry.tailMip;
+	entry.requestFrame		= 0;
+
+	// The entry owns the pixels now
+	p_rawImg.raw = nullptr;
+
+	std::lock_guard<std::mutex> lock(m_pendingMutex);
+	m_pending.push_back(std::move(entry));
+}
+
+void CTextureStreamer::RequestMip(uint32_t p_slot, float p_pixelsPerUV)
+{
+	if (p_slot >= m_slotToEntry.size() || m_slotToEntry[p_slot] < 0 || p_pixelsPerUV <= 0.0f)
+		return;
+
+	Entry& entry = m_entries[m_slotToEntry[p_slot]];
+
+	// A texel per pixel: the base level fits when the texture spans as many pixels as it has texels
+	float texels = (float)(std::max)(entry.rawImg.width, entry.rawImg.height);
+	float mip = std::log2(texels / p_pixelsPerUV) + m_settings.mipBias;
+
+	if (entry.requestFrame != m_frame || mip < entry.requestedMip)
+		entry.requestedMip = mip;
+	entry.requestFrame = m_frame;
+}
+
+bool CTextureStreamer::Update(CVulkanRHI* p_rhi, CBindlessTextureTable& p_bindlessTable, uint32_t p_frameIdx)
+{
+	PROFILE_FUNCTION();
+
+	// The frame's fence was waited, every frame and upload submitted before the frames in flight is done
+	for (size_t i = 0; i < m_retired.size();)
+	{
+		if (m_retired[i].frame + MAX_FRAMES_IN_FLIGHT <= m_frame)
+		{
+			DestroyImage(p_rhi, m_retired[i].image);
+			if (m_retired[i].staging.descInfo.buffer != VK_NULL_HANDLE)
+				p_rhi->FreeMemoryDestroyBuffer(m_retired[i].staging);
+
+			m_retired[i] = m_retired.back();
+			m_retired.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	// Textures are streamed from the first frame their slot is in the bindless table, their tail is uploaded by then
+	{
+		std::lock_guard<std::mutex> lock(m_pendingMutex);
+		uint32_t stagedCount = p_bindlessTable.GetStagedCount();
+		for (size_t i = 0; i < m_pending.size();)
+		{
+			if (m_pending[i].slot < stagedCount)
+			{
+				if (m_pending[i].slot >= m_slotToEntry.size())
+					m_slotToEntry.resize(m_pending[i].slot + 1, -1);
+
+				m_slotToEntry[m_pending[i].slot] = (int32_t)m_entries.size();
+				m_entries.push_back(std::move(m_pending[i]));
+				m_pending.erase(m_pending.begin() + i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	m_frameIdx = p_frameIdx;
+	m_cmdBfr = VK_NULL_HANDLE;
+	RETURN_FALSE_IF_FALSE(p_rhi->ResetCommandPool(m_cmdPools[p_frameIdx]));
+
+	std::vector<size_t> candidates;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (GetWantedMip(m_entries[i]) < m_entries[i].residentMip)
+			candidates.push_back(i);
+	}
+
+	// The textures missing the most mips first, the ones asked for the finest mip breaking ties
+	std::sort(candidates.begin(), candidates.end(), [this](size_t a, size_t b) {
+		uint32_t gapA = m_entries[a].residentMip - GetWantedMip(m_entries[a]);
+		uint32_t gapB = m_entries[b].residentMip - GetWantedMip(m_entries[b]);
+		if (gapA != gapB)
+			return gapA > gapB;
+		return m_entries[a].requestedMip < m_entries[b].requestedMip;
+	});
+
+	VkDeviceSize uploaded = 0;
+	for (size_t candidate : candidates)
+	{
+		Entry& entry = m_entries[candidate];
+
+		// Settles for a coarser mip than asked for when the chain does not fit this frame's uploads or the budget
+		for (uint32_t mip = GetWantedMip(entry); mip < entry.residentMip; mip++)
+		{
+			VkDeviceSize chainSize = GetChainSize(entry, mip);
+			if (uploaded > 0 && uploaded + chainSize > m_settings.uploadBytesPerFrame)
+				continue;
+
+			if (!MakeRoom(p_rhi, p_bindlessTable, chainSize - entry.imageSize, candidate, uploaded))
+				continue;
+
+			RETURN_FALSE_IF_FALSE(StreamTo(p_rhi, p_bindlessTable, entry, mip, uploaded));
+			break;
+		}
+	}
+
+	// Submitted ahead of the frame on the same queue, the upload's barriers make the images readable to it
+	if (m_cmdBfr != VK_NULL_HANDLE)
+		RETURN_FALSE_IF_FALSE(p_rhi->SubmitCommandBuffer(m_cmdBfr));
+
+	m_frame++;
+	return true;
+}
+
+CTextureStreamer::Stats CTextureStreamer::GetStats() const
+{
+	Stats stats{};
+	stats.textureCount		= (uint32_t)m_entries.size();
+	stats.residentBytes		= m_residentBytes;
+	stats.streamedIn		= m_streamedIn;
+	stats.evicted			= m_evicted;
+	for (const auto& entry : m_entries)
+	{
+		if (entry.residentMip < entry.tailMip)
+			stats.streamedCount++;
+	}
+	return stats;
+}
+
+uint32_t CTextureStreamer::GetWantedMip(const Entry& p_entry) const
+{
+	// Textures not asked for this frame want no more than their tail
+	if (p_entry.requestFrame != m_frame || p_entry.requestedMip >= (float)p_entry.tailMip)
+		return p_entry.tailMip;
+
+	return (p_entry.requestedMip <= 0.0f) ? 0 : (uint32_t)p_entry.requestedMip;
+}
+
+VkDeviceSize CTextureStreamer::GetChainSize(const Entry& p_entry, uint32_t p_firstMip) const
+{
+	uint32_t width = (std::max)((uint32_t)p_entry.rawImg.width >> p_firstMip, 1u);
+	uint32_t height = (std::max)((uint32_t)p_entry.rawImg.height >> p_firstMip, 1u);
+	return CVulkanRHI::Image::GetTextureSizePerLayer(width, height, p_entry.format, p_entry.rawImg.mipLevels - p_firstMip, nullptr);
+}
+
+// Frees budget for p_bytes more. The textures not asked for this frame are dropped to their tail first, the least
+// recently asked for first, then the ones holding finer mips than asked for are cut down to those. Replaced images
+// count as freed right away, though they live on until no frame in flight reads them
+bool CTextureStreamer::MakeRoom(CVulkanRHI* p_rhi, CBindlessTextureTable& p_bindlessTable, VkDeviceSize p_bytes, size_t p_exclude, VkDeviceSize& p_uploaded)
+{
+	while (m_residentBytes + p_bytes > m_settings.budget)
+	{
+		size_t victim = m_entries.size();
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			const Entry& entry = m_entries[i];
+			if (i == p_exclude || entry.residentMip == entry.tailMip || entry.requestFrame == m_frame)
+				continue;
+
+			if (victim == m_entries.size() || entry.requestFrame < m_entries[victim].requestFrame)
+				victim = i;
+		}
+
+		if (victim == m_entries.size())
+		{
+			for (size_t i = 0; i < m_entries.size(); i++)
+			{
+				const Entry& entry = m_entries[i];
+				if (i == p_exclude || GetWantedMip(entry) <= entry.residentMip)
+					continue;
+
+				if (victim == m_entries.size() || entry.imageSize > m_entries[victim].imageSize)
+					victim = i;
+			}
+		}
+
+		if (victim == m_entries.size())
+			return false;
+
+		RETURN_FALSE_IF_FALSE(StreamTo(p_rhi, p_bindlessTable, m_entries[victim], GetWantedMip(m_entries[victim]), p_uploaded));
+	}
+
+	return true;
+}
+
+// Replaces the resident chain of the entry by the one from p_mip on, or by the tail from its tail mip on
+bool CTextureStreamer::StreamTo(CVulkanRHI* p_rhi, CBindlessTextureTable& p_bindlessTable, Entry& p_entry, uint32_t p_mip, VkDeviceSize& p_uploaded)
+{
+	Retired retired{};
+	retired.image.image = VK_NULL_HANDLE;
+	retired.frame = m_frame;
+
+	if (p_entry.residentMip < p_entry.tailMip)
+		retired.image = p_entry.image;
+
+	if (p_mip >= p_entry.tailMip)
+	{
+		RETURN_FALSE_IF_FALSE(p_bindlessTable.Update(p_entry.slot, p_entry.tail));
+
+		m_residentBytes -= p_entry.imageSize;
+		p_entry.image = CVulkanRHI::Image();
+		p_entry.image.image = VK_NULL_HANDLE;
+		p_entry.imageSize = 0;
+		p_entry.residentMip = p_entry.tailMip;
+		m_evicted++;
+	}
+	else
+	{
+		if (m_cmdBfr == VK_NULL_HANDLE)
+			RETURN_FALSE_IF_FALSE(p_rhi->CreateCommandBuffer(m_cmdPools[m_frameIdx], &m_cmdBfr, "Texture Streaming"));
+
+		CVulkanRHI::Image image;
+		RETURN_FALSE_IF_FALSE(CTextures::CreateTextureImage(p_rhi, retired.staging, &p_entry.rawImg, p_entry.format, m_cmdBfr,
+			p_entry.rawImg.name + "_mip" + std::to_string(p_mip), p_mip, image));
+		RETURN_FALSE_IF_FALSE(p_bindlessTable.Update(p_entry.slot, image.descInfo));
+
+		VkDeviceSize chainSize = GetChainSize(p_entry, p_mip);
+		m_residentBytes += chainSize - p_entry.imageSize;
+		p_uploaded += chainSize;
+
+		p_entry.image = image;
+		p_entry.imageSize = chainSize;
+		if (p_mip < p_entry.residentMip)
+			m_streamedIn++;
+		p_entry.residentMip = p_mip;
+	}
+
+	if (retired.image.image != VK_NULL_HANDLE || retired.staging.descInfo.buffer != VK_NULL_HANDLE)
+		m_retired.push_back(retired);
+
+	return true;
+}
+
+void CTextureStreamer::DestroyImage(CVulkanRHI* p_rhi, CVulkanRHI::Image& p_image)
+{
+	if (p_image.image == VK_NULL_HANDLE)
+		return;
+
+	p_rhi->DestroyImage(p_image.image);
+	p_rhi->DestroyImageView(p_image.descInfo.imageView);
+	p_rhi->FreeDeviceMemory(p_image.devMem);
+	p_image.image = VK_NULL_HANDLE;
+}
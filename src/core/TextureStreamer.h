@@ -0,0 +1,113 @@
+#pragma once
+
+#include "VulkanRHI.h"
+#include "AssetLoader.h"
+
+#include <mutex>
+#include <vector>
+
+// 0 uploads every scene texture whole at load
+#if !defined(TEXTURE_STREAMING)
+#define TEXTURE_STREAMING 1
+#endif
+#define TEXTURE_STREAMING_BUDGET_MB				512		// device memory the streamed mip chains may take
+#define TEXTURE_STREAMING_TAIL_SIZE				128		// mips up to this size stay resident from load on
+#define TEXTURE_STREAMING_UPLOAD_MB_PER_FRAME	32
+
+class CBindlessTextureTable;
+
+// Streams the finer mips of the scene textures under a device memory budget. Textures whose mip chain comes
+// with the file, block compressed or KTX2, are loaded with their tail only, the mips no larger than
+// TEXTURE_STREAMING_TAIL_SIZE, and the streamer keeps the whole chain in RAM. Every frame the scene asks for
+// the mip each visible surface needs, from its distance to the camera and the density of its UVs, and the
+// streamer uploads a new image from that mip down for the textures missing it, largest gap first. Textures
+// not asked for the longest are dropped back to their tail when the budget is full. A new image replaces
+// the old one in its bindless slot at once, the old one is destroyed once no frame in flight reads it
+class CTextureStreamer
+{
+public:
+	struct Settings
+	{
+		VkDeviceSize					budget;					// bytes of the streamed images, the tails not included
+		uint32_t						tailSize;
+		VkDeviceSize					uploadBytesPerFrame;	// a single larger chain is still uploaded
+		float							mipBias;				// added to the mip asked for, positive trades sharpness for memory
+	};
+
+	struct Stats
+	{
+		uint32_t						textureCount;			// registered, tails resident
+		uint32_t						streamedCount;			// with finer mips than their tail resident
+		VkDeviceSize					residentBytes;
+		uint32_t						streamedIn;
+		uint32_t						evicted;
+	};
+
+	CTextureStreamer();
+	~CTextureStreamer();
+
+	bool Create(CVulkanRHI* p_rhi, const Settings& p_settings);
+	void Destroy(CVulkanRHI* p_rhi);
+
+	// First mip of the texture to load, 0 if it is loaded whole
+	uint32_t GetTailMip(const ImageRaw& p_rawImg) const;
+
+	// Hands over the mip chain of a bindless slot whose tail, from GetTailMip, is loaded as p_tail; p_rawImg
+	// is left empty. May be called from any thread, the slot is streamed from the first frame it is staged in
+	void Register(uint32_t p_slot, ImageRaw& p_rawImg, const CVulkanRHI::Image& p_tail);
+
+	// A surface samples the slot at p_pixelsPerUV pixels on screen per UV unit. Called before Update, slots
+	// not registered are ignored
+	void RequestMip(uint32_t p_slot, float p_pixelsPerUV);
+
+	// Once per frame, after the frame's fence is waited and before the bindless table is applied to the frame's copy
+	bool Update(CVulkanRHI* p_rhi, CBindlessTextureTable& p_bindlessTable, uint32_t p_frameIdx);
+
+	bool IsCreated() const { return m_cmdPools[0] != VK_NULL_HANDLE; }
+	Stats GetStats() const;
+
+private:
+	struct Entry
+	{
+		uint32_t						slot;
+		ImageRaw						rawImg;
+		VkFormat						format;					// of the tail, the streamed images share it
+		VkDescriptorImageInfo			tail;
+		uint32_t						tailMip;
+		uint32_t						residentMip;			// tailMip while only the tail is resident
+		CVulkanRHI::Image				image;					// from residentMip on, unless only the tail is resident
+		VkDeviceSize					imageSize;
+		float							requestedMip;			// finest asked for in the frame requestFrame
+		uint64_t						requestFrame;
+	};
+
+	struct Retired
+	{
+		CVulkanRHI::Image				image;
+		CVulkanRHI::Buffer				staging;
+		uint64_t						frame;					// replaced in, frames before it may still read the image
+	};
+
+	Settings							m_settings;
+	VkCommandPool						m_cmdPools[MAX_FRAMES_IN_FLIGHT];
+	CVulkanRHI::CommandBuffer			m_cmdBfr;				// recording this frame's uploads, VK_NULL_HANDLE until the first
+	uint32_t							m_frameIdx;
+
+	std::mutex							m_pendingMutex;
+	std::vector<Entry>					m_pending;				// registered, not staged in the bindless table yet
+
+	std::vector<Entry>					m_entries;
+	std::vector<int32_t>				m_slotToEntry;			// -1 for slots not registered
+	std::vector<Retired>				m_retired;
+	uint64_t							m_frame;
+
+	VkDeviceSize						m_residentBytes;
+	uint32_t							m_streamedIn;
+	uint32_t							m_evicted;
+
+	uint32_t GetWantedMip(const Entry& p_entry) const;
+	VkDeviceSize GetChainSize(const Entry& p_entry, uint32_t p_firstMip) const;
+	bool MakeRoom(CVulkanRHI* p_rhi, CBindlessTextureTable& p_bindlessTable, VkDeviceSize p_bytes, size_t p_exclude, VkDeviceSize& p_uploaded);
+	bool StreamTo(CVulkanRHI* p_rhi, CBindlessTextureTable& p_bindlessTable, Entry& p_entry, uint32_t p_mip, VkDeviceSize& p_uploaded);
+	void DestroyImage(CVulkanRHI* p_rhi, CVulkanRHI::Image& p_image);
+};
@@ -0,0 +1,134 @@
+#include "ThreadPool.h"
+#include "Global.h"
+#include "Profiler.h"
+
+static thread_local int32_t tl_workerId = -1;
+
+CThreadPool::CThreadPool()
+	: m_exit(false)
+{
+}
+
+CThreadPool::~CThreadPool()
+{
+	Destroy();
+}
+
+bool CThreadPool::Create(uint32_t p_workerCount)
+{
+	if (p_workerCount == 0)
+	{
+		uint32_t hwThreads = std::thread::hardware_concurrency();
+		p_workerCount = (hwThreads > 1) ? (hwThreads - 1) : 1;
+	}
+
+	m_exit = false;
+	for (uint32_t i = 0; i < p_workerCount; i++)
+		m_workers.emplace_back(&CThreadPool::WorkerLoop, this, i);
+
+	std::clog << "CThreadPool::Create - " << p_workerCount << " worker threads" << std::endl;
+
+	return true;
+}
+
+void CThreadPool::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_wakeCV.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	m_workers.clear();
+	m_jobs.clear();
+}
+
+uint32_t CThreadPool::GetThreadId() const
+{
+	return (tl_workerId >= 0) ? (uint32_t)tl_workerId : GetWorkerCount();
+}
+
+void CThreadPool::Submit(JobGroup& p_group, Job p_job)
+{
+	p_group.pending++;
+
+	// without workers the job is executed right away on the calling thread
+	if (m_workers.empty())
+	{
+		QueuedJob queued{ &p_group, std::move(p_job) };
+		Execute(queued, GetThreadId());
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(QueuedJob{ &p_group, std::move(p_job) });
+	}
+	m_wakeCV.notify_one();
+}
+
+bool CThreadPool::Wait(JobGroup& p_group)
+{
+	uint32_t threadId = GetThreadId();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (p_group.pending > 0)
+	{
+		// help with the queue instead of idling; the job might be one this group is waiting on
+		if (!m_jobs.empty())
+		{
+			QueuedJob queued = std::move(m_jobs.front());
+			m_jobs.pop_front();
+
+			lock.unlock();
+			Execute(queued, threadId);
+			lock.lock();
+			continue;
+		}
+
+		m_wakeCV.wait(lock, [&] { return p_group.pending == 0 || !m_jobs.empty(); });
+	}
+
+	return p_group.succeeded;
+}
+
+void CThreadPool::Execute(QueuedJob& p_job, uint32_t p_threadId)
+{
+	if (!p_job.job(p_threadId))
+		p_job.group->succeeded = false;
+
+	// decrement under the lock so a waiter can not miss the notification between its check and its wait
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		p_job.group->pending--;
+	}
+	m_wakeCV.notify_all();
+}
+
+void CThreadPool::WorkerLoop(uint32_t p_threadId)
+{
+	tl_workerId = (int32_t)p_threadId;
+	PROFILE_THREAD("Worker");
+
+	while (true)
+	{
+		QueuedJob queued;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCV.wait(lock, [&] { return m_exit || !m_jobs.empty(); });
+
+			if (m_exit && m_jobs.empty())
+				return;
+
+			queued = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		Execute(queued, p_threadId);
+	}
+}
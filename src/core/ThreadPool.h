@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a shared job queue. Every thread, including the one that waits on
+// a job group, has a stable thread id in [0, GetThreadCount()] so jobs can index per-thread resources
+// such as command pools without locking. The waiting thread executes queued jobs itself while it waits,
+// so jobs may safely submit and wait on nested job groups
+class CThreadPool
+{
+public:
+	typedef std::function<bool(uint32_t p_threadId)> Job;
+
+	struct JobGroup
+	{
+		std::atomic<uint32_t>			pending;
+		std::atomic<bool>				succeeded;
+
+		JobGroup() : pending(0), succeeded(true) {}
+	};
+
+	CThreadPool();
+	~CThreadPool();
+
+	bool Create(uint32_t p_workerCount = 0);	// 0 = one worker per hardware thread minus the calling thread
+	void Destroy();
+
+	void Submit(JobGroup& p_group, Job p_job);
+	bool Wait(JobGroup& p_group);				// returns false if any job of the group returned false
+
+	uint32_t GetWorkerCount() const { return (uint32_t)m_workers.size(); }
+	uint32_t GetThreadCount() const { return (uint32_t)m_workers.size() + 1; }
+	uint32_t GetThreadId() const;				// worker index, or GetWorkerCount() for any non worker thread
+
+private:
+	struct QueuedJob
+	{
+		JobGroup*						group;
+		Job								job;
+	};
+
+	void WorkerLoop(uint32_t p_threadId);
+	void Execute(QueuedJob& p_job, uint32_t p_threadId);
+
+	std::vector<std::thread>			m_workers;
+	std::deque<QueuedJob>				m_jobs;
+	std::mutex							m_mutex;
+	std::condition_variable				m_wakeCV;
+	bool								m_exit;
+};
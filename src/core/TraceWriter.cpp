@@ -0,0 +1,111 @@
+#include "TraceWriter.h"
+
+#include <fstream>
+#include <iostream>
+
+CTraceWriter::CTraceWriter()
+{
+}
+
+CTraceWriter::~CTraceWriter()
+{
+}
+
+void CTraceWriter::Clear()
+{
+	m_events.clear();
+	m_trackNames.clear();
+	m_threadNames.clear();
+}
+
+void CTraceWriter::AddEvent(const std::string& p_name, const char* p_category, uint32_t p_pid, uint32_t p_tid, double p_startUs, double p_durationUs)
+{
+	m_events.push_back(Event{ p_name, p_category, p_pid, p_tid, p_startUs, p_durationUs });
+}
+
+void CTraceWriter::SetTrackName(uint32_t p_pid, const std::string& p_name)
+{
+	SetName(m_trackNames, p_pid, 0, p_name);
+}
+
+void CTraceWriter::SetThreadName(uint32_t p_pid, uint32_t p_tid, const std::string& p_name)
+{
+	SetName(m_threadNames, p_pid, p_tid, p_name);
+}
+
+void CTraceWriter::SetName(std::vector<Name>& p_names, uint32_t p_pid, uint32_t p_tid, const std::string& p_name)
+{
+	for (auto& name : p_names)
+	{
+		if (name.pid == p_pid && name.tid == p_tid)
+		{
+			name.name = p_name;
+			return;
+		}
+	}
+	p_names.push_back(Name{ p_pid, p_tid, p_name });
+}
+
+bool CTraceWriter::Write(const std::string& p_path) const
+{
+	std::ofstream file(p_path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "CTraceWriter::Write Error: Failed to open " << p_path << std::endl;
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	for (const auto& track : m_trackNames)
+	{
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << track.pid << ",\"args\":{\"name\":\"" << Escape(track.name) << "\"}}";
+		first = false;
+	}
+	for (const auto& thread : m_threadNames)
+	{
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << thread.pid << ",\"tid\":" << thread.tid << ",\"args\":{\"name\":\"" << Escape(thread.name) << "\"}}";
+		first = false;
+	}
+
+	file.precision(3);
+	file << std::fixed;
+	for (const auto& event : m_events)
+	{
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"" << Escape(event.name) << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\""
+			<< ",\"pid\":" << event.pid << ",\"tid\":" << event.tid
+			<< ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+		first = false;
+	}
+
+	file << "\n]}\n";
+
+	if (!file.good())
+	{
+		std::cerr << "CTraceWriter::Write Error: Failed writing " << p_path << std::endl;
+		return false;
+	}
+
+	std::clog << "CTraceWriter::Write - " << m_events.size() << " events written to " << p_path << std::endl;
+
+	return true;
+}
+
+std::string CTraceWriter::Escape(const std::string& p_str)
+{
+	std::string escaped;
+	escaped.reserve(p_str.size());
+	for (char c : p_str)
+	{
+		if (c == '"' || c == '\\')
+			escaped.push_back('\\');
+		if ((unsigned char)c < 0x20)
+			continue;
+		escaped.push_back(c);
+	}
+	return escaped;
+}
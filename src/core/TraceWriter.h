@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Collects complete ("X") events and writes them as Chrome trace JSON, which chrome://tracing and
+// Perfetto load. Every track is a pid/tid pair; CPU zones and GPU passes are written to separate pids
+// so they show up as separate processes in the viewer
+class CTraceWriter
+{
+public:
+	enum ProcessId
+	{
+		  pid_CPU		= 1
+		, pid_GPU		= 2
+	};
+
+	CTraceWriter();
+	~CTraceWriter();
+
+	void Clear();
+	void AddEvent(const std::string& p_name, const char* p_category, uint32_t p_pid, uint32_t p_tid, double p_startUs, double p_durationUs);
+	void SetTrackName(uint32_t p_pid, const std::string& p_name);
+	void SetThreadName(uint32_t p_pid, uint32_t p_tid, const std::string& p_name);
+
+	size_t GetEventCount() const { return m_events.size(); }
+
+	bool Write(const std::string& p_path) const;
+
+private:
+	struct Event
+	{
+		std::string					name;
+		const char*					category;
+		uint32_t					pid;
+		uint32_t					tid;
+		double						startUs;
+		double						durationUs;
+	};
+
+	struct Name
+	{
+		uint32_t					pid;
+		uint32_t					tid;
+		std::string					name;
+	};
+
+	std::vector<Event>				m_events;
+	std::vector<Name>				m_trackNames;
+	std::vector<Name>				m_threadNames;
+
+	static void SetName(std::vector<Name>& p_names, uint32_t p_pid, uint32_t p_tid, const std::string& p_name);
+
+	static std::string Escape(const std::string& p_str);
+};
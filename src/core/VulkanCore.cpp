@@ -1,8 +1,10 @@
 #include <assert.h>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 
 #include "VulkanCore.h"
+#include "FileIO.h"
 
 #if	VULKAN_DEBUG == 1
 VKAPI_ATTR VkBool32 VKAPI_CALL debugUtilsMessengerCallback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
@@ -101,7 +103,17 @@ CVulkanCore::CVulkanCore(const char* p_applicaitonName, int p_renderWidth, int p
 		, m_vkPhysicalDevice(VK_NULL_HANDLE)
 		, m_QFIndex(0)
 		, m_vkSurface(VK_NULL_HANDLE)
+		, m_swapchainImageCount(0)
 		, m_enabledRayTracing(false)
+		, m_timestampPeriod(0.0f)
+		, m_maxBindlessTextures(0)
+		, m_enabledTextureCompressionBC(false)
+		, m_headless(false)
+		, m_headlessImageIndex(0)
+		, m_headlessImageMemory{}
+		, m_allocatedDeviceMemory(0)
+		, m_peakDeviceMemory(0)
+		, m_vkPipelineCache(VK_NULL_HANDLE)
 {}
 
 CVulkanCore::~CVulkanCore()
@@ -111,9 +123,6 @@ CVulkanCore::~CVulkanCore()
 void CVulkanCore::BeginDebugMarker(VkCommandBuffer p_vkCmdBuff, const char* pMsg)
 {
 #if VULKAN_DEBUG_MARKERS == 1
-	if(!m_fpvkCmdBeginDebugUtilsLabel)
-		m_fpvkCmdBeginDebugUtilsLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdBeginDebugUtilsLabelEXT");
-
 	VkDebugUtilsLabelEXT debugLabel{};
 	debugLabel.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
 	debugLabel.pLabelName = pMsg;
@@ -128,9 +137,6 @@ void CVulkanCore::BeginDebugMarker(VkCommandBuffer p_vkCmdBuff, const char* pMsg
 void CVulkanCore::EndDebugMarker(VkCommandBuffer p_vkCmdBuff)
 {
 #if VULKAN_DEBUG_MARKERS == 1
-	if(!m_fpvkCmdEndDebugUtilsLabelEXT)
-		m_fpvkCmdEndDebugUtilsLabelEXT = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdEndDebugUtilsLabelEXT");
-
 	m_fpvkCmdEndDebugUtilsLabelEXT(p_vkCmdBuff);
 #endif
 }
@@ -138,9 +144,6 @@ void CVulkanCore::EndDebugMarker(VkCommandBuffer p_vkCmdBuff)
 void CVulkanCore::InsertMarker(VkCommandBuffer p_vkCmdBuff, const char* pMsg)
 {
 #if VULKAN_DEBUG_MARKERS == 1
-	if(!m_fpvkCmdInsertDebugUtilsLabelEXT)
-		m_fpvkCmdInsertDebugUtilsLabelEXT = (PFN_vkCmdInsertDebugUtilsLabelEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdInsertDebugUtilsLabelEXT");
-
 	VkDebugUtilsLabelEXT debugLabel{};
 	debugLabel.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
 	debugLabel.pLabelName = pMsg;
@@ -155,9 +158,6 @@ void CVulkanCore::InsertMarker(VkCommandBuffer p_vkCmdBuff, const char* pMsg)
 void CVulkanCore::SetDebugName(uint64_t pObject, VkObjectType pObjectType, const char* pName)
 {
 #if VULKAN_DEBUG_MARKERS == 1
-	if(!m_fpVkSetDebugUtilsObjectName)
-		m_fpVkSetDebugUtilsObjectName = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetDeviceProcAddr(m_vkDevice, "vkSetDebugUtilsObjectNameEXT");
-
 	VkDebugUtilsObjectNameInfoEXT name_info = { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
 	name_info.objectType = pObjectType;
 	name_info.objectHandle = pObject;
@@ -168,11 +168,26 @@ void CVulkanCore::SetDebugName(uint64_t pObject, VkObjectType pObjectType, const
 
 void CVulkanCore::cleanUp()
 {
-	for (auto& view : m_swapchainImageViewList)
-		vkDestroyImageView(m_vkDevice, view, nullptr);
+	for (uint32_t i = 0; i < m_swapchainImageCount; i++)
+		vkDestroyImageView(m_vkDevice, m_swapchainImageViewList[i], nullptr);
+
+	if (m_headless)
+	{
+		for (uint32_t i = 0; i < m_swapchainImageCount; i++)
+		{
+			vkDestroyImage(m_vkDevice, m_swapchainImageList[i], nullptr);
+			FreeDeviceMemory(m_headlessImageMemory[i]);
+		}
+	}
+	else
+	{
+		vkDestroySwapchainKHR(m_vkDevice, m_vkSwapchain, nullptr);
+		vkDestroySurfaceKHR(m_vkInstance, m_vkSurface, nullptr);
+	}
+
+	SavePipelineCache();
+	DestroyPipelineCache();
 
-	vkDestroySwapchainKHR(m_vkDevice, m_vkSwapchain, nullptr);
-	vkDestroySurfaceKHR(m_vkInstance, m_vkSurface, nullptr);
 	vkDestroyDevice(m_vkDevice, nullptr);
 
 #if VULKAN_DEBUG == 1
@@ -200,17 +215,49 @@ void CVulkanCore::cleanUp()
 
 bool CVulkanCore::initialize(const InitData& p_initData)
 {
+	m_headless = p_initData.headless;
+
 	if (!CreateInstance(m_applicationName))
 		return false;
 
 	if (!CreateDevice(p_initData.queueType))
 		return false;
 
-	if (!CreateSurface(p_initData.winInstance, p_initData.winHandle))
+#if VULKAN_DEBUG_MARKERS == 1
+	// fetched up front as pipelines, and with them debug names, are created on worker threads and command buffers,
+	// with their labels, are recorded on them
+	m_fpvkCmdBeginDebugUtilsLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdBeginDebugUtilsLabelEXT");
+	m_fpvkCmdEndDebugUtilsLabelEXT = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdEndDebugUtilsLabelEXT");
+	m_fpvkCmdInsertDebugUtilsLabelEXT = (PFN_vkCmdInsertDebugUtilsLabelEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdInsertDebugUtilsLabelEXT");
+	m_fpVkSetDebugUtilsObjectName = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetDeviceProcAddr(m_vkDevice, "vkSetDebugUtilsObjectNameEXT");
+#endif
+
+	if (!CreatePipelineCache())
 		return false;
 
-	if (!CreateSwapChain(p_initData.swapchainImageFormat, p_initData.swapChaineImageUsage))
+#if RUNTIME_SHADER_COMPILATION == 1
+	CShaderCompiler::Settings compilerSettings{};
+	compilerSettings.sourceDir = g_EnginePath / "shaders/glsl";
+	compilerSettings.cacheDir = g_EnginePath / "shaders/cache";
+	compilerSettings.optimize = (RUNTIME_SHADER_OPTIMIZATION == 1);
+	compilerSettings.debugInfo = false;
+	if (!m_shaderCompiler.Create(compilerSettings))
 		return false;
+#endif
+
+	if (m_headless)
+	{
+		if (!CreateHeadlessSwapChain(p_initData.swapchainImageFormat, p_initData.swapChaineImageUsage))
+			return false;
+	}
+	else
+	{
+		if (!CreateSurface(p_initData.winInstance, p_initData.winHandle))
+			return false;
+
+		if (!CreateSwapChain(p_initData.swapchainImageFormat, p_initData.swapChaineImageUsage))
+			return false;
+	}
 
 	if (!CreateSwapChainImages(p_initData.swapchainImageFormat))
 		return false;
@@ -225,8 +272,11 @@ bool CVulkanCore::CreateInstance(const char* p_applicaitonName)
 	// Brute force setting up instance layers and extensions; instance creation will fail if layers are
 	// not supported
 	std::vector<const char*> instanceExtensionList;
-	instanceExtensionList.push_back("VK_KHR_win32_surface");
-	instanceExtensionList.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+	if (!m_headless)
+	{
+		instanceExtensionList.push_back("VK_KHR_win32_surface");
+		instanceExtensionList.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+	}
 	instanceExtensionList.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
 #if VULKAN_DEBUG == 1
@@ -334,6 +384,8 @@ bool CVulkanCore::CreateInstance(const char* p_applicaitonName)
 
 bool SelectAvailablePhysicalDevice(const std::vector<VkPhysicalDevice>& p_all, VkPhysicalDevice& p_selected)
 {
+	// software rasterizers like lavapipe report as CPU devices, only taken when there is no GPU
+	VkPhysicalDevice fallback = VK_NULL_HANDLE;
 	for(const auto& physicalDevice : p_all)
 	{
 		VkPhysicalDeviceProperties deviceProperties{};
@@ -352,6 +404,18 @@ bool SelectAvailablePhysicalDevice(const std::vector<VkPhysicalDevice>& p_all, V
 			p_selected = physicalDevice;
 			CLOG_YELLOW("Selected GPU - INTEGRATED - " << deviceProperties.deviceName << std::endl);
 		}
+		else if (fallback == VK_NULL_HANDLE)
+		{
+			fallback = physicalDevice;
+		}
+	}
+
+	if (p_selected == VK_NULL_HANDLE && fallback != VK_NULL_HANDLE)
+	{
+		VkPhysicalDeviceProperties deviceProperties{};
+		vkGetPhysicalDeviceProperties(fallback, &deviceProperties);
+		p_selected = fallback;
+		CLOG_YELLOW("Selected GPU - OTHER - " << deviceProperties.deviceName << std::endl);
 	}
 
 	if (p_selected == VK_NULL_HANDLE)
@@ -427,7 +491,6 @@ bool CVulkanCore::CreateDevice(VkQueueFlagBits p_queueType)
 		bool isAccelerationStructureFound = false;
 		bool isRayQueryFound = false;
 		
-		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 		CLOG("Checking support for requested device extensions" << std::endl);
 		for (std::vector<const char*>::iterator requestedExtension = deviceExtensionList.begin(); requestedExtension != deviceExtensionList.end(); requestedExtension++)
 		{
@@ -497,6 +560,34 @@ bool CVulkanCore::CreateDevice(VkQueueFlagBits p_queueType)
 	{
 		vkGetPhysicalDeviceMemoryProperties(m_vkPhysicalDevice, &m_vkPhysicalDeviceMemProp);
 
+		// 0 leaves GPU timestamps unsupported
+		VkPhysicalDeviceProperties deviceProperties{};
+		vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &deviceProperties);
+		m_timestampPeriod = deviceProperties.limits.timestampComputeAndGraphics ? deviceProperties.limits.timestampPeriod : 0.0f;
+
+		// The bindless texture table takes what the update after bind limits allow, less what the other
+		// bindings of a pipeline may sample in the same stage
+		VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+		vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+		VkPhysicalDeviceProperties2 deviceProperties2{};
+		deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		deviceProperties2.pNext = &vulkan12Properties;
+		vkGetPhysicalDeviceProperties2(m_vkPhysicalDevice, &deviceProperties2);
+
+		uint32_t sampledImageLimit = (std::min)(vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages, vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages);
+		sampledImageLimit = (std::min)(sampledImageLimit, vulkan12Properties.maxPerStageUpdateAfterBindResources);
+		m_maxBindlessTextures = (sampledImageLimit > BINDLESS_RESERVED_DESCRIPTORS) ? (std::min)(sampledImageLimit - BINDLESS_RESERVED_DESCRIPTORS, (uint32_t)MAX_SUPPORTED_TEXTURES) : 0;
+		CLOG("Bindless Texture Slots - " << m_maxBindlessTextures << std::endl);
+
+		// Scene textures are block compressed at import when the device can sample BC formats
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures(m_vkPhysicalDevice, &supportedFeatures);
+		m_enabledTextureCompressionBC = (supportedFeatures.textureCompressionBC == VK_TRUE);
+		if (!m_enabledTextureCompressionBC)
+		{
+			CLOG_YELLOW("BC Texture Compression Not Supported" << std::endl);
+		}
+
 		uint32_t queueFamilyCount;
 		vkGetPhysicalDeviceQueueFamilyProperties(m_vkPhysicalDevice, &queueFamilyCount, nullptr);
 		std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
@@ -543,11 +634,18 @@ bool CVulkanCore::CreateDevice(VkQueueFlagBits p_queueType)
 	enabledFeatures.shaderStorageImageReadWithoutFormat					= VK_TRUE;
 	enabledFeatures.shaderStorageImageWriteWithoutFormat				= VK_TRUE;
 	enabledFeatures.vertexPipelineStoresAndAtomics						= VK_TRUE;
+	enabledFeatures.textureCompressionBC								= m_enabledTextureCompressionBC ? VK_TRUE : VK_FALSE;
 
 	VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
 	physicalDeviceFeatures2.sType										= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
 	physicalDeviceFeatures2.features									= enabledFeatures;
 	physicalDeviceFeatures2.pNext										= &dynamicRenderingFeatures;
+
+	// Enable support for vkCmdPipelineBarrier2, used by the render graph to batch barriers
+	VkPhysicalDeviceSynchronization2Features synchronization2Features{};
+	synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+	synchronization2Features.synchronization2							= VK_TRUE;
+	synchronization2Features.pNext										= &physicalDeviceFeatures2;
 			
 	// Enable Vulakn 1.2 Features
 	VkPhysicalDeviceVulkan12Features vulkan12Features{};
@@ -564,7 +662,9 @@ bool CVulkanCore::CreateDevice(VkQueueFlagBits p_queueType)
 	vulkan12Features.descriptorBindingUpdateUnusedWhilePending			= VK_TRUE;
 	vulkan12Features.separateDepthStencilLayouts						= VK_TRUE;
 	vulkan12Features.descriptorIndexing									= VK_TRUE;
-	vulkan12Features.pNext												= &physicalDeviceFeatures2;
+	vulkan12Features.timelineSemaphore									= VK_TRUE;
+	vulkan12Features.hostQueryReset										= VK_TRUE;
+	vulkan12Features.pNext												= &synchronization2Features;
 
 	VkDeviceCreateInfo deviceCreateInfo{};
 	deviceCreateInfo.sType												= VkStructureType::VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -650,6 +750,7 @@ bool CVulkanCore::CreateDevice(VkQueueFlagBits p_queueType)
 
 bool CVulkanCore::CreateSurface(HINSTANCE p_hnstns, HWND p_Hwnd)
 {
+#if defined(_WIN32)
 	VkWin32SurfaceCreateInfoKHR createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
 	createInfo.hinstance = p_hnstns;
@@ -663,19 +764,35 @@ bool CVulkanCore::CreateSurface(HINSTANCE p_hnstns, HWND p_Hwnd)
 	}
 
 	return true;
+#else
+	std::cerr << "CVulkanCore::CreateSurface Error: Only Win32 surfaces are supported, run headless instead" << std::endl;
+	return false;
+#endif
 }
 
 bool CVulkanCore::CreateSwapChain(VkFormat p_format, VkImageUsageFlags p_imageUsage)
 {
-	// Brute-forcing swapchain count to 2 without querying for capabilities
+	// Asking for one swapchain image per frame that can be in flight, within the surface's limits
 	// Forcing presentation mode to immediate without querying for support
 	VkPresentModeKHR presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
 
+	VkSurfaceCapabilitiesKHR surfaceCaps{};
+	VkResult res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_vkPhysicalDevice, m_vkSurface, &surfaceCaps);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkGetPhysicalDeviceSurfaceCapabilitiesKHR failed: " << res << std::endl;
+		return false;
+	}
+
+	uint32_t minImageCount = (surfaceCaps.minImageCount > MAX_FRAMES_IN_FLIGHT) ? surfaceCaps.minImageCount : MAX_FRAMES_IN_FLIGHT;
+	if (surfaceCaps.maxImageCount > 0 && minImageCount > surfaceCaps.maxImageCount)
+		minImageCount = surfaceCaps.maxImageCount;
+
 	VkSwapchainCreateInfoKHR swapChainCreateInfo{};
 	swapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
 	swapChainCreateInfo.pNext = nullptr;
 	swapChainCreateInfo.surface = m_vkSurface;
-	swapChainCreateInfo.minImageCount = FRAME_BUFFER_COUNT;
+	swapChainCreateInfo.minImageCount = minImageCount;
 	swapChainCreateInfo.imageFormat = p_format;
 	swapChainCreateInfo.imageColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
 	swapChainCreateInfo.imageExtent.height = m_renderHeight;
@@ -690,35 +807,84 @@ bool CVulkanCore::CreateSwapChain(VkFormat p_format, VkImageUsageFlags p_imageUs
 	swapChainCreateInfo.presentMode = presentMode;
 	swapChainCreateInfo.clipped = VK_TRUE;
 	swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
-	VkResult res = vkCreateSwapchainKHR(m_vkDevice, &swapChainCreateInfo, nullptr, &m_vkSwapchain);
+	res = vkCreateSwapchainKHR(m_vkDevice, &swapChainCreateInfo, nullptr, &m_vkSwapchain);
 	if (res != VK_SUCCESS)
 	{
 		std::cerr << "vkCreateSwapchainKHR failed: " << res << std::endl;
 		return false;
 	}
 
-	uint32_t scCount = FRAME_BUFFER_COUNT;
-	res = vkGetSwapchainImagesKHR(m_vkDevice, m_vkSwapchain, &scCount, nullptr);
+	// the driver is free to create more images than asked for
+	res = vkGetSwapchainImagesKHR(m_vkDevice, m_vkSwapchain, &m_swapchainImageCount, nullptr);
 	if (res != VK_SUCCESS)
 	{
 		std::cerr << "vkGetSwapchainImagesKHR failed: " << res << std::endl;
 		return false;
 	}
 
+	if (m_swapchainImageCount > MAX_SWAPCHAIN_IMAGES)
+	{
+		std::cerr << "CVulkanCore::CreateSwapChain Error: " << m_swapchainImageCount << " swapchain images, supporting up to " << MAX_SWAPCHAIN_IMAGES << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Offscreen images standing in for the swapchain, one per frame that can be in flight like the
+// image count asked of a real swapchain
+bool CVulkanCore::CreateHeadlessSwapChain(VkFormat p_format, VkImageUsageFlags p_imageUsage)
+{
+	m_swapchainImageCount = MAX_FRAMES_IN_FLIGHT;
+	for (uint32_t i = 0; i < m_swapchainImageCount; i++)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = p_format;
+		imageInfo.extent = VkExtent3D{ m_renderWidth, m_renderHeight, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = p_imageUsage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkResult res = vkCreateImage(m_vkDevice, &imageInfo, nullptr, &m_swapchainImageList[i]);
+		if (res != VK_SUCCESS)
+		{
+			std::cerr << "CVulkanCore::CreateHeadlessSwapChain Error: vkCreateImage failed " << res << std::endl;
+			return false;
+		}
+
+		VkMemoryRequirements memReq{};
+		GetImageMemoryRequirements(m_swapchainImageList[i], memReq);
+		RETURN_FALSE_IF_FALSE(AllocateMemory(memReq, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_headlessImageMemory[i]));
+		RETURN_FALSE_IF_FALSE(BindImageMemory(m_swapchainImageList[i], m_headlessImageMemory[i]));
+
+		SetDebugName((uint64_t)m_swapchainImageList[i], VkObjectType::VK_OBJECT_TYPE_IMAGE, ("Headless Swapchain " + std::to_string(i)).c_str());
+	}
+
+	CLOG_YELLOW("Running headless, " << m_swapchainImageCount << " offscreen swapchain images of " << m_renderWidth << "x" << m_renderHeight << std::endl);
+
 	return true;
 }
 
 bool CVulkanCore::CreateSwapChainImages(VkFormat p_format)
 {
-	uint32_t scCount = FRAME_BUFFER_COUNT;
-	VkResult res = vkGetSwapchainImagesKHR(m_vkDevice, m_vkSwapchain, &scCount, m_swapchainImageList);
-	if (res != VK_SUCCESS)
+	VkResult res = VK_SUCCESS;
+	if (!m_headless)
 	{
-		std::cerr << "vkGetSwapchainImagesKHR failed: " << res << std::endl;
-		return false;
+		uint32_t scCount = m_swapchainImageCount;
+		res = vkGetSwapchainImagesKHR(m_vkDevice, m_vkSwapchain, &scCount, m_swapchainImageList);
+		if (res != VK_SUCCESS)
+		{
+			std::cerr << "vkGetSwapchainImagesKHR failed: " << res << std::endl;
+			return false;
+		}
 	}
 
-	for (int it = 0; it != FRAME_BUFFER_COUNT; ++it)
+	for (uint32_t it = 0; it != m_swapchainImageCount; ++it)
 	{
 		VkImageViewCreateInfo l_vkSwapChainImageViewInfo{};
 		l_vkSwapChainImageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -746,39 +912,45 @@ bool CVulkanCore::CreateSwapChainImages(VkFormat p_format)
 	return true;
 }
 
-// for now there is an offline glsl to spirv compiler in place but will later update this with
-// a runtime compiler
-bool CVulkanCore::LoadShader(const char* p_shaderpath, VkShaderModule& p_shader)
+// With RUNTIME_SHADER_COMPILATION the GLSL source is compiled, or taken from the shader cache. Without it
+// the SPIR-V compiled offline by glsl_to_spirv.py is loaded
+bool CVulkanCore::LoadShader(const std::filesystem::path& p_shaderpath, const std::vector<std::string>& p_defines, VkShaderModule& p_shader)
 {
-	std::size_t found = std::string(p_shaderpath).find_last_of(".");
-	if (found == std::string::npos)
+	VkShaderModuleCreateInfo shaderCreateInfo{};
+	shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+#if RUNTIME_SHADER_COMPILATION == 1
+	std::vector<uint32_t> spirv;
+	if (!m_shaderCompiler.Compile(GetShaderSource(p_shaderpath), p_defines, spirv))
 	{
-		std::cerr << "Invalid shader path - " << p_shaderpath << std::endl;
+		std::cerr << "Failed to compile shader - " << p_shaderpath.generic_string() << std::endl;
 		return false;
 	}
 
-	std::string fileExtension = std::string(p_shaderpath).substr(found + 1);
-	if (std::strcmp(fileExtension.c_str(), "spv") != 0)
+	shaderCreateInfo.codeSize = spirv.size() * sizeof(uint32_t);
+	shaderCreateInfo.pCode = spirv.data();
+
+	VkResult res = vkCreateShaderModule(m_vkDevice, &shaderCreateInfo, nullptr, &p_shader);
+#else
+	if (p_shaderpath.extension() != ".spv")
 	{
-		std::cerr << "Invalid shader type - " << p_shaderpath << std::endl;
+		std::cerr << "Invalid shader type - " << p_shaderpath.generic_string() << std::endl;
 		return false;
 	}
 
-	size_t fileSize = 0;
-	char* shaderBlob = BinaryLoader(p_shaderpath, fileSize);
-	if (shaderBlob == nullptr)
+	// mapped or read into a buffer of the view, either is aligned for the SPIR-V words
+	CFileView shaderBlob;
+	if (!shaderBlob.Open(p_shaderpath.string().c_str()) || shaderBlob.GetSize() == 0)
 	{
-		std::cerr << "Failed to load shader blob - " << p_shaderpath << std::endl;
+		std::cerr << "Failed to load shader blob - " << p_shaderpath.generic_string() << std::endl;
 		return false;
 	}
 
-	VkShaderModuleCreateInfo shaderCreateInfo{};
-	shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderCreateInfo.codeSize = fileSize;
-	shaderCreateInfo.pCode = (uint32_t*)shaderBlob;
+	shaderCreateInfo.codeSize = shaderBlob.GetSize();
+	shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderBlob.GetData());
 
 	VkResult res = vkCreateShaderModule(m_vkDevice, &shaderCreateInfo, nullptr, &p_shader);
-	delete[] shaderBlob;
+#endif
 
 	if (res != VK_SUCCESS)
 	{
@@ -789,6 +961,22 @@ bool CVulkanCore::LoadShader(const char* p_shaderpath, VkShaderModule& p_shader)
 	return true;
 }
 
+std::filesystem::path CVulkanCore::GetShaderSource(const std::filesystem::path& p_shaderpath)
+{
+	if (p_shaderpath.extension() != ".spv")
+		return p_shaderpath;
+
+	// <name>.<stage>.spv, the stem keeps the stage
+	return p_shaderpath.parent_path().parent_path() / "glsl" / p_shaderpath.stem();
+}
+
+void CVulkanCore::GetOutdatedShaderSources(std::vector<std::filesystem::path>& p_sources)
+{
+#if RUNTIME_SHADER_COMPILATION == 1
+	m_shaderCompiler.GetOutdatedSources(p_sources);
+#endif
+}
+
 // as the draw will happen using the compute queue, there is not going to be any renderpass
 // when creating the frame buffer
 bool CVulkanCore::CreateFramebuffer(VkRenderPass p_renderPass, VkFramebuffer& p_frameBuffer, 
@@ -821,6 +1009,27 @@ void CVulkanCore::DestroyFramebuffer(VkFramebuffer p_framebuffer)
 
 bool CVulkanCore::AcquireNextSwapChain(VkSemaphore p_semaphore, uint32_t& p_swapChainID)
 {
+	if (m_headless)
+	{
+		// round robin over the offscreen images; the acquire semaphore still has to be signaled as
+		// the frame's submission waits on it
+		p_swapChainID = m_headlessImageIndex;
+		m_headlessImageIndex = (m_headlessImageIndex + 1) % m_swapchainImageCount;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &p_semaphore;
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		VkResult res = vkQueueSubmit(m_vkQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		if (res != VK_SUCCESS)
+		{
+			std::cerr << "CVulkanCore::AcquireNextSwapChain Error: vkQueueSubmit failed " << res << std::endl;
+			return false;
+		}
+		return true;
+	}
+
 	VkResult res = vkAcquireNextImageKHR(m_vkDevice, m_vkSwapchain, UINT64_MAX, p_semaphore, VK_NULL_HANDLE, &p_swapChainID);
 	if (res != VK_SUCCESS)
 	{
@@ -831,6 +1040,32 @@ bool CVulkanCore::AcquireNextSwapChain(VkSemaphore p_semaphore, uint32_t& p_swap
 	return true;
 }
 
+bool CVulkanCore::PresentHeadless(VkSemaphore p_waitSemaphore)
+{
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores = &p_waitSemaphore;
+	submitInfo.pWaitDstStageMask = &waitStage;
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	VkResult res = vkQueueSubmit(m_vkQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "CVulkanCore::PresentHeadless Error: vkQueueSubmit failed " << res << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+VkResult CVulkanCore::QueuePresent(const VkPresentInfoKHR& p_presentInfo)
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	return vkQueuePresentKHR(m_vkQueue, &p_presentInfo);
+}
+
 bool CVulkanCore::CreateCommandPool(uint32_t p_qfIndex, VkCommandPool& p_cmdPool)
 {
 	VkCommandPoolCreateInfo commandPoolCreateInfo{};
@@ -865,12 +1100,12 @@ void CVulkanCore::DestroyCommandPool(VkCommandPool p_cmdPool)
 	vkDestroyCommandPool(m_vkDevice, p_cmdPool, nullptr);
 }
 
-bool CVulkanCore::CreateCommandBuffers(VkCommandPool p_cmdPool, VkCommandBuffer* p_cmdBuffers, uint32_t p_cbCount, std::string* p_debugNames)
+bool CVulkanCore::CreateCommandBuffers(VkCommandPool p_cmdPool, VkCommandBuffer* p_cmdBuffers, uint32_t p_cbCount, std::string* p_debugNames, VkCommandBufferLevel p_level)
 {
 	VkCommandBufferAllocateInfo cmdBfrAllocInfo{};
 	cmdBfrAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	cmdBfrAllocInfo.commandPool = p_cmdPool;
-	cmdBfrAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cmdBfrAllocInfo.level = p_level;
 	cmdBfrAllocInfo.commandBufferCount = p_cbCount;
 	VkResult res = vkAllocateCommandBuffers(m_vkDevice, &cmdBfrAllocInfo, p_cmdBuffers);
 	if (res != VK_SUCCESS)
@@ -961,6 +1196,35 @@ void CVulkanCore::DestroyDescriptorSetLayout(VkDescriptorSetLayout p_descLayput)
 	vkDestroyDescriptorSetLayout(m_vkDevice, p_descLayput, nullptr);
 }
 
+bool CVulkanCore::CreateDescriptorUpdateTemplate(const VkDescriptorUpdateTemplateEntry* p_entries, uint32_t p_entryCount, VkDescriptorSetLayout p_descLayout, VkDescriptorUpdateTemplate& p_template)
+{
+	VkDescriptorUpdateTemplateCreateInfo templateCreateInfo{};
+	templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateCreateInfo.descriptorUpdateEntryCount = p_entryCount;
+	templateCreateInfo.pDescriptorUpdateEntries = p_entries;
+	templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateCreateInfo.descriptorSetLayout = p_descLayout;
+
+	VkResult res = vkCreateDescriptorUpdateTemplate(m_vkDevice, &templateCreateInfo, nullptr, &p_template);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkCreateDescriptorUpdateTemplate failed: " << res << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void CVulkanCore::UpdateDescriptorSetWithTemplate(VkDescriptorSet p_descSet, VkDescriptorUpdateTemplate p_template, const void* p_data)
+{
+	vkUpdateDescriptorSetWithTemplate(m_vkDevice, p_descSet, p_template, p_data);
+}
+
+void CVulkanCore::DestroyDescriptorUpdateTemplate(VkDescriptorUpdateTemplate p_template)
+{
+	vkDestroyDescriptorUpdateTemplate(m_vkDevice, p_template, nullptr);
+}
+
 bool CVulkanCore::CreatePipelineLayout(VkPushConstantRange* p_pushConstants, uint32_t p_pcCount,
 	VkDescriptorSetLayout* p_descLayouts, uint32_t p_dlCount,
 	VkPipelineLayout& p_vkPipelineLayout, std::string p_debugName)
@@ -1033,7 +1297,7 @@ void CVulkanCore::SetClearColorValue(Renderpass& p_renderpass, uint32_t p_attach
 	p_renderpass.colorClearValue[p_attachmentIndex] = p_colorClearValue;
 }
 
-void CVulkanCore::BeginRenderpass(VkFramebuffer p_frameBfr, const Renderpass& p_renderpass, VkCommandBuffer& p_cmdBfr)
+void CVulkanCore::BeginRenderpass(VkFramebuffer p_frameBfr, const Renderpass& p_renderpass, VkCommandBuffer& p_cmdBfr, VkSubpassContents p_contents)
 {
 	std::vector<VkClearValue> clear;
 	for (auto colorClear : p_renderpass.colorClearValue)
@@ -1059,7 +1323,7 @@ void CVulkanCore::BeginRenderpass(VkFramebuffer p_frameBfr, const Renderpass& p_
 	renderpassBegin.renderArea.extent.height = p_renderpass.framebufferHeight;
 	renderpassBegin.renderArea.offset = { 0, 0 };
 	renderpassBegin.renderPass = p_renderpass.renderpass;
-	vkCmdBeginRenderPass(p_cmdBfr, &renderpassBegin, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(p_cmdBfr, &renderpassBegin, p_contents);
 }
 
 void CVulkanCore::EndRenderPass(VkCommandBuffer& p_cmdBfr)
@@ -1114,13 +1378,13 @@ bool CVulkanCore::CreateGraphicsPipeline(const ShaderPaths& p_shaderPaths, Pipel
 	CLOG("Creating Graphics Pipeline - " << p_debugName << std::endl);
 
 	pData.vertexShader = VK_NULL_HANDLE;
-	if (p_shaderPaths.shaderpath_vertex == "" || !LoadShader(p_shaderPaths.shaderpath_vertex.string().c_str(), pData.vertexShader))
+	if (p_shaderPaths.shaderpath_vertex == "" || !LoadShader(p_shaderPaths.shaderpath_vertex, p_shaderPaths.defines, pData.vertexShader))
 		return false;
 
 	pData.fragmentShader = VK_NULL_HANDLE;
 	if (p_shaderPaths.shaderpath_fragment != "")
 	{
-		if (!LoadShader(p_shaderPaths.shaderpath_fragment.string().c_str(), pData.fragmentShader))
+		if (!LoadShader(p_shaderPaths.shaderpath_fragment, p_shaderPaths.defines, pData.fragmentShader))
 			return false;
 	}
 
@@ -1141,12 +1405,21 @@ bool CVulkanCore::CreateGraphicsPipeline(const ShaderPaths& p_shaderPaths, Pipel
 		vertInInfo.vertexAttributeDescriptionCount	= (uint32_t)pData.vertexAttributeDesc.size();
 	}
 
+	// Shaders without the constant ignore it
+	VkSpecializationMapEntry featureEntry{ FEATURE_PERMUTATION_ID, 0, sizeof(uint32_t) };
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount			= 1;
+	specializationInfo.pMapEntries				= &featureEntry;
+	specializationInfo.dataSize					= sizeof(uint32_t);
+	specializationInfo.pData					= &pData.features;
+
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStageCreateInfo;
 	VkPipelineShaderStageCreateInfo shaderCreateInfo{};
 	shaderCreateInfo.sType						= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderCreateInfo.stage						= VK_SHADER_STAGE_VERTEX_BIT;
 	shaderCreateInfo.module						= pData.vertexShader;
 	shaderCreateInfo.pName						= "main";
+	shaderCreateInfo.pSpecializationInfo		= &specializationInfo;
 	shaderStageCreateInfo.push_back(shaderCreateInfo);
 
 	if (pData.fragmentShader != VK_NULL_HANDLE)
@@ -1156,6 +1429,7 @@ bool CVulkanCore::CreateGraphicsPipeline(const ShaderPaths& p_shaderPaths, Pipel
 		shaderCreateInfo.stage					= VK_SHADER_STAGE_FRAGMENT_BIT;
 		shaderCreateInfo.module					= pData.fragmentShader;
 		shaderCreateInfo.pName					= "main";
+		shaderCreateInfo.pSpecializationInfo	= &specializationInfo;
 		shaderStageCreateInfo.push_back(shaderCreateInfo);
 	}
 
@@ -1297,7 +1571,7 @@ bool CVulkanCore::CreateGraphicsPipeline(const ShaderPaths& p_shaderPaths, Pipel
 	gfxPipelineCreateInfo.layout				= pData.pipeLayout;
 	gfxPipelineCreateInfo.renderPass			= pData.renderpassData.renderpass;
 
-	VkResult res = vkCreateGraphicsPipelines(m_vkDevice, VK_NULL_HANDLE, 1, &gfxPipelineCreateInfo, nullptr, &pData.pipeline);
+	VkResult res = vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &gfxPipelineCreateInfo, nullptr, &pData.pipeline);
 	if (res != VK_SUCCESS)
 	{
 		std::cerr << "vkCreateGraphicsPipelines failed: " << res << std::endl;
@@ -1306,6 +1580,11 @@ bool CVulkanCore::CreateGraphicsPipeline(const ShaderPaths& p_shaderPaths, Pipel
 
 	SetDebugName((uint64_t)pData.pipeline, VK_OBJECT_TYPE_PIPELINE, p_debugName.c_str());
 
+	{
+		std::lock_guard<std::mutex> lock(m_pipelineShaderMutex);
+		m_pipelineShaders[pData.pipeline] = PipelineShaders{ p_shaderPaths, p_debugName };
+	}
+
 	return true;
 }
 
@@ -1315,22 +1594,30 @@ bool CVulkanCore::CreateComputePipeline(const ShaderPaths& p_shaderPaths, Pipeli
 
 	// load shader and get shader module
 	p_pData.computeShader = VK_NULL_HANDLE;
-	if (!LoadShader(p_shaderPaths.shaderpath_compute.string().c_str(), p_pData.computeShader))
+	if (!LoadShader(p_shaderPaths.shaderpath_compute, p_shaderPaths.defines, p_pData.computeShader))
 		return false;
 
+	// Shaders without the constant ignore it
+	VkSpecializationMapEntry featureEntry{ FEATURE_PERMUTATION_ID, 0, sizeof(uint32_t) };
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &featureEntry;
+	specializationInfo.dataSize = sizeof(uint32_t);
+	specializationInfo.pData = &p_pData.features;
+
 	VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo{};
 	pipelineShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	pipelineShaderStageCreateInfo.flags = 0;
 	pipelineShaderStageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
 	pipelineShaderStageCreateInfo.module = p_pData.computeShader;
 	pipelineShaderStageCreateInfo.pName = "main";
-	pipelineShaderStageCreateInfo.pSpecializationInfo = nullptr;
+	pipelineShaderStageCreateInfo.pSpecializationInfo = &specializationInfo;
 
 	VkComputePipelineCreateInfo computePipelineInfo{};
 	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
 	computePipelineInfo.layout = p_pData.pipeLayout;
 	computePipelineInfo.stage = pipelineShaderStageCreateInfo;
-	VkResult res = vkCreateComputePipelines(m_vkDevice, VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &p_pData.pipeline);
+	VkResult res = vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineInfo, nullptr, &p_pData.pipeline);
 	if (res != VK_SUCCESS)
 	{
 		std::cerr << "vkCreateComputePipelines failed: " << res << std::endl;
@@ -1339,23 +1626,287 @@ bool CVulkanCore::CreateComputePipeline(const ShaderPaths& p_shaderPaths, Pipeli
 
 	SetDebugName((uint64_t)p_pData.pipeline, VK_OBJECT_TYPE_PIPELINE, p_debugName.c_str());
 
+	{
+		std::lock_guard<std::mutex> lock(m_pipelineShaderMutex);
+		m_pipelineShaders[p_pData.pipeline] = PipelineShaders{ p_shaderPaths, p_debugName };
+	}
+
 	return true;
 }
 
 void CVulkanCore::DestroyPipeline(Pipeline& p_pipeline)
 {
-	if (p_pipeline.vertexShader != VK_NULL_HANDLE)
-		vkDestroyShaderModule(m_vkDevice, p_pipeline.vertexShader, nullptr);
+	DestroyPipelineLayout(p_pipeline.pipeLayout);
+	DestroyPipelinePermutation(p_pipeline);
+}
+
+bool CVulkanCore::CreatePipelinePermutation(const Pipeline& p_source, uint32_t p_features, Pipeline& p_permutation)
+{
+	PipelineShaders shaders;
+	{
+		std::lock_guard<std::mutex> lock(m_pipelineShaderMutex);
+		auto found = m_pipelineShaders.find(p_source.pipeline);
+		if (found == m_pipelineShaders.end())
+		{
+			std::cerr << "CVulkanCore::CreatePipelinePermutation Error: the source pipeline was not created by CVulkanCore" << std::endl;
+			return false;
+		}
+		shaders = found->second;
+	}
 
-	if (p_pipeline.fragmentShader != VK_NULL_HANDLE)
-		vkDestroyShaderModule(m_vkDevice, p_pipeline.fragmentShader, nullptr);
+	// the permutations of a pipeline are told apart by their feature suffix, the first one has none
+	std::string debugName = shaders.debugName.substr(0, shaders.debugName.find('#'));
+	debugName += "#" + std::to_string(p_features);
 
-	if (p_pipeline.computeShader != VK_NULL_HANDLE)
-		vkDestroyShaderModule(m_vkDevice, p_pipeline.computeShader, nullptr);
-	
-	DestroyPipelineLayout(p_pipeline.pipeLayout);
+	Pipeline permutation = p_source;
+	permutation.features = p_features;
+	bool isCompute = !shaders.paths.shaderpath_compute.empty();
+	bool created = isCompute ? CreateComputePipeline(shaders.paths, permutation, debugName) : CreateGraphicsPipeline(shaders.paths, permutation, debugName);
+	if (!created)
+	{
+		for (VkShaderModule shader : { permutation.vertexShader, permutation.fragmentShader, permutation.computeShader })
+		{
+			if (shader != VK_NULL_HANDLE && shader != p_source.vertexShader && shader != p_source.fragmentShader && shader != p_source.computeShader)
+				vkDestroyShaderModule(m_vkDevice, shader, nullptr);
+		}
+		return false;
+	}
+
+	p_permutation = permutation;
+	return true;
+}
+
+void CVulkanCore::DestroyPipelinePermutation(Pipeline& p_permutation)
+{
+	if (p_permutation.vertexShader != VK_NULL_HANDLE)
+		vkDestroyShaderModule(m_vkDevice, p_permutation.vertexShader, nullptr);
+
+	if (p_permutation.fragmentShader != VK_NULL_HANDLE)
+		vkDestroyShaderModule(m_vkDevice, p_permutation.fragmentShader, nullptr);
+
+	if (p_permutation.computeShader != VK_NULL_HANDLE)
+		vkDestroyShaderModule(m_vkDevice, p_permutation.computeShader, nullptr);
+
+	vkDestroyPipeline(m_vkDevice, p_permutation.pipeline, nullptr);
+
+	std::lock_guard<std::mutex> lock(m_pipelineShaderMutex);
+	m_pipelineShaders.erase(p_permutation.pipeline);
+}
+
+bool CVulkanCore::ReloadPipeline(Pipeline& p_pipeline, const std::vector<std::filesystem::path>& p_sources)
+{
+	PipelineShaders shaders;
+	{
+		std::lock_guard<std::mutex> lock(m_pipelineShaderMutex);
+		auto found = m_pipelineShaders.find(p_pipeline.pipeline);
+		if (found == m_pipelineShaders.end())
+			return false;
+		shaders = found->second;
+	}
+
+	bool outdated = false;
+	for (const std::filesystem::path* shaderpath : { &shaders.paths.shaderpath_vertex, &shaders.paths.shaderpath_fragment, &shaders.paths.shaderpath_compute })
+	{
+		if (shaderpath->empty())
+			continue;
+
+		std::string source = GetShaderSource(*shaderpath).generic_string();
+		for (const auto& changed : p_sources)
+			outdated |= (changed.generic_string() == source);
+	}
+
+	if (!outdated)
+		return false;
+
+	// everything but the shaders and the pipeline itself, the layout and render pass included, is kept
+	Pipeline reloaded = p_pipeline;
+	bool isCompute = !shaders.paths.shaderpath_compute.empty();
+	bool created = isCompute ? CreateComputePipeline(shaders.paths, reloaded, shaders.debugName) : CreateGraphicsPipeline(shaders.paths, reloaded, shaders.debugName);
+	if (!created)
+	{
+		for (VkShaderModule shader : { reloaded.vertexShader, reloaded.fragmentShader, reloaded.computeShader })
+		{
+			if (shader != VK_NULL_HANDLE && shader != p_pipeline.vertexShader && shader != p_pipeline.fragmentShader && shader != p_pipeline.computeShader)
+				vkDestroyShaderModule(m_vkDevice, shader, nullptr);
+		}
+
+		std::cerr << "CVulkanCore::ReloadPipeline Error: " << shaders.debugName << " failed to build, the previous pipeline stays in use" << std::endl;
+		return false;
+	}
 
-	vkDestroyPipeline(m_vkDevice, p_pipeline.pipeline, nullptr);
+	// the layout stays, it is the one the reloaded pipeline uses
+	DestroyPipelinePermutation(p_pipeline);
+	p_pipeline = reloaded;
+
+	CLOG_GREEN("Reloaded " << shaders.debugName << std::endl);
+
+	return true;
+}
+
+// The cache file starts with the identity of the device and driver it was written by. The driver validates
+// its own header as well, but a cache from another driver version is at best useless, so it is dropped here
+struct PipelineCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+};
+
+static const uint32_t s_pipelineCacheMagic = 0x43505646;		// "FVPC"
+
+bool CVulkanCore::CreatePipelineCache()
+{
+	std::vector<char> cacheData;
+
+#if VULKAN_PIPELINE_CACHE == 1
+	VkPhysicalDeviceProperties deviceProperties{};
+	vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &deviceProperties);
+
+	m_pipelineCachePath = g_EnginePath / ("pipeline_cache_" + std::to_string(deviceProperties.vendorID) + "_" + std::to_string(deviceProperties.deviceID) + ".bin");
+
+	std::ifstream file(m_pipelineCachePath, std::ios::binary | std::ios::in);
+	if (file.is_open())
+	{
+		PipelineCacheFileHeader header{};
+		file.read((char*)&header, sizeof(header));
+
+		bool valid = file.good()
+			&& header.magic == s_pipelineCacheMagic
+			&& header.vendorID == deviceProperties.vendorID
+			&& header.deviceID == deviceProperties.deviceID
+			&& header.driverVersion == deviceProperties.driverVersion
+			&& memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0
+			&& header.dataSize >= sizeof(VkPipelineCacheHeaderVersionOne);
+
+		if (valid)
+		{
+			cacheData.resize((size_t)header.dataSize);
+			file.read(cacheData.data(), (std::streamsize)cacheData.size());
+			valid = (file.gcount() == (std::streamsize)cacheData.size());
+		}
+
+		if (valid)
+		{
+			VkPipelineCacheHeaderVersionOne cacheHeader{};
+			memcpy(&cacheHeader, cacheData.data(), sizeof(cacheHeader));
+			valid = cacheHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+				&& cacheHeader.vendorID == deviceProperties.vendorID
+				&& cacheHeader.deviceID == deviceProperties.deviceID
+				&& memcmp(cacheHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+
+		if (valid)
+		{
+			CLOG("Pipeline cache loaded - " << m_pipelineCachePath.generic_string() << " (" << cacheData.size() << " bytes)" << std::endl);
+		}
+		else
+		{
+			CLOG_YELLOW("Pipeline cache discarded, written by another device or driver - " << m_pipelineCachePath.generic_string() << std::endl);
+			cacheData.clear();
+		}
+	}
+#endif
+
+	VkPipelineCacheCreateInfo cacheCreateInfo{};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheCreateInfo.initialDataSize = cacheData.size();
+	cacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+	VkResult res = vkCreatePipelineCache(m_vkDevice, &cacheCreateInfo, nullptr, &m_vkPipelineCache);
+	if (res != VK_SUCCESS && !cacheData.empty())
+	{
+		// the driver is free to reject data it does not like, start over with an empty cache
+		std::cerr << "vkCreatePipelineCache failed with the cached data: " << res << ", retrying empty" << std::endl;
+		cacheCreateInfo.initialDataSize = 0;
+		cacheCreateInfo.pInitialData = nullptr;
+		res = vkCreatePipelineCache(m_vkDevice, &cacheCreateInfo, nullptr, &m_vkPipelineCache);
+	}
+
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkCreatePipelineCache failed: " << res << std::endl;
+		return false;
+	}
+
+	SetDebugName((uint64_t)m_vkPipelineCache, VK_OBJECT_TYPE_PIPELINE_CACHE, "PipelineCache");
+
+	return true;
+}
+
+bool CVulkanCore::SavePipelineCache()
+{
+#if VULKAN_PIPELINE_CACHE == 1
+	if (m_vkPipelineCache == VK_NULL_HANDLE)
+		return false;
+
+	size_t dataSize = 0;
+	VkResult res = vkGetPipelineCacheData(m_vkDevice, m_vkPipelineCache, &dataSize, nullptr);
+	if (res != VK_SUCCESS || dataSize == 0)
+	{
+		std::cerr << "vkGetPipelineCacheData failed: " << res << std::endl;
+		return false;
+	}
+
+	std::vector<char> cacheData(dataSize);
+	res = vkGetPipelineCacheData(m_vkDevice, m_vkPipelineCache, &dataSize, cacheData.data());
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkGetPipelineCacheData failed: " << res << std::endl;
+		return false;
+	}
+
+	VkPhysicalDeviceProperties deviceProperties{};
+	vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &deviceProperties);
+
+	PipelineCacheFileHeader header{};
+	header.magic = s_pipelineCacheMagic;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+
+	// written aside and moved over the old cache, a crash half way through never leaves a truncated cache behind
+	std::filesystem::path tempPath = m_pipelineCachePath;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "CVulkanCore::SavePipelineCache Error: Failed to open " << tempPath.generic_string() << std::endl;
+			return false;
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write(cacheData.data(), (std::streamsize)dataSize);
+		if (!file.good())
+		{
+			std::cerr << "CVulkanCore::SavePipelineCache Error: Failed to write " << tempPath.generic_string() << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_pipelineCachePath, error);
+	if (error)
+	{
+		std::cerr << "CVulkanCore::SavePipelineCache Error: Failed to replace " << m_pipelineCachePath.generic_string() << " - " << error.message() << std::endl;
+		return false;
+	}
+
+	CLOG("Pipeline cache saved - " << m_pipelineCachePath.generic_string() << " (" << dataSize << " bytes)" << std::endl);
+#endif
+
+	return true;
+}
+
+void CVulkanCore::DestroyPipelineCache()
+{
+	vkDestroyPipelineCache(m_vkDevice, m_vkPipelineCache, nullptr);
+	m_vkPipelineCache = VK_NULL_HANDLE;
 }
 
 bool CVulkanCore::CreateSemaphor(VkSemaphore& p_semaphore, std::string p_dbgName)
@@ -1379,6 +1930,55 @@ void CVulkanCore::DestroySemaphore(VkSemaphore p_semaphore)
 	vkDestroySemaphore(m_vkDevice, p_semaphore, nullptr);
 }
 
+bool CVulkanCore::CreateTimelineSemaphore(VkSemaphore& p_semaphore, uint64_t p_initialValue, std::string p_dbgName)
+{
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo{};
+	semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeInfo.initialValue = p_initialValue;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo{};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &semaphoreTypeInfo;
+	VkResult res = vkCreateSemaphore(m_vkDevice, &semaphoreCreateInfo, nullptr, &p_semaphore);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkCreateSemaphore failed: " << res << std::endl;
+		return false;
+	}
+
+	SetDebugName((uint64_t)p_semaphore, VkObjectType::VK_OBJECT_TYPE_SEMAPHORE, p_dbgName.c_str());
+
+	return true;
+}
+
+bool CVulkanCore::WaitTimelineSemaphore(VkSemaphore p_semaphore, uint64_t p_value)
+{
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &p_semaphore;
+	waitInfo.pValues = &p_value;
+	VkResult res = vkWaitSemaphores(m_vkDevice, &waitInfo, UINT64_MAX);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkWaitSemaphores failed: " << res << std::endl;
+		return false;
+	}
+	return true;
+}
+
+uint64_t CVulkanCore::GetTimelineSemaphoreValue(VkSemaphore p_semaphore)
+{
+	uint64_t value = 0;
+	VkResult res = vkGetSemaphoreCounterValue(m_vkDevice, p_semaphore, &value);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkGetSemaphoreCounterValue failed: " << res << std::endl;
+	}
+	return value;
+}
+
 bool CVulkanCore::CreateFence(VkFenceCreateFlags p_flags, VkFence& p_fence, std::string p_dbgName)
 {
 	VkFenceCreateInfo fenceinfo{};
@@ -1423,6 +2023,55 @@ void CVulkanCore::DestroyFence(VkFence p_fence)
 	vkDestroyFence(m_vkDevice, p_fence, nullptr);
 }
 
+bool CVulkanCore::CreateTimestampQueryPool(VkQueryPool& p_queryPool, uint32_t p_queryCount, std::string p_dbgName)
+{
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = p_queryCount;
+	VkResult res = vkCreateQueryPool(m_vkDevice, &queryPoolInfo, nullptr, &p_queryPool);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkCreateQueryPool failed: " << res << std::endl;
+		return false;
+	}
+
+	SetDebugName((uint64_t)p_queryPool, VkObjectType::VK_OBJECT_TYPE_QUERY_POOL, p_dbgName.c_str());
+
+	// queries have to be reset before their first use
+	ResetQueryPool(p_queryPool, 0, p_queryCount);
+
+	return true;
+}
+
+void CVulkanCore::DestroyQueryPool(VkQueryPool p_queryPool)
+{
+	vkDestroyQueryPool(m_vkDevice, p_queryPool, nullptr);
+}
+
+// Host side reset, only valid once the GPU is done with the queries
+void CVulkanCore::ResetQueryPool(VkQueryPool p_queryPool, uint32_t p_firstQuery, uint32_t p_queryCount)
+{
+	vkResetQueryPool(m_vkDevice, p_queryPool, p_firstQuery, p_queryCount);
+}
+
+// Does not wait; false if any of the queries is not available yet
+bool CVulkanCore::GetQueryPoolResults(VkQueryPool p_queryPool, uint32_t p_firstQuery, uint32_t p_queryCount, uint64_t* p_results)
+{
+	VkResult res = vkGetQueryPoolResults(m_vkDevice, p_queryPool, p_firstQuery, p_queryCount, 
+		p_queryCount * sizeof(uint64_t), p_results, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (res != VK_SUCCESS && res != VK_NOT_READY)
+	{
+		std::cerr << "vkGetQueryPoolResults failed: " << res << std::endl;
+	}
+	return (res == VK_SUCCESS);
+}
+
+void CVulkanCore::WriteTimestamp(VkCommandBuffer p_cmdBfr, VkPipelineStageFlagBits p_stage, VkQueryPool p_queryPool, uint32_t p_query)
+{
+	vkCmdWriteTimestamp(p_cmdBfr, p_stage, p_queryPool, p_query);
+}
+
 bool CVulkanCore::BeginCommandBuffer(VkCommandBuffer& p_cmdBfr, const char* p_debugMarker)
 {
 	VkCommandBufferBeginInfo l_cmdBufferBeginInfo{};
@@ -1439,6 +2088,25 @@ bool CVulkanCore::BeginCommandBuffer(VkCommandBuffer& p_cmdBfr, const char* p_de
 	return true;
 }
 
+// Secondary command buffers continue the render pass (or dynamic rendering scope) of the primary
+// they are executed from; the inheritance info describes that pass
+bool CVulkanCore::BeginSecondaryCommandBuffer(VkCommandBuffer& p_cmdBfr, const VkCommandBufferInheritanceInfo& p_inheritance, const char* p_debugMarker)
+{
+	VkCommandBufferBeginInfo l_cmdBufferBeginInfo{};
+	l_cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	l_cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	l_cmdBufferBeginInfo.pInheritanceInfo = &p_inheritance;
+
+	VkResult res = vkBeginCommandBuffer(p_cmdBfr, &l_cmdBufferBeginInfo);
+	if (res != VK_SUCCESS)
+	{
+		std::cerr << "vkBeginCommandBuffer failed: " << p_debugMarker << " : " << res << std::endl;
+		return false;
+	}
+	BeginDebugMarker(p_cmdBfr, p_debugMarker);
+	return true;
+}
+
 bool CVulkanCore::EndCommandBuffer(VkCommandBuffer& p_cmdBfr)
 {
 	EndDebugMarker(p_cmdBfr);
@@ -1455,6 +2123,7 @@ bool CVulkanCore::EndCommandBuffer(VkCommandBuffer& p_cmdBfr)
 
 bool CVulkanCore::SubmitCommandbuffer(VkQueue p_queue, VkSubmitInfo* p_subInfoList, uint32_t p_subInfoCount, VkFence p_fence)
 {
+	std::lock_guard<std::mutex> lock(m_queueMutex);
 	VkResult res = vkQueueSubmit(p_queue, p_subInfoCount, p_subInfoList, p_fence);
 	if (res != VK_SUCCESS)
 	{
@@ -1479,6 +2148,7 @@ bool CVulkanCore::ResetCommandBuffer(VkCommandBuffer p_cmdBfr)
 
 bool CVulkanCore::WaitToFinish(VkQueue p_queue)
 {
+	std::lock_guard<std::mutex> lock(m_queueMutex);
 	VkResult res = vkQueueWaitIdle(p_queue);
 	if (res != VK_SUCCESS)
 	{
@@ -1614,6 +2284,19 @@ void CVulkanCore::IssueImageLayoutBarrier(	VkImageLayout p_old, VkImageLayout p_
 		1, &imgMemBarrier);
 }
 
+void CVulkanCore::IssuePipelineBarrier2(const VkImageMemoryBarrier2* p_imageBarriers, uint32_t p_imageBarrierCount, VkCommandBuffer p_cmdBfr)
+{
+	if (p_imageBarrierCount == 0)
+		return;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = p_imageBarrierCount;
+	dependencyInfo.pImageMemoryBarriers = p_imageBarriers;
+
+	vkCmdPipelineBarrier2(p_cmdBfr, &dependencyInfo);
+}
+
 void CVulkanCore::IssueBufferBarrier(
 	VkAccessFlags p_srcAcc, VkAccessFlags p_dstAcc, 
 	VkPipelineStageFlags p_srcStg, VkPipelineStageFlags p_dstStg, 
@@ -1691,12 +2374,22 @@ bool CVulkanCore::AllocateImageMemory(VkImage p_image, VkMemoryPropertyFlags p_m
 	VkMemoryRequirements memReq;
 	vkGetImageMemoryRequirements(m_vkDevice, p_image, &memReq);
 
+	return AllocateMemory(memReq, p_memFlags, p_devMem);
+}
+
+void CVulkanCore::GetImageMemoryRequirements(VkImage p_image, VkMemoryRequirements& p_memReq)
+{
+	vkGetImageMemoryRequirements(m_vkDevice, p_image, &p_memReq);
+}
+
+bool CVulkanCore::AllocateMemory(const VkMemoryRequirements& p_memReq, VkMemoryPropertyFlags p_memFlags, VkDeviceMemory& p_devMem)
+{
 	// memory type index
-	uint32_t memIndex = FindMemoryTypeIndex(m_vkPhysicalDeviceMemProp, &memReq, p_memFlags);
+	uint32_t memIndex = FindMemoryTypeIndex(m_vkPhysicalDeviceMemProp, &p_memReq, p_memFlags);
 
 	VkMemoryAllocateInfo memAllocInfo{};
 	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAllocInfo.allocationSize = memReq.size;
+	memAllocInfo.allocationSize = p_memReq.size;
 	memAllocInfo.memoryTypeIndex = memIndex;
 
 	// allocate memory
@@ -1706,6 +2399,8 @@ bool CVulkanCore::AllocateImageMemory(VkImage p_image, VkMemoryPropertyFlags p_m
 		std::cerr << "vkAllocateMemory for image failed " << res << std::endl;
 		return false;
 	}
+
+	TrackAllocation(p_devMem, p_memReq.size);
 	return true;
 
 }
@@ -1723,7 +2418,7 @@ bool CVulkanCore::BindImageMemory(VkImage& p_image, VkDeviceMemory& p_devMem)
 }
 
 bool CVulkanCore::CreateImagView(VkImageUsageFlags p_usage, VkImage p_image, VkFormat p_format, 
-	VkImageViewType p_viewType, uint32_t p_levelCount, VkImageView& p_imgView)
+	VkImageViewType p_viewType, uint32_t p_levelCount, VkImageView& p_imgView, VkComponentMapping p_swizzle)
 {
 	VkImageAspectFlags aspectFlag = VK_IMAGE_ASPECT_COLOR_BIT;
 	if (p_usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
@@ -1736,6 +2431,7 @@ bool CVulkanCore::CreateImagView(VkImageUsageFlags p_usage, VkImage p_image, VkF
 	imgviewCreateInfo.image = p_image;
 	imgviewCreateInfo.viewType = p_viewType;
 	imgviewCreateInfo.format = p_format;
+	imgviewCreateInfo.components = p_swizzle;
 	imgviewCreateInfo.subresourceRange.aspectMask = aspectFlag;
 	imgviewCreateInfo.subresourceRange.baseMipLevel = 0;
 	imgviewCreateInfo.subresourceRange.layerCount = (p_viewType == VK_IMAGE_VIEW_TYPE_CUBE) ? 6 : 1;
@@ -1881,6 +2577,8 @@ bool CVulkanCore::AllocateBufferMemory(VkBuffer p_buffer, VkMemoryPropertyFlags
 		std::cerr << "vkAllocateMemory failed " << res << std::endl;
 		return false;
 	}
+
+	TrackAllocation(p_devMem, bufferMemReq.size);
 	return true;
 }
 
@@ -1897,10 +2595,37 @@ bool CVulkanCore::BindBufferMemory(VkBuffer& p_buffer, VkDeviceMemory& p_devMem)
 
 void CVulkanCore::FreeDeviceMemory(VkDeviceMemory& p_devMem)
 {
+	if (p_devMem != VK_NULL_HANDLE)
+	{
+		std::lock_guard<std::mutex> lock(m_memoryMutex);
+		auto allocation = m_deviceAllocations.find(p_devMem);
+		if (allocation != m_deviceAllocations.end())
+		{
+			m_allocatedDeviceMemory -= allocation->second;
+			m_deviceAllocations.erase(allocation);
+		}
+	}
+
 	vkFreeMemory(m_vkDevice, p_devMem, nullptr);
 	p_devMem = VK_NULL_HANDLE;
 }
 
+void CVulkanCore::TrackAllocation(VkDeviceMemory p_devMem, VkDeviceSize p_size)
+{
+	std::lock_guard<std::mutex> lock(m_memoryMutex);
+	m_deviceAllocations[p_devMem] = p_size;
+	m_allocatedDeviceMemory += p_size;
+	m_peakDeviceMemory = (std::max)(m_peakDeviceMemory, m_allocatedDeviceMemory);
+}
+
+void CVulkanCore::GetDeviceMemoryStats(VkDeviceSize& p_allocated, VkDeviceSize& p_peak, uint32_t& p_allocationCount)
+{
+	std::lock_guard<std::mutex> lock(m_memoryMutex);
+	p_allocated = m_allocatedDeviceMemory;
+	p_peak = m_peakDeviceMemory;
+	p_allocationCount = (uint32_t)m_deviceAllocations.size();
+}
+
 void CVulkanCore::DestroyBuffer(VkBuffer &p_buffer)
 {
 	vkDestroyBuffer(m_vkDevice, p_buffer, nullptr);
@@ -2236,29 +2961,4 @@ bool CVulkanCore::ListAvailableInstanceExtensions(std::vector<const char*> reqLi
 	}
 
 	return true;
-}
-
-char* BinaryLoader(const std::string pPath, size_t& pDataSize)
-{
-	std::ifstream is(pPath, std::ios::binary | std::ios::in | std::ios::ate);
-	if (is.is_open())
-	{
-		pDataSize = (size_t)is.tellg();
-		if (pDataSize < 1)
-		{
-			assert(pDataSize > 0);
-			return nullptr;
-		}
-
-		is.seekg(0, std::ios::beg);
-
-		// Copy file contents into a buffer
-		char* Data = new char[pDataSize]();
-		is.read(Data, pDataSize);
-		is.close();
-
-		return Data;
-	}
-
-	return nullptr;
 }
\ No newline at end of file
@@ -14,7 +14,13 @@
 #define VULKAN_DEBUG_MARKERS 1
 #endif
 
+// 0 keeps the pipeline cache in memory, every start compiles all pipelines again
+// 1 loads and saves a pipeline cache next to the engine, see CreatePipelineCache
+#define VULKAN_PIPELINE_CACHE 1
+
+#if defined(_WIN32)
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 
 #include <assert.h>
 #include <iostream>
@@ -22,7 +28,9 @@
 #include <vulkan/vulkan.h>
 #include <filesystem>
 
-char* BinaryLoader(const std::string pPath, size_t& pDataSize);
+#include "ShaderCompiler.h"
+#include <mutex>
+#include <unordered_map>
 
 class CVulkanCore
 {
@@ -34,6 +42,7 @@ public:
 		VkQueueFlagBits										queueType;
 		VkImageUsageFlags									swapChaineImageUsage;
 		VkFormat											swapchainImageFormat;
+		bool												headless;			// no surface; the swapchain images are plain offscreen images
 	};
 
 	struct VertexBinding
@@ -118,6 +127,7 @@ public:
 		std::filesystem::path								shaderpath_vertex;
 		std::filesystem::path								shaderpath_fragment;
 		std::filesystem::path								shaderpath_compute;
+		std::vector<std::string>							defines;		// NAME or NAME=VALUE, runtime compilation only
 	};
 
 	struct Pipeline
@@ -138,14 +148,21 @@ public:
 		VkFormat											depthAttachFormat;
 
 		bool												isWireframe;
+		uint32_t											features;		// specialization constant FEATURE_PERMUTATION_ID
 		VkPipelineLayout									pipeLayout;
 		VkPipeline											pipeline;
 
 		Pipeline() :
-			cullMode(VK_CULL_MODE_BACK_BIT)
+			vertexShader(VK_NULL_HANDLE)
+			, fragmentShader(VK_NULL_HANDLE)
+			, computeShader(VK_NULL_HANDLE)
+			, cullMode(VK_CULL_MODE_BACK_BIT)
 			, depthCmpOp(VK_COMPARE_OP_LESS_OR_EQUAL)
 			, enableBlending(false)
-			, isWireframe(false) {}
+			, isWireframe(false)
+			, features(0)
+			, pipeLayout(VK_NULL_HANDLE)
+			, pipeline(VK_NULL_HANDLE) {}
 	};
 
 	struct Buffer
@@ -176,6 +193,7 @@ public:
 		VkDeviceMemory										devMem;
 
 		VkImageViewType										viewType;
+		VkComponentMapping									swizzle;		// of the image view, identity unless the texture was packed at import
 
 		VkFormat											format;
 		uint32_t											width;
@@ -187,7 +205,8 @@ public:
 		void SetLevelCount(uint32_t p_levelCount) { levelCount = p_levelCount; curLayout.resize(levelCount); }
 
 		Image() :
-			layerCount(1)
+			swizzle{}
+			, layerCount(1)
 			, levelCount(1) {
 			curLayout.resize(1);
 		}
@@ -221,11 +240,45 @@ public:
 			return 0;
 		}
 
+		// Bytes per 4x4 block of the block compressed formats, 0 for every other format
+		static uint8_t GetBytesPerBlock(VkFormat p_format)
+		{
+			switch (p_format)
+			{
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+			case VK_FORMAT_BC4_SNORM_BLOCK:
+				return 8;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+			case VK_FORMAT_BC5_SNORM_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				return 16;
+			default:
+				return 0;
+			}
+		}
+
+		static size_t GetMipSize(uint32_t p_width, uint32_t p_height, VkFormat p_format)
+		{
+			uint8_t bytesPerBlock = GetBytesPerBlock(p_format);
+			if (bytesPerBlock > 0)
+				return (size_t)((p_width + 3) / 4) * ((p_height + 3) / 4) * bytesPerBlock;
+
+			// the channels of packed formats share a 32 bit texel
+			if (p_format == VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 || p_format == VK_FORMAT_B10G11R11_UFLOAT_PACK32)
+				return (size_t)p_width * p_height * sizeof(uint32_t);
+
+			return (size_t)p_width * p_height * GetBytesPerChannel(p_format) * GetChannelCount(p_format);
+		}
+
 		static size_t GetTextureSizePerLayer(uint32_t p_width, uint32_t p_height,
 			VkFormat p_format, uint32_t p_mipCount,	std::vector<uint32_t>* p_mipOffsets)
 		{
 			size_t totalSize = 0;
-			uint32_t sizePerPixel = GetBytesPerChannel(p_format) * GetChannelCount(p_format);
 			
 			if(p_mipOffsets)
 				p_mipOffsets->clear();
@@ -235,9 +288,9 @@ public:
 				if(p_mipOffsets)
 					p_mipOffsets->push_back((uint32_t)totalSize);
 
-				totalSize += p_width * p_height * sizePerPixel;
-				p_width /= 2;
-				p_height /= 2;
+				totalSize += GetMipSize(p_width, p_height, p_format);
+				p_width = (p_width > 1) ? p_width / 2 : 1;
+				p_height = (p_height > 1) ? p_height / 2 : 1;
 			}
 			return totalSize;
 		}
@@ -245,10 +298,7 @@ public:
 		static size_t GetTextureSizePerLayerNoMips(uint32_t p_width, uint32_t p_height,
 			VkFormat p_format)
 		{
-			size_t totalSize = 0;
-			uint32_t sizePerPixel = GetBytesPerChannel(p_format) * GetChannelCount(p_format);
-			totalSize += p_width * p_height * sizePerPixel;
-			return totalSize;
+			return GetMipSize(p_width, p_height, p_format);
 		}
 	};
 
@@ -315,6 +365,7 @@ public:
 	typedef VkCommandBuffer									CommandBuffer;
 	typedef std::vector<VkCommandBuffer>					CommandBufferList;
 	typedef std::vector<VkSemaphore>						SemaphoreList;
+	typedef std::vector<uint64_t>							SemaphoreValueList;
 	typedef std::vector<VkPipelineStageFlags>				PipelineStageFlagsList;
 	typedef std::vector<VkFence>							FenceList;
 	typedef std::vector<Buffer>								BufferList;
@@ -338,17 +389,27 @@ public:
 	VkQueue GetSecondaryQueue()								{ return m_secondaryQueue;}
 	uint32_t GetQueueFamiliyIndex() const					{ return m_QFIndex; }
 	VkImageView GetSCImageView(uint32_t p_scIdx)			{ return m_swapchainImageViewList[p_scIdx]; }
+	uint32_t GetSwapchainImageCount() const					{ return m_swapchainImageCount; }
 	uint32_t GetRenderWidth()								{ return m_renderWidth; }
 	uint32_t GetRenderHeight()								{ return m_renderHeight; }
 	uint32_t GetScreenWidth()								{ return m_screenWidth; }
 	uint32_t GetScreenHeight()								{ return m_screenHeight; }
 
 	VkSwapchainKHR GetSwapChain()							{ return m_vkSwapchain; }
+	VkImage GetSCImage(uint32_t p_scIdx)					{ return m_swapchainImageList[p_scIdx]; }
+	bool IsHeadless() const									{ return m_headless; }
 	 
 	bool IsRayTracingEnabled()								{ return m_enabledRayTracing; }
+	float GetTimestampPeriod() const						{ return m_timestampPeriod; }	// ns per timestamp tick, 0 if not supported
+	uint32_t GetMaxBindlessTextures() const					{ return m_maxBindlessTextures; }	// slots of the bindless texture table the device allows
+	bool IsTextureCompressionBCEnabled() const				{ return m_enabledTextureCompressionBC; }
+	void GetDeviceMemoryStats(VkDeviceSize& p_allocated, VkDeviceSize& p_peak, uint32_t& p_allocationCount);
 
 protected:
 	bool													m_enabledRayTracing;
+	float													m_timestampPeriod;
+	uint32_t												m_maxBindlessTextures;
+	bool													m_enabledTextureCompressionBC;
 
 	uint32_t												m_renderWidth;
 	uint32_t												m_renderHeight;
@@ -364,8 +425,43 @@ protected:
 	VkQueue													m_secondaryQueue;
 	VkSurfaceKHR											m_vkSurface;
 	VkSwapchainKHR											m_vkSwapchain;
-	VkImage													m_swapchainImageList[FRAME_BUFFER_COUNT];
-	VkImageView												m_swapchainImageViewList[FRAME_BUFFER_COUNT];
+	uint32_t												m_swapchainImageCount;
+	VkImage													m_swapchainImageList[MAX_SWAPCHAIN_IMAGES];
+	VkImageView												m_swapchainImageViewList[MAX_SWAPCHAIN_IMAGES];
+
+	// Headless only, backing memory of the offscreen swapchain images
+	bool													m_headless;
+	uint32_t												m_headlessImageIndex;
+	VkDeviceMemory											m_headlessImageMemory[MAX_SWAPCHAIN_IMAGES];
+
+	// Every vkAllocateMemory goes through AllocateMemory or AllocateBufferMemory and is tracked here
+	std::mutex												m_memoryMutex;
+	std::unordered_map<VkDeviceMemory, VkDeviceSize>		m_deviceAllocations;
+	VkDeviceSize											m_allocatedDeviceMemory;
+	VkDeviceSize											m_peakDeviceMemory;
+
+	void TrackAllocation(VkDeviceMemory p_devMem, VkDeviceSize p_size);
+
+	// Submits, waits and presents on the queue are externally synchronized; the scene's loader threads submit their uploads
+	// while the render thread submits frames
+	std::mutex												m_queueMutex;
+
+	// Shared by every vkCreate*Pipelines call; pipeline caches are synchronized internally, so pipelines can be created on any thread
+	VkPipelineCache											m_vkPipelineCache;
+	std::filesystem::path									m_pipelineCachePath;
+
+	// What every pipeline was created from, so that it can be created again once its shaders change
+	struct PipelineShaders
+	{
+		ShaderPaths											paths;
+		std::string											debugName;
+	};
+
+#if RUNTIME_SHADER_COMPILATION == 1
+	CShaderCompiler											m_shaderCompiler;
+#endif
+	std::mutex												m_pipelineShaderMutex;
+	std::unordered_map<VkPipeline, PipelineShaders>			m_pipelineShaders;
 
 	VkPhysicalDeviceMemoryProperties m_vkPhysicalDeviceMemProp{};
 
@@ -395,12 +491,20 @@ public:
 	bool CreateSurface(HINSTANCE p_hnstns, HWND p_Hwnd);
 	bool CreateSwapChain(VkFormat p_format, VkImageUsageFlags p_imageUsage);
 	bool CreateSwapChainImages(VkFormat p_format);
+	bool CreateHeadlessSwapChain(VkFormat p_format, VkImageUsageFlags p_imageUsage);
 	bool CreateFramebuffer(VkRenderPass p_renderPass, VkFramebuffer& p_frameBuffer, VkImageView* p_imageViewList, uint32_t p_fbCount, uint32_t p_width, uint32_t p_height);
 	void DestroyFramebuffer(VkFramebuffer p_framebuffer);
 
 	bool AcquireNextSwapChain(VkSemaphore p_semaphore, uint32_t& p_swapChainID);
-
-	bool LoadShader(const char* p_shaderpath, VkShaderModule& p_shader);
+	// Stands in for vkQueuePresentKHR when headless, consumes the render complete semaphore
+	bool PresentHeadless(VkSemaphore p_waitSemaphore);
+	VkResult QueuePresent(const VkPresentInfoKHR& p_presentInfo);
+
+	bool LoadShader(const std::filesystem::path& p_shaderpath, const std::vector<std::string>& p_defines, VkShaderModule& p_shader);
+	// GLSL source of a shader, shaders/spirv/<name>.<stage>.spv maps to shaders/glsl/<name>.<stage> as glsl_to_spirv.py names them
+	static std::filesystem::path GetShaderSource(const std::filesystem::path& p_shaderpath);
+	// Sources changed on disk since they were compiled, always empty without runtime compilation
+	void GetOutdatedShaderSources(std::vector<std::filesystem::path>& p_sources);
 		
 	bool CreateDescriptorPool(VkDescriptorPoolSize* p_dpSizeList, uint32_t p_dpSizeCount, VkDescriptorPool& p_vkdescriptorPool);
 	void DestroyDescriptorPool(VkDescriptorPool p_descPool);
@@ -408,6 +512,9 @@ public:
 	bool AllocateDescriptorSets(VkDescriptorPool p_dPool, VkDescriptorSetLayout* p_dslList, uint32_t p_dslCount, VkDescriptorSet* p_vkDescriptorSet, void* p_next = VK_NULL_HANDLE);
 	bool CreateDescriptorSetLayout(VkDescriptorSetLayoutBinding* p_dsLayoutList, uint32_t p_dsLayoutCount, VkDescriptorSetLayout& p_vkdsLayout, void* p_next = VK_NULL_HANDLE, bool p_isBindless = false);
 	void DestroyDescriptorSetLayout(VkDescriptorSetLayout p_descLayput);
+	bool CreateDescriptorUpdateTemplate(const VkDescriptorUpdateTemplateEntry* p_entries, uint32_t p_entryCount, VkDescriptorSetLayout p_descLayout, VkDescriptorUpdateTemplate& p_template);
+	void UpdateDescriptorSetWithTemplate(VkDescriptorSet p_descSet, VkDescriptorUpdateTemplate p_template, const void* p_data);
+	void DestroyDescriptorUpdateTemplate(VkDescriptorUpdateTemplate p_template);
 
 	bool CreatePipelineLayout(VkPushConstantRange* p_pushConstants, uint32_t p_pcCount,
 		VkDescriptorSetLayout* p_descLayouts, uint32_t p_dlCount, 
@@ -416,7 +523,7 @@ public:
 	
 	bool CreateRenderpass(Renderpass& p_rpData);
 	void SetClearColorValue(Renderpass& p_renderpass, uint32_t p_attachmentIndex, const VkClearColorValue& p_colorClearValue);
-	void BeginRenderpass(VkFramebuffer p_frameBfr, const Renderpass& p_renderpass, VkCommandBuffer& p_cmdBfr);
+	void BeginRenderpass(VkFramebuffer p_frameBfr, const Renderpass& p_renderpass, VkCommandBuffer& p_cmdBfr, VkSubpassContents p_contents = VK_SUBPASS_CONTENTS_INLINE);
 	void EndRenderPass(VkCommandBuffer& p_cmdBfr);
 	void DestroyRenderpass(VkRenderPass p_renderpass);
 
@@ -424,13 +531,24 @@ public:
 	bool CreateGraphicsPipeline(const ShaderPaths& p_shaderPaths, Pipeline& pData, std::string p_debugName);
 	bool CreateComputePipeline(const ShaderPaths& p_shaderPaths, Pipeline& pData, std::string p_debugName);
 	void DestroyPipeline(Pipeline& p_pipeline);
+	// Builds p_source again with p_features as its FEATURE_PERMUTATION_ID specialization constant. The permutation
+	// shares the layout of p_source and is destroyed with DestroyPipelinePermutation
+	bool CreatePipelinePermutation(const Pipeline& p_source, uint32_t p_features, Pipeline& p_permutation);
+	void DestroyPipelinePermutation(Pipeline& p_permutation);
+	// Creates the pipeline again if any of its shaders is built from one of p_sources, returns whether it did.
+	// The pipeline must not be in use; a shader that fails to compile leaves the previous pipeline in place
+	bool ReloadPipeline(Pipeline& p_pipeline, const std::vector<std::filesystem::path>& p_sources);
+	bool CreatePipelineCache();
+	bool SavePipelineCache();
+	void DestroyPipelineCache();
 		
 	bool CreateCommandPool(uint32_t p_qfIndex, VkCommandPool& p_cmdPool);
 	bool ResetCommandPool(VkCommandPool& p_cmdPool);
 	void DestroyCommandPool(VkCommandPool p_cmdPool);
 	
-	bool CreateCommandBuffers(VkCommandPool p_cmdPool, VkCommandBuffer* p_cmdBuffers, uint32_t p_cbCount, std::string* p_debugNames);
+	bool CreateCommandBuffers(VkCommandPool p_cmdPool, VkCommandBuffer* p_cmdBuffers, uint32_t p_cbCount, std::string* p_debugNames, VkCommandBufferLevel p_level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 	bool BeginCommandBuffer(VkCommandBuffer& p_cmdBfr, const char* p_debugMarker);
+	bool BeginSecondaryCommandBuffer(VkCommandBuffer& p_cmdBfr, const VkCommandBufferInheritanceInfo& p_inheritance, const char* p_debugMarker);
 	void SetViewport(VkCommandBuffer p_cmdbfr, float p_minD, float p_maxD, float p_width, float p_height);
 	void SetScissors(VkCommandBuffer p_cmdBfr, uint32_t p_offX, uint32_t p_offY, uint32_t p_width, uint32_t p_height);
 	bool EndCommandBuffer(VkCommandBuffer& p_cmdBfr);
@@ -440,13 +558,22 @@ public:
 	bool WaitToFinish(VkQueue p_queue);
 	bool CreateSemaphor(VkSemaphore& p_semaphore, std::string p_dbgName);
 	void DestroySemaphore(VkSemaphore p_semaphore);
+	bool CreateTimelineSemaphore(VkSemaphore& p_semaphore, uint64_t p_initialValue, std::string p_dbgName);
+	bool WaitTimelineSemaphore(VkSemaphore p_semaphore, uint64_t p_value);
+	uint64_t GetTimelineSemaphoreValue(VkSemaphore p_semaphore);
 	bool CreateFence(VkFenceCreateFlags p_flags, VkFence& p_fence, std::string p_dbgName);
 	bool WaitFence(VkFence& p_fence);
 	bool ResetFence(VkFence& p_fence);
 	void DestroyFence(VkFence p_fence);
+	bool CreateTimestampQueryPool(VkQueryPool& p_queryPool, uint32_t p_queryCount, std::string p_dbgName);
+	void DestroyQueryPool(VkQueryPool p_queryPool);
+	void ResetQueryPool(VkQueryPool p_queryPool, uint32_t p_firstQuery, uint32_t p_queryCount);
+	bool GetQueryPoolResults(VkQueryPool p_queryPool, uint32_t p_firstQuery, uint32_t p_queryCount, uint64_t* p_results);
+	void WriteTimestamp(VkCommandBuffer p_cmdBfr, VkPipelineStageFlagBits p_stage, VkQueryPool p_queryPool, uint32_t p_query);
 
 	void IssueLayoutBarrier(VkImageLayout p_new, Image& p_image, VkCommandBuffer p_cmdBfr, int p_baseMipLevel = -1);
 	void IssueImageLayoutBarrier(VkImageLayout p_old, VkImageLayout p_new, uint32_t layerCount, uint32_t lavelCount, VkImage& p_image, VkImageUsageFlags p_usage, VkCommandBuffer p_cmdBfr, uint32_t p_baseMipLevel = 0, bool p_hasStencil = false);
+	void IssuePipelineBarrier2(const VkImageMemoryBarrier2* p_imageBarriers, uint32_t p_imageBarrierCount, VkCommandBuffer p_cmdBfr);
 	void IssueBufferBarrier(VkAccessFlags p_srcAcc, VkAccessFlags p_dstAcc, VkPipelineStageFlags p_srcStg, VkPipelineStageFlags p_dstStg, VkBuffer& p_buffer, VkCommandBuffer p_cmdBfr);
 
 	bool IsFormatSupported(VkFormat p_format, VkFormatFeatureFlags p_featureflag);
@@ -455,8 +582,10 @@ public:
 	
 	bool CreateImage(VkImageCreateInfo p_imageCreateInfo, VkImage& p_image);
 	bool AllocateImageMemory(VkImage p_image, VkMemoryPropertyFlags p_memFlags, VkDeviceMemory& p_devMem);
+	void GetImageMemoryRequirements(VkImage p_image, VkMemoryRequirements& p_memReq);
+	bool AllocateMemory(const VkMemoryRequirements& p_memReq, VkMemoryPropertyFlags p_memFlags, VkDeviceMemory& p_devMem);
 	bool BindImageMemory(VkImage& p_image, VkDeviceMemory& p_devMem);
-	bool CreateImagView(VkImageUsageFlags p_usage, VkImage p_image, VkFormat p_format, VkImageViewType p_viewType, uint32_t p_levelCount, VkImageView& p_imgView);
+	bool CreateImagView(VkImageUsageFlags p_usage, VkImage p_image, VkFormat p_format, VkImageViewType p_viewType, uint32_t p_levelCount, VkImageView& p_imgView, VkComponentMapping p_swizzle = VkComponentMapping{});
 	void DestroyImageView(VkImageView p_imageView);
 	void DestroyImage(VkImage p_image);
 	void ClearImage(VkCommandBuffer p_cmdBfr, VkImage p_src, VkImageLayout p_srclayout, VkClearValue p_clearValue);
@@ -21,7 +21,7 @@ bool CVulkanRHI::CreateCommandBuffer(VkCommandPool p_cmdPool, VkCommandBuffer* p
 bool CVulkanRHI::SubmitCommandBuffers(
 	CommandBufferList* p_commndBfrList, PipelineStageFlagsList* p_psfList, bool p_waitForFinish, 
 	VkFence* p_fence, bool p_waitforFence, SemaphoreList* p_signalList, SemaphoreList* p_waitList, 
-	QueueType p_queueType)
+	QueueType p_queueType, SemaphoreValueList* p_signalValues)
 {
 	if (!p_commndBfrList || !p_psfList)
 	{
@@ -61,6 +61,23 @@ bool CVulkanRHI::SubmitCommandBuffers(
 	submitInfo.pWaitSemaphores = p_waitList == nullptr ? nullptr : p_waitList->data();
 	submitInfo.waitSemaphoreCount = p_waitList == nullptr ? 0 : (uint32_t)p_waitList->size();
 	submitInfo.pWaitDstStageMask = p_psfList->data();
+
+	// values are only read for timeline semaphores, binary semaphores in the same list ignore theirs
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	if (p_signalValues != nullptr)
+	{
+		if (p_signalList == nullptr || p_signalList->size() != p_signalValues->size())
+		{
+			std::cerr << "CVulkanRHI::SubmitCommandBuffers - Signal semaphore count and signal value count mismatch. " << std::endl;
+			return false;
+		}
+
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = (uint32_t)p_signalValues->size();
+		timelineInfo.pSignalSemaphoreValues = p_signalValues->data();
+		submitInfo.pNext = &timelineInfo;
+	}
+
 	if (!SubmitCommandbuffer(queue, &submitInfo, 1, (p_fence == nullptr ? VK_NULL_HANDLE : *p_fence)))
 		return false;
 
@@ -180,7 +197,7 @@ bool CVulkanRHI::CreateTexture(Buffer& p_staging, Image& p_Image, VkImageCreateI
 	
 	SetDebugName((uint64_t)p_Image.image, VK_OBJECT_TYPE_IMAGE, (p_DebugName + "_image").c_str());
 
-	if (!CreateImagView(p_createInfo.usage, p_Image.image, p_Image.format, p_Image.viewType, p_Image.GetLevelCount(), p_Image.descInfo.imageView))
+	if (!CreateImagView(p_createInfo.usage, p_Image.image, p_Image.format, p_Image.viewType, p_Image.GetLevelCount(), p_Image.descInfo.imageView, p_Image.swizzle))
 		return false;
 	
 	SetDebugName((uint64_t)p_Image.descInfo.imageView, VK_OBJECT_TYPE_IMAGE_VIEW, (p_DebugName + "_image_view").c_str());
@@ -221,7 +238,7 @@ void CVulkanRHI::CreateMipmaps(Image& p_image, VkCommandBuffer& p_cmdBfr)
 }
 
 bool CVulkanRHI::CreateRenderTarget(VkFormat p_format, uint32_t p_width, uint32_t p_height, uint32_t p_levelCount,
-	VkImageLayout p_layout, VkImageUsageFlags p_usage, Image& p_renderTarget, std::string p_DebugName)
+	VkImageLayout p_layout, VkImageUsageFlags p_usage, Image& p_renderTarget, std::string p_DebugName, bool p_bindMemory)
 {
 	VkFormatFeatureFlags feature;
 	if (p_usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
@@ -263,14 +280,25 @@ bool CVulkanRHI::CreateRenderTarget(VkFormat p_format, uint32_t p_width, uint32_
 
 	if (!CreateImage(imageCreateInfo, p_renderTarget.image))
 		return false;
+
+	SetDebugName((uint64_t)p_renderTarget.image, VK_OBJECT_TYPE_IMAGE, (p_DebugName + "_rt").c_str());
+
+	// memory is bound later by the owner, see BindRenderTargetMemory
+	if (!p_bindMemory)
+		return true;
+
 	if (!AllocateImageMemory(p_renderTarget.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, p_renderTarget.devMem))
 		return false;
-	if (!BindImageMemory(p_renderTarget.image, p_renderTarget.devMem))
+
+	return BindRenderTargetMemory(p_renderTarget, p_renderTarget.devMem);
+}
+
+bool CVulkanRHI::BindRenderTargetMemory(Image& p_renderTarget, VkDeviceMemory p_devMem)
+{
+	if (!BindImageMemory(p_renderTarget.image, p_devMem))
 		return false;
-	if (!CreateImagView(p_usage, p_renderTarget.image, p_renderTarget.format, VK_IMAGE_VIEW_TYPE_2D, p_levelCount, p_renderTarget.descInfo.imageView))
+	if (!CreateImagView(p_renderTarget.usage, p_renderTarget.image, p_renderTarget.format, VK_IMAGE_VIEW_TYPE_2D, p_renderTarget.GetLevelCount(), p_renderTarget.descInfo.imageView))
 		return false;
-	
-	SetDebugName((uint64_t)p_renderTarget.image, VK_OBJECT_TYPE_IMAGE, (p_DebugName + "_rt").c_str());
 
 	return true;
 }
@@ -394,7 +422,7 @@ bool CVulkanRHI::CreateDescriptors(	const DescDataList& p_descDataList, VkDescri
 	{
 		DescriptorData desc = p_descDataList[i];
 
-		dPSize.push_back(VkDescriptorPoolSize{ desc.type, desc.count * FRAME_BUFFER_COUNT });
+		dPSize.push_back(VkDescriptorPoolSize{ desc.type, desc.count * MAX_FRAMES_IN_FLIGHT });
 		dsLayoutBinding.push_back(VkDescriptorSetLayoutBinding{ (uint32_t)desc.bindingDest, desc.type, desc.count, desc.shaderStage });
 
 		if (p_bindFlags & DescriptorBindFlag::Variable_Count
@@ -41,14 +41,17 @@ public:
 		CommandBufferList* p_commndBfrList, PipelineStageFlagsList* p_psfList, 
 		bool p_waitForFinish = false, VkFence* p_fence = VK_NULL_HANDLE, 
 		bool p_waitforFence = false, SemaphoreList* p_signalList = nullptr, 
-		SemaphoreList* p_waitList = nullptr, QueueType p_queueType = QueueType::qt_Primary);
+		SemaphoreList* p_waitList = nullptr, QueueType p_queueType = QueueType::qt_Primary,
+		SemaphoreValueList* p_signalValues = nullptr);		// one value per signal semaphore when any of them is a timeline semaphore
 
 	bool SubmitCommandBuffer(CommandBuffer p_commndBfr, bool p_waitForFinish = false, QueueType p_queueType = QueueType::qt_Primary);
 
 	bool CreateAllocateBindBuffer(size_t p_size, Buffer& p_buffer, VkBufferUsageFlags p_bfrUsg, VkMemoryPropertyFlags p_propFlagm, std::string p_DebugName);
 	bool CreateTexture(Buffer& p_staging, Image& p_Image, VkImageCreateInfo p_createInfo, VkCommandBuffer& p_cmdBfr, std::string p_DebugName, bool p_createMips = true);
 	void CreateMipmaps(Image& p_image, VkCommandBuffer& p_cmdBfr);
-	bool CreateRenderTarget(VkFormat p_format, uint32_t p_width, uint32_t p_height, uint32_t p_LevelCount, VkImageLayout p_Layout, VkImageUsageFlags p_usage, Image& p_renderTarget, std::string p_DebugName);
+	bool CreateRenderTarget(VkFormat p_format, uint32_t p_width, uint32_t p_height, uint32_t p_LevelCount, VkImageLayout p_Layout, VkImageUsageFlags p_usage, Image& p_renderTarget, std::string p_DebugName, bool p_bindMemory = true);
+	// For render targets created without memory; binds them to memory that may be shared with other render targets and creates the view
+	bool BindRenderTargetMemory(Image& p_renderTarget, VkDeviceMemory p_devMem);
 	void ClearImage(CommandBuffer p_cmdBfr, CVulkanRHI::Image p_src, VkClearValue p_clearValue);
 	void CopyImage(CommandBuffer p_cmdBfr, CVulkanRHI::Image p_src, CVulkanRHI::Image p_dest);
 
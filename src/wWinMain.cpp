@@ -23,6 +23,13 @@ int __stdcall WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdL
         {
             CRasterRender rasterRender("VFrame Renderer", DISPLAY_RESOLUTION_X, DISPLAY_RESOLUTION_Y, 1);
             CWinCore* winCore = &rasterRender;
+
+            // a scene file on the command line, such as the session saved on exit, is loaded instead of the default scene
+            std::string scenePath = lpCmdLine ? lpCmdLine : "";
+            if (scenePath.size() >= 2 && scenePath.front() == '"' && scenePath.back() == '"')
+                scenePath = scenePath.substr(1, scenePath.size() - 2);
+            if (!scenePath.empty())
+                rasterRender.SetScenePath(scenePath);
             
             if (!winCore->initialize())
                 exit(EXIT_FAILURE);